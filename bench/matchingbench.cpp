@@ -0,0 +1,155 @@
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <filesystem>
+
+#include "syntheticbook.hpp"
+#include "../src/agent/stockexchange.hpp"
+#include "../src/networking/networkentity.hpp"
+#include "../src/trade/sessioncheckpoint.hpp"
+
+/** Benchmarks of the exchange's matching of limit, market and fill-or-kill orders against synthetic books.
+ *  Each run opens an exchange on a checkpoint of the book, outside the timing, and replays a batch of orders through
+ *  its matching engine in the calling thread, which includes writing the trade tape, market data and LOB snapshots.
+ *  Arguments: book type (0 heap, 1 ladder), price levels each side, orders each side, price distribution (0 uniform, 1 concentrated). */
+
+namespace
+{
+    /** Orders replayed in each run. */
+    constexpr int BATCH = 256;
+
+    /** Resting orders are sent by agents 1 to 63 and aggressing orders by agent 64. */
+    constexpr int AGGRESSOR_ID = 64;
+
+    /** Writes a checkpoint of the synthetic book of the benchmark, which the exchanges of its runs open on. */
+    std::string writeCheckpoint(const benchmark::State& state, const std::filesystem::path& directory)
+    {
+        SyntheticBook synthetic {static_cast<int>(state.range(1)), static_cast<int>(state.range(2)), static_cast<PriceDistribution>(state.range(3))};
+        SessionCheckpoint checkpoint;
+        SessionCheckpoint::Book& book = checkpoint.books[SyntheticBook::TICKER];
+        for (LimitOrderPtr const& order : synthetic.orders())
+        {
+            book.orders.push_back(SessionCheckpoint::RestingOrder{order, order->sender_id, "bench_" + std::to_string(order->sender_id)});
+        }
+        checkpoint.orders_created = static_cast<int>(book.orders.size());
+
+        std::string path = (directory / "book.bin").string();
+        checkpoint.save(path);
+        return path;
+    }
+
+    /** Runs the given batch against a fresh copy of the benchmark's book in each iteration. */
+    void runMatching(benchmark::State& state, const std::vector<MessagePtr>& batch)
+    {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / ("dsxe_bench_" + std::to_string(::getpid()));
+        std::filesystem::create_directories(directory);
+
+        ExchangeConfigPtr config = std::make_shared<ExchangeConfig>();
+        config->agent_id = 0;
+        config->name = "bench";
+        config->tickers = {SyntheticBook::TICKER};
+        config->connect_time = 0;
+        config->trading_time = 0;
+        config->order_book_type = state.range(0) == 0 ? OrderBookType::HEAP : OrderBookType::LADDER;
+        config->output_dir = directory.string();
+        config->restore_file = writeCheckpoint(state, directory);
+
+        asio::io_context io_context;
+        NetworkEntity entity {io_context, std::string{"127.0.0.1"}, 0};
+        size_t trades = 0;
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            std::shared_ptr<StockExchange> exchange = std::make_shared<StockExchange>(&entity, config, true);
+            state.ResumeTiming();
+
+            trades += exchange->replay(batch).size();
+
+            state.PauseTiming();
+            exchange->terminate();
+            exchange.reset();
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(state.iterations() * batch.size());
+        state.counters["trades_per_run"] = static_cast<double>(trades) / std::max<size_t>(state.iterations(), 1);
+
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+    }
+
+    SyntheticBook syntheticBook(const benchmark::State& state)
+    {
+        // Seeded apart from the book, so that the orders do not mirror the resting ones
+        return SyntheticBook{static_cast<int>(state.range(1)), static_cast<int>(state.range(2)),
+            static_cast<PriceDistribution>(state.range(3)), 2};
+    }
+
+    void bookArguments(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->ArgNames({"book", "levels", "orders", "distribution"})->Unit(benchmark::kMicrosecond);
+        for (int book : {0, 1})
+        {
+            for (auto [levels, orders] : {std::pair{10, 1000}, std::pair{100, 10000}})
+            {
+                for (int distribution : {0, 1})
+                {
+                    benchmark->Args({book, levels, orders, distribution});
+                }
+            }
+        }
+    }
+}
+
+/** Limit orders alternately resting in the book and crossing up to three levels into it. */
+static void BM_MatchLimit(benchmark::State& state)
+{
+    SyntheticBook synthetic = syntheticBook(state);
+    std::vector<MessagePtr> batch;
+    for (int i = 0; i < BATCH; ++i)
+    {
+        Order::Side side = (i % 4 < 2) ? Order::Side::BID : Order::Side::ASK;
+        LimitOrderMessagePtr msg = (i % 2 == 0)
+            ? synthetic.restingMessage(side, AGGRESSOR_ID)
+            : synthetic.aggressiveMessage(side, 1 + i % 3, synthetic.quantity(), Order::TimeInForce::GTC, AGGRESSOR_ID);
+        batch.push_back(msg);
+    }
+    runMatching(state, batch);
+}
+BENCHMARK(BM_MatchLimit)->Apply(bookArguments);
+
+/** Market orders, each the size of a few resting orders. */
+static void BM_MatchMarket(benchmark::State& state)
+{
+    SyntheticBook synthetic = syntheticBook(state);
+    std::vector<MessagePtr> batch;
+    for (int i = 0; i < BATCH; ++i)
+    {
+        MarketOrderMessagePtr msg = std::make_shared<MarketOrderMessage>();
+        msg->sender_id = AGGRESSOR_ID;
+        msg->agent_name = "bench_" + std::to_string(AGGRESSOR_ID);
+        msg->client_order_id = 0;
+        msg->ticker = SyntheticBook::TICKER;
+        msg->side = (i % 2 == 0) ? Order::Side::BID : Order::Side::ASK;
+        msg->quantity = 3 * synthetic.quantity();
+        msg->priv_value = SyntheticBook::MID_PRICE;
+        batch.push_back(msg);
+    }
+    runMatching(state, batch);
+}
+BENCHMARK(BM_MatchMarket)->Apply(bookArguments);
+
+/** Fill-or-kill orders, half of them too large for the levels they may cross and killed. */
+static void BM_MatchFOK(benchmark::State& state)
+{
+    SyntheticBook synthetic = syntheticBook(state);
+    std::vector<MessagePtr> batch;
+    for (int i = 0; i < BATCH; ++i)
+    {
+        Order::Side side = (i % 2 == 0) ? Order::Side::BID : Order::Side::ASK;
+        int quantity = (i % 4 < 2) ? synthetic.quantity() : 1000 * synthetic.quantity();
+        batch.push_back(synthetic.aggressiveMessage(side, 2, quantity, Order::TimeInForce::FOK, AGGRESSOR_ID));
+    }
+    runMatching(state, batch);
+}
+BENCHMARK(BM_MatchFOK)->Apply(bookArguments);
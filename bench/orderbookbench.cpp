@@ -0,0 +1,158 @@
+#include <benchmark/benchmark.h>
+
+#include "syntheticbook.hpp"
+#include "../src/order/orderbook.hpp"
+#include "../src/order/orderbooktype.hpp"
+
+/** Benchmarks of the order book operations, on synthetic books of each implementation.
+ *  Arguments: book type (0 heap, 1 ladder), price levels each side, orders each side, price distribution (0 uniform, 1 concentrated). */
+
+namespace
+{
+    /** Orders added or removed between pauses to restore the book. */
+    constexpr int BATCH = 256;
+
+    OrderBookType bookType(const benchmark::State& state)
+    {
+        return state.range(0) == 0 ? OrderBookType::HEAP : OrderBookType::LADDER;
+    }
+
+    SyntheticBook syntheticBook(const benchmark::State& state)
+    {
+        return SyntheticBook{static_cast<int>(state.range(1)), static_cast<int>(state.range(2)),
+            static_cast<PriceDistribution>(state.range(3))};
+    }
+
+    /** Returns a book of the benchmark's type filled with the synthetic book's orders. */
+    OrderBookPtr filledBook(const benchmark::State& state, SyntheticBook& synthetic, std::vector<LimitOrderPtr>& orders)
+    {
+        OrderBookPtr book = OrderBook::create(SyntheticBook::TICKER, bookType(state));
+        orders = synthetic.orders();
+        for (LimitOrderPtr const& order : orders)
+        {
+            book->addOrder(order);
+        }
+        return book;
+    }
+
+    void bookArguments(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->ArgNames({"book", "levels", "orders", "distribution"});
+        for (int book : {0, 1})
+        {
+            for (auto [levels, orders] : {std::pair{10, 100}, std::pair{100, 1000}, std::pair{1000, 10000}})
+            {
+                for (int distribution : {0, 1})
+                {
+                    benchmark->Args({book, levels, orders, distribution});
+                }
+            }
+        }
+    }
+}
+
+static void BM_AddOrder(benchmark::State& state)
+{
+    SyntheticBook synthetic = syntheticBook(state);
+    std::vector<LimitOrderPtr> resting;
+    OrderBookPtr book = filledBook(state, synthetic, resting);
+
+    int next_id = static_cast<int>(resting.size()) + 1;
+    std::vector<LimitOrderPtr> batch;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        batch.clear();
+        for (int i = 0; i < BATCH; ++i)
+        {
+            batch.push_back(synthetic.order(next_id++, (i % 2 == 0) ? Order::Side::BID : Order::Side::ASK));
+        }
+        state.ResumeTiming();
+
+        for (LimitOrderPtr const& order : batch)
+        {
+            book->addOrder(order);
+        }
+
+        state.PauseTiming();
+        for (LimitOrderPtr const& order : batch)
+        {
+            book->removeOrder(order->id, order->side);
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH);
+}
+BENCHMARK(BM_AddOrder)->Apply(bookArguments);
+
+static void BM_RemoveOrder(benchmark::State& state)
+{
+    SyntheticBook synthetic = syntheticBook(state);
+    std::vector<LimitOrderPtr> resting;
+    OrderBookPtr book = filledBook(state, synthetic, resting);
+
+    std::mt19937 random_generator {1};
+    std::vector<LimitOrderPtr> batch;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        batch.clear();
+        std::sample(resting.begin(), resting.end(), std::back_inserter(batch), BATCH, random_generator);
+        state.ResumeTiming();
+
+        for (LimitOrderPtr const& order : batch)
+        {
+            benchmark::DoNotOptimize(book->removeOrder(order->id, order->side));
+        }
+
+        state.PauseTiming();
+        for (LimitOrderPtr const& order : batch)
+        {
+            book->addOrder(order);
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH);
+}
+BENCHMARK(BM_RemoveOrder)->Apply(bookArguments);
+
+static void BM_BestBidAsk(benchmark::State& state)
+{
+    SyntheticBook synthetic = syntheticBook(state);
+    std::vector<LimitOrderPtr> resting;
+    OrderBookPtr book = filledBook(state, synthetic, resting);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(book->bestBid());
+        benchmark::DoNotOptimize(book->bestAsk());
+    }
+}
+BENCHMARK(BM_BestBidAsk)->Apply(bookArguments);
+
+static void BM_WorstBidAsk(benchmark::State& state)
+{
+    SyntheticBook synthetic = syntheticBook(state);
+    std::vector<LimitOrderPtr> resting;
+    OrderBookPtr book = filledBook(state, synthetic, resting);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(book->worstBid());
+        benchmark::DoNotOptimize(book->worstAsk());
+    }
+}
+BENCHMARK(BM_WorstBidAsk)->Apply(bookArguments);
+
+static void BM_LiveMarketData(benchmark::State& state)
+{
+    SyntheticBook synthetic = syntheticBook(state);
+    std::vector<LimitOrderPtr> resting;
+    OrderBookPtr book = filledBook(state, synthetic, resting);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(book->getLiveMarketData(Order::Side::BID));
+    }
+}
+BENCHMARK(BM_LiveMarketData)->Apply(bookArguments);
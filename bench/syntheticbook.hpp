@@ -0,0 +1,128 @@
+#ifndef SYNTHETIC_BOOK_HPP
+#define SYNTHETIC_BOOK_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/order/limitorder.hpp"
+#include "../src/order/orderbook.hpp"
+#include "../src/message/limit_order_message.hpp"
+
+/** How the orders of a synthetic book are spread over its price levels. */
+enum class PriceDistribution : int
+{
+    UNIFORM,      // evenly over every level
+    CONCENTRATED, // geometrically, most of them at the levels nearest the touch
+};
+
+/** Generates the resting orders of a synthetic book around a mid price, the same ones for the same seed,
+ *  so that benchmarks of different books run on identical input. */
+class SyntheticBook
+{
+public:
+
+    static constexpr const char* TICKER = "BENCH";
+    static constexpr int MID_PRICE = 10000; // ticks
+
+    /** A book of the given number of price levels each side, holding the given number of orders each side. */
+    SyntheticBook(int levels, int orders, PriceDistribution distribution, unsigned int seed = 1)
+    : levels_{std::max(levels, 1)},
+      orders_{std::max(orders, 1)},
+      distribution_{distribution},
+      random_generator_{seed}
+    {
+    }
+
+    /** Returns the price (ticks) of a new order on the given side. */
+    int price(Order::Side side)
+    {
+        int level;
+        if (distribution_ == PriceDistribution::UNIFORM)
+        {
+            level = std::uniform_int_distribution<int>{0, levels_ - 1}(random_generator_);
+        }
+        else
+        {
+            // About a fifth of the orders at each level of the touch's top five, fewer further out
+            level = std::min(static_cast<int>(std::geometric_distribution<int>{0.2}(random_generator_)), levels_ - 1);
+        }
+        return (side == Order::Side::BID) ? MID_PRICE - 1 - level : MID_PRICE + 1 + level;
+    }
+
+    /** Returns a quantity for a new order. */
+    int quantity()
+    {
+        return std::uniform_int_distribution<int>{1, 10}(random_generator_) * 10;
+    }
+
+    /** Returns a new resting order with the given ID on the given side. */
+    LimitOrderPtr order(int id, Order::Side side)
+    {
+        LimitOrderPtr order = std::make_shared<LimitOrder>(id);
+        order->ticker = TICKER;
+        order->side = side;
+        order->time_in_force = Order::TimeInForce::GTC;
+        order->status = Order::Status::NEW;
+        order->price = price(side);
+        order->remaining_quantity = quantity();
+        order->cumulative_quantity = 0;
+        order->priv_value = order->price;
+        order->sender_id = id % 64;
+        order->timestamp_created = id;
+        return order;
+    }
+
+    /** Returns the resting orders of the book, bids and asks alternately, with IDs from 1. */
+    std::vector<LimitOrderPtr> orders()
+    {
+        std::vector<LimitOrderPtr> orders;
+        orders.reserve(2 * orders_);
+        for (int i = 0; i < 2 * orders_; ++i)
+        {
+            orders.push_back(order(i + 1, (i % 2 == 0) ? Order::Side::BID : Order::Side::ASK));
+        }
+        return orders;
+    }
+
+    /** Returns a new limit order message resting on the given side, from the given sender. */
+    LimitOrderMessagePtr restingMessage(Order::Side side, int sender_id)
+    {
+        return message(side, price(side), quantity(), Order::TimeInForce::GTC, sender_id);
+    }
+
+    /** Returns a limit order message on the given side priced through the given number of levels of the opposite side. */
+    LimitOrderMessagePtr aggressiveMessage(Order::Side side, int levels_through, int quantity, Order::TimeInForce time_in_force, int sender_id)
+    {
+        int price = (side == Order::Side::BID) ? MID_PRICE + levels_through : MID_PRICE - levels_through;
+        return message(side, price, quantity, time_in_force, sender_id);
+    }
+
+    int levels() const { return levels_; }
+
+private:
+
+    LimitOrderMessagePtr message(Order::Side side, int price, int quantity, Order::TimeInForce time_in_force, int sender_id)
+    {
+        LimitOrderMessagePtr msg = std::make_shared<LimitOrderMessage>();
+        msg->sender_id = sender_id;
+        msg->agent_name = "bench_" + std::to_string(sender_id);
+        msg->client_order_id = 0;
+        msg->ticker = TICKER;
+        msg->side = side;
+        msg->time_in_force = time_in_force;
+        msg->price = price;
+        msg->quantity = quantity;
+        msg->priv_value = price;
+        return msg;
+    }
+
+    int levels_;
+    int orders_;
+    PriceDistribution distribution_;
+    std::mt19937 random_generator_;
+};
+
+#endif
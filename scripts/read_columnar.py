@@ -0,0 +1,61 @@
+"""
+Loads the columnar outputs of the exchange (.col trade tapes, market data feeds and LOB snapshots)
+into pandas DataFrames. The file layout is described in src/utilities/columnarwriter.hpp.
+
+Usage: python read_columnar.py <file.col> [<file.col> ...]
+"""
+import struct
+import sys
+
+import numpy as np
+import pandas as pd
+
+MAGIC = b"SIMCOL01"
+NUMERIC_TYPES = {1: "<i8", 2: "<u8", 3: "<f8"}
+STRING_TYPE = 4
+
+
+def read_columnar(path):
+    """Returns the rows of the given columnar file as a DataFrame."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if not data:
+        return pd.DataFrame()
+    if data[:len(MAGIC)] != MAGIC:
+        raise ValueError(f"{path} is not a columnar output file")
+
+    pos = len(MAGIC)
+    (column_count,) = struct.unpack_from("<I", data, pos)
+    pos += 4
+    schema = []
+    for _ in range(column_count):
+        column_type, name_length = struct.unpack_from("<BI", data, pos)
+        pos += 5
+        schema.append((data[pos:pos + name_length].decode(), column_type))
+        pos += name_length
+
+    chunks = {name: [] for name, _ in schema}
+    while pos < len(data):
+        (rows,) = struct.unpack_from("<I", data, pos)
+        pos += 4
+        for name, column_type in schema:
+            (length,) = struct.unpack_from("<Q", data, pos)
+            pos += 8
+            values = data[pos:pos + length]
+            pos += length
+            if column_type == STRING_TYPE:
+                ends = np.frombuffer(values, dtype="<u4", count=rows)
+                text = values[4 * rows:]
+                starts = np.concatenate(([0], ends[:-1]))
+                chunks[name].append(np.array([text[s:e].decode() for s, e in zip(starts, ends)], dtype=object))
+            else:
+                chunks[name].append(np.frombuffer(values, dtype=NUMERIC_TYPES[column_type], count=rows))
+
+    return pd.DataFrame({name: np.concatenate(parts) if parts else [] for name, parts in chunks.items()})
+
+
+if __name__ == "__main__":
+    for path in sys.argv[1:]:
+        df = read_columnar(path)
+        print(f"{path}: {len(df)} rows")
+        print(df.head())
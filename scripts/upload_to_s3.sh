@@ -49,7 +49,7 @@ process_and_upload() {
     echo "Processing $data_type files..."
     
     # Count files to determine trials per configuration
-    local total_files=$(find "$src_dir" -name "*.csv" | wc -l)
+    local total_files=$(find "$src_dir" -name "*.csv" -o -name "*.csv.zst" | wc -l)
     echo "Found $total_files $data_type files"
     
     # Calculate actual configuration number based on CONFIG_START and current_config
@@ -60,12 +60,18 @@ process_and_upload() {
     local trial_count=1
     
     # For each file in source directory
-    for file in "$src_dir"/*.csv; do
+    for file in "$src_dir"/*.csv "$src_dir"/*.csv.zst; do
         if [ -f "$file" ]; then
             filename=$(basename "$file")
+
+            # Keep the extension of compressed files
+            extension=".csv"
+            if [[ "$filename" == *.csv.zst ]]; then
+                extension=".csv.zst"
+            fi
             
             # Create new simpler filename with configuration number and trial number
-            new_filename="config_${absolute_config}_trial_${trial_count}_${data_type}.csv"
+            new_filename="config_${absolute_config}_trial_${trial_count}_${data_type}${extension}"
             
             # Copy file to temp directory with new filename
             cp "$file" "$temp_dir/$new_filename"
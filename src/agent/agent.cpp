@@ -1,5 +1,6 @@
 #include <iostream>
 #include <string>
+#include <charconv>
 
 #include "agent.hpp"
 #include "../networking/networkentity.hpp"
@@ -27,12 +28,55 @@ void Agent::connect(ipv4_address address, std::string agent_name, std::function<
 void Agent::addToAddressBook(ipv4_view address, std::string_view agent_name)
 {
     // std::cout << "Adding to address book " << address << " " << agent_name << "\n";
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
     known_agents.left.insert({std::string{agent_name}, std::string{address}});
+    lock.unlock();
+
+    // Agents named by their ID can be reached without looking up the name
+    std::optional<int> agent_id = agentIdFromName(agent_name);
+    if (agent_id.has_value())
+    {
+        network()->addRoute(agent_id.value(), address);
+    }
 }
 
 void Agent::removeFromAddressBook(std::string_view agent_name)
 {
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
     known_agents.left.erase(std::string{agent_name});
+    lock.unlock();
+
+    std::optional<int> agent_id = agentIdFromName(agent_name);
+    if (agent_id.has_value())
+    {
+        network()->removeRoute(agent_id.value());
+    }
+}
+
+bool Agent::knowsAddress(ipv4_view address)
+{
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
+    return known_agents.right.find(std::string{address}) != known_agents.right.end();
+}
+
+std::optional<std::string> Agent::knownSender(ipv4_view address, int sender_id)
+{
+    auto [first, last] = known_agents.right.equal_range(std::string{address});
+    if (first == last) return std::nullopt;
+
+    // Agents sharing an address are named by their ID
+    std::string sender_name = std::to_string(sender_id);
+    for (auto it = first; it != last; ++it)
+    {
+        if (it->second == sender_name) return sender_name;
+    }
+
+    // Otherwise a sole agent known by a name, rather than another agent's ID
+    if (std::next(first) == last && !agentIdFromName(first->second).has_value())
+    {
+        return first->second;
+    }
+    return std::nullopt;
 }
 
 std::optional<MessagePtr> Agent::handleMessage(ipv4_view sender, MessagePtr message)
@@ -40,41 +84,49 @@ std::optional<MessagePtr> Agent::handleMessage(ipv4_view sender, MessagePtr mess
     // std::cout << "In agent handle message" << "\n";
 
     // Check if sender is in known agents address book
-    if (known_agents.right.find(std::string(sender)) != known_agents.right.end())
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
+    std::optional<std::string> known_sender = knownSender(sender, message->sender_id);
+    if (known_sender.has_value())
     {
         // Known sender from address book
-        return handleMessageFrom(known_agents.right.at(std::string(sender)), message);
+        std::string agent_name = known_sender.value();
+        lock.unlock();
+        return handleMessageFrom(agent_name, message);
     }
     else
     {
         // Unknown sender, add to address book
         std::string agent_id = std::to_string(message->sender_id);
-        addToAddressBook(sender, agent_id);
+        known_agents.left.insert({agent_id, std::string{sender}});
+        lock.unlock();
+        network()->addRoute(message->sender_id, sender);
         return handleMessageFrom(agent_id, message);
     }
 }
 
 void Agent::handleBroadcast(ipv4_view sender, MessagePtr message)
 {
-    if (known_agents.right.find(std::string(sender)) != known_agents.right.end())
-    {
-        // Known sender from address book
-        handleBroadcastFrom(known_agents.right.at(std::string(sender)), message);
-    }
-    else
-    {
-        // Unknown sender
-        handleBroadcastFrom("unknown", message);
-    }
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
+    std::string agent_name = knownSender(sender, message->sender_id).value_or("unknown");
+    lock.unlock();
+
+    // Senders missing from the address book are unknown
+    handleBroadcastFrom(agent_name, message);
 }
 
 void Agent::sendMessageTo(std::string_view agent_name, MessagePtr message, bool async)
 {
     // std::cout << "Sending message to " << agent_name << "\n";
-    if (known_agents.left.find(std::string{agent_name}) != known_agents.left.end())
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
+    auto it = known_agents.left.find(std::string{agent_name});
+    if (it != known_agents.left.end())
     {
         // std::cout << "Agent found in address book\n";
-        network()->sendMessage(known_agents.left.at(std::string{agent_name}), message, async);
+        std::string address = it->second;
+        lock.unlock();
+        message->recipient_id = agentIdFromName(agent_name).value_or(-1);
+        message->markSent(agent_id);
+        network()->sendMessage(address, message, async);
     }
     else
     {
@@ -83,11 +135,49 @@ void Agent::sendMessageTo(std::string_view agent_name, MessagePtr message, bool
     }
 }
 
+void Agent::sendMessageTo(int agent_id, MessagePtr message, bool async)
+{
+    // Fall back to the address book for agents without a route, which throws if the agent is unknown
+    message->recipient_id = agent_id;
+    message->markSent(this->agent_id);
+    if (!network()->sendMessage(agent_id, message, async))
+    {
+        sendMessageTo(std::to_string(agent_id), message, async);
+    }
+}
+
+void Agent::sendMessageTo(const std::vector<std::string>& agent_names, MessagePtr message, bool async)
+{
+    std::vector<std::string> addresses;
+    addresses.reserve(agent_names.size());
+
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
+    for (std::string const& agent_name : agent_names)
+    {
+        auto it = known_agents.left.find(agent_name);
+        if (it == known_agents.left.end())
+        {
+            throw std::runtime_error(std::string{"Unknown agent name: "} + agent_name);
+        }
+        addresses.push_back(it->second);
+    }
+    lock.unlock();
+
+    message->markSent(agent_id);
+    network()->sendMessage(addresses, message, async);
+}
+
 void Agent::sendBroadcastTo(std::string_view agent_name, MessagePtr message)
 {
-    if (known_agents.left.find(std::string{agent_name}) != known_agents.left.end())
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
+    auto it = known_agents.left.find(std::string{agent_name});
+    if (it != known_agents.left.end())
     {
-        network()->sendBroadcast(known_agents.left.at(std::string{agent_name}), message);
+        std::string address = it->second;
+        lock.unlock();
+        message->recipient_id = agentIdFromName(agent_name).value_or(-1);
+        message->markSent(agent_id);
+        network()->sendBroadcast(address, message);
     }
     else
     {
@@ -96,16 +186,120 @@ void Agent::sendBroadcastTo(std::string_view agent_name, MessagePtr message)
     }
 }
 
+size_t Agent::sendQueueDepth(std::string_view agent_name)
+{
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
+    auto it = known_agents.left.find(std::string{agent_name});
+    if (it == known_agents.left.end()) return 0;
+    std::string address = it->second;
+    lock.unlock();
+
+    return network()->sendQueueDepth(address);
+}
+
+bool Agent::runsInProcess(std::string_view agent_name)
+{
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
+    auto it = known_agents.left.find(std::string{agent_name});
+    if (it == known_agents.left.end()) return false;
+    std::string address = it->second;
+    lock.unlock();
+
+    return LocalTransport::instance().find(address) != nullptr;
+}
+
+bool Agent::sendQueueBacklogged(std::string_view agent_name)
+{
+    if (!network()->sendQueueBounded()) return false;
+
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
+    auto it = known_agents.left.find(std::string{agent_name});
+    if (it == known_agents.left.end()) return false;
+    std::string address = it->second;
+    lock.unlock();
+
+    return network()->sendQueueBacklogged(address);
+}
+
+bool Agent::sendQueueBacklogged(int agent_id)
+{
+    return network()->sendQueueBacklogged(agent_id);
+}
+
 void Agent::sendBroadcast(std::string_view address, MessagePtr message)
 {
+    message->markSent(agent_id);
     network()->sendBroadcast(address, message);
 }
 
+void Agent::sendBroadcast(std::span<const std::string> addresses, MessagePtr message)
+{
+    message->markSent(agent_id);
+    network()->sendBroadcast(addresses, message);
+}
+
+void Agent::forwardBroadcast(std::span<const std::string> addresses, MessagePtr message)
+{
+    network()->sendBroadcast(addresses, message);
+}
+
+void Agent::forwardMessage(int agent_id, MessagePtr message, bool async)
+{
+    if (!network()->sendMessage(agent_id, message, async))
+    {
+        throw std::runtime_error("Unknown agent ID: " + std::to_string(agent_id));
+    }
+}
+
+void Agent::joinMulticastGroup(ipv4_view group_address)
+{
+    network()->joinMulticastGroup(group_address);
+}
+
+void Agent::attachSharedMemoryFeed(std::string_view agent_name, const std::string& path, uint64_t token)
+{
+    std::unique_lock<std::mutex> lock(known_agents_mutex_);
+    auto it = known_agents.left.find(std::string{agent_name});
+    if (it == known_agents.left.end())
+    {
+        throw std::runtime_error("Unknown agent name: " + std::string{agent_name});
+    }
+    std::string address = it->second;
+    lock.unlock();
+
+    network()->attachSharedMemoryFeed(path, token, address);
+}
+
+bool Agent::publishSharedMemory(SharedMemoryRing& ring, MessagePtr message)
+{
+    message->markSent(agent_id);
+    return network()->publishSharedMemory(ring, message);
+}
+
+bool Agent::emulatesLinks()
+{
+    return network()->emulatesLinks();
+}
+
 NetworkEntity* Agent::network()
 {
     return network_;
 }
 
+std::optional<int> Agent::agentIdFromName(std::string_view agent_name)
+{
+    int agent_id;
+    const char* end = agent_name.data() + agent_name.size();
+    auto [ptr, ec] = std::from_chars(agent_name.data(), end, agent_id);
+    if (ec != std::errc{} || ptr != end) return std::nullopt;
+    return agent_id;
+}
+
+void Agent::setOrchestratorAddress(ipv4_view address)
+{
+    orchestrator_addr_ = std::string{address};
+}
+
 unsigned int Agent::myPort()
 {
     return network()->port();
@@ -116,6 +310,16 @@ std::string Agent::myAddr()
     return network()->addr();
 }
 
+asio::io_context& Agent::ioContext()
+{
+    return network()->ioContext();
+}
+
+void Agent::placeIOThreads()
+{
+    network()->placeIOThreads();
+}
+
 int Agent::getAgentId()
 {
     return agent_id;
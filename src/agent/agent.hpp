@@ -2,13 +2,17 @@
 #define AGENT_HPP
 
 #include <iostream>
+#include <mutex>
+#include <span>
 #include <tuple>
 #include <boost/asio.hpp>
 #include <boost/bimap.hpp>
+#include <boost/bimap/multiset_of.hpp>
 
 #include "../config/agentconfig.hpp"
 #include "../message/message.hpp"
 #include "../message/messagetype.hpp"
+#include "../utilities/sharedmemoryring.hpp"
 
 namespace asio = boost::asio;
 
@@ -20,7 +24,7 @@ class Agent : std::enable_shared_from_this<Agent>
 public:
     typedef std::string ipv4_address;
     typedef std::string_view ipv4_view;
-    typedef boost::bimap<std::string, ipv4_address> address_book;
+    typedef boost::bimap<std::string, boost::bimaps::multiset_of<ipv4_address>> address_book;
 
     Agent() = delete;
     virtual ~Agent() = default;
@@ -40,24 +44,80 @@ public:
     /** Returns agent ID. */
     int getAgentId();
 
+    /** Records the address of the orchestrator that configured the agent, to report back to. */
+    void setOrchestratorAddress(ipv4_view address);
+
     /** Establishes a lasting connection with the agent at the given address. */
     void connect(ipv4_address address, std::string agent_name, std::function<void()> const& callback);
 
-    /** Sends a message to the known agent with the given name. */
+    /** Sends a message to the known agent with the given name. 
+     *  Agents named by their ID are set as the recipient, so the message must not be shared with sends to other agents. */
     void sendMessageTo(std::string_view agent_name, MessagePtr message, bool async = false);
 
+    /** Sends a message to the known agent with the given ID, through the routing table filled at connect time. 
+     *  The agent is set as the recipient, so the message must not be shared with sends to other agents. */
+    void sendMessageTo(int agent_id, MessagePtr message, bool async = false);
+
+    /** Sends the same message to each of the known agents with the given names. */
+    void sendMessageTo(const std::vector<std::string>& agent_names, MessagePtr message, bool async = false);
+
     /** Sends a broadcast to the agent with the given name. */
     void sendBroadcastTo(std::string_view agent_name, MessagePtr message);
 
     /** Sends a broadcast to the agent at the given address. */
     void sendBroadcast(std::string_view address, MessagePtr message);
 
+    /** Sends the same broadcast to the agents at each of the given addresses. */
+    void sendBroadcast(std::span<const std::string> addresses, MessagePtr message);
+
+    /** Sends the same broadcast to the agents at each of the given addresses as its sender sent it,
+     *  keeping the sender's ID and the time it was sent, as a relay passes on another agent's broadcasts. */
+    void forwardBroadcast(std::span<const std::string> addresses, MessagePtr message);
+
+    /** Sends a message already marked sent to the known agent with the given ID, keeping its sender's ID. */
+    void forwardMessage(int agent_id, MessagePtr message, bool async = false);
+
+    /** Starts receiving broadcasts sent to the given multicast group address. */
+    void joinMulticastGroup(ipv4_view group_address);
+
+    /** Starts reading the broadcasts the known agent with the given name writes to the shared memory ring at the given path.
+     *  Throws if the ring cannot be opened or is not the one with the given token. */
+    void attachSharedMemoryFeed(std::string_view agent_name, const std::string& path, uint64_t token);
+
+    /** Writes the broadcast to the given shared memory ring. Returns false if it does not fit in a slot. */
+    bool publishSharedMemory(SharedMemoryRing& ring, MessagePtr message);
+
+    /** Indicates whether the node emulates links to its peers, which messages through shared memory would bypass. */
+    bool emulatesLinks();
+
+    /** Returns the number of bytes waiting to be sent to the known agent with the given name. */
+    size_t sendQueueDepth(std::string_view agent_name);
+
+    /** Indicates whether messages to the known agent with the given name are queued above the high watermark. */
+    bool sendQueueBacklogged(std::string_view agent_name);
+
+    /** Indicates whether messages to the known agent with the given ID are queued above the high watermark. */
+    bool sendQueueBacklogged(int agent_id);
+
+    /** Indicates whether the known agent with the given name runs in this process, so that messages to it skip the network. */
+    bool runsInProcess(std::string_view agent_name);
+
     /** Adds the given agent to the address book. */
     void addToAddressBook(ipv4_view address, std::string_view agent_name);
 
     /** Removes the given agent from the address book. */
     void removeFromAddressBook(std::string_view agent_name);
 
+    /** Indicates whether an agent at the given address is in the address book. */
+    bool knowsAddress(ipv4_view address);
+
+    /** Indicates whether messages addressed by name rather than ID are for this agent when it shares a node with others,
+     *  as messages to an exchange are. */
+    virtual bool takesUnaddressedMessages() { return false; };
+
+    /** Appends the agent's own metrics, in the Prometheus text format, to those its node serves. Called from the IO threads. */
+    virtual void appendMetrics([[maybe_unused]] std::string& out) {};
+
     /** On receiving a new message, identifies the sender, adding to the address book if needed. */
     std::optional<MessagePtr> handleMessage(ipv4_view sender, MessagePtr message);
 
@@ -75,6 +135,12 @@ protected:
     /** Returns the public IPv4 address of the agent. */
     std::string myAddr();
 
+    /** Returns the IO context the agent's networking runs on. */
+    asio::io_context& ioContext();
+
+    /** Pins the threads running the networking of the agent's node as the process's thread placement says. */
+    void placeIOThreads();
+
     /** Derived classes must implement these: */
 
     /** Handles an incoming broadcast. */
@@ -83,13 +149,26 @@ protected:
     /** The unique ID of the agent in the simulation. */
     int agent_id;
 
-    /** A bidirectional map of known agent names and addresses. */
+    /** A bidirectional map of known agent names and addresses. Agents hosted by one node share its address. */
     address_book known_agents;
 
+    /** Guards the address book, which messages handled on several IO threads may update. */
+    std::mutex known_agents_mutex_;
+
+    /** The address of the orchestrator that configured the agent, empty if it was configured otherwise. */
+    ipv4_address orchestrator_addr_;
+
 private:
 
     NetworkEntity* network();
 
+    /** Returns the agent ID an agent name stands for, if the name is a number. */
+    static std::optional<int> agentIdFromName(std::string_view agent_name);
+
+    /** Returns the name of the known agent at the given address that sent a message, if it is in the address book.
+     *  The address book mutex must be held. */
+    std::optional<std::string> knownSender(ipv4_view address, int sender_id);
+
     NetworkEntity* network_;
 };
 
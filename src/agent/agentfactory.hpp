@@ -22,6 +22,8 @@
 #include "arbitragetrader.hpp"
 #include "deeptraderlstm.hpp"
 #include "deeptraderxgb.hpp"
+#include "loadgeneratoragent.hpp"
+#include "marketdatarelay.hpp"
 
 class AgentFactory
 {
@@ -139,6 +141,16 @@ public:
                 std::shared_ptr<Agent> agent (new ArbitrageTrader{network_entity, std::static_pointer_cast<ArbitrageurConfig>(config)});
                 return agent;
             }
+            case AgentType::LOAD_GENERATOR:
+            {
+                std::shared_ptr<Agent> agent (new LoadGeneratorAgent{network_entity, std::static_pointer_cast<LoadGeneratorConfig>(config)});
+                return agent;
+            }
+            case AgentType::MARKET_DATA_RELAY:
+            {
+                std::shared_ptr<Agent> agent (new MarketDataRelay{network_entity, std::static_pointer_cast<MarketDataRelayConfig>(config)});
+                return agent;
+            }
             default:
             {
                 throw std::runtime_error("Failed to create agent. Unknown agent received");
@@ -174,7 +186,9 @@ private:
         {std::string{"obvvwap"}, AgentType::TRADER_OBV_VWAP},
         {std::string{"arbitrageur"}, AgentType::ARBITRAGE_TRADER}, 
         {std::string{"deeplstm"}, AgentType::TRADER_DEEP_LSTM}, 
-        {std::string{"deepxgb"}, AgentType::TRADER_DEEP_XGB}
+        {std::string{"deepxgb"}, AgentType::TRADER_DEEP_XGB},
+        {std::string{"loadgen"}, AgentType::LOAD_GENERATOR},
+        {std::string{"relay"}, AgentType::MARKET_DATA_RELAY}
     };
 
 };
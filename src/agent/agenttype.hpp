@@ -18,7 +18,9 @@ enum class AgentType : int
     TRADER_OBV_VWAP, // OBV and VWAP
     ARBITRAGE_TRADER, 
     TRADER_DEEP_LSTM, // DeepTrader LSTM
-    TRADER_DEEP_XGB // DeepTrader XGB
+    TRADER_DEEP_XGB, // DeepTrader XGB
+    LOAD_GENERATOR, // Open-loop order load for throughput and latency tests
+    MARKET_DATA_RELAY // Passes an exchange's market data on to traders
 };
 
 inline std::string to_string(AgentType agent_type)
@@ -40,6 +42,8 @@ inline std::string to_string(AgentType agent_type)
         case AgentType::ARBITRAGE_TRADER: return std::string{"ArbitrageTrader"};
         case AgentType::TRADER_DEEP_LSTM: return std::string{"DeepTraderLSTM"};
         case AgentType::TRADER_DEEP_XGB: return std::string{"DeepTraderXGB"}; 
+        case AgentType::LOAD_GENERATOR: return std::string{"LoadGenerator"};
+        case AgentType::MARKET_DATA_RELAY: return std::string{"MarketDataRelay"};
         default: return std::string{""};
     }
 }
@@ -2,12 +2,22 @@
 #define ARBITRAGE_TRADER_HPP
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <limits>
+#include <map>
 #include <random>
+#include <tuple>
 
 #include "traderagent.hpp"
 #include "../config/arbitrageurconfig.hpp"
+#include "../utilities/seqlock.hpp"
 
+/** Trades the spread between the best bid of one exchange and the best ask of the other when it exceeds alpha.
+ *  Each exchange's top of book is kept in a lock-free snapshot. In polling mode the spread is checked on a jittered timer;
+ *  in reactive mode it is checked on every market data update, so an opportunity is acted on as soon as it is seen.
+ *  A pair of orders is not placed again at the same prices until both of its orders have been acknowledged. */
 class ArbitrageTrader : public TraderAgent
 {
 public:
@@ -18,7 +28,9 @@ public:
       ticker_{config->ticker},
       cancelling_{config->cancelling},
       trade_interval_ms_{config->trade_interval},
-      random_generator_{std::random_device{}()}
+      reactive_{config->reactive},
+      exchange_names_{config->exchange0_name, config->exchange1_name},
+      random_generator_{SimulationClock::randomSeed()}
     {
         /** TODO: Consider changing config to allow arbitrageur to trade on abitrary number of exchanges. */
 
@@ -35,62 +47,55 @@ public:
         addDelayedStart(config->delay);
     }
 
-    /** Gracefully terminates the trader, freeing all memory. */
-    void terminate() override
-    {
-        if (trading_thread_ != nullptr)
-        {
-            trading_thread_->join();
-            delete(trading_thread_);
-        }
-        TraderAgent::terminate();
-    }
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TOP; }
 
     void onTradingStart() override
     {
         std::cout << "Trading window started.\n";
         is_trading_ = true;
-        activelyTrade();
+        if (!reactive_) activelyTrade();
     }
 
     void onTradingEnd() override
     {
-        std::unique_lock<std::mutex> lock(mutex_);
         std::cout << "Trading window ended.\n";
         is_trading_ = false;
-        lock.unlock();
+        if (!reactive_) stopActiveTrading();
     }
 
     void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override
     {
         // Update market data for the given exchange
         updateMarketData(exchange, msg->data);
-        checkForAbitrage();
+        if (reactive_ && is_trading_) checkForAbitrage();
     }
 
     void onExecutionReport(std::string_view exchange, ExecutionReportMessagePtr msg) override
     {
+        std::lock_guard<std::mutex> lock(mutex_);
+        acknowledgeLeg(msg->order->client_order_id);
+
         // Order added to order book
         if (msg->order->status == Order::Status::NEW)
         {
             if (msg->order->side == Order::Side::BID)
             {
-                last_accepted_bid_id_ = msg->order->id;
+                last_accepted_bid_ = RestingOrder{std::string{exchange}, msg->order->id};
             }
             else
             {
-                last_accepted_ask_id_ = msg->order->id;
+                last_accepted_ask_ = RestingOrder{std::string{exchange}, msg->order->id};
             }
         } 
         else if (msg->order->status == Order::Status::FILLED)
         {
             if (msg->order->side == Order::Side::BID)
             {
-                last_accepted_bid_id_ = std::nullopt;
+                last_accepted_bid_ = std::nullopt;
             }
             else
             {
-                last_accepted_ask_id_ = std::nullopt;
+                last_accepted_ask_ = std::nullopt;
             }
         }
     }
@@ -102,122 +107,178 @@ public:
 
 private:
 
-    void activelyTrade()
+    /** Best bid and ask of one exchange, as last reported. */
+    struct TopOfBook
     {
-        trading_thread_ = new std::thread([&, this](){
-
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (is_trading_)
-            {
-                lock.unlock();
+        double bid_price = 0.0;
+        double ask_price = 0.0;
+        int bid_size = 0;
+        int ask_size = 0;
+        bool seen = false;
+    };
+
+    /** An order resting on an exchange, which may be cancelled before the next pair is placed. */
+    struct RestingOrder
+    {
+        std::string exchange;
+        int order_id;
+    };
 
-                checkForAbitrage();
-                sleep();
+    /** Buying exchange, selling exchange, bid price and ask price of a pair of orders. */
+    typedef std::tuple<size_t, size_t, double, double> PairKey;
 
-                lock.lock();
-            }
-            lock.unlock();
+    /** A pair of orders placed and not yet acknowledged by both exchanges. */
+    struct PendingPair
+    {
+        PairKey key;
+        int unacknowledged_legs; // Bit 0 for the bid, bit 1 for the ask
+        SimulationClock::duration placed;
+    };
 
-            std::cout << "Finished actively trading.\n";
+    void activelyTrade()
+    {
+        startActiveTrading(trade_interval_ms_, REL_JITTER, [this]() {
+            checkForAbitrage();
         });
     }
 
-    void sleep()
+    /** Returns the index of the exchange with the given name, or std::nullopt if it is not one the trader trades on. */
+    std::optional<size_t> exchangeIndex(std::string_view exchange) const
     {
-        // Generate a random jitter
-        std::uniform_real_distribution<> dist(-REL_JITTER, REL_JITTER);
-        unsigned long jitter = dist(random_generator_);
-        unsigned long sleep_time_ms = std::round(trade_interval_ms_ * (1.0+jitter));
-
-        // Sleep for specified duration
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
+        for (size_t i = 0; i < exchange_names_.size(); ++i)
+        {
+            if (exchange_names_[i] == exchange) return i;
+        }
+        return std::nullopt;
     }
 
     void updateMarketData(std::string_view exchange, MarketDataPtr data)
     {
-        // Update best known ask (ovewrite best ask if was from this exchange)
-        if (best_ask_exchange_ == std::string{exchange} || data->best_ask < best_ask_price_)
-        {
-            best_ask_price_ = data->best_ask;
-            best_ask_size_ = data->best_ask_size;
-            best_ask_exchange_ = std::string{exchange};
-        }
-
-        // Update best known bid (ovewrite best bid if was from this exchange)
-        if (best_bid_exchange_ == std::string{exchange} || data->best_bid > best_bid_price_)
-        {
-            best_bid_price_ = data->best_bid;
-            best_bid_size_ = data->best_bid_size;
-            best_bid_exchange_ = std::string{exchange};
-        }
+        std::optional<size_t> index = exchangeIndex(exchange);
+        if (!index.has_value()) return;
+        books_[index.value()].store(TopOfBook{data->best_bid, data->best_ask, data->best_bid_size, data->best_ask_size, true});
     }
 
     void checkForAbitrage()
     {
+        // Snapshots of both exchanges, each consistent but updated independently
+        std::array<TopOfBook, 2> books {books_[0].load(), books_[1].load()};
+        if (!books[0].seen || !books[1].seen) return;
+
+        size_t bid_exchange = books[0].bid_price >= books[1].bid_price ? 0 : 1;
+        size_t ask_exchange = books[0].ask_price <= books[1].ask_price ? 0 : 1;
+
         // Check for sufficient arbitrage opportunity
-        if ((best_bid_exchange_ != best_ask_exchange_) && (best_bid_price_ > (1 + alpha_) * best_ask_price_))
+        if ((bid_exchange != ask_exchange) && (books[bid_exchange].bid_price > (1 + alpha_) * books[ask_exchange].ask_price))
         {
-            placeArbitrageOrders();
+            placeArbitrageOrders(books, bid_exchange, ask_exchange);
         }
     }
 
-    void placeArbitrageOrders()
+    void placeArbitrageOrders(const std::array<TopOfBook, 2>& books, size_t bid_exchange, size_t ask_exchange)
     {
-        double size = std::min(best_bid_size_, best_ask_size_);
+        const TopOfBook& best_bid = books[bid_exchange];
+        const TopOfBook& best_ask = books[ask_exchange];
+        int size = std::min(best_bid.bid_size, best_ask.ask_size);
         if (size <= 0) return;
 
+        double midpoint = (best_bid.bid_price + best_ask.ask_price) / 2;
+        double bid_price = std::floor(midpoint);
+        double ask_price = std::ceil(midpoint);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!is_trading_) return;
+
+        // Updates arriving before the exchanges have acknowledged a pair show the same opportunity again
+        std::optional<int> pair_id = reservePair(PairKey{ask_exchange, bid_exchange, bid_price, ask_price});
+        if (!pair_id.has_value()) return;
+
         // Cancel previous orders if not filled
-        if (cancelling_ && last_accepted_bid_id_.has_value())
+        if (cancelling_ && last_accepted_bid_.has_value())
         {
-            cancelOrder(best_bid_exchange_, Order::Side::BID, ticker_, last_accepted_bid_id_.value());
-            last_accepted_bid_id_ = std::nullopt;
+            cancelOrder(last_accepted_bid_->exchange, Order::Side::BID, ticker_, last_accepted_bid_->order_id);
+            last_accepted_bid_ = std::nullopt;
         }
-        if (cancelling_ && last_accepted_ask_id_.has_value())
+        if (cancelling_ && last_accepted_ask_.has_value())
         {   
-            cancelOrder(best_ask_exchange_, Order::Side::ASK, ticker_, last_accepted_ask_id_.value());
-            last_accepted_ask_id_ = std::nullopt;
+            cancelOrder(last_accepted_ask_->exchange, Order::Side::ASK, ticker_, last_accepted_ask_->order_id);
+            last_accepted_ask_ = std::nullopt;
         }
 
-        double midpoint = (best_bid_price_ + best_ask_price_) / 2;
-        double bid_price = std::floor(midpoint);
-        double ask_price = std::ceil(midpoint);
-
         std::cout << "[Opportunity] " 
-        << "BEST BID: " << best_bid_exchange_ << " @ " << best_bid_price_ << " "
-        << "BEST ASK: " << best_ask_exchange_ << " @ " << best_ask_price_ << std::endl;
+        << "BEST BID: " << exchange_names_[bid_exchange] << " @ " << best_bid.bid_price << " "
+        << "BEST ASK: " << exchange_names_[ask_exchange] << " @ " << best_ask.ask_price << std::endl;
         
         std::cout << "[Arbitrage] " 
-        << "BID: " << best_ask_exchange_ << " @ " <<  bid_price 
-        << " ASK: " << best_bid_exchange_ << " @ " << ask_price << std::endl;
+        << "BID: " << exchange_names_[ask_exchange] << " @ " <<  bid_price 
+        << " ASK: " << exchange_names_[bid_exchange] << " @ " << ask_price << std::endl;
 
-        // Note: Arbitrageur places bid order on the exchange with best ask and vice versa
-        placeLimitOrder(best_ask_exchange_, Order::Side::BID, ticker_, size, bid_price, ask_price);
-        placeLimitOrder(best_bid_exchange_, Order::Side::ASK, ticker_, size, ask_price, bid_price);
+        // Note: Arbitrageur places bid order on the exchange with best ask and vice versa.
+        // The legs of pair n carry client order ids 2n and 2n + 1, so their acknowledgements can be matched to it.
+        placeLimitOrder(exchange_names_[ask_exchange], Order::Side::BID, ticker_, size, bid_price, ask_price, Order::TimeInForce::GTC, 2 * pair_id.value());
+        placeLimitOrder(exchange_names_[bid_exchange], Order::Side::ASK, ticker_, size, ask_price, bid_price, Order::TimeInForce::GTC, 2 * pair_id.value() + 1);
     }
 
-    double best_bid_price_ = std::numeric_limits<double>::min();
-    int best_bid_size_ = 0;
-    std::string best_bid_exchange_;
+    /** Records a new pair under the given key and returns its id, or std::nullopt if one is already waiting for acknowledgement.
+     *  Pairs left unacknowledged for longer than PAIR_TIMEOUT are forgotten. Called with the mutex held. */
+    std::optional<int> reservePair(const PairKey& key)
+    {
+        SimulationClock::duration now = SimulationClock::now();
+        for (auto it = pending_pairs_.begin(); it != pending_pairs_.end();)
+        {
+            if (now - it->second.placed > PAIR_TIMEOUT)
+            {
+                it = pending_pairs_.erase(it);
+            }
+            else if (it->second.key == key)
+            {
+                return std::nullopt;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        int pair_id = next_pair_id_++;
+        pending_pairs_.emplace(pair_id, PendingPair{key, BOTH_LEGS, now});
+        return pair_id;
+    }
 
-    double best_ask_price_ = std::numeric_limits<double>::max();
-    int best_ask_size_ = 0;
-    std::string best_ask_exchange_;
+    /** Counts the first report of an order towards acknowledging its pair. Called with the mutex held. */
+    void acknowledgeLeg(int client_order_id)
+    {
+        auto it = pending_pairs_.find(client_order_id / 2);
+        if (it == pending_pairs_.end()) return;
+        int leg = 1 << (client_order_id % 2);
+        if (!(it->second.unacknowledged_legs & leg)) return;
+        it->second.unacknowledged_legs &= ~leg;
+        if (it->second.unacknowledged_legs == 0) pending_pairs_.erase(it);
+    }
 
     double alpha_;
     std::string ticker_;
     bool cancelling_;
     unsigned int trade_interval_ms_;
+    bool reactive_;
 
-    std::optional<int> last_accepted_bid_id_ = std::nullopt;
-    std::optional<int> last_accepted_ask_id_ = std::nullopt;
+    // Top of book of each exchange, written by market data handlers and read without locking
+    std::array<std::string, 2> exchange_names_;
+    std::array<SeqLock<TopOfBook>, 2> books_;
 
     std::mt19937 random_generator_;
 
+    // Guards the orders below, placed from market data or the timer and acknowledged by execution reports
     std::mutex mutex_;
-    std::thread* trading_thread_ = nullptr;
-    bool is_trading_ = false;
+    std::optional<RestingOrder> last_accepted_bid_ = std::nullopt;
+    std::optional<RestingOrder> last_accepted_ask_ = std::nullopt;
+    std::map<int, PendingPair> pending_pairs_; // By pair id
+    int next_pair_id_ = 1;
+
+    std::atomic<bool> is_trading_ = false;
 
     constexpr static double REL_JITTER = 0.25;
+    constexpr static std::chrono::seconds PAIR_TIMEOUT {5};
+    constexpr static int BOTH_LEGS = 0b11; // Bit i set while leg i of a pair is unacknowledged
 };
 
 #endif
\ No newline at end of file
@@ -5,12 +5,15 @@
 #include "traderagent.hpp"
 #include "../message/profitmessage.hpp"
 #include "../message/customer_order_message.hpp"
+#include "../utilities/logger.hpp"
+#include "../utilities/recordsink.hpp"
+#include "../trade/predictionrecord.hpp"
 #include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <nlohmann/json.hpp>
-#include "onnxruntime/onnxruntime_cxx_api.h"
+#include "../inference/inferenceservice.hpp"
 
 using json = nlohmann::json;
 
@@ -22,7 +25,8 @@ public:
     exchange_{config->exchange_name},
     ticker_{config->ticker},
     trader_side_{config->side},
-    limit_price_{config->limit}
+    limit_price_{config->limit},
+    prediction_log_interval_{config->prediction_log_interval}
     {
         // Create a log file
         std::ofstream init_log("./logs/deeptrader_init.log", std::ios::app);
@@ -30,7 +34,7 @@ public:
         init_log << "Timestamp: " << std::time(nullptr) << std::endl;
         
         // Initialise ONNX Runtime and load the model
-        initialiseModel();
+        initialiseModel(config);
         
         // Test model connection
         model_initialised_ = testModelInitialisation();
@@ -55,14 +59,14 @@ public:
     
     void onTradingStart() override
     {
-        std::cout << "Trading window started for DeepTrader.\n";
+        LOG_INFO("Trading window started for DeepTrader.");
         is_trading_ = true; 
     }
 
     void onTradingEnd() override
     {
         is_trading_ = false;
-        std::cout << "Trading window ended for DeepTrader.\n";
+        LOG_INFO("Trading window ended for DeepTrader.");
     }
 
     void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override
@@ -85,56 +89,18 @@ public:
             Order::Side side = cust_order->side;
             limit_price_ = cust_order->price;
             
-            // Get predicted price using LSTM
-            double model_price = predictPrice(msg, side);
-            
-            // Apply price adjustments
-            if (side == Order::Side::ASK) {
-                if (model_price < limit_price_) {
-                    model_price = limit_price_ + 1;
-                    if (msg->data->best_ask > 0 && limit_price_ < msg->data->best_ask - 1) {
-                        model_price = msg->data->best_ask - 1;
-                    }
-                }
-            } else { // BID
-                if (model_price > limit_price_) {
-                    model_price = limit_price_ - 1;
-                    if (msg->data->best_bid > 0 && limit_price_ > msg->data->best_bid + 1) {
-                        model_price = msg->data->best_bid + 1;
-                    }
-                }
-            }
-            
-            // Place the order
-            placeLimitOrder(exchange_, side, ticker_, cust_order->quantity, model_price, limit_price_);
-            std::cout << "DeepTrader (customer): " << (side == Order::Side::BID ? "BID" : "ASK") 
-                      << " " << cust_order->quantity << " @ " << model_price << " (limit: " << limit_price_ << ")\n";
+            // Get predicted price using LSTM, placing the order once the shared model answers
+            double limit_price = limit_price_;
+            predictPrice(msg, side, limit_price, [=, this](double model_price) {
+                placeModelOrder(msg, side, cust_order->quantity, model_price, limit_price, "customer");
+            });
         } 
         else {
             // No customer orders, use default settings similar to TraderShaver
-            double model_price = predictPrice(msg, trader_side_);
-            
-            // Apply price adjustments
-            if (trader_side_ == Order::Side::ASK) {
-                if (model_price < limit_price_) {
-                    model_price = limit_price_ + 1;
-                    if (msg->data->best_ask > 0 && limit_price_ < msg->data->best_ask - 1) {
-                        model_price = msg->data->best_ask - 1;
-                    }
-                }
-            } 
-            else { // BID
-                if (model_price > limit_price_) {
-                    model_price = limit_price_ - 1;
-                    if (msg->data->best_bid > 0 && limit_price_ > msg->data->best_bid + 1) {
-                        model_price = msg->data->best_bid + 1;
-                    }
-                }
-            }
-            
-            // Place the order
-            placeLimitOrder(exchange_, trader_side_, ticker_, quantity, model_price, limit_price_);
-            std::cout << "DeepTrader (default): " << (trader_side_ == Order::Side::BID ? "BID" : "ASK") << " " << quantity << " @ " << model_price << " (limit: " << limit_price_ << ")\n";
+            double limit_price = limit_price_;
+            predictPrice(msg, trader_side_, limit_price, [=, this](double model_price) {
+                placeModelOrder(msg, trader_side_, quantity, model_price, limit_price, "default");
+            });
         }
     }
 
@@ -148,13 +114,13 @@ public:
             bookkeepTrade(msg->trade, limit_order);
         }
 
-        std::cout << "DeepTrader received execution report from " << exchange << ": Order: " << msg->order->id << " Status: " << msg->order->status << " Qty remaining = " << msg->order->remaining_quantity << "\n";
+        LOG_DEBUG("DeepTrader received execution report from " << exchange << ": Order: " << msg->order->id << " Status: " << msg->order->status << " Qty remaining = " << msg->order->remaining_quantity);
     }
 
     void onCancelReject(std::string_view exchange, CancelRejectMessagePtr msg) override
     {
-        std::cout << "DeepTrader received cancel reject from " << exchange 
-                  << " for order ID " << msg->order_id << "\n";
+        LOG_INFO("DeepTrader received cancel reject from " << exchange 
+                  << " for order ID " << msg->order_id);
     }
 
     void handleBroadcastFrom(std::string_view sender, MessagePtr message) override
@@ -167,7 +133,7 @@ public:
                 std::lock_guard<std::mutex> lock(mutex_);
                 // Use a stack like TraderShaver
                 customer_orders_.push(cust_msg);
-                std::cout << "[DEEPLSTM] Received CUSTOMER_ORDER: side=" << (cust_msg->side == Order::Side::BID ? "BID" : "ASK") << " limit=" << cust_msg->price << "\n";
+                LOG_INFO("[DEEPLSTM] Received CUSTOMER_ORDER: side=" << (cust_msg->side == Order::Side::BID ? "BID" : "ASK") << " limit=" << cust_msg->price);
             }
             return;
         }
@@ -185,51 +151,48 @@ private:
         std::string otype;
     };
     
-    // ONNX Runtime environment and session for smart pointer to NN inference session
-    Ort::Env ort_env{ORT_LOGGING_LEVEL_WARNING, "TraderDeepLSTM"};
-    Ort::SessionOptions session_options;
-    std::unique_ptr<Ort::Session> ort_session;
-    
     // Storage for model normalisation parameters
     std::vector<float> min_values;
     std::vector<float> max_values;
     
-    void initialiseModel() {
+    void initialiseModel(TraderConfigPtr config) {
         try {
             // Path to the ONNX model
             std::string model_path = "../src/deeptrader/dt_lstm/lstm_models/DeepTrader_LSTM.onnx";
             
             // Check if ONNX model file exists
             if (!std::filesystem::exists(model_path)) {
-                std::cerr << "ONNX model file not found at: " << model_path << std::endl;
-                std::cerr << "Trying alternative path..." << std::endl;
+                LOG_ERROR("ONNX model file not found at: " << model_path);
+                LOG_WARN("Trying alternative path...");
                 
                 model_path = "models/DeepTrader_LSTM/DeepTrader_LSTM.onnx";
                 if (!std::filesystem::exists(model_path)) {
-                    std::cerr << "ONNX model file not found at alternative path either." << std::endl;
+                    LOG_ERROR("ONNX model file not found at alternative path either.");
                     return;
                 }
             }
             
-            std::cout << "Loading ONNX model from: " << model_path << std::endl;
-            
-            // Set graph optimization level
-            session_options.SetGraphOptimizationLevel(ORT_ENABLE_BASIC);
+            LOG_INFO("Loading ONNX model from: " << model_path);
             
-            // Create session
-            ort_session = std::make_unique<Ort::Session>(ort_env, model_path.c_str(), session_options);
+            // The model is loaded once per process and shared by the agents using it
+            InferenceService::SessionSettings settings;
+            settings.graph_optimisation = config->graph_optimisation;
+            settings.intra_op_threads = config->inference_threads;
+            settings.device = config->inference_device;
+            settings.device_id = config->inference_device_id;
+            inference_ = InferenceService::Client{InferenceService::forModel(model_path, ROW_SHAPE, settings)};
             
             // Path to normalisation values in shared location (no alternatives)
             std::string norm_path = "../src/deeptrader/normalised_data/min_max_values.json";
             loadNormalisationValues(norm_path);
             
-            std::cout << "ONNX model loaded successfully" << std::endl;
+            LOG_INFO("ONNX model loaded successfully");
         }
         catch (const Ort::Exception& e) {
-            std::cerr << "ONNX Runtime error: " << e.what() << std::endl;
+            LOG_ERROR("ONNX Runtime error: " << e.what());
         }
         catch (const std::exception& e) {
-            std::cerr << "Error initialising model: " << e.what() << std::endl;
+            LOG_ERROR("Error initialising model: " << e.what());
         }
     }
     
@@ -237,8 +200,8 @@ private:
         try {
             // If the sation file doesn't exist, use default values
             if (!std::filesystem::exists(file_path)) {
-                std::cerr << "Normalisation file not found: " << file_path << std::endl;
-                std::cerr << "Using default normalisation values" << std::endl;
+                LOG_ERROR("Normalisation file not found: " << file_path);
+                LOG_WARN("Using default normalisation values");
                 
                 // Create default values (14 features including the output - min = 0, max = 1; default)
                 min_values.resize(14, 0.0f);
@@ -246,20 +209,16 @@ private:
                 return;
             }
             
-            // Read the JSON file min/max values
-            std::ifstream norm_file(file_path);
-            json norm_data;
-            norm_file >> norm_data;
+            // Compiled from the JSON file into the model cache on first use, and shared by the agents of the process
+            std::shared_ptr<const NormalisationValues> values = ModelCache::normalisationValues(file_path);
+            min_values = values->min_values;
+            max_values = values->max_values;
             
-            // Extract the min and max values
-            min_values = norm_data["min_values"].get<std::vector<float>>();
-            max_values = norm_data["max_values"].get<std::vector<float>>();
-            
-            std::cout << "Loaded normalisation values: min size=" << min_values.size() 
-                      << ", max size=" << max_values.size() << std::endl;
+            LOG_INFO("Loaded normalisation values: min size=" << min_values.size() 
+                      << ", max size=" << max_values.size());
         }
         catch (const std::exception& e) {
-            std::cerr << "Error loading normalisation values: " << e.what() << std::endl;
+            LOG_ERROR("Error loading normalisation values: " << e.what());
             // Set default values
             min_values.resize(14, 0.0f);
             max_values.resize(14, 1.0f);
@@ -268,197 +227,140 @@ private:
     
     bool testModelInitialisation() {
         // Simple test to check if model is initialised
-        return ort_session != nullptr && min_values.size() > 0 && max_values.size() > 0;
+        return inference_.ready() && min_values.size() > 0 && max_values.size() > 0;
     }
     
-    double predictPrice(MarketDataMessagePtr msg, Order::Side side) {
+    /** Predicts the price to quote and passes it to on_price, once the shared model has answered,
+     *  or straight away with the best bid or ask if the model is not available. */
+    void predictPrice(MarketDataMessagePtr msg, Order::Side side, double limit_price, std::function<void(double)> on_price) {
         std::string otype = (side == Order::Side::BID) ? "Bid" : "Ask";
         double best_bid = msg->data->best_bid;
         double best_ask = msg->data->best_ask;
-        
-        // Create log file for predictions DEBUG
-        std::ofstream prediction_log("./logs/deeptrader_predictions.log", std::ios::app);
-        prediction_log << "\n--- New Prediction Request ---" << std::endl;
-        prediction_log << "Timestamp: " << std::time(nullptr) << std::endl;
-        prediction_log << "Order Type: " << otype << std::endl;
-        prediction_log << "Market Data - Best Bid: " << best_bid << ", Best Ask: " << best_ask << std::endl;
+        double fallback_price = otype == "Ask" ? best_ask : best_bid;
+
+        // Create input feature array (13 features like in the Python version)
+        std::array<float, PredictionRecord::FEATURE_COUNT> features = {
+            static_cast<float>(msg->data->timestamp),
+            static_cast<float>(msg->data->time_diff),
+            side == Order::Side::BID ? 1.0f : 0.0f,
+            static_cast<float>(msg->data->best_bid),
+            static_cast<float>(msg->data->best_ask),
+            static_cast<float>(msg->data->micro_price),
+            static_cast<float>(msg->data->mid_price),
+            static_cast<float>(msg->data->imbalance),
+            static_cast<float>(msg->data->spread),
+            static_cast<float>(msg->data->total_volume),
+            static_cast<float>(msg->data->p_equilibrium),
+            static_cast<float>(msg->data->smiths_alpha),
+            static_cast<float>(limit_price)
+        };
+
+        // Only sampled predictions are recorded, and the record is formatted by the sink's thread
+        bool sampled = prediction_log_interval_ > 0 && predictions_++ % prediction_log_interval_ == 0;
+        PredictionRecord record;
+        if (sampled) {
+            record.timestamp = SimulationClock::nowNanos();
+            record.agent_id = agent_id;
+            record.side = (side == Order::Side::BID) ? 1 : 0;
+            std::copy_n(features.begin(), PredictionRecord::FEATURE_COUNT, record.features.begin());
+        }
     
         // If model isn't available, use fallback
-        if (!model_initialised_ || !ort_session) {
-            prediction_log << "Model not initialised, using fallback price" << std::endl;
-            double fallback_price = otype == "Ask" ? best_ask : best_bid;
-            prediction_log << "Fallback Price: " << fallback_price << std::endl;
-            prediction_log.close();
-            return fallback_price;
+        if (!model_initialised_ || !inference_.ready()) {
+            recordPrediction(record, sampled, fallback_price, PredictionOutcome::UNAVAILABLE);
+            on_price(fallback_price);
+            return;
         }
         
-        try {
-            // Create input feature array (13 features like in the Python version)
-            std::vector<float> features = {
-                static_cast<float>(msg->data->timestamp),
-                static_cast<float>(msg->data->time_diff),
-                side == Order::Side::BID ? 1.0f : 0.0f,
-                static_cast<float>(msg->data->best_bid),
-                static_cast<float>(msg->data->best_ask),
-                static_cast<float>(msg->data->micro_price),
-                static_cast<float>(msg->data->mid_price),
-                static_cast<float>(msg->data->imbalance),
-                static_cast<float>(msg->data->spread),
-                static_cast<float>(msg->data->total_volume),
-                static_cast<float>(msg->data->p_equilibrium),
-                static_cast<float>(msg->data->smiths_alpha),
-                static_cast<float>(limit_price_)
-            };
-            
-            // Log raw features DEBUG
-            prediction_log << "\nRaw Features:" << std::endl;
-            prediction_log << "timestamp: " << features[0] << std::endl;
-            prediction_log << "time_diff: " << features[1] << std::endl;
-            prediction_log << "is_bid: " << features[2] << std::endl;
-            prediction_log << "best_bid: " << features[3] << std::endl;
-            prediction_log << "best_ask: " << features[4] << std::endl;
-            prediction_log << "micro_price: " << features[5] << std::endl;
-            prediction_log << "mid_price: " << features[6] << std::endl;
-            prediction_log << "imbalance: " << features[7] << std::endl;
-            prediction_log << "spread: " << features[8] << std::endl;
-            prediction_log << "total_volume: " << features[9] << std::endl;
-            prediction_log << "p_equilibrium: " << features[10] << std::endl;
-            prediction_log << "smiths_alpha: " << features[11] << std::endl;
-            prediction_log << "limit_price: " << features[12] << std::endl;
-            
-            // Store original features for logging
-            std::vector<float> original_features = features;
-            
-            // Normalise features
-            for (size_t i = 0; i < features.size(); i++) {
-                if (i < min_values.size() && i < max_values.size()) {
-                    features[i] = (features[i] - min_values[i]) / (max_values[i] - min_values[i]);
-                }
+        // Normalise features
+        for (size_t i = 0; i < features.size(); i++) {
+            if (i < min_values.size() && i < max_values.size()) {
+                features[i] = (features[i] - min_values[i]) / (max_values[i] - min_values[i]);
             }
-            
-            // Log normalised features
-            prediction_log << "\nNormalised Features:" << std::endl;
-            for (size_t i = 0; i < features.size(); i++) {
-                prediction_log << "Feature " << i << ": " << features[i] << " (original: " << original_features[i] 
-                               << ", min: " << min_values[i] << ", max: " << max_values[i] << ")" << std::endl;
-            }
-            
-            // Prepare input tensor
-            std::vector<int64_t> input_shape = {1, 1, 13}; // [batch_size, sequence_length, features]
-            
-            // Define I/O names for the model for memory allocation utilities so NN uses CPU memory with default allocation settings
-            // INPUT = market data features fed into NN. OUTPUT = price prediction NN returns
-            Ort::AllocatorWithDefaultOptions allocator;
-            Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-
-            /** Expected INPUT and OUTPUT names in log - DEBUG; 
-             * Input Tensor name = "input" index 0. Name of input tensor #0 is input
-             * Output Tensor name = "dense_2". Name of output tensor #0 is dense_2; last layer of keras model
-             */
-
+        }
 
-            // Get input names to identify input tensors in ONNX model; symbolic labels to match input data with correct nodes in NN computational graph 
-            // Computational Graph = underlying structure of NN to define how data flows through nodes
-            size_t num_input_nodes = ort_session->GetInputCount();
-            std::vector<std::string> input_names_str;
-            std::vector<const char*> input_names;
-            for (size_t i = 0; i < num_input_nodes; i++) {
-                Ort::AllocatedStringPtr input_name = ort_session->GetInputNameAllocated(i, allocator);
-                input_names_str.push_back(input_name.get());
-                input_names.push_back(input_names_str.back().c_str());
-                prediction_log << "Input " << i << " name: " << input_names[i] << std::endl; 
+        // The row is batched with the predictions of other agents sharing the model
+        inference_.predict(features.data(), features.size(), [=, this](std::optional<float> output) mutable {
+            if (!output.has_value()) {
+                // Fallback to simple price
+                recordPrediction(record, sampled, fallback_price, PredictionOutcome::ERROR);
+                on_price(fallback_price);
+                return;
             }
+            float normalised_output = output.value();
 
-            // Get output names; Identifies output tensors in ONNX model; symbolic labels to access prediction results from NN after inference is complete
-            size_t num_output_nodes = ort_session->GetOutputCount();
-            std::vector<std::string> output_names_str;
-            std::vector<const char*> output_names;
-            for (size_t i = 0; i < num_output_nodes; i++) {
-                Ort::AllocatedStringPtr output_name = ort_session->GetOutputNameAllocated(i, allocator);
-                output_names_str.push_back(output_name.get());
-                output_names.push_back(output_names_str.back().c_str());
-                prediction_log << "Output " << i << " name: " << output_names[i] << std::endl;
-            }
-            
-            prediction_log << "\nRunning ONNX model inference..." << std::endl;
-            
-            // Create input tensor
-            auto input_tensor = Ort::Value::CreateTensor<float>(
-                memory_info, features.data(), features.size(), 
-                input_shape.data(), input_shape.size()
-            );
-            
-            // Run inference (prediction)
-            auto output_tensors = ort_session->Run(
-                Ort::RunOptions{nullptr}, 
-                input_names.data(), 
-                &input_tensor, 
-                1, 
-                output_names.data(), 
-                1
-            );
-            
-            // Get output tensor and value
-            float* output_data = output_tensors[0].GetTensorMutableData<float>();
-            float normalised_output = output_data[0];
-            
-            prediction_log << "Model output (normalised): " << normalised_output << std::endl;
-            
             // Denormalise output
             float denormalised_output = 0.0f;
             if (min_values.size() > 13 && max_values.size() > 13) {
                 denormalised_output = (normalised_output * (max_values[13] - min_values[13])) + min_values[13];
-                prediction_log << "Denormalised output: " << denormalised_output 
-                               << " (using min: " << min_values[13] << ", max: " << max_values[13] << ")" << std::endl;
             } else {
                 // Fallback if normalisation values are not available
                 denormalised_output = normalised_output * 200.0f; // Assuming output is in range [0,1] and price in [0,200]
-                prediction_log << "Denormalised output: " << denormalised_output 
-                               << " (using fallback scaling factor: 200.0)" << std::endl;
             }
+            record.normalised_output = normalised_output;
+            record.denormalised_output = denormalised_output;
             
             // Round to nearest integer
             int model_price = static_cast<int>(std::round(denormalised_output));
-            prediction_log << "Rounded model price: " << model_price << std::endl;
+            PredictionOutcome outcome = PredictionOutcome::MODEL;
             
             // Apply sanity checks as in the Python code
             if (model_price < 50 || model_price > 200) {
-                prediction_log << "Warning: Unreasonable prediction: " << model_price << ", using fallback" << std::endl;
+                outcome = PredictionOutcome::UNREASONABLE;
                 if (otype == "Ask") {
                     model_price = best_ask - 1;
-                    prediction_log << "Fallback to best_ask - 1: " << model_price << std::endl;
                 } else {
                     model_price = best_bid + 1;
-                    prediction_log << "Fallback to best_bid + 1: " << model_price << std::endl;
                 }
             }
             
-            prediction_log << "Final model prediction: " << model_price << " for " << otype << std::endl;
-            prediction_log.close();
+            recordPrediction(record, sampled, model_price, outcome);
             
-            std::cout << "ONNX model prediction: " << model_price << " for " << otype << std::endl;
-            return model_price;
-        }
-        catch (const Ort::Exception& e) {
-            prediction_log << "ONNX Runtime error in predictPrice: " << e.what() << std::endl;
-            // Fallback to simple price
-            double fallback_price = otype == "Ask" ? best_ask : best_bid;
-            prediction_log << "Using fallback price: " << fallback_price << std::endl;
-            prediction_log.close();
-            
-            std::cerr << "ONNX Runtime error in predictPrice: " << e.what() << std::endl;
-            return fallback_price;
+            LOG_DEBUG("ONNX model prediction: " << model_price << " for " << otype);
+            on_price(model_price);
+        });
+    }
+
+    void recordPrediction(PredictionRecord& record, bool sampled, double price, PredictionOutcome outcome) {
+        if (!sampled) return;
+        record.price = price;
+        record.outcome = outcome;
+        predictionLog().write(record);
+    }
+
+    /** Keeps the predicted price on the right side of the limit price and places the order, unless trading has ended meanwhile. */
+    void placeModelOrder(MarketDataMessagePtr msg, Order::Side side, int quantity, double model_price, double limit_price, std::string_view source) {
+        if (!is_trading_) {
+            return;
         }
-        catch (const std::exception& e) {
-            prediction_log << "Error in predictPrice: " << e.what() << std::endl;
-            // Fallback
-            double fallback_price = otype == "Ask" ? best_ask : best_bid;
-            prediction_log << "Using fallback price: " << fallback_price << std::endl;
-            prediction_log.close();
-            
-            std::cerr << "Error in predictPrice: " << e.what() << std::endl;
-            return fallback_price;
+
+        // Apply price adjustments
+        if (side == Order::Side::ASK) {
+            if (model_price < limit_price) {
+                model_price = limit_price + 1;
+                if (msg->data->best_ask > 0 && limit_price < msg->data->best_ask - 1) {
+                    model_price = msg->data->best_ask - 1;
+                }
+            }
+        } else { // BID
+            if (model_price > limit_price) {
+                model_price = limit_price - 1;
+                if (msg->data->best_bid > 0 && limit_price > msg->data->best_bid + 1) {
+                    model_price = msg->data->best_bid + 1;
+                }
+            }
         }
+        
+        // Place the order
+        placeLimitOrder(exchange_, side, ticker_, quantity, model_price, limit_price);
+        LOG_INFO("DeepTrader (" << source << "): " << (side == Order::Side::BID ? "BID" : "ASK") 
+                  << " " << quantity << " @ " << model_price << " (limit: " << limit_price << ")");
+    }
+
+    /** Returns the sink shared by the agents of the process for sampled prediction telemetry, opening it on first use. */
+    static RecordSink<PredictionRecord>& predictionLog() {
+        static RecordSink<PredictionRecord> sink{"./logs/deeptrader_predictions.csv"};
+        return sink;
     }
     
     std::string exchange_;
@@ -466,8 +368,12 @@ private:
     Order::Side trader_side_;
     double limit_price_;
     
-    bool is_trading_ = false;
+    std::atomic<bool> is_trading_ = false;
     bool model_initialised_ = false;
+
+    // Prediction telemetry: every nth prediction is recorded, none if zero
+    unsigned int prediction_log_interval_;
+    unsigned long predictions_ = 0;
     
     // Order management
     std::mutex mutex_;
@@ -476,7 +382,13 @@ private:
     int next_order_id_ = 1;
 
     std::stack<CustomerOrderMessagePtr> customer_orders_;
-    std::mt19937 random_generator_{std::random_device{}()};
+    std::mt19937 random_generator_{SimulationClock::randomSeed()};
+
+    // Shape of a row of features fed to the model, without the batch dimension
+    static inline const std::vector<int64_t> ROW_SHAPE = {1, 13};
+
+    // Declared last so that pending predictions stop calling back before the rest of the agent is destroyed
+    InferenceService::Client inference_;
 };
 
 #endif
\ No newline at end of file
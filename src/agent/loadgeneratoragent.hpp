@@ -0,0 +1,309 @@
+#ifndef LOAD_GENERATOR_AGENT_HPP
+#define LOAD_GENERATOR_AGENT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <utility>
+
+#include "traderagent.hpp"
+#include "../config/loadgeneratorconfig.hpp"
+#include "../utilities/latencyhistogram.hpp"
+#include "../utilities/logger.hpp"
+
+/** Sends limit orders to an exchange open loop, at a set rate whatever the exchange's replies, and times them:
+ *  from sending an order to its first execution report, and to the first market data update published after it was processed.
+ *  Orders are priced either side of a mid price so that some rest and some trade; the oldest resting ones are cancelled
+ *  to keep the book's size steady. Runs at its configured rate through the trading session, or at rates set by a load test. */
+class LoadGeneratorAgent : public TraderAgent
+{
+public:
+
+    /** What the generator measured since its statistics were last taken. */
+    struct LoadStats
+    {
+        unsigned long sent = 0;
+        unsigned long acked = 0;
+        unsigned long rejected = 0; // over the exchange's rate limit
+        unsigned long cancels_rejected = 0;
+        double elapsed = 0; // seconds spent sending
+        LatencyHistogram ack_latency;
+        LatencyHistogram market_data_latency;
+    };
+
+    LoadGeneratorAgent(NetworkEntity *network_entity, LoadGeneratorConfigPtr config)
+    : TraderAgent(network_entity, config),
+      config_{config},
+      stats_{std::make_unique<LoadStats>()},
+      strand_{asio::make_strand(ioContext())},
+      timer_{strand_},
+      random_generator_{config->seed != 0 ? config->seed : SimulationClock::randomSeed()}
+    {
+        is_legacy_trader_ = true;
+
+        connect(config->exchange_addr, config->exchange_name, [=, this](){
+            subscribeToMarket(config->exchange_name, config->ticker);
+        });
+    }
+
+    std::string getAgentName() const override { return "loadgen"; }
+
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TOP; }
+
+    void terminate() override
+    {
+        stopLoad();
+        TraderAgent::terminate();
+    }
+
+    /** Indicates whether the exchange's trading session has started, so that orders are accepted. */
+    bool tradingOpen() const
+    {
+        return trading_open_.load(std::memory_order_acquire);
+    }
+
+    /** Starts sending orders at the given rate per second, replacing the rate already sent at. */
+    void startLoad(double rate)
+    {
+        std::lock_guard<std::mutex> lock(load_mutex_);
+        if (sending_) stats_->elapsed += secondsSince(send_start_);
+        unsigned long generation = ++generation_;
+        rate_ = rate;
+        sending_ = rate > 0;
+        if (!sending_) return;
+
+        send_start_ = SimulationClock::now();
+        next_send_ = send_start_;
+        asio::post(strand_, SimulationClock::holding([this, generation]() { dispatchDue(generation); }));
+    }
+
+    /** Stops sending orders. Replies to orders already sent are still timed. */
+    void stopLoad()
+    {
+        std::lock_guard<std::mutex> lock(load_mutex_);
+        if (!sending_) return;
+        stats_->elapsed += secondsSince(send_start_);
+        sending_ = false;
+        ++generation_;
+    }
+
+    /** Returns the statistics measured so far and starts afresh, forgetting orders still awaiting a reply. */
+    std::unique_ptr<LoadStats> takeStats()
+    {
+        std::lock_guard<std::mutex> lock(load_mutex_);
+        if (sending_)
+        {
+            stats_->elapsed += secondsSince(send_start_);
+            send_start_ = SimulationClock::now();
+        }
+        std::unique_ptr<LoadStats> stats = std::move(stats_);
+        stats_ = std::make_unique<LoadStats>();
+        pending_acks_.clear();
+        awaiting_market_data_.clear();
+        return stats;
+    }
+
+protected:
+
+    void onTradingStart() override
+    {
+        trading_open_.store(true, std::memory_order_release);
+        if (config_->rate > 0)
+        {
+            std::cout << "[LoadGenerator] Sending " << config_->rate << " orders per second.\n";
+            startLoad(config_->rate);
+        }
+    }
+
+    void onTradingEnd() override
+    {
+        trading_open_.store(false, std::memory_order_release);
+        stopLoad();
+
+        std::unique_ptr<LoadStats> stats = takeStats();
+        std::cout << "[LoadGenerator] Sent " << stats->sent << " orders in " << stats->elapsed << "s, "
+                  << stats->acked << " acknowledged, " << stats->rejected << " rejected.\n"
+                  << "[LoadGenerator] Order to ack: " << stats->ack_latency.summary() << "\n"
+                  << "[LoadGenerator] Order to market data: " << stats->market_data_latency.summary() << "\n";
+    }
+
+    void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override {}
+
+    void onExecutionReport(std::string_view exchange, ExecutionReportMessagePtr msg) override
+    {
+        unsigned long long now = SimulationClock::monotonicNanos();
+        std::optional<std::pair<int, Order::Side>> cancel;
+
+        std::unique_lock<std::mutex> lock(load_mutex_);
+        auto pending = pending_acks_.find(msg->order->client_order_id);
+        if (pending != pending_acks_.end() && msg->order->status == Order::Status::REJECTED)
+        {
+            pending_acks_.erase(pending);
+            ++stats_->rejected;
+        }
+        else if (pending != pending_acks_.end())
+        {
+            unsigned long long sent = pending->second;
+            pending_acks_.erase(pending);
+            ++stats_->acked;
+            stats_->ack_latency.record(now - sent);
+
+            // Updates are published after the order is processed, so any sent by the exchange since its ack reflect it
+            auto update = std::find_if(recent_market_data_.begin(), recent_market_data_.end(),
+                [&msg](const auto& update) { return update.first >= msg->timestamp_sent; });
+            if (update != recent_market_data_.end())
+            {
+                stats_->market_data_latency.record(update->second > sent ? update->second - sent : 0);
+            }
+            else
+            {
+                awaiting_market_data_.push_back({msg->timestamp_sent, sent});
+            }
+        }
+
+        if (msg->order->status == Order::Status::NEW && msg->trade == nullptr)
+        {
+            resting_.push_back({msg->order->id, msg->order->side});
+            if (static_cast<int>(resting_.size()) > config_->max_resting)
+            {
+                cancel = resting_.front();
+                resting_.pop_front();
+            }
+        }
+        lock.unlock();
+
+        if (cancel.has_value())
+        {
+            cancelOrder(exchange_, cancel->second, config_->ticker, cancel->first);
+        }
+    }
+
+    void onCancelReject(std::string_view exchange, CancelRejectMessagePtr msg) override
+    {
+        // The order traded in full before the cancel reached it
+        std::lock_guard<std::mutex> lock(load_mutex_);
+        ++stats_->cancels_rejected;
+    }
+
+    void handleBroadcastFrom(std::string_view sender, MessagePtr message) override
+    {
+        if (message->type == MessageType::MARKET_DATA || message->type == MessageType::MARKET_DATA_DELTA)
+        {
+            noteMarketData(message->timestamp_sent);
+        }
+        TraderAgent::handleBroadcastFrom(sender, message);
+    }
+
+private:
+
+    /** Market data updates remembered for acks that arrive after them, as the feed may overtake the acks. */
+    static constexpr size_t RECENT_MARKET_DATA = 64;
+
+    /** Sends every order that is due, then waits until the next one is.
+     *  Does nothing if sending was stopped or restarted since the given generation was started. */
+    void dispatchDue(unsigned long generation)
+    {
+        std::unique_lock<std::mutex> lock(load_mutex_);
+        if (generation != generation_) return;
+
+        // Open loop: orders that fell due while the generator was busy are sent at once rather than dropped
+        SimulationClock::duration now = SimulationClock::now();
+        while (next_send_ <= now)
+        {
+            next_send_ += nextGap();
+            sendOrder(lock);
+            if (generation != generation_) return;
+        }
+
+        timer_.expires_after(next_send_ - now);
+        timer_.async_wait([this, generation](const boost::system::error_code& error) {
+            if (!error) dispatchDue(generation);
+        });
+    }
+
+    /** Sends a limit order on a random side at a random price within the range either side of the mid price.
+     *  The load mutex is released while the order is sent. */
+    void sendOrder(std::unique_lock<std::mutex>& lock)
+    {
+        Order::Side side = std::bernoulli_distribution{0.5}(random_generator_) ? Order::Side::BID : Order::Side::ASK;
+        double price = config_->mid_price + std::uniform_int_distribution<int>{-config_->price_range, config_->price_range}(random_generator_);
+        int quantity = std::uniform_int_distribution<int>{1, 10}(random_generator_);
+        int client_order_id = ++next_client_order_id_;
+        pending_acks_[client_order_id] = SimulationClock::monotonicNanos();
+        ++stats_->sent;
+        lock.unlock();
+
+        placeLimitOrder(exchange_, side, config_->ticker, quantity, price, price, Order::TimeInForce::GTC, client_order_id);
+        lock.lock();
+    }
+
+    /** Times the orders acked before the exchange sent the update at the given time, which reflects them. */
+    void noteMarketData(unsigned long long timestamp_sent)
+    {
+        unsigned long long now = SimulationClock::monotonicNanos();
+        std::lock_guard<std::mutex> lock(load_mutex_);
+        while (!awaiting_market_data_.empty() && awaiting_market_data_.front().first <= timestamp_sent)
+        {
+            unsigned long long sent = awaiting_market_data_.front().second;
+            stats_->market_data_latency.record(now > sent ? now - sent : 0);
+            awaiting_market_data_.pop_front();
+        }
+
+        recent_market_data_.push_back({timestamp_sent, now});
+        if (recent_market_data_.size() > RECENT_MARKET_DATA)
+        {
+            recent_market_data_.pop_front();
+        }
+    }
+
+    /** Returns the time until the order after the last one sent. */
+    SimulationClock::duration nextGap()
+    {
+        double gap = (config_->arrival == ArrivalProcess::POISSON)
+            ? std::exponential_distribution<double>{rate_}(random_generator_)
+            : 1.0 / rate_;
+        return std::chrono::duration_cast<SimulationClock::duration>(std::chrono::duration<double>(gap));
+    }
+
+    static double secondsSince(SimulationClock::duration start)
+    {
+        return std::chrono::duration<double>(SimulationClock::now() - start).count();
+    }
+
+    LoadGeneratorConfigPtr config_;
+    std::atomic<bool> trading_open_ = false;
+
+    /** Guards the sending state, the orders awaiting replies and the statistics. */
+    std::mutex load_mutex_;
+    bool sending_ = false;
+    double rate_ = 0;
+    unsigned long generation_ = 0;
+    SimulationClock::duration send_start_;
+    SimulationClock::duration next_send_;
+    int next_client_order_id_ = 0;
+
+    /** Send times of the orders not acked yet, by client order ID. */
+    std::unordered_map<int, unsigned long long> pending_acks_;
+
+    /** Exchange timestamps of the acks of orders not yet seen in market data, in the order acked, with the orders' send times. */
+    std::deque<std::pair<unsigned long long, unsigned long long>> awaiting_market_data_;
+
+    /** Exchange timestamps of the latest market data updates, with the times they were received. */
+    std::deque<std::pair<unsigned long long, unsigned long long>> recent_market_data_;
+
+    /** Resting orders by ID and side, oldest first. */
+    std::deque<std::pair<int, Order::Side>> resting_;
+
+    std::unique_ptr<LoadStats> stats_;
+
+    asio::strand<asio::io_context::executor_type> strand_;
+    SimulationTimer timer_;
+    std::mt19937 random_generator_;
+};
+
+#endif
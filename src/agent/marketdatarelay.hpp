@@ -0,0 +1,238 @@
+#ifndef MARKET_DATA_RELAY_HPP
+#define MARKET_DATA_RELAY_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "agent.hpp"
+#include "../config/marketdatarelayconfig.hpp"
+#include "../message/market_data_message.hpp"
+#include "../message/market_data_delta_message.hpp"
+#include "../message/market_depth_message.hpp"
+#include "../message/subscribe_message.hpp"
+#include "../message/event_message.hpp"
+#include "../message/symbol_definition_message.hpp"
+#include "../message/symboldirectory.hpp"
+#include "../utilities/logger.hpp"
+
+/** Subscribes once to every ticker of an exchange and passes its market data on to subscribers of its own, so that the
+ *  exchange sends each update to the relay rather than to every trader. Updates are passed on as the exchange sent them,
+ *  keeping its sender ID, sequence numbers and timestamps, and once to each node address however many subscribers it hosts.
+ *  Subscribers recover gaps from the exchange itself; rate-limited subscribers are not served, as updates are not conflated. */
+class MarketDataRelay : public Agent
+{
+public:
+
+    MarketDataRelay(NetworkEntity* network_entity, MarketDataRelayConfigPtr config)
+    : Agent(network_entity, config),
+      config_{config}
+    {
+        for (std::string const& ticker : config->tickers)
+        {
+            subscribers_[ticker];
+        }
+
+        connect(config->exchange_addr, config->exchange_name, [=, this](){
+            LOG_INFO("Relaying market data of " << config->exchange_name << " for " << config->tickers.size() << " tickers");
+            for (std::string const& ticker : config->tickers)
+            {
+                subscribeToMarket(ticker);
+            }
+        });
+    };
+
+    /** Takes the subscriptions sent to it by name, when hosted alongside traders. */
+    bool takesUnaddressedMessages() override { return true; };
+
+    void appendMetrics(std::string& out) override
+    {
+        std::string relay = "exchange=\"" + config_->exchange_name + "\"";
+        out += "# TYPE dsxe_relay_addresses gauge\n";
+        std::shared_lock<std::shared_mutex> lock(subscribers_mutex_);
+        for (auto const& [ticker, subscribers] : subscribers_)
+        {
+            out += "dsxe_relay_addresses{" + relay + ",ticker=\"" + ticker + "\"} " + std::to_string(subscribers.addresses.size()) + "\n";
+        }
+        lock.unlock();
+        out += "# TYPE dsxe_relayed_messages_total counter\n";
+        out += "dsxe_relayed_messages_total{" + relay + "} " + std::to_string(relayed_.load(std::memory_order_relaxed)) + "\n";
+    };
+
+private:
+
+    /** The addresses a ticker's market data is passed on to. */
+    struct TickerSubscribers
+    {
+        std::vector<std::string> addresses; // distinct, as one send reaches every agent of the node at an address
+        std::vector<int> undefined; // subscribers not yet sent the ticker's symbol definition
+    };
+
+    /** Subscribes to every update of the ticker from the exchange, with every group of fields, as the relay's subscribers may use any. */
+    void subscribeToMarket(const std::string& ticker)
+    {
+        SubscribeMessagePtr msg = std::make_shared<SubscribeMessage>();
+        msg->ticker = ticker;
+        msg->address = myAddr() + std::string{":"} + std::to_string(myPort());
+        msg->agent_name = "relay";
+        msg->multicast = false;
+        msg->fields = MarketDataFields::ALL;
+        sendMessageTo(config_->exchange_name, std::static_pointer_cast<Message>(msg));
+    };
+
+    /** Adds the subscriber's address to those the ticker's market data is passed on to. */
+    void onSubscribe(SubscribeMessagePtr msg)
+    {
+        auto it = subscribers_.find(msg->ticker);
+        if (it == subscribers_.end())
+        {
+            LOG_WARN("Relay of " << config_->exchange_name << " does not relay " << msg->ticker << " asked for by agent " << msg->sender_id);
+            return;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(subscribers_mutex_);
+        std::vector<std::string>& addresses = it->second.addresses;
+        if (std::find(addresses.begin(), addresses.end(), msg->address) == addresses.end())
+        {
+            addresses.push_back(msg->address);
+        }
+        it->second.undefined.push_back(msg->sender_id);
+        lock.unlock();
+        LOG_INFO("Relaying " << msg->ticker << " to agent " << msg->sender_id << " at " << msg->address);
+
+        defineSymbol(msg->ticker);
+
+        // As the exchange tells traders subscribing after trading has started
+        if (session_open_.load(std::memory_order_acquire))
+        {
+            EventMessagePtr event = std::make_shared<EventMessage>(EventMessage::EventType::TRADING_SESSION_START);
+            event->recipient_id = msg->sender_id;
+            sendBroadcast(msg->address, std::static_pointer_cast<Message>(event));
+        }
+    };
+
+    /** Sends the ticker's symbol definition to the subscribers not yet sent it, as the exchange's own,
+     *  once the relay has learned it from the exchange. */
+    void defineSymbol(const std::string& ticker)
+    {
+        std::optional<SymbolDirectory::Symbol> symbol = SymbolDirectory::instance().find(config_->exchange_id, ticker);
+        if (!symbol.has_value()) return;
+
+        std::unique_lock<std::shared_mutex> lock(subscribers_mutex_);
+        std::vector<int> undefined = std::move(subscribers_.at(ticker).undefined);
+        subscribers_.at(ticker).undefined.clear();
+        lock.unlock();
+
+        for (int subscriber_id : undefined)
+        {
+            SymbolDefinitionMessagePtr symbol_msg = std::make_shared<SymbolDefinitionMessage>();
+            symbol_msg->ticker = ticker;
+            symbol_msg->symbol = symbol->id;
+            symbol_msg->tick_size = symbol->tick_size;
+            symbol_msg->markSent(config_->exchange_id);
+            forwardMessage(subscriber_id, std::static_pointer_cast<Message>(symbol_msg), true);
+        }
+    };
+
+    /** Passes the exchange's message about the ticker on to the ticker's subscribers. */
+    void relay(const std::string& ticker, MessagePtr message)
+    {
+        auto it = subscribers_.find(ticker);
+        if (it == subscribers_.end()) return;
+
+        std::shared_lock<std::shared_mutex> lock(subscribers_mutex_);
+        if (!it->second.undefined.empty())
+        {
+            lock.unlock();
+            defineSymbol(ticker);
+            lock.lock();
+        }
+        if (it->second.addresses.empty()) return;
+        forwardBroadcast(it->second.addresses, message);
+        relayed_.fetch_add(it->second.addresses.size(), std::memory_order_relaxed);
+    };
+
+    /** Passes the start or end of the trading session on to every subscriber once, though the exchange sends it for each ticker. */
+    void onSessionEvent(EventMessagePtr msg)
+    {
+        bool open = msg->event_type == EventMessage::EventType::TRADING_SESSION_START;
+        if (session_open_.exchange(open, std::memory_order_acq_rel) == open) return;
+
+        std::unordered_set<std::string> seen;
+        std::vector<std::string> addresses;
+        std::shared_lock<std::shared_mutex> lock(subscribers_mutex_);
+        for (auto const& [ticker, subscribers] : subscribers_)
+        {
+            for (std::string const& address : subscribers.addresses)
+            {
+                if (seen.insert(address).second) addresses.push_back(address);
+            }
+        }
+        lock.unlock();
+
+        EventMessagePtr event = std::make_shared<EventMessage>(msg->event_type);
+        sendBroadcast(addresses, std::static_pointer_cast<Message>(event));
+    };
+
+    /** Checks the type of the incoming message and makes a callback. */
+    std::optional<MessagePtr> handleMessageFrom(std::string_view sender, MessagePtr message) override
+    {
+        if (message->type == MessageType::SUBSCRIBE)
+        {
+            onSubscribe(std::static_pointer_cast<SubscribeMessage>(message));
+        }
+        return std::nullopt;
+    };
+
+    /** Passes the market data and session events of the exchange on to the subscribers. */
+    void handleBroadcastFrom(std::string_view sender, MessagePtr message) override
+    {
+        if (sender != config_->exchange_name) return;
+
+        switch (message->type)
+        {
+            case MessageType::MARKET_DATA:
+            {
+                relay(std::static_pointer_cast<MarketDataMessage>(message)->data->ticker, message);
+                break;
+            }
+            case MessageType::MARKET_DATA_DELTA:
+            {
+                relay(std::static_pointer_cast<MarketDataDeltaMessage>(message)->ticker, message);
+                break;
+            }
+            case MessageType::MARKET_DEPTH:
+            {
+                relay(std::static_pointer_cast<MarketDepthMessage>(message)->depth->ticker, message);
+                break;
+            }
+            case MessageType::EVENT:
+            {
+                EventMessagePtr msg = std::static_pointer_cast<EventMessage>(message);
+                if (msg->event_type == EventMessage::EventType::TRADING_SESSION_START
+                    || msg->event_type == EventMessage::EventType::TRADING_SESSION_END)
+                {
+                    onSessionEvent(msg);
+                }
+                break;
+            }
+            default:
+            {
+                break;
+            }
+        }
+    };
+
+    MarketDataRelayConfigPtr config_;
+
+    /** Subscribers of each ticker relayed; the tickers are fixed at construction, and their subscribers guarded by the mutex. */
+    std::unordered_map<std::string, TickerSubscribers> subscribers_;
+    std::shared_mutex subscribers_mutex_;
+
+    std::atomic<bool> session_open_ = false;
+    std::atomic<unsigned long> relayed_ = 0;
+};
+
+#endif
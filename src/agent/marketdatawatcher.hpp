@@ -54,7 +54,7 @@ private:
     {
         if (message->type == MessageType::MARKET_DATA)
             {
-                onMarketData(sender, std::dynamic_pointer_cast<MarketDataMessage>(message));
+                onMarketData(sender, std::static_pointer_cast<MarketDataMessage>(message));
             }
     }
 
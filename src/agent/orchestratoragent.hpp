@@ -9,18 +9,27 @@
 #include "../config/marketwatcherconfig.hpp"
 #include "../config/orderinjectorconfig.hpp"
 #include "../message/config_message.hpp"
+#include "../message/config_ack_message.hpp"
+#include "../message/profit_report_message.hpp"
 #include "../message/limit_order_message.hpp"
 #include "../message/config_message.hpp"
 #include "../order/order.hpp"
+#include "../networking/localtransport.hpp"
+#include "../utilities/simulationclock.hpp"
 
 #include <sys/stat.h> 
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
+#include <mutex>
 #include <random>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 
 class OrchestratorAgent : public Agent 
@@ -35,88 +44,258 @@ public:
     /** Configures the simulation given a simulation configuration. */
     void configureSimulation(SimulationConfigPtr simulation)
     {
-        configuration_thread_ = new std::thread([&](){
+        // The configuration is timed on the simulation clock, which must not move before the thread waits on it
+        SimulationClock::beginWork();
+        configuration_thread_ = new std::thread([=, this](){
+            SimulationClock::Participant participant{std::adopt_lock};
             std::cout << "Simulation repetitions: " << simulation->repetitions() 
-            << " time: " << simulation->time() << " seconds." << std::endl;
+            << " time: " << simulation->time() << " seconds, up to " 
+            << simulation->concurrentTrials() << " at once." << std::endl;
 
-            for (int i = 0; i < simulation->repetitions(); i++)
+            // Exchanges cannot be replaced mid-session, so trials are given at least as long as their longest session to end
+            int trial_time = std::max(simulation->time(), longestSession(simulation));
+
+            // Nodes hosting the exchanges and injectors of the first slot are started before the orchestrator;
+            // traders given their address join them, and exchange messages with them in process
+            SimulationConfigPtr first_trial = simulation->trial(0);
+            for (auto exchange_config : first_trial->exchanges())
+            {
+                launched_nodes_.insert(exchange_config->addr);
+            }
+            for (auto injector_config : first_trial->injectors())
             {
-                // Initialise exchanges
-                for (auto exchange_config : simulation->exchanges())
+                launched_nodes_.insert(injector_config->addr);
+            }
+
+            // Trials running at once take a slot each, and the next trials reuse their nodes once they have all ended
+            for (int first = 0; first < simulation->repetitions(); first += simulation->concurrentTrials())
+            {
+                int last = std::min(first + simulation->concurrentTrials(), simulation->repetitions());
+                std::vector<SimulationConfigPtr> trials;
+                for (int i = first; i < last; i++)
                 {
-                    configureNode(exchange_config);
+                    trials.push_back(simulation->trial(i));
                 }
+                runTrials(trials, first, trial_time);
+            }
 
-                if (i == 0) // Only initialise the injector on the first iteration so it injects constantly in rest of simulation. 
-                { 
-
-                    std::this_thread::sleep_for(std::chrono::milliseconds(500)); // Wait for exchanges to launch
-
-                    for (auto injector_config : simulation->injectors())
-                    {
-                        std::cout << "Initialising injector: "
-                                    << injector_config->addr 
-                                    << " for exchange " 
-                                    << std::dynamic_pointer_cast<OrderInjectorConfig>(injector_config)->exchange_name
-                                    << std::endl;
-                        configureNode(injector_config);
-                    } 
+            std::cout << "Trading session ended." << std::endl;
+            std::cout << "Finished all " << simulation->repetitions() << " simulation trials." << std::endl;
+            for (int slot = 0; slot < std::min(simulation->concurrentTrials(), simulation->repetitions()); slot++)
+            {
+                for (auto injector_config : simulation->trial(slot)->injectors()) {
+                    EventMessagePtr stop_injection_msg = std::make_shared<EventMessage>(EventMessage::EventType::ORDER_INJECTION_STOP); // Stop injection entirely after all repetitions
+                    sendMessageTo(std::to_string(injector_config->agent_id), std::static_pointer_cast<Message>(stop_injection_msg));
                 }
+            }
+        });
+    }
 
-                // Allow injector to initialise first
-                std::this_thread::sleep_for(std::chrono::seconds(2));
+    /** Configures the given trials to run at the same time, numbered from the given index, 
+     *  and waits up to the given number of seconds for their sessions to end. */
+    void runTrials(const std::vector<SimulationConfigPtr>& trials, int first, int trial_time)
+    {
+        SimulationClock::duration started = SimulationClock::now();
+
+        // Agents configured with the same address in a trial are hosted together by one node
+        std::unordered_map<std::string, unsigned int> agents_per_node;
+        for (SimulationConfigPtr const& trial : trials)
+        {
+            for (auto exchange_config : trial->exchanges()) ++agents_per_node[exchange_config->addr];
+            for (auto injector_config : trial->injectors()) ++agents_per_node[injector_config->addr];
+            for (auto relay_config : trial->relays()) ++agents_per_node[relay_config->addr];
+            for (auto trader_config : trial->traders()) ++agents_per_node[trader_config->addr];
+        }
 
-                // Initialise traders
-                for (auto trader_config : simulation->traders())
-                {   
-                    trader_addresses_.push_back(trader_config->addr);
-                    launchTraderProcess(trader_config->addr, to_string(trader_config->type));
-                    std::this_thread::sleep_for(std::chrono::milliseconds(500)); // Wait for traders to launch
-                    configureNode(trader_config);
-                }
+        // Every node is launched up front; configurations sent before a node listens are sent again until it acknowledges them
+        for (SimulationConfigPtr const& trial : trials)
+        {
+            for (auto exchange_config : trial->exchanges())
+            {
+                launchNode(exchange_config, agents_per_node[exchange_config->addr]);
+            }
+            for (auto injector_config : trial->injectors())
+            {
+                launchNode(injector_config, agents_per_node[injector_config->addr]);
+            }
+            for (auto relay_config : trial->relays())
+            {
+                launchNode(relay_config, agents_per_node[relay_config->addr]);
+            }
+            for (auto trader_config : trial->traders())
+            {
+                launchNode(trader_config, agents_per_node[trader_config->addr]);
+            }
+        }
 
-                for (auto injector_config : simulation->injectors()) {
-                    sendTraderListToInjector(injector_config);
-                }
+        // Initialise exchanges
+        std::vector<AgentConfigPtr> exchange_configs;
+        for (SimulationConfigPtr const& trial : trials)
+        {
+            for (auto exchange_config : trial->exchanges())
+            {
+                std::unique_lock<std::mutex> lock(trials_mutex_);
+                ended_exchanges_.erase(exchange_config->agent_id);
+                lock.unlock();
+                exchange_configs.push_back(exchange_config);
+            }
+        }
+        configureNodes(exchange_configs);
 
-                /**  
-                for (auto watcher_config : simulation->watchers())
+        if (first == 0) // Only initialise the injectors in the first trials so they inject constantly in rest of simulation. 
+        { 
+            std::vector<AgentConfigPtr> injector_configs;
+            for (SimulationConfigPtr const& trial : trials)
+            {
+                for (auto injector_config : trial->injectors())
                 {
-                    std::cout << "Initialising watcher: "
-                                << watcher_config->addr 
+                    std::cout << "Initialising injector: "
+                                << injector_config->addr 
                                 << " for exchange " 
-                                << std::dynamic_pointer_cast<MarketWatcherConfig>(watcher_config)->exchange_name
-                                << " with ticker "
-                                << std::dynamic_pointer_cast<MarketWatcherConfig>(watcher_config)->ticker 
+                                << std::dynamic_pointer_cast<OrderInjectorConfig>(injector_config)->exchange_name
                                 << std::endl;
-                    configureNode(watcher_config);
+                    injector_configs.push_back(injector_config);
                 }
-                */
+            } 
+            configureNodes(injector_configs);
+        }
+
+        // Relays subscribe to their exchanges before the traders taking market data from them subscribe to the relays
+        std::vector<AgentConfigPtr> relay_configs;
+        for (SimulationConfigPtr const& trial : trials)
+        {
+            for (auto relay_config : trial->relays()) relay_configs.push_back(relay_config);
+        }
+        if (!relay_configs.empty()) configureNodes(relay_configs);
+
+        // Initialise traders
+        std::vector<AgentConfigPtr> trader_configs;
+        for (SimulationConfigPtr const& trial : trials)
+        {
+            std::vector<std::string> trader_addresses;
+            for (auto trader_config : trial->traders())
+            {   
+                trader_addresses.push_back(trader_config->addr);
+                trader_configs.push_back(trader_config);
+            }
 
-                std::cout << "[Orchestrator] Sending ORDER_INJECTION_START event to Order Injector.\n";
+            std::unique_lock<std::mutex> lock(trials_mutex_);
+            for (auto injector_config : trial->injectors())
+            {
+                trader_addresses_[injector_config->agent_id] = trader_addresses;
+            }
+        }
+        configureNodes(trader_configs);
+
+        for (SimulationConfigPtr const& trial : trials)
+        {
+            for (auto injector_config : trial->injectors()) {
+                sendTraderListToInjector(injector_config);
+            }
+        }
+
+        /**  
+        for (auto watcher_config : simulation->watchers())
+        {
+            std::cout << "Initialising watcher: "
+                        << watcher_config->addr 
+                        << " for exchange " 
+                        << std::dynamic_pointer_cast<MarketWatcherConfig>(watcher_config)->exchange_name
+                        << " with ticker "
+                        << std::dynamic_pointer_cast<MarketWatcherConfig>(watcher_config)->ticker 
+                        << std::endl;
+            configureNode(watcher_config);
+        }
+        */
+
+        std::cout << "[Orchestrator] Sending ORDER_INJECTION_START event to Order Injector.\n";
+        for (SimulationConfigPtr const& trial : trials)
+        {
+            for (auto injector_config : trial->injectors()) {
                 EventMessagePtr order_inject_start_msg = std::make_shared<EventMessage>(EventMessage::EventType::ORDER_INJECTION_START);
-                for (auto injector_config : simulation->injectors()) {
-                    sendMessageTo(std::to_string(injector_config->agent_id), std::static_pointer_cast<Message>(order_inject_start_msg));
-                }
+                sendMessageTo(std::to_string(injector_config->agent_id), std::static_pointer_cast<Message>(order_inject_start_msg));
+            }
+        }
 
-                // Allow injection to send customer orders before trading. 
-                std::this_thread::sleep_for(std::chrono::seconds(5));
+        // Allow injection to send customer orders before trading. 
+        SimulationClock::sleepFor(std::chrono::seconds(5));
 
-                // Wait for this trial to finish before starting the next one
-                std::cout << "Simulation " << i << " configured." << std::endl;
-                std::cout << "Waiting " << simulation->time() << " seconds for simulation trial to end..." << std::endl;
-                std::this_thread::sleep_for(std::chrono::seconds(simulation->time()));
+        // Wait for the exchanges of these trials to report the end of their sessions before starting the next ones
+        for (size_t i = 0; i < trials.size(); i++)
+        {
+            std::cout << "Simulation " << first + i << " configured." << std::endl;
+        }
+        std::cout << "Waiting up to " << trial_time << " seconds for " << trials.size() << " simulation trials to end..." << std::endl;
+        SimulationClock::duration deadline = started + std::chrono::seconds(trial_time);
+        while (!trialsEnded(trials) && SimulationClock::now() < deadline)
+        {
+            SimulationClock::sleepFor(TRIAL_POLL_INTERVAL);
+        }
+        if (!trialsEnded(trials))
+        {
+            std::cerr << "[Orchestrator] Warning: Trials from " << first << " did not all report the end of their sessions in time.\n";
+        }
+        printProfits(trials, first);
+
+        // The agents of the next trials on these nodes replace those of these, keeping their connections
+        for (SimulationConfigPtr const& trial : trials)
+        {
+            for (auto exchange_config : trial->exchanges()) configured_nodes_.insert(exchange_config->addr);
+            for (auto trader_config : trial->traders()) configured_nodes_.insert(trader_config->addr);
+            for (auto relay_config : trial->relays()) configured_nodes_.insert(relay_config->addr);
+        }
+
+        std::unique_lock<std::mutex> lock(trials_mutex_);
+        trader_addresses_.clear();
+        std::cout << "Cleared trader addresses for next trial." << std::endl;
+    }
 
-                trader_addresses_.clear();
-                std::cout << "Cleared trader addresses for next trial." << std::endl;
+    /** Sends the configurations to their nodes all at once, and waits until each node has acknowledged its agent,
+     *  sending the configurations not yet acknowledged again now and then. Returns whether all were acknowledged in time. */
+    bool configureNodes(const std::vector<AgentConfigPtr>& configs)
+    {
+        std::unique_lock<std::mutex> lock(trials_mutex_);
+        for (AgentConfigPtr const& config : configs)
+        {
+            configured_agents_.erase(config->agent_id);
+        }
+        lock.unlock();
+
+        SimulationClock::duration started = SimulationClock::now();
+        SimulationClock::duration last_sent = started;
+        std::vector<AgentConfigPtr> pending = configs;
+        for (AgentConfigPtr const& config : pending)
+        {
+            configureNode(config);
+        }
+
+        while (true)
+        {
+            SimulationClock::sleepFor(CONFIG_ACK_POLL_INTERVAL);
+
+            lock.lock();
+            std::erase_if(pending, [this](AgentConfigPtr const& config) { return configured_agents_.contains(config->agent_id); });
+            lock.unlock();
+            if (pending.empty()) return true;
+
+            SimulationClock::duration now = SimulationClock::now();
+            if (now - started >= CONFIG_ACK_TIMEOUT)
+            {
+                std::cerr << "[Orchestrator] Warning: " << pending.size() << " of " << configs.size() 
+                    << " agents did not acknowledge their configuration in time.\n";
+                return false;
             }
-            std::cout << "Trading session ended." << std::endl;
-            std::cout << "Finished all " << simulation->repetitions() << " simulation trials." << std::endl;
-            EventMessagePtr stop_injection_msg = std::make_shared<EventMessage>(EventMessage::EventType::ORDER_INJECTION_STOP); // Stop injection entirely after all repetitions
-            for (auto injector_config : simulation->injectors()) {
-                sendMessageTo(std::to_string(injector_config->agent_id), std::static_pointer_cast<Message>(stop_injection_msg));
+
+            // Nodes still launching refused the connection, and are sent their configurations again
+            if (now - last_sent >= CONFIG_RESEND_INTERVAL)
+            {
+                for (AgentConfigPtr const& config : pending)
+                {
+                    configureNode(config);
+                }
+                last_sent = now;
             }
-        });
+        }
     }
 
     /** Sends a config message to the simulation node at the given address. */
@@ -124,10 +303,12 @@ public:
     {   
         //std::cout << "sending config message to: " << config->addr << std::endl; // DEBUG
         std::cout << "Initialising agent: " << to_string(config->type) << " with addr: " << config->addr << "\n"; // DEBUG
+        bool reset = configured_nodes_.contains(config->addr);
         this->connect(std::string(config->addr), std::to_string(config->agent_id), [=, this](){
             std::cout << "[DEBUG] Registered agent: " << config->addr << " as ID " << config->agent_id << "\n";
             ConfigMessagePtr msg = std::make_shared<ConfigMessage>();
             msg->config = config;
+            msg->reset = reset;
 
             std::string agent_id = std::to_string(config->agent_id);
             //std::cout << "sending config to agent " << agent_id << " at " << config->addr << std::endl; DEBUG
@@ -135,8 +316,21 @@ public:
         });
     }
 
-    /** Launches a trader process at the given address to store logs as substitute to terminal prints when using markets.csv. */
-    void launchTraderProcess(const std::string& addr, const std::string& trader_type) {
+    /** Launches a node to host the agent of the given configuration, along with max_agents - 1 others, 
+     *  unless one was launched at its address already or runs in this process. Returns whether a node was launched. */
+    bool launchNode(AgentConfigPtr config, unsigned int max_agents)
+    {
+        // Nodes already running in this process need no launching
+        bool in_process = LocalTransport::instance().find(config->addr) != nullptr;
+        if (!launched_nodes_.insert(config->addr).second || in_process) return false;
+
+        launchTraderProcess(config->addr, to_string(config->type), max_agents);
+        return true;
+    }
+
+    /** Launches a trader process at the given address, hosting up to max_agents traders, 
+     *  to store logs as substitute to terminal prints when using markets.csv. */
+    void launchTraderProcess(const std::string& addr, const std::string& trader_type, unsigned int max_agents = 1) {
         
         // Clear logs directory 
         static bool logsCleared = false;
@@ -171,7 +365,8 @@ public:
         }
 
         std::string log_path = "logs/traders/trader_" + port + ".log"; // Set log path
-        std::string command = "nohup ./simulation node --port " + port + " > " + log_path + " 2>&1 &"; // Set command to launch trader process with log
+        std::string command = "nohup ./simulation node --port " + port + " --max-agents " + std::to_string(max_agents) 
+            + " > " + log_path + " 2>&1 &"; // Set command to launch trader process with log
         std::cout << "Launching " << trader_type << " trader at: " << addr << " (log: " << log_path << ")" << "\n"; // DEBUG
         
         int ret = system(command.c_str()); // Launch trader process
@@ -196,17 +391,36 @@ private:
     std::optional<MessagePtr> handleMessageFrom(std::string_view sender, MessagePtr message) override
     {
         if (message->type == MessageType::REQUEST_TRADER_LIST) { 
-            if (trader_addresses_.empty()) {
+            std::unique_lock<std::mutex> lock(trials_mutex_);
+            std::vector<std::string> trader_addresses = trader_addresses_[message->sender_id];
+            lock.unlock();
+            if (trader_addresses.empty()) {
                 std::cerr << "[Orchestrator] Warning: No traders available when responding to injector.\n";
             }
     
             // Create and send trader list response
             TraderListMessagePtr response_msg = std::make_shared<TraderListMessage>();
-            response_msg->trader_addresses = trader_addresses_; 
+            response_msg->trader_addresses = trader_addresses; 
             sendMessageTo(sender, std::static_pointer_cast<Message>(response_msg));
     
             std::cout << "[Orchestrator] Sent trader list to Order Injector.\n";
         }
+        else if (message->type == MessageType::CONFIG_ACK)
+        {
+            std::unique_lock<std::mutex> lock(trials_mutex_);
+            configured_agents_.insert(std::static_pointer_cast<ConfigAckMessage>(message)->agent_id);
+        }
+        else if (message->type == MessageType::EVENT 
+            && std::static_pointer_cast<EventMessage>(message)->event_type == EventMessage::EventType::TRADING_SESSION_END)
+        {
+            std::unique_lock<std::mutex> lock(trials_mutex_);
+            ended_exchanges_.insert(message->sender_id);
+        }
+        else if (message->type == MessageType::PROFIT_REPORT)
+        {
+            std::unique_lock<std::mutex> lock(trials_mutex_);
+            profit_reports_[message->sender_id] = std::static_pointer_cast<ProfitReportMessage>(message);
+        }
         return std::nullopt;
     }
 
@@ -216,9 +430,66 @@ private:
         std::cout << "Orchestrator received a broadcast" << "\n";
     }
 
+    /** Returns the longest an exchange of the simulation may take to run its session, in seconds: its connection time,
+     *  the quiet period it waits for after it, and its trading time, counted from the start of the trial. */
+    static int longestSession(SimulationConfigPtr simulation)
+    {
+        int longest = 0;
+        for (auto exchange_config : simulation->exchanges())
+        {
+            longest = std::max(longest, exchange_config->connect_time + EXCHANGE_QUIET_PERIOD + exchange_config->trading_time);
+        }
+        return longest;
+    }
+
+    /** Indicates whether every exchange of the given trials has reported the end of its session. */
+    bool trialsEnded(const std::vector<SimulationConfigPtr>& trials)
+    {
+        std::unique_lock<std::mutex> lock(trials_mutex_);
+        for (SimulationConfigPtr const& trial : trials)
+        {
+            for (auto exchange_config : trial->exchanges())
+            {
+                if (!ended_exchanges_.contains(exchange_config->agent_id)) return false;
+            }
+        }
+        return true;
+    }
+
+    /** Prints the latest profits reported by each exchange of the given trials, numbered from the given index:
+     *  the final ones of exchanges that ended their sessions, and the last snapshot of the others. */
+    void printProfits(const std::vector<SimulationConfigPtr>& trials, int first)
+    {
+        std::unique_lock<std::mutex> lock(trials_mutex_);
+        for (size_t i = 0; i < trials.size(); i++)
+        {
+            for (auto exchange_config : trials[i]->exchanges())
+            {
+                auto report = profit_reports_.find(exchange_config->agent_id);
+                if (report == profit_reports_.end()) continue;
+
+                std::unordered_map<std::string, double> by_name = report->second->accounts.profitsByName();
+                std::vector<std::pair<std::string, double>> sorted_profits(by_name.begin(), by_name.end());
+                std::sort(sorted_profits.begin(), sorted_profits.end(), 
+                    [](const auto& a, const auto& b) { return a.second > b.second; });
+
+                std::cout << "Profits of simulation " << first + i << " at " << exchange_config->name 
+                    << (report->second->final ? "" : " (last snapshot)") << ":\n";
+                for (auto const& [name, profit] : sorted_profits)
+                {
+                    std::cout << "  " << name << ": " << profit << "\n";
+                }
+                profit_reports_.erase(report);
+            }
+        }
+    }
+
     void sendTraderListToInjector(AgentConfigPtr injector_config)
     {
-        if (trader_addresses_.empty()) {
+        std::unique_lock<std::mutex> lock(trials_mutex_);
+        std::vector<std::string> trader_addresses = trader_addresses_[injector_config->agent_id];
+        lock.unlock();
+        if (trader_addresses.empty()) {
             std::cerr << "[Orchestrator] Warning: No traders available, not sending trader list.\n";
             return;
         }
@@ -235,7 +506,7 @@ private:
         }
 
         TraderListMessagePtr response_msg = std::make_shared<TraderListMessage>();
-        response_msg->trader_addresses = trader_addresses_;
+        response_msg->trader_addresses = trader_addresses;
 
         std::cout << "[Orchestrator] Sending trader list to Order Injector (Agent ID: " << agent_id_str << ").\n";
 
@@ -243,8 +514,26 @@ private:
     }
 
 
+    /** Seconds an exchange waits with no new connection before opening its session, with a margin for the last to connect. */
+    static constexpr int EXCHANGE_QUIET_PERIOD = 10;
+
+    /** Time between checks for the end of the trials running. */
+    static constexpr std::chrono::seconds TRIAL_POLL_INTERVAL {1};
+
+    /** Time between checks for configuration acknowledgements, between sending unacknowledged configurations again, 
+     *  and before giving up on them. */
+    static constexpr std::chrono::milliseconds CONFIG_ACK_POLL_INTERVAL {20};
+    static constexpr std::chrono::seconds CONFIG_RESEND_INTERVAL {2};
+    static constexpr std::chrono::seconds CONFIG_ACK_TIMEOUT {30};
+
     std::thread* configuration_thread_;
-    std::vector<std::string> trader_addresses_; 
+    std::unordered_map<int, std::vector<std::string>> trader_addresses_; // Traders of the trial of each injector, by injector ID
+    std::unordered_set<int> ended_exchanges_; // Exchanges that have reported the end of their session, by ID
+    std::unordered_set<int> configured_agents_; // Agents whose nodes have acknowledged their configuration, by ID
+    std::unordered_map<int, ProfitReportMessagePtr> profit_reports_; // Latest profits streamed by each exchange, by ID
+    std::mutex trials_mutex_; // Guards the trader addresses, ended exchanges, configured agents and profit reports, which messages handled on IO threads read and update
+    std::unordered_set<std::string> launched_nodes_; // Trader nodes stay up across repetitions
+    std::unordered_set<std::string> configured_nodes_; // Nodes that hosted agents of trials already run, which are reset for the next
 };
 
 #endif
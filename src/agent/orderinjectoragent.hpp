@@ -5,12 +5,16 @@
 #include "../config/simulationconfig.hpp"
 #include "../config/orderinjectorconfig.hpp"
 #include "../message/customer_order_message.hpp"
+#include "../message/customer_order_batch_message.hpp"
 #include "../message/trader_list_message.hpp"
 #include "../message/request_trader_list_message.hpp"
 #include "../message/event_message.hpp"
 #include "traderagent.hpp"
+#include "../trade/offsetschedule.hpp"
+#include "../trade/injectionschedule.hpp"
+#include "../utilities/logger.hpp"
 #include <random>
-#include <thread>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <chrono>
@@ -19,8 +23,8 @@
 #include <string>
 #include <stdexcept>
 #include <unordered_map>
-#include <condition_variable>
 #include <cmath> 
+#include <boost/asio.hpp>
 
 
 class OrderInjectorAgent : public Agent 
@@ -30,10 +34,9 @@ public:
         : Agent(network_entity, config), 
           exchange_{config->exchange_name},  // Store exchange name
           ticker_{config->ticker},           // Store ticker symbol
-          injection_thread_(nullptr), 
-          is_injecting_(false),
-          random_generator_(std::random_device{}()), 
-          config_(config)
+          config_(config),
+          strand_{asio::make_strand(ioContext())},
+          timer_{strand_}
         {
 
         // Automatically connect to exchange on initialisations
@@ -59,12 +62,7 @@ public:
 
     // Gracefully terminates the agent.
     void terminate() override {
-
-        if (injection_thread_ != nullptr)
-        {
-            injection_thread_->join();
-            delete(injection_thread_);
-        }
+        stopInjecting();
     }
 
     void handleBroadcastFrom(std::string_view sender, MessagePtr message) override {
@@ -129,18 +127,33 @@ public:
 
 private:
 
+    /** Session time the schedule is generated ahead for when the session length is unknown, in seconds. */
+    static constexpr double DEFAULT_SCHEDULE_WINDOW = 60.0;
+
+    /** Most orders sent to one node in a single broadcast, keeping the datagram well within UDP's limit. */
+    static constexpr size_t MAX_BATCH_ORDERS = 512;
+
     std::string exchange_;
     std::string ticker_;
     OrderInjectorConfigPtr config_;
-    std::thread* injection_thread_;
+
+    /** Guards the schedule and injection state. Held while orders are dispatched, so stopping waits for a dispatch in progress. */
     std::mutex mutex_;
-    bool is_injecting_;
-    std::mt19937 random_generator_;
-    std::chrono::time_point<std::chrono::high_resolution_clock> start_time_;
+    bool is_injecting_ = false;
+    unsigned long generation_ = 0;
+    SimulationClock::duration start_time_;
     std::vector<std::string> trader_addresses_;
-    int next_client_order_id_;
+
+    std::unique_ptr<InjectionSchedule> schedule_;
+    size_t next_order_ = 0;  // Index in the schedule of the first order not dispatched yet
+
+    asio::strand<asio::io_context::executor_type> strand_;
+    SimulationTimer timer_;
 
     void startInjecting() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (is_injecting_) return;
+
         std::cout << "[OrderInjector] Starting order injection now.\n";
 
         if (trader_addresses_.empty()) {
@@ -148,304 +161,111 @@ private:
             return;
         }
 
+        OffsetSchedule offset_schedule;
+        if (config_->use_input_file) {
+            try {
+                offset_schedule = OffsetSchedule::load(config_->input_file);
+                std::cout << "Using input file for order schedule: " << offset_schedule.size() << " points" << std::endl;
+            } catch (const std::exception& ex) {
+                std::cerr << "[OrderInjector] Failed to load input file: " << ex.what() << "\n";
+            }
+        }
+
+        unsigned int seed = (config_->seed != 0) ? config_->seed : SimulationClock::randomSeed();
+        schedule_ = std::make_unique<InjectionSchedule>(config_, std::move(offset_schedule), trader_addresses_.size(), seed);
+        schedule_->extendTo(scheduleWindow());
+        next_order_ = 0;
+        std::cout << "[OrderInjector] Scheduled " << schedule_->size() << " customer orders over " 
+                  << schedule_->horizon() << "s with seed " << seed << ".\n";
+
         is_injecting_ = true;
-        start_time_ = std::chrono::high_resolution_clock::now();
-        injection_thread_ = new std::thread([this]() { injectOrders(); });
+        start_time_ = SimulationClock::now();
+        unsigned long generation = ++generation_;
+        asio::post(strand_, SimulationClock::holding([this, generation]() { dispatchDue(generation); }));
     }
 
     void stopInjecting() 
     {
-        std::unique_lock<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!is_injecting_) return;
         std::cout << "Trading window ended.\n";
         is_injecting_ = false;
-        lock.unlock();
-        if (injection_thread_ != nullptr) {
-            if (injection_thread_->joinable()) {
-                injection_thread_->join();
-            }
-            delete injection_thread_;
-            injection_thread_ = nullptr;
-        }
-    }
-    
-
-    double getElapsedTime() {
-        auto now = std::chrono::high_resolution_clock::now();
-        double elapsed = std::chrono::duration<double>(now - start_time_).count();
-        std::cout << "[OrderInjector] Elapsed Time: " << elapsed << "s\n";
-        return elapsed;
-    }
-    
-    // Parses a time string "HH:MM:SS" into seconds since midnight.
-    static double parseTime(const std::string &time_string) {
-        std::tm tm = {};
-        std::istringstream ss(time_string);
-        ss >> std::get_time(&tm, "%H:%M:%S");
-        if (ss.fail()) {
-            throw std::invalid_argument("Invalid time format: " + time_string);
-        }
-        return tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+        ++generation_;
     }
 
-    // Reads a CSV historical file and returns a vector of (normalized time, scaled price offset) pairs.
-    static std::vector<std::pair<double, int>> getOffsetEventList(const std::string &historical_data_file) {
-
-        std::ifstream file(historical_data_file);
-        if (!file.is_open()) {
-            throw std::runtime_error("Failed to open the file: " + historical_data_file);
-        }
-        std::vector<std::pair<double, double>> raw_events;
-        std::string line;
-        bool first_line = true;
-        double first_time = 0.0;
-        double min_price = std::numeric_limits<double>::max();
-        double max_price = std::numeric_limits<double>::min();
-
-        // Assumes CSV format: Date,Time,Open,High,Low,Close,Volume
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;
-            std::istringstream ss(line);
-            std::string date, time, open, high, low, close, volume;
-            std::getline(ss, date, ',');
-            std::getline(ss, time, ',');
-            std::getline(ss, open, ',');
-            std::getline(ss, high, ',');
-            std::getline(ss, low, ',');
-            std::getline(ss, close, ',');
-            std::getline(ss, volume, ',');
-            double price = std::stod(close);
-            double current_time = parseTime(time);
-            if (first_line) {
-                first_time = current_time;
-                first_line = false;
-            }
-            double elapsed_time = current_time - first_time;
-            raw_events.emplace_back(elapsed_time, price);
-            if (price < min_price) min_price = price;
-            if (price > max_price) max_price = price;
-        }
-        file.close();
-
-        if (raw_events.empty()) {
-            throw std::runtime_error("No data points found in historical file: " + historical_data_file);
-        }
-
-        double total_time = raw_events.back().first;
-        std::cout << "[OrderInjector] Total Time in CSV: " << total_time << " seconds\n";
-        double price_range = max_price - min_price;
-        int scale_factor = 40;
-        std::vector<std::pair<double, int>> offset_events;
-
-        for (const auto &event : raw_events) {
-            double normalized_time = event.first / total_time;
-            double normalized_price = (event.second - min_price) / price_range;
-            normalized_price = std::clamp(normalized_price, 0.0, 1.0);
-            int scaled_price = static_cast<int>(std::round(normalized_price * scale_factor));
-            offset_events.emplace_back(normalized_time, scaled_price);
-        }
-        return offset_events;
+    /** Returns the session time to generate the schedule ahead for at once: the whole session if its length is known. */
+    double scheduleWindow() const
+    {
+        return (config_->session_time > 0) ? config_->session_time : DEFAULT_SCHEDULE_WINDOW;
     }
 
-    // Computes the offset based on real-world data.
-    static int realWorldScheduleOffset(double time, double total_time, const std::vector<std::pair<double, int>> &offset_events) {
-        double percent_elapsed = time / total_time;
-        percent_elapsed = std::fmod(percent_elapsed, 1.0);  // Normalize to [0, 1)
-        std::cout << "Percent Elapsed: " << percent_elapsed << std::endl;
-        if (percent_elapsed > 1.0) {
-            percent_elapsed -= std::floor(percent_elapsed); // Keep it in [0,1]
-        }
-        int offset = 0;
-        for (const auto &event : offset_events) {
-            //std::cout << "Time: " << event.first << " | Offset: " << event.second << std::endl;
-            offset = event.second;  // Keep updating offset
-            if (percent_elapsed <= event.first) {
-                break;  // Stop at the first event greater than percent_elapsed
-            }
-        }
-        return offset;
-    }
+    /** Sends every order that is due in one batch per trader node, then waits until the next order is due.
+     *  Does nothing if injection was stopped or restarted since the given generation was started. */
+    void dispatchDue(unsigned long generation)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation != generation_) return;
 
-    // Alternative offset function (sine wave + linear trend).
-    static int scheduleOffset(double time) {
-        double pi2 = 2 * M_PI;
-        double c = M_PI * 3000;
-        double wavelength = time / c;
-        double gradient = 100 * time / (c / pi2);
-        double amplitude = 100 * time / (c / pi2);
-        double offset = gradient + amplitude * sin(wavelength * time);
-        return static_cast<int>(std::round(offset));
-    }
+        double elapsed = std::chrono::duration<double>(SimulationClock::now() - start_time_).count();
+        LOG_DEBUG("[OrderInjector] Elapsed Time: " << elapsed << "s");
 
-    // Compute the next delay interval based on time mode and number of traders 
-    double getNextIssueDelay(int n_traders) {
-        double interval = config_->interval; // interval from config (in seconds)
-        if (config_->time_mode == "periodic") 
+        // Batches are sent in the order their nodes first appear, so the dispatch order follows the schedule
+        std::vector<std::pair<std::string, CustomerOrderBatchMessagePtr>> batches;
+        std::unordered_map<std::string, size_t> batch_index;
+        const std::vector<ScheduledCustomerOrder>& orders = schedule_->orders();
+        for (; next_order_ < orders.size() && orders[next_order_].time <= elapsed; ++next_order_)
         {
-            return interval; 
-        } 
-        else if (config_->time_mode == "drip-fixed") 
-        {
-            return (n_traders > 1) ? interval / (n_traders - 1) : interval;
-        } 
-        else if (config_->time_mode == "drip-jitter") 
-        {
-            double base = (n_traders > 1) ? interval / (n_traders - 1) : interval;
-            std::uniform_real_distribution<double> jitterDist(0.0, base);
-            return base + jitterDist(random_generator_);
-        } 
-        else if (config_->time_mode == "drip-poisson") 
-        {
-            double lambda = (n_traders > 0) ? n_traders / interval : 1.0;
-            std::exponential_distribution<double> expDist(lambda);
-            return expDist(random_generator_);
-        } 
-        else 
-        {
-            // Default
-            return interval;
-        }
-    }
-
-    // Continuously injects orders based on the simulation configuration.
-    void injectOrders() {
-
-        //std::string csv_path = "../IBM-310817.csv"; // Path to historical data file
-        //auto offset_events = getOffsetEventList(csv_path); 
-        OrderInjectorConfigPtr injectorConfig = std::static_pointer_cast<OrderInjectorConfig>(config_); // Get injector configuration
-
-        std::vector<std::pair<double, int>> offset_events;
-        if (config_->use_input_file) {
-            try {
-                offset_events = getOffsetEventList(injectorConfig->input_file);
-                std::cout << "Using input file for order schedule: " << std::endl;
-            } catch (const std::exception& ex) {
-                std::cerr << "[OrderInjector] Failed to load input file: " << ex.what() << "\n";
-            }
-        }
-
-
-        std::uniform_int_distribution<> supplyMinDist(injectorConfig->supply_min_low, injectorConfig->supply_min_high);
-        std::uniform_int_distribution<> supplyMaxDist(injectorConfig->supply_max_low, injectorConfig->supply_max_high);
-        std::uniform_int_distribution<> demandMinDist(injectorConfig->demand_min_low, injectorConfig->demand_min_high);
-        std::uniform_int_distribution<> demandMaxDist(injectorConfig->demand_max_low, injectorConfig->demand_max_high);
-
-        int sMin = supplyMinDist(random_generator_);
-        int sMax = supplyMaxDist(random_generator_);
-        int dMin = demandMinDist(random_generator_);
-        int dMax = demandMaxDist(random_generator_);
-        std::string step_mode = injectorConfig->step_mode;
-
-        while (true) {
+            const ScheduledCustomerOrder& order = orders[next_order_];
+            const std::string& address = trader_addresses_[order.trader];
+            auto [it, inserted] = batch_index.try_emplace(address, batches.size());
+            if (inserted)
             {
-                std::unique_lock<std::mutex> lock(mutex_);
-                if (!is_injecting_) {
-                    std::cout << "[OrderInjector] Stopping injection due to TRADING_SESSION_END event.\n";
-                    break;
-                }
+                CustomerOrderBatchMessagePtr batch = std::make_shared<CustomerOrderBatchMessage>();
+                batch->ticker = ticker_;
+                batches.emplace_back(address, batch);
             }
 
-            int offset_value = 0; 
-            double elapsed = getElapsedTime();
-            
-            if (injectorConfig->use_input_file && !offset_events.empty()) 
+            CustomerOrderBatchMessagePtr& batch = batches[it->second].second;
+            batch->orders.push_back({order.client_order_id, order.side, order.quantity, static_cast<double>(order.price), -1.0});
+            if (batch->orders.size() == MAX_BATCH_ORDERS)
             {
-                // Use real-world schedule offset (the total time is normalised to 1.0 here; adjust if needed)
-                double total_time = offset_events.back().first;
-                if (total_time <= 0.0) {
-                    std::cerr << "[OrderInjector] Warning: total_time is zero or negative. Using fallback offset.\n";
-                    total_time = 1.0;  // Assign a default value to avoid division by zero
-                }
-                offset_value = realWorldScheduleOffset(elapsed, total_time, offset_events);
-                std::cout << "[OrderInjector] Real-world offset: " << offset_value << std::endl;
-            } 
-            else if (config_->use_offset) {
-                offset_value = scheduleOffset(elapsed);
-            }
-
-            std::uniform_int_distribution<> ordersCountDist(5, 10);
-            int numOrders = ordersCountDist(random_generator_);
-
-            for (int i = 0; i < numOrders; ++i) {
-                {
-                    std::unique_lock<std::mutex> lock(mutex_);
-                    if (!is_injecting_) {
-                        std::cout << "[OrderInjector] Terminating mid-injection.\n";
-                        return;
-                    }
-                }
-                injectSingleOrder(sMin, sMax, dMin, dMax, offset_value, step_mode);
-                std::this_thread::sleep_for(std::chrono::milliseconds(10)); 
+                sendBatch(address, batch);
+                batch = std::make_shared<CustomerOrderBatchMessage>();
+                batch->ticker = ticker_;
             }
-            double delay = getNextIssueDelay(trader_addresses_.size());
-            std::this_thread::sleep_for(std::chrono::milliseconds(100)); 
         }
-        std::cout << "[OrderInjector] Finished active injection.\n";
-    }
-
-    // Injecting single order into stock exchange. 
-    void injectSingleOrder(int sMin, int sMax, int dMin, int dMax, int offset_value, const std::string &step_mode) {
-
-        Order::Side side = (std::rand() % 2 == 0) ? Order::Side::BID : Order::Side::ASK; // Randomly select side
-        int base_price = 0;
-        if (side == Order::Side::ASK) 
-        {
-            std::uniform_int_distribution<> dist(sMin, sMax);
-            base_price = dist(random_generator_);
-        } else 
+        for (auto& [address, batch] : batches)
         {
-            std::uniform_int_distribution<> dist(dMin, dMax);
-            base_price = dist(random_generator_);
+            if (!batch->orders.empty()) sendBatch(address, batch);
         }
 
-        int final_price = std::clamp(base_price + offset_value, 1, 9999); // Clamp final price between 1 and 9999
-
-        if (step_mode == "jittered") {
-            std::uniform_int_distribution<int> jitterDist(-2, 2);
-            final_price += jitterDist(random_generator_);
-        } 
-        else if (step_mode == "random") 
+        // Sessions outlasting the schedule continue it from the same generator
+        if (next_order_ == orders.size())
         {
-            // Re-pick price randomly from the appropriate range.
-            if (side == Order::Side::ASK) 
-            {
-                std::uniform_int_distribution<> dist(sMin, sMax);
-                final_price = dist(random_generator_);
-            } else 
-            {
-                std::uniform_int_distribution<> dist(dMin, dMax);
-                final_price = dist(random_generator_);
-            }
+            schedule_->discardBefore(next_order_);
+            next_order_ = 0;
+            schedule_->extendTo(schedule_->horizon() + scheduleWindow());
         }
 
-        // Create customer order message 
-        CustomerOrderMessagePtr customer_msg = std::make_shared<CustomerOrderMessage>();// Create limit order message
-        customer_msg->client_order_id = next_client_order_id_++; 
-        customer_msg->ticker = ticker_;
-        customer_msg->side = side;
-        std::uniform_int_distribution<int> dist(10, 50);
-        customer_msg->quantity = dist(random_generator_);
-        customer_msg->price = final_price;
-        customer_msg->priv_value = -1.0; // if you need or want some “private value”
-
-        // Sending orders to traders
-        if (trader_addresses_.empty()) { 
-            std::cerr << "[OrderInjector] No trader addresses configured. Cannot inject.\n";
-            return; 
-        }
-        std::uniform_int_distribution<size_t> pickTraderDist(0, trader_addresses_.size()-1);
-        std::string target_trader = trader_addresses_[pickTraderDist(random_generator_)];
+        double wait = std::max(0.0, schedule_->orders()[next_order_].time - elapsed);
+        timer_.expires_after(std::chrono::duration_cast<SimulationClock::duration>(std::chrono::duration<double>(wait)));
+        timer_.async_wait([this, generation](const boost::system::error_code& error) {
+            if (!error) dispatchDue(generation);
+        });
+    }
 
+    /** Broadcasts a batch of customer orders to the trader node at the given address. */
+    void sendBatch(const std::string& address, CustomerOrderBatchMessagePtr batch)
+    {
         try {
-            sendBroadcast(target_trader, std::static_pointer_cast<Message>(customer_msg));
-            std::cout << "[OrderInjector] Sent customer order to trader (" << target_trader << "): "<< (side == Order::Side::BID ? "BID" : "ASK") << " @ " << final_price << std::endl;
+            sendBroadcast(address, std::static_pointer_cast<Message>(batch));
+            LOG_DEBUG("[OrderInjector] Sent " << batch->orders.size() << " customer orders to trader node (" << address << ")");
         }
         catch (const std::runtime_error &e) {
-            std::cerr << "[OrderInjector] Failed to send customer order to trader (" << target_trader
+            std::cerr << "[OrderInjector] Failed to send customer orders to trader node (" << address
                       << "): " << e.what() << std::endl;
         } 
-
-        //std::cout << "[OrderInjector] Sent customer order to trader (" << target_trader << "): " << (side == Order::Side::BID ? "BID" : "ASK") << " @ " << final_price << std::endl;
     }
 };
 
-#endif
+#endif
\ No newline at end of file
@@ -1,9 +1,13 @@
 #include <algorithm>
-#include <stack>
 #include <filesystem> 
 
 #include "stockexchange.hpp"
 #include "../utilities/syncqueue.hpp"
+#include "../utilities/logger.hpp"
+#include "../utilities/latencyrecorder.hpp"
+#include "../utilities/tracer.hpp"
+#include "../message/symbol_definition_message.hpp"
+#include "../message/symboldirectory.hpp"
 #include "../trade/lobsnapshot.hpp" // Include the LOB Snapshot header file
 #include "../trade/profitsnapshot.hpp" // Include the Profit Snapshot header file
 #include "../message/profitmessage.hpp" // Include the Profit Message header file
@@ -15,8 +19,12 @@
 
 void StockExchange::start()
 { 
-    // Create a Matching Engine Thread
-    matching_engine_thread_ = new std::thread(&StockExchange::runMatchingEngine, this);
+    // Create a Matching Engine Thread for each ticker
+    for (std::unique_ptr<TickerState> const& state : tickers_)
+    {
+        if (state == nullptr) continue;
+        matching_engine_threads_.push_back(new std::thread(&StockExchange::runMatchingEngine, this, state->symbol, matching_engine_threads_.size()));
+    }
     
     // Main thread continues to handle incoming and outgoing communication
     Agent::start();
@@ -24,77 +32,238 @@ void StockExchange::start()
 
 void StockExchange::terminate()
 {
-    if (matching_engine_thread_ != nullptr)
+    for (std::thread* matching_engine_thread : matching_engine_threads_)
     {
-        matching_engine_thread_->join();
-        delete(matching_engine_thread_);
+        matching_engine_thread->join();
+        delete(matching_engine_thread);
     }
+    matching_engine_threads_.clear();
 
     if (trading_window_thread_ != nullptr)
     {
         trading_window_thread_->join();
         delete(trading_window_thread_);
     }
+
+    // Write out the rest of the message tape, which compressed tapes need to be complete
+    std::unique_lock<std::mutex> lock(message_tape_mutex_);
+    message_tape_->stop();
+}
+
+void StockExchange::placeThreads(const std::string& cpu_affinity, size_t matching_threads)
+{
+    ThreadPlacement::instance().configure(cpu_affinity, matching_threads);
+    placeIOThreads();
 }
 
-void StockExchange::runMatchingEngine()
+void StockExchange::runMatchingEngine(uint16_t symbol, size_t index)
 {
-    // Wait until trading window opens
+    ThreadPlacement::instance().pinCurrent(ThreadRole::MATCHING, index);
+    TickerState& state = *tickers_[symbol];
+    const std::string& ticker = state.ticker;
+    MPSCQueue<MessagePtr>& msg_queue = state.inbox;
+    std::atomic<int>& work_held = state.work_held;
+    MatchingStats& stats = state.stats;
+    OrderBookPtr order_book = state.order_book;
+    std::vector<MessagePtr> batch;
+    batch.reserve(MAX_MATCHING_BATCH);
+    std::vector<std::pair<unsigned int, size_t>> turns;
+    std::vector<MessagePtr> interleaved;
+    if (fair_intake_)
+    {
+        turns.reserve(MAX_MATCHING_BATCH);
+        interleaved.reserve(MAX_MATCHING_BATCH);
+    }
+
+    // Wait until trading window opens, or the session is ended before it does
     std::unique_lock<std::mutex> trading_window_lock(trading_window_mutex_);
-    trading_window_cv_.wait(trading_window_lock, [this]{ return trading_window_open_;});
+    trading_window_cv_.wait(trading_window_lock, [this]{ return session_state_.load(std::memory_order_acquire) != TradingSessionState::PRE_OPEN; });
+    trading_window_lock.unlock();
 
-    // Atomically check if trading window is open, and if not break loop
-    while (trading_window_open_)
+    // Schedule the first uncross when running periodic call auctions
+    bool call_auction = (matching_mode_ == MatchingMode::CALL_AUCTION);
+    std::chrono::milliseconds auction_interval {auction_interval_};
+    std::chrono::steady_clock::time_point next_uncross = std::chrono::steady_clock::now() + auction_interval;
+    int batch_size = 0;
+
+    // Keep matching while the trading window is open
+    while (session_state_.load(std::memory_order_acquire) == TradingSessionState::OPEN)
     {
-        trading_window_lock.unlock();
-        // std::cout << "Matching engine unlocked" << "\n";
-        
-        // Wait until new message is present
-        MessagePtr msg = msg_queue_.pop();
-        if (msg != nullptr)
-        {
-            // Pattern match the message type
-            switch (msg->type) {
-                case MessageType::MARKET_ORDER:
-                {
-                    onMarketOrder(std::dynamic_pointer_cast<MarketOrderMessage>(msg));
-                    break;
-                }
-                case MessageType::LIMIT_ORDER:
-                {
-                    onLimitOrder(std::dynamic_pointer_cast<LimitOrderMessage>(msg));
-                    break;
-                }
-                case MessageType::CANCEL_ORDER:
-                {
-                    onCancelOrder(std::dynamic_pointer_cast<CancelOrderMessage>(msg));
-                    break;
-                }
-                default:
-                {
-                    std::cout << "Exchange received unknown message type" << "\n";
-                }
+        // Wait until new messages are present, or until the next uncross or market data update is due
+        std::optional<std::chrono::steady_clock::time_point> deadline = nextMarketDataDue(ticker);
+        if (call_auction && (!deadline.has_value() || next_uncross < deadline.value()))
+        {
+            deadline = next_uncross;
+        }
+        if (SimulationClock::isVirtual())
+        {
+            deadline = std::nullopt;
+        }
+        batch.clear();
+        size_t count = deadline.has_value() 
+            ? msg_queue.popBatchUntil(deadline.value(), batch, MAX_MATCHING_BATCH) 
+            : msg_queue.popBatch(batch, MAX_MATCHING_BATCH);
+        if (fair_intake_ && count > 1)
+        {
+            interleaveBySender(batch, turns, interleaved);
+        }
+
+        for (MessagePtr const& msg : batch)
+        {
+            // Same clock as the message timestamps
+            unsigned long long timestamp_dequeued = SimulationClock::nowNanos();
+            if (msg->trace_enqueued != 0)
+            {
+                Tracer::instance().record(TraceStage::QUEUE_WAIT, msg->trace_enqueued, Tracer::now(), msg->type);
             }
 
+            {
+                TraceSpan span {TraceStage::MATCH, msg->type};
+                processMessage(msg);
+            }
             msg->markProcessed();
+            LatencyRecorder::instance().record(LatencyStage::QUEUE, msg->type, msg->sender_id, msg->timestamp_received, timestamp_dequeued);
+            LatencyRecorder::instance().record(LatencyStage::PROCESSING, msg->type, msg->sender_id, timestamp_dequeued, msg->timestamp_processed);
             addMessageToTape(msg);
+
+            // Send the market data changes of this message, or of the conflation window, as one update
+            publishDueMarketData(ticker);
+
+            // Only the matching engine takes work off the count, so it cannot drop below zero between the check and the decrement
+            if (work_held.load(std::memory_order_acquire) > 0)
+            {
+                work_held.fetch_sub(1, std::memory_order_acq_rel);
+                SimulationClock::endWork();
+            }
         }
-        
-        // std::cout << "Matching engine attempting to lock" << "\n";
-        trading_window_lock.lock();
-        // std::cout << "Matching engine locked" << "\n";
-    }
 
-    std::cout << "Matching Engine stopping." << "\n";
+        if (count > 0)
+        {
+            stats.matched.fetch_add(count, std::memory_order_relaxed);
+            stats.bids.store(order_book->bidsCount(), std::memory_order_relaxed);
+            stats.asks.store(order_book->asksCount(), std::memory_order_relaxed);
+        }
 
-    trading_window_lock.unlock();
-    std::cout << "Stopped running matching engine" << "\n";
+        if (call_auction)
+        {
+            batch_size += count;
+        }
+        if (call_auction && std::chrono::steady_clock::now() >= next_uncross)
+        {
+            if (batch_size > 0)
+            {
+                runCallAuction(ticker);
+                batch_size = 0;
+            }
+            next_uncross += auction_interval;
+        }
+
+        // Send updates that fell due while waiting, and the outcome of any uncross
+        publishDueMarketData(ticker);
+    }
+
+    LOG_INFO("Matching Engine for " << ticker << " stopping.");
+    LOG_INFO("Stopped running matching engine");
     // trading_window_cv_.notify_all();
 };
 
+void StockExchange::processMessage(const MessagePtr& msg)
+{
+    // Pattern match the message type
+    switch (msg->type) {
+        case MessageType::MARKET_ORDER:
+        {
+            onMarketOrder(std::static_pointer_cast<MarketOrderMessage>(msg));
+            break;
+        }
+        case MessageType::LIMIT_ORDER:
+        {
+            onLimitOrder(std::static_pointer_cast<LimitOrderMessage>(msg));
+            break;
+        }
+        case MessageType::CANCEL_ORDER:
+        {
+            onCancelOrder(std::static_pointer_cast<CancelOrderMessage>(msg));
+            break;
+        }
+        case MessageType::AMEND_ORDER:
+        {
+            onAmendOrder(std::static_pointer_cast<AmendOrderMessage>(msg));
+            break;
+        }
+        case MessageType::BULK_ORDER:
+        {
+            onBulkOrder(std::static_pointer_cast<BulkOrderMessage>(msg));
+            break;
+        }
+        case MessageType::MARKET_DATA_REQUEST:
+        {
+            onMarketDataRequest(std::static_pointer_cast<MarketDataRequestMessage>(msg));
+            break;
+        }
+        default:
+        {
+            LOG_WARN("Exchange received unknown message type");
+        }
+    }
+}
+
+std::vector<TradePtr> StockExchange::replay(const std::vector<MessagePtr>& messages)
+{
+    // Trades restored from a checkpoint were not executed by the replay
+    std::unordered_map<std::string, size_t> restored_trades;
+    for (auto const& [ticker, history] : trade_histories_)
+    {
+        restored_trades[ticker] = history->size();
+    }
+
+    trading_session_start_time_ = SimulationClock::now();
+    session_state_.store(TradingSessionState::OPEN, std::memory_order_release);
+    for (MessagePtr const& msg : messages)
+    {
+        std::optional<uint16_t> symbol = assignSymbol(*msg);
+        if (!symbol.has_value())
+        {
+            continue;
+        }
+
+        processMessage(msg);
+        msg->markProcessed();
+        addMessageToTape(msg);
+        publishDueMarketData(tickers_[symbol.value()]->ticker);
+    }
+    session_state_.store(TradingSessionState::CLOSED, std::memory_order_release);
+
+    for (auto const& [ticker, writer] : trade_tapes_)
+    {
+        writer->stop();
+    }
+    for (auto const& [ticker, writer] : market_data_feeds_)
+    {
+        writer->stop();
+    }
+    for (auto const& [ticker, writer] : lob_snapshot_)
+    {
+        writer->stop();
+    }
+
+    std::vector<TradePtr> trades;
+    for (auto const& [ticker, history] : trade_histories_)
+    {
+        std::vector<TradePtr> ticker_trades = history->all();
+        trades.insert(trades.end(), ticker_trades.begin() + restored_trades.at(ticker), ticker_trades.end());
+    }
+    std::sort(trades.begin(), trades.end(), [](const TradePtr& a, const TradePtr& b) { return a->id < b->id; });
+    return trades;
+}
+
 void StockExchange::onLimitOrder(LimitOrderMessagePtr msg)
 {
-    LimitOrderPtr order = order_factory_.createLimitOrder(msg);
+    processLimitOrder(order_factory_.createLimitOrder(msg, getOrderBookFor(msg->symbol)->tickSize()));
+};
+
+void StockExchange::processLimitOrder(LimitOrderPtr order)
+{
 
     // Check if the incoming order crosses the spread 
     // If yes, grab the current LOB data, time etc. 
@@ -102,6 +271,20 @@ void StockExchange::onLimitOrder(LimitOrderMessagePtr msg)
     // Write that snapshot to CSV 
     // Then proceed with normal matching
 
+    // In a call auction every order joins the batch; IOC and FOK remainders are cancelled after the uncross
+    if (matching_mode_ == MatchingMode::CALL_AUCTION)
+    {
+        getOrderBookFor(order->symbol)->addOrder(order);
+        if (order->time_in_force != Order::TimeInForce::GTC)
+        {
+            auction_ioc_orders_.at(order->ticker).push_back(order);
+        }
+        ExecutionReportMessagePtr report = ExecutionReportMessage::createFromOrder(order);
+        report->sender_id = this->agent_id;
+        sendExecutionReport(order->sender_id, report);
+        return;
+    }
+
     // Check if it crosses the spread 
     bool crosses = crossesSpread(order); 
 
@@ -119,11 +302,11 @@ void StockExchange::onLimitOrder(LimitOrderMessagePtr msg)
     }
     else
     {
-        getOrderBookFor(order->ticker)->addOrder(order);
+        getOrderBookFor(order->symbol)->addOrder(order);
         ExecutionReportMessagePtr report = ExecutionReportMessage::createFromOrder(order);
         report->sender_id = this->agent_id;
-        sendExecutionReport(std::to_string(order->sender_id), report);
-        publishMarketData(msg->ticker, msg->side);
+        sendExecutionReport(order->sender_id, report);
+        publishMarketData(order->ticker, order->side);
     }    
 };
 
@@ -131,34 +314,46 @@ void StockExchange::onMarketOrder(MarketOrderMessagePtr msg)
 {
     MarketOrderPtr order = order_factory_.createMarketOrder(msg);
 
-    if (msg->side == Order::Side::BID)
+    // In a call auction market orders execute against the book left after the next uncross
+    if (matching_mode_ == MatchingMode::CALL_AUCTION)
+    {
+        auction_market_orders_.at(order->ticker).push_back(order);
+        return;
+    }
+
+    matchMarketOrder(order);
+};
+
+void StockExchange::matchMarketOrder(MarketOrderPtr order, bool publish)
+{
+    if (order->side == Order::Side::BID)
     {
-        std::optional<LimitOrderPtr> best_ask = getOrderBookFor(msg->ticker)->bestAsk();
+        std::optional<LimitOrderPtr> best_ask = getOrderBookFor(order->symbol)->bestAsk();
 
         while (best_ask.has_value() && !order->isFilled())
         {
-            getOrderBookFor(msg->ticker)->popBestAsk();
+            getOrderBookFor(order->symbol)->popBestAsk();
 
-            TradePtr trade = trade_factory_.createFromLimitAndMarketOrders(best_ask.value(), order);
+            TradePtr trade = trade_factory_.createFromLimitAndMarketOrders(best_ask.value(), order, getOrderBookFor(order->symbol)->tickSize());
             addTradeToTape(trade);
-            executeTrade(best_ask.value(), order, trade);
+            executeTrade(best_ask.value(), order, trade, publish);
 
-            best_ask = getOrderBookFor(order->ticker)->bestAsk();
+            best_ask = getOrderBookFor(order->symbol)->bestAsk();
         }
     }
     else
     {
-        std::optional<LimitOrderPtr> best_bid = getOrderBookFor(msg->ticker)->bestBid();
+        std::optional<LimitOrderPtr> best_bid = getOrderBookFor(order->symbol)->bestBid();
 
         while (best_bid.has_value() && !order->isFilled())
         {
-            getOrderBookFor(msg->ticker)->popBestBid();
+            getOrderBookFor(order->symbol)->popBestBid();
 
-            TradePtr trade = trade_factory_.createFromLimitAndMarketOrders(best_bid.value(), order);
+            TradePtr trade = trade_factory_.createFromLimitAndMarketOrders(best_bid.value(), order, getOrderBookFor(order->symbol)->tickSize());
             addTradeToTape(trade);
-            executeTrade(best_bid.value(), order, trade);
+            executeTrade(best_bid.value(), order, trade, publish);
 
-            best_bid = getOrderBookFor(order->ticker)->bestBid();
+            best_bid = getOrderBookFor(order->symbol)->bestBid();
         }
     }
 
@@ -171,7 +366,12 @@ void StockExchange::onMarketOrder(MarketOrderMessagePtr msg)
 
 void StockExchange::onCancelOrder(CancelOrderMessagePtr msg)
 {
-    std::optional<LimitOrderPtr> order = getOrderBookFor(msg->ticker)->removeOrder(msg->order_id, msg->side);
+    processCancel(msg->symbol, msg->order_id, msg->side, msg->sender_id);
+};
+
+void StockExchange::processCancel(uint16_t symbol, int order_id, Order::Side side, int sender_id)
+{
+    std::optional<LimitOrderPtr> order = getOrderBookFor(symbol)->removeOrder(order_id, side);
     
     if (order.has_value()) 
     {
@@ -180,28 +380,135 @@ void StockExchange::onCancelOrder(CancelOrderMessagePtr msg)
     else
     {
         // Send a cancel reject message if order does not exist in the order book
-        CancelRejectMessagePtr reject = std::make_shared<CancelRejectMessage>();
-        reject->sender_id = this->agent_id;
-        reject->order_id = msg->order_id;
+        sendCancelReject(tickers_[symbol]->ticker, sender_id, order_id);
+    }
+};
+
+void StockExchange::onAmendOrder(AmendOrderMessagePtr msg)
+{
+    processAmend(msg->symbol, msg->order_id, msg->side, msg->price, msg->quantity, msg->sender_id);
+};
+
+void StockExchange::processAmend(uint16_t symbol, int order_id, Order::Side side, double price, int quantity, int sender_id)
+{
+    if (quantity <= 0)
+    {
+        processCancel(symbol, order_id, side, sender_id);
+        return;
+    }
+
+    const std::string& ticker = tickers_[symbol]->ticker;
+    const OrderBookPtr& order_book = getOrderBookFor(symbol);
+    int price_ticks = order_book->tickSize().toTicks(price);
+
+    // In a call auction orders rest until the uncross, so they are amended in place whatever the price
+    if (matching_mode_ == MatchingMode::CALL_AUCTION || !crossesSpread(symbol, side, price_ticks))
+    {
+        std::optional<LimitOrderPtr> order = order_book->amendOrder(order_id, side, price_ticks, quantity);
+        if (!order.has_value())
+        {
+            sendCancelReject(ticker, sender_id, order_id);
+            return;
+        }
+        ExecutionReportMessagePtr report = ExecutionReportMessage::createFromOrder(order.value());
+        report->sender_id = this->agent_id;
+        sendExecutionReport(sender_id, report);
+        publishMarketData(ticker, side);
+        return;
+    }
 
-        sendMessageTo(std::to_string(msg->sender_id), std::dynamic_pointer_cast<Message>(reject), true);
+    // An amend into the opposite side trades like a new order, losing its priority
+    std::optional<LimitOrderPtr> resting = order_book->removeOrder(order_id, side);
+    if (!resting.has_value())
+    {
+        sendCancelReject(ticker, sender_id, order_id);
+        return;
     }
+    LimitOrderPtr order = std::static_pointer_cast<LimitOrder>(resting.value()->clone());
+    order->requeue();
+    order->price = price_ticks;
+    order->remaining_quantity = quantity;
+    processLimitOrder(order);
 };
 
+void StockExchange::onBulkOrder(BulkOrderMessagePtr msg)
+{
+    // Reports for the sender are collected until the whole message is handled
+    BulkOrderAck& collecting = bulk_order_acks_.at(msg->ticker);
+    collecting.sender_id = msg->sender_id;
+    collecting.ack = std::make_shared<BulkOrderAckMessage>();
+    collecting.ack->reports.reserve(msg->orders.size());
+
+    for (BulkOrderMessage::Cancel const& cancel : msg->cancels)
+    {
+        processCancel(msg->symbol, cancel.order_id, cancel.side, msg->sender_id);
+    }
+    for (BulkOrderMessage::Amend const& amend : msg->amends)
+    {
+        processAmend(msg->symbol, amend.order_id, amend.side, amend.price, amend.quantity, msg->sender_id);
+    }
+
+    // Orders are created from one message holding the fields they share with the bulk order
+    LimitOrderMessagePtr entry = std::make_shared<LimitOrderMessage>();
+    entry->sender_id = msg->sender_id;
+    entry->agent_name = msg->agent_name;
+    entry->timestamp_sent = msg->timestamp_sent;
+    entry->timestamp_received = msg->timestamp_received;
+    entry->ticker = msg->ticker;
+    entry->symbol = msg->symbol;
+    const TickSize& tick_size = getOrderBookFor(msg->symbol)->tickSize();
+    for (BulkOrderMessage::NewOrder const& order : msg->orders)
+    {
+        entry->client_order_id = order.client_order_id;
+        entry->side = order.side;
+        entry->time_in_force = order.time_in_force;
+        entry->quantity = order.quantity;
+        entry->price = order.price;
+        entry->priv_value = order.priv_value;
+        processLimitOrder(order_factory_.createLimitOrder(entry, tick_size));
+    }
+
+    BulkOrderAckMessagePtr ack = std::move(collecting.ack);
+    collecting = BulkOrderAck{};
+    ack->sender_id = this->agent_id;
+    if (replaying_) return;
+    sendMessageTo(msg->sender_id, std::static_pointer_cast<Message>(ack), true);
+}
+
+void StockExchange::onMarketDataRequest(MarketDataRequestMessagePtr msg)
+{
+    MarketDataPtr data = last_market_data_.at(msg->ticker);
+    if (data == nullptr) return;
+
+    LOG_DEBUG("Resending " << msg->ticker << " market data to agent " << msg->sender_id << " from sequence " 
+        << msg->last_sequence << " to " << market_data_sequence_.at(msg->ticker));
+
+    // The snapshot carries the current sequence number, so the subscriber resumes with the next UDP update
+    MarketDataMessagePtr snapshot = std::make_shared<MarketDataMessage>();
+    snapshot->data = data;
+    snapshot->sequence = market_data_sequence_.at(msg->ticker);
+    sendMessageTo(msg->sender_id, std::static_pointer_cast<Message>(snapshot), true);
+}
+
 bool StockExchange::crossesSpread(LimitOrderPtr order)
 {
-    if (order->side == Order::Side::BID)
+    return crossesSpread(order->symbol, order->side, order->price);
+};
+
+bool StockExchange::crossesSpread(uint16_t symbol, Order::Side side, int price)
+{
+    if (side == Order::Side::BID)
     {
-        std::optional<LimitOrderPtr> best_ask = getOrderBookFor(order->ticker)->bestAsk();
-        if (best_ask.has_value() && order->price >= best_ask.value()->price)
+        std::optional<LimitOrderPtr> best_ask = getOrderBookFor(symbol)->bestAsk();
+        if (best_ask.has_value() && price >= best_ask.value()->price)
         {
             return true;
         }
     }
     else
     {
-        std::optional<LimitOrderPtr> best_bid = getOrderBookFor(order->ticker)->bestBid();
-        if (best_bid.has_value() && order->price <= best_bid.value()->price)
+        std::optional<LimitOrderPtr> best_bid = getOrderBookFor(symbol)->bestBid();
+        if (best_bid.has_value() && price <= best_bid.value()->price)
         {
             return true;
         }
@@ -212,38 +519,38 @@ bool StockExchange::crossesSpread(LimitOrderPtr order)
 void StockExchange::matchOrder(LimitOrderPtr order)
 {
     if (order->side == Order::Side::BID) {
-        std::optional<LimitOrderPtr> best_ask = getOrderBookFor(order->ticker)->bestAsk();
+        std::optional<LimitOrderPtr> best_ask = getOrderBookFor(order->symbol)->bestAsk();
         
         while (best_ask.has_value() && !order->isFilled() && order->price >= best_ask.value()->price)
         {
-            getOrderBookFor(order->ticker)->popBestAsk();
+            getOrderBookFor(order->symbol)->popBestAsk();
 
-            TradePtr trade = trade_factory_.createFromLimitOrders(best_ask.value(), order);
+            TradePtr trade = trade_factory_.createFromLimitOrders(best_ask.value(), order, getOrderBookFor(order->symbol)->tickSize());
             addTradeToTape(trade);
             executeTrade(best_ask.value(), order, trade);
 
-            best_ask = getOrderBookFor(order->ticker)->bestAsk();
+            best_ask = getOrderBookFor(order->symbol)->bestAsk();
         }
     }
     else
     {
-        std::optional<LimitOrderPtr> best_bid = getOrderBookFor(order->ticker)->bestBid();
+        std::optional<LimitOrderPtr> best_bid = getOrderBookFor(order->symbol)->bestBid();
 
         while (best_bid.has_value() && !order->isFilled() && order->price <= best_bid.value()->price)
         {
-            getOrderBookFor(order->ticker)->popBestBid();
+            getOrderBookFor(order->symbol)->popBestBid();
 
-            TradePtr trade = trade_factory_.createFromLimitOrders(best_bid.value(), order);
+            TradePtr trade = trade_factory_.createFromLimitOrders(best_bid.value(), order, getOrderBookFor(order->symbol)->tickSize());
             addTradeToTape(trade);
             executeTrade(best_bid.value(), order, trade);
 
-            best_bid = getOrderBookFor(order->ticker)->bestBid();
+            best_bid = getOrderBookFor(order->symbol)->bestBid();
         }
     }
 
     // If the incoming order is Good-Til-Cancelled (GTC) and not fully executed, add it to the order book
     if (!order->isFilled() && order->time_in_force == Order::TimeInForce::GTC){
-        getOrderBookFor(order->ticker)->addOrder(order);
+        getOrderBookFor(order->symbol)->addOrder(order);
     }
     // Cancel the remainder of the order otherwise
     else if (order->time_in_force == Order::TimeInForce::IOC)
@@ -254,60 +561,148 @@ void StockExchange::matchOrder(LimitOrderPtr order)
 
 void StockExchange::matchOrderInFull(LimitOrderPtr order)
 {
-    int temp_rem_quantity = order->remaining_quantity;
-    std::stack<LimitOrderPtr> stack;
+    // Walk the opposite side of the book without modifying it to check if the order can be filled in full
+    int available_quantity = 0;
+    Order::Side opposite_side = (order->side == Order::Side::BID) ? Order::Side::ASK : Order::Side::BID;
+    getOrderBookFor(order->symbol)->walkDepth(opposite_side, [&](int price, int quantity, int count) {
+        bool crosses = (order->side == Order::Side::BID) ? order->price >= price : order->price <= price;
+        if (!crosses) return false;
+        available_quantity += quantity;
+        return available_quantity < order->remaining_quantity;
+    });
 
-    if (order->side == Order::Side::BID) {
-        std::optional<LimitOrderPtr> best_ask = getOrderBookFor(order->ticker)->bestAsk();
-        while (best_ask.has_value() && temp_rem_quantity > 0 && order->price >= best_ask.value()->price)
-        {
-            getOrderBookFor(order->ticker)->popBestAsk();
-            stack.push(best_ask.value());
-            temp_rem_quantity -= std::min(temp_rem_quantity, best_ask.value()->remaining_quantity);
-            best_ask = getOrderBookFor(order->ticker)->bestAsk();
-        }
+    // Cancel the order if it cannot be executed in full
+    if (available_quantity < order->remaining_quantity)
+    {
+        cancelOrder(order);
     }
+    // Execute the order in full in a single pass
     else
     {
-        std::optional<LimitOrderPtr> best_bid = getOrderBookFor(order->ticker)->bestBid();
-        while (best_bid.has_value() && temp_rem_quantity > 0 && order->price <= best_bid.value()->price)
+        matchOrder(order);
+    }
+};
+
+void StockExchange::runCallAuction(std::string_view ticker)
+{
+    OrderBookPtr order_book = getOrderBookFor(ticker);
+    Order::Side last_aggressing_side = Order::Side::BID;
+
+    // Uncross all crossing orders at the clearing price in price-time priority
+    std::optional<int> clearing_price = calculateClearingPrice(order_book);
+    if (clearing_price.has_value())
+    {
+        int price = clearing_price.value();
+        std::optional<LimitOrderPtr> best_bid = order_book->bestBid();
+        std::optional<LimitOrderPtr> best_ask = order_book->bestAsk();
+
+        while (best_bid.has_value() && best_ask.has_value() && best_bid.value()->price >= price && best_ask.value()->price <= price)
         {
-            getOrderBookFor(order->ticker)->popBestBid();
+            order_book->popBestBid();
+            order_book->popBestAsk();
+
+            // The earlier order of the pair is treated as resting, the later as aggressing
+            bool bid_rests = best_bid.value()->timestamp_created <= best_ask.value()->timestamp_created;
+            LimitOrderPtr resting_order = bid_rests ? best_bid.value() : best_ask.value();
+            LimitOrderPtr aggressing_order = bid_rests ? best_ask.value() : best_bid.value();
+
+            TradePtr trade = trade_factory_.createFromLimitOrders(resting_order, aggressing_order, order_book->tickSize());
+            trade->price = order_book->tickSize().toPrice(price);
+            addTradeToTape(trade);
+            executeTrade(resting_order, aggressing_order, trade, false);
 
-            stack.push(best_bid.value());
-            temp_rem_quantity -= std::min(temp_rem_quantity, best_bid.value()->remaining_quantity);
+            // Return the unfilled remainder of the aggressing order to the book
+            if (aggressing_order->remaining_quantity > 0)
+            {
+                order_book->addOrder(aggressing_order);
+            }
+            last_aggressing_side = aggressing_order->side;
 
-            best_bid = getOrderBookFor(order->ticker)->bestBid();
+            best_bid = order_book->bestBid();
+            best_ask = order_book->bestAsk();
         }
     }
 
-    // Cancel the order if not executed in full and add all matching orders back to the order book
-    if (temp_rem_quantity > 0)
+    // Cancel whatever is left of the Immediate-or-Cancel and Fill-or-Kill orders of this batch
+    for (LimitOrderPtr order : auction_ioc_orders_.at(std::string{ticker}))
     {
-        // Add all matching orders back to the order book
-        while (!stack.empty())
+        if (order_book->removeOrder(order->id, order->side).has_value())
         {
-            getOrderBookFor(order->ticker)->addOrder(stack.top());
-            stack.pop();
+            cancelOrder(order);
         }
-        
-        // Cancel the incoming order
-        cancelOrder(order);
     }
-    // Execute the order in full
-    else
+    auction_ioc_orders_.at(std::string{ticker}).clear();
+
+    // Execute the market orders of this batch against the uncrossed book
+    for (MarketOrderPtr order : auction_market_orders_.at(std::string{ticker}))
     {
-        while (!stack.empty())
-        {
-            LimitOrderPtr matched_order = stack.top();
-            stack.pop();
+        matchMarketOrder(order, false);
+        last_aggressing_side = order->side;
+    }
+    auction_market_orders_.at(std::string{ticker}).clear();
 
-            // Execute trade
-            TradePtr trade = trade_factory_.createFromLimitOrders(matched_order, order);
-            addTradeToTape(trade);
-            executeTrade(matched_order, order, trade);
+    publishMarketData(ticker, last_aggressing_side);
+};
+
+std::optional<int> StockExchange::calculateClearingPrice(OrderBookPtr order_book)
+{
+    std::optional<LimitOrderPtr> best_bid = order_book->bestBid();
+    std::optional<LimitOrderPtr> best_ask = order_book->bestAsk();
+    if (!best_bid.has_value() || !best_ask.has_value() || best_bid.value()->price < best_ask.value()->price)
+    {
+        return std::nullopt;
+    }
+
+    // Only the levels inside the crossed region can trade
+    int highest_bid = best_bid.value()->price;
+    int lowest_ask = best_ask.value()->price;
+    std::vector<std::pair<int, int>> bid_levels;
+    std::vector<std::pair<int, int>> ask_levels;
+    order_book->walkDepth(Order::Side::BID, [&](int price, int quantity, int count) {
+        if (price < lowest_ask) return false;
+        bid_levels.push_back({price, quantity});
+        return true;
+    });
+    order_book->walkDepth(Order::Side::ASK, [&](int price, int quantity, int count) {
+        if (price > highest_bid) return false;
+        ask_levels.push_back({price, quantity});
+        return true;
+    });
+
+    // Pick the price maximising executed volume, then minimising the surplus left on one side
+    int best_volume = -1;
+    int best_surplus = 0;
+    int lowest_price = 0;
+    int highest_price = 0;
+    std::vector<int> candidates;
+    for (auto const& [price, quantity] : bid_levels) candidates.push_back(price);
+    for (auto const& [price, quantity] : ask_levels) candidates.push_back(price);
+
+    for (int price : candidates)
+    {
+        int demand = 0;
+        int supply = 0;
+        for (auto const& [bid_price, quantity] : bid_levels) if (bid_price >= price) demand += quantity;
+        for (auto const& [ask_price, quantity] : ask_levels) if (ask_price <= price) supply += quantity;
+
+        int volume = std::min(demand, supply);
+        int surplus = std::abs(demand - supply);
+        if (volume > best_volume || (volume == best_volume && surplus < best_surplus))
+        {
+            best_volume = volume;
+            best_surplus = surplus;
+            lowest_price = price;
+            highest_price = price;
+        }
+        else if (volume == best_volume && surplus == best_surplus)
+        {
+            lowest_price = std::min(lowest_price, price);
+            highest_price = std::max(highest_price, price);
         }
     }
+
+    // Settle ties at the middle of the equally good prices
+    return lowest_price + (highest_price - lowest_price) / 2;
 };
 
 void StockExchange::cancelOrder(OrderPtr order)
@@ -315,24 +710,27 @@ void StockExchange::cancelOrder(OrderPtr order)
     order->setStatus(Order::Status::CANCELLED);
     ExecutionReportMessagePtr report = ExecutionReportMessage::createFromOrder(order);
     report->sender_id = this->agent_id;
-    sendExecutionReport(std::to_string(order->sender_id), report);
+    sendExecutionReport(order->sender_id, report);
 }
 
-void StockExchange::executeTrade(LimitOrderPtr resting_order, OrderPtr aggressing_order, TradePtr trade)
+void StockExchange::executeTrade(LimitOrderPtr resting_order, OrderPtr aggressing_order, TradePtr trade, bool publish)
 {   
+    TraceSpan span {TraceStage::EXECUTE_TRADE};
+
     // Elapsed time since trading session start in seconds. 
-    auto now = std::chrono::high_resolution_clock::now();
+    SimulationClock::duration now = SimulationClock::now();
     double elapsed_time = std::chrono::duration<double, std::milli>(now - trading_session_start_time_).count();
 
     // Time difference between the current trade and the last trade
     double time_diff = 0.0;
-    if (last_trade_time_.find(resting_order->ticker) != last_trade_time_.end()) {
-        time_diff = std::chrono::duration<double, std::milli>(now - last_trade_time_[resting_order->ticker]).count();
+    std::optional<SimulationClock::duration>& last_trade_time = last_trade_time_.at(resting_order->ticker);
+    if (last_trade_time.has_value()) {
+        time_diff = std::chrono::duration<double, std::milli>(now - last_trade_time.value()).count();
     } else {
         time_diff = trade->price;
     }
     // Update last trade timestamp
-    last_trade_time_[resting_order->ticker] = now; 
+    last_trade_time = now; 
 
     // Calculate trade profits
     if (aggressing_order->side == Order::Side::BID) { // Buyer = aggressor, Seller = resting order
@@ -348,7 +746,7 @@ void StockExchange::executeTrade(LimitOrderPtr resting_order, OrderPtr aggressin
     double aggressing_profit = 0.0;
 
     // Cast aggressing_order to LimitOrder if needed for priv_value access
-    LimitOrderPtr aggressing_limit_order = std::dynamic_pointer_cast<LimitOrder>(aggressing_order);
+    LimitOrderPtr aggressing_limit_order = (aggressing_order->type == Order::Type::LIMIT) ? std::static_pointer_cast<LimitOrder>(aggressing_order) : nullptr;
     
     // Calculate resting order profit
     if (resting_order->side == Order::Side::BID) {
@@ -377,34 +775,30 @@ void StockExchange::executeTrade(LimitOrderPtr resting_order, OrderPtr aggressin
     }
     
     // Update profit tracking directly in the exchange
-    std::string resting_name = agent_names_[resting_order->sender_id];
-    std::string aggressing_name = agent_names_[aggressing_order->sender_id];
-    
-    // Update profits by trader name
-    agent_profits_by_name_[resting_name] += resting_profit;
-    agent_profits_by_name_[aggressing_name] += aggressing_profit;
+    profit_ledger_.record(resting_order->sender_id, resting_profit);
+    profit_ledger_.record(aggressing_order->sender_id, aggressing_profit);
 
     // Decrement the quantity of the orders by quantity traded
-    getOrderBookFor(resting_order->ticker)->updateOrderWithTrade(resting_order, trade);
-    getOrderBookFor(resting_order->ticker)->updateOrderWithTrade(aggressing_order, trade);
+    getOrderBookFor(resting_order->symbol)->updateOrderWithTrade(resting_order, trade);
+    getOrderBookFor(resting_order->symbol)->updateOrderWithTrade(aggressing_order, trade);
 
     // Re-insert the resting order if it has not been fully filled
     if (resting_order->remaining_quantity > 0) {
-        getOrderBookFor(resting_order->ticker)->addOrder(resting_order);
+        getOrderBookFor(resting_order->symbol)->addOrder(resting_order);
     }
 
     // Log the trade in the order book
-    getOrderBookFor(resting_order->ticker)->logTrade(trade);
+    getOrderBookFor(resting_order->symbol)->logTrade(trade);
 
     // Send execution reports to the traders
     ExecutionReportMessagePtr resting_report = ExecutionReportMessage::createFromTrade(resting_order, trade);
     resting_report->sender_id = this->agent_id;
     ExecutionReportMessagePtr aggressing_report = ExecutionReportMessage::createFromTrade(aggressing_order, trade);
     aggressing_report->sender_id = this->agent_id;
-    sendExecutionReport(std::to_string(resting_order->sender_id), resting_report);
-    sendExecutionReport(std::to_string(aggressing_order->sender_id), aggressing_report);
+    sendExecutionReport(resting_order->sender_id, resting_report);
+    sendExecutionReport(aggressing_order->sender_id, aggressing_report);
 
-    MarketDataPtr data = getOrderBookFor(resting_order->ticker)->getLiveMarketData(aggressing_order->side);
+    MarketDataPtr data = getOrderBookFor(resting_order->symbol)->getLiveMarketData(aggressing_order->side);
     if (data) 
     {
         double p_equilibrium = calculatePEquilibrium(resting_order->ticker);
@@ -414,7 +808,7 @@ void StockExchange::executeTrade(LimitOrderPtr resting_order, OrderPtr aggressin
         // Limit price from the aggressing order (the one that initiated the trade) 
         double limit_price = 0.0; 
         if (aggressing_limit_order) {
-            limit_price = aggressing_limit_order->price;
+            limit_price = getOrderBookFor(resting_order->symbol)->tickSize().toPrice(aggressing_limit_order->price);
         } else {
             // For market orders, we use the trade price as the limit price
             limit_price = trade->price;
@@ -441,14 +835,40 @@ void StockExchange::executeTrade(LimitOrderPtr resting_order, OrderPtr aggressin
         addLOBSnapshot(lob_data);
     } 
 
-    publishMarketData(resting_order->ticker, aggressing_order->side);
+    if (publish)
+    {
+        publishMarketData(resting_order->ticker, aggressing_order->side);
+    }
 
 }
 
 
-void StockExchange::sendExecutionReport(std::string_view trader, ExecutionReportMessagePtr msg)
+void StockExchange::sendExecutionReport(int trader_id, ExecutionReportMessagePtr msg)
 {
-    sendMessageTo(trader, std::dynamic_pointer_cast<Message>(msg), true);
+    BulkOrderAck& collecting = bulk_order_acks_.at(msg->order->ticker);
+    if (collecting.ack != nullptr && collecting.sender_id == trader_id)
+    {
+        collecting.ack->reports.push_back(msg);
+        return;
+    }
+    if (replaying_) return;
+    sendMessageTo(trader_id, std::dynamic_pointer_cast<Message>(msg), true);
+};
+
+void StockExchange::sendCancelReject(std::string_view ticker, int trader_id, int order_id)
+{
+    BulkOrderAck& collecting = bulk_order_acks_.at(std::string{ticker});
+    if (collecting.ack != nullptr && collecting.sender_id == trader_id)
+    {
+        collecting.ack->rejected_cancels.push_back(order_id);
+        return;
+    }
+    if (replaying_) return;
+
+    CancelRejectMessagePtr reject = std::make_shared<CancelRejectMessage>();
+    reject->sender_id = this->agent_id;
+    reject->order_id = order_id;
+    sendMessageTo(trader_id, std::dynamic_pointer_cast<Message>(reject), true);
 };
 
 std::optional<MessagePtr> StockExchange::handleMessageFrom(std::string_view sender, MessagePtr message)
@@ -457,17 +877,24 @@ std::optional<MessagePtr> StockExchange::handleMessageFrom(std::string_view send
     {
         case MessageType::SUBSCRIBE:
         { 
-            SubscribeMessagePtr msg = std::dynamic_pointer_cast<SubscribeMessage>(message);
-            if (msg == nullptr) {
-                throw std::runtime_error("Failed to cast message to SubscribeMessage");
-            }
+            SubscribeMessagePtr msg = std::static_pointer_cast<SubscribeMessage>(message);
             onSubscribe(msg);
             break;
         }
+        case MessageType::CLOCK_SYNC:
+        {
+            // Answered at once rather than through the matching engine, to keep the round trip short
+            ClockSyncMessagePtr request = std::static_pointer_cast<ClockSyncMessage>(message);
+            ClockSyncMessagePtr response = std::make_shared<ClockSyncMessage>();
+            response->origin = request->origin;
+            response->receive = request->timestamp_received;
+            response->recipient_id = request->sender_id;
+            return response;
+        }
         case MessageType::EVENT:
         {
-            EventMessagePtr event_msg = std::dynamic_pointer_cast<EventMessage>(message);
-            if (event_msg && event_msg->event_type == EventMessage::EventType::TECHNICAL_AGENTS_STARTED) 
+            EventMessagePtr event_msg = std::static_pointer_cast<EventMessage>(message);
+            if (event_msg->event_type == EventMessage::EventType::TECHNICAL_AGENTS_STARTED) 
             {
                 // When a technical agent signals that it's ready to trade,
                 // broadcast this to all traders
@@ -479,63 +906,406 @@ std::optional<MessagePtr> StockExchange::handleMessageFrom(std::string_view send
         default:
         {   
             // Send message to the matching engine
-            msg_queue_.push(message);
+            routeToMatchingEngine(message);
         }
     }
     return std::nullopt;
 };
 
-void StockExchange::handleBroadcastFrom(std::string_view sender, MessagePtr message)
+std::optional<std::string_view> StockExchange::tickerOf(const Message& message)
 {
-    /** TODO: Decide how to handle this more elegantly. */
-    throw std::runtime_error("ExchangeAgent does not handle broadcasts");
-};
-
-
-void StockExchange::onSubscribe(SubscribeMessagePtr msg)
-{   
-    std::cout << "Subscription received: Agent " << msg->sender_id << " subscribed to " << msg->ticker << " at address " << msg->address << "\n"; // DEBUG ONLY
-
-    agent_names_[msg->sender_id] = msg->agent_name;
-    std::cout << "Agent " << msg->sender_id << " is " << msg->agent_name << "\n"; // DEBUG ONLY
-
-    if (order_books_.contains(std::string{msg->ticker}))
-    {   
-        std::cout << "Subscription address: " << msg->address << " Agent ID: " << msg->sender_id << "\n";
-        addSubscriber(msg->ticker, msg->sender_id, msg->address);
-    }
-    else
+    switch (message.type)
     {
-        throw std::runtime_error("Failed to add subscriber: Ticker " + msg->ticker + " not found");
+        case MessageType::MARKET_ORDER:
+        {
+            return static_cast<const MarketOrderMessage&>(message).ticker;
+        }
+        case MessageType::LIMIT_ORDER:
+        {
+            return static_cast<const LimitOrderMessage&>(message).ticker;
+        }
+        case MessageType::CANCEL_ORDER:
+        {
+            return static_cast<const CancelOrderMessage&>(message).ticker;
+        }
+        case MessageType::AMEND_ORDER:
+        {
+            return static_cast<const AmendOrderMessage&>(message).ticker;
+        }
+        case MessageType::BULK_ORDER:
+        {
+            return static_cast<const BulkOrderMessage&>(message).ticker;
+        }
+        case MessageType::MARKET_DATA_REQUEST:
+        {
+            // Answered by the matching engine, which owns the latest market data
+            return static_cast<const MarketDataRequestMessage&>(message).ticker;
+        }
+        default:
+        {
+            return std::nullopt;
+        }
     }
-};
+}
 
-void StockExchange::addSubscriber(std::string_view ticker, int subscriber_id, std::string_view address)
+std::optional<uint16_t> StockExchange::assignSymbol(Message& message)
 {
-    subscribers_.at(std::string{ticker}).insert({subscriber_id, std::string{address}});
-
-    // If trader connects after trading has started, inform the trader that trading window is open
-    std::unique_lock lock {trading_window_mutex_};
-    if (trading_window_open_) 
-    {
-        lock.unlock();
+    std::optional<std::string_view> ticker = tickerOf(message);
+    if (!ticker.has_value()) return std::nullopt;
 
-        EventMessagePtr msg = std::make_shared<EventMessage>(EventMessage::EventType::TRADING_SESSION_START); 
-        sendBroadcast(address, std::dynamic_pointer_cast<Message>(msg));
-    }
-    else 
-    {
-        lock.unlock();
-    }
+    auto symbol = symbols_.find(ticker.value());
+    if (symbol == symbols_.end()) return std::nullopt;
+    message.symbol = symbol->second;
+    return symbol->second;
 };
 
-void StockExchange::addTradeableAsset(std::string_view ticker)
+void StockExchange::routeToMatchingEngine(MessagePtr message)
 {
-    order_books_.insert({std::string{ticker}, OrderBook::create(ticker)});
-    subscribers_.insert({std::string{ticker}, {}});
-
+    std::optional<uint16_t> symbol = assignSymbol(*message);
+    if (!symbol.has_value())
+    {
+        std::optional<std::string_view> ticker = tickerOf(*message);
+        if (ticker.has_value())
+        {
+            LOG_WARN("Exchange received order for unknown ticker " << ticker.value());
+        }
+        else
+        {
+            LOG_WARN("Exchange received unknown message type");
+        }
+        return;
+    }
+    TickerState& state = *tickers_[symbol.value()];
+
+    if (!admit(*message))
+    {
+        rejectOverLimit(message);
+        return;
+    }
+
+    // In virtual time the clock waits for the matching engine to handle messages of an open session.
+    // Checked under the trading window lock, so that none is counted once the session is closing.
+    if (SimulationClock::isVirtual())
+    {
+        std::unique_lock<std::mutex> trading_window_lock(trading_window_mutex_);
+        if (session_state_.load(std::memory_order_acquire) == TradingSessionState::OPEN)
+        {
+            SimulationClock::beginWork();
+            state.work_held.fetch_add(1, std::memory_order_acq_rel);
+        }
+    }
+    if (Tracer::enabled())
+    {
+        message->trace_enqueued = Tracer::now();
+    }
+    state.inbox.push(message);
+};
+
+bool StockExchange::admit(const Message& message)
+{
+    if (order_rate_limit_ <= 0) return true;
+
+    double cost = 1.0;
+    switch (message.type)
+    {
+        case MessageType::CANCEL_ORDER:
+        case MessageType::MARKET_DATA_REQUEST:
+        {
+            return true;
+        }
+        case MessageType::BULK_ORDER:
+        {
+            // Its cancels are free, as they are sent alone
+            const BulkOrderMessage& bulk = static_cast<const BulkOrderMessage&>(message);
+            cost = static_cast<double>(bulk.amends.size() + bulk.orders.size());
+            if (cost == 0) return true;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    unsigned long long now = SimulationClock::nowNanos();
+    std::lock_guard<std::mutex> lock(order_buckets_mutex_);
+    auto [bucket, added] = order_buckets_.try_emplace(message.sender_id, order_rate_limit_, order_burst_, now);
+    return bucket->second.admit(now, cost);
+};
+
+void StockExchange::rejectOverLimit(MessagePtr message)
+{
+    rejected_over_limit_.fetch_add(1, std::memory_order_relaxed);
+    LOG_DEBUG("Agent " << message->sender_id << " is over its rate limit, rejecting " << to_string(message->type));
+
+    const TickSize& tick_size = tickers_[message->symbol]->order_book->tickSize();
+    switch (message->type)
+    {
+        case MessageType::LIMIT_ORDER:
+        {
+            LimitOrderMessagePtr msg = std::static_pointer_cast<LimitOrderMessage>(message);
+            ExecutionReportMessagePtr report = ExecutionReportMessage::createFromOrder(order_factory_.createRejectedLimitOrder(msg, tick_size));
+            sendMessageTo(msg->sender_id, std::static_pointer_cast<Message>(report), true);
+            break;
+        }
+        case MessageType::MARKET_ORDER:
+        {
+            MarketOrderMessagePtr msg = std::static_pointer_cast<MarketOrderMessage>(message);
+            ExecutionReportMessagePtr report = ExecutionReportMessage::createFromOrder(order_factory_.createRejectedMarketOrder(msg));
+            sendMessageTo(msg->sender_id, std::static_pointer_cast<Message>(report), true);
+            break;
+        }
+        case MessageType::AMEND_ORDER:
+        {
+            AmendOrderMessagePtr msg = std::static_pointer_cast<AmendOrderMessage>(message);
+            CancelRejectMessagePtr reject = std::make_shared<CancelRejectMessage>();
+            reject->sender_id = this->agent_id;
+            reject->order_id = msg->order_id;
+            sendMessageTo(msg->sender_id, std::static_pointer_cast<Message>(reject), true);
+            break;
+        }
+        case MessageType::BULK_ORDER:
+        {
+            // Rejected whole, so that its sender sees one outcome of it as usual
+            BulkOrderMessagePtr msg = std::static_pointer_cast<BulkOrderMessage>(message);
+            BulkOrderAckMessagePtr ack = std::make_shared<BulkOrderAckMessage>();
+            ack->sender_id = this->agent_id;
+            for (BulkOrderMessage::Cancel const& cancel : msg->cancels)
+            {
+                ack->rejected_cancels.push_back(cancel.order_id);
+            }
+            for (BulkOrderMessage::Amend const& amend : msg->amends)
+            {
+                ack->rejected_cancels.push_back(amend.order_id);
+            }
+
+            LimitOrderMessagePtr entry = std::make_shared<LimitOrderMessage>();
+            entry->sender_id = msg->sender_id;
+            entry->agent_name = msg->agent_name;
+            entry->timestamp_sent = msg->timestamp_sent;
+            entry->timestamp_received = msg->timestamp_received;
+            entry->ticker = msg->ticker;
+            entry->symbol = msg->symbol;
+            for (BulkOrderMessage::NewOrder const& order : msg->orders)
+            {
+                entry->client_order_id = order.client_order_id;
+                entry->side = order.side;
+                entry->time_in_force = order.time_in_force;
+                entry->quantity = order.quantity;
+                entry->price = order.price;
+                entry->priv_value = order.priv_value;
+                ack->reports.push_back(ExecutionReportMessage::createFromOrder(order_factory_.createRejectedLimitOrder(entry, tick_size)));
+            }
+            sendMessageTo(msg->sender_id, std::static_pointer_cast<Message>(ack), true);
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+};
+
+void StockExchange::interleaveBySender(std::vector<MessagePtr>& batch, std::vector<std::pair<unsigned int, size_t>>& turns, 
+    std::vector<MessagePtr>& interleaved)
+{
+    // Grouped by sender first, so that each message's turn is its place among its sender's messages
+    turns.clear();
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        turns.push_back({0, i});
+    }
+    std::stable_sort(turns.begin(), turns.end(), [&batch](auto const& a, auto const& b) { 
+        return batch[a.second]->sender_id < batch[b.second]->sender_id; 
+    });
+    bool repeated = false;
+    for (size_t i = 1; i < turns.size(); ++i)
+    {
+        if (batch[turns[i].second]->sender_id == batch[turns[i - 1].second]->sender_id)
+        {
+            turns[i].first = turns[i - 1].first + 1;
+            repeated = true;
+        }
+    }
+    if (!repeated) return;
+
+    std::sort(turns.begin(), turns.end());
+    interleaved.clear();
+    for (auto const& [turn, index] : turns)
+    {
+        interleaved.push_back(std::move(batch[index]));
+    }
+    batch.swap(interleaved);
+};
+
+void StockExchange::handleBroadcastFrom(std::string_view sender, MessagePtr message)
+{
+    /** TODO: Decide how to handle this more elegantly. */
+    throw std::runtime_error("ExchangeAgent does not handle broadcasts");
+};
+
+
+void StockExchange::onSubscribe(SubscribeMessagePtr msg)
+{   
+    LOG_DEBUG("Subscription received: Agent " << msg->sender_id << " subscribed to " << msg->ticker << " at address " << msg->address);
+
+    std::unique_lock<std::mutex> agents_lock(agents_mutex_);
+    agent_names_[msg->sender_id] = msg->agent_name;
+    agents_lock.unlock();
+    profit_ledger_.setName(msg->sender_id, msg->agent_name);
+    LOG_DEBUG("Agent " << msg->sender_id << " is " << msg->agent_name);
+
+    if (symbols_.contains(msg->ticker))
+    {   
+        LOG_INFO("Subscription address: " << msg->address << " Agent ID: " << msg->sender_id);
+        addSubscriber(msg->ticker, msg->sender_id, msg->address, msg->max_update_rate, msg->multicast, msg->fields, msg->host);
+    }
+    else
+    {
+        throw std::runtime_error("Failed to add subscriber: Ticker " + msg->ticker + " not found");
+    }
+};
+
+void StockExchange::addSubscriber(std::string_view ticker, int subscriber_id, std::string_view address, unsigned int max_update_rate, bool multicast,
+    MarketDataFields fields, std::string_view host)
+{
+    const TickerState& state = *tickers_[symbols_.find(ticker)->second];
+    std::unique_lock<std::mutex> subscribers_lock(subscribers_mutex_);
+    SubscriberList& list = subscribers_.at(std::string{ticker});
+    auto [position, added] = list.positions.try_emplace(subscriber_id, list.subscribers.size());
+    if (added)
+    {
+        list.subscribers.push_back(Subscriber{subscriber_id, std::string{address}});
+        list.order.push_back(static_cast<uint32_t>(position->second));
+    }
+    Subscriber& subscriber = list.subscribers[position->second];
+
+    // The ticker's market data carries every group of fields any subscriber uses
+    subscriber.fields = fields;
+    MarketDataFields used = MarketDataFields::TOP;
+    for (Subscriber const& other : list.subscribers)
+    {
+        used |= other.fields;
+    }
+    if (market_data_fields_.at(std::string{ticker}).exchange(used, std::memory_order_relaxed) != used)
+    {
+        LOG_INFO("Market data for " << ticker << " carries " << to_string(used));
+    }
+
+    if (max_update_rate > 0)
+    {
+        if (subscriber.min_interval == std::chrono::steady_clock::duration::zero()) ++list.rate_limited;
+        subscriber.min_interval = std::chrono::microseconds(1000000 / max_update_rate);
+        subscriber.last_sent = {};
+        subscriber.stale = false;
+    }
+
+    // Rate-limited subscribers need their own conflated stream, so only the others read the ring or join the group.
+    // A subscriber subscribing again without its host could not open the ring, and is sent updates over the network.
+    bool read_ring = state.ring != nullptr && max_update_rate == 0 && !host.empty() && host == SharedMemoryRing::hostId();
+    subscriber.shared_memory = read_ring;
+    bool join_group = !read_ring && multicast && max_update_rate == 0 && multicast_groups_.contains(std::string{ticker});
+    if (join_group)
+    {
+        subscriber.multicast = true;
+    }
+    subscribers_lock.unlock();
+
+    // Sent ahead of the market data, which carries the ticker as its symbol ID and prices in ticks
+    SymbolDefinitionMessagePtr symbol_msg = std::make_shared<SymbolDefinitionMessage>();
+    symbol_msg->ticker = state.ticker;
+    symbol_msg->symbol = state.symbol;
+    symbol_msg->tick_size = state.order_book->tickSize().size();
+    sendMessageTo(subscriber_id, std::static_pointer_cast<Message>(symbol_msg), true);
+
+    if (read_ring)
+    {
+        SharedMemoryFeedMessagePtr feed_msg = std::make_shared<SharedMemoryFeedMessage>();
+        feed_msg->ticker = state.ticker;
+        feed_msg->path = state.ring->path();
+        feed_msg->token = state.ring->token();
+        sendMessageTo(subscriber_id, std::static_pointer_cast<Message>(feed_msg), true);
+    }
+
+    if (join_group)
+    {
+        MulticastGroupMessagePtr group_msg = std::make_shared<MulticastGroupMessage>();
+        group_msg->ticker = std::string{ticker};
+        group_msg->group_address = multicast_groups_.at(std::string{ticker});
+        sendMessageTo(subscriber_id, std::static_pointer_cast<Message>(group_msg), true);
+    }
+
+    // If trader connects after trading has started, inform the trader that trading window is open
+    if (session_state_.load(std::memory_order_acquire) == TradingSessionState::OPEN) 
+    {
+        EventMessagePtr msg = std::make_shared<EventMessage>(EventMessage::EventType::TRADING_SESSION_START); 
+        msg->recipient_id = subscriber_id;
+        sendBroadcast(address, std::dynamic_pointer_cast<Message>(msg));
+    }
+};
+
+void StockExchange::assignMulticastGroups(std::string_view base_group, const std::vector<std::string>& tickers)
+{
+    size_t colon_pos = base_group.rfind(':');
+    if (colon_pos == std::string_view::npos)
+    {
+        throw std::runtime_error("Invalid multicast group (missing ':'): " + std::string{base_group});
+    }
+    std::string group_address {base_group.substr(0, colon_pos)};
+    unsigned int base_port = std::stoi(std::string{base_group.substr(colon_pos + 1)});
+
+    for (size_t i = 0; i < tickers.size(); ++i)
+    {
+        multicast_groups_[tickers[i]] = group_address + ":" + std::to_string(base_port + i);
+        LOG_INFO("Publishing market data for " << tickers[i] << " to multicast group " << multicast_groups_[tickers[i]]);
+    }
+}
+
+void StockExchange::addTradeableAsset(std::string_view ticker, double tick_size, TradeStatsWindow trade_stats_window)
+{
+    // The symbol ID indexes the ticker's state here and names it in compact market data
+    SymbolDirectory::Symbol symbol = SymbolDirectory::instance().define(agent_id, std::string{ticker}, tick_size);
+    if (tickers_.size() <= symbol.id)
+    {
+        tickers_.resize(symbol.id + 1);
+    }
+    std::unique_ptr<TickerState> state = std::make_unique<TickerState>();
+    state->ticker = symbol.ticker;
+    state->symbol = symbol.id;
+    state->order_book = OrderBook::create(ticker, order_book_type_, TickSize{tick_size});
+    state->order_book->setTradeStatsWindow(trade_stats_window);
+    state->inbox.setBusyPoll(busy_poll_);
+    if (!shared_memory_feed_.empty())
+    {
+        // Named by the exchange's ID as well, so that exchanges of one name on a host in different trials do not collide
+        std::string path = shared_memory_feed_ + "/dsxe_" + std::string{exchange_name_} + "_" + std::to_string(agent_id) + "_" + symbol.ticker;
+        try
+        {
+            state->ring = SharedMemoryRing::create(path, SHARED_MEMORY_SLOTS, SHARED_MEMORY_SLOT_SIZE);
+            LOG_INFO("Publishing market data for " << ticker << " to shared memory ring " << path);
+        }
+        catch (std::exception& e)
+        {
+            LOG_WARN(e.what() << ", so market data for " << ticker << " is only sent over the network");
+        }
+    }
+    tickers_[symbol.id] = std::move(state);
+    symbols_.insert_or_assign(symbol.ticker, symbol.id);
+
+    subscribers_.insert({std::string{ticker}, {}});
+    auction_ioc_orders_.insert({std::string{ticker}, {}});
+    last_market_data_.insert({std::string{ticker}, nullptr});
+    pending_market_data_.insert({std::string{ticker}, nullptr});
+    last_market_data_flush_.insert({std::string{ticker}, {}});
+    market_data_fields_.try_emplace(std::string{ticker}, MarketDataFields::TOP);
+    market_data_sequence_.insert({std::string{ticker}, 0});
+    auction_market_orders_.insert({std::string{ticker}, {}});
+    bulk_order_acks_.insert({std::string{ticker}, {}});
+    equilibrium_trackers_.insert({std::string{ticker}, EquilibriumTracker{}});
+    last_trade_time_.insert({std::string{ticker}, std::nullopt});
+
     createDataFiles(ticker);
-    std::cout << "Added " << ticker << " as a tradeable asset" << std::endl;
+    LOG_INFO("Added " << ticker << " as a tradeable asset");
 };
 
 void StockExchange::confirmDirectory(const std::string& dirPath) {
@@ -545,21 +1315,35 @@ void StockExchange::confirmDirectory(const std::string& dirPath) {
     if (!std::filesystem::exists(dir, ec)) {
         std::filesystem::create_directories(dir, ec);
         if (ec) {
-            std::cerr << "Error creating directory " << dirPath << ": " << ec.message() << std::endl;
+            LOG_ERROR("Error creating directory " << dirPath << ": " << ec.message());
         } else {
-            std::cout << "Created directory: " << dirPath << std::endl;
+            LOG_INFO("Created directory: " << dirPath);
         }
     }
 }
 
+std::string StockExchange::outputDirectory(const std::string& name)
+{
+    return output_dir_.empty() ? name : (std::filesystem::path{output_dir_} / name).string();
+}
+
+std::string StockExchange::outputPath(const std::string& name, const std::string& file)
+{
+    if (upload_.empty() || !upload_streams_.contains(name))
+    {
+        return outputDirectory(name) + "/" + file;
+    }
+    return upload_ + "/" + (std::filesystem::path{outputDirectory(name)}.relative_path() / file).generic_string();
+}
+
 // Modify your createDataFiles method to use directories
 void StockExchange::createDataFiles(std::string_view ticker)
 {
     // Create base directories for different file types
-    std::string lob_dir = "lob_snapshots";
-    std::string trades_dir = "trades";
-    std::string market_data_dir = "market_data";
-    std::string profits_dir = "profits";
+    std::string lob_dir = outputDirectory("lob_snapshots");
+    std::string trades_dir = outputDirectory("trades");
+    std::string market_data_dir = outputDirectory("market_data");
+    std::string profits_dir = outputDirectory("profits");
     
     // Ensure directories exist
     confirmDirectory(lob_dir);
@@ -575,30 +1359,60 @@ void StockExchange::createDataFiles(std::string_view ticker)
 
     // Set path to CSV files with directories
     std::string suffix = std::string{exchange_name_} + "_" + std::string{ticker} + "_" + timestamp;
-    std::string trades_file = trades_dir + "/" + "trades_" + suffix + ".csv";
-    std::string market_data_file = market_data_dir + "/" + "data_" + suffix + ".csv";
-    std::string lob_snapshot_file = lob_dir + "/" + "lob_snapshot_" + suffix + ".csv";
-    std::string profits_file = profits_dir + "/" + "profits_snapshot_" + suffix + ".csv";
-
-    // Create CSV writers
-    CSVWriterPtr trade_writer = std::make_shared<CSVWriter>(trades_file);
-    CSVWriterPtr market_data_writer = std::make_shared<CSVWriter>(market_data_file);
-    CSVWriterPtr lob_snapshot_writer = std::make_shared<CSVWriter>(lob_snapshot_file);
-    CSVWriterPtr profits_writer = std::make_shared<CSVWriter>(profits_file);
+    std::string extension = (output_format_ == OutputFormat::COLUMNAR) ? ".col" 
+        : (tape_compression_ == TapeCompression::ALL) ? ".csv.zst" : ".csv";
+    std::string trades_file = outputPath("trades", "trades_" + suffix + extension);
+    std::string market_data_file = outputPath("market_data", "data_" + suffix + extension);
+    std::string lob_snapshot_file = outputPath("lob_snapshots", "lob_snapshot_" + suffix + extension);
+    std::string profits_file = outputPath("profits", "profits_snapshot_" + suffix + ".csv");
+
+    // Create writers; profits are few and stay in CSV
+    RowWriterPtr trade_writer = createWriter(trades_file);
+    RowWriterPtr market_data_writer = createWriter(market_data_file);
+    RowWriterPtr lob_snapshot_writer = createWriter(lob_snapshot_file);
+
+    // Streams recorded under a policy drop or hold their rows before the writer formats them
+    if (market_data_recording_.kind != RecordingPolicy::EVERY)
+    {
+        // The mid price is taken from the best prices, which every update carries, as its own field only comes with ANALYTICS;
+        // a one-sided book has no mid, and its last traded price stands in
+        market_data_writer = std::make_shared<SampledWriter>(market_data_writer, market_data_recording_,
+            [](const CSVPrintable& row) {
+                const MarketData& data = static_cast<const MarketData&>(row);
+                return (data.best_bid > 0 && data.best_ask > 0) ? (data.best_bid + data.best_ask) / 2 : data.last_price_traded;
+            });
+    }
+    if (lob_recording_.kind != RecordingPolicy::EVERY)
+    {
+        lob_snapshot_writer = std::make_shared<SampledWriter>(lob_snapshot_writer, lob_recording_,
+            [](const CSVPrintable& row) { return static_cast<const LOBSnapshot&>(row).trade_price; });
+    }
+    CSVWriterPtr profits_writer = std::make_shared<CSVWriter>(profits_file, csv_flush_interval_);
 
     trade_tapes_.insert({std::string{ticker}, trade_writer});
     market_data_feeds_.insert({std::string{ticker}, market_data_writer});
     lob_snapshot_.insert({std::string{ticker}, lob_snapshot_writer});
     profits_writer_.insert({std::string{ticker}, profits_writer});
+    trade_histories_.insert({std::string{ticker}, 
+        std::make_shared<TradeHistory>(trade_history_window_, trades_dir + "/" + "history_" + suffix + ".bin")});
     
-    std::cout << "Created data files in organized directories for ticker: " << ticker << std::endl;
+    LOG_INFO("Created data files in organized directories for ticker: " << ticker);
+}
+
+RowWriterPtr StockExchange::createWriter(const std::string& path)
+{
+    if (output_format_ == OutputFormat::COLUMNAR)
+    {
+        return std::make_shared<ColumnarWriter>(path);
+    }
+    return std::make_shared<CSVWriter>(path, csv_flush_interval_, tape_compression_ == TapeCompression::ALL);
 }
 
 // Also modify createMessageTape method
 void StockExchange::createMessageTape() 
 {
     // Create messages directory
-    std::string messages_dir = "messages";
+    std::string messages_dir = outputDirectory("messages");
     confirmDirectory(messages_dir);
     
     // Get current ISO 8601 timestamp
@@ -609,90 +1423,98 @@ void StockExchange::createMessageTape()
 
     // Define CSV filename with directory
     std::string suffix = std::string{exchange_name_} + "_" + timestamp;
-    std::string messages_file = messages_dir + "/" + "msgs_" + suffix + ".csv";
+    bool compress = tape_compression_ != TapeCompression::NONE;
+    std::string messages_file = outputPath("messages", "msgs_" + suffix + (compress ? ".csv.zst" : ".csv"));
 
     // Create message writer
-    this->message_tape_ = std::make_shared<CSVWriter>(messages_file);
+    this->message_tape_ = std::make_shared<CSVWriter>(messages_file, csv_flush_interval_, compress);
+
+    // The order tape keeps the payloads the message tape leaves out
+    if (record_orders_)
+    {
+        std::string orders_file = messages_dir + "/" + "orders_" + suffix + ".bin";
+        this->order_tape_ = std::make_shared<OrderTape>(orders_file);
+        LOG_INFO("Recording order messages to " << orders_file);
+    }
     
-    std::cout << "Created message tape in organized directory" << std::endl;
+    LOG_INFO("Created message tape in organized directory");
 }
 
-double StockExchange::calculatePEquilibrium(std::string_view ticker)
+void StockExchange::appendMetrics(std::string& out)
 {
-    const auto& trade_tape = in_memory_trades_[std::string(ticker)]; // Get the trade tape for the given ticker
-
-    if (trade_tape.empty()) // If no trades have been made
+    std::string exchange = "exchange=\"" + std::string{exchange_name_} + "\"";
+    out += "# TYPE dsxe_matching_queue_depth gauge\n";
+    for (auto const& state : tickers_)
     {
-        return 0.0; // No trades available
-    }
-
-    std::vector<double> trade_prices; // Vector to store trade prices
-    for (const auto& trade : trade_tape) { // Iterate through all trades
-        trade_prices.push_back(trade->price);
+        if (state == nullptr) continue;
+        out += "dsxe_matching_queue_depth{" + exchange + ",ticker=\"" + state->ticker + "\"} " + std::to_string(state->inbox.size()) + "\n";
     }
-
-    // Apply exponentially decreasing weight decay
-    std::vector<double> weights; 
-    for (size_t i = 0; i < trade_prices.size(); ++i) { 
-        weights.push_back(std::pow(0.9, i)); // Exponential decay with factor 0.9
+    out += "# TYPE dsxe_matched_messages_total counter\n";
+    for (auto const& state : tickers_)
+    {
+        if (state == nullptr) continue;
+        out += "dsxe_matched_messages_total{" + exchange + ",ticker=\"" + state->ticker + "\"} " 
+            + std::to_string(state->stats.matched.load(std::memory_order_relaxed)) + "\n";
     }
-
-    // Calculate weighted average of trade prices
-    double weighted_sum = 0; 
-    double weight_sum = 0; 
-    for (size_t i = 0; i < trade_prices.size(); ++i) { 
-        weighted_sum += trade_prices[i] * weights[i]; 
-        weight_sum += weights[i]; 
+    out += "# TYPE dsxe_rejected_over_limit_total counter\n";
+    out += "dsxe_rejected_over_limit_total{" + exchange + "} " + std::to_string(rejected_over_limit_.load(std::memory_order_relaxed)) + "\n";
+    out += "# TYPE dsxe_book_orders gauge\n";
+    for (auto const& state : tickers_)
+    {
+        if (state == nullptr) continue;
+        out += "dsxe_book_orders{" + exchange + ",ticker=\"" + state->ticker + "\",side=\"bid\"} " 
+            + std::to_string(state->stats.bids.load(std::memory_order_relaxed)) + "\n";
+        out += "dsxe_book_orders{" + exchange + ",ticker=\"" + state->ticker + "\",side=\"ask\"} " 
+            + std::to_string(state->stats.asks.load(std::memory_order_relaxed)) + "\n";
     }
-
-    // NOTE: p_equilibrium value stays same/barely changes if no new trades placed. Only changes when significant trades affect the equilibrium price. 
-
-    return weighted_sum / weight_sum; 
 }
 
-double StockExchange::calculateSmithsAlpha(std::string_view ticker) 
-{ 
-    const auto& trade_tape = in_memory_trades_[std::string(ticker)]; // Get the trade tape for the given ticker
+void StockExchange::exportTrace()
+{
+    Tracer::instance().stop();
 
-    if (trade_tape.empty()) // If no trades have been made
-    {
-        return 0.0; // No trades available
-    }
+    std::string traces_dir = outputDirectory("traces");
+    confirmDirectory(traces_dir);
 
-    std::vector<double> trade_prices; // Vector to store trade prices
-    for (const auto& trade : trade_tape) { // Iterate through all trades
-        trade_prices.push_back(trade->price);
-    }
+    std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::stringstream ss;
+    ss << std::put_time(std::localtime(&t), "%FT%T");
+    std::string trace_file = traces_dir + "/" + "trace_" + std::string{exchange_name_} + "_" + ss.str() + ".json";
 
-    // Calculate p_equilibrium
-    double p_equilibrium = calculatePEquilibrium(ticker);
+    size_t events = Tracer::instance().exportChromeTrace(trace_file);
+    LOG_INFO("Wrote " << events << " trace events to " << trace_file);
+}
 
-    // Compute Smith's Alpha
-    double sum_squared_diff = 0; 
-    for (const auto& price : trade_prices) { // Iterate through all trade prices
-        sum_squared_diff += std::pow(price - p_equilibrium, 2); // Calculate sum of squared differences = (price - p_equilibrium)^2
-    }
-    double smiths_alpha = std::sqrt(sum_squared_diff / trade_prices.size()); // Calculate square root of the average squared difference (divide by number of trades and then sqrt)
+double StockExchange::calculatePEquilibrium(std::string_view ticker)
+{
+    // NOTE: p_equilibrium value stays same/barely changes if no new trades placed. Only changes when significant trades affect the equilibrium price. 
+    return equilibrium_trackers_.at(std::string(ticker)).pEquilibrium();
+}
 
-    return smiths_alpha;
+double StockExchange::calculateSmithsAlpha(std::string_view ticker) 
+{ 
+    return equilibrium_trackers_.at(std::string(ticker)).smithsAlpha();
 }
 
 void StockExchange::publishMarketData(std::string_view ticker, Order::Side aggressing_side) 
 {
-    MarketDataPtr data = getOrderBookFor(ticker)->getLiveMarketData(aggressing_side); // Get live market data for the given ticker
+    // Only the fields the subscribers use, and those the tape records, are computed
+    MarketDataFields fields = market_data_fields_.at(std::string(ticker)).load(std::memory_order_relaxed);
+    MarketDataPtr data = getOrderBookFor(ticker)->getLiveMarketData(aggressing_side, fields | TAPE_FIELDS); // Get live market data for the given ticker
     if (!data) { // DEBUG  
-        std::cout << "No market data available for " << ticker << "\n";
+        LOG_INFO("No market data available for " << ticker);
         return;
     }
 
     // Always ensure the timestamps are proper millisecond values relative to session start
-    auto now = std::chrono::high_resolution_clock::now();
+    SimulationClock::duration now = SimulationClock::now();
     double elapsed_time = std::chrono::duration<double, std::milli>(now - trading_session_start_time_).count();
     
     // Time difference between current event and last trade for this ticker
     double time_diff = 0.0;
-    if (last_trade_time_.find(std::string(ticker)) != last_trade_time_.end()) {
-        time_diff = std::chrono::duration<double, std::milli>(now - last_trade_time_[std::string(ticker)]).count();
+    const std::optional<SimulationClock::duration>& last_trade_time = last_trade_time_.at(std::string(ticker));
+    if (last_trade_time.has_value()) {
+        time_diff = std::chrono::duration<double, std::milli>(now - last_trade_time.value()).count();
     }
     
     // Ensure timestamps are always properly set
@@ -700,17 +1522,214 @@ void StockExchange::publishMarketData(std::string_view ticker, Order::Side aggre
     data->time_diff = static_cast<unsigned long long>(time_diff);
     
     // Update other derived values
-    data->p_equilibrium = calculatePEquilibrium(ticker);
-    data->smiths_alpha = calculateSmithsAlpha(ticker);
+    if (includes(fields, MarketDataFields::EQUILIBRIUM))
+    {
+        data->p_equilibrium = calculatePEquilibrium(ticker);
+        data->smiths_alpha = calculateSmithsAlpha(ticker);
+    }
     
     addMarketDataSnapshot(data); // Existing market data snapshot (data_ files)
-    MarketDataMessagePtr msg = std::make_shared<MarketDataMessage>();
-    msg->data = data;
+    data->keepOnly(fields);
 
-    // Send message to all subscribers of the given ticker 
-    broadcastToSubscribers(ticker, std::dynamic_pointer_cast<Message>(msg));
+    // Keep only the latest state until the next flush
+    pending_market_data_.at(std::string(ticker)) = data;
 }; 
 
+void StockExchange::flushMarketData(std::string_view ticker)
+{
+    MarketDataPtr& data = pending_market_data_.at(std::string(ticker));
+    if (data == nullptr) return;
+
+    // Send a delta against the last update unless a full snapshot is due
+    unsigned long sequence = ++market_data_sequence_.at(std::string(ticker));
+    MarketDataPtr& last_data = last_market_data_.at(std::string(ticker));
+    bool send_delta = market_data_feed_ == MarketDataFeedType::DELTA && last_data != nullptr
+        && (snapshot_interval_ <= 0 || sequence % snapshot_interval_ != 0);
+    MessagePtr msg;
+    if (send_delta)
+    {
+        msg = MarketDataDeltaMessage::createFromChange(*last_data, *data, sequence);
+    }
+    else
+    {
+        MarketDataMessagePtr snapshot_msg = std::make_shared<MarketDataMessage>();
+        snapshot_msg->data = data;
+        snapshot_msg->sequence = sequence;
+        msg = snapshot_msg;
+    }
+    last_data = data;
+    data = nullptr;
+    last_market_data_flush_.at(std::string(ticker)) = std::chrono::steady_clock::now();
+
+    // Send message to all subscribers of the given ticker 
+    broadcastMarketData(ticker, msg);
+}
+
+void StockExchange::publishDueMarketData(std::string_view ticker)
+{
+    TraceSpan span {TraceStage::MARKET_DATA};
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (pending_market_data_.at(std::string(ticker)) != nullptr 
+        && now >= last_market_data_flush_.at(std::string(ticker)) + std::chrono::milliseconds(conflation_interval_))
+    {
+        flushMarketData(ticker);
+    }
+    broadcastMarketData(ticker, nullptr, true);
+}
+
+std::optional<std::chrono::steady_clock::time_point> StockExchange::nextMarketDataDue(std::string_view ticker)
+{
+    std::optional<std::chrono::steady_clock::time_point> due = std::nullopt;
+    if (pending_market_data_.at(std::string(ticker)) != nullptr)
+    {
+        due = last_market_data_flush_.at(std::string(ticker)) + std::chrono::milliseconds(conflation_interval_);
+    }
+
+    std::unique_lock<std::mutex> subscribers_lock(subscribers_mutex_);
+    const SubscriberList& list = subscribers_.at(std::string(ticker));
+    if (list.rate_limited == 0) return due;
+    for (Subscriber const& subscriber : list.subscribers)
+    {
+        if (subscriber.stale && (!due.has_value() || subscriber.last_sent + subscriber.min_interval < due.value()))
+        {
+            due = subscriber.last_sent + subscriber.min_interval;
+        }
+    }
+    return due;
+}
+
+void StockExchange::broadcastMarketData(std::string_view ticker, MessagePtr update, bool stale_only)
+{
+    TraceSpan span {TraceStage::FANOUT};
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    // Split the subscribers into those sent every update and rate-limited ones due for the latest snapshot,
+    // in a fresh random order for every update so that no subscriber is always sent it first
+    std::unique_lock<std::mutex> subscribers_lock(subscribers_mutex_);
+    SubscriberList& list = subscribers_.at(std::string{ticker});
+    std::vector<std::string>& update_addresses = list.update_addresses;
+    std::vector<std::string>& snapshot_addresses = list.snapshot_addresses;
+    size_t update_count = 0;
+    size_t snapshot_count = 0;
+    std::shuffle(list.order.begin(), list.order.end(), random_generator_);
+    bool multicast = false;
+    size_t ring_count = 0;
+    for (uint32_t position : list.order)
+    {
+        Subscriber& subscriber = list.subscribers[position];
+        if (subscriber.shared_memory)
+        {
+            assignAddress(list.ring_addresses, ring_count++, subscriber.address);
+        }
+        else if (subscriber.multicast)
+        {
+            multicast = true;
+        }
+        else if (subscriber.min_interval == std::chrono::steady_clock::duration::zero())
+        {
+            // Conflate updates for subscribers that are not keeping up, catching them up with the full state once they drain
+            if (sendQueueBacklogged(subscriber.id))
+            {
+                subscriber.backlogged = true;
+            }
+            else if (subscriber.backlogged)
+            {
+                subscriber.backlogged = false;
+                assignAddress(snapshot_addresses, snapshot_count++, subscriber.address);
+            }
+            else if (!stale_only)
+            {
+                assignAddress(update_addresses, update_count++, subscriber.address);
+            }
+        }
+        else if (now - subscriber.last_sent >= subscriber.min_interval)
+        {
+            if (stale_only && !subscriber.stale) continue;
+            subscriber.last_sent = now;
+            subscriber.stale = false;
+            assignAddress(snapshot_addresses, snapshot_count++, subscriber.address);
+        }
+        else
+        {
+            subscriber.stale = true;
+        }
+    }
+
+    // A single send to the group reaches every multicast subscriber
+    if (!stale_only && multicast)
+    {
+        assignAddress(update_addresses, update_count++, multicast_groups_.at(std::string{ticker}));
+    }
+    subscribers_lock.unlock();
+
+    // One write to the ring reaches every subscriber on this host, however many there are
+    SharedMemoryRing* ring = (ring_count > 0 && !stale_only && update != nullptr) ? tickers_[symbols_.find(ticker)->second]->ring.get() : nullptr;
+    if (ring != nullptr && !publishSharedMemory(*ring, update))
+    {
+        for (size_t i = 0; i < ring_count; ++i)
+        {
+            assignAddress(update_addresses, update_count++, list.ring_addresses[i]);
+        }
+        ring = nullptr;
+    }
+
+    if (update_count == 0 && snapshot_count == 0 && ring == nullptr) return;
+
+    MarketDataPtr data = last_market_data_.at(std::string(ticker));
+    if (data == nullptr) return;
+
+    // Rate-limited and backlogged subscribers may have skipped updates, so they always get the full state
+    MessagePtr snapshot = update;
+    if (snapshot == nullptr || snapshot->type != MessageType::MARKET_DATA)
+    {
+        MarketDataMessagePtr snapshot_msg = std::make_shared<MarketDataMessage>();
+        snapshot_msg->data = data;
+        snapshot_msg->sequence = market_data_sequence_.at(std::string(ticker));
+        snapshot = snapshot_msg;
+    }
+
+    // Send the top levels of the book if market depth is enabled
+    MessagePtr depth = nullptr;
+    if (depth_levels_ > 0)
+    {
+        MarketDepthMessagePtr depth_msg = std::make_shared<MarketDepthMessage>();
+        depth_msg->depth = getOrderBookFor(ticker)->getDepth(depth_levels_);
+        depth_msg->depth->timestamp = data->timestamp;
+        depth = depth_msg;
+    }
+
+    // Each message is serialised once and the same buffer sent to every address
+    sendBroadcast(std::span{update_addresses.data(), update_count}, update);
+    sendBroadcast(std::span{snapshot_addresses.data(), snapshot_count}, snapshot);
+    if (depth != nullptr)
+    {
+        for (size_t i = 0; i < snapshot_count; ++i)
+        {
+            assignAddress(update_addresses, update_count++, snapshot_addresses[i]);
+        }
+        if (ring != nullptr && !publishSharedMemory(*ring, depth))
+        {
+            for (size_t i = 0; i < ring_count; ++i)
+            {
+                assignAddress(update_addresses, update_count++, list.ring_addresses[i]);
+            }
+        }
+        sendBroadcast(std::span{update_addresses.data(), update_count}, depth);
+    }
+}
+
+void StockExchange::assignAddress(std::vector<std::string>& addresses, size_t index, const std::string& address)
+{
+    if (index < addresses.size())
+    {
+        addresses[index].assign(address);
+    }
+    else
+    {
+        addresses.push_back(address);
+    }
+}
+
 void StockExchange::setTradingWindow(int connect_time, int trading_time)
 {
     if (trading_window_thread_ != nullptr)
@@ -718,31 +1737,20 @@ void StockExchange::setTradingWindow(int connect_time, int trading_time)
         throw new std::runtime_error("Trading window already has been set");
     }
 
+    // The window is timed on the simulation clock, which must not move before the thread waits on it
+    SimulationClock::beginWork();
     trading_window_thread_ = new std::thread([=, this](){
+        SimulationClock::Participant participant{std::adopt_lock};
+        ThreadPlacement::instance().pinCurrent(ThreadRole::SESSION);
 
-        // Allow time for connections
-        std::cout << "Trading time set to " << trading_time << " seconds." << std::endl;
-        std::cout << "Waiting for connections for " << connect_time << " seconds..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(connect_time));
-
-        // After the initial period, continue checking for additional connections. 
-        std::cout << "Initial connection period complete. Monitoring for additional connections..." << std::endl;
-        auto last_connection_time = std::chrono::steady_clock::now();
-        size_t prev_count = agent_names_.size();
-        while (true) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));  // Check periodically
-            size_t current_count = agent_names_.size();
-            if (current_count > prev_count) {
-                std::cout << "New connection detected. Total connected agents: " << current_count << std::endl;
-                last_connection_time = std::chrono::steady_clock::now();
-                prev_count = current_count;
-            }
-            // If no new connection for 5 seconds, then proceed.
-            if (std::chrono::duration_cast<std::chrono::seconds>(
-                    std::chrono::steady_clock::now() - last_connection_time).count() >= 5) {
-                std::cout << "No new connections for 5 seconds. Proceeding to order injection phase." << std::endl;
-                break;
-            }
+        LOG_INFO("Trading time set to " << trading_time << " seconds.");
+        if (!expected_subscribers_.empty())
+        {
+            awaitSubscribers(connect_time);
+        }
+        else
+        {
+            awaitConnections(connect_time);
         }
 
         // **Phase 1: Order Injection**
@@ -755,40 +1763,99 @@ void StockExchange::setTradingWindow(int connect_time, int trading_time)
         //std::this_thread::sleep_for(std::chrono::seconds(5));  // Allow OrderInjector to inject orders for 3 seconds
 
         // **Phase 2: Start Trading Session**
-        std::cout << "Order injection complete. Starting trading session now.\n";
+        LOG_INFO("Order injection complete. Starting trading session now.");
         startTradingSession();
-        std::this_thread::sleep_for(std::chrono::seconds(trading_time));
+        SimulationClock::sleepFor(std::chrono::seconds(trading_time));
 
         // **Phase 3: End Trading Session**
         endTradingSession();
-        std::cout << "Trading session ended.\n";
+        LOG_INFO("Trading session ended.");
     });
 }
 
 
+void StockExchange::awaitSubscribers(int connect_time)
+{
+    // Trading opens the moment every expected trader has subscribed, or once the connect time has passed at the latest
+    LOG_INFO("Waiting up to " << connect_time << " seconds for " << expected_subscribers_.size() << " traders to subscribe...");
+    SimulationClock::duration deadline = SimulationClock::now() + std::chrono::seconds(connect_time);
+    while (true)
+    {
+        std::unique_lock<std::mutex> agents_lock(agents_mutex_);
+        size_t missing = std::count_if(expected_subscribers_.begin(), expected_subscribers_.end(), 
+            [this](int subscriber_id) { return !agent_names_.contains(subscriber_id); });
+        agents_lock.unlock();
+
+        if (missing == 0)
+        {
+            LOG_INFO("All expected traders subscribed. Proceeding to order injection phase.");
+            return;
+        }
+        if (SimulationClock::now() >= deadline)
+        {
+            LOG_WARN(missing << " expected traders did not subscribe in time. Proceeding to order injection phase.");
+            return;
+        }
+        SimulationClock::sleepFor(SUBSCRIBER_POLL_INTERVAL);
+    }
+}
+
+void StockExchange::awaitConnections(int connect_time)
+{
+    // Allow time for connections
+    LOG_INFO("Waiting for connections for " << connect_time << " seconds...");
+    SimulationClock::sleepFor(std::chrono::seconds(connect_time));
+
+    // After the initial period, continue checking for additional connections. 
+    LOG_INFO("Initial connection period complete. Monitoring for additional connections...");
+    SimulationClock::duration last_connection_time = SimulationClock::now();
+    std::unique_lock<std::mutex> agents_lock(agents_mutex_);
+    size_t prev_count = agent_names_.size();
+    agents_lock.unlock();
+    while (true) {
+        SimulationClock::sleepFor(std::chrono::milliseconds(500));  // Check periodically
+        agents_lock.lock();
+        size_t current_count = agent_names_.size();
+        agents_lock.unlock();
+        if (current_count > prev_count) {
+            LOG_INFO("New connection detected. Total connected agents: " << current_count);
+            last_connection_time = SimulationClock::now();
+            prev_count = current_count;
+        }
+        // If no new connection for 5 seconds, then proceed.
+        if (std::chrono::duration_cast<std::chrono::seconds>(
+                SimulationClock::now() - last_connection_time).count() >= 5) {
+            LOG_INFO("No new connections for 5 seconds. Proceeding to order injection phase.");
+            break;
+        }
+    }
+}
+
 void StockExchange::startTradingSession()
 {   
-    trading_session_start_time_ = std::chrono::high_resolution_clock::now();
+    trading_session_start_time_ = SimulationClock::now();
+    if (trace_)
+    {
+        Tracer::instance().start();
+    }
 
     // Schedule the technical traders ready event
+    SimulationClock::beginWork();
     auto ready_thread = new std::thread([this]() {
-        std::this_thread::sleep_for(std::chrono::seconds(TECHNICAL_READY_DELAY_SECONDS));
+        SimulationClock::Participant participant{std::adopt_lock};
+        SimulationClock::sleepFor(std::chrono::seconds(TECHNICAL_READY_DELAY_SECONDS));
         
         // Set technical traders as ready and reset legacy trader profits
         technical_traders_ready_ = true;
-        ready_timestamp_ = std::chrono::high_resolution_clock::now();
+        ready_timestamp_ = SimulationClock::now();
         
         // Reset profits for legacy traders
-        int reset_count = 0;
-        for (auto& [name, profit] : agent_profits_by_name_) {
+        profit_ledger_.resetIf([this](const std::string& name) {
             for (const auto& legacy_type : legacy_trader_types_) {
-                if (name.find(legacy_type) == 0) {  // Name starts with legacy type
-                    profit = 0.0;  // Reset profit
-                    reset_count++;
-                    break;
-                }
+                if (name.find(legacy_type) == 0) return true;  // Name starts with legacy type
             }
-        }
+            return false;
+        });
         
         // Signal all traders that technical agents are ready
         signalTechnicalAgentsStarted();
@@ -797,9 +1864,10 @@ void StockExchange::startTradingSession()
 
     // Signal start of trading window to the matching engine
     std::unique_lock<std::mutex> trading_window_lock(trading_window_mutex_);
-    trading_window_open_ = true;
+    session_state_.store(TradingSessionState::OPEN, std::memory_order_release);
     trading_window_lock.unlock();
     trading_window_cv_.notify_all();
+    startProfitReports();
 
     EventMessagePtr msg = std::make_shared<EventMessage>(EventMessage::EventType::TRADING_SESSION_START); 
     // Send a message to subscribers of all tickers
@@ -813,18 +1881,52 @@ void StockExchange::endTradingSession()
 {
     // Signal end of trading window to the matching engine
     std::unique_lock<std::mutex> trading_window_lock(trading_window_mutex_);
-    trading_window_open_ = false;
+    session_state_.store(TradingSessionState::CLOSING, std::memory_order_release);
     trading_window_lock.unlock();
     trading_window_cv_.notify_all();
 
-    // First close the message queue to prevent new trades
-    msg_queue_.close();
+    // First close the message queues to prevent new trades
+    for (auto const& state : tickers_)
+    {
+        if (state != nullptr) state->inbox.close();
+    }
     
-    // Wait for the matching engine to stop
-    if (matching_engine_thread_ != nullptr && matching_engine_thread_->joinable()) {
-        matching_engine_thread_->join();
-        delete matching_engine_thread_;
-        matching_engine_thread_ = nullptr;
+    // Wait for the matching engines to stop
+    for (std::thread* matching_engine_thread : matching_engine_threads_)
+    {
+        if (matching_engine_thread->joinable()) {
+            matching_engine_thread->join();
+        }
+        delete matching_engine_thread;
+    }
+    matching_engine_threads_.clear();
+
+    // Messages left in the closed queues are dropped, so the clock no longer waits for them
+    for (auto const& state : tickers_)
+    {
+        if (state == nullptr) continue;
+        for (int held = state->work_held.exchange(0); held > 0; --held)
+        {
+            SimulationClock::endWork();
+        }
+    }
+
+    // Nothing is matched once the matching engines have stopped
+    if (order_tape_ != nullptr)
+    {
+        std::unique_lock<std::mutex> message_tape_lock(message_tape_mutex_);
+        order_tape_->close();
+        order_tape_ = nullptr;
+    }
+
+    // The books no longer change once the matching engines have stopped
+    if (!checkpoint_file_.empty())
+    {
+        saveCheckpoint(outputDirectory(checkpoint_file_));
+    }
+    if (trace_)
+    {
+        exportTrace();
     }
 
     EventMessagePtr msg = std::make_shared<EventMessage>(EventMessage::EventType::TRADING_SESSION_END);
@@ -834,13 +1936,8 @@ void StockExchange::endTradingSession()
         broadcastToSubscribers(ticker, std::dynamic_pointer_cast<Message>(msg));
     }
 
-    // Now calculate profits and write to CSV
-    std::cout << "Profits calculated internally by exchange:\n";
-    for (const auto& [agentName, profit] : agent_profits_by_name_) {
-        std::cout << agentName << ": " << profit << std::endl;
-    }
-
-    // Write profits to CSV
+    // Profits are kept as trades execute, and no longer change once the matching engines have stopped
+    profit_report_timer_.stop();
     writeProfitsToCSV();
 
     // Iterate through all tickers and close all open csv files
@@ -848,45 +1945,174 @@ void StockExchange::endTradingSession()
     {
         writer->stop();
     }
+    for (auto const& [ticker, writer] : market_data_feeds_)
+    {
+        writer->stop();
+    }
+    for (auto const& [ticker, writer] : lob_snapshot_)
+    {
+        writer->stop();
+    }
+
+    LOG_INFO("Message latencies:\n" << LatencyRecorder::instance().report());
+
+    session_state_.store(TradingSessionState::CLOSED, std::memory_order_release);
+    LOG_INFO("Trading session ended.");
+    reportSessionEnd();
+}
+
+void StockExchange::saveCheckpoint(const std::string& path)
+{
+    // Checkpoints keep the configured agent IDs, so that trials in any slot can open on them
+    SessionCheckpoint checkpoint;
+    for (auto const& state : tickers_)
+    {
+        if (state == nullptr) continue;
+        const std::string& ticker = state->ticker;
+        const OrderBookPtr& order_book = state->order_book;
+        SessionCheckpoint::Book& book = checkpoint.books[ticker];
+        auto keep = [this, &book](const LimitOrderPtr& order) {
+            book.orders.push_back(SessionCheckpoint::RestingOrder{order, order->sender_id - agent_id_offset_, order->agent_name});
+            return true;
+        };
+        order_book->walkOrders(Order::Side::BID, keep);
+        order_book->walkOrders(Order::Side::ASK, keep);
+
+        book.statistics = order_book->tradeStatistics();
+        book.trades = trade_histories_.at(ticker)->all();
+        book.equilibrium = equilibrium_trackers_.at(ticker);
+        book.last_market_data = last_market_data_.at(ticker);
+        book.market_data_sequence = market_data_sequence_.at(ticker);
+    }
+
+    checkpoint.orders_created = order_factory_.getNumberOfOrders();
+    checkpoint.trades_created = trade_factory_.getNumberOfTrades();
+    checkpoint.volume_traded = trade_factory_.getVolumeTraded();
+    checkpoint.profits = profit_ledger_.accounts();
+
+    try
+    {
+        confirmDirectory(std::filesystem::path{path}.parent_path().string());
+        checkpoint.save(path);
+        LOG_INFO("Saved session checkpoint to " << path);
+    }
+    catch (std::exception& e)
+    {
+        LOG_ERROR("Failed to save session checkpoint: " << e.what());
+    }
+}
+
+void StockExchange::restoreCheckpoint(const std::string& path)
+{
+    SessionCheckpoint checkpoint = SessionCheckpoint::load(path);
+
+    // Restored orders are restamped with their place in the checkpoint, which keeps their priority among themselves
+    // and puts them ahead of every order of this session, whose clock may have started behind the saved one
+    unsigned long long place = 0;
+    for (auto& [ticker, book] : checkpoint.books)
+    {
+        auto symbol = symbols_.find(ticker);
+        if (symbol == symbols_.end())
+        {
+            LOG_WARN("Checkpoint " << path << " holds " << ticker << ", which is not traded here");
+            continue;
+        }
+        const OrderBookPtr& order_book = tickers_[symbol->second]->order_book;
+
+        for (SessionCheckpoint::RestingOrder& resting : book.orders)
+        {
+            resting.order->sender_id = resting.sender_id + agent_id_offset_;
+            resting.order->agent_name = resting.agent_name;
+            resting.order->timestamp_created = ++place;
+            resting.order->symbol = symbol->second;
+            order_book->addOrder(resting.order);
+        }
+
+        order_book->restoreTradeStatistics(book.statistics);
+        for (TradePtr const& trade : book.trades)
+        {
+            trade_histories_.at(ticker)->add(trade);
+        }
+        equilibrium_trackers_[ticker] = book.equilibrium;
+        last_market_data_[ticker] = book.last_market_data;
+        market_data_sequence_[ticker] = book.market_data_sequence;
+    }
 
-    std::cout << "Trading session ended.\n";
+    // Agent names are left to the subscriptions of this session, which trading waits for
+    order_factory_.restoreNumberOfOrders(checkpoint.orders_created);
+    trade_factory_.restoreTrades(checkpoint.trades_created, checkpoint.volume_traded);
+    profit_ledger_.restore(std::move(checkpoint.profits));
+
+    LOG_INFO("Restored session checkpoint from " << path << ": " << place << " resting orders, " 
+        << checkpoint.trades_created << " trades");
+}
+
+void StockExchange::startProfitReports()
+{
+    if (orchestrator_addr_.empty() || profit_report_interval_ <= 0) return;
+
+    connect(orchestrator_addr_, "orchestrator", [this]() {
+        if (session_state_.load(std::memory_order_acquire) != TradingSessionState::OPEN) return;
+        profit_report_timer_.start(std::chrono::milliseconds(profit_report_interval_), 0.0, [this]() { reportProfits(false); });
+    });
+}
+
+void StockExchange::reportProfits(bool final)
+{
+    ProfitReportMessagePtr msg = std::make_shared<ProfitReportMessage>();
+    msg->first_agent_id = profit_ledger_.firstAgentId();
+    msg->accounts = profit_ledger_.accounts();
+    msg->final = final;
+    sendMessageTo("orchestrator", std::static_pointer_cast<Message>(msg), true);
+}
+
+void StockExchange::reportSessionEnd()
+{
+    if (orchestrator_addr_.empty()) return;
+
+    // The orchestrator waits for the exchanges of a trial to report the end of their sessions before starting the next
+    connect(orchestrator_addr_, "orchestrator", [this]() {
+        reportProfits(true);
+        EventMessagePtr msg = std::make_shared<EventMessage>(EventMessage::EventType::TRADING_SESSION_END);
+        sendMessageTo("orchestrator", std::static_pointer_cast<Message>(msg));
+    });
 }
 
 void StockExchange::writeProfitsToCSV()
 {
     // Ensure profits to write.
-    if (agent_profits_by_name_.empty()) {
-        std::cout << "ERROR: No profits to write to CSV!\n";
+    std::unordered_map<std::string, double> profits_by_name = profit_ledger_.accounts().profitsByName();
+    if (profits_by_name.empty()) {
+        LOG_ERROR("No profits to write to CSV!");
         return;
     }
 
     // Sort profits in descending order
-    std::vector<std::pair<std::string, double>> sorted_profits(
-        agent_profits_by_name_.begin(), agent_profits_by_name_.end());
+    std::vector<std::pair<std::string, double>> sorted_profits(profits_by_name.begin(), profits_by_name.end());
 
     std::sort(sorted_profits.begin(), sorted_profits.end(), 
         [](const auto& a, const auto& b) { return a.second > b.second; }); 
     
     // Write to each ticker's profit file
     for (const auto& [ticker, writer] : profits_writer_) {
-        std::cout << "Writing profits for ticker: " << ticker << "\n";
+        LOG_INFO("Writing profits for ticker: " << ticker);
         
         for (const auto& [agentName, profit] : sorted_profits) {
             ProfitSnapshotPtr snapshot = std::make_shared<ProfitSnapshot>(agentName, profit);
             
             if (!writer) {
-                std::cerr << "ERROR: Null writer for ticker " << ticker << "\n";
+                LOG_ERROR("Null writer for ticker " << ticker);
                 continue;
             }
             
             writer->writeRow(snapshot);
-            std::cout << "Wrote profit for " << agentName << ": " << profit << "\n";
+            LOG_INFO("Wrote profit for " << agentName << ": " << profit);
         }
         
         writer->stop();
     }
 
-    std::cout << "Finished writing profits to CSV\n";
+    LOG_INFO("Finished writing profits to CSV");
 }
 
 void StockExchange::signalTechnicalAgentsStarted()
@@ -903,35 +2129,49 @@ void StockExchange::signalTechnicalAgentsStarted()
 
 OrderBookPtr StockExchange::getOrderBookFor(std::string_view ticker)
 {
-    return order_books_.at(std::string{ticker});
+    auto symbol = symbols_.find(ticker);
+    if (symbol == symbols_.end())
+    {
+        throw std::runtime_error("Ticker " + std::string{ticker} + " is not traded here");
+    }
+    return tickers_[symbol->second]->order_book;
 };
 
-CSVWriterPtr StockExchange::getTradeTapeFor(std::string_view ticker)
+RowWriterPtr StockExchange::getTradeTapeFor(std::string_view ticker)
 {
     return trade_tapes_.at(std::string{ticker});
 };
 
-CSVWriterPtr StockExchange::getMarketDataFeedFor(std::string_view ticker)
+RowWriterPtr StockExchange::getMarketDataFeedFor(std::string_view ticker)
 {
     return market_data_feeds_.at(std::string{ticker});
 };
 
-CSVWriterPtr StockExchange::getLOBSnapshotFor(std::string_view ticker)
+RowWriterPtr StockExchange::getLOBSnapshotFor(std::string_view ticker)
 {
     return lob_snapshot_.at(std::string{ticker});
 };
 
 void StockExchange::addTradeToTape(TradePtr trade)
 {
-    std::cout << *trade << "\n";
+    TraceSpan span {TraceStage::TAPE_WRITE, MessageType::EXECUTION_REPORT};
+    LOG_DEBUG(*trade);
     getTradeTapeFor(trade->ticker)->writeRow(trade);
 
-    // Add trade to in-memory list 
-    in_memory_trades_[trade->ticker].push_back(trade); // CORRECTLY GETTING TRADES
+    // Add trade to the history, spilling older trades to disk
+    trade_histories_.at(trade->ticker)->add(trade);
+    equilibrium_trackers_.at(trade->ticker).add(trade->price);
 };
 
 void StockExchange::addMarketDataSnapshot(MarketDataPtr data)
 {
+    TraceSpan span {TraceStage::TAPE_WRITE, MessageType::MARKET_DATA};
+
+    // A held update is copied, as it is trimmed to its subscribers' fields once written
+    if (market_data_recording_.holdsRows())
+    {
+        data = std::make_shared<MarketData>(*data);
+    }
     getMarketDataFeedFor(data->ticker)->writeRow(data);
 }
 
@@ -944,20 +2184,30 @@ void StockExchange::addLOBSnapshot(LOBSnapshotPtr lob_data)
 
 void StockExchange::addMessageToTape(MessagePtr msg)
 {
+    TraceSpan span {TraceStage::TAPE_WRITE, msg->type};
+    std::unique_lock<std::mutex> lock(message_tape_mutex_);
     message_tape_->writeRow(msg);
+    if (order_tape_ != nullptr && msg->type != MessageType::MARKET_DATA_REQUEST)
+    {
+        order_tape_->record(msg);
+    }
 }
 
 
 void StockExchange::broadcastToSubscribers(std::string_view ticker, MessagePtr msg)
 {
     // Randomise the subscribers list
-    std::unordered_map<int, std::string> ticker_subcribers(subscribers_.at(std::string{ticker}));
-    std::vector<std::pair<int, std::string>> randomised_subscribers(ticker_subcribers.begin(), ticker_subcribers.end());
-    std::shuffle(randomised_subscribers.begin(), randomised_subscribers.end(), random_generator_);
-
-    // Send a broadcast to each one
-    for (auto const& [subscriber_id, address] : randomised_subscribers)
+    std::unique_lock<std::mutex> subscribers_lock(subscribers_mutex_);
+    const SubscriberList& list = subscribers_.at(std::string{ticker});
+    std::vector<std::string> randomised_addresses;
+    randomised_addresses.reserve(list.subscribers.size());
+    for (Subscriber const& subscriber : list.subscribers)
     {
-        sendBroadcast(address, std::dynamic_pointer_cast<Message>(msg));
+        randomised_addresses.push_back(subscriber.address);
     }
+    std::shuffle(randomised_addresses.begin(), randomised_addresses.end(), random_generator_);
+    subscribers_lock.unlock();
+
+    // Serialise once and send the same buffer to each one
+    sendBroadcast(randomised_addresses, msg);
 }
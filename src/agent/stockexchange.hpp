@@ -1,7 +1,9 @@
 #ifndef STOCK_EXCHANGE_HPP
 #define STOCK_EXCHANGE_HPP
 
+#include <atomic>
 #include <random>
+#include <span>
 #include <unordered_set>
 
 #include "../agent/agent.hpp"
@@ -14,11 +16,29 @@
 #include "../trade/marketdata.hpp"
 #include "../trade/lobsnapshot.hpp"
 #include "../trade/profitsnapshot.hpp"
-#include "../utilities/syncqueue.hpp"
+#include "../trade/profitledger.hpp"
+#include "../trade/tradehistory.hpp"
+#include "../trade/equilibriumtracker.hpp"
+#include "../trade/tradingsessionstate.hpp"
+#include "../trade/sessioncheckpoint.hpp"
+#include "../utilities/mpscqueue.hpp"
+#include "../utilities/simulationclock.hpp"
 #include "../utilities/csvwriter.hpp"
+#include "../utilities/ordertape.hpp"
+#include "../utilities/jitteredtimer.hpp"
+#include "../utilities/columnarwriter.hpp"
+#include "../utilities/sampledwriter.hpp"
+#include "../utilities/logger.hpp"
+#include "../utilities/threadplacement.hpp"
+#include "../utilities/tokenbucket.hpp"
 #include "../utilities/csvprintable.hpp"
 #include "../message/message.hpp"
 #include "../message/market_data_message.hpp"
+#include "../message/market_depth_message.hpp"
+#include "../message/market_data_delta_message.hpp"
+#include "../message/multicast_group_message.hpp"
+#include "../message/shared_memory_feed_message.hpp"
+#include "../message/market_data_request_message.hpp"
 #include "../message/limit_order_message.hpp"
 #include "../message/market_order_message.hpp"
 #include "../message/cancel_order_message.hpp"
@@ -26,33 +46,123 @@
 #include "../message/exec_report_message.hpp"
 #include "../message/event_message.hpp"
 #include "../message/cancel_reject_message.hpp"
+#include "../message/bulk_order_message.hpp"
+#include "../message/bulk_order_ack_message.hpp"
+#include "../message/amend_order_message.hpp"
+#include "../message/profit_report_message.hpp"
+#include "../message/clock_sync_message.hpp"
 #include "../config/simulationconfig.hpp"
 
 class StockExchange : public Agent
 {
 public:
 
-    StockExchange(NetworkEntity *network_entity, ExchangeConfigPtr config)
+    /** Creates the exchange for the given configuration. An exchange created for replaying a session 
+     *  has no trading window and sends nothing to traders; its session is driven by replay. */
+    StockExchange(NetworkEntity *network_entity, ExchangeConfigPtr config, bool replaying = false)
     : Agent(network_entity, std::static_pointer_cast<AgentConfig>(config)),
       exchange_name_{config->name},
-      order_books_{},
+      order_book_type_{config->order_book_type},
+      matching_mode_{config->matching_mode},
+      auction_interval_{config->auction_interval},
+      depth_levels_{config->depth_levels},
+      market_data_feed_{config->market_data_feed},
+      snapshot_interval_{config->snapshot_interval},
+      conflation_interval_{config->conflation_interval},
+      busy_poll_{config->busy_poll < 0 ? std::chrono::nanoseconds::max() : std::chrono::microseconds(config->busy_poll)},
+      order_rate_limit_{std::max(config->order_rate_limit, 0.0)},
+      order_burst_{config->order_burst > 0 ? static_cast<double>(config->order_burst) : config->order_rate_limit},
+      shared_memory_feed_{replaying ? std::string{} : config->shared_memory_feed},
+      fair_intake_{config->fair_intake},
+      csv_flush_interval_{config->csv_flush_interval},
+      output_format_{config->output_format},
+      tape_compression_{config->tape_compression},
+      market_data_recording_{config->market_data_recording},
+      lob_recording_{config->lob_recording},
+      output_dir_{config->output_dir},
+      upload_{replaying ? std::string{} : config->upload},
+      upload_streams_{config->upload_streams.begin(), config->upload_streams.end()},
+      expected_subscribers_{config->expected_subscribers},
+      checkpoint_file_{config->checkpoint_file},
+      agent_id_offset_{config->agent_id_offset},
+      profit_report_interval_{config->profit_report_interval},
+      trade_history_window_{static_cast<size_t>(std::max(config->trade_history_window, 0))},
+      record_orders_{config->record_orders && !replaying},
+      trace_{config->trace},
+      replaying_{replaying},
       subscribers_{},
       trade_tapes_{},
       market_data_feeds_{},
-      msg_queue_{},
-      random_generator_{std::random_device{}()}
+      random_generator_{SimulationClock::randomSeed()},
+      profit_ledger_{config->agent_id_offset},
+      profit_report_timer_{ioContext()}
     {
+      // Pinned before the session and writer threads start, as configured for the exchange or else for its node
+      std::string cpu_affinity = config->cpu_affinity.empty() ? ThreadPlacement::instance().spec() : config->cpu_affinity;
+      if (!cpu_affinity.empty())
+      {
+        placeThreads(cpu_affinity, config->tickers.size());
+      }
+
+      // Uncrosses and conflation windows are timed by the matching engine's waits, which do not run on virtual time
+      if (SimulationClock::isVirtual() && (matching_mode_ != MatchingMode::CONTINUOUS || conflation_interval_ > 0))
+      {
+        LOG_WARN("Virtual time sessions match continuously without conflation");
+        matching_mode_ = MatchingMode::CONTINUOUS;
+        conflation_interval_ = 0;
+      }
+
+      // Uncrosses are timed by the matching engine, which a replay runs without
+      if (replaying_ && matching_mode_ != MatchingMode::CONTINUOUS)
+      {
+        LOG_WARN("Replays match continuously");
+        matching_mode_ = MatchingMode::CONTINUOUS;
+      }
+
+      if (tape_compression_ != TapeCompression::NONE && !CSVWriter::COMPRESSION_SUPPORTED)
+      {
+        LOG_WARN("Built without zstd, writing uncompressed outputs");
+        tape_compression_ = TapeCompression::NONE;
+      }
+
+      if (!upload_.empty())
+      {
+        LOG_INFO("Uploading outputs to " << upload_ << " as they are written");
+      }
+
+      // Busy polling only pays with a core of its own for each matching engine
+      if (busy_poll_.count() > 0)
+      {
+        LOG_INFO("Matching engines busy-poll " << (config->busy_poll < 0 ? std::string{"without sleeping"} : "for " + std::to_string(config->busy_poll) + "us"));
+        if (cpu_affinity.empty()) LOG_WARN("Busy polling without cpu-affinity, so the matching engines may share cores with other threads");
+      }
+
       // Create message tape to log incoming messages
       createMessageTape();
 
       // Add all tickers to exchange
       for (auto ticker : config->tickers)
       {
-        addTradeableAsset(ticker);
+        addTradeableAsset(ticker, config->tickSizeFor(ticker), config->tradeStatsWindowFor(ticker));
+      }
+
+      // Open on the books of a saved session if configured
+      if (!config->restore_file.empty())
+      {
+        restoreCheckpoint(config->restore_file);
+      }
+
+      // Publish market data to multicast groups if configured
+      if (!config->multicast_group.empty())
+      {
+        assignMulticastGroups(config->multicast_group, config->tickers);
       }
 
       // Set trading window
-      setTradingWindow(config->connect_time, config->trading_time);
+      if (!replaying_)
+      {
+        setTradingWindow(config->connect_time, config->trading_time);
+      }
     }
 
     /** Starts the exchange. */
@@ -61,8 +171,9 @@ public:
     /** Gracefully terminates the exchange, freeing all memory. */
     void terminate() override;
 
-    /** Adds the given asset as tradeable and initialises an empty order book. */
-    void addTradeableAsset(std::string_view ticker);
+    /** Adds the given asset as tradeable and initialises an empty order book with the given tick size,
+     *  keeping its trade statistics over the given window. */
+    void addTradeableAsset(std::string_view ticker, double tick_size = 1.0, TradeStatsWindow trade_stats_window = TradeStatsWindow{});
 
     /** Waits for incoming connections then opens trading window for the specified duration (seconds). */
     void setTradingWindow(int connect_time, int trading_time);
@@ -76,33 +187,84 @@ public:
     /** Returns the pointer to the order book for the given ticker. */
     OrderBookPtr getOrderBookFor(std::string_view ticker);
 
+    /** Returns the order book of the ticker the exchange gave the given symbol ID. */
+    const OrderBookPtr& getOrderBookFor(uint16_t symbol) { return tickers_[symbol]->order_book; }
+
     /** Returns the trade tape writer for the given ticker. */
-    CSVWriterPtr getTradeTapeFor(std::string_view ticker);
+    RowWriterPtr getTradeTapeFor(std::string_view ticker);
 
     /** Returns the market data feed for the given ticker. */
-    CSVWriterPtr getMarketDataFeedFor(std::string_view ticker);
+    RowWriterPtr getMarketDataFeedFor(std::string_view ticker);
 
     /** Returns the LOB snapshot feed for the given ticker. */
-    CSVWriterPtr getLOBSnapshotFor(std::string_view ticker);
+    RowWriterPtr getLOBSnapshotFor(std::string_view ticker);
 
-    /** Adds the given subscriber to the market data subscribers list. */
-    void addSubscriber(std::string_view ticker, int subscriber_id, std::string_view address);
+    /** Adds the given subscriber to the market data subscribers list. 
+     *  A non-zero maximum update rate (per second) conflates the market data sent to the subscriber.
+     *  Subscribers accepting multicast are told to join the ticker's group, if it has one, instead.
+     *  Subscribers on this host, given by its host ID, are told to read the ticker's shared memory ring, if it has one, before either.
+     *  The market data of the ticker carries the groups of fields any of its subscribers uses. */
+    void addSubscriber(std::string_view ticker, int subscriber_id, std::string_view address, unsigned int max_update_rate = 0, bool multicast = false,
+        MarketDataFields fields = MarketDataFields::ALL, std::string_view host = {});
 
     /** Signal to technical indicator agents to start trading. */
     void signalTechnicalAgentsStarted(); 
 
+    /** Matches the given order messages in the calling thread, one after another as fast as they can be matched,
+     *  then closes the outputs. For exchanges created for replaying. Returns the trades executed, in the order they were. */
+    std::vector<TradePtr> replay(const std::vector<MessagePtr>& messages);
+
 private:
 
     /**
      *   HELPER METHODS
     */
 
-    /** Runs the matching engine. */
-    void runMatchingEngine();
+    /** Assigns each ticker a multicast group at the given base group address, on consecutive ports. */
+    void assignMulticastGroups(std::string_view base_group, const std::vector<std::string>& tickers);
+
+    /** Pins the threads of this node by role as the given CPU affinity says, including the network IO threads already running. */
+    void placeThreads(const std::string& cpu_affinity, size_t matching_threads);
+
+    /** Runs the matching engine for the ticker of the given symbol ID, the given index among the exchange's matching engines. */
+    void runMatchingEngine(uint16_t symbol, size_t index);
+
+    /** Hands the given message to its handler in the matching engine. */
+    void processMessage(const MessagePtr& msg);
+
+    /** Returns the ticker the given message is routed by, or nullopt if the matching engine does not handle messages of its type. */
+    static std::optional<std::string_view> tickerOf(const Message& message);
+
+    /** Gives the given message the symbol ID of the ticker it is routed by and returns it,
+     *  or returns nullopt if the ticker is not traded here or the matching engine does not handle messages of its type. */
+    std::optional<uint16_t> assignSymbol(Message& message);
+
+    /** Waits until every expected trader has subscribed, for the given number of seconds at most. */
+    void awaitSubscribers(int connect_time);
+
+    /** Waits for the given number of seconds, then until no new agent has connected for five seconds. */
+    void awaitConnections(int connect_time);
+
+    /** Routes the given order message to the matching engine of its ticker, unless its sender is over its rate limit. */
+    void routeToMatchingEngine(MessagePtr message);
+
+    /** Indicates whether the sender of the given message is within its rate limit, taking the message's cost from it.
+     *  Cancels and market data requests are always admitted, so that a trader over its limit can still pull its orders. */
+    bool admit(const Message& message);
+
+    /** Answers an order message turned away by the rate limit: orders are reported rejected, amends have their cancel rejected. */
+    void rejectOverLimit(MessagePtr message);
+
+    /** Reorders the batch so that the senders of its messages take turns, each sender's messages kept in the order they arrived. */
+    static void interleaveBySender(std::vector<MessagePtr>& batch, std::vector<std::pair<unsigned int, size_t>>& turns, 
+        std::vector<MessagePtr>& interleaved);
 
     /** Checks if the given order crosses the spread. */
     bool crossesSpread(LimitOrderPtr order);
 
+    /** Checks if an order of the ticker of the given symbol ID on the given side at the given price (ticks) would cross the spread. */
+    bool crossesSpread(uint16_t symbol, Order::Side side, int price);
+
     /** Matches the given order with the orders currently present in the OrderBook.
      *  Partial execution is allowed. */
     void matchOrder(LimitOrderPtr order);
@@ -111,55 +273,88 @@ private:
      *  Order must be executed in full. */
     void matchOrderInFull(LimitOrderPtr order);
 
+    /** Matches the given market order with the orders currently present in the OrderBook.
+     *  Any unfilled quantity is cancelled. Publishes market data after each fill if requested. */
+    void matchMarketOrder(MarketOrderPtr order, bool publish = true);
+
+    /** Uncrosses the order book of the given ticker at a single clearing price, then executes 
+     *  the market orders collected since the last uncross and publishes market data once. */
+    void runCallAuction(std::string_view ticker);
+
+    /** Returns the price (ticks) maximising the volume executable in an uncross of the given order book,
+     *  or nullopt if the book is not crossed. */
+    std::optional<int> calculateClearingPrice(OrderBookPtr order_book);
+
     /** Cancels the given order and sends a cancellation report to the sender. */
     void cancelOrder(OrderPtr order);
 
-    /** Executes the trade between the resting and aggressing orders. */
-    void executeTrade(LimitOrderPtr resting_order, OrderPtr aggressing_order, TradePtr trade);
+    /** Executes the trade between the resting and aggressing orders. Publishes market data if requested. */
+    void executeTrade(LimitOrderPtr resting_order, OrderPtr aggressing_order, TradePtr trade, bool publish = true);
 
     /** Adds the given trade to the trade tape. */
     void addTradeToTape(TradePtr trade);
 
-    /** Creates new trade tape and market data feed CSV files. */
+    /** Creates new trade tape, market data feed and LOB snapshot files in the configured output format. */
     void createDataFiles(std::string_view ticker);
 
+    /** Creates a writer for the file at the given path in the configured output format. */
+    RowWriterPtr createWriter(const std::string& path);
+
     /** Logs the given market data snapshot. */
     void addMarketDataSnapshot(MarketDataPtr data);
 
     /** Logs a snapshot of the LOB with selected attributes. */
     void addLOBSnapshot(LOBSnapshotPtr lob_data);
     
-    /** Calculate profits for csv file. */
-    void computeProfits();
-
     /** Write profits to CSV file. */
     void writeProfitsToCSV();
 
-    /** Print profits to stock exchange terminal. */
-    void printProfits();
-
-    /** Creates a new message tape CSV file. */
+    /** Creates a new message tape CSV file, and an order tape next to it if the order messages are recorded. */
     void createMessageTape();
 
+    /** Stops tracing and writes the session's trace under the traces directory. */
+    void exportTrace();
+
     /** Calculates p* (p equilibrium) */
     double calculatePEquilibrium(std::string_view ticker);
 
     /** Calculate Smith's Alpha */
     double calculateSmithsAlpha(std::string_view ticker);
 
-    /** Adds the given message to the message tape. */
+    /** Adds the given message to the message tape, and to the order tape if it is an order message and they are recorded. */
     void addMessageToTape(MessagePtr msg);
 
     /**
      *   MESSAGE SENDERS
     */
 
-    /** Sends execution report to the trader. */
-    void sendExecutionReport(std::string_view trader, ExecutionReportMessagePtr msg);
+    /** Sends execution report to the trader, or adds it to the acknowledgement of the bulk order being handled if it is the sender's. */
+    void sendExecutionReport(int trader_id, ExecutionReportMessagePtr msg);
+
+    /** Rejects the cancel of an order of the ticker that is not in the book, in the acknowledgement of the bulk order being handled if it is the sender's. */
+    void sendCancelReject(std::string_view ticker, int trader_id, int order_id);
 
-    /** Publishes market data to all subscribers. */
+    /** Records the current market data of the ticker, to be sent to subscribers by the next flush. */
     void publishMarketData(std::string_view ticker, Order::Side side); 
 
+    /** Sends the market data recorded since the last flush as a single update to all subscribers of the ticker. */
+    void flushMarketData(std::string_view ticker);
+
+    /** Flushes the recorded market data once the conflation interval has elapsed, and catches up 
+     *  rate-limited subscribers that skipped updates. */
+    void publishDueMarketData(std::string_view ticker);
+
+    /** Returns when market data of the ticker is next due to be sent, or nullopt if nothing is waiting. */
+    std::optional<std::chrono::steady_clock::time_point> nextMarketDataDue(std::string_view ticker);
+
+    /** Sends the given market data update to the subscribers of the ticker. Rate-limited subscribers get the 
+     *  latest full snapshot instead once their interval has elapsed. If stale_only, only rate-limited 
+     *  subscribers that skipped updates are sent to. */
+    void broadcastMarketData(std::string_view ticker, MessagePtr update, bool stale_only = false);
+
+    /** Sets the address at the given index of a fan-out list, reusing the string already there. */
+    static void assignAddress(std::vector<std::string>& addresses, size_t index, const std::string& address);
+
     /** Broadcasts the given message to all subscribers of the given ticker. */
     void broadcastToSubscribers(std::string_view ticker, MessagePtr msg);
 
@@ -176,6 +371,26 @@ private:
     /** Handles a cancel order message. */
     void onCancelOrder(CancelOrderMessagePtr msg);
 
+    /** Handles an amend order message. */
+    void onAmendOrder(AmendOrderMessagePtr msg);
+
+    /** Handles a bulk order message in one pass: its cancels, then its amends, then its new orders, then one acknowledgement to the sender. */
+    void onBulkOrder(BulkOrderMessagePtr msg);
+
+    /** Adds a new limit order to the book, matching it first if it crosses the spread. */
+    void processLimitOrder(LimitOrderPtr order);
+
+    /** Removes the order with the given ID from the book of the ticker of the given symbol ID and cancels it, 
+     *  or rejects the cancel if it is not there. */
+    void processCancel(uint16_t symbol, int order_id, Order::Side side, int sender_id);
+
+    /** Changes the price and remaining quantity of the order with the given ID in the book of the ticker of the given symbol ID, 
+     *  in place unless the new price crosses the spread, when it is matched as a new order. Rejects the amend if the order is not there. */
+    void processAmend(uint16_t symbol, int order_id, Order::Side side, double price, int quantity, int sender_id);
+
+    /** Handles a request to resend the latest market data, replying with a full snapshot over TCP. */
+    void onMarketDataRequest(MarketDataRequestMessagePtr msg);
+
     /** Handles a subscription to market data request message. */
     void onSubscribe(SubscribeMessagePtr msg);
 
@@ -185,9 +400,38 @@ private:
     /** Checks the type of the incoming broadcast and makes a callback. */
     void handleBroadcastFrom(std::string_view sender, MessagePtr message) override;
 
+    /** Traders address the exchange by its name. */
+    bool takesUnaddressedMessages() override { return true; };
+
+    /** Appends the depth of each ticker's matching queue, the messages matched and the orders resting on each side. */
+    void appendMetrics(std::string& out) override;
+
     /** Ensure directory to store data files exists. */
     void confirmDirectory(const std::string& dirPath);
 
+    /** Returns the path of the output directory with the given name, under the configured output directory. */
+    std::string outputDirectory(const std::string& name);
+
+    /** Returns the path the given file of the output directory with the given name is written to: under that directory,
+     *  or the object keeping its place under the configured upload prefix if the directory's files are uploaded. */
+    std::string outputPath(const std::string& name, const std::string& file);
+
+    /** Saves the books, trade statistics, profits and id counters to the checkpoint file at the given path. 
+     *  The matching engines must have stopped. */
+    void saveCheckpoint(const std::string& path);
+
+    /** Restores the books, trade statistics, profits and id counters saved in the checkpoint file at the given path. */
+    void restoreCheckpoint(const std::string& path);
+
+    /** Starts streaming snapshots of the profits to the orchestrator that configured the exchange, if any. */
+    void startProfitReports();
+
+    /** Sends a snapshot of the profits to the orchestrator, final once the session has ended. */
+    void reportProfits(bool final);
+
+    /** Tells the orchestrator that configured the exchange that its trading session has ended, with the final profits. */
+    void reportSessionEnd();
+
     /**
      *   PRIVATE MEMBERS
     */
@@ -195,69 +439,279 @@ private:
     /** The unique name of the exchange*/
     std::string exchange_name_;
 
-    /** Order books for each ticker traded. */
-    std::unordered_map<std::string, OrderBookPtr> order_books_;
+    /** The order book implementation used for each ticker. */
+    OrderBookType order_book_type_;
+
+    /** Whether orders are matched on arrival or in periodic call auctions. */
+    MatchingMode matching_mode_;
+
+    /** Time between call auction uncrosses (milliseconds). */
+    int auction_interval_;
+
+    /** Number of price levels published in market depth updates; depth is not published if zero. */
+    int depth_levels_;
+
+    /** Whether market data is published in full or as deltas with periodic full snapshots. */
+    MarketDataFeedType market_data_feed_;
+
+    /** Number of updates between full snapshots in the delta feed. */
+    int snapshot_interval_;
+
+    /** Minimum time between market data updates of a ticker (milliseconds); updates are conflated per message if zero. */
+    int conflation_interval_;
+
+    /** How long the matching engines busy-poll their inboxes before sleeping, zero to sleep at once. */
+    std::chrono::nanoseconds busy_poll_;
+
+    /** Order messages per second each trader may send, and at once, before the rest are rejected; no limit if the rate is zero. */
+    double order_rate_limit_;
+    double order_burst_;
+
+    /** Directory each ticker's shared memory ring is created in, empty if market data is not published to shared memory. */
+    std::string shared_memory_feed_;
+
+    /** Slots of each ticker's shared memory ring, and the largest update a slot holds; a compact update takes 192 bytes. */
+    static constexpr uint32_t SHARED_MEMORY_SLOTS = 4096;
+    static constexpr uint32_t SHARED_MEMORY_SLOT_SIZE = 2048;
+
+    /** Whether the matching engines interleave each batch they take by sender, so that no trader's burst delays the others'. */
+    bool fair_intake_;
+
+    /** Rate limit of each trader that sent order messages, by agent ID. */
+    std::unordered_map<int, TokenBucket> order_buckets_;
+
+    /** Guards the rate limits, as messages are admitted on the network threads. */
+    std::mutex order_buckets_mutex_;
+
+    /** Number of order messages rejected for being over their sender's rate limit. */
+    std::atomic<uint64_t> rejected_over_limit_ = 0;
+
+    /** Milliseconds between background writes of the CSV outputs, 0 to write every row synchronously. */
+    std::chrono::milliseconds csv_flush_interval_;
+
+    /** Format of the trade tapes, market data feeds and LOB snapshots. */
+    OutputFormat output_format_;
+
+    /** CSV outputs written zstd-compressed. */
+    TapeCompression tape_compression_;
+
+    /** Which market data updates and LOB snapshots of each ticker are written, applied before they are formatted. */
+    RecordingPolicy market_data_recording_;
+    RecordingPolicy lob_recording_;
+
+    /** Directory the outputs are written under, empty for the working directory. */
+    std::string output_dir_;
+
+    /** s3://bucket/prefix the files of the upload streams are uploaded under as they are written, empty to keep them local. */
+    std::string upload_;
+    std::unordered_set<std::string> upload_streams_;
+
+    /** IDs of the traders trading opens for once all have subscribed, empty to wait until connections stop instead. */
+    std::vector<int> expected_subscribers_;
+
+    /** Checkpoint file the state of the exchange is saved to when the session ends, empty not to save. */
+    std::string checkpoint_file_;
+
+    /** Offset of the agent IDs of this trial from those configured, removed from the IDs kept in checkpoints. */
+    int agent_id_offset_;
+
+    /** Milliseconds between snapshots of the profits streamed to the orchestrator, 0 for only the final one. */
+    int profit_report_interval_;
+
+    /** Trades of each ticker kept in memory, older ones spilled to disk; 0 to keep all in memory. */
+    size_t trade_history_window_;
+
+    /** Whether the order messages matched are kept in full on the order tape. */
+    bool record_orders_;
+
+    /** Whether the stages of the session's message handling are traced. */
+    bool trace_;
+
+    /** Whether the exchange replays a recorded session, sending nothing to traders. */
+    bool replaying_;
+
+    /** Time between checks for the subscriptions of the expected traders. */
+    static constexpr std::chrono::milliseconds SUBSCRIBER_POLL_INTERVAL {10};
+
+    /** Latest market data recorded but not yet sent for each ticker, or nullptr if there is none. */
+    std::unordered_map<std::string, MarketDataPtr> pending_market_data_;
+
+    /** Time the market data of each ticker was last sent. */
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> last_market_data_flush_;
+
+    /** A subscriber of a ticker and how it is sent market data. */
+    struct Subscriber
+    {
+        int id;
+        std::string address;
+        MarketDataFields fields = MarketDataFields::ALL; // groups of fields it uses
+        bool multicast = false; // sent updates through the ticker's multicast group instead
+        bool shared_memory = false; // reads updates from the ticker's shared memory ring instead
+        bool backlogged = false; // its connection was backlogged and it skipped updates since
+        std::chrono::steady_clock::duration min_interval {}; // between the snapshots it is sent if rate-limited, zero if sent every update
+        std::chrono::steady_clock::time_point last_sent {}; // of its latest snapshot if rate-limited
+        bool stale = false; // skipped an update since last_sent if rate-limited
+    };
+
+    /** The subscribers of a ticker in a flat list, with the space the matching engine fans market data out in. */
+    struct SubscriberList
+    {
+        std::vector<Subscriber> subscribers; // in the order they subscribed
+        std::unordered_map<int, size_t> positions; // in subscribers, by ID
+        size_t rate_limited = 0;
+
+        /** The order the subscribers are sent the current update in, shuffled in place for every update. */
+        std::vector<uint32_t> order;
+
+        /** Addresses sent the current update and snapshot. Only used by the ticker's matching engine, 
+         *  outside the subscribers mutex; the strings keep their capacity between updates, so filling them does not allocate. */
+        std::vector<std::string> update_addresses;
+        std::vector<std::string> snapshot_addresses;
+
+        /** Addresses of the subscribers reading the shared memory ring, sent the current update instead if it does not fit in a slot. */
+        std::vector<std::string> ring_addresses;
+    };
+
+    /** Multicast group address market data is published to for each ticker, if multicast is enabled. */
+    std::unordered_map<std::string, std::string> multicast_groups_;
+
+    /** Groups of fields the market data of each ticker carries: those used by any of its subscribers, read by its matching engine. */
+    std::unordered_map<std::string, std::atomic<MarketDataFields>> market_data_fields_;
+
+    /** Groups of fields the market data tape records, computed whether or not subscribers use them. */
+    static constexpr MarketDataFields TAPE_FIELDS = MarketDataFields::DEPTH;
+
+    /** Last market data sent and its sequence number for each ticker. */
+    std::unordered_map<std::string, MarketDataPtr> last_market_data_;
+    std::unordered_map<std::string, unsigned long> market_data_sequence_;
+
+    /** Immediate-or-cancel limit orders waiting in the current call auction batch of each ticker. */
+    std::unordered_map<std::string, std::vector<LimitOrderPtr>> auction_ioc_orders_;
+
+    /** The sender of the bulk order being handled for each ticker and the acknowledgement collecting its reports, 
+     *  or a null acknowledgement outside bulk orders. Only touched by the ticker's matching engine. */
+    struct BulkOrderAck
+    {
+        int sender_id = -1;
+        BulkOrderAckMessagePtr ack;
+    };
+    std::unordered_map<std::string, BulkOrderAck> bulk_order_acks_;
+
+    /** Market orders waiting in the current call auction batch of each ticker. */
+    std::unordered_map<std::string, std::vector<MarketOrderPtr>> auction_market_orders_;
 
     /** Trade tape for each ticker traded. */
-    std::unordered_map<std::string, CSVWriterPtr> trade_tapes_;
+    std::unordered_map<std::string, RowWriterPtr> trade_tapes_;
 
     /** Market data feed snapshots for each ticker traded. */
-    std::unordered_map<std::string, CSVWriterPtr> market_data_feeds_;
+    std::unordered_map<std::string, RowWriterPtr> market_data_feeds_;
 
     /** LOB snapshot feed for each ticker traded. */
-    std::unordered_map<std::string, CSVWriterPtr> lob_snapshot_;
+    std::unordered_map<std::string, RowWriterPtr> lob_snapshot_;
 
     std::unordered_map<std::string, CSVWriterPtr> profits_writer_;
 
     /** Message tape for each message received. */
     CSVWriterPtr message_tape_;
 
-    /** Subscribers for each ticker traded. */
-    std::unordered_map<std::string, std::unordered_map<int, std::string>> subscribers_;
+    /** Tape of the order messages matched with their payloads, guarded by the message tape mutex; null unless recorded. */
+    OrderTapePtr order_tape_;
+
+    /** Subscribers for each ticker traded, guarded by the subscribers mutex but for their fan-out addresses. */
+    std::unordered_map<std::string, SubscriberList> subscribers_;
 
-    /** Thread-safe FIFO queue for incoming messages to be processed by the matching engine. */
-    SyncQueue<MessagePtr> msg_queue_;
+    /** Counts kept by each ticker's matching engine for the metrics, read from the IO threads. */
+    struct MatchingStats
+    {
+        std::atomic<uint64_t> matched = 0;
+        std::atomic<int> bids = 0; // resting orders as of the last batch matched
+        std::atomic<int> asks = 0;
+    };
+
+    /** The state of a ticker its matching engine works on. */
+    struct TickerState
+    {
+        std::string ticker;
+        uint16_t symbol;
+        OrderBookPtr order_book;
+
+        /** Lock-free FIFO queue of incoming messages, drained in batches by the matching engine. */
+        MPSCQueue<MessagePtr> inbox;
+
+        /** In virtual time, the number of messages in the inbox holding the clock until the matching engine has handled them. */
+        std::atomic<int> work_held = 0;
+
+        MatchingStats stats;
+
+        /** Market data written once for the subscribers on this host, null if not published to shared memory. Written by the matching engine. */
+        SharedMemoryRingPtr ring;
+    };
+
+    /** Hashes tickers given as strings or string views alike, so that looking one up does not copy it. */
+    struct TickerHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view ticker) const { return std::hash<std::string_view>{}(ticker); }
+    };
+
+    /** State of each ticker traded, indexed by the symbol ID the exchange gave it when configured; null for IDs of no ticker here.
+     *  Messages are given the ID as they are routed, so that the matching engines look nothing up by ticker. */
+    std::vector<std::unique_ptr<TickerState>> tickers_;
+
+    /** Symbol ID of each ticker traded, for the messages and outputs that name tickers. */
+    std::unordered_map<std::string, uint16_t, TickerHash, std::equal_to<>> symbols_;
+
+    /** Maximum number of messages the matching engine takes from its queue per wakeup. */
+    static constexpr size_t MAX_MATCHING_BATCH = 256;
+
+    /** Guards the subscribers and their shuffling, shared by all matching engines. */
+    std::mutex subscribers_mutex_;
+
+    /** Guards the message tape, shared by all matching engines. */
+    std::mutex message_tape_mutex_;
+
+    /** Guards the agent names and profits, shared by all matching engines. */
+    std::mutex agents_mutex_;
 
     OrderFactory order_factory_;
     TradeFactory trade_factory_;
 
-    /** Conditional variable signalling whether trading window is open */
-    bool trading_window_open_ = false;
+    /** State of the trading session, read by the matching engines without locking. */
+    std::atomic<TradingSessionState> session_state_ = TradingSessionState::PRE_OPEN;
+
+    /** Conditional variable signalling that the trading window has opened or is closing */
     std::mutex trading_window_mutex_;
     std::condition_variable trading_window_cv_;
     std::thread* trading_window_thread_ = nullptr;
-    std::thread* matching_engine_thread_ = nullptr;
+    std::vector<std::thread*> matching_engine_threads_;
 
     /** Used for randomising the order of UDP broadcasts */
     std::mt19937 random_generator_;
 
-    /** Add trade to in-memory list */
-    std::unordered_map<std::string, std::vector<TradePtr>> in_memory_trades_;
+    /** Trades of each ticker, the latest in memory and older ones spilled to disk. */
+    std::unordered_map<std::string, TradeHistoryPtr> trade_histories_;
 
-    /** Profit attributes. */
-    std::unordered_map<int, double> agent_profits_; 
+    /** Running p* and Smith's alpha for each ticker traded. */
+    std::unordered_map<std::string, EquilibriumTracker> equilibrium_trackers_;
+
+    /** Names of the agents that have subscribed, by ID. */
     std::unordered_map<int, std::string> agent_names_;
-    std::unordered_map<std::string, double> total_profits_;
-    std::unordered_map<std::string, double> buyer_profits_;
-    std::unordered_map<std::string, double> seller_profits_;
-    std::unordered_set<int> received_profit_traders_;
-    std::mutex profit_mutex_;
-    std::condition_variable profit_cv_;
-    size_t expected_trader_count_ = 0; 
+
+    /** Profits of the agents, kept as trades execute and streamed to the orchestrator every profit_report_interval_ milliseconds. */
+    ProfitLedger profit_ledger_;
+    JitteredTimer profit_report_timer_;
 
     /** Legacy vs Technical agents. */
     bool technical_traders_ready_ = false; 
     std::unordered_set<std::string> legacy_trader_types_ = {"zic", "zip", "shvr", "deeplstm", "deepxgb"};
-    std::chrono::time_point<std::chrono::high_resolution_clock> ready_timestamp_;
+    SimulationClock::duration ready_timestamp_;
     const int TECHNICAL_READY_DELAY_SECONDS = 4; 
 
     /** Simulation config params. */
     SimulationConfigPtr simulation_config_;
 
-    std::unordered_map<std::string, double> agent_profits_by_name_;
-  
-    std::chrono::high_resolution_clock::time_point trading_session_start_time_;
-    std::unordered_map<std::string, std::chrono::high_resolution_clock::time_point> last_trade_time_;
+    SimulationClock::duration trading_session_start_time_;
+    std::unordered_map<std::string, std::optional<SimulationClock::duration>> last_trade_time_;
 
 };
 
@@ -3,19 +3,72 @@
 #include <random>
 
 #include "traderagent.hpp"
+#include "../utilities/logger.hpp"
 
 void TraderAgent::terminate() 
 {
-    // Only safe after delay is finished
-    if (delay_thread_ != nullptr) 
-    {
-        delay_thread_->join();
-        delete(delay_thread_);
-    }
+    // A delayed start still pending must not start trading afterwards
+    std::unique_lock lock{mutex_};
+    terminated_ = true;
+    lock.unlock();
+    stopActiveTrading();
+    clock_sync_timer_.cancel();
+}
+
+void TraderAgent::startActiveTrading(unsigned int interval_ms, double rel_jitter, std::function<void()> trade)
+{
+    trading_timer_.start(std::chrono::milliseconds(interval_ms), rel_jitter, std::move(trade));
+}
+
+void TraderAgent::stopActiveTrading()
+{
+    trading_timer_.stop();
 }
 
 std::optional<MessagePtr> TraderAgent::handleMessageFrom(std::string_view sender, MessagePtr message)
 {
+    // Market data for the subscription is published to a multicast group
+    if (message->type == MessageType::MULTICAST_GROUP)
+    {
+        MulticastGroupMessagePtr msg = std::static_pointer_cast<MulticastGroupMessage>(message);
+        LOG_INFO("Joining multicast group " << msg->group_address << " for " << msg->ticker);
+        joinMulticastGroup(msg->group_address);
+        return std::nullopt;
+    }
+
+    // Market data for the subscription is written to a shared memory ring on this host
+    if (message->type == MessageType::SHARED_MEMORY_FEED)
+    {
+        SharedMemoryFeedMessagePtr msg = std::static_pointer_cast<SharedMemoryFeedMessage>(message);
+        try
+        {
+            attachSharedMemoryFeed(sender, msg->path, msg->token);
+            LOG_INFO("Reading market data for " << msg->ticker << " from shared memory ring " << msg->path);
+        }
+        catch (std::exception& e)
+        {
+            // As when the host ID is shared with a container that does not share its /dev/shm
+            LOG_WARN("Receiving market data for " << msg->ticker << " over the network: " << e.what());
+            shared_memory_feeds_.store(false, std::memory_order_relaxed);
+            subscribeToMarket(sender, msg->ticker);
+        }
+        return std::nullopt;
+    }
+
+    // Clock synchronisation runs before and after the trading window
+    if (message->type == MessageType::CLOCK_SYNC)
+    {
+        onClockSync(std::static_pointer_cast<ClockSyncMessage>(message));
+        return std::nullopt;
+    }
+
+    // Snapshots requested after a gap in the UDP feed arrive over TCP, and are handled like the feed itself
+    if (message->type == MessageType::MARKET_DATA)
+    {
+        handleBroadcastFrom(sender, message);
+        return std::nullopt;
+    }
+
     // If trading window (for this trader) not yet open ignore message
     std::unique_lock lock{mutex_};
     if (!trading_window_open_) return std::nullopt;
@@ -25,25 +78,35 @@ std::optional<MessagePtr> TraderAgent::handleMessageFrom(std::string_view sender
     {
         case MessageType::EXECUTION_REPORT:
         {
-            ExecutionReportMessagePtr msg = std::dynamic_pointer_cast<ExecutionReportMessage>(message);
-            if (msg == nullptr) {
-                throw std::runtime_error("Failed to cast message to ExecutionReportMessage");
-            }
+            ExecutionReportMessagePtr msg = std::static_pointer_cast<ExecutionReportMessage>(message);
             onExecutionReport(sender, msg);
             break;
         }
         case MessageType::CANCEL_REJECT:
         {
-            CancelRejectMessagePtr msg = std::dynamic_pointer_cast<CancelRejectMessage>(message);
-            if (msg == nullptr) {
-                throw std::runtime_error("Failed to cast message to CancelRejectMessage");
-            }
+            CancelRejectMessagePtr msg = std::static_pointer_cast<CancelRejectMessage>(message);
             onCancelReject(sender, msg);
             break;
         }
+        case MessageType::BULK_ORDER_ACK:
+        {
+            BulkOrderAckMessagePtr msg = std::static_pointer_cast<BulkOrderAckMessage>(message);
+            for (ExecutionReportMessagePtr const& report : msg->reports)
+            {
+                onExecutionReport(sender, report);
+            }
+            for (int order_id : msg->rejected_cancels)
+            {
+                CancelRejectMessagePtr reject = std::make_shared<CancelRejectMessage>();
+                reject->sender_id = msg->sender_id;
+                reject->order_id = order_id;
+                onCancelReject(sender, reject);
+            }
+            break;
+        }
         default:
         {
-            std::cout << "Unknown message type" << "\n";
+            LOG_WARN("Unknown message type");
             break;
         }
     }
@@ -53,33 +116,60 @@ std::optional<MessagePtr> TraderAgent::handleMessageFrom(std::string_view sender
 
 void TraderAgent::handleBroadcastFrom(std::string_view sender, MessagePtr message)
 {
+    // Broadcasts passed on by the relay are the exchange's, and gaps in them are recovered from the exchange
+    if (!relay_.empty() && sender == relay_)
+    {
+        sender = exchange_;
+    }
+
     switch (message->type)
     {
         case MessageType::MARKET_DATA: 
         {
+            // Keep the local copy current so that subsequent deltas can be applied
+            MarketDataMessagePtr msg = std::static_pointer_cast<MarketDataMessage>(message);
+            if (!storeMarketData(sender, msg)) return;
+
+            // If trading window (for this trader) not yet open ignore message
+            std::unique_lock lock{mutex_};
+            if (!trading_window_open_) return;
+            lock.unlock();
+
+            onMarketData(sender, msg);
+            break;
+        }
+        case MessageType::MARKET_DATA_DELTA: 
+        {
+            MarketDataMessagePtr msg = applyMarketDataDelta(sender, std::static_pointer_cast<MarketDataDeltaMessage>(message));
+            if (msg == nullptr) return;
+
             // If trading window (for this trader) not yet open ignore message
             std::unique_lock lock{mutex_};
             if (!trading_window_open_) return;
             lock.unlock();
 
-            MarketDataMessagePtr msg = std::dynamic_pointer_cast<MarketDataMessage>(message);
-            if (msg == nullptr) {
-                throw std::runtime_error("Failed to cast message to MarketDataMessage");
-            }
             onMarketData(sender, msg);
             break;
         }
+        case MessageType::MARKET_DEPTH: 
+        {
+            // If trading window (for this trader) not yet open ignore message
+            std::unique_lock lock{mutex_};
+            if (!trading_window_open_) return;
+            lock.unlock();
+
+            MarketDepthMessagePtr msg = std::static_pointer_cast<MarketDepthMessage>(message);
+            onMarketDepth(sender, msg);
+            break;
+        }
         case MessageType::EVENT:
         {
-            EventMessagePtr msg = std::dynamic_pointer_cast<EventMessage>(message);
-            if (msg == nullptr) {
-                throw std::runtime_error("Failed to cast message to EventMessage");
-            }
+            EventMessagePtr msg = std::static_pointer_cast<EventMessage>(message);
 
             if (msg->event_type == EventMessage::EventType::ORDER_INJECTION_START)
             {
                 // Do nothing: Traders should not react to order injection events
-                std::cout << "[TraderAgent] Ignoring ORDER_INJECTION_START event.\n";
+                LOG_INFO("[TraderAgent] Ignoring ORDER_INJECTION_START event.");
             }
             else if (msg->event_type == EventMessage::EventType::TRADING_SESSION_START)
             {
@@ -92,7 +182,7 @@ void TraderAgent::handleBroadcastFrom(std::string_view sender, MessagePtr messag
         } 
         default:
         {
-            std::cout << "Unknown message type" << "\n";
+            LOG_WARN("Unknown message type");
             break;
         }
     }
@@ -100,14 +190,175 @@ void TraderAgent::handleBroadcastFrom(std::string_view sender, MessagePtr messag
 
 std::string TraderAgent::getAgentName() const { return agent_name_; }
 
+bool TraderAgent::storeMarketData(std::string_view exchange, MarketDataMessagePtr msg)
+{
+    std::string key = marketDataKey(exchange, msg->data->ticker);
+    std::unique_lock<std::mutex> lock(market_data_mutex_);
+    auto sequence = market_data_sequence_.find(key);
+    if (sequence != market_data_sequence_.end() && msg->sequence <= sequence->second)
+    {
+        return false;
+    }
+
+    // Rate-limited and conflated snapshots skip sequence numbers by design, and a snapshot fills any gap
+    market_data_[key] = *msg->data;
+    market_data_sequence_[key] = msg->sequence;
+    snapshot_requests_.erase(key);
+    return true;
+}
+
+std::string TraderAgent::marketDataKey(std::string_view exchange, std::string_view ticker) const
+{
+    // Broadcasts from an address missing from the address book come from the exchange we trade on
+    std::string_view exchange_name = (exchange == "unknown" && !exchange_.empty()) ? std::string_view{exchange_} : exchange;
+    return std::string{exchange_name} + "/" + std::string{ticker};
+}
+
+MarketDataMessagePtr TraderAgent::applyMarketDataDelta(std::string_view sender, MarketDataDeltaMessagePtr msg)
+{
+    std::string key = marketDataKey(sender, msg->ticker);
+    std::unique_lock<std::mutex> lock(market_data_mutex_);
+    auto sequence = market_data_sequence_.find(key);
+    if (sequence == market_data_sequence_.end())
+    {
+        // Joined mid-stream or still recovering from a gap: wait for a full snapshot
+        lock.unlock();
+        requestMarketDataSnapshot(sender, msg->ticker);
+        return nullptr;
+    }
+    if (msg->sequence != sequence->second + 1)
+    {
+        // Missed an update: the local copy is stale until a full snapshot arrives
+        if (msg->sequence > sequence->second)
+        {
+            LOG_WARN("[TraderAgent] Market data gap for " << key << ": expected " 
+            << sequence->second + 1 << ", received " << msg->sequence);
+            market_data_sequence_.erase(sequence);
+            lock.unlock();
+            requestMarketDataSnapshot(sender, msg->ticker);
+        }
+        return nullptr;
+    }
+
+    MarketData& data = market_data_.at(key);
+    msg->applyTo(data);
+    sequence->second = msg->sequence;
+
+    MarketDataMessagePtr data_msg = std::make_shared<MarketDataMessage>();
+    data_msg->data = std::make_shared<MarketData>(data);
+    data_msg->sequence = msg->sequence;
+    return data_msg;
+}
+
+void TraderAgent::requestMarketDataSnapshot(std::string_view exchange, std::string_view ticker)
+{
+    // Broadcasts from an address missing from the address book come from the exchange we trade on
+    std::string exchange_name {exchange == "unknown" ? std::string_view{exchange_} : exchange};
+    if (exchange_name.empty()) return;
+
+    std::string key = marketDataKey(exchange_name, ticker);
+    std::unique_lock<std::mutex> lock(market_data_mutex_);
+    SimulationClock::duration now = SimulationClock::now();
+    auto request = snapshot_requests_.find(key);
+    if (request != snapshot_requests_.end() && now - request->second < SNAPSHOT_REQUEST_TIMEOUT) return;
+    snapshot_requests_.insert_or_assign(key, now);
+
+    auto sequence = market_data_sequence_.find(key);
+    MarketDataRequestMessagePtr msg = std::make_shared<MarketDataRequestMessage>();
+    msg->ticker = std::string{ticker};
+    msg->last_sequence = (sequence != market_data_sequence_.end()) ? sequence->second : 0;
+    lock.unlock();
+
+    Agent::sendMessageTo(routeFor(exchange_name, ticker), std::static_pointer_cast<Message>(msg), true);
+}
+
+std::string_view TraderAgent::routeFor(std::string_view exchange, std::string_view ticker) const
+{
+    if (routes_.empty() || exchange != exchange_) return exchange;
+
+    std::string_view shard = routes_.shardFor(ticker);
+    if (shard.empty() || shard == own_shard_) return exchange;
+    return shard;
+}
+
 void TraderAgent::subscribeToMarket(std::string_view exchange, std::string_view ticker)
 {
     SubscribeMessagePtr msg = std::make_shared<SubscribeMessage>();
     msg->ticker = std::string{ticker};
     msg->address = myAddr() + std::string{":"} + std::to_string(myPort());
     msg->agent_name = getAgentName();
+    msg->max_update_rate = max_update_rate_;
+    msg->multicast = true;
+    msg->fields = marketDataFields();
+
+    // The relay passes on the market data of the exchange node the trader connects to, and only that
+    std::string_view route = routeFor(exchange, ticker);
+    if (!relay_.empty() && exchange == exchange_ && route == exchange_)
+    {
+        connect(relay_addr_, relay_, [this, msg]() {
+            Agent::sendMessageTo(relay_, std::static_pointer_cast<Message>(msg));
+        });
+        startClockSync();
+        return;
+    }
+
+    // Shared memory would skip the clock waiting for the feed in virtual time and any link emulated to the exchange
+    if (shared_memory_feeds_.load(std::memory_order_relaxed) && !SimulationClock::isVirtual() && !emulatesLinks() && !runsInProcess(route))
+    {
+        msg->host = SharedMemoryRing::hostId();
+    }
 
-    Agent::sendMessageTo(exchange, std::dynamic_pointer_cast<Message>(msg));
+    Agent::sendMessageTo(route, std::dynamic_pointer_cast<Message>(msg));
+
+    if (exchange == exchange_)
+    {
+        startClockSync();
+    }
+}
+
+void TraderAgent::startClockSync()
+{
+    if (SimulationClock::isVirtual() || runsInProcess(exchange_)) return;
+
+    // One agent per process synchronises, as the correction applies to every timestamp of the process
+    int no_owner = -1;
+    if (!clock_sync_owner_.compare_exchange_strong(no_owner, agent_id)) return;
+
+    sendClockSync();
+}
+
+void TraderAgent::sendClockSync()
+{
+    std::unique_lock<std::mutex> lock(clock_sync_mutex_);
+    ClockSyncMessagePtr msg = std::make_shared<ClockSyncMessage>();
+    msg->origin = SimulationClock::systemNanos();
+    Agent::sendMessageTo(exchange_, std::dynamic_pointer_cast<Message>(msg));
+
+    ++clock_sync_rounds_;
+    clock_sync_timer_.expires_after((clock_sync_rounds_ < CLOCK_SYNC_BURST) ? CLOCK_SYNC_BURST_INTERVAL : CLOCK_SYNC_INTERVAL);
+    lock.unlock();
+
+    clock_sync_timer_.async_wait([this](const boost::system::error_code& error) {
+        if (!error) sendClockSync();
+    });
+}
+
+void TraderAgent::onClockSync(ClockSyncMessagePtr msg)
+{
+    int64_t received = SimulationClock::systemNanos();
+
+    std::unique_lock<std::mutex> lock(clock_sync_mutex_);
+    if (!clock_offset_.addSample(msg->origin, msg->receive, msg->timestamp_sent, received)) return;
+    std::optional<ClockOffsetEstimator::Estimate> estimate = clock_offset_.estimate();
+    lock.unlock();
+
+    bool first = !SimulationClock::correction().has_value();
+    SimulationClock::setCorrection(SimulationClock::Correction{estimate->offset, estimate->drift, estimate->at});
+    if (first)
+    {
+        LOG_INFO("Timestamps corrected onto the clock of " << exchange_ << ": offset " << estimate->offset 
+            << "ns, round trip " << estimate->delay << "ns");
+    }
 }
 
 // Random order size
@@ -117,8 +368,7 @@ int TraderAgent::getRandomOrderSize()
     int max_quantity = 500; // Max order size
 
     // Create random generator 
-    static std::random_device rd; 
-    static std::mt19937 gen(rd());
+    static std::mt19937 gen(SimulationClock::randomSeed());
 
     // Uniform distribution
 std::uniform_int_distribution<> dist(base_quantity, max_quantity);
@@ -138,7 +388,7 @@ void TraderAgent::placeLimitOrder(std::string_view exchange, Order::Side side, s
     msg->time_in_force = time_in_force;
     msg->agent_name = getAgentName();
 
-    Agent::sendMessageTo(exchange, std::dynamic_pointer_cast<Message>(msg));
+    Agent::sendMessageTo(routeFor(exchange, ticker), std::dynamic_pointer_cast<Message>(msg));
 }
 
 void TraderAgent::placeMarketOrder(std::string_view exchange, Order::Side side, std::string_view ticker, int quantity, double priv_value)
@@ -150,7 +400,7 @@ void TraderAgent::placeMarketOrder(std::string_view exchange, Order::Side side,
     msg->priv_value = priv_value;
     msg->agent_name = getAgentName(); 
 
-    Agent::sendMessageTo(exchange, std::dynamic_pointer_cast<Message>(msg));
+    Agent::sendMessageTo(routeFor(exchange, ticker), std::dynamic_pointer_cast<Message>(msg));
 }
 
 void TraderAgent::cancelOrder(std::string_view exchange, Order::Side side, std::string_view ticker, int order_id)
@@ -161,7 +411,27 @@ void TraderAgent::cancelOrder(std::string_view exchange, Order::Side side, std::
     msg->side = side;
     msg->agent_name = getAgentName(); 
 
-    Agent::sendMessageTo(exchange, std::dynamic_pointer_cast<Message>(msg));
+    Agent::sendMessageTo(routeFor(exchange, ticker), std::dynamic_pointer_cast<Message>(msg));
+}
+
+void TraderAgent::amendOrder(std::string_view exchange, Order::Side side, std::string_view ticker, int order_id, int quantity, double price)
+{
+    AmendOrderMessagePtr msg = std::make_shared<AmendOrderMessage>();
+    msg->order_id = order_id;
+    msg->ticker = std::string{ticker};
+    msg->side = side;
+    msg->quantity = quantity;
+    msg->price = price;
+    msg->agent_name = getAgentName(); 
+
+    Agent::sendMessageTo(routeFor(exchange, ticker), std::dynamic_pointer_cast<Message>(msg));
+}
+
+void TraderAgent::submitBulkOrder(std::string_view exchange, BulkOrderMessagePtr msg)
+{
+    msg->agent_name = getAgentName();
+
+    Agent::sendMessageTo(routeFor(exchange, msg->ticker), std::dynamic_pointer_cast<Message>(msg));
 }
 
 void TraderAgent::addDelayedStart(int delay_in_seconds)
@@ -178,14 +448,20 @@ bool TraderAgent::technical_agents_started_ = false;
 
 void TraderAgent::signalTradingStart()
 {
-    delay_thread_ = new std::thread([&](){
-        if (start_delay_in_seconds_ > 0) 
-        {
-            std::cout << "Delayed trader start: waiting " << start_delay_in_seconds_ << " to start...\n";
-            std::this_thread::sleep_for(std::chrono::seconds(start_delay_in_seconds_));
-        }
+    if (start_delay_in_seconds_ > 0) 
+    {
+        LOG_INFO("Delayed trader start: waiting " << start_delay_in_seconds_ << " to start...");
+    }
+
+    start_timer_.expires_after(std::chrono::seconds(start_delay_in_seconds_));
+    start_timer_.async_wait([this](const boost::system::error_code& error){
+        if (error) return;
+
+        std::unique_lock terminated_lock{mutex_};
+        if (terminated_) return;
+        terminated_lock.unlock();
 
-        std::cout << "Trader starts now.\n";
+        LOG_INFO("Trader starts now.");
 
         if (!is_legacy_trader_ && start_delay_in_seconds_ == TECHNICAL_AGENT_DELAY_SECONDS) // When delay reached, signal to exchange
         { 
@@ -199,7 +475,7 @@ void TraderAgent::signalTradingStart()
             
             // Set the static flag
             technical_agents_started_ = true;
-            std::cout << " Sending technical agents started message to exchange" << std::endl;
+            LOG_INFO(" Sending technical agents started message to exchange");
         }
         onTradingStart();
 
@@ -225,8 +501,8 @@ void TraderAgent::bookkeepTrade(const TradePtr & trade, const LimitOrderPtr & or
     n_trades++; 
     //profit_per_time = balance / (current_time - birth_time_); 
 
-    blotter_.push_back(trade);
-    std::cout << "Trade booked: quantity: " << trade->quantity << " @ price: " << trade->price << " for profit: " << profit << "\n";
-    std::cout << "Order price: " << order->price << ", Trade price: " << trade->price << "\n";
+    blotter_.add(trade);
+    LOG_DEBUG("Trade booked: quantity: " << trade->quantity << " @ price: " << trade->price << " for profit: " << profit);
+    LOG_DEBUG("Order price: " << order->price << ", Trade price: " << trade->price);
 
 }
\ No newline at end of file
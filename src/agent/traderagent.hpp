@@ -5,9 +5,18 @@
 
 #include "agent.hpp"
 #include "../config/traderconfig.hpp"
+#include "../utilities/jitteredtimer.hpp"
+#include "../utilities/simulationtimer.hpp"
+#include "../utilities/clockoffsetestimator.hpp"
 #include "../trade/trade.hpp"
+#include "../trade/tradehistory.hpp"
 #include "../order/order.hpp"
 #include "../message/market_data_message.hpp"
+#include "../message/market_depth_message.hpp"
+#include "../message/market_data_delta_message.hpp"
+#include "../message/multicast_group_message.hpp"
+#include "../message/shared_memory_feed_message.hpp"
+#include "../message/market_data_request_message.hpp"
 #include "../message/exec_report_message.hpp"
 #include "../message/subscribe_message.hpp"
 #include "../message/limit_order_message.hpp"
@@ -15,6 +24,10 @@
 #include "../message/cancel_order_message.hpp"
 #include "../message/event_message.hpp"
 #include "../message/cancel_reject_message.hpp"
+#include "../message/bulk_order_message.hpp"
+#include "../message/bulk_order_ack_message.hpp"
+#include "../message/amend_order_message.hpp"
+#include "../message/clock_sync_message.hpp"
 
 class TraderAgent : public Agent
 {
@@ -24,18 +37,37 @@ public:
     virtual ~TraderAgent() = default;
 
     TraderAgent(NetworkEntity *network_entity, AgentConfigPtr config)
-    : Agent(network_entity, std::static_pointer_cast<AgentConfig>(config))
+    : Agent(network_entity, std::static_pointer_cast<AgentConfig>(config)),
+      start_timer_{ioContext()},
+      trading_timer_{ioContext()},
+      clock_sync_timer_{ioContext()}
     {
         if (auto trader_config = std::dynamic_pointer_cast<TraderConfig>(config))
         {
             exchange_ = trader_config->exchange_name;
+            max_update_rate_ = trader_config->max_update_rate;
+            routes_ = trader_config->routes;
+            relay_ = trader_config->relay_name;
+            relay_addr_ = trader_config->relay_addr;
+
+            // The shard trading the trader's own ticker is reached under the venue's name, the others under their own
+            for (auto const& [shard, shard_addr] : routes_.shards())
+            {
+                if (shard_addr == trader_config->exchange_addr)
+                {
+                    own_shard_ = shard;
+                    continue;
+                }
+                connect(shard_addr, shard, []{});
+            }
         }
     }
 
     /** Gracefully terminates the trader, freeing all memory. */
     virtual void terminate() override;
 
-    /** Subscribes to updates for the stock with the given ticker at the given exchange. */
+    /** Subscribes to updates for the stock with the given ticker at the given exchange, 
+     *  at no more than the configured maximum update rate. */
     void subscribeToMarket(std::string_view exchange, std::string_view ticker);
 
     /** Places a limit order for the given ticker at the given exchange. */
@@ -48,6 +80,13 @@ public:
     // /** Cancels the order with the given id at the given exchange. */
     void cancelOrder(std::string_view exchange, Order::Side side, std::string_view ticker, int order_id);
 
+    /** Changes the price and remaining quantity of the resting order with the given id at the given exchange, keeping its id. */
+    void amendOrder(std::string_view exchange, Order::Side side, std::string_view ticker, int order_id, int quantity, double price);
+
+    /** Submits the cancels, amends and new orders of the bulk order to the given exchange in a single message. 
+     *  Its execution reports and cancel rejects are handed to the callbacks one by one, as if sent separately. */
+    void submitBulkOrder(std::string_view exchange, BulkOrderMessagePtr msg);
+
     /** The trader will remain idle and no handlers will be called until the specified duration after trading start. */
     void addDelayedStart(int delay_in_seconds);
 
@@ -61,6 +100,9 @@ public:
     /** Check if agent is a legacy agent. */
     bool isLegacyTrader() const;
 
+    /** Returns the groups of market data fields the trader uses beyond the top of the book, all that its exchanges need send it. */
+    virtual MarketDataFields marketDataFields() const { return MarketDataFields::ALL; }
+
 protected:
 
     /** Derived classes must implement these: */
@@ -74,24 +116,55 @@ protected:
     /** The callback function called when new market data update is received. */
     virtual void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) = 0;
 
+    /** The callback function called when new market depth update is received. Ignored unless overridden. */
+    virtual void onMarketDepth(std::string_view exchange, MarketDepthMessagePtr msg) {};
+
     /** The callback function called when the execution report message is received. */
     virtual void onExecutionReport(std::string_view exchange, ExecutionReportMessagePtr msg) = 0;
 
     /** The callback function called when the cancel order message is rejected. */
     virtual void onCancelReject(std::string_view exchange, CancelRejectMessagePtr msg) = 0;
 
+    /** Applies the given delta from the sending exchange to the local copy of the ticker's market data on it and returns the updated data,
+     *  or nullptr if no snapshot has been received yet or an update was missed since the last one. 
+     *  In that case a snapshot is requested from the sending exchange. */
+    MarketDataMessagePtr applyMarketDataDelta(std::string_view sender, MarketDataDeltaMessagePtr msg);
+
+    /** Stores the given snapshot from the exchange as the local copy of the ticker's market data on it.
+     *  Returns false if it is older than the local copy, as UDP updates may arrive out of order. */
+    bool storeMarketData(std::string_view exchange, MarketDataMessagePtr msg);
+
+    /** Returns the key of the ticker's market data on the exchange. Each exchange numbers the updates of its tickers
+     *  on its own, so the local copies and their sequence numbers are kept apart for each exchange. */
+    std::string marketDataKey(std::string_view exchange, std::string_view ticker) const;
+
+    /** Returns the exchange node to send messages about the given ticker to: the shard trading it if the exchange
+     *  is the venue the trader's exchange belongs to, otherwise the exchange itself. */
+    std::string_view routeFor(std::string_view exchange, std::string_view ticker) const;
+
+    /** Asks the exchange to resend the ticker's market data over TCP, unless a request is already outstanding. */
+    void requestMarketDataSnapshot(std::string_view exchange, std::string_view ticker);
+
     /** Bookkeeping trades for profit calculations. */
     void bookkeepTrade(const TradePtr & trade, const LimitOrderPtr & order);
 
+    /** Calls trade on a timer of the IO context, first straight away and then every interval_ms 
+     *  jittered by up to rel_jitter either way, until stopActiveTrading is called. */
+    void startActiveTrading(unsigned int interval_ms, double rel_jitter, std::function<void()> trade);
+
+    /** Stops the calls started by startActiveTrading, waiting for a call in progress to return. */
+    void stopActiveTrading();
+
     /** Checks the type of the incoming message and makes a callback. */
     std::optional<MessagePtr> handleMessageFrom(std::string_view sender, MessagePtr message) override;
 
     /** Checks the type of the incoming broadcast and makes a callback. */
     void handleBroadcastFrom(std::string_view sender, MessagePtr message) override;
 
-    /** Bookkeeping function for individual traders */
+    /** Bookkeeping function for individual traders; the blotter keeps the latest trades, as the exchange keeps them all. */
+    static constexpr size_t BLOTTER_WINDOW = 256;
     unsigned int n_trades; 
-    std::vector<TradePtr> blotter_; 
+    TradeHistory blotter_{BLOTTER_WINDOW}; 
     double balance = 0.0; 
     
     /** Steady state for legacy vs technical trading agents. */
@@ -103,6 +176,14 @@ protected:
     /** Name of exchange the trader is connecting to */
     std::string exchange_; 
 
+    /** Shards of the exchange if it is a venue partitioned across several nodes, and the one reached under its name. */
+    RoutingTable routes_;
+    std::string own_shard_;
+
+    /** Relay the trader takes the market data of its exchange from, and its address, or empty to take it from the exchange. */
+    std::string relay_;
+    std::string relay_addr_;
+
 private:
 
     /** Signals that trading has started and starts sending callbacks to handlers. */
@@ -114,11 +195,59 @@ private:
     /** TODO: Signals that trading has ended and stops sending callbacks to handlers. */
     // void signalTradingEnd();
 
+    /** Starts synchronising the timestamps of the process with the clock of the trader's exchange, unless another agent
+     *  of the process already does, the exchange runs in this process or the process runs on virtual time. */
+    void startClockSync();
+
+    /** Sends the next clock synchronisation request and schedules the one after. */
+    void sendClockSync();
+
+    /** Adds the round trip completed by the exchange's answer and corrects the process's timestamps by the new estimate. */
+    void onClockSync(ClockSyncMessagePtr msg);
+
     /** Used for delayed start of the trader. */
     bool trading_window_open_ = false;
+    bool terminated_ = false;
     unsigned int start_delay_in_seconds_ = 0;
     std::mutex mutex_;
-    std::thread* delay_thread_;
+    SimulationTimer start_timer_;
+
+    /** Runs the trading decisions of derived traders on the IO context instead of a thread per trader. */
+    JitteredTimer trading_timer_;
+
+    /** Paces the clock synchronisation requests, and estimates the exchange's clock from their round trips. */
+    SimulationTimer clock_sync_timer_;
+    ClockOffsetEstimator clock_offset_;
+    std::mutex clock_sync_mutex_;
+    unsigned int clock_sync_rounds_ = 0;
+
+    /** The agent synchronising the process's timestamps, -1 before one has started. */
+    static inline std::atomic<int> clock_sync_owner_ = -1;
+
+    /** Requests sent quickly at first, for a usable estimate before trading starts, then at the steady interval. */
+    static constexpr unsigned int CLOCK_SYNC_BURST = 8;
+    static constexpr std::chrono::milliseconds CLOCK_SYNC_BURST_INTERVAL {100};
+    static constexpr std::chrono::milliseconds CLOCK_SYNC_INTERVAL {1000};
+
+    /** Maximum number of market data updates per second requested on subscription, 0 for every update. */
+    unsigned int max_update_rate_ = 0;
+
+    /** Whether the trader offers to read market data from shared memory, until a ring it is offered fails to open. */
+    std::atomic<bool> shared_memory_feeds_ = true;
+
+    /** Local copy of the latest market data and its sequence number for each ticker on each exchange, by marketDataKey,
+     *  rebuilt from delta updates. */
+    std::unordered_map<std::string, MarketData> market_data_;
+    std::unordered_map<std::string, unsigned long> market_data_sequence_;
+
+    /** When a snapshot was last requested for each ticker on each exchange with a gap that has not been filled yet. */
+    std::unordered_map<std::string, SimulationClock::duration> snapshot_requests_;
+
+    /** Guards the local market data, which snapshots over TCP and updates over UDP may reach concurrently. */
+    std::mutex market_data_mutex_;
+
+    /** How long to wait for a requested snapshot before asking again. */
+    static constexpr std::chrono::milliseconds SNAPSHOT_REQUEST_TIMEOUT {1000};
     
 };
 
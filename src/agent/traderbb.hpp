@@ -1,11 +1,10 @@
 #ifndef TRADER_BOLLINGER_BANDS_HPP
 #define TRADER_BOLLINGER_BANDS_HPP
 
-#include <vector>
-#include <numeric>
 #include <algorithm>
 #include <stack> 
 #include "traderagent.hpp"
+#include "../indicators/variance.hpp"
 
 class TraderBollingerBands : public TraderAgent
 {
@@ -21,7 +20,8 @@ public:
       std_dev_multiplier_{std_dev_multiplier},
       cancelling_{config->cancelling},
       trade_interval_ms_{config->trade_interval}, 
-      random_generator_{std::random_device{}()},
+      prices_{static_cast<size_t>(lookback_period)},
+      random_generator_{SimulationClock::randomSeed()},
       mutex_{}
     {
         // Mark as legacy agent
@@ -38,15 +38,7 @@ public:
 
     std::string getAgentName() const override { return "bb"; }
 
-    void terminate() override
-    {
-        if (trading_thread_ != nullptr)
-        {
-            trading_thread_->join();
-            delete trading_thread_;
-        }
-        TraderAgent::terminate();
-    }
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TOP; }
 
     void onTradingStart() override
     {
@@ -62,6 +54,7 @@ public:
         std::cout << "Trading window ended.\n";
         is_trading_ = false;
         lock.unlock();
+        stopActiveTrading();
     }
 
     void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override
@@ -133,48 +126,37 @@ private:
 
     void activelyTrade()
     {
-        trading_thread_ = new std::thread([&, this]()
-        {
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (is_trading_)
+        startActiveTrading(trade_interval_ms_, REL_JITTER, [this]() {
             {
-                lock.unlock();
+                // Process any pending customer orders to initiate orders
+                if (!customer_orders_.empty())
                 {
-                    // Process any pending customer orders to initiate orders
-                    if (!customer_orders_.empty())
-                    {
-                        if (closing_prices_.size() >= lookback_period_)
-                        {
-                            double sma = calculateSMA(closing_prices_);
-                            double std_dev = calculateStandardDeviation(closing_prices_, sma);
-                            double upper_band = sma + (std_dev_multiplier_ * std_dev);
-                            double lower_band = sma - (std_dev_multiplier_ * std_dev);
-                            std::cout << "Calculated Bollinger Bands: Upper: " << upper_band << " | Lower: " << lower_band << "\n";
-                            placeOrder(upper_band, lower_band);  
-                        }
-                        // Else directly process customer orders to bootstrap market data
-                        else
-                        {
-                            processCustomerOrder();
-                        }
-                    }
-                    // Apply strat
-                    else if (closing_prices_.size() >= lookback_period_)
+                    if (prices_.ready())
                     {
-                        double sma = calculateSMA(closing_prices_);
-                        double std_dev = calculateStandardDeviation(closing_prices_, sma);
+                        double sma = prices_.mean();
+                        double std_dev = prices_.standardDeviation();
                         double upper_band = sma + (std_dev_multiplier_ * std_dev);
                         double lower_band = sma - (std_dev_multiplier_ * std_dev);
                         std::cout << "Calculated Bollinger Bands: Upper: " << upper_band << " | Lower: " << lower_band << "\n";
-                        placeOrder(upper_band, lower_band);
+                        placeOrder(upper_band, lower_band);  
+                    }
+                    // Else directly process customer orders to bootstrap market data
+                    else
+                    {
+                        processCustomerOrder();
                     }
                 }
-
-                sleep();
-                lock.lock();
+                // Apply strat
+                else if (prices_.ready())
+                {
+                    double sma = prices_.mean();
+                    double std_dev = prices_.standardDeviation();
+                    double upper_band = sma + (std_dev_multiplier_ * std_dev);
+                    double lower_band = sma - (std_dev_multiplier_ * std_dev);
+                    std::cout << "Calculated Bollinger Bands: Upper: " << upper_band << " | Lower: " << lower_band << "\n";
+                    placeOrder(upper_band, lower_band);
+                }
             }
-            lock.unlock();
-            std::cout << "Finished actively trading.\n";
         });
     }
 
@@ -278,47 +260,14 @@ private:
             return;
         }
 
-        closing_prices_.push_back(msg->data->last_price_traded);
-
-        if (closing_prices_.size() > lookback_period_)
-        {
-            closing_prices_.erase(closing_prices_.begin());
-        }
+        prices_.push(msg->data->last_price_traded);
 
         last_market_data_ = msg->data;
     }
 
-    void sleep()
-    {
-        // Generate a random jitter
-        std::uniform_real_distribution<> dist(-REL_JITTER, REL_JITTER);
-        unsigned long jitter = dist(random_generator_);
-        unsigned long sleep_time_ms = std::round(trade_interval_ms_ * (1.0+jitter));
-
-        // Sleep for specified duration
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
-    }
-
-    double calculateSMA(const std::vector<double>& prices)
-    {
-        double sum = std::accumulate(prices.begin(), prices.end(), 0.0); // Sum all elements in prices (begin and end define range to sum over). 0.0 = initial value of sum
-        return sum / prices.size(); // Calculate Simple Moving Average; sum divided by number of elements in prices
-    }
-
-    double calculateStandardDeviation(const std::vector<double>& prices, double sma)
-    {
-        double sum = 0.0; // Initialise sum to 0
-        for (double price : prices) // For each price in prices
-        {
-            sum += (price - sma) * (price - sma); // Add square of difference between price and SMA to sum (sum of squared differences)
-        }
-        return std::sqrt(sum / (prices.size() - 1)); // Calculate Standard Deviation; square root of sum divided by number of elements in prices minus 1; sample variance
-    }
-
     unsigned long long timeNow()
     {
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+        return SimulationClock::nowNanos();
     }
 
     std::string exchange_;
@@ -329,11 +278,10 @@ private:
     double std_dev_multiplier_;
     bool cancelling_;
     unsigned int trade_interval_ms_ = 500; 
-    std::vector<double> closing_prices_;
+    indicators::RollingVariance prices_; // Mean and standard deviation of the last lookback_period_ prices
     std::optional<int> last_accepted_order_id_ = std::nullopt;
     std::mt19937 random_generator_;
     std::mutex mutex_;
-    std::thread* trading_thread_ = nullptr;
     bool is_trading_ = false;
     unsigned long next_trade_timestamp_;
     constexpr static double REL_JITTER = 0.25;
@@ -3,8 +3,9 @@
 
 #include "traderagent.hpp"
 #include <cmath>
-#include <vector>
 #include <algorithm>
+#include "../indicators/ema.hpp"
+#include "../indicators/atr.hpp"
 
 class TraderMACD : public TraderAgent
 {
@@ -23,7 +24,12 @@ public:
       threshold_{threshold},
       n_to_smooth_{n_to_smooth},
       lookback_period_{lookback_period},
-      random_generator_{std::random_device{}()},
+      short_ema_{short_length},
+      long_ema_{long_length},
+      signal_ema_{signal_length},
+      macd_smoothing_{std::max(n_to_smooth, 1)},
+      atr_{static_cast<size_t>(lookback_period)},
+      random_generator_{SimulationClock::randomSeed()},
       mutex_{}
     {
         // Mark as legacy agent
@@ -40,15 +46,7 @@ public:
 
     std::string getAgentName() const override { return "macd"; }
 
-    void terminate() override
-    {
-        if (trading_thread_ != nullptr)
-        {
-            trading_thread_->join();
-            delete(trading_thread_);
-        }
-        TraderAgent::terminate();
-    }
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TRADE_STATS; }
 
     void onTradingStart() override
     {
@@ -65,6 +63,7 @@ public:
         // Delay shutdown to allow profit message to be sent completely.
         lock.unlock();
         is_trading_ = false;
+        stopActiveTrading();
     }
 
     void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override
@@ -136,63 +135,29 @@ private:
 
     void activelyTrade()
     {
-        trading_thread_ = new std::thread([&, this]()
-        {
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (is_trading_)
+        startActiveTrading(trade_interval_ms_, REL_JITTER, [this]() {
+            // Process any pending customer orders to initiate orders
+            if (!customer_orders_.empty())
             {
-                lock.unlock();
-
-                // Process any pending customer orders to initiate orders
-                if (!customer_orders_.empty())
+                if (atr_.ready()) 
                 {
-                    if (prices_.size() >= lookback_period_) 
-                    {
-                        // Compute MACD (and signal) on the local copy.
-                        auto [macd_line, signal_line] = calculateMACD(prices_);
-                        
-                        // Additional safety check
-                        if (!macd_line.empty() && !signal_line.empty())
-                        {
-                            double macd = macd_line.back();
-                            double signal = signal_line.back();
-                            double histogram = macd - signal;
-                            
-                            std::cout << "MACD: " << macd << ", Signal: " << signal << ", Histogram: " << histogram << ", Threshold: " << threshold_ << "\n";
-                            
-                            placeOrder(histogram, prices_.back());
-                        }
-                    }
-                    // Else directly process customer orders to bootstrap market data
-                    else
-                    {
-                        processCustomerOrder();
-                    }
+                    double histogram = macd_ - signal_;
+                    std::cout << "MACD: " << macd_ << ", Signal: " << signal_ << ", Histogram: " << histogram << ", Threshold: " << threshold_ << "\n";
+                    placeOrder(histogram, last_price_);
                 }
-                // Apply normal strategy when enough data is available
-                else if (prices_.size() >= lookback_period_) 
+                // Else directly process customer orders to bootstrap market data
+                else
                 {
-                    // Compute MACD (and signal) on the local copy.
-                    auto [macd_line, signal_line] = calculateMACD(prices_);
-                    
-                    // Additional safety check
-                    if (!macd_line.empty() && !signal_line.empty())
-                    {
-                        double macd = macd_line.back();
-                        double signal = signal_line.back();
-                        double histogram = macd - signal;
-                        
-                        std::cout << "MACD: " << macd << ", Signal: " << signal << ", Histogram: " << histogram << ", Threshold: " << threshold_ << "\n";
-                        
-                        placeOrder(histogram, prices_.back());
-                    }
+                    processCustomerOrder();
                 }
-
-                sleep();
-                lock.lock();
             }
-            lock.unlock();
-            std::cout << "Finished actively trading.\n";
+            // Apply normal strategy when enough data is available
+            else if (atr_.ready()) 
+            {
+                double histogram = macd_ - signal_;
+                std::cout << "MACD: " << macd_ << ", Signal: " << signal_ << ", Histogram: " << histogram << ", Threshold: " << threshold_ << "\n";
+                placeOrder(histogram, last_price_);
+            }
         });
     }
 
@@ -286,105 +251,37 @@ private:
     void reactToMarket(MarketDataMessagePtr msg)
     {
         double price = msg->data->last_price_traded;
-        prices_.push_back(price);
-        highs_.push_back(msg->data->high_price);
-        lows_.push_back(msg->data->low_price);
-        closes_.push_back(price);
-        updateRollingWindow(msg->data->high_price, msg->data->low_price);
-
-        if (prices_.size() > lookback_period_)
-        {
-            prices_.erase(prices_.begin());
-            highs_.erase(highs_.begin());
-            lows_.erase(lows_.begin());
-            closes_.erase(closes_.begin());
-        }
+        updateMACD(price, msg->data->high_price, msg->data->low_price);
+        last_price_ = price;
+        prices_seen_++;
 
         last_market_data_ = msg->data;
-        std::cout << "Stored Market Data - Price: " << price << ", Prices size: " << prices_.size() << "\n";
+        std::cout << "Stored Market Data - Price: " << price << ", Prices seen: " << prices_seen_ << "\n";
     }
 
-    void updateRollingWindow(double high_price, double low_price)
+    // Updates the EMAs, the ATR over the lookback period, the MACD and its signal line with the latest period
+    void updateMACD(double price, double high_price, double low_price)
     {
-        high_window_.push_back(high_price);
-        low_window_.push_back(low_price);
-        if (high_window_.size() > lookback_period_)
-        {
-            high_window_.pop_front();
-            low_window_.pop_front();
-        }
-    }
+        short_ema_.push(price);
+        long_ema_.push(price);
+        atr_.push(high_price, low_price, price);
 
-    std::pair<std::vector<double>, std::vector<double>> calculateMACD(const std::vector<double>& prices_)
-    {   
-        // Store MACD and signal line values for each price point
-        std::vector<double> macd_line(prices_.size(), 0.0); // Initialise MACD line with zeros 
-        std::vector<double> signal_line(prices_.size(), 0.0); // Initialise signal line with zeros
-        if(prices_.empty()) return {macd_line, signal_line};
-
-        double long_sum = prices_[0]; // Initialise long EMA sum with first price (26-period)
-        double short_sum = prices_[0]; // Initialise short EMA sum with first price (12-period)
-        double long_alpha = 2.0 / (long_length_ + 1.0); // Calculate alpha for long EMA
-        double short_alpha = 2.0 / (short_length_ + 1.0);  // Calculate alpha for short EMA
-        double signal_alpha = 2.0 / (signal_length_ + 1.0); // Calculate alpha for signal line (9-period)
-
-        // Calculate MACD line and EMAs for each price point. 
-        for (int icase = 1; icase < prices_.size(); ++icase) // Loop through each price point
-        {
-            long_sum = long_alpha * prices_[icase] + (1.0 - long_alpha) * long_sum; // Calculate long EMA
-            short_sum = short_alpha * prices_[icase] + (1.0 - short_alpha) * short_sum; // Calculate short EMA
-            double diff = 0.5 * (long_length_ - 1.0) - 0.5 * (short_length_ - 1.0); // Calculate difference between long and short EMA lengths
-            double denom = std::sqrt(std::abs(diff)); // Normalisation factor for MACD using EMA difference
-            denom *= ATR(icase, lookback_period_);
-            if (std::abs(denom) < 1e-10) // Avoid divide-by-zero
-                denom = 1e-10;  
-            macd_line[icase] = (short_sum - long_sum) / (denom + 1.e-15); // MACD normalisation 
-            macd_line[icase] = 100.0 * normal_cdf(1.0 + macd_line[icase]) - 50.0; // Normalise MACD to 0-100 scale (applies normal cumulative distributin function to MACD; CDF) 
-
-            //std::cout << "Price[" << icase << "]: " << prices_[icase] << ", Short EMA: " << short_sum << ", Long EMA: " << long_sum << ", MACD: " << macd_line[icase] << "\n";
-        }
+        double diff = 0.5 * (long_length_ - 1.0) - 0.5 * (short_length_ - 1.0); // Calculate difference between long and short EMA lengths
+        double denom = std::sqrt(std::abs(diff)) * atr_.value(); // Normalisation factor for MACD using EMA difference and volatility
+        if (std::abs(denom) < 1e-10) // Avoid divide-by-zero
+            denom = 1e-10;
+        double macd = (short_ema_.value() - long_ema_.value()) / (denom + 1.e-15); // MACD normalisation
+        macd = 100.0 * normal_cdf(1.0 + macd) - 50.0; // Normalise MACD to 0-100 scale (applies normal cumulative distributin function to MACD; CDF)
 
-        signal_line[0] = macd_line[0]; // Calculate the signal line as an EMA of the MACD line
-        for (int icase = 1; icase < macd_line.size(); ++icase) // Loop through each price point
-        {
-            signal_line[icase] = signal_alpha * macd_line[icase] + (1.0 - signal_alpha) * signal_line[icase - 1]; // Calculate signal line as EMA of MACD line using signal_alpha as smoothing factor
-        }
+        signal_ema_.push(macd); // Signal line is an EMA of the MACD line
+        signal_ = signal_ema_.value();
 
-        if (n_to_smooth_ > 1) // If additional smoothing steps are required
+        if (n_to_smooth_ > 1) // If additional smoothing is required, subtract the smoothed MACD line from the MACD line
         {
-            double alpha = 2.0 / (n_to_smooth_ + 1.0); // Calculate alpha for additional smoothing
-            double smoothed = macd_line[0]; // Initialise smoothed MACD line with first MACD value
-            for (int icase = 1; icase < macd_line.size(); ++icase) // Loop through each price point
-            {
-                smoothed = alpha * macd_line[icase] + (1.0 - alpha) * smoothed; // Apply additional smoothing to MACD line
-                macd_line[icase] -= smoothed; // Subtract smoothed MACD line from MACD line
-            }
+            macd_smoothing_.push(macd);
+            macd -= macd_smoothing_.value();
         }
-
-        return {macd_line, signal_line}; // Return MACD line and signal line
-    }
-
-
-    double ATR(int end, int lookback)
-    {
-        if (end < lookback) { // If not enough values to calculate ATR
-            lookback = end + 1; // Adjust lookback if not enough values to include all available data points 
-        }
-    
-        double atr = 0.0; // Initialise ATR with zero (accumulate total true range over lookback period)
-        int start = end - lookback + 1; // Calculate start index for ATR calculation for rolling window 
-
-        for (int i = start; i <= end; ++i) // Loop through rolling window to calculate the TR (True Range) for each period and accumulate total ATR
-        {
-            //high_window_[i - start] = highs_[i]; = high price for the current time period, low_window_[i - start] = lows_[i]; = low price for the current time period, closes_[i - 1] = closes_[i - 1]; = closing price for the previous time period
-            double high_low = high_window_[i - start] - low_window_[i - start]; // High-low range for the current time period (difference between high and low prices for current period)
-            double high_close = std::abs(high_window_[i - start] - closes_[i - 1]); // Abs. difference between current high price and previous closing price
-            double low_close = std::abs(low_window_[i - start] - closes_[i - 1]); // Abs. difference between current low price and previous closing price
-            atr += std::max({high_low, high_close, low_close}); // Calculate the True Range (TR) for each period and accumulate total ATR
-            //std::cout << "ATR: " << atr << "\n";
-        }
-
-        return atr / lookback; // Return the average ATR over the lookback period
+        macd_ = macd;
     }
 
     // Calculate the normal CDF for given value 
@@ -393,17 +290,6 @@ private:
         return 0.5 * std::erfc(-value / std::sqrt(2.0)); // Gaussian CDF (error function) for normal distribution. Result scaled by 0.5 to normalise to 0-1 scale
     } 
 
-    void sleep()
-    {
-        // Generate a random jitter
-        std::uniform_real_distribution<> dist(-REL_JITTER, REL_JITTER);
-        unsigned long jitter = dist(random_generator_);
-        unsigned long sleep_time_ms = std::round(trade_interval_ms_ * (1.0+jitter));
-
-        // Sleep for specified duration
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
-    }
-
     // Member variables.
     std::string exchange_;
     std::string ticker_;
@@ -417,17 +303,19 @@ private:
     double threshold_;
     int n_to_smooth_;
     int lookback_period_;
-    std::vector<double> prices_;
-    std::vector<double> highs_;
-    std::vector<double> lows_;
-    std::vector<double> closes_;
-    std::deque<double> high_window_;
-    std::deque<double> low_window_;
+    indicators::EMA short_ema_;
+    indicators::EMA long_ema_;
+    indicators::EMA signal_ema_;
+    indicators::EMA macd_smoothing_;
+    indicators::ATR atr_; // Ready once lookback_period_ periods are seen
+    double macd_ = 0.0;
+    double signal_ = 0.0;
+    double last_price_ = 0.0;
+    unsigned long prices_seen_ = 0;
     std::optional<int> last_accepted_order_id_ = std::nullopt;
     std::optional<MarketDataPtr> last_market_data_;
     std::mt19937 random_generator_;
     std::mutex mutex_;
-    std::thread* trading_thread_ = nullptr;
     bool is_trading_ = false;
     unsigned long next_trade_timestamp_;
     constexpr static double REL_JITTER = 0.25;
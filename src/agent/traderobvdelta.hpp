@@ -3,8 +3,8 @@
 
 #include "traderagent.hpp"
 #include <cmath>
-#include <vector>
 #include <algorithm>
+#include "../indicators/obv.hpp"
 
 class TraderOBVDelta : public TraderAgent
 {
@@ -20,7 +20,9 @@ public:
       lookback_length_{lookback_length},
       delta_length_{delta_length},
       threshold_{threshold}, 
-      random_generator_{std::random_device{}()},
+      obv_{static_cast<size_t>(lookback_length), PRICE_CHANGE_THRESHOLD},
+      obv_delta_{static_cast<size_t>(delta_length)},
+      random_generator_{SimulationClock::randomSeed()},
       mutex_{}
     {
         // Mark as legacy agent
@@ -37,15 +39,7 @@ public:
 
     std::string getAgentName() const override { return "obvd"; }
 
-    void terminate() override
-    {
-        if (trading_thread_ != nullptr)
-        {
-            trading_thread_->join();
-            delete(trading_thread_);
-        }
-        TraderAgent::terminate();
-    }
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TOP; }
 
     void onTradingStart() override
     {
@@ -62,6 +56,7 @@ public:
         // Delay shutdown to allow profit message to be sent completely.
         lock.unlock();
         is_trading_ = false;
+        stopActiveTrading();
     }
 
     void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override
@@ -131,44 +126,30 @@ private:
 
     void activelyTrade()
     {
-        trading_thread_ = new std::thread([&, this]()
-        {
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (is_trading_)
+        startActiveTrading(trade_interval_ms_, REL_JITTER, [this]() {
+            // Process any pending customer orders
+            if (!customer_orders_.empty())
             {
-                lock.unlock();
-                
-                // Process any pending customer orders
-                if (!customer_orders_.empty())
+                // If we have enough data, use OBV Delta strategy with customer order parameters
+                if (obv_.ready())
                 {
-                    // If we have enough data, use OBV Delta strategy with customer order parameters
-                    if (close_prices_.size() >= lookback_length_ && volumes_.size() >= lookback_length_)
-                    {
-                        std::vector<double> delta_obv_values = calculateOBVDelta();  
-                        placeOrder(delta_obv_values.back());
-                    }
-                    // Else directly process customer orders to bootstrap market data
-                    else
-                    {
-                        processCustomerOrder();
-                    }
-                }
-                // Normal OBV Delta strategy for regular trading
-                else if (close_prices_.size() >= lookback_length_ && volumes_.size() >= lookback_length_)
-                {
-                    std::vector<double> delta_obv_values = calculateOBVDelta();  
-                    placeOrder(delta_obv_values.back());
+                    placeOrder(obv_delta_.value());
                 }
+                // Else directly process customer orders to bootstrap market data
                 else
                 {
-                    std::cout << "Not enough market data for OBV Delta calculation.\n";
+                    processCustomerOrder();
                 }
-                
-                sleep();
-                lock.lock();
             }
-            lock.unlock();
-            std::cout << "Finished actively trading.\n";
+            // Normal OBV Delta strategy for regular trading
+            else if (obv_.ready())
+            {
+                placeOrder(obv_delta_.value());
+            }
+            else
+            {
+                std::cout << "Not enough market data for OBV Delta calculation.\n";
+            }
         });
     }
 
@@ -192,14 +173,11 @@ private:
         double price = msg->data->last_price_traded;
         double volume = msg->data->last_quantity_traded;
 
-        close_prices_.push_back(price);
-        volumes_.push_back(volume);
-
-        if (close_prices_.size() > lookback_length_)
-            close_prices_.erase(close_prices_.begin());
-
-        if (volumes_.size() > lookback_length_)
-            volumes_.erase(volumes_.begin());
+        obv_.push(price, volume);
+        if (obv_.ready())
+        {
+            obv_delta_.push(normaliseOBV());
+        }
 
         last_market_data_ = msg->data;
     } 
@@ -266,103 +244,17 @@ private:
     }
 
 
-    std::vector<double> calculateOBVDelta() 
-    {   
-        size_t n = close_prices_.size(); 
-        if (n < lookback_length_ || volumes_.size() < lookback_length_) { 
-            return {}; 
-        }
-
-        std::vector<double> output(n, 0.0);
-        size_t front_bad = lookback_length_;
-
-        // More lenient volume check
-        for (size_t first_volume = 0; first_volume < n; first_volume++) {
-            if (volumes_[first_volume] > 0) {
-                break;
-            }
-            front_bad = std::min(front_bad, n - 1);
-        }
-
-        for (size_t i = 0; i < front_bad; i++) {
-            output[i] = 0.0;
-        }
-
-        for (size_t icase = front_bad; icase < n; icase++) {
-            double signed_volume = 0.0;
-            double total_volume = 0.0;
-
-            for (size_t i = 1; i < lookback_length_ && (icase - i) > 0; i++) {
-                if (icase - i - 1 < 0) {
-                    std::cerr << "ERROR: Out-of-bounds access prevented (icase - i - 1)" << std::endl;
-                    break;
-                }
-
-                // More lenient price change detection with a small threshold
-                double price_change_threshold = 0.001; // 0.1% price change
-                if (std::abs(close_prices_[icase - i] - close_prices_[icase - i - 1]) / close_prices_[icase - i - 1] > price_change_threshold) {
-                    // Price change is significant
-                    if (close_prices_[icase - i] > close_prices_[icase - i - 1]) {
-                        signed_volume += volumes_[icase - i];
-                    } 
-                    else {
-                        signed_volume -= volumes_[icase - i];
-                    }
-                }
-                total_volume += volumes_[icase - i];
-            }
-
-            if (total_volume <= 0.0) {
-                output[icase] = 0.0;
-                continue;
-            }
-
-            // More aggressive normalization
-            double value = signed_volume / total_volume;
-            // Adjusted normalization to make signals more frequent
-            double normalized_value = 200.0 * std::tanh(value * sqrt(static_cast<double>(lookback_length_))) - 100.0;
-            
-            // Add debug logging
-            std::cout << "OBV Calculation Debug:"
-                    << " icase=" << icase 
-                    << " signed_volume=" << signed_volume 
-                    << " total_volume=" << total_volume 
-                    << " value=" << value 
-                    << " normalized_value=" << normalized_value << std::endl;
-
-            output[icase] = normalized_value;
-        }
-
-        if (n < front_bad) {
-            std::cerr << "ERROR: Not enough data for delta calculation!" << std::endl;
-            return output;
-        }
-
-        // More flexible delta calculation
-        for (int icase = static_cast<int>(n) - 1; icase >= static_cast<int>(front_bad); icase--) {
-            if (icase - delta_length_ < 0) {
-                std::cerr << "ERROR: Out-of-bounds access prevented (icase - delta_length)\n";
-                break;
-            }
-            // Use absolute delta for more trading opportunities
-            output[icase] = output[icase] - output[icase - delta_length_];
-        }
-
-        return output;
-    }
-
-    void sleep()
+    // Scales the OBV ratio of signed to total volume to between -100 and 100, more aggressively for longer lookbacks
+    double normaliseOBV()
     {
-        std::uniform_real_distribution<> dist(-REL_JITTER, REL_JITTER);
-        unsigned long jitter = dist(random_generator_);
-        unsigned long sleep_time_ms = std::round(trade_interval_ms_ * (1.0 + jitter));
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
+        if (obv_.totalVolume() <= 0.0) return 0.0;
+        double value = obv_.ratio();
+        return 200.0 * std::tanh(value * sqrt(static_cast<double>(lookback_length_))) - 100.0;
     }
 
     unsigned long long timeNow()
     {
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+        return SimulationClock::nowNanos();
     }
 
     std::string exchange_;
@@ -374,15 +266,15 @@ private:
     double threshold_;
     bool cancelling_;
     unsigned int trade_interval_ms_;
-    std::vector<double> close_prices_;
-    std::vector<double> volumes_;
+    indicators::OBV obv_; // Signed and total volume over the last lookback_length_ prices
+    indicators::Delta obv_delta_; // Change of the normalised OBV over delta_length_ updates
     std::optional<int> last_accepted_order_id_ = std::nullopt;
     std::mt19937 random_generator_;
     std::mutex mutex_;
-    std::thread* trading_thread_ = nullptr;
     bool is_trading_ = false;
     std::optional<MarketDataPtr> last_market_data_;
     constexpr static double REL_JITTER = 0.25;
+    constexpr static double PRICE_CHANGE_THRESHOLD = 0.001; // Price moves under 0.1% do not sign their volume
     constexpr static unsigned long MS_TO_NS = 1000000;
     unsigned long next_trade_timestamp_;
     std::stack<CustomerOrderMessagePtr> customer_orders_;
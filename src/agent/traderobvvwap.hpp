@@ -1,10 +1,11 @@
 #ifndef TRADER_VWAP_OBV_DELTA_HPP
 #define TRADER_VWAP_OBV_DELTA_HPP
 
-#include <vector>
-#include <numeric>
+#include <cmath>
 #include <algorithm>
 #include "traderagent.hpp"
+#include "../indicators/vwap.hpp"
+#include "../indicators/obv.hpp"
 
 class TraderVWAPOBVDelta : public TraderAgent
 {
@@ -21,7 +22,10 @@ public:
       threshold_{threshold},
       cancelling_{config->cancelling},
       trade_interval_ms_{config->trade_interval},
-      random_generator_{std::random_device{}()},
+      vwap_{static_cast<size_t>(lookback_vwap)},
+      obv_{static_cast<size_t>(lookback_obv)},
+      obv_delta_{static_cast<size_t>(delta_length)},
+      random_generator_{SimulationClock::randomSeed()},
       mutex_{}
     {
 
@@ -39,15 +43,7 @@ public:
 
     std::string getAgentName() const override { return "obvvwap"; }
 
-    void terminate() override
-    {
-        if (trading_thread_ != nullptr)
-        {
-            trading_thread_->join();
-            delete(trading_thread_);
-        }
-        TraderAgent::terminate();
-    }
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TOP; }
 
     void onTradingStart() override
     {
@@ -64,6 +60,7 @@ public:
         // Delay shutdown to allow profit message to be sent completely.
         lock.unlock();
         is_trading_ = false;
+        stopActiveTrading();
     }
 
     void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override
@@ -136,46 +133,30 @@ private:
 
     void activelyTrade()
     {
-        trading_thread_ = new std::thread([&, this]()
-        {
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (is_trading_)
+        startActiveTrading(trade_interval_ms_, REL_JITTER, [this]() {
+            // Process any pending customer orders
+            if (!customer_orders_.empty())
             {
-                lock.unlock();
-                
-                // Process any pending customer orders
-                if (!customer_orders_.empty())
-                {
-                    // If we have enough data, use OBV+VWAP strategy with customer order parameters
-                    if (price_volume_data_.size() >= lookback_vwap_ && close_prices_.size() >= lookback_obv_)
-                    {
-                        double rolling_vwap = calculateVWAP(price_volume_data_);
-                        std::vector<double> delta_obv_values = calculateOBVDelta();
-                        placeOrder(delta_obv_values.back(), rolling_vwap);
-                    }
-                    // Else directly process customer orders to bootstrap market data
-                    else
-                    {
-                        processCustomerOrder();
-                    }
-                }
-                // Normal OBV+VWAP strategy for regular trading
-                else if (price_volume_data_.size() >= lookback_vwap_ && close_prices_.size() >= lookback_obv_)
+                // If we have enough data, use OBV+VWAP strategy with customer order parameters
+                if (vwap_.ready() && obv_.ready())
                 {
-                    double rolling_vwap = calculateVWAP(price_volume_data_);
-                    std::vector<double> delta_obv_values = calculateOBVDelta();
-                    placeOrder(delta_obv_values.back(), rolling_vwap);
+                    placeOrder(obv_delta_.value(), vwap_.value());
                 }
+                // Else directly process customer orders to bootstrap market data
                 else
                 {
-                    std::cout << "Not enough market data for OBV+VWAP calculation.\n";
+                    processCustomerOrder();
                 }
-                
-                sleep();
-                lock.lock();
             }
-            lock.unlock();
-            std::cout << "Finished actively trading.\n";
+            // Normal OBV+VWAP strategy for regular trading
+            else if (vwap_.ready() && obv_.ready())
+            {
+                placeOrder(obv_delta_.value(), vwap_.value());
+            }
+            else
+            {
+                std::cout << "Not enough market data for OBV+VWAP calculation.\n";
+            }
         });
     }
 
@@ -206,17 +187,11 @@ private:
         double price = msg->data->last_price_traded;
         double volume = msg->data->last_quantity_traded;
 
-        price_volume_data_.emplace_back(price, volume);
-        close_prices_.push_back(price);
-        volumes_.push_back(volume);
-
-        if (price_volume_data_.size() > lookback_vwap_)
-            price_volume_data_.erase(price_volume_data_.begin());
-
-        if (close_prices_.size() > lookback_obv_)
+        vwap_.push(price, volume);
+        obv_.push(price, volume);
+        if (obv_.ready())
         {
-            close_prices_.erase(close_prices_.begin());
-            volumes_.erase(volumes_.begin());
+            obv_delta_.push(normaliseOBV());
         }
 
         last_market_data_ = msg->data;
@@ -301,99 +276,17 @@ private:
     }
 
 
-    double calculateVWAP(const std::vector<std::pair<double, double>>& data)
-    {
-        double price_volume_sum = 0.0;
-        double volume_sum = 0.0;
-
-        for (const auto& [price, volume] : data) // For each price-volume pair in the data
-        {
-            price_volume_sum += price * volume; // Calculate the sum of price * volume
-            volume_sum += volume; // Calculate the sum of volume
-        }
-
-        return volume_sum > 0 ? price_volume_sum / volume_sum : 0.0; // Calculate the VWAP
-    }
-
-    std::vector<double> calculateOBVDelta()
-    {
-        size_t n = close_prices_.size();
-        if (n < lookback_obv_ || volumes_.size() < lookback_obv_) 
-        {
-            return {};
-        }
-
-        std::vector<double> output(n, 0.0);
-        size_t front_bad = lookback_obv_;
-
-        for (size_t first_volume = 0; first_volume < n; first_volume++) 
-        {
-            if (volumes_[first_volume] > 0) 
-            {
-                break;
-            }
-            front_bad = std::min(front_bad, n - 1);
-        }
-
-        for (size_t i = 0; i < front_bad; i++) 
-        {
-            output[i] = 0.0;
-        }
-
-        for (size_t icase = front_bad; icase < n; icase++) 
-        {
-            double signed_volume = 0.0;
-            double total_volume = 0.0;
-
-            for (size_t i = 1; i < lookback_obv_ && (icase - i) > 0; i++) 
-            {
-                if (close_prices_[icase - i] > close_prices_[icase - i - 1]) 
-                {
-                    signed_volume += volumes_[icase - i];
-                } 
-                else if (close_prices_[icase - i] < close_prices_[icase - i - 1]) 
-                {
-                    signed_volume -= volumes_[icase - i];
-                }
-                total_volume += volumes_[icase - i];
-            }
-
-            if (total_volume <= 0.0) 
-            {
-                output[icase] = 0.0;
-                continue;
-            }
-
-            double value = signed_volume / total_volume;
-            double normalized_value = 100.0 * std::erfc(-0.6 * value * sqrt(static_cast<double>(lookback_obv_))) - 50.0;
-            output[icase] = normalized_value;
-        }
-
-        if (n < front_bad + delta_length_) 
-        {
-            std::cerr << "ERROR: Not enough data for delta calculation!\n";
-            return output;
-        }
-
-        for (int icase = static_cast<int>(n) - 1; icase >= static_cast<int>(front_bad + delta_length_); icase--) 
-        {
-            output[icase] -= output[icase - delta_length_];
-        }
-
-        return output;
-    }
-    void sleep()
+    // Scales the OBV ratio of signed to total volume through the complementary error function, more steeply for longer lookbacks
+    double normaliseOBV()
     {
-        std::uniform_real_distribution<> dist(-REL_JITTER, REL_JITTER);
-        unsigned long jitter = dist(random_generator_);
-        unsigned long sleep_time_ms = std::round(trade_interval_ms_ * (1.0 + jitter));
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
+        if (obv_.totalVolume() <= 0.0) return 0.0;
+        double value = obv_.ratio();
+        return 100.0 * std::erfc(-0.6 * value * sqrt(static_cast<double>(lookback_obv_))) - 50.0;
     }
 
     unsigned long long timeNow()
     {
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+        return SimulationClock::nowNanos();
     }
 
     std::string exchange_;
@@ -406,16 +299,15 @@ private:
     double threshold_;
     bool cancelling_;
     unsigned int trade_interval_ms_;
-    std::vector<std::pair<double, double>> price_volume_data_;
-    std::vector<double> close_prices_;
-    std::vector<double> volumes_;
+    indicators::VWAP vwap_; // Rolling VWAP of the last lookback_vwap_ trades
+    indicators::OBV obv_; // Signed and total volume over the last lookback_obv_ prices
+    indicators::Delta obv_delta_; // Change of the normalised OBV over delta_length_ updates
 
     std::optional<int> last_accepted_order_id_ = std::nullopt;
 
     std::mt19937 random_generator_;
 
     std::mutex mutex_;
-    std::thread* trading_thread_ = nullptr;
     bool is_trading_ = false;
 
     constexpr static double REL_JITTER = 0.25;
@@ -1,12 +1,11 @@
 #ifndef TRADER_RSI_HPP
 #define TRADER_RSI_HPP
 
-#include <vector>
-#include <numeric>
 #include <stack> 
 #include <algorithm>
 #include "traderagent.hpp"
 #include "../message/profitmessage.hpp"
+#include "../indicators/rsi.hpp"
 
 class TraderRSI : public TraderAgent
 {
@@ -23,8 +22,10 @@ public:
       trade_interval_ms_{config->trade_interval}, 
       stoch_lookback_{stoch_lookback}, 
       n_to_smooth_{n_to_smooth}, // Smoothing factor
-      random_generator_{std::random_device{}()},
-      mutex_{}
+      random_generator_{SimulationClock::randomSeed()},
+      mutex_{},
+      rsi_{lookback},
+      stoch_rsi_{stoch_lookback, n_to_smooth}
     {   
         use_stoch_rsi_ = false; 
 
@@ -42,15 +43,7 @@ public:
 
     std::string getAgentName() const override { return "rsi"; }
 
-    void terminate() override
-    {
-        if (trading_thread_ != nullptr)
-        {
-            trading_thread_->join();
-            delete(trading_thread_);
-        }
-        TraderAgent::terminate();
-    }
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TOP; }
 
     void onTradingStart() override
     {
@@ -67,6 +60,7 @@ public:
         // Delay shutdown to allow profit message to be sent completely.
         lock.unlock();
         is_trading_ = false;
+        stopActiveTrading();
     }
 
     void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override
@@ -139,54 +133,22 @@ private:
 
     void activelyTrade()
     {
-        trading_thread_ = new std::thread([&, this](){
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (is_trading_)
+        startActiveTrading(trade_interval_ms_, REL_JITTER, [this]() {
+            // Process any pending customer orders
+            if (!customer_orders_.empty())
             {
-                lock.unlock();
-                
-                // Process any pending customer orders
-                if (!customer_orders_.empty())
-                {
-                    if (closing_prices_.size() >= lookback_)
-                    { 
-                        // If we have enough data, use RSI strategy with customer order parameters
-                        double rsi = calculateRSI(closing_prices_);
-                        std::cout << "RSI: " << rsi << "\n";
-
-                        double stoch_rsi = 50.0; // Neutral value.
-                        if (use_stoch_rsi_)
-                        { 
-                            if (rsi_values_.size() >= stoch_lookback_)
-                            { 
-                                stoch_rsi = calculateStochRSI(rsi_values_, stoch_lookback_, n_to_smooth_);
-                                std::cout << "Stochastic RSI: " << stoch_rsi << "\n";
-                            }
-                            else
-                            {
-                                std::cout << "Not enough RSI values for StochRSI calculation.\n";
-                            }
-                        }
-                        placeOrder(rsi, stoch_rsi);
-                    }
-                    // Else directly process customer orders to bootstrap market data
-                    else
-                    {
-                        processCustomerOrder();
-                    }
-                }
-                // Normal RSI strategy for regular trading
-                else if (closing_prices_.size() >= lookback_)
+                if (rsi_.ready())
                 { 
-                    double rsi = calculateRSI(closing_prices_);
+                    // If we have enough data, use RSI strategy with customer order parameters
+                    double rsi = rsi_.value();
                     std::cout << "RSI: " << rsi << "\n";
 
                     double stoch_rsi = 50.0; // Neutral value.
                     if (use_stoch_rsi_)
                     { 
-                        if (rsi_values_.size() >= stoch_lookback_)
+                        if (stoch_rsi_.ready())
                         { 
-                            stoch_rsi = calculateStochRSI(rsi_values_, stoch_lookback_, n_to_smooth_);
+                            stoch_rsi = stoch_rsi_.value();
                             std::cout << "Stochastic RSI: " << stoch_rsi << "\n";
                         }
                         else
@@ -196,16 +158,37 @@ private:
                     }
                     placeOrder(rsi, stoch_rsi);
                 }
+                // Else directly process customer orders to bootstrap market data
                 else
                 {
-                    std::cout << "Not enough closing prices for RSI calculation.\n";
+                    processCustomerOrder();
                 }
-                
-                sleep();
-                lock.lock();
             }
-            lock.unlock();
-            std::cout << "Finished actively trading.\n";
+            // Normal RSI strategy for regular trading
+            else if (rsi_.ready())
+            { 
+                double rsi = rsi_.value();
+                std::cout << "RSI: " << rsi << "\n";
+
+                double stoch_rsi = 50.0; // Neutral value.
+                if (use_stoch_rsi_)
+                { 
+                    if (stoch_rsi_.ready())
+                    { 
+                        stoch_rsi = stoch_rsi_.value();
+                        std::cout << "Stochastic RSI: " << stoch_rsi << "\n";
+                    }
+                    else
+                    {
+                        std::cout << "Not enough RSI values for StochRSI calculation.\n";
+                    }
+                }
+                placeOrder(rsi, stoch_rsi);
+            }
+            else
+            {
+                std::cout << "Not enough closing prices for RSI calculation.\n";
+            }
         });
     }
 
@@ -228,24 +211,11 @@ private:
     {
         std::cout << "Last price traded: " << msg->data->last_price_traded << "\n";
 
-        closing_prices_.push_back(msg->data->last_price_traded); // Add last price traded from market data to buffer
-
-        if (closing_prices_.size() > lookback_) // If buffer exceeds lookback, remove the oldest price
-        {
-            closing_prices_.erase(closing_prices_.begin());
-        }
+        rsi_.push(msg->data->last_price_traded); // Update the smoothed gains and losses with the last price traded
 
-        if (use_stoch_rsi_)
+        if (use_stoch_rsi_ && rsi_.ready())
         { 
-            if (closing_prices_.size() >= lookback_)
-            {
-                double rsi = calculateRSI(closing_prices_);
-                rsi_values_.push_back(rsi);
-                if (rsi_values_.size() > stoch_lookback_)
-                {
-                    rsi_values_.erase(rsi_values_.begin());
-                }
-            }
+            stoch_rsi_.push(rsi_.value());
         }
 
         last_market_data_ = msg->data; // Store last market data
@@ -322,108 +292,9 @@ private:
 
     }
 
-    void sleep()
-    {
-        std::uniform_real_distribution<> dist(-REL_JITTER, REL_JITTER);
-        unsigned long jitter = dist(random_generator_);
-        unsigned long sleep_time_ms = std::round(trade_interval_ms_ * (1.0+jitter));
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
-    }
-
-    // Calculate RSI based on closing prices
-    double calculateRSI(const std::vector<double>& prices)
-    {
-        if (prices.size() < lookback_) {
-            return 50.0; // Neutral RSI
-        }
-
-        //double upsum = 1.e-60, dnsm = 1.e-60; Avoid division by zero. Upsum = sum of upward price movements (gains). Dnsm = sum of downward price movements (losses)
-        double upsum = 0.0, dnsm = 0.0;
-        size_t initial_calculation_period = std::min(static_cast<size_t>(lookback_), prices.size());
-
-        //Initial calculation of upsum and dnsm (lookback period); initial smoothed averages for upward and downward movements over lookback period. 
-        for (size_t i = 1; i < initial_calculation_period; ++i) 
-        {
-            double diff = prices[i] - prices[i - 1]; //Price difference for each consecutive price pair
-            if (diff > 0.0) 
-                upsum += diff;
-            else
-                dnsm += -diff; 
-        }
-
-        // Averages of upward/downard price movements over lookback period
-        upsum /= (lookback_ - 1); 
-        dnsm /= (lookback_ - 1); 
-
-        //Processes remaining prices sequentially to dynamically update smoothed averages using exponential smoothing
-        for (size_t i = initial_calculation_period; i < prices.size(); ++i) 
-        {   
-            double diff = prices[i] - prices[i - 1]; //Price difference for each consecutive price pair
-            if (diff > 0.0) //If diff > 0.0 its upward price movement
-            {
-                upsum = ((lookback_ - 1) * upsum + diff) / lookback_; 
-                dnsm *= (lookback_ - 1.0) / lookback_;
-            }
-            else
-            {
-                dnsm = ((lookback_ - 1) * dnsm - diff) / lookback_; //Update dnsm using exponential smoothing. 
-                upsum *= (lookback_ - 1.0) / lookback_; 
-            }
-        }
-        
-        if (upsum + dnsm < 1e-6) { // Prevents divison by 0 when calculating RSI by returning neutral value (50) if sum of upward and downward price movement is extremely small (less than 1e-6)
-           return 50.0;
-        } 
-
-        return 100.0 * (upsum / (upsum + dnsm)); // Calculate RSI value based on smoothed averages of upward and downward price movements
-    }
-
-    double calculateStochRSI(const std::vector<double>& rsi_values, int stoch_lookback, int n_to_smooth)
-    {
-        size_t n = rsi_values.size();
-
-        if (n < stoch_lookback) { // If no. of RSI values is less than required stochastic RSI lookback length; avoids error when not enough data 
-            return 50.0; 
-        }
-
-        std::vector<double> stoch_rsi_values(n, 0.0); // Vector of zeros (same size as RSI values) to store computed S.RSI values
-
-        // Initialise min and max RSI values for lookback period
-        for (size_t icase = stoch_lookback - 1; icase < n; ++icase) { // Loop through existing RSI values
-            double min_val = 1e60; // Arbitrary high value;
-            double max_val = -1e60; 
-
-            // Inner loop for lookback2 window
-            for (size_t j = icase - stoch_lookback + 1; j <= icase; ++j) { // Loop through stochastic lookback RSI values (sliding window) 
-                if (rsi_values[j] < min_val) min_val = rsi_values[j]; // Finds min. and max. RSI within this period 
-                if (rsi_values[j] > max_val) max_val = rsi_values[j];
-            }
-
-            // Compute Stochastic RSI
-            if (max_val == min_val) { // If max val == min. val -> no variation -> assign netural RSI value
-                stoch_rsi_values[icase] = 50.0; 
-            } else {
-                stoch_rsi_values[icase] = 100.0 * (rsi_values[icase] - min_val) / (max_val - min_val); // Stochastic RSI formula; normalises RSI values between 0 and 100. Closer to 100 -> RSI is at upper range of past values. Closer to 0 -> RSI is at lower range of past values
-            }
-        }
-
-        // Exponential smoothing (EMA) if requested (reduces noise in stochastic RSI for stability)
-        if (n_to_smooth > 1) {
-            double alpha = 2.0 / (n_to_smooth + 1.0);
-            double smoothed = stoch_rsi_values[stoch_lookback - 1];
-            for (size_t icase = stoch_lookback; icase < n; ++icase) { // Iterate over stochastic RSI values and apply smoothing EMA formula
-                smoothed = alpha * stoch_rsi_values[icase] + (1.0 - alpha) * smoothed;
-                stoch_rsi_values[icase] = smoothed;
-            }
-        }
-
-        return stoch_rsi_values.back(); // Return the latest Stochastic RSI value
-    }
-
     unsigned long long timeNow()
     {
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+        return SimulationClock::nowNanos();
     }
 
     std::string exchange_;
@@ -433,15 +304,12 @@ private:
     int lookback_;
     bool cancelling_;
     unsigned int trade_interval_ms_;
-    std::vector<double> closing_prices_;
-    std::vector<double> rsi_values_; // Store RSI values for Stochastic RSI calculation
 
     std::optional<int> last_accepted_order_id_ = std::nullopt;
 
     std::mt19937 random_generator_;
 
     std::mutex mutex_;
-    std::thread* trading_thread_ = nullptr;
     bool is_trading_ = false;
 
     constexpr static double REL_JITTER = 0.25;
@@ -449,6 +317,8 @@ private:
     bool use_stoch_rsi_; 
     int stoch_lookback_; 
     int n_to_smooth_; 
+    indicators::RSI rsi_; // Wilder-smoothed RSI over the last prices traded
+    indicators::StochasticRSI stoch_rsi_; // Stochastic RSI over the last RSI values
 
     constexpr static unsigned long MS_TO_NS = 1000000;
     unsigned long next_trade_timestamp_;
@@ -1,10 +1,10 @@
 #ifndef TRADER_BB_RSI_HPP
 #define TRADER_BB_RSI_HPP
 
-#include <vector>
-#include <numeric>
 #include <algorithm>
 #include "traderagent.hpp"
+#include "../indicators/rsi.hpp"
+#include "../indicators/variance.hpp"
 
 class TraderBBRSI : public TraderAgent
 {
@@ -21,7 +21,9 @@ public:
       std_dev_multiplier_{std_dev_multiplier},
       cancelling_{config->cancelling},
       trade_interval_ms_{config->trade_interval},
-      random_generator_{std::random_device{}()},
+      rsi_{lookback_rsi},
+      bb_prices_{static_cast<size_t>(lookback_bb)},
+      random_generator_{SimulationClock::randomSeed()},
       mutex_{}
     {
         // Mark as legacy agent
@@ -38,15 +40,7 @@ public:
 
     std::string getAgentName() const override { return "rsibb"; }
 
-    void terminate() override
-    {
-        if (trading_thread_ != nullptr)
-        {
-            trading_thread_->join();
-            delete(trading_thread_);
-        }
-        TraderAgent::terminate();
-    }
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TOP; }
 
 
     void onTradingStart() override
@@ -64,6 +58,7 @@ public:
         // Delay shutdown to allow profit message to be sent completely.
         lock.unlock();
         is_trading_ = false;
+        stopActiveTrading();
     }
 
 
@@ -136,52 +131,40 @@ private:
 
     void activelyTrade()
     {
-        trading_thread_ = new std::thread([&, this]()
-        {
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (is_trading_)
+        startActiveTrading(trade_interval_ms_, REL_JITTER, [this]() {
+            // Process any pending customer orders
+            if (!customer_orders_.empty())
             {
-                lock.unlock();
-                
-                // Process any pending customer orders
-                if (!customer_orders_.empty())
-                {
-                    // If we have enough data, use RSI+BB strategy with customer order parameters
-                    if (rsi_prices_.size() >= lookback_rsi_ && bb_prices_.size() >= lookback_bb_) 
-                    { 
-                        double rsi = calculateRSI(rsi_prices_); 
-                        double sma = calculateSMA(bb_prices_);
-                        double std_dev = calculateStandardDeviation(bb_prices_, sma);
-                        double upper_band = sma + (std_dev_multiplier_ * std_dev);
-                        double lower_band = sma - (std_dev_multiplier_ * std_dev);
-                        placeOrder(rsi, upper_band, lower_band);
-                    }
-                    // Else directly process customer orders to bootstrap market data
-                    else
-                    {
-                        processCustomerOrder();
-                    }
-                }
-                // Normal RSI+BB strategy for regular trading
-                else if (rsi_prices_.size() >= lookback_rsi_ && bb_prices_.size() >= lookback_bb_) 
+                // If we have enough data, use RSI+BB strategy with customer order parameters
+                if (rsi_.ready() && bb_prices_.ready()) 
                 { 
-                    double rsi = calculateRSI(rsi_prices_); 
-                    double sma = calculateSMA(bb_prices_);
-                    double std_dev = calculateStandardDeviation(bb_prices_, sma);
+                    double rsi = rsi_.value(); 
+                    double sma = bb_prices_.mean();
+                    double std_dev = bb_prices_.standardDeviation();
                     double upper_band = sma + (std_dev_multiplier_ * std_dev);
                     double lower_band = sma - (std_dev_multiplier_ * std_dev);
                     placeOrder(rsi, upper_band, lower_band);
                 }
-                else 
-                { 
-                    std::cout << "Not enough data for RSI+BB calculation.\n";
-                } 
-    
-                sleep();
-                lock.lock();
+                // Else directly process customer orders to bootstrap market data
+                else
+                {
+                    processCustomerOrder();
+                }
+            }
+            // Normal RSI+BB strategy for regular trading
+            else if (rsi_.ready() && bb_prices_.ready()) 
+            { 
+                double rsi = rsi_.value(); 
+                double sma = bb_prices_.mean();
+                double std_dev = bb_prices_.standardDeviation();
+                double upper_band = sma + (std_dev_multiplier_ * std_dev);
+                double lower_band = sma - (std_dev_multiplier_ * std_dev);
+                placeOrder(rsi, upper_band, lower_band);
             }
-            lock.unlock();
-            std::cout << "Finished actively trading.\n";
+            else 
+            { 
+                std::cout << "Not enough data for RSI+BB calculation.\n";
+            } 
         });
     }
 
@@ -216,18 +199,8 @@ private:
             return;
         }
 
-        rsi_prices_.push_back(price);
-        bb_prices_.push_back(price);
-
-        if (rsi_prices_.size() > lookback_rsi_)
-        {
-            rsi_prices_.erase(rsi_prices_.begin());
-        }
-
-        if (bb_prices_.size() > lookback_bb_)
-        {
-            bb_prices_.erase(bb_prices_.begin());
-        }
+        rsi_.push(price);
+        bb_prices_.push(price);
 
         last_market_data_ = msg->data;
     } 
@@ -309,79 +282,9 @@ private:
         }
     }
 
-    double calculateSMA(const std::vector<double>& prices)
-    {   
-        if (prices.empty()) return 0.0; // Avoid divison by 0
-        double sum = std::accumulate(prices.begin(), prices.end(), 0.0); 
-        return sum / prices.size(); // Simple Moving Avergge 
-    }
-
-    double calculateStandardDeviation(const std::vector<double>& prices, double sma) 
-    {
-        double sum = 0.0;
-        for (double price : prices) // Iterate through prices 
-        {
-            sum += (price - sma) * (price - sma); // Add square of difference between price and SMA to sum (sum of squared differences)
-        }
-        return std::sqrt(sum / (prices.size() - 1)); // Standard deviation
-    }
-
-    double calculateRSI(const std::vector<double>& prices) // Calculate RSI based on closing prices
-    {
-        if (prices.size() < lookback_rsi_) { // If prices size less than lookback period, return neutral RSI
-            return 50.0; 
-        }
-
-        double upsum = 0.0, dnsm = 0.0; // Initialise upsum and dnsm to 0 (gain and loss)
-        size_t initial_calculation_period = std::min(static_cast<size_t>(lookback_rsi_), prices.size()); // Initial calculation period (minimum of lookback period and prices size)
-
-        for (size_t i = 1; i < initial_calculation_period; ++i) // Loop through lookback period 
-        {
-            double diff = prices[i] - prices[i - 1]; // Price difference for each consecutive price pair
-            if (diff > 0.0) 
-                upsum += diff; 
-            else
-                dnsm += -diff; 
-        }
-        // Average of upward and downward price movements (over lookback period)
-        upsum /= (lookback_rsi_ - 1); 
-        dnsm /= (lookback_rsi_ - 1); 
-
-        //RSI continuously updated using exponential smoothing (historical trend via upsum and dnsm and the new prices differences)
-        for (size_t i = initial_calculation_period; i < prices.size(); ++i) 
-        {
-            double diff = prices[i] - prices[i - 1]; // Price difference for each consecutive price pair
-            if (diff > 0.0) // If diff > 0.0 its upward price movement
-            {
-                upsum = ((lookback_rsi_ - 1) * upsum + diff) / lookback_rsi_; // Exponential smoothing
-                dnsm *= (lookback_rsi_ - 1.0) / lookback_rsi_; 
-            }
-            else
-            {
-                dnsm = ((lookback_rsi_ - 1) * dnsm - diff) / lookback_rsi_; // Exponential smoothing
-                upsum *= (lookback_rsi_ - 1.0) / lookback_rsi_; 
-            }
-        }
-
-        if (upsum + dnsm < 1e-6) { // Prevents divison by 0 when calculating RSI by returning neutral value (50) if sum of upward and downward price movement is extremely small (less than 1e-6)
-            return 50.0; // Neutral RSI
-        }
-
-        return 100.0 * (upsum / (upsum + dnsm)); // Calculate RSI; normalises ratio of avg. gains (upsum) to total movement (upsum + dnsm) to 0-100 scale. RSI < 30: oversold, RSI > 70: overbought
-    }
-
-    void sleep()
-    {
-        std::uniform_real_distribution<> dist(-REL_JITTER, REL_JITTER);
-        unsigned long jitter = dist(random_generator_);
-        unsigned long sleep_time_ms = std::round(trade_interval_ms_ * (1.0 + jitter));
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
-    }
-
     unsigned long long timeNow()
     {
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+        return SimulationClock::nowNanos();
     }
 
     std::string exchange_;
@@ -393,12 +296,11 @@ private:
     double std_dev_multiplier_;
     bool cancelling_;
     unsigned int trade_interval_ms_;
-    std::vector<double> rsi_prices_;
-    std::vector<double> bb_prices_;
+    indicators::RSI rsi_; // Wilder-smoothed RSI over the last prices
+    indicators::RollingVariance bb_prices_; // Mean and standard deviation of the last lookback_bb_ prices
     std::optional<int> last_accepted_order_id_ = std::nullopt;
     std::mt19937 random_generator_;
     std::mutex mutex_;
-    std::thread* trading_thread_ = nullptr;
     bool is_trading_ = false;
     unsigned long next_trade_timestamp_;
     std::optional<MarketDataPtr> last_market_data_;
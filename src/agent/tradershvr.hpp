@@ -17,7 +17,7 @@ public:
         limit_price_{config->limit},
         trade_interval_ms_{config->trade_interval}, // Add this line
         cancelling_{config->cancelling},            // Add this line
-        random_generator_{std::random_device{}()},
+        random_generator_{SimulationClock::randomSeed()},
         mutex_{}
     {   
         
@@ -35,15 +35,7 @@ public:
 
     std::string getAgentName() const override { return "shvr"; }
 
-    void terminate() override
-    {
-        if (trading_thread_ != nullptr)
-        {
-            trading_thread_->join();
-            delete(trading_thread_);
-        }
-        TraderAgent::terminate();
-    }
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TOP; }
 
     void onTradingStart() override
     {
@@ -59,6 +51,7 @@ public:
         std::cout << "Trading window ended.\n";
         lock.unlock();
         is_trading_ = false;
+        stopActiveTrading();
     }
 
     void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override
@@ -74,6 +67,11 @@ public:
         if (msg->order->status == Order::Status::NEW)
         {
             last_accepted_order_id_ = msg->order->id;
+            last_accepted_side_ = msg->order->side;
+        }
+        else if (msg->order->status == Order::Status::FILLED && last_accepted_order_id_ == msg->order->id)
+        {
+            last_accepted_order_id_ = std::nullopt;
         }
 
         if (msg->trade) { 
@@ -92,7 +90,11 @@ public:
 
     void onCancelReject(std::string_view exchange, CancelRejectMessagePtr msg) override
     {
-        throw std::runtime_error("Shaver trader does not cancel orders therefore cannot receive cancel rejection.");
+        // The quote being amended is no longer resting, so the next one is placed anew
+        if (last_accepted_order_id_ == msg->order_id)
+        {
+            last_accepted_order_id_ = std::nullopt;
+        }
     }
 
     void handleBroadcastFrom(std::string_view sender, MessagePtr message) override
@@ -125,21 +127,8 @@ private:
 
     void activelyTrade()
     {
-        trading_thread_ = new std::thread([&, this](){
-
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (is_trading_)
-            {
-                lock.unlock();
-
-                placeOrder();
-                sleep();
-
-                lock.lock();
-            }
-            lock.unlock();
-
-            std::cout << "Finished actively trading.\n";
+        startActiveTrading(trade_interval_ms_, REL_JITTER, [this]() {
+            placeOrder();
         });
     }
 
@@ -170,12 +159,6 @@ private:
             return;
         }
 
-        if (cancelling_ && last_accepted_order_id_.has_value())
-        {
-            cancelOrder(exchange_, trader_side_, ticker_, last_accepted_order_id_.value());
-            last_accepted_order_id_ = std::nullopt;
-        }
-
         // Process customer orders with market data if available
         if (!customer_orders_.empty())
         {
@@ -189,6 +172,19 @@ private:
         std::uniform_int_distribution<int> dist(10, 50);
         int quantity = dist(random_generator_);
         double price = getShaverPrice(last_market_data_.value(), limit_price_);
+
+        // Reprice the resting quote in place if it is on the same side, and replace it otherwise
+        if (cancelling_ && last_accepted_order_id_.has_value())
+        {
+            if (last_accepted_side_ == trader_side_)
+            {
+                amendOrder(exchange_, trader_side_, ticker_, last_accepted_order_id_.value(), quantity, price);
+                std::cout << ">> Amend " << (trader_side_ == Order::Side::BID ? "BID" : "ASK") << " " << quantity << " @ " << price << "\n";
+                return;
+            }
+            cancelOrder(exchange_, last_accepted_side_, ticker_, last_accepted_order_id_.value());
+            last_accepted_order_id_ = std::nullopt;
+        }
         placeLimitOrder(exchange_, trader_side_, ticker_, quantity, price, limit_price_);
         std::cout << ">> " << (trader_side_ == Order::Side::BID ? "BID" : "ASK") << " " << quantity << " @ " << price << "\n";
     }
@@ -211,17 +207,6 @@ private:
         return price;
     }
 
-    void sleep()
-    {
-        // Generate a random jitter
-        std::uniform_real_distribution<> dist(-REL_JITTER, REL_JITTER);
-        unsigned long jitter = dist(random_generator_);
-        unsigned long sleep_time_ms = std::round(trade_interval_ms_ * (1.0+jitter));
-
-        // Sleep for specified duration
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
-    }
-
 
     std::string exchange_;
     std::string ticker_;
@@ -230,9 +215,9 @@ private:
     unsigned int trade_interval_ms_; 
 
     std::mutex mutex_;
-    std::thread* trading_thread_ = nullptr;
     bool is_trading_ = false;
     std::optional<int> last_accepted_order_id_ = std::nullopt;
+    Order::Side last_accepted_side_ = Order::Side::BID;
     
     std::mt19937 random_generator_;
     
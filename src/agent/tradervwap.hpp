@@ -1,13 +1,12 @@
 #ifndef TRADER_VWAP_HPP
 #define TRADER_VWAP_HPP
 
-#include <vector>
-#include <numeric>
 #include <stack> 
 #include <algorithm>
 #include <random> 
 #include "traderagent.hpp"
 #include "../message/profitmessage.hpp"
+#include "../indicators/vwap.hpp"
 
 class TraderVWAP : public TraderAgent
 {
@@ -21,7 +20,8 @@ public:
       lookback_{lookback},
       cancelling_{config->cancelling},
       trade_interval_ms_{config->trade_interval},
-      random_generator_{std::random_device{}()},
+      vwap_{static_cast<size_t>(lookback)},
+      random_generator_{SimulationClock::randomSeed()},
       mutex_{}
     {   
         // Mark as legacy agent
@@ -38,16 +38,7 @@ public:
 
     std::string getAgentName() const override { return "vwap"; }
 
-    /** Gracefully terminates the trader, freeing all memory. */
-    void terminate() override
-    {
-        if (trading_thread_ != nullptr)
-        {
-            trading_thread_->join();
-            delete(trading_thread_);
-        }
-        TraderAgent::terminate();
-    }
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TOP; }
 
     void onTradingStart() override
     {
@@ -64,6 +55,7 @@ public:
         // Delay shutdown to allow profit message to be sent completely.
         lock.unlock();
         is_trading_ = false;
+        stopActiveTrading();
     }
 
     void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override
@@ -133,43 +125,33 @@ private:
 
     void activelyTrade()
     {
-        trading_thread_ = new std::thread([&, this]()
-        {
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (is_trading_)
-            {
-                lock.unlock();
+        startActiveTrading(trade_interval_ms_, REL_JITTER, [this]() {
+            { 
+                if (!customer_orders_.empty()) 
                 { 
-                    if (!customer_orders_.empty()) 
-                    { 
-                        // Check if we have at least 'lookback_' entries
-                        if (price_volume_data_.size() >= lookback_)
-                        {
-                            double rolling_vwap = calculateVWAP(price_volume_data_); 
-                            double last_price  = price_volume_data_.back().first;
-                            std::cout << "Calculated Rolling VWAP: " << rolling_vwap << " (Last price: " << last_price << ")\n";
-                            placeOrder(rolling_vwap, last_price);
-                        } 
-
-                        else 
-                        { 
-                            processCustomerOrder(); 
-                        }
-                    }
-
-                    else if (price_volume_data_.size() >= lookback_)
-                    { 
-                        double rolling_vwap = calculateVWAP(price_volume_data_); 
-                        double last_price  = price_volume_data_.back().first;
+                    // Check if we have at least 'lookback_' entries
+                    if (vwap_.ready())
+                    {
+                        double rolling_vwap = vwap_.value(); 
+                        double last_price  = vwap_.lastPrice();
                         std::cout << "Calculated Rolling VWAP: " << rolling_vwap << " (Last price: " << last_price << ")\n";
                         placeOrder(rolling_vwap, last_price);
+                    } 
+
+                    else 
+                    { 
+                        processCustomerOrder(); 
                     }
-                } 
-                sleep();
-                lock.lock();
-            }
-            lock.unlock();
-            std::cout << "Finished actively trading.\n";
+                }
+
+                else if (vwap_.ready())
+                { 
+                    double rolling_vwap = vwap_.value(); 
+                    double last_price  = vwap_.lastPrice();
+                    std::cout << "Calculated Rolling VWAP: " << rolling_vwap << " (Last price: " << last_price << ")\n";
+                    placeOrder(rolling_vwap, last_price);
+                }
+            } 
         });
     }
 
@@ -262,44 +244,17 @@ private:
         double volume = msg->data->last_quantity_traded; 
         std::cout << "closing price: " << closing_price << " volume: " << volume << std::endl;
 
-        price_volume_data_.emplace_back(closing_price, volume);
-        if (price_volume_data_.size() > lookback_)
-        {
-            price_volume_data_.erase(price_volume_data_.begin());
-        }
+        vwap_.push(closing_price, volume);
 
         last_market_data_ = msg->data;
 
         // Debugging: Print stored market data
-        std::cout << "[DEBUG] Stored Market Data - Price: " << closing_price << ", Volume: " << volume << ", Buffer Size: " << price_volume_data_.size() << "\n";
-    }
-
-    void sleep()
-    {
-        std::uniform_real_distribution<> dist(-REL_JITTER, REL_JITTER);
-        unsigned long jitter = dist(random_generator_);
-        unsigned long sleep_time_ms = std::round(trade_interval_ms_ * (1.0 + jitter));
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
-    }
-
-    double calculateVWAP(const std::vector<std::pair<double, double>>& data)
-    {
-        double price_volume_sum = 0.0; // Sum of price * volume
-        double volume_sum = 0.0; // Sum of volume
-
-        for (const auto& [price, volume] : data) // For each price-volume pair in the data
-        {
-            price_volume_sum += price * volume; // Add the price * volume to the sum
-            volume_sum += volume; // Add the volume to the sum
-        }
-
-        return volume_sum > 0 ? price_volume_sum / volume_sum : 0.0; // Calculate VWAP as price-volume sum divided by volume sum
+        std::cout << "[DEBUG] Stored Market Data - Price: " << closing_price << ", Volume: " << volume << ", VWAP: " << vwap_.value() << "\n";
     }
 
     unsigned long long timeNow()
     {
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count();
+        return SimulationClock::nowNanos();
     }
 
 
@@ -310,11 +265,10 @@ private:
     bool cancelling_;
     unsigned int trade_interval_ms_ = 500; 
     int lookback_;
-    std::vector<std::pair<double, double>> price_volume_data_;
+    indicators::VWAP vwap_; // Rolling VWAP of the last lookback_ trades
     std::optional<int> last_accepted_order_id_ = std::nullopt;
     std::mt19937 random_generator_;
     std::mutex mutex_;
-    std::thread* trading_thread_ = nullptr;
     bool is_trading_ = false;
     unsigned long next_trade_timestamp_;
     constexpr static double REL_JITTER = 0.25;
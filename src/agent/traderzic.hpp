@@ -21,7 +21,7 @@ public:
       limit_price_{config->limit},
       cancelling_{config->cancelling},
       trade_interval_ms_{config->trade_interval},
-      random_generator_{std::random_device{}()},
+      random_generator_{SimulationClock::randomSeed()},
       mutex_{}
     {
         // Mark as legacy agent
@@ -38,16 +38,7 @@ public:
 
     std::string getAgentName() const override { return "zic"; }
 
-    /** Gracefully terminates the trader, freeing all memory. */
-    void terminate() override
-    {
-        if (trading_thread_ != nullptr)
-        {
-            trading_thread_->join();
-            delete(trading_thread_);
-        }
-        TraderAgent::terminate();
-    }
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TOP; }
 
     void onTradingStart() override
     {
@@ -64,6 +55,7 @@ public:
         // Delay shutdown to allow profit message to be sent completely.
         lock.unlock();
         is_trading_ = false;
+        stopActiveTrading();
     }
 
     void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override
@@ -146,35 +138,11 @@ private:
 
     void activelyTrade()
     {
-        trading_thread_ = new std::thread([&, this](){
-
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (is_trading_)
-            {
-                lock.unlock();
-
-                placeOrder();
-                sleep();
-
-                lock.lock();
-            }
-            lock.unlock();
-
-            std::cout << "Finished actively trading.\n";
+        startActiveTrading(trade_interval_ms_, REL_JITTER, [this]() {
+            placeOrder();
         });
     }
 
-    void sleep()
-    {
-        // Generate a random jitter
-        std::uniform_real_distribution<> dist(-REL_JITTER, REL_JITTER);
-        unsigned long jitter = dist(random_generator_);
-        unsigned long sleep_time_ms = std::round(trade_interval_ms_ * (1.0+jitter));
-
-        // Sleep for specified duration
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
-    }
-
     void placeOrder()
     {
         if (cancelling_ && last_accepted_order_id_.has_value())
@@ -225,7 +193,6 @@ private:
     std::mt19937 random_generator_;
 
     std::mutex mutex_;
-    std::thread* trading_thread_ = nullptr;
     bool is_trading_ = false;
 
     constexpr static double MIN_PRICE = 0.0;
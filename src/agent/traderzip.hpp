@@ -5,11 +5,14 @@
 #include <stack> 
 
 #include "traderagent.hpp"
+#include "zippopulation.hpp"
 #include "../config/zipconfig.hpp"
 #include "../message/profitmessage.hpp"
 #include "../message/customer_order_message.hpp"
 
-/** Real-time implementation of the ZIP trading algorithm. */
+/** Real-time implementation of the ZIP trading algorithm.
+ *  A trader configured as part of a population keeps its margin state in the ZIPPopulation of its process for its market,
+ *  which adjusts the margins of all its members in one pass per market data update. */
 class TraderZIP : public TraderAgent
 {
 public:
@@ -24,9 +27,14 @@ public:
       min_margin_{config->min_margin},
       trade_interval_ms_{config->trade_interval},
       liquidity_interval_ms_{config->liquidity_interval},
-      random_generator_{std::random_device{}()},
+      random_generator_{SimulationClock::randomSeed()},
       mutex_{}
     {
+        if (config->population)
+        {
+            population_ = ZIPPopulation::forMarket(config->exchange_name, config->ticker, config->max_update_rate);
+            population_slot_ = population_->join(ZIPPopulation::Member{trader_side_, limit_price_, min_margin_, trade_interval_ms_, liquidity_interval_ms_});
+        }
         initialiseConstants();
 
         // Mark as legacy agent
@@ -41,19 +49,15 @@ public:
         addDelayedStart(config->delay);
     }
 
-    std::string getAgentName() const override { return "zip"; }
-
-    /** Gracefully terminates the trader, freeing all memory. */
-    void terminate() override
+    ~TraderZIP()
     {
-        if (trading_thread_ != nullptr)
-        {
-            trading_thread_->join();
-            delete(trading_thread_);
-        }
-        TraderAgent::terminate();
+        if (population_ != nullptr) population_->leave(population_slot_);
     }
 
+    std::string getAgentName() const override { return "zip"; }
+
+    MarketDataFields marketDataFields() const override { return MarketDataFields::TOP; }
+
     void handleBroadcastFrom(std::string_view sender, MessagePtr message) override
     {
         if (message->type == MessageType::CUSTOMER_ORDER) 
@@ -76,6 +80,7 @@ public:
         std::cout << "Trading window started.\n";
         next_undercut_timestamp_ = timeNow() + (liquidity_interval_ms_ * MS_TO_NS);
         next_lower_margin_timestamp_ = timeNow() + (trade_interval_ms_ * MS_TO_NS);
+        if (population_ != nullptr) population_->startTrading(population_slot_, timeNow());
         is_trading_ = true;
         activelyTrade();
     }
@@ -88,10 +93,18 @@ public:
         // Delay shutdown to allow profit message to be sent completely.
         lock.unlock();
         is_trading_ = false;
+        stopActiveTrading();
+        if (population_ != nullptr) population_->stopTrading(population_slot_);
     }
 
     void onMarketData(std::string_view exchange, MarketDataMessagePtr msg) override
     {   
+        if (population_ != nullptr)
+        {
+            // Adjusts the margins of the whole population, unless another member has passed the update on already
+            population_->onMarketData(msg->data, msg->sequence, timeNow());
+            return;
+        }
         std::cout << "Received market data from " << exchange << "\n";
         reactToMarket(msg);
     }
@@ -107,6 +120,7 @@ public:
         {
             last_accepted_order_id_ = std::nullopt;
             next_lower_margin_timestamp_ = timeNow() + (trade_interval_ms_ * MS_TO_NS);
+            if (population_ != nullptr) population_->orderFilled(population_slot_, timeNow());
         }
 
         if (msg->trade) { 
@@ -121,7 +135,11 @@ public:
 
     void onCancelReject(std::string_view exchange, CancelRejectMessagePtr msg) override
     {
-
+        // The quote being amended is no longer resting, so the next one is placed anew
+        if (last_accepted_order_id_ == msg->order_id)
+        {
+            last_accepted_order_id_ = std::nullopt;
+        }
     }
 
 private:
@@ -136,6 +154,16 @@ private:
 
     void initialiseConstants()
     {
+        if (population_ != nullptr)
+        {
+            // Drawn by the population, which keeps them
+            last_price_ = limit_price_;
+            last_client_order_id_ = 0;
+            last_accepted_order_id_ = std::nullopt;
+            last_market_data_ = std::nullopt;
+            return;
+        }
+
         momentum_ = getRandom(0.0, 0.1);
         learning_rate_ = getRandom(0.0, 0.5);
 
@@ -161,33 +189,23 @@ private:
 
     void activelyTrade()
     {
-        trading_thread_ = new std::thread([&, this](){
-
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (is_trading_)
+        startActiveTrading(trade_interval_ms_, REL_JITTER, [this]() {
+            // Undercut competition if market not liquid
+            if (population_ != nullptr)
             {
-                lock.unlock();
-
-                // Undercut competition if market not liquid
-                if (timeNow() >= next_undercut_timestamp_)
-                {
-                    undercutCompetition();
-                }
-
-                // Place order
-                try {
-                    placeOrder();
-                } catch (const std::exception& e) {
-                    std::cerr << "ERROR: ZIP Trader crashed with exception: " << e.what() << std::endl;
-                }
-
-                sleep();
-
-                lock.lock();
+                population_->undercutIfDue(population_slot_, timeNow());
+            }
+            else if (timeNow() >= next_undercut_timestamp_)
+            {
+                undercutCompetition();
             }
-            lock.unlock();
 
-            std::cout << "Finished actively trading.\n";
+            // Place order
+            try {
+                placeOrder();
+            } catch (const std::exception& e) {
+                std::cerr << "ERROR: ZIP Trader crashed with exception: " << e.what() << std::endl;
+            }
         });
     }
 
@@ -255,17 +273,6 @@ private:
 
     }
 
-    void sleep()
-    {
-        // Generate a random jitter
-        std::uniform_real_distribution<> dist(-REL_JITTER, REL_JITTER);
-        unsigned long jitter = dist(random_generator_);
-        unsigned long sleep_time_ms = std::round(trade_interval_ms_ * (1.0+jitter));
-
-        // Sleep for specified duration
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
-    }
-
     void undercutCompetition()
     {   
         if (!last_market_data_.has_value()) {
@@ -357,12 +364,6 @@ private:
 
     void placeOrder()
     {
-        if (cancelling_ && last_accepted_order_id_.has_value())
-        {
-            cancelOrder(exchange_, trader_side_, ticker_, last_accepted_order_id_.value());
-            last_accepted_order_id_ = std::nullopt;
-        }
-
         std::lock_guard<std::mutex> lock(mutex_);
         if (!customer_orders_.empty()) 
         {   
@@ -372,9 +373,16 @@ private:
             //trader_side_ = cust_order->side;
         }
 
-        last_price_ = getQuotePrice();
+        last_price_ = (population_ != nullptr) ? population_->quote(population_slot_, limit_price_) : getQuotePrice();
         std::uniform_int_distribution<int> dist(10, 50);
         int quantity = dist(random_generator_);
+
+        // Reprice the resting quote in place rather than cancelling it and placing another
+        if (cancelling_ && last_accepted_order_id_.has_value())
+        {
+            amendOrder(exchange_, trader_side_, ticker_, last_accepted_order_id_.value(), quantity, last_price_);
+            return;
+        }
         placeLimitOrder(exchange_, trader_side_, ticker_, quantity, last_price_, limit_price_, Order::TimeInForce::GTC, ++last_client_order_id_);
         std::cout << ">> " << (trader_side_ == Order::Side::BID ? "BID" : "ASK") << " " << 100 << " @ " << last_price_ << "\n";
     }
@@ -382,8 +390,7 @@ private:
 
     unsigned long long timeNow()
     {
-        std::chrono::system_clock::duration now = std::chrono::system_clock::now().time_since_epoch();
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+        return SimulationClock::nowNanos();
     }
 
     double getRandom(double lower, double upper)
@@ -420,9 +427,12 @@ private:
     std::mt19937 random_generator_;
 
     std::mutex mutex_;
-    std::thread* trading_thread_ = nullptr;
     bool is_trading_ = false;
 
+    // Set if the margin state is kept by a population
+    std::shared_ptr<ZIPPopulation> population_;
+    size_t population_slot_ = 0;
+
     constexpr static double C_A = 0.05;
     constexpr static double C_R = 0.05;
     constexpr static double REL_JITTER = 0.25;
@@ -0,0 +1,329 @@
+#ifndef ZIP_POPULATION_HPP
+#define ZIP_POPULATION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../order/order.hpp"
+#include "../trade/marketdata.hpp"
+#include "../utilities/simulationclock.hpp"
+
+/** The margin state of the ZIP traders of a process that trade one ticker on one exchange, kept in arrays
+ *  with one element per trader, so that a market data update adjusts every margin in one pass over the arrays.
+ *  The update is the one TraderZIP::reactToMarket makes, written without branches, applied once however many of
+ *  the traders receive the update. Each trader draws its target price perturbations from a counter-based stream
+ *  of its own, with the same distributions as TraderZIP, so the pass needs no shared generator.
+ *  Members place their own orders; they call in from any thread, and the population serialises them. */
+class ZIPPopulation
+{
+public:
+
+    /** What a member trades, as configured for TraderZIP. */
+    struct Member
+    {
+        Order::Side side;
+        double limit_price;
+        double min_margin;
+        unsigned long trade_interval_ms;
+        unsigned long liquidity_interval_ms;
+    };
+
+    ZIPPopulation() = default;
+    ZIPPopulation(const ZIPPopulation&) = delete;
+    ZIPPopulation& operator=(const ZIPPopulation&) = delete;
+
+    /** Returns the population of the process for the given market, creating it on first use.
+     *  Members must receive the same updates, so traders throttled to different rates get different populations. */
+    static std::shared_ptr<ZIPPopulation> forMarket(const std::string& exchange, const std::string& ticker, unsigned int max_update_rate)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        std::weak_ptr<ZIPPopulation>& entry = registry()[std::make_tuple(exchange, ticker, max_update_rate)];
+        std::shared_ptr<ZIPPopulation> population = entry.lock();
+        if (population == nullptr)
+        {
+            population = std::make_shared<ZIPPopulation>();
+            entry = population;
+        }
+        return population;
+    }
+
+    /** Adds a trader, drawing its momentum, learning rate and initial margin as TraderZIP does, and returns its slot. */
+    size_t join(const Member& member)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t slot;
+        if (!free_slots_.empty())
+        {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        }
+        else
+        {
+            slot = size();
+            resize(slot + 1);
+        }
+
+        uint64_t seed = (static_cast<uint64_t>(SimulationClock::randomSeed()) << 32) | SimulationClock::randomSeed();
+        seeds_[slot] = seed;
+        draws_[slot] = 0;
+
+        is_bid_[slot] = member.side == Order::Side::BID;
+        limit_price_[slot] = member.limit_price;
+        min_margin_[slot] = member.min_margin;
+        trade_interval_ns_[slot] = member.trade_interval_ms * MS_TO_NS;
+        liquidity_interval_ns_[slot] = member.liquidity_interval_ms * MS_TO_NS;
+        momentum_[slot] = 0.1 * nextUniform(slot);
+        learning_rate_[slot] = 0.5 * nextUniform(slot);
+        double margin = 0.05 + 0.3 * nextUniform(slot);
+        margin_[slot] = is_bid_[slot] ? -margin : margin;
+        prev_change_[slot] = 0.0;
+        last_price_[slot] = member.limit_price;
+        next_lower_margin_[slot] = 0;
+        next_undercut_[slot] = 0;
+        trading_[slot] = 0;
+        primed_[slot] = 0;
+        return slot;
+    }
+
+    /** Removes the trader in the slot, which may be given to a later member. */
+    void leave(size_t slot)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        trading_[slot] = 0;
+        primed_[slot] = 0;
+        free_slots_.push_back(slot);
+    }
+
+    /** Starts adjusting the slot's margin on market data, as TraderZIP::onTradingStart. */
+    void startTrading(size_t slot, unsigned long long now)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        next_undercut_[slot] = now + liquidity_interval_ns_[slot];
+        next_lower_margin_[slot] = now + trade_interval_ns_[slot];
+        trading_[slot] = 1;
+    }
+
+    void stopTrading(size_t slot)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        trading_[slot] = 0;
+    }
+
+    /** Applies the update at the given position in the ticker's feed to every trading member, unless a member already
+     *  delivered it or a later one. A member's first update after it starts trading is only recorded, as in TraderZIP. */
+    void onMarketData(const MarketDataPtr& data, unsigned long sequence, unsigned long long now)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (last_data_ != nullptr && sequence <= last_sequence_) return;
+
+        if (last_data_ != nullptr && data->cumulative_volume_traded > last_data_->cumulative_volume_traded)
+        {
+            adjustMargins(data->last_price_traded, data->last_price_traded > last_data_->last_price_traded,
+                data->last_price_traded < last_data_->last_price_traded, now);
+        }
+
+        // Members trading now have seen market data, and adjust their margins from the next update
+        for (size_t i = 0; i < size(); ++i) primed_[i] |= trading_[i];
+        last_data_ = data;
+        last_sequence_ = sequence;
+    }
+
+    /** Moves the slot's margin towards the best competing quote if no trade has happened for its liquidity interval,
+     *  as TraderZIP::undercutCompetition. */
+    void undercutIfDue(size_t slot, unsigned long long now)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (now < next_undercut_[slot] || !primed_[slot] || last_data_ == nullptr) return;
+
+        bool bid = is_bid_[slot];
+        if (bid ? last_data_->best_ask_size <= 0 : last_data_->best_bid_size <= 0) return;
+
+        double u_abs = nextUniform(slot);
+        double u_rel = nextUniform(slot);
+        double target = bid ? increasedTarget(last_data_->best_ask, u_abs, u_rel) : decreasedTarget(last_data_->best_bid, u_abs, u_rel);
+        updateMargin(slot, target);
+        next_undercut_[slot] = now + liquidity_interval_ns_[slot];
+        next_lower_margin_[slot] = now + trade_interval_ns_[slot];
+    }
+
+    /** Sets the slot's limit price and returns the price it quotes, keeping it as the price its margin is adjusted from,
+     *  as TraderZIP::getQuotePrice. Quotes the limit price before any market data is seen. */
+    double quote(size_t slot, double limit_price)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        limit_price_[slot] = limit_price;
+        double price = limit_price;
+        if (primed_[slot])
+        {
+            price = std::round(limit_price * (1 + margin_[slot]));
+            price = is_bid_[slot] ? std::min(limit_price, price) : std::max(limit_price, price);
+        }
+        last_price_[slot] = price;
+        return price;
+    }
+
+    /** Restarts the slot's wait to lower its margin, after its order filled. */
+    void orderFilled(size_t slot, unsigned long long now)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        next_lower_margin_[slot] = now + trade_interval_ns_[slot];
+    }
+
+    double margin(size_t slot)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return margin_[slot];
+    }
+
+    /** Returns the number of slots, including those left free. */
+    size_t size() const { return is_bid_.size(); };
+
+    constexpr static double C_A = 0.05;
+    constexpr static double C_R = 0.05;
+    constexpr static unsigned long MS_TO_NS = 1000000;
+
+private:
+
+    /** One update for all members: a trade at the given price, up or down from the last one. Called with the mutex held.
+     *  Sellers raise their margin when the price went up to at least their quote, buyers when it went down to at most theirs,
+     *  and either lowers its margin once its trade interval has passed since it last did. Each step is computed for every
+     *  member and kept only where its condition holds, so the loop has no branches. */
+    void adjustMargins(double price, bool rose, bool fell, unsigned long long now)
+    {
+        size_t n = size();
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint64_t draw = draws_[i];
+            double u0 = uniform(seeds_[i], draw);
+            double u1 = uniform(seeds_[i], draw + 1);
+            double u2 = uniform(seeds_[i], draw + 2);
+            double u3 = uniform(seeds_[i], draw + 3);
+            draws_[i] = draw + 4;
+
+            bool bid = is_bid_[i];
+            bool active = trading_[i] & primed_[i];
+            double last_price = last_price_[i];
+
+            // Raising the margin moves sellers up and buyers down
+            bool raise = active & (bid ? (fell & (last_price >= price)) : (rose & (last_price <= price)));
+            double raise_target = bid ? decreasedTarget(price, u0, u1) : increasedTarget(price, u0, u1);
+            step(i, raise, raise_target);
+
+            // Lowering the margin moves buyers up and sellers down
+            bool lower = active & (now > next_lower_margin_[i]);
+            double lower_target = bid ? increasedTarget(price, u2, u3) : decreasedTarget(price, u2, u3);
+            step(i, lower, lower_target);
+
+            next_lower_margin_[i] = lower ? now + trade_interval_ns_[i] : next_lower_margin_[i];
+            next_undercut_[i] = active ? now + liquidity_interval_ns_[i] : next_undercut_[i];
+        }
+    }
+
+    /** The Widrow-Hoff step of TraderZIP::updateMargin towards the target, kept only if apply is set. */
+    void step(size_t i, bool apply, double target_price)
+    {
+        double change = ((1.0 - momentum_[i]) * (learning_rate_[i] * (target_price - last_price_[i]))) + (momentum_[i] * prev_change_[i]);
+        double new_margin = ((last_price_[i] + change) / limit_price_[i]) - 1.0;
+        double bounded = is_bid_[i] ? std::min(-min_margin_[i], new_margin) : std::max(min_margin_[i], new_margin);
+        prev_change_[i] = apply ? change : prev_change_[i];
+        margin_[i] = apply ? bounded : margin_[i];
+    }
+
+    void updateMargin(size_t i, double target_price)
+    {
+        step(i, true, target_price);
+    }
+
+    static double increasedTarget(double price, double u_abs, double u_rel)
+    {
+        return std::round(C_A * u_abs + (1.0 + C_R * u_rel) * price);
+    }
+
+    static double decreasedTarget(double price, double u_abs, double u_rel)
+    {
+        return std::round((1.0 - C_R * u_rel) * price - C_A * u_abs);
+    }
+
+    /** Returns the draw-th number of the stream with the given seed, uniform in [0, 1): SplitMix64 of the seed and counter. */
+    static double uniform(uint64_t seed, uint64_t draw)
+    {
+        uint64_t z = seed + (draw + 1) * 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        z ^= z >> 31;
+        return static_cast<double>(z >> 11) * 0x1.0p-53;
+    }
+
+    double nextUniform(size_t slot)
+    {
+        return uniform(seeds_[slot], draws_[slot]++);
+    }
+
+    void resize(size_t n)
+    {
+        is_bid_.resize(n);
+        limit_price_.resize(n);
+        min_margin_.resize(n);
+        momentum_.resize(n);
+        learning_rate_.resize(n);
+        margin_.resize(n);
+        prev_change_.resize(n);
+        last_price_.resize(n);
+        next_lower_margin_.resize(n);
+        next_undercut_.resize(n);
+        trade_interval_ns_.resize(n);
+        liquidity_interval_ns_.resize(n);
+        trading_.resize(n);
+        primed_.resize(n);
+        seeds_.resize(n);
+        draws_.resize(n);
+    }
+
+    typedef std::tuple<std::string, std::string, unsigned int> MarketKey;
+
+    static std::mutex& registryMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::map<MarketKey, std::weak_ptr<ZIPPopulation>>& registry()
+    {
+        static std::map<MarketKey, std::weak_ptr<ZIPPopulation>> populations;
+        return populations;
+    }
+
+    std::mutex mutex_;
+
+    // Per member, by slot
+    std::vector<uint8_t> is_bid_;
+    std::vector<double> limit_price_;
+    std::vector<double> min_margin_;
+    std::vector<double> momentum_;
+    std::vector<double> learning_rate_;
+    std::vector<double> margin_;
+    std::vector<double> prev_change_;
+    std::vector<double> last_price_; // Last price quoted, which margins are adjusted from
+    std::vector<unsigned long long> next_lower_margin_;
+    std::vector<unsigned long long> next_undercut_;
+    std::vector<unsigned long long> trade_interval_ns_;
+    std::vector<unsigned long long> liquidity_interval_ns_;
+    std::vector<uint8_t> trading_;
+    std::vector<uint8_t> primed_;    // Whether the member has seen market data since it started trading
+    std::vector<uint64_t> seeds_;    // Random streams
+    std::vector<uint64_t> draws_;
+
+    std::vector<size_t> free_slots_;
+    MarketDataPtr last_data_;
+    unsigned long last_sequence_ = 0; // Position of the last update in the feed, as updates in the same millisecond share a timestamp
+};
+
+#endif
\ No newline at end of file
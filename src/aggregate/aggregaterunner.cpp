@@ -0,0 +1,515 @@
+#include "aggregaterunner.hpp"
+#include "../config/configreader.hpp"
+#include "../sweep/sweeprunner.hpp"
+#include "../utilities/csvformat.hpp"
+#include "../utilities/mappedfile.hpp"
+#include "../utilities/workstealingpool.hpp"
+
+#ifdef SIMULATION_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+AggregateRunner::AggregateRunner(Options options)
+: options_{options},
+  input_path_{std::filesystem::absolute(options.input)},
+  output_path_{options.output.empty() ? input_path_ / "aggregate" : std::filesystem::absolute(options.output)}
+{
+}
+
+int AggregateRunner::run()
+{
+    std::vector<Configuration> configurations = scan();
+    size_t trials = 0;
+    for (Configuration const& configuration : configurations)
+    {
+        trials += configuration.trials.size();
+    }
+
+    std::atomic<int> failed = 0;
+    {
+        WorkStealingPool pool {options_.jobs > 0 ? options_.jobs : std::thread::hardware_concurrency()};
+        report("Reading " + std::to_string(trials) + " trials of " + std::to_string(configurations.size())
+            + " trader mixes, " + std::to_string(pool.size()) + " at once");
+        for (Configuration& configuration : configurations)
+        {
+            for (Trial& trial : configuration.trials)
+            {
+                pool.submit([this, &configuration, &trial, &failed]() {
+                    try
+                    {
+                        readTrial(trial);
+                    }
+                    catch (std::exception& e)
+                    {
+                        report("Configuration " + std::to_string(configuration.configuration) + " trial " + std::to_string(trial.trial)
+                            + " could not be read: " + e.what());
+                        ++failed;
+                    }
+                });
+            }
+        }
+        pool.wait();
+    }
+
+    std::filesystem::create_directories(output_path_);
+    for (Configuration const& configuration : configurations)
+    {
+        writeConfiguration(configuration);
+    }
+    writeSummary(configurations);
+    report("Tables written to " + output_path_.string() + ", " + std::to_string(failed.load()) + " trials could not be read");
+    return failed.load();
+}
+
+std::vector<AggregateRunner::Configuration> AggregateRunner::scan()
+{
+    if (!std::filesystem::is_directory(input_path_))
+    {
+        throw std::runtime_error("Sweep directory not found: " + input_path_.string());
+    }
+
+    // Directories are numbered from 1 as the sweep expands the markets file, and are taken in that order
+    auto numbered = [](const std::filesystem::path& path, std::string_view prefix) -> int {
+        std::string name = path.filename().string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) return 0;
+        int number = 0;
+        auto [end, ec] = std::from_chars(name.data() + prefix.size(), name.data() + name.size(), number);
+        return (ec == std::errc{} && end == name.data() + name.size()) ? number : 0;
+    };
+
+    std::vector<Configuration> configurations;
+    for (auto const& entry : std::filesystem::directory_iterator{input_path_})
+    {
+        int number = numbered(entry.path(), "config_");
+        if (!entry.is_directory() || number == 0) continue;
+
+        Configuration configuration {number, entry.path(), {}, {}};
+        if (std::filesystem::exists(entry.path() / "markets.csv"))
+        {
+            configuration.mix = readMix(entry.path() / "markets.csv");
+        }
+        for (auto const& trial_entry : std::filesystem::directory_iterator{entry.path()})
+        {
+            int trial = numbered(trial_entry.path(), "trial_");
+            if (!trial_entry.is_directory() || trial == 0) continue;
+            if (!std::filesystem::exists(trial_entry.path() / SweepRunner::COMPLETED_MARKER)) continue;
+            configuration.trials.push_back(Trial{trial, trial_entry.path()});
+        }
+        std::sort(configuration.trials.begin(), configuration.trials.end(),
+            [](const Trial& a, const Trial& b) { return a.trial < b.trial; });
+        configurations.push_back(std::move(configuration));
+    }
+    std::sort(configurations.begin(), configurations.end(),
+        [](const Configuration& a, const Configuration& b) { return a.configuration < b.configuration; });
+    return configurations;
+}
+
+std::vector<std::pair<std::string, int>> AggregateRunner::readMix(const std::filesystem::path& path)
+{
+    std::ifstream markets {path};
+    std::string line;
+    std::getline(markets, line);
+
+    // Each count of a trader type is a buyer and a seller
+    std::vector<std::pair<std::string, int>> mix;
+    std::stringstream counts {line};
+    std::string count;
+    for (size_t index = 0; std::getline(counts, count, ',') && index < ConfigReader::MARKET_TRADER_TYPES.size(); ++index)
+    {
+        int traders = std::stoi(count) * 2;
+        if (traders > 0) mix.emplace_back(ConfigReader::MARKET_TRADER_TYPES[index], traders);
+    }
+    return mix;
+}
+
+void AggregateRunner::readTrial(Trial& trial)
+{
+    // Every ticker of an exchange has a profits file holding the same profits of the whole exchange, so one is read for each exchange.
+    // Files are named profits_snapshot_<exchange>_<ticker>_<time>.csv, the time holding no underscores
+    std::filesystem::path profits = trial.directory / "profits";
+    std::unordered_set<std::string> exchanges;
+    if (std::filesystem::is_directory(profits))
+    {
+        for (auto const& entry : std::filesystem::directory_iterator{profits})
+        {
+            std::string name = entry.path().stem().string();
+            if (name.rfind("profits_snapshot_", 0) != 0 || entry.path().extension() != ".csv") continue;
+            std::string exchange = name.substr(0, name.rfind('_'));
+            exchange = exchange.substr(0, exchange.rfind('_'));
+            if (!exchanges.insert(exchange).second) continue;
+
+            MappedFile file {entry.path().string()};
+            readProfits(file.view(), trial);
+        }
+    }
+
+    std::filesystem::path trades = trial.directory / "trades";
+    if (std::filesystem::is_directory(trades))
+    {
+        for (auto const& entry : std::filesystem::directory_iterator{trades})
+        {
+            std::string name = entry.path().filename().string();
+            if (name.rfind("trades_", 0) != 0) continue;
+
+            MappedFile file {entry.path().string()};
+            if (name.ends_with(".csv"))
+            {
+                readTradesCSV(file.view(), trial);
+            }
+            else if (name.ends_with(".csv.zst"))
+            {
+                readTradesCSV(decompress(file.view(), entry.path().string()), trial);
+            }
+            else if (name.ends_with(".col"))
+            {
+                readTradesColumnar(file.view(), entry.path().string(), trial);
+            }
+        }
+    }
+    trial.read = true;
+}
+
+void AggregateRunner::readProfits(std::string_view contents, Trial& trial)
+{
+    auto trim = [](std::string_view field) {
+        while (!field.empty() && field.front() == ' ') field.remove_prefix(1);
+        while (!field.empty() && field.back() == ' ') field.remove_suffix(1);
+        return field;
+    };
+
+    nextLine(contents); // Headers
+    while (!contents.empty())
+    {
+        std::string_view row = nextLine(contents);
+        if (row.empty()) continue;
+
+        size_t comma = row.find(',');
+        std::string_view name = trim(row.substr(0, comma));
+        std::string_view value = trim(comma == std::string_view::npos ? std::string_view{} : row.substr(comma + 1));
+        double profit = 0;
+        auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), profit);
+        if (ec != std::errc{} || value.empty())
+        {
+            throw std::runtime_error("Malformed profits row: " + std::string{row});
+        }
+
+        std::string type {traderType(name)};
+        trial.types[type].profit += profit;
+        ++trial.names[type];
+    }
+}
+
+void AggregateRunner::readTradesCSV(std::string_view contents, Trial& trial)
+{
+    if (contents.empty()) return;
+
+    // Columns are found by their headers, so that tapes with columns added later are still read
+    std::string_view headers = nextLine(contents);
+    size_t quantity_index = SIZE_MAX, buyer_index = SIZE_MAX, seller_index = SIZE_MAX;
+    for (size_t index = 0; !headers.empty(); ++index)
+    {
+        size_t comma = headers.find(',');
+        std::string_view header = headers.substr(0, comma);
+        if (header == "quantity") quantity_index = index;
+        else if (header == "buyer_name") buyer_index = index;
+        else if (header == "seller_name") seller_index = index;
+        headers = (comma == std::string_view::npos) ? std::string_view{} : headers.substr(comma + 1);
+    }
+    if (quantity_index == SIZE_MAX || buyer_index == SIZE_MAX || seller_index == SIZE_MAX)
+    {
+        throw std::runtime_error("Not a CSV trade tape");
+    }
+    size_t last_index = std::max({quantity_index, buyer_index, seller_index});
+
+    while (!contents.empty())
+    {
+        std::string_view row = nextLine(contents);
+        if (row.empty()) continue;
+
+        std::string_view quantity, buyer, seller;
+        for (size_t index = 0; index <= last_index; ++index)
+        {
+            size_t comma = row.find(',');
+            std::string_view field = row.substr(0, comma);
+            if (index == quantity_index) quantity = field;
+            else if (index == buyer_index) buyer = field;
+            else if (index == seller_index) seller = field;
+            row = (comma == std::string_view::npos) ? std::string_view{} : row.substr(comma + 1);
+        }
+
+        long traded = 0;
+        std::from_chars(quantity.data(), quantity.data() + quantity.size(), traded);
+        addTrade(buyer, seller, traded, trial);
+    }
+}
+
+void AggregateRunner::readTradesColumnar(std::string_view contents, const std::string& path, Trial& trial)
+{
+    // A tape with no rows is empty; the layout is described in columnarwriter.hpp
+    if (contents.empty()) return;
+
+    auto take = [&contents, &path](size_t bytes) {
+        if (contents.size() < bytes)
+        {
+            throw std::runtime_error("Columnar trade tape is truncated: " + path);
+        }
+        std::string_view taken = contents.substr(0, bytes);
+        contents.remove_prefix(bytes);
+        return taken;
+    };
+    auto value = [&take]<class T>(T) {
+        T result;
+        std::memcpy(&result, take(sizeof(T)).data(), sizeof(T));
+        return result;
+    };
+
+    if (take(8) != "SIMCOL01")
+    {
+        throw std::runtime_error("Not a columnar output file: " + path);
+    }
+    uint32_t column_count = value(uint32_t{});
+    std::vector<std::pair<std::string_view, uint8_t>> columns;
+    for (uint32_t i = 0; i < column_count; ++i)
+    {
+        uint8_t type = value(uint8_t{});
+        uint32_t name_length = value(uint32_t{});
+        columns.emplace_back(take(name_length), type);
+    }
+
+    while (!contents.empty())
+    {
+        uint32_t rows = value(uint32_t{});
+        std::string_view quantities, buyers, sellers;
+        for (auto const& [name, type] : columns)
+        {
+            std::string_view values = take(value(uint64_t{}));
+            if (name == "quantity") quantities = values;
+            else if (name == "buyer_name") buyers = values;
+            else if (name == "seller_name") sellers = values;
+        }
+        if (quantities.size() < rows * sizeof(int64_t) || buyers.size() < rows * sizeof(uint32_t)
+            || sellers.size() < rows * sizeof(uint32_t))
+        {
+            throw std::runtime_error("Not a columnar trade tape: " + path);
+        }
+
+        // String columns hold the end offset of each row, then the characters of all rows
+        auto text = [rows](std::string_view strings, uint32_t row) {
+            uint32_t start = 0, end = 0;
+            if (row > 0) std::memcpy(&start, strings.data() + (row - 1) * sizeof(uint32_t), sizeof(uint32_t));
+            std::memcpy(&end, strings.data() + row * sizeof(uint32_t), sizeof(uint32_t));
+            return strings.substr(rows * sizeof(uint32_t) + start, end - start);
+        };
+        for (uint32_t row = 0; row < rows; ++row)
+        {
+            int64_t quantity;
+            std::memcpy(&quantity, quantities.data() + row * sizeof(int64_t), sizeof(int64_t));
+            addTrade(text(buyers, row), text(sellers, row), static_cast<long>(quantity), trial);
+        }
+    }
+}
+
+void AggregateRunner::addTrade(std::string_view buyer, std::string_view seller, long quantity, Trial& trial)
+{
+    ++trial.trades;
+    trial.volume += quantity;
+    ++trial.types[std::string{traderType(buyer)}].trades;
+    ++trial.types[std::string{traderType(seller)}].trades;
+}
+
+void AggregateRunner::writeConfiguration(const Configuration& configuration)
+{
+    std::vector<std::string> types = typesOf(configuration);
+
+    // Laid out as the tables the plotting scripts read, a group of columns for each trader type
+    std::string table = "trial";
+    for (size_t k = 1; k <= types.size(); ++k)
+    {
+        std::string n = std::to_string(k);
+        table += ",trader_type_" + n + ",num_traders_" + n + ",total_profit_" + n + ",avg_profit_per_trader_" + n;
+    }
+    table += ",trades,volume\n";
+
+    for (Trial const& trial : configuration.trials)
+    {
+        if (!trial.read) continue;
+
+        csv::append(table, trial.trial);
+        for (std::string const& type : types)
+        {
+            auto it = trial.types.find(type);
+            double profit = (it != trial.types.end()) ? it->second.profit : 0.0;
+            int traders = tradersOf(configuration, trial, type);
+            table += ",";
+            csv::appendFields(table, ",", std::string_view{type}, traders, profit, traders > 0 ? profit / traders : 0.0);
+        }
+        table += ",";
+        csv::appendFields(table, ",", trial.trades, trial.volume);
+        table += "\n";
+    }
+
+    std::ofstream file {output_path_ / ("config_" + std::to_string(configuration.configuration) + ".csv")};
+    file << table;
+}
+
+void AggregateRunner::writeSummary(const std::vector<Configuration>& configurations)
+{
+    std::string table = "config,trader_type,num_traders,trials,mean_profit,profit_variance,mean_profit_per_trader,wins,win_ratio,mean_trades\n";
+    for (Configuration const& configuration : configurations)
+    {
+        std::vector<std::string> types = typesOf(configuration);
+        std::vector<long> count(types.size()), wins(types.size()), trades(types.size());
+        std::vector<double> mean(types.size()), m2(types.size());
+        std::vector<int> traders(types.size());
+        long decided = 0;
+
+        for (Trial const& trial : configuration.trials)
+        {
+            if (!trial.read) continue;
+
+            // A trial is won by the type with the highest profit per trader, and by none if the highest is tied
+            double best = 0;
+            std::optional<size_t> winner;
+            bool tied = false;
+            for (size_t i = 0; i < types.size(); ++i)
+            {
+                auto it = trial.types.find(types[i]);
+                TypeTotals totals = (it != trial.types.end()) ? it->second : TypeTotals{};
+                traders[i] = std::max(traders[i], tradersOf(configuration, trial, types[i]));
+
+                // Welford's update of the mean and variance
+                ++count[i];
+                double delta = totals.profit - mean[i];
+                mean[i] += delta / count[i];
+                m2[i] += delta * (totals.profit - mean[i]);
+                trades[i] += totals.trades;
+
+                double per_trader = traders[i] > 0 ? totals.profit / traders[i] : 0.0;
+                if (!winner.has_value() || per_trader > best)
+                {
+                    best = per_trader;
+                    winner = i;
+                    tied = false;
+                }
+                else if (per_trader == best)
+                {
+                    tied = true;
+                }
+            }
+            if (winner.has_value() && !tied)
+            {
+                ++wins[*winner];
+                ++decided;
+            }
+        }
+
+        for (size_t i = 0; i < types.size(); ++i)
+        {
+            if (count[i] == 0) continue;
+            double variance = count[i] > 1 ? m2[i] / (count[i] - 1) : 0.0;
+            csv::appendFields(table, ",", configuration.configuration, std::string_view{types[i]}, traders[i], count[i],
+                mean[i], variance, traders[i] > 0 ? mean[i] / traders[i] : 0.0, wins[i],
+                decided > 0 ? static_cast<double>(wins[i]) / decided : 0.0, static_cast<double>(trades[i]) / count[i]);
+            table += "\n";
+        }
+    }
+
+    std::ofstream file {output_path_ / "summary.csv"};
+    file << table;
+}
+
+std::vector<std::string> AggregateRunner::typesOf(const Configuration& configuration)
+{
+    std::vector<std::string> types;
+    for (auto const& [type, traders] : configuration.mix)
+    {
+        types.push_back(type);
+    }
+
+    std::set<std::string> others;
+    for (Trial const& trial : configuration.trials)
+    {
+        for (auto const& [type, totals] : trial.types)
+        {
+            if (std::find(types.begin(), types.end(), type) == types.end()) others.insert(type);
+        }
+    }
+    types.insert(types.end(), others.begin(), others.end());
+    return types;
+}
+
+int AggregateRunner::tradersOf(const Configuration& configuration, const Trial& trial, const std::string& type)
+{
+    for (auto const& [mix_type, traders] : configuration.mix)
+    {
+        if (mix_type == type) return traders;
+    }
+    auto it = trial.names.find(type);
+    return (it != trial.names.end()) ? it->second : 0;
+}
+
+std::string_view AggregateRunner::traderType(std::string_view agent_name)
+{
+    for (std::string_view side : {std::string_view{"_Buyer"}, std::string_view{"_Seller"}})
+    {
+        if (agent_name.ends_with(side)) return agent_name.substr(0, agent_name.size() - side.size());
+    }
+    return agent_name;
+}
+
+std::string AggregateRunner::decompress([[maybe_unused]] std::string_view compressed, const std::string& path)
+{
+#ifdef SIMULATION_WITH_ZSTD
+    // The file is a sequence of independent frames, which a stream decompresses one after another
+    std::unique_ptr<ZSTD_DCtx, size_t(*)(ZSTD_DCtx*)> context {ZSTD_createDCtx(), ZSTD_freeDCtx};
+    std::string contents;
+    std::vector<char> buffer(ZSTD_DStreamOutSize());
+    ZSTD_inBuffer in {compressed.data(), compressed.size(), 0};
+    bool flushed = false;
+    while (in.pos < in.size || !flushed)
+    {
+        ZSTD_outBuffer out {buffer.data(), buffer.size(), 0};
+        size_t result = ZSTD_decompressStream(context.get(), &out, &in);
+        if (ZSTD_isError(result))
+        {
+            throw std::runtime_error("Failed to decompress " + path + ": " + ZSTD_getErrorName(result));
+        }
+        contents.append(buffer.data(), out.pos);
+
+        // A full output buffer may leave more of the frame to flush once the input is consumed
+        flushed = out.pos < out.size;
+    }
+    return contents;
+#else
+    throw std::runtime_error("Cannot decompress " + path + ": built without zstd");
+#endif
+}
+
+std::string_view AggregateRunner::nextLine(std::string_view& text)
+{
+    size_t end = text.find('\n');
+    std::string_view line = text.substr(0, end);
+    text = (end == std::string_view::npos) ? std::string_view{} : text.substr(end + 1);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return line;
+}
+
+void AggregateRunner::report(const std::string& line)
+{
+    std::unique_lock<std::mutex> lock(report_mutex_);
+    std::cout << "[Aggregate] " << line << std::endl;
+}
@@ -0,0 +1,112 @@
+#ifndef AGGREGATE_RUNNER_HPP
+#define AGGREGATE_RUNNER_HPP
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/** Summarises the outputs of a parameter sweep in one pass: the trials of every trader mix are read in parallel,
+ *  their profits and trade tapes parsed in place, whether CSV, compressed CSV or columnar, and the results written
+ *  as a table of the trials of each trader mix, in the layout the plotting and statistical test scripts read,
+ *  and one table summarising every trader type of every mix. */
+class AggregateRunner
+{
+public:
+
+    struct Options
+    {
+        std::string input;           // the directory of the sweep, holding a config_<n> directory for each trader mix
+        std::string output;          // the directory the tables are written to, empty for <input>/aggregate
+        unsigned int jobs = 0;       // trials read at once, 0 for one per hardware thread
+    };
+
+    AggregateRunner() = delete;
+
+    explicit AggregateRunner(Options options);
+
+    /** Reads every completed trial of the sweep and writes the tables. Returns the number of trials that could not be read. */
+    int run();
+
+private:
+
+    /** Totals of the traders of one type in one trial. */
+    struct TypeTotals
+    {
+        double profit = 0;
+        long trades = 0; // trades the traders of the type took part in, on either side
+    };
+
+    struct Trial
+    {
+        int trial = 0;
+        std::filesystem::path directory;
+        std::unordered_map<std::string, TypeTotals> types {};
+        std::unordered_map<std::string, int> names {}; // agent names of each type the profits were written for
+        long trades = 0;
+        long volume = 0;
+        bool read = false;
+    };
+
+    struct Configuration
+    {
+        int configuration;
+        std::filesystem::path directory;
+        std::vector<std::pair<std::string, int>> mix; // trader types of the mix in column order, with their number of traders
+        std::vector<Trial> trials;
+    };
+
+    /** Finds the trader mixes of the sweep and their completed trials, in the order they were swept. */
+    std::vector<Configuration> scan();
+
+    /** Returns the trader types of the mix in the given markets file and their number of traders, buyers and sellers alike. */
+    std::vector<std::pair<std::string, int>> readMix(const std::filesystem::path& path);
+
+    /** Reads the profits and trade tapes the exchanges of the trial wrote. */
+    void readTrial(Trial& trial);
+
+    /** Adds the profits of the given profits file to the totals of their trader types. */
+    void readProfits(std::string_view contents, Trial& trial);
+
+    /** Adds the trades of the given CSV trade tape to the totals of the trial and of the trader types taking part. */
+    void readTradesCSV(std::string_view contents, Trial& trial);
+
+    /** Adds the trades of the given columnar trade tape to the totals of the trial and of the trader types taking part. */
+    void readTradesColumnar(std::string_view contents, const std::string& path, Trial& trial);
+
+    /** Adds a trade of the given quantity between the named traders. */
+    void addTrade(std::string_view buyer, std::string_view seller, long quantity, Trial& trial);
+
+    /** Writes the table of the trials of the trader mix, one row per trial with the totals of each of its trader types. */
+    void writeConfiguration(const Configuration& configuration);
+
+    /** Writes the mean and variance of the profits, the wins and the trades of every trader type of every mix. */
+    void writeSummary(const std::vector<Configuration>& configurations);
+
+    /** Returns the trader types of the mix, then any others its trials had profits or trades for, in the order they are tabled. */
+    static std::vector<std::string> typesOf(const Configuration& configuration);
+
+    /** Returns the number of traders of the type in the mix, or of agent names it had profits for if it is not in the mix. */
+    static int tradersOf(const Configuration& configuration, const Trial& trial, const std::string& type);
+
+    /** Returns the trader type of the agent, its name without the side markets.csv traders are named after. */
+    static std::string_view traderType(std::string_view agent_name);
+
+    /** Returns the contents of the zstd-compressed file, throwing if it cannot be decompressed or the build has no zstd. */
+    static std::string decompress(std::string_view compressed, const std::string& path);
+
+    /** Returns the next line of the text, without its line ending, and moves the text past it. */
+    static std::string_view nextLine(std::string_view& text);
+
+    /** Prints a line of progress; trials report from several threads. */
+    void report(const std::string& line);
+
+    Options options_;
+    std::filesystem::path input_path_;
+    std::filesystem::path output_path_;
+    std::mutex report_mutex_;
+};
+
+#endif
@@ -7,6 +7,7 @@
 #include <boost/serialization/unordered_map.hpp>
 #include <boost/serialization/vector.hpp>
 
+#include "linkprofile.hpp"
 #include "../agent/agenttype.hpp"
 
 /** Used to configure an instance of an agent in the simulation. */
@@ -20,6 +21,34 @@ public:
     int agent_id;
     std::string addr;
     AgentType type;
+    std::unordered_map<std::string, LinkProfile> links; // wide area networks emulated to peers, by their address
+
+    /** Returns a copy of the configuration, as the derived type. */
+    virtual std::shared_ptr<AgentConfig> clone() const
+    {
+        return std::make_shared<AgentConfig>(*this);
+    }
+
+    /** Moves the agent, and the addresses of the agents it connects to, the given number of ports up. */
+    virtual void offsetPorts(int offset)
+    {
+        addr = offsetPort(addr, offset);
+
+        std::unordered_map<std::string, LinkProfile> offset_links;
+        for (auto const& [address, profile] : links)
+        {
+            offset_links.emplace(offsetPort(address, offset), profile);
+        }
+        links = std::move(offset_links);
+    }
+
+    /** Returns the given ip:port address moved the given number of ports up. */
+    static std::string offsetPort(const std::string& address, int offset)
+    {
+        size_t colon = address.rfind(':');
+        if (offset == 0 || colon == std::string::npos) return address;
+        return address.substr(0, colon + 1) + std::to_string(std::stoi(address.substr(colon + 1)) + offset);
+    }
 
 private:
 
@@ -30,6 +59,7 @@ private:
         ar & agent_id;
         ar & addr;
         ar & type;
+        ar & links;
     }
 };
 
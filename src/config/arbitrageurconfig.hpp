@@ -19,6 +19,19 @@ public:
     double alpha;
     unsigned int trade_interval;
     bool cancelling;
+    bool reactive = false; // check for arbitrage on every market data update rather than every trade interval
+
+    std::shared_ptr<AgentConfig> clone() const override
+    {
+        return std::make_shared<ArbitrageurConfig>(*this);
+    }
+
+    void offsetPorts(int offset) override
+    {
+        AgentConfig::offsetPorts(offset);
+        exchange0_addr = offsetPort(exchange0_addr, offset);
+        exchange1_addr = offsetPort(exchange1_addr, offset);
+    }
 
 private:
     
@@ -36,6 +49,7 @@ private:
         ar & alpha;
         ar & trade_interval;
         ar & cancelling;
+        ar & reactive;
     }
 
 };
@@ -0,0 +1,28 @@
+#ifndef ARRIVAL_PROCESS_HPP
+#define ARRIVAL_PROCESS_HPP
+
+#include <string>
+
+enum class ArrivalProcess : int
+{
+    FIXED,   // Orders evenly spaced at the configured rate
+    POISSON  // Exponentially distributed gaps averaging the configured rate
+};
+
+inline std::string to_string(ArrivalProcess arrival_process)
+{
+    switch (arrival_process) {
+        case ArrivalProcess::FIXED: return std::string{"fixed"};
+        case ArrivalProcess::POISSON: return std::string{"poisson"};
+        default: return std::string{""};
+    }
+}
+
+/** Returns the arrival process for the given name. Defaults to fixed spacing. */
+inline ArrivalProcess arrival_process_from_string(std::string_view name)
+{
+    if (name == "poisson") return ArrivalProcess::POISSON;
+    return ArrivalProcess::FIXED;
+}
+
+#endif
@@ -1,6 +1,11 @@
 #include "configreader.hpp"
+#include "arbitrageurconfig.hpp"
+#include "marketdatarelayconfig.hpp"
 #include "../agent/agentfactory.hpp"
 #include "../pugi/pugixml.hpp"
+#include "../utilities/simulationclock.hpp"
+
+#include <unordered_set>
 
 SimulationConfigPtr ConfigReader::readConfig(std::string& filepath)
 {
@@ -17,12 +22,16 @@ SimulationConfigPtr ConfigReader::readConfig(std::string& filepath)
     pugi::xml_node parameters = simulation.child("parameters");
     int time = parameters.child("time").text().as_int(120); // Default to 120 seconds
     int repetitions = parameters.child("repetitions").text().as_int(1); // Default to 1 repetition
+    int traders_per_node = std::max(parameters.child("traders-per-node").text().as_int(1), 1); // Default to a process per trader
+    int concurrent_trials = std::max(parameters.child("concurrent-trials").text().as_int(1), 1); // Default to one trial at a time
+    int port_stride = parameters.child("port-stride").text().as_int(0); // Default to the span of the configured ports
     
     // Parse through the available instances
     std::vector<std::string> exchange_addrs;
     std::vector<std::string> trader_addrs;
     std::vector<std::string> watcher_addrs;
     std::vector<std::string> injector_addrs;
+    std::vector<std::string> relay_addrs;
     
     pugi::xml_node instances = simulation.child("instances");
     for (auto instance : instances.children())
@@ -47,6 +56,10 @@ SimulationConfigPtr ConfigReader::readConfig(std::string& filepath)
         {
             injector_addrs.push_back(addr);
         }
+        else if (std::string{instance.attribute("agent-type").value()} == "relay")
+        {
+            relay_addrs.push_back(addr);
+        }
     }
 
     // Parse through the configured agents
@@ -67,11 +80,32 @@ SimulationConfigPtr ConfigReader::readConfig(std::string& filepath)
         ++agent_id; 
     }
 
+    // Exchanges sharing a venue each trade a share of its tickers, and traders of the venue route orders by ticker
+    std::unordered_map<std::string, RoutingTable> venue_routes;
+    for (ExchangeConfigPtr const& exchange_config : exchange_configs)
+    {
+        if (exchange_config->venue.empty()) continue;
+        if (exchange_addrs_map.contains(exchange_config->venue) && !venue_routes.contains(exchange_config->venue))
+        {
+            throw std::runtime_error("Venue " + exchange_config->venue + " has the name of an exchange");
+        }
+        RoutingTable& routes = venue_routes[exchange_config->venue];
+        for (std::string const& ticker : exchange_config->tickers)
+        {
+            if (!routes.shardFor(ticker).empty())
+            {
+                throw std::runtime_error("Ticker " + ticker + " is traded by more than one shard of venue " + exchange_config->venue);
+            }
+        }
+        routes.addShard(exchange_config->name, exchange_config->addr, exchange_config->tickers);
+        exchange_addrs_map.insert({exchange_config->venue, exchange_config->addr}); // the first shard, until the ticker is known
+    }
+
     // Get the default exchange name and ticker from exchange name for traders to use. - CHANGE LOGIC FOR MULTIPLE EXCHANGES. 
     std::string default_exchange_name; 
     std::string default_ticker;
     if (!exchange_configs.empty()) {
-        default_exchange_name = exchange_configs.at(0)->name;
+        default_exchange_name = exchange_configs.at(0)->venue.empty() ? exchange_configs.at(0)->name : exchange_configs.at(0)->venue;
         if (!exchange_configs.at(0)->tickers.empty()) {
             default_ticker = exchange_configs.at(0)->tickers.at(0);
         }
@@ -104,9 +138,30 @@ SimulationConfigPtr ConfigReader::readConfig(std::string& filepath)
         csv_filepath = filepath; // Set the CSV filepath
     }
     std::cout << "Loading trader configurations from " << csv_filepath << "..." << std::endl; // DEBUG
-    SimulationConfigPtr csv_config = readConfigFromCSV(csv_filepath, exchange_addrs_map, agent_id, default_exchange_name, default_ticker); // Read trader configurations from CSV
+    SimulationConfigPtr csv_config = readConfigFromCSV(csv_filepath, exchange_addrs_map, agent_id, default_exchange_name, default_ticker, traders_per_node); // Read trader configurations from CSV
     std::vector<AgentConfigPtr> trader_configs = csv_config->traders(); // Get trader configurations from CSV
 
+    // Traders of a venue are given its routing table, and connect to the shard trading their ticker under the venue's name
+    for (AgentConfigPtr const& trader_config : trader_configs)
+    {
+        TraderConfigPtr trader = std::dynamic_pointer_cast<TraderConfig>(trader_config);
+        if (!trader) continue;
+        auto routes = venue_routes.find(trader->exchange_name);
+        if (routes == venue_routes.end()) continue;
+
+        std::string_view shard = routes->second.shardFor(trader->ticker);
+        if (shard.empty())
+        {
+            throw std::runtime_error("No shard of venue " + trader->exchange_name + " trades " + trader->ticker);
+        }
+        trader->routes = routes->second;
+        trader->exchange_addr = routes->second.shards().at(std::string{shard});
+    }
+
+    // Wide area networks emulated between exchanges and their traders
+    pugi::xml_node links = simulation.child("links");
+    configureLinks(links, exchange_configs, trader_configs);
+
     // Watchers
     std::vector<AgentConfigPtr> watcher_configs;
     int watcher_instance_id = 0;
@@ -136,12 +191,49 @@ SimulationConfigPtr ConfigReader::readConfig(std::string& filepath)
             injector_addrs.at(injector_instance_id),
             exchange_addrs_map
         );
+
+        // The schedule is generated up front for the trading session of the injector's exchange
+        OrderInjectorConfigPtr order_injector_config = std::static_pointer_cast<OrderInjectorConfig>(injector_config);
+        for (ExchangeConfigPtr const& exchange_config : exchange_configs)
+        {
+            if (exchange_config->name == order_injector_config->exchange_name)
+            {
+                order_injector_config->session_time = exchange_config->trading_time;
+            }
+        }
         injector_configs.push_back(injector_config);
         ++injector_instance_id;
         ++agent_id;
     }
 
-    SimulationConfigPtr simulation_config = std::make_shared<SimulationConfig>(repetitions, time, exchange_configs, trader_configs, watcher_configs, injector_configs);
+    // Relays
+    pugi::xml_node relays = simulation.child("agents").child("relays");
+    std::vector<AgentConfigPtr> relay_configs = configureRelays(relays, agent_id, relay_addrs, exchange_configs, trader_configs);
+
+    // Exchanges open trading as soon as the traders connecting to them, or the relays of those that take market data from one, have all subscribed
+    for (ExchangeConfigPtr const& exchange_config : exchange_configs)
+    {
+        for (AgentConfigPtr const& trader_config : trader_configs)
+        {
+            TraderConfigPtr trader = std::dynamic_pointer_cast<TraderConfig>(trader_config);
+            ArbitrageurConfigPtr arbitrageur = std::dynamic_pointer_cast<ArbitrageurConfig>(trader_config);
+            if ((trader && trader->exchange_addr == exchange_config->addr && trader->relay_name.empty()) 
+                || (arbitrageur && (arbitrageur->exchange0_addr == exchange_config->addr || arbitrageur->exchange1_addr == exchange_config->addr)))
+            {
+                exchange_config->expected_subscribers.push_back(trader_config->agent_id);
+            }
+        }
+        for (AgentConfigPtr const& relay_config : relay_configs)
+        {
+            if (std::static_pointer_cast<MarketDataRelayConfig>(relay_config)->exchange_addr == exchange_config->addr)
+            {
+                exchange_config->expected_subscribers.push_back(relay_config->agent_id);
+            }
+        }
+    }
+
+    SimulationConfigPtr simulation_config = std::make_shared<SimulationConfig>(repetitions, time, exchange_configs, trader_configs, watcher_configs, injector_configs, 
+        relay_configs, concurrent_trials, port_stride);
     return simulation_config;
 }
 
@@ -212,6 +304,10 @@ AgentConfigPtr ConfigReader::configureAgent(int id, pugi::xml_node& xml_node, st
         { 
             return configureTrader(id, xml_node, addr, exchange_addrs, type); 
         }
+        case AgentType::LOAD_GENERATOR:
+        {
+            return configureLoadGenerator(id, xml_node, addr, exchange_addrs);
+        }
         default:
         {
             throw std::runtime_error("Unknown XML tag in configuration file");
@@ -230,9 +326,58 @@ ExchangeConfigPtr ConfigReader::configureExchange(int id, pugi::xml_node& xml_no
 
     exchange_config->addr = addr;
     exchange_config->name = std::string{xml_node.attribute("name").value()};
-    exchange_config->tickers = std::vector{std::string{xml_node.attribute("ticker").value()}};
+    exchange_config->venue = xml_node.attribute("venue").as_string("");
+
+    // Shards of a venue may trade several tickers, separated by commas
+    std::stringstream tickers {xml_node.attribute("ticker").value()};
+    std::string ticker;
+    while (std::getline(tickers, ticker, ','))
+    {
+        if (!ticker.empty()) exchange_config->tickers.push_back(ticker);
+    }
+    if (exchange_config->tickers.empty())
+    {
+        throw std::runtime_error("No ticker configured for exchange " + exchange_config->name);
+    }
     exchange_config->connect_time = std::atoi(xml_node.attribute("connect-time").value());
     exchange_config->trading_time = std::atoi(xml_node.attribute("trading-time").value());
+    exchange_config->order_book_type = order_book_type_from_string(xml_node.attribute("order-book").as_string("heap"));
+    for (std::string const& exchange_ticker : exchange_config->tickers)
+    {
+        exchange_config->tick_sizes[exchange_ticker] = xml_node.attribute("tick-size").as_double(1.0);
+        exchange_config->trade_stats_windows[exchange_ticker] = xml_node.attribute("trade-stats-window").as_string("14");
+    }
+    exchange_config->matching_mode = matching_mode_from_string(xml_node.attribute("matching-mode").as_string("continuous"));
+    exchange_config->auction_interval = xml_node.attribute("auction-interval").as_int(100);
+    exchange_config->depth_levels = xml_node.attribute("depth-levels").as_int(0);
+    exchange_config->market_data_feed = market_data_feed_type_from_string(xml_node.attribute("market-data-feed").as_string("full"));
+    exchange_config->snapshot_interval = xml_node.attribute("snapshot-interval").as_int(100);
+    exchange_config->conflation_interval = xml_node.attribute("conflation-interval").as_int(0);
+    exchange_config->multicast_group = xml_node.attribute("multicast-group").as_string("");
+    exchange_config->csv_flush_interval = xml_node.attribute("csv-flush-interval").as_int(200);
+    exchange_config->output_format = output_format_from_string(xml_node.attribute("output-format").as_string("csv"));
+    exchange_config->tape_compression = tape_compression_from_string(xml_node.attribute("tape-compression").as_string("none"));
+    exchange_config->market_data_recording = recording_policy_from_string(xml_node.attribute("market-data-recording").as_string("every"));
+    exchange_config->lob_recording = recording_policy_from_string(xml_node.attribute("lob-recording").as_string("every"));
+    exchange_config->upload = xml_node.attribute("upload").as_string("");
+    std::stringstream upload_streams {xml_node.attribute("upload-streams").as_string("trades,market_data,lob_snapshots,profits,messages")};
+    std::string upload_stream;
+    while (std::getline(upload_streams, upload_stream, ','))
+    {
+        if (!upload_stream.empty()) exchange_config->upload_streams.push_back(upload_stream);
+    }
+    exchange_config->checkpoint_file = xml_node.attribute("checkpoint").as_string("");
+    exchange_config->restore_file = xml_node.attribute("restore").as_string("");
+    exchange_config->record_orders = xml_node.attribute("record-orders").as_bool(false);
+    exchange_config->profit_report_interval = xml_node.attribute("profit-report-interval").as_int(1000);
+    exchange_config->trade_history_window = xml_node.attribute("trade-history-window").as_int(10000);
+    exchange_config->trace = xml_node.attribute("trace").as_bool(false);
+    exchange_config->busy_poll = xml_node.attribute("busy-poll").as_int(0);
+    exchange_config->cpu_affinity = xml_node.attribute("cpu-affinity").as_string("");
+    exchange_config->order_rate_limit = xml_node.attribute("order-rate-limit").as_double(0);
+    exchange_config->order_burst = xml_node.attribute("order-burst").as_int(0);
+    exchange_config->fair_intake = xml_node.attribute("fair-intake").as_bool(false);
+    exchange_config->shared_memory_feed = xml_node.attribute("shared-memory-feed").as_string("");
 
     return exchange_config;
 }
@@ -264,6 +409,13 @@ AgentConfigPtr ConfigReader::configureTrader(int id, pugi::xml_node& xml_node,
     trader_config->limit = xml_node.attribute("limit").as_int(50);
     trader_config->trade_interval = xml_node.attribute("trade-interval").as_int(1);
     trader_config->delay = xml_node.attribute("delay").as_int(0);
+    trader_config->max_update_rate = xml_node.attribute("max-update-rate").as_uint(0);
+    trader_config->prediction_log_interval = xml_node.attribute("prediction-log-interval").as_uint(1);
+    trader_config->graph_optimisation = graph_optimisation_from_string(xml_node.attribute("graph-optimisation").as_string("basic"));
+    trader_config->inference_threads = xml_node.attribute("inference-threads").as_uint(0);
+    trader_config->inference_device = inference_device_from_string(xml_node.attribute("inference-device").as_string("cpu"));
+    trader_config->inference_device_id = xml_node.attribute("inference-device-id").as_int(0);
+    trader_config->inference_backend = inference_backend_from_string(xml_node.attribute("inference-backend").as_string("onnx"));
 
     std::string cancelling = xml_node.attribute("cancel").as_string();
     trader_config->cancelling = (cancelling == "true");
@@ -274,6 +426,117 @@ AgentConfigPtr ConfigReader::configureTrader(int id, pugi::xml_node& xml_node,
     return std::static_pointer_cast<AgentConfig>(trader_config);
 }
 
+std::vector<AgentConfigPtr> ConfigReader::configureRelays(pugi::xml_node& xml_node, int& agent_id, const std::vector<std::string>& relay_addrs,
+    const std::vector<ExchangeConfigPtr>& exchange_configs, std::vector<AgentConfigPtr>& trader_configs)
+{
+    std::vector<MarketDataRelayConfigPtr> relay_configs;
+    for (auto relay : xml_node.children())
+    {
+        MarketDataRelayConfigPtr config = std::make_shared<MarketDataRelayConfig>();
+        config->agent_id = agent_id;
+        config->addr = relay_addrs.at(relay_configs.size());
+        config->type = AgentType::MARKET_DATA_RELAY;
+        config->name = relay.attribute("name").as_string(("relay_" + std::to_string(agent_id)).c_str());
+
+        // Relays pass on the market data of one exchange, or one shard of a venue, for all of its tickers
+        config->exchange_name = std::string{relay.attribute("exchange").value()};
+        auto exchange = std::find_if(exchange_configs.begin(), exchange_configs.end(), 
+            [&](ExchangeConfigPtr const& exchange_config) { return exchange_config->name == config->exchange_name; });
+        if (exchange == exchange_configs.end())
+        {
+            throw std::runtime_error("Relay configured for unknown exchange " + config->exchange_name);
+        }
+        config->exchange_addr = (*exchange)->addr;
+        config->exchange_id = (*exchange)->agent_id;
+        config->tickers = (*exchange)->tickers;
+
+        std::cout << "Configuring Market Data Relay: Exchange=" << config->exchange_name << ", Addr=" << config->addr << std::endl;
+        relay_configs.push_back(config);
+        ++agent_id;
+    }
+
+    // Traders take their exchange's market data from the relay of the exchange on their own host, or else from each of its relays in turn.
+    // Rate-limited traders need the exchange's conflated updates, and traders behind emulated links the exchange's own delays.
+    std::unordered_map<std::string, size_t> next_relay;
+    for (AgentConfigPtr const& trader_config : trader_configs)
+    {
+        TraderConfigPtr trader = std::dynamic_pointer_cast<TraderConfig>(trader_config);
+        if (!trader || trader->max_update_rate > 0 || !trader->links.empty()) continue;
+
+        std::vector<MarketDataRelayConfigPtr> candidates;
+        for (MarketDataRelayConfigPtr const& relay_config : relay_configs)
+        {
+            if (relay_config->exchange_addr == trader->exchange_addr) candidates.push_back(relay_config);
+        }
+        if (candidates.empty()) continue;
+
+        std::string host = trader->addr.substr(0, trader->addr.rfind(':'));
+        auto local = std::find_if(candidates.begin(), candidates.end(), 
+            [&](MarketDataRelayConfigPtr const& relay_config) { return relay_config->addr.substr(0, relay_config->addr.rfind(':')) == host; });
+        MarketDataRelayConfigPtr chosen = (local != candidates.end()) ? *local : candidates[next_relay[trader->exchange_addr]++ % candidates.size()];
+        trader->relay_name = chosen->name;
+        trader->relay_addr = chosen->addr;
+    }
+
+    return std::vector<AgentConfigPtr>(relay_configs.begin(), relay_configs.end());
+}
+
+void ConfigReader::configureLinks(pugi::xml_node& xml_node, const std::vector<ExchangeConfigPtr>& exchange_configs, std::vector<AgentConfigPtr>& trader_configs)
+{
+    for (auto link : xml_node.children("link"))
+    {
+        LinkProfile profile;
+        profile.delay = link.attribute("delay").as_double(0);
+        profile.jitter = link.attribute("jitter").as_double(0);
+        profile.distribution = delay_distribution_from_string(link.attribute("distribution").as_string("constant"));
+        profile.bandwidth = link.attribute("bandwidth").as_double(0);
+        profile.loss = link.attribute("loss").as_double(0);
+        if (profile.delay < 0 || profile.jitter < 0 || profile.bandwidth < 0 || profile.loss < 0 || profile.loss >= 1)
+        {
+            throw std::runtime_error("Invalid link profile for exchange " + std::string{link.attribute("exchange").as_string()});
+        }
+
+        // An exchange named by its venue stands for every shard of the venue
+        std::string exchange_name = link.attribute("exchange").as_string();
+        std::unordered_set<std::string> exchange_addrs;
+        for (ExchangeConfigPtr const& exchange_config : exchange_configs)
+        {
+            if (exchange_config->name == exchange_name || exchange_config->venue == exchange_name)
+            {
+                exchange_addrs.insert(exchange_config->addr);
+            }
+        }
+        if (exchange_addrs.empty())
+        {
+            throw std::runtime_error("Link configured to unknown exchange " + exchange_name);
+        }
+
+        // Without a trader named, the link applies to every trader of the exchange
+        std::string trader_name = link.attribute("trader").as_string();
+        for (AgentConfigPtr const& trader_config : trader_configs)
+        {
+            std::vector<std::string> peers;
+            if (TraderConfigPtr trader = std::dynamic_pointer_cast<TraderConfig>(trader_config))
+            {
+                if (!trader_name.empty() && trader->name != trader_name) continue;
+                peers.push_back(trader->exchange_addr);
+                for (auto const& [shard, shard_addr] : trader->routes.shards()) peers.push_back(shard_addr);
+            }
+            else if (ArbitrageurConfigPtr arbitrageur = std::dynamic_pointer_cast<ArbitrageurConfig>(trader_config))
+            {
+                if (!trader_name.empty()) continue;
+                peers.push_back(arbitrageur->exchange0_addr);
+                peers.push_back(arbitrageur->exchange1_addr);
+            }
+
+            for (std::string const& peer : peers)
+            {
+                if (exchange_addrs.contains(peer)) trader_config->links[peer] = profile;
+            }
+        }
+    }
+}
+
 AgentConfigPtr ConfigReader::configureArbitrageur(int id, pugi::xml_node& xml_node, std::string& addr, std::unordered_map<std::string, std::string>& exchange_addrs)
 {
     ArbitrageurConfigPtr config = std::make_shared<ArbitrageurConfig>();
@@ -292,11 +555,14 @@ AgentConfigPtr ConfigReader::configureArbitrageur(int id, pugi::xml_node& xml_no
     config->ticker = std::string{xml_node.attribute("ticker").value()};
     config->alpha = std::stod(xml_node.attribute("alpha").value());
     config->delay = std::atoi(xml_node.attribute("delay").value());
-    config->trade_interval = std::stoul(xml_node.attribute("trade-interval").value());
+    config->trade_interval = xml_node.attribute("trade-interval").as_uint(1);
 
     std::string cancelling {xml_node.attribute("cancel").value()};
     config->cancelling = cancelling == "true" ? true : false;
 
+    std::string mode {xml_node.attribute("mode").as_string("polling")};
+    config->reactive = mode == "reactive";
+
     return std::static_pointer_cast<AgentConfig>(config);
 }
 
@@ -392,6 +658,9 @@ AgentConfigPtr ConfigReader::configureOrderInjector(int id, pugi::xml_node& xml_
     // Interval 
     config->interval = xml_node.attribute("interval").as_int(1); // Default interval value
 
+    // Seed of the injection schedule, random if not given
+    config->seed = xml_node.attribute("seed").as_uint(0);
+
     std::cout << "Configuring Order Injector: " 
           << "Exchange=" << config->exchange_name 
           << ", Addr=" << config->exchange_addr 
@@ -426,6 +695,7 @@ AgentConfigPtr ConfigReader::configureTraderZIP(int id, pugi::xml_node& xml_node
     config->limit = std::atoi(xml_node.attribute("limit").value());
     config->delay = std::atoi(xml_node.attribute("delay").value());
     config->ticker = std::string{xml_node.attribute("ticker").value()};
+    config->max_update_rate = xml_node.attribute("max-update-rate").as_uint(0);
 
     std::string cancelling {xml_node.attribute("cancel").value()};
     config->cancelling = cancelling == "true" ? true : false;
@@ -436,15 +706,38 @@ AgentConfigPtr ConfigReader::configureTraderZIP(int id, pugi::xml_node& xml_node
 
     config->min_margin = std::stod(xml_node.attribute("min-margin").value());
     std::cout << "trade: " << xml_node.attribute("trade-interval").value() << "\n";
-    config->trade_interval = std::stoul(xml_node.attribute("trade-interval").value());
+    config->trade_interval = xml_node.attribute("trade-interval").as_uint(1);
     std::cout << "liquidity: " << xml_node.attribute("liquidity-interval").value() << "\n";
     config->liquidity_interval = std::stoul(xml_node.attribute("liquidity-interval").value());
+    config->population = xml_node.attribute("population").as_bool(false);
 
 
     return std::static_pointer_cast<AgentConfig>(config);
 
 }
 
+AgentConfigPtr ConfigReader::configureLoadGenerator(int id, pugi::xml_node& xml_node, std::string& addr, std::unordered_map<std::string, std::string>& exchange_addrs)
+{
+    LoadGeneratorConfigPtr config = std::make_shared<LoadGeneratorConfig>();
+    config->agent_id = id;
+    config->addr = addr;
+    config->type = AgentType::LOAD_GENERATOR;
+
+    config->exchange_name = std::string{xml_node.attribute("exchange").value()};
+    config->exchange_addr = exchange_addrs.at(config->exchange_name);
+    config->ticker = std::string{xml_node.attribute("ticker").value()};
+    config->delay = 0;
+
+    config->rate = xml_node.attribute("rate").as_double(0);
+    config->arrival = arrival_process_from_string(xml_node.attribute("arrival").as_string("fixed"));
+    config->mid_price = xml_node.attribute("mid-price").as_double(100);
+    config->price_range = xml_node.attribute("price-range").as_int(5);
+    config->max_resting = xml_node.attribute("max-resting").as_int(100);
+    config->seed = xml_node.attribute("seed").as_uint(0);
+
+    return std::static_pointer_cast<AgentConfig>(config);
+}
+
 /** Reading and configuring trader configs from markets.csv. */
 
 AgentConfigPtr ConfigReader::configureTraderFromCSV(int id, const std::string& addr, 
@@ -489,8 +782,7 @@ AgentConfigPtr ConfigReader::configureTraderFromCSV(int id, const std::string& a
 
     // Assign a different limit price per trader - DEBUG TO TEST PROFITABILIITY BY TESTING RANDOM LIMIT PRICES
     std::uniform_int_distribution<int> dist(100, 200); // Range of limit prices
-    static std::random_device rd; // Random seed
-    static std::mt19937 gen(rd()); // Random number generator
+    static std::mt19937 gen(SimulationClock::randomSeed()); // Random number generator
     trader_config->limit = dist(gen);
 
     // DEBUG - Print Trader Configuration
@@ -535,8 +827,7 @@ AgentConfigPtr ConfigReader::configureTraderZIPFromCSV(
     // Set default values
 
     std::uniform_int_distribution<int> dist(100, 200); // Range of limit prices
-    static std::random_device rd; // Random seed
-    static std::mt19937 gen(rd()); // Random number generator
+    static std::mt19937 gen(SimulationClock::randomSeed()); // Random number generator
     zip_config->limit = dist(gen);
 
     //zip_config->limit = 50; 
@@ -571,7 +862,7 @@ AgentConfigPtr ConfigReader::configureTraderZIPFromCSV(
     
 
 SimulationConfigPtr ConfigReader::readConfigFromCSV(const std::string& filepath, 
-    const std::unordered_map<std::string, std::string>& exchange_addrs_map, int& agent_id, const std::string& default_exchange_name, const std::string& default_ticker)
+    const std::unordered_map<std::string, std::string>& exchange_addrs_map, int& agent_id, const std::string& default_exchange_name, const std::string& default_ticker, int traders_per_node)
 {
     std::ifstream file(filepath); // Open CSV file
     if (!file.is_open()) // Check if file is open
@@ -589,9 +880,10 @@ SimulationConfigPtr ConfigReader::readConfigFromCSV(const std::string& filepath,
     }
 
     int port = 8100; // Start assigning trader ports from 8100
+    int traders_on_node = 0; // Traders assigned to the node at the current port
 
     // These are the expected trader types (exactly 10 values).
-    std::vector<std::string> trader_types = {"zic", "shvr", "vwap", "bb", "macd", "obvd", "obvvwap", "rsi", "rsibb", "zip", "deeplstm", "deepxgb"};
+    const std::vector<std::string>& trader_types = MARKET_TRADER_TYPES;
     std::unordered_map<std::string, AgentType> agent_type_map = {
         {"zic", AgentType::TRADER_ZIC}, 
         {"shvr", AgentType::TRADER_SHVR},
@@ -624,7 +916,7 @@ SimulationConfigPtr ConfigReader::readConfigFromCSV(const std::string& filepath,
         }
 
         // Validate exactly 12 agents (tokens). 
-        if (tokens.size() != 12) {
+        if (tokens.size() != trader_types.size()) {
             throw std::runtime_error("Invalid CSV format: each line must contain exactly 12 comma-separated values.");
         }
 
@@ -646,9 +938,17 @@ SimulationConfigPtr ConfigReader::readConfigFromCSV(const std::string& filepath,
             {
                 for (const std::string& side : {"buy", "sell"}) // Create buyer and seller agents
                 {   
+                    // Consecutive traders share a node until it is full
+                    if (traders_on_node == traders_per_node)
+                    {
+                        ++port;
+                        traders_on_node = 0;
+                    }
+                    ++traders_on_node;
+
                     std::cout << "Assigning trader " << agent_id << " to port " << port << std::endl;
                     std::cout << "Trader name " << trader_string_name << " with side " << side << std::endl;
-                    std::string addr = "127.0.0.1:" + std::to_string(port++);
+                    std::string addr = "127.0.0.1:" + std::to_string(port);
                     std::function<AgentConfigPtr(void)> configFunc =
                     (type == AgentType::TRADER_ZIP)
                     ? std::function<AgentConfigPtr(void)>([&]() -> AgentConfigPtr {
@@ -668,5 +968,5 @@ SimulationConfigPtr ConfigReader::readConfigFromCSV(const std::string& filepath,
     }
 
     file.close();
-    return std::make_shared<SimulationConfig>(1, 30, exchange_configs, trader_configs, watcher_configs, injector_configs);
+    return std::make_shared<SimulationConfig>(1, 30, exchange_configs, trader_configs, watcher_configs, injector_configs, std::vector<AgentConfigPtr>{});
 }
@@ -19,8 +19,8 @@ public:
     /** Reads the given XML configuration file and returns the list of agent configs. */
     static SimulationConfigPtr readConfig(std::string& filepath);
 
-    /** Reads markets.csv for dynamic trader agent allocation. */
-    static SimulationConfigPtr readConfigFromCSV(const std::string& filepath, const std::unordered_map<std::string, std::string>& exchange_addrs_map, int& agent_id, const std::string& default_exchange_name, const std::string& default_ticker);
+    /** Reads markets.csv for dynamic trader agent allocation, putting up to traders_per_node traders on each node. */
+    static SimulationConfigPtr readConfigFromCSV(const std::string& filepath, const std::unordered_map<std::string, std::string>& exchange_addrs_map, int& agent_id, const std::string& default_exchange_name, const std::string& default_ticker, int traders_per_node = 1);
 
     /** Configures the agent based on the XML tag. - LEAVE THIS HERE IN CASE OF MANUAL SIMULATION CONFIG ALLOCATION. */
     static AgentConfigPtr configureAgent(int id, pugi::xml_node& xml_node, std::string& addr, std::unordered_map<std::string, std::string>& exchange_addr);
@@ -31,6 +31,9 @@ public:
     /** Configure ZIP based on CSV. */
     static AgentConfigPtr configureTraderZIPFromCSV(int id, const std::string& addr, const std::string& exchange, const std::string& ticker, AgentType trader_type, const std::string& side, const std::unordered_map<std::string, std::string>& exchange_addrs_map, const std::string& trader_string_name);
 
+    /** Trader types of the columns of markets.csv, in order. */
+    inline static const std::vector<std::string> MARKET_TRADER_TYPES = {"zic", "shvr", "vwap", "bb", "macd", "obvd", "obvvwap", "rsi", "rsibb", "zip", "deeplstm", "deepxgb"};
+
     /** Technical agents delay. */
     constexpr static unsigned int DEFAULT_TECHNICAL_AGENT_DELAY = 4; 
     
@@ -47,6 +50,16 @@ private:
     static AgentConfigPtr configureOrderInjector(int id, pugi::xml_node& xml_node, std::string& addr, std::unordered_map<std::string, std::string>& exchange_addr);
 
     static AgentConfigPtr configureTraderZIP(int id, pugi::xml_node& xml_node, std::string& addr, std::unordered_map<std::string, std::string>& exchange_addrs);
+
+    static AgentConfigPtr configureLoadGenerator(int id, pugi::xml_node& xml_node, std::string& addr, std::unordered_map<std::string, std::string>& exchange_addrs);
+
+    /** Configures the market data relays in the given XML node, numbering them from the given agent ID onwards, 
+     *  and gives each trader of an exchange with relays the one it takes its market data from. */
+    static std::vector<AgentConfigPtr> configureRelays(pugi::xml_node& xml_node, int& agent_id, const std::vector<std::string>& relay_addrs,
+        const std::vector<ExchangeConfigPtr>& exchange_configs, std::vector<AgentConfigPtr>& trader_configs);
+
+    /** Gives each trader the link profiles configured between it and the exchanges it trades on. */
+    static void configureLinks(pugi::xml_node& xml_node, const std::vector<ExchangeConfigPtr>& exchange_configs, std::vector<AgentConfigPtr>& trader_configs);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef DELAY_DISTRIBUTION_HPP
+#define DELAY_DISTRIBUTION_HPP
+
+#include <string>
+
+enum class DelayDistribution : int
+{
+    CONSTANT,     // Every message takes the link's delay, without jitter
+    UNIFORM,      // The delay give or take up to the jitter, evenly spread
+    NORMAL,       // The delay plus normally distributed jitter, the jitter its standard deviation
+    EXPONENTIAL   // The delay plus exponentially distributed jitter, the jitter its mean, for the long tail of queueing on a busy path
+};
+
+inline std::string to_string(DelayDistribution distribution)
+{
+    switch (distribution) {
+        case DelayDistribution::CONSTANT: return std::string{"constant"};
+        case DelayDistribution::UNIFORM: return std::string{"uniform"};
+        case DelayDistribution::NORMAL: return std::string{"normal"};
+        case DelayDistribution::EXPONENTIAL: return std::string{"exponential"};
+        default: return std::string{""};
+    }
+}
+
+/** Returns the delay distribution for the given name. Defaults to a constant delay. */
+inline DelayDistribution delay_distribution_from_string(std::string_view name)
+{
+    if (name == "uniform") return DelayDistribution::UNIFORM;
+    if (name == "normal") return DelayDistribution::NORMAL;
+    if (name == "exponential") return DelayDistribution::EXPONENTIAL;
+    return DelayDistribution::CONSTANT;
+}
+
+#endif
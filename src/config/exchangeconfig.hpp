@@ -1,7 +1,16 @@
 #ifndef EXCHANGE_CONFIG_HPP
 #define EXCHANGE_CONFIG_HPP
 
+#include <boost/serialization/unordered_map.hpp>
+
 #include "agentconfig.hpp"
+#include "../order/orderbooktype.hpp"
+#include "../order/matchingmode.hpp"
+#include "../trade/marketdatafeedtype.hpp"
+#include "../trade/rollingtradestats.hpp"
+#include "../utilities/outputformat.hpp"
+#include "../utilities/tapecompression.hpp"
+#include "../utilities/recordingpolicy.hpp"
 
 class ExchangeConfig : public AgentConfig
 {
@@ -10,9 +19,67 @@ public:
     ExchangeConfig() = default;
 
     std::string name;
+    std::string venue; // logical exchange whose tickers this node trades a share of, empty if it trades on its own
     std::vector<std::string> tickers;
     int connect_time;
     int trading_time;
+    OrderBookType order_book_type = OrderBookType::HEAP;
+    std::unordered_map<std::string, double> tick_sizes;
+    std::unordered_map<std::string, std::string> trade_stats_windows; // trades, or span of time such as "5s", the high, low and VWAP of each ticker are kept over
+    MatchingMode matching_mode = MatchingMode::CONTINUOUS;
+    int auction_interval = 100;
+    int depth_levels = 0;
+    MarketDataFeedType market_data_feed = MarketDataFeedType::FULL;
+    int snapshot_interval = 100;
+    int conflation_interval = 0;
+    std::string multicast_group; // base group address:port, ticker i publishes on port + i; empty to disable
+    int csv_flush_interval = 200; // milliseconds between background writes of the CSV outputs, 0 to write synchronously
+    OutputFormat output_format = OutputFormat::CSV; // format of the trade tapes, market data feeds and LOB snapshots
+    TapeCompression tape_compression = TapeCompression::NONE; // which CSV outputs are written zstd-compressed
+    RecordingPolicy market_data_recording; // which of the market data updates of each ticker are written to its feed
+    RecordingPolicy lob_recording; // which of the LOB snapshots of each ticker, one per trade, are written
+    std::string output_dir; // directory the outputs are written under, empty for the working directory
+    std::string upload; // s3://bucket/prefix the outputs of upload_streams are uploaded under as they are written, empty to keep them local
+    std::vector<std::string> upload_streams; // output directories, such as trades or profits, whose files are uploaded
+    std::vector<int> expected_subscribers; // IDs of the traders trading opens for once all have subscribed, empty to wait for connections to stop
+    std::string checkpoint_file; // file the state of the exchange is saved to when the session ends, under the output directory; empty not to save
+    std::string restore_file; // checkpoint the session opens on instead of empty books, empty to start afresh
+    bool record_orders = false; // whether the order messages matched are kept in full on an order tape, for replaying the session
+    int agent_id_offset = 0; // offset of the agent IDs of this trial from those configured, which checkpoints keep
+    int profit_report_interval = 1000; // milliseconds between snapshots of the profits streamed to the orchestrator, 0 for only the final one
+    int trade_history_window = 10000; // trades of each ticker kept in memory, older ones spilled to disk; 0 to keep all in memory
+    bool trace = false; // whether the stages of the session's message handling are traced and exported as a Chrome trace
+    int busy_poll = 0; // microseconds the matching engines busy-poll their inboxes before sleeping, -1 never to sleep, 0 to sleep at once
+    std::string cpu_affinity; // CPUs the node's threads are pinned to by role, "auto" to divide those the node may run on; empty not to pin
+    double order_rate_limit = 0; // order messages per second each trader may send, beyond which they are rejected; 0 for no limit
+    int order_burst = 0; // order messages a trader may send at once within its rate limit, 0 for one second's worth
+    std::string shared_memory_feed; // directory, such as /dev/shm, each ticker's market data is also written to for traders on the host; empty to disable
+    bool fair_intake = false; // whether each batch the matching engines take is interleaved by sender, rather than handled as it arrived
+
+    std::shared_ptr<AgentConfig> clone() const override
+    {
+        return std::make_shared<ExchangeConfig>(*this);
+    }
+
+    void offsetPorts(int offset) override
+    {
+        AgentConfig::offsetPorts(offset);
+        if (!multicast_group.empty()) multicast_group = offsetPort(multicast_group, offset);
+    }
+
+    /** Returns the tick size configured for the given ticker, or one if not configured. */
+    double tickSizeFor(const std::string& ticker) const
+    {
+        auto it = tick_sizes.find(ticker);
+        return (it != tick_sizes.end()) ? it->second : 1.0;
+    }
+
+    /** Returns the trade statistics window configured for the given ticker, or the latest 14 trades if not configured. */
+    TradeStatsWindow tradeStatsWindowFor(const std::string& ticker) const
+    {
+        auto it = trade_stats_windows.find(ticker);
+        return (it != trade_stats_windows.end()) ? trade_stats_window_from_string(it->second) : TradeStatsWindow{};
+    }
 
 private:
 
@@ -22,9 +89,42 @@ private:
     {
         ar & boost::serialization::base_object<AgentConfig>(*this);
         ar & name;
+        ar & venue;
         ar & tickers;
         ar & connect_time;
         ar & trading_time;
+        ar & order_book_type;
+        ar & tick_sizes;
+        ar & trade_stats_windows;
+        ar & matching_mode;
+        ar & auction_interval;
+        ar & depth_levels;
+        ar & market_data_feed;
+        ar & snapshot_interval;
+        ar & conflation_interval;
+        ar & multicast_group;
+        ar & csv_flush_interval;
+        ar & output_format;
+        ar & tape_compression;
+        ar & market_data_recording;
+        ar & lob_recording;
+        ar & output_dir;
+        ar & upload;
+        ar & upload_streams;
+        ar & expected_subscribers;
+        ar & checkpoint_file;
+        ar & restore_file;
+        ar & record_orders;
+        ar & agent_id_offset;
+        ar & profit_report_interval;
+        ar & trade_history_window;
+        ar & trace;
+        ar & busy_poll;
+        ar & cpu_affinity;
+        ar & order_rate_limit;
+        ar & order_burst;
+        ar & fair_intake;
+        ar & shared_memory_feed;
     }
 };
 
@@ -0,0 +1,37 @@
+#ifndef LINK_PROFILE_HPP
+#define LINK_PROFILE_HPP
+
+#include <boost/serialization/access.hpp>
+
+#include "delaydistribution.hpp"
+
+/** The wide area network emulated between an agent and a peer, the same each way. */
+struct LinkProfile
+{
+    double delay = 0; // one way delay in milliseconds
+    double jitter = 0; // spread of the delay in milliseconds, as the distribution takes it
+    DelayDistribution distribution = DelayDistribution::CONSTANT;
+    double bandwidth = 0; // megabits per second each way, 0 for unlimited
+    double loss = 0; // probability a message is lost: broadcasts are dropped, messages over TCP retransmitted
+
+    /** Indicates whether the link differs from sending directly at all. */
+    bool emulated() const
+    {
+        return delay > 0 || jitter > 0 || bandwidth > 0 || loss > 0;
+    }
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & delay;
+        ar & jitter;
+        ar & distribution;
+        ar & bandwidth;
+        ar & loss;
+    }
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef LOAD_GENERATOR_CONFIG_HPP
+#define LOAD_GENERATOR_CONFIG_HPP
+
+#include "traderconfig.hpp"
+#include "arrivalprocess.hpp"
+#include <boost/serialization/base_object.hpp>
+
+class LoadGeneratorConfig : public TraderConfig
+{
+public:
+
+    LoadGeneratorConfig() = default;
+
+    double rate = 0; // orders per second sent from the start of trading, 0 to wait for a load test to set it
+    ArrivalProcess arrival = ArrivalProcess::FIXED;
+    double mid_price = 100; // orders are priced uniformly within price_range either side of it
+    int price_range = 5;
+    int max_resting = 100; // resting orders kept in the book before the oldest is cancelled
+    unsigned int seed = 0; // zero for a random seed
+
+    std::shared_ptr<AgentConfig> clone() const override
+    {
+        return std::make_shared<LoadGeneratorConfig>(*this);
+    }
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<TraderConfig>(*this);
+        ar & rate;
+        ar & arrival;
+        ar & mid_price;
+        ar & price_range;
+        ar & max_resting;
+        ar & seed;
+    }
+};
+
+typedef std::shared_ptr<LoadGeneratorConfig> LoadGeneratorConfigPtr;
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef MARKET_DATA_RELAY_CONFIG_HPP
+#define MARKET_DATA_RELAY_CONFIG_HPP
+
+#include "agentconfig.hpp"
+#include <boost/serialization/base_object.hpp>
+
+class MarketDataRelayConfig : public AgentConfig
+{
+public:
+
+    MarketDataRelayConfig() = default;
+
+    std::string name; // by which its traders know it
+    std::string exchange_name;
+    std::string exchange_addr;
+    int exchange_id; // sender of the market data relayed, whose symbol definitions the relay passes on
+    std::vector<std::string> tickers;
+
+    std::shared_ptr<AgentConfig> clone() const override
+    {
+        return std::make_shared<MarketDataRelayConfig>(*this);
+    }
+
+    void offsetPorts(int offset) override
+    {
+        AgentConfig::offsetPorts(offset);
+        exchange_addr = offsetPort(exchange_addr, offset);
+    }
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<AgentConfig>(*this);
+        ar & name;
+        ar & exchange_name;
+        ar & exchange_addr;
+        ar & exchange_id;
+        ar & tickers;
+    }
+
+};
+
+typedef std::shared_ptr<MarketDataRelayConfig> MarketDataRelayConfigPtr;
+
+#endif
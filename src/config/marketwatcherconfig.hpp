@@ -15,6 +15,17 @@ public:
     std::string exchange_addr;
     std::string ticker;
 
+    std::shared_ptr<AgentConfig> clone() const override
+    {
+        return std::make_shared<MarketWatcherConfig>(*this);
+    }
+
+    void offsetPorts(int offset) override
+    {
+        AgentConfig::offsetPorts(offset);
+        exchange_addr = offsetPort(exchange_addr, offset);
+    }
+
 private:
     
     friend class boost::serialization::access;
@@ -31,6 +31,23 @@ public:
     int interval; 
     std::string input_file;
 
+    // Seed of the injection schedule, so that a session's customer orders can be reproduced. Zero for a random seed.
+    unsigned int seed = 0;
+
+    // Length of the trading session in seconds, which the schedule is generated for up front. Zero if unknown.
+    int session_time = 0;
+
+    std::shared_ptr<AgentConfig> clone() const override
+    {
+        return std::make_shared<OrderInjectorConfig>(*this);
+    }
+
+    void offsetPorts(int offset) override
+    {
+        AgentConfig::offsetPorts(offset);
+        exchange_addr = offsetPort(exchange_addr, offset);
+    }
+
 
 private:
     friend class boost::serialization::access;
@@ -54,6 +71,8 @@ private:
         ar & use_offset;
         ar & interval;
         ar & input_file;
+        ar & seed;
+        ar & session_time;
     }
 };
 
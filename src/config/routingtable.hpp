@@ -0,0 +1,70 @@
+#ifndef ROUTING_TABLE_HPP
+#define ROUTING_TABLE_HPP
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "agentconfig.hpp"
+
+/** Routes of a logical exchange (venue) whose tickers are partitioned across several exchange nodes (shards):
+ *  the shard trading each ticker and the address of each shard. Empty for an exchange that is not sharded. */
+class RoutingTable
+{
+public:
+
+    RoutingTable() = default;
+
+    /** Adds the shard at the given address, trading the given tickers. */
+    void addShard(const std::string& name, const std::string& addr, const std::vector<std::string>& tickers)
+    {
+        shard_addrs_[name] = addr;
+        for (std::string const& ticker : tickers)
+        {
+            shards_[ticker] = name;
+        }
+    }
+
+    /** Returns the name of the shard trading the given ticker, or an empty view if no shard trades it. */
+    std::string_view shardFor(std::string_view ticker) const
+    {
+        auto it = shards_.find(std::string{ticker});
+        return (it != shards_.end()) ? std::string_view{it->second} : std::string_view{};
+    }
+
+    /** Returns the address of each shard, by name. */
+    const std::unordered_map<std::string, std::string>& shards() const
+    {
+        return shard_addrs_;
+    }
+
+    bool empty() const
+    {
+        return shard_addrs_.empty();
+    }
+
+    /** Moves the shards the given number of ports up. */
+    void offsetPorts(int offset)
+    {
+        for (auto& [name, addr] : shard_addrs_)
+        {
+            addr = AgentConfig::offsetPort(addr, offset);
+        }
+    }
+
+private:
+
+    std::unordered_map<std::string, std::string> shards_; // ticker -> shard name
+    std::unordered_map<std::string, std::string> shard_addrs_; // shard name -> address
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & shards_;
+        ar & shard_addrs_;
+    }
+};
+
+#endif
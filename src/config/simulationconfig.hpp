@@ -1,12 +1,16 @@
 #ifndef SIMULATION_CONFIG_HPP
 #define SIMULATION_CONFIG_HPP
 
+#include <algorithm>
+#include <climits>
 #include <memory>
+#include <string>
 
 #include "agentconfig.hpp"
 #include "exchangeconfig.hpp"
 #include "traderconfig.hpp"
 #include "marketwatcherconfig.hpp"
+#include "marketdatarelayconfig.hpp"
 
 /** Configuration object for a single simulation. */
 class SimulationConfig : public std::enable_shared_from_this<SimulationConfig>
@@ -19,13 +23,19 @@ public:
                      std::vector<ExchangeConfigPtr> exchange_configs, 
                      std::vector<AgentConfigPtr> trader_configs,
                      std::vector<AgentConfigPtr> watcher_configs, 
-                    std::vector<AgentConfigPtr> injector_configs) 
+                    std::vector<AgentConfigPtr> injector_configs,
+                    std::vector<AgentConfigPtr> relay_configs,
+                    int concurrent_trials = 1,
+                    int port_stride = 0) 
     : repetitions_{repetitions},
       time_{time},
       exchange_configs_{exchange_configs},
       trader_configs_{trader_configs},
       watcher_configs_{watcher_configs},
-      injector_configs_{injector_configs}
+      injector_configs_{injector_configs},
+      relay_configs_{relay_configs},
+      concurrent_trials_{std::max(concurrent_trials, 1)},
+      port_stride_{port_stride}
 
     {
     }
@@ -34,8 +44,77 @@ public:
     const std::vector<AgentConfigPtr>& traders() const { return trader_configs_; }
     const std::vector<AgentConfigPtr>& watchers() const { return watcher_configs_; } 
     const std::vector<AgentConfigPtr>& injectors() const { return injector_configs_; }
+    const std::vector<AgentConfigPtr>& relays() const { return relay_configs_; }
     int repetitions() const { return repetitions_; }
     int time() const { return time_; }
+    int concurrentTrials() const { return concurrent_trials_; }
+
+    /** Returns the slot the trial with the given index runs in: trials running at once take different slots,
+     *  and a trial reuses the ports and agent IDs of the one before it in its slot. */
+    int slotOf(int trial) const { return trial % concurrent_trials_; }
+
+    /** Returns the configuration of the trial with the given index, isolated from the trials running at the same time:
+     *  its agents are moved up a port stride and given new IDs for each slot, and when trials run at once, 
+     *  its exchanges write their outputs under a directory of their own. */
+    std::shared_ptr<SimulationConfig> trial(int trial) const
+    {
+        int slot = slotOf(trial);
+        int port_offset = slot * portStride();
+        int id_offset = slot * static_cast<int>(exchange_configs_.size() + trader_configs_.size() 
+            + watcher_configs_.size() + injector_configs_.size() + relay_configs_.size());
+        auto relocate = [=](AgentConfigPtr const& config) {
+            AgentConfigPtr copy = config->clone();
+            copy->offsetPorts(port_offset);
+            copy->agent_id += id_offset;
+            return copy;
+        };
+
+        std::vector<ExchangeConfigPtr> exchange_configs;
+        for (ExchangeConfigPtr const& config : exchange_configs_)
+        {
+            ExchangeConfigPtr copy = std::static_pointer_cast<ExchangeConfig>(relocate(config));
+            if (concurrent_trials_ > 1) copy->output_dir = "trial_" + std::to_string(trial);
+            for (int& subscriber_id : copy->expected_subscribers) subscriber_id += id_offset;
+            copy->agent_id_offset = id_offset;
+            exchange_configs.push_back(copy);
+        }
+        std::vector<AgentConfigPtr> trader_configs;
+        std::transform(trader_configs_.begin(), trader_configs_.end(), std::back_inserter(trader_configs), relocate);
+        std::vector<AgentConfigPtr> watcher_configs;
+        std::transform(watcher_configs_.begin(), watcher_configs_.end(), std::back_inserter(watcher_configs), relocate);
+        std::vector<AgentConfigPtr> injector_configs;
+        std::transform(injector_configs_.begin(), injector_configs_.end(), std::back_inserter(injector_configs), relocate);
+        std::vector<AgentConfigPtr> relay_configs;
+        for (AgentConfigPtr const& config : relay_configs_)
+        {
+            MarketDataRelayConfigPtr copy = std::static_pointer_cast<MarketDataRelayConfig>(relocate(config));
+            copy->exchange_id += id_offset;
+            relay_configs.push_back(copy);
+        }
+
+        return std::make_shared<SimulationConfig>(1, time_, exchange_configs, trader_configs, watcher_configs, injector_configs, relay_configs);
+    }
+
+    /** Returns the number of ports the agents of each slot are moved up from the one before:
+     *  as configured, or else the span of the ports the simulation uses. */
+    int portStride() const
+    {
+        if (port_stride_ > 0) return port_stride_;
+
+        int lowest = INT_MAX;
+        int highest = 0;
+        auto include = [&](AgentConfigPtr const& config) {
+            int port = std::stoi(config->addr.substr(config->addr.rfind(':') + 1));
+            lowest = std::min(lowest, port);
+            highest = std::max(highest, port);
+        };
+        std::for_each(exchange_configs_.begin(), exchange_configs_.end(), include);
+        std::for_each(trader_configs_.begin(), trader_configs_.end(), include);
+        std::for_each(watcher_configs_.begin(), watcher_configs_.end(), include);
+        std::for_each(injector_configs_.begin(), injector_configs_.end(), include);
+        std::for_each(relay_configs_.begin(), relay_configs_.end(), include);
+        return (lowest <= highest) ? highest - lowest + 1 : 0;
+    }
 
 private:
 
@@ -43,8 +122,11 @@ private:
     std::vector<AgentConfigPtr> trader_configs_;
     std::vector<AgentConfigPtr> watcher_configs_; 
     std::vector<AgentConfigPtr> injector_configs_;
+    std::vector<AgentConfigPtr> relay_configs_;
     int repetitions_;
     int time_;
+    int concurrent_trials_; // trials run at the same time, each on ports of its own
+    int port_stride_; // ports between the agents of one slot and the next, zero for the span of the configured ports
 };
 
 typedef std::shared_ptr<SimulationConfig> SimulationConfigPtr;
@@ -2,7 +2,11 @@
 #define TRADER_CONFIG_HPP
 
 #include "agentconfig.hpp"
+#include "routingtable.hpp"
 #include "../order/order.hpp"
+#include "../inference/graphoptimisation.hpp"
+#include "../inference/inferencebackend.hpp"
+#include "../inference/inferencedevice.hpp"
 #include <boost/serialization/base_object.hpp>
 
 class TraderConfig : public AgentConfig
@@ -14,12 +18,35 @@ public:
     std::string name; // agent name
     std::string exchange_name;
     std::string exchange_addr;
+    RoutingTable routes; // shards of the exchange when it is a venue partitioned across several nodes, empty otherwise
+    std::string relay_name; // relay the trader takes its exchange's market data from, empty to subscribe to the exchange
+    std::string relay_addr;
     std::string ticker;
     Order::Side side;
     double limit;
     unsigned int delay;
     unsigned int trade_interval;
     bool cancelling;
+    unsigned int max_update_rate = 0; // market data updates per second, 0 for every update
+    unsigned int prediction_log_interval = 1; // DeepTrader agents record every nth prediction, 0 for none
+    GraphOptimisation graph_optimisation = GraphOptimisation::BASIC; // DeepTrader model graph optimisation
+    unsigned int inference_threads = 0; // threads running each DeepTrader inference, 0 for the ONNX Runtime default
+    InferenceDevice inference_device = InferenceDevice::CPU; // where DeepTrader ONNX models run, falling back to the CPU
+    int inference_device_id = 0; // GPU the DeepTrader ONNX models run on
+    InferenceBackend inference_backend = InferenceBackend::ONNX; // what runs the DeepTraderXGB model
+
+    std::shared_ptr<AgentConfig> clone() const override
+    {
+        return std::make_shared<TraderConfig>(*this);
+    }
+
+    void offsetPorts(int offset) override
+    {
+        AgentConfig::offsetPorts(offset);
+        exchange_addr = offsetPort(exchange_addr, offset);
+        relay_addr = offsetPort(relay_addr, offset);
+        routes.offsetPorts(offset);
+    }
 
 private:
     
@@ -31,12 +58,22 @@ private:
         ar & name;
         ar & exchange_name;
         ar & exchange_addr;
+        ar & routes;
+        ar & relay_name;
+        ar & relay_addr;
         ar & ticker;
         ar & side;
         ar & limit;
         ar & delay;
         ar & trade_interval;
         ar & cancelling;
+        ar & max_update_rate;
+        ar & prediction_log_interval;
+        ar & graph_optimisation;
+        ar & inference_threads;
+        ar & inference_backend;
+        ar & inference_device;
+        ar & inference_device_id;
     }
 
 };
@@ -11,6 +11,12 @@ public:
 
     double min_margin;
     unsigned int liquidity_interval;
+    bool population = false; // keep margin state in the process's ZIPPopulation for the market
+
+    std::shared_ptr<AgentConfig> clone() const override
+    {
+        return std::make_shared<ZIPConfig>(*this);
+    }
 
 private:
     
@@ -21,6 +27,7 @@ private:
         ar & boost::serialization::base_object<TraderConfig>(*this);
         ar & min_margin;
         ar & liquidity_interval;
+        ar & population;
     }
 
 };
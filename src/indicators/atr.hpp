@@ -0,0 +1,57 @@
+#ifndef ATR_HPP
+#define ATR_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "sma.hpp"
+
+namespace indicators
+{
+
+/** Average true range over the last lookback periods, updated in amortised O(1) per period.
+ *  The true range of a period is the largest of its high-low range and the distances of its high and low
+ *  from the previous close; the first period only has its high-low range. */
+class ATR
+{
+public:
+
+    explicit ATR(size_t lookback)
+    : true_ranges_{lookback}
+    {};
+
+    void push(double high, double low, double close)
+    {
+        double true_range = high - low;
+        if (has_close_)
+        {
+            true_range = std::max({true_range, std::abs(high - last_close_), std::abs(low - last_close_)});
+        }
+        true_ranges_.push(true_range);
+        last_close_ = close;
+        has_close_ = true;
+    }
+
+    /** Returns the average true range of the periods seen so far, up to lookback periods. */
+    double value() const { return true_ranges_.value(); };
+
+    bool ready() const { return true_ranges_.ready(); };
+
+    void clear()
+    {
+        true_ranges_.clear();
+        last_close_ = 0.0;
+        has_close_ = false;
+    }
+
+private:
+
+    SMA true_ranges_;
+    double last_close_ = 0.0;
+    bool has_close_ = false;
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,285 @@
+#ifndef INDICATORS_BATCH_HPP
+#define INDICATORS_BATCH_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "simd.hpp"
+#include "sma.hpp"
+#include "variance.hpp"
+#include "ema.hpp"
+#include "rsi.hpp"
+
+/** Indicators over whole price and volume arrays, for offline studies of recorded sessions.
+ *  Element i of each output is the value the streaming indicator of the same name reports after the i-th push,
+ *  equal up to rounding since window sums are added up in a different order.
+ *  Windows of up to DIRECT_SUM_LENGTH values are summed directly, several outputs per vector instruction;
+ *  longer windows run the streaming indicator over the array. Recurrences (EMA and the Wilder smoothing of RSI)
+ *  are sequential, so only their element-wise inputs are vectorised. */
+namespace indicators::batch
+{
+
+/** Longest window summed directly; the direct sum costs length additions per output. */
+constexpr size_t DIRECT_SUM_LENGTH = 64;
+
+inline void checkLength(size_t length)
+{
+    if (length == 0)
+    {
+        throw std::invalid_argument("Indicator window length must be positive");
+    }
+}
+
+/** Writes the sum of the last length values up to each element, over fewer values at the start. */
+inline void rollingSum(const double* values, size_t n, size_t length, double* out)
+{
+    checkLength(length);
+    if (length > DIRECT_SUM_LENGTH)
+    {
+        SMA sma{length};
+        for (size_t i = 0; i < n; ++i)
+        {
+            sma.push(values[i]);
+            out[i] = sma.sum();
+        }
+        return;
+    }
+
+    size_t warmup = std::min(n, length - 1);
+    double sum = 0.0;
+    for (size_t i = 0; i < warmup; ++i)
+    {
+        sum += values[i];
+        out[i] = sum;
+    }
+
+    size_t i = warmup;
+    for (; i + simd::WIDTH <= n; i += simd::WIDTH)
+    {
+        const double* window = values + i + 1 - length;
+        simd::Vector total = simd::broadcast(0.0);
+        for (size_t k = 0; k < length; ++k)
+        {
+            total = simd::add(total, simd::load(window + k));
+        }
+        simd::store(out + i, total);
+    }
+    for (; i < n; ++i)
+    {
+        const double* window = values + i + 1 - length;
+        double total = 0.0;
+        for (size_t k = 0; k < length; ++k) total += window[k];
+        out[i] = total;
+    }
+}
+
+/** Simple moving average, as SMA::value(). */
+inline void sma(const double* values, size_t n, size_t length, double* out)
+{
+    rollingSum(values, n, length, out);
+
+    size_t warmup = std::min(n, length - 1);
+    for (size_t i = 0; i < warmup; ++i) out[i] /= (i + 1);
+
+    size_t i = warmup;
+    simd::Vector divisor = simd::broadcast(static_cast<double>(length));
+    for (; i + simd::WIDTH <= n; i += simd::WIDTH)
+    {
+        simd::store(out + i, simd::div(simd::load(out + i), divisor));
+    }
+    for (; i < n; ++i) out[i] /= length;
+}
+
+/** Rolling mean and sample standard deviation, as RollingVariance::mean() and RollingVariance::standardDeviation(). */
+inline void rollingStandardDeviation(const double* values, size_t n, size_t length, double* mean_out, double* out)
+{
+    checkLength(length);
+    if (length > DIRECT_SUM_LENGTH)
+    {
+        RollingVariance variance{length};
+        for (size_t i = 0; i < n; ++i)
+        {
+            variance.push(values[i]);
+            mean_out[i] = variance.mean();
+            out[i] = variance.standardDeviation();
+        }
+        return;
+    }
+
+    sma(values, n, length, mean_out);
+
+    size_t warmup = std::min(n, length - 1);
+    for (size_t i = 0; i < warmup; ++i)
+    {
+        double squares = 0.0;
+        for (size_t k = 0; k <= i; ++k) squares += (values[k] - mean_out[i]) * (values[k] - mean_out[i]);
+        bool flat = squares <= RollingVariance::ROUNDING_RESIDUE * mean_out[i] * mean_out[i] * (i + 1);
+        out[i] = (i > 0 && !flat) ? std::sqrt(squares / i) : 0.0;
+    }
+
+    if (length == 1)
+    {
+        std::fill(out + warmup, out + n, 0.0);
+        return;
+    }
+
+    size_t i = warmup;
+    simd::Vector zero = simd::broadcast(0.0);
+    simd::Vector degrees = simd::broadcast(static_cast<double>(length - 1));
+    simd::Vector residue = simd::broadcast(RollingVariance::ROUNDING_RESIDUE * length);
+    for (; i + simd::WIDTH <= n; i += simd::WIDTH)
+    {
+        const double* window = values + i + 1 - length;
+        simd::Vector mean = simd::load(mean_out + i);
+        simd::Vector squares = zero;
+        for (size_t k = 0; k < length; ++k)
+        {
+            simd::Vector deviation = simd::sub(simd::load(window + k), mean);
+            squares = simd::add(squares, simd::mul(deviation, deviation));
+        }
+        simd::Mask varied = simd::greater(squares, simd::mul(residue, simd::mul(mean, mean)));
+        simd::store(out + i, simd::select(varied, simd::sqrt(simd::div(squares, degrees)), zero));
+    }
+    for (; i < n; ++i)
+    {
+        const double* window = values + i + 1 - length;
+        double squares = 0.0;
+        for (size_t k = 0; k < length; ++k) squares += (window[k] - mean_out[i]) * (window[k] - mean_out[i]);
+        bool flat = squares <= RollingVariance::ROUNDING_RESIDUE * mean_out[i] * mean_out[i] * length;
+        out[i] = flat ? 0.0 : std::sqrt(squares / (length - 1));
+    }
+}
+
+/** Exponential moving average, as EMA::value(). */
+inline void ema(const double* values, size_t n, int length, double* out)
+{
+    EMA average{length};
+    for (size_t i = 0; i < n; ++i)
+    {
+        average.push(values[i]);
+        out[i] = average.value();
+    }
+}
+
+/** Wilder-smoothed RSI, as RSI::value(): the neutral 50 until lookback prices are seen. */
+inline void rsi(const double* prices, size_t n, int lookback, double* out)
+{
+    if (lookback < 2)
+    {
+        throw std::invalid_argument("RSI lookback must be at least 2");
+    }
+    if (n == 0) return;
+
+    // Gains and losses of each move, the move into price i at index i
+    std::vector<double> gains(n, 0.0);
+    std::vector<double> losses(n, 0.0);
+    size_t i = 1;
+    simd::Vector zero = simd::broadcast(0.0);
+    for (; i + simd::WIDTH <= n; i += simd::WIDTH)
+    {
+        simd::Vector diff = simd::sub(simd::load(prices + i), simd::load(prices + i - 1));
+        simd::store(gains.data() + i, simd::max(diff, zero));
+        simd::store(losses.data() + i, simd::max(simd::sub(zero, diff), zero));
+    }
+    for (; i < n; ++i)
+    {
+        double diff = prices[i] - prices[i - 1];
+        gains[i] = diff > 0.0 ? diff : 0.0;
+        losses[i] = diff > 0.0 ? 0.0 : -diff;
+    }
+
+    // Same recurrence as RSI::push
+    double average_gain = 0.0;
+    double average_loss = 0.0;
+    size_t seed = static_cast<size_t>(lookback);
+    for (i = 0; i < n; ++i)
+    {
+        if (i > 0)
+        {
+            if (i < seed)
+            {
+                average_gain += gains[i] / (lookback - 1);
+                average_loss += losses[i] / (lookback - 1);
+            }
+            else
+            {
+                average_gain = ((lookback - 1) * average_gain + gains[i]) / lookback;
+                average_loss = ((lookback - 1) * average_loss + losses[i]) / lookback;
+            }
+        }
+        bool ready = i + 1 >= seed;
+        out[i] = (!ready || average_gain + average_loss < RSI::FLAT_THRESHOLD) ? 50.0 : 100.0 * average_gain / (average_gain + average_loss);
+    }
+}
+
+/** Rolling VWAP, as VWAP::value(): zero while the window has no volume. */
+inline void vwap(const double* prices, const double* volumes, size_t n, size_t length, double* out)
+{
+    std::vector<double> price_volume(n);
+    size_t i = 0;
+    for (; i + simd::WIDTH <= n; i += simd::WIDTH)
+    {
+        simd::store(price_volume.data() + i, simd::mul(simd::load(prices + i), simd::load(volumes + i)));
+    }
+    for (; i < n; ++i) price_volume[i] = prices[i] * volumes[i];
+
+    std::vector<double> volume_sums(n);
+    rollingSum(price_volume.data(), n, length, out);
+    rollingSum(volumes, n, length, volume_sums.data());
+
+    i = 0;
+    simd::Vector zero = simd::broadcast(0.0);
+    for (; i + simd::WIDTH <= n; i += simd::WIDTH)
+    {
+        simd::Vector volume = simd::load(volume_sums.data() + i);
+        simd::Vector average = simd::div(simd::load(out + i), volume);
+        simd::store(out + i, simd::select(simd::greater(volume, zero), average, zero));
+    }
+    for (; i < n; ++i) out[i] = volume_sums[i] > 0 ? out[i] / volume_sums[i] : 0.0;
+}
+
+/** Ratio of signed to total volume over the last lookback prices, as OBV::ratio(). */
+inline void obv(const double* prices, const double* volumes, size_t n, size_t lookback, double min_relative_change, double* out)
+{
+    if (n == 0) return;
+    out[0] = 0.0;
+    if (n == 1) return;
+
+    // Signed volume of each move, the move into price j + 1 at index j
+    size_t moves = n - 1;
+    std::vector<double> signed_volumes(moves);
+    size_t j = 0;
+    simd::Vector zero = simd::broadcast(0.0);
+    simd::Vector threshold = simd::broadcast(min_relative_change);
+    for (; j + simd::WIDTH <= moves; j += simd::WIDTH)
+    {
+        simd::Vector previous = simd::load(prices + j);
+        simd::Vector diff = simd::sub(simd::load(prices + j + 1), previous);
+        simd::Vector volume = simd::load(volumes + j + 1);
+        simd::Vector direction = simd::select(simd::greater(diff, zero), volume, simd::sub(zero, volume));
+        simd::Mask significant = simd::greater(simd::abs(diff), simd::mul(threshold, simd::abs(previous)));
+        simd::store(signed_volumes.data() + j, simd::select(significant, direction, zero));
+    }
+    for (; j < moves; ++j)
+    {
+        double diff = prices[j + 1] - prices[j];
+        bool significant = std::abs(diff) > min_relative_change * std::abs(prices[j]);
+        signed_volumes[j] = significant ? (diff > 0.0 ? volumes[j + 1] : -volumes[j + 1]) : 0.0;
+    }
+
+    size_t window = lookback > 1 ? lookback - 1 : 1;
+    std::vector<double> total_volumes(moves);
+    rollingSum(signed_volumes.data(), moves, window, out + 1);
+    rollingSum(volumes + 1, moves, window, total_volumes.data());
+    for (j = 0; j < moves; ++j)
+    {
+        out[j + 1] = total_volumes[j] > 0.0 ? out[j + 1] / total_volumes[j] : 0.0;
+    }
+}
+
+}
+
+#endif
\ No newline at end of file
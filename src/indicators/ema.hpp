@@ -0,0 +1,49 @@
+#ifndef EMA_HPP
+#define EMA_HPP
+
+#include <stdexcept>
+
+namespace indicators
+{
+
+/** Exponential moving average with smoothing factor 2 / (length + 1), seeded with the first value. */
+class EMA
+{
+public:
+
+    explicit EMA(int length)
+    : alpha_{2.0 / (length + 1.0)}
+    {
+        if (length < 1)
+        {
+            throw std::invalid_argument("EMA length must be positive");
+        }
+    };
+
+    void push(double value)
+    {
+        value_ = ready_ ? alpha_ * value + (1.0 - alpha_) * value_ : value;
+        ready_ = true;
+    }
+
+    /** Returns the current average, or zero before the first value. */
+    double value() const { return value_; };
+
+    bool ready() const { return ready_; };
+
+    void clear()
+    {
+        value_ = 0.0;
+        ready_ = false;
+    }
+
+private:
+
+    double alpha_;
+    double value_ = 0.0;
+    bool ready_ = false;
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,133 @@
+#ifndef MIN_MAX_WINDOW_HPP
+#define MIN_MAX_WINDOW_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace indicators
+{
+
+/** Tracks the minimum and maximum of the most recent values in a sliding window of fixed length.
+ *  Each extreme is kept in a monotonic queue of candidates, so pushes are amortised O(1)
+ *  and the queues live in ring buffers allocated once on construction. */
+template <typename T>
+class MinMaxWindow
+{
+public:
+
+    explicit MinMaxWindow(size_t length)
+    : length_{length},
+      minima_{length},
+      maxima_{length}
+    {
+        if (length == 0)
+        {
+            throw std::invalid_argument("Min/max window length must be positive");
+        }
+    };
+
+    /** Adds the value to the window, dropping the oldest value once the window is full. */
+    void push(const T& value)
+    {
+        // Candidates older than the window can no longer be an extreme
+        size_t oldest = (count_ >= length_) ? count_ - length_ + 1 : 0;
+        minima_.expire(oldest);
+        maxima_.expire(oldest);
+
+        // Candidates that are no better than the new value can never be an extreme again
+        while (!minima_.empty() && !(minima_.back().value < value)) minima_.popBack();
+        while (!maxima_.empty() && !(value < maxima_.back().value)) maxima_.popBack();
+        minima_.pushBack({count_, value});
+        maxima_.pushBack({count_, value});
+        ++count_;
+    }
+
+    /** Returns the smallest value in the window. The window must not be empty. */
+    const T& min() const { return minima_.front().value; };
+
+    /** Returns the largest value in the window. The window must not be empty. */
+    const T& max() const { return maxima_.front().value; };
+
+    size_t size() const { return count_ < length_ ? count_ : length_; };
+    size_t length() const { return length_; };
+    bool empty() const { return count_ == 0; };
+    bool full() const { return count_ >= length_; };
+
+    void clear()
+    {
+        count_ = 0;
+        minima_.clear();
+        maxima_.clear();
+    }
+
+private:
+
+    struct Candidate
+    {
+        size_t sequence;
+        T value;
+    };
+
+    /** A double-ended queue of at most capacity candidates on a ring buffer. */
+    class CandidateQueue
+    {
+    public:
+
+        explicit CandidateQueue(size_t capacity)
+        : candidates_(capacity),
+          capacity_{capacity}
+        {};
+
+        void pushBack(const Candidate& candidate)
+        {
+            size_t index = head_ + size_;
+            candidates_[index >= capacity_ ? index - capacity_ : index] = candidate;
+            ++size_;
+        }
+
+        void popBack() { --size_; };
+
+        /** Drops candidates from the front whose sequence is before the given one. */
+        void expire(size_t oldest)
+        {
+            while (size_ > 0 && candidates_[head_].sequence < oldest)
+            {
+                head_ = (head_ + 1 == capacity_) ? 0 : head_ + 1;
+                --size_;
+            }
+        }
+
+        const Candidate& front() const { return candidates_[head_]; };
+
+        const Candidate& back() const
+        {
+            size_t index = head_ + size_ - 1;
+            return candidates_[index >= capacity_ ? index - capacity_ : index];
+        }
+
+        bool empty() const { return size_ == 0; };
+
+        void clear()
+        {
+            head_ = 0;
+            size_ = 0;
+        }
+
+    private:
+
+        std::vector<Candidate> candidates_;
+        size_t capacity_;
+        size_t head_ = 0;
+        size_t size_ = 0;
+    };
+
+    size_t length_;
+    size_t count_ = 0;
+    CandidateQueue minima_;
+    CandidateQueue maxima_;
+};
+
+}
+
+#endif
\ No newline at end of file
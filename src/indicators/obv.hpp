@@ -0,0 +1,94 @@
+#ifndef OBV_HPP
+#define OBV_HPP
+
+#include <cmath>
+#include <cstddef>
+
+#include "rollingwindow.hpp"
+#include "sma.hpp"
+
+namespace indicators
+{
+
+/** On-balance volume over the last lookback prices: the volume of each rising move counts positive and of each falling move negative.
+ *  Moves smaller than min_relative_change of the previous price are unsigned but still count towards the total volume.
+ *  Signed and total volume are running sums over lookback - 1 moves, updated in amortised O(1). */
+class OBV
+{
+public:
+
+    explicit OBV(size_t lookback, double min_relative_change = 0.0)
+    : signed_volume_{lookback > 1 ? lookback - 1 : 1},
+      total_volume_{lookback > 1 ? lookback - 1 : 1},
+      min_relative_change_{min_relative_change}
+    {};
+
+    void push(double price, double volume)
+    {
+        if (has_price_)
+        {
+            double signed_volume = 0.0;
+            if (std::abs(price - last_price_) > min_relative_change_ * std::abs(last_price_))
+            {
+                signed_volume = (price > last_price_) ? volume : -volume;
+            }
+            signed_volume_.push(signed_volume);
+            total_volume_.push(volume);
+        }
+        last_price_ = price;
+        has_price_ = true;
+    }
+
+    /** Returns the signed volume as a fraction of the total volume, between -1 and 1, or zero if there was no volume. */
+    double ratio() const { return total_volume_.sum() > 0.0 ? signed_volume_.sum() / total_volume_.sum() : 0.0; };
+
+    double signedVolume() const { return signed_volume_.sum(); };
+    double totalVolume() const { return total_volume_.sum(); };
+
+    /** Indicates whether lookback prices have been seen. */
+    bool ready() const { return total_volume_.ready(); };
+
+    void clear()
+    {
+        signed_volume_.clear();
+        total_volume_.clear();
+        last_price_ = 0.0;
+        has_price_ = false;
+    }
+
+private:
+
+    SMA signed_volume_;
+    SMA total_volume_;
+    double min_relative_change_;
+    double last_price_ = 0.0;
+    bool has_price_ = false;
+};
+
+/** Change of a series over the last length values: the latest value minus the value length values before it. */
+class Delta
+{
+public:
+
+    explicit Delta(size_t length)
+    : window_{length + 1}
+    {};
+
+    void push(double value) { window_.push(value); };
+
+    /** Returns the change over the values seen so far, up to length values back. */
+    double value() const { return window_.empty() ? 0.0 : window_.newest() - window_.oldest(); };
+
+    /** Indicates whether length + 1 values have been seen. */
+    bool ready() const { return window_.full(); };
+
+    void clear() { window_.clear(); };
+
+private:
+
+    RollingWindow<double> window_;
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef ROLLING_WINDOW_HPP
+#define ROLLING_WINDOW_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace indicators
+{
+
+/** Holds the most recent values up to a fixed capacity, overwriting the oldest value once full.
+ *  Storage is allocated once on construction, so pushing never allocates. */
+template <typename T>
+class RollingWindow
+{
+public:
+
+    explicit RollingWindow(size_t capacity)
+    : values_(capacity),
+      capacity_{capacity}
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument("Rolling window capacity must be positive");
+        }
+    };
+
+    /** Appends the value, dropping the oldest value if the window is full. */
+    void push(const T& value)
+    {
+        values_[head_] = value;
+        head_ = (head_ + 1 == capacity_) ? 0 : head_ + 1;
+        if (size_ < capacity_) ++size_;
+    }
+
+    /** Returns the value that the next push drops, which is only meaningful when the window is full. */
+    const T& evicted() const { return values_[head_]; };
+
+    /** Returns the i-th value from the oldest. */
+    const T& operator[](size_t i) const
+    {
+        size_t index = head_ + capacity_ - size_ + i;
+        return values_[index >= capacity_ ? index - capacity_ : index];
+    }
+
+    const T& oldest() const { return (*this)[0]; };
+    const T& newest() const { return (*this)[size_ - 1]; };
+
+    size_t size() const { return size_; };
+    size_t capacity() const { return capacity_; };
+    bool empty() const { return size_ == 0; };
+    bool full() const { return size_ == capacity_; };
+
+    void clear()
+    {
+        head_ = 0;
+        size_ = 0;
+    }
+
+private:
+
+    std::vector<T> values_;
+    size_t capacity_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+};
+
+}
+
+#endif
\ No newline at end of file
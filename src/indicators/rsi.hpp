@@ -0,0 +1,130 @@
+#ifndef RSI_HPP
+#define RSI_HPP
+
+#include <stdexcept>
+
+#include "ema.hpp"
+#include "minmaxwindow.hpp"
+
+namespace indicators
+{
+
+/** Relative strength index with Wilder smoothing, updated in O(1) per price.
+ *  The average gain and loss are seeded with the simple average of the first lookback - 1 price moves,
+ *  then each further move is blended in with weight 1 / lookback. */
+class RSI
+{
+public:
+
+    explicit RSI(int lookback)
+    : lookback_{lookback}
+    {
+        if (lookback < 2)
+        {
+            throw std::invalid_argument("RSI lookback must be at least 2");
+        }
+    };
+
+    void push(double price)
+    {
+        if (count_ > 0)
+        {
+            double diff = price - last_price_;
+            double gain = diff > 0.0 ? diff : 0.0;
+            double loss = diff > 0.0 ? 0.0 : -diff;
+            if (count_ < lookback_)
+            {
+                average_gain_ += gain / (lookback_ - 1);
+                average_loss_ += loss / (lookback_ - 1);
+            }
+            else
+            {
+                average_gain_ = ((lookback_ - 1) * average_gain_ + gain) / lookback_;
+                average_loss_ = ((lookback_ - 1) * average_loss_ + loss) / lookback_;
+            }
+        }
+        last_price_ = price;
+        if (count_ < lookback_) ++count_;
+    }
+
+    /** Indicates whether lookback prices have been seen. */
+    bool ready() const { return count_ >= lookback_; };
+
+    /** Returns the RSI between 0 and 100, or the neutral 50 before it is ready or when prices are flat. */
+    double value() const
+    {
+        if (!ready() || average_gain_ + average_loss_ < FLAT_THRESHOLD) return 50.0;
+        return 100.0 * average_gain_ / (average_gain_ + average_loss_);
+    }
+
+    void clear()
+    {
+        count_ = 0;
+        last_price_ = 0.0;
+        average_gain_ = 0.0;
+        average_loss_ = 0.0;
+    }
+
+    /** Below this total movement the RSI is reported as neutral. */
+    static constexpr double FLAT_THRESHOLD = 1e-6;
+
+private:
+
+    int lookback_;
+    int count_ = 0;
+    double last_price_ = 0.0;
+    double average_gain_ = 0.0;
+    double average_loss_ = 0.0;
+};
+
+/** Stochastic RSI: where the latest RSI lies between the lowest and highest RSI of the last lookback values,
+ *  from 0 to 100, optionally smoothed by an EMA over n_to_smooth values. Updated in amortised O(1) per RSI value. */
+class StochasticRSI
+{
+public:
+
+    StochasticRSI(int lookback, int n_to_smooth)
+    : window_{static_cast<size_t>(lookback > 0 ? lookback : 0)},
+      smoothing_{n_to_smooth > 1 ? n_to_smooth : 1},
+      smoothed_{n_to_smooth > 1}
+    {};
+
+    void push(double rsi)
+    {
+        window_.push(rsi);
+        if (!window_.full()) return;
+
+        double range = window_.max() - window_.min();
+        double stoch_rsi = (range == 0.0) ? 50.0 : 100.0 * (rsi - window_.min()) / range;
+        if (smoothed_)
+        {
+            smoothing_.push(stoch_rsi);
+            stoch_rsi = smoothing_.value();
+        }
+        value_ = stoch_rsi;
+    }
+
+    /** Indicates whether lookback RSI values have been seen. */
+    bool ready() const { return window_.full(); };
+
+    /** Returns the stochastic RSI, or the neutral 50 before it is ready. */
+    double value() const { return value_; };
+
+    void clear()
+    {
+        window_.clear();
+        smoothing_.clear();
+        value_ = 50.0;
+    }
+
+private:
+
+    MinMaxWindow<double> window_;
+    EMA smoothing_;
+    bool smoothed_;
+    double value_ = 50.0;
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef INDICATORS_SIMD_HPP
+#define INDICATORS_SIMD_HPP
+
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#else
+#include <cmath>
+#endif
+
+/** The few vector operations on doubles used by the batch indicator kernels, on AVX2, on NEON or one lane at a time.
+ *  The instruction set is chosen at compile time, so kernels are written once against these functions. */
+namespace indicators::simd
+{
+
+#if defined(__AVX2__)
+
+using Vector = __m256d;
+using Mask = __m256d;
+constexpr size_t WIDTH = 4;
+constexpr const char* INSTRUCTION_SET = "avx2";
+
+inline Vector load(const double* values) { return _mm256_loadu_pd(values); }
+inline void store(double* values, Vector vector) { _mm256_storeu_pd(values, vector); }
+inline Vector broadcast(double value) { return _mm256_set1_pd(value); }
+inline Vector add(Vector a, Vector b) { return _mm256_add_pd(a, b); }
+inline Vector sub(Vector a, Vector b) { return _mm256_sub_pd(a, b); }
+inline Vector mul(Vector a, Vector b) { return _mm256_mul_pd(a, b); }
+inline Vector div(Vector a, Vector b) { return _mm256_div_pd(a, b); }
+inline Vector max(Vector a, Vector b) { return _mm256_max_pd(a, b); }
+inline Vector sqrt(Vector a) { return _mm256_sqrt_pd(a); }
+inline Vector abs(Vector a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+inline Mask greater(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+inline Vector select(Mask mask, Vector if_true, Vector if_false) { return _mm256_blendv_pd(if_false, if_true, mask); }
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+using Vector = float64x2_t;
+using Mask = uint64x2_t;
+constexpr size_t WIDTH = 2;
+constexpr const char* INSTRUCTION_SET = "neon";
+
+inline Vector load(const double* values) { return vld1q_f64(values); }
+inline void store(double* values, Vector vector) { vst1q_f64(values, vector); }
+inline Vector broadcast(double value) { return vdupq_n_f64(value); }
+inline Vector add(Vector a, Vector b) { return vaddq_f64(a, b); }
+inline Vector sub(Vector a, Vector b) { return vsubq_f64(a, b); }
+inline Vector mul(Vector a, Vector b) { return vmulq_f64(a, b); }
+inline Vector div(Vector a, Vector b) { return vdivq_f64(a, b); }
+inline Vector max(Vector a, Vector b) { return vmaxq_f64(a, b); }
+inline Vector sqrt(Vector a) { return vsqrtq_f64(a); }
+inline Vector abs(Vector a) { return vabsq_f64(a); }
+inline Mask greater(Vector a, Vector b) { return vcgtq_f64(a, b); }
+inline Vector select(Mask mask, Vector if_true, Vector if_false) { return vbslq_f64(mask, if_true, if_false); }
+
+#else
+
+using Vector = double;
+using Mask = bool;
+constexpr size_t WIDTH = 1;
+constexpr const char* INSTRUCTION_SET = "scalar";
+
+inline Vector load(const double* values) { return *values; }
+inline void store(double* values, Vector vector) { *values = vector; }
+inline Vector broadcast(double value) { return value; }
+inline Vector add(Vector a, Vector b) { return a + b; }
+inline Vector sub(Vector a, Vector b) { return a - b; }
+inline Vector mul(Vector a, Vector b) { return a * b; }
+inline Vector div(Vector a, Vector b) { return a / b; }
+inline Vector max(Vector a, Vector b) { return a > b ? a : b; }
+inline Vector sqrt(Vector a) { return std::sqrt(a); }
+inline Vector abs(Vector a) { return a < 0.0 ? -a : a; }
+inline Mask greater(Vector a, Vector b) { return a > b; }
+inline Vector select(Mask mask, Vector if_true, Vector if_false) { return mask ? if_true : if_false; }
+
+#endif
+
+}
+
+#endif
\ No newline at end of file
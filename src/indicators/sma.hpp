@@ -0,0 +1,65 @@
+#ifndef SMA_HPP
+#define SMA_HPP
+
+#include <cstddef>
+
+#include "rollingwindow.hpp"
+
+namespace indicators
+{
+
+/** Simple moving average of the last length values, kept as a running sum over a rolling window.
+ *  The sum is recomputed from the window each time the window wraps around, so rounding errors
+ *  do not accumulate while the update stays amortised O(1). */
+class SMA
+{
+public:
+
+    explicit SMA(size_t length)
+    : window_{length}
+    {};
+
+    void push(double value)
+    {
+        if (window_.full()) sum_ -= window_.evicted();
+        window_.push(value);
+        sum_ += value;
+
+        if (++pushes_ == window_.capacity())
+        {
+            pushes_ = 0;
+            sum_ = 0.0;
+            for (size_t i = 0; i < window_.size(); ++i) sum_ += window_[i];
+        }
+    }
+
+    /** Returns the average of the values in the window, or zero if it is empty. */
+    double value() const { return window_.empty() ? 0.0 : sum_ / window_.size(); };
+
+    /** Returns the sum of the values in the window. */
+    double sum() const { return sum_; };
+
+    /** Indicates whether the window holds length values. */
+    bool ready() const { return window_.full(); };
+
+    size_t size() const { return window_.size(); };
+
+    const RollingWindow<double>& window() const { return window_; };
+
+    void clear()
+    {
+        window_.clear();
+        sum_ = 0.0;
+        pushes_ = 0;
+    }
+
+private:
+
+    RollingWindow<double> window_;
+    double sum_ = 0.0;
+    size_t pushes_ = 0;
+};
+
+}
+
+#endif
\ No newline at end of file
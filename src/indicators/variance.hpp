@@ -0,0 +1,97 @@
+#ifndef VARIANCE_HPP
+#define VARIANCE_HPP
+
+#include <cmath>
+#include <cstddef>
+
+#include "rollingwindow.hpp"
+
+namespace indicators
+{
+
+/** Mean and variance of the last length values, updated in amortised O(1) per value.
+ *  The sum of squared deviations is maintained with Welford's update for adding a value and removing the oldest,
+ *  and recomputed from the window each time it wraps around so that rounding errors do not accumulate. */
+class RollingVariance
+{
+public:
+
+    explicit RollingVariance(size_t length)
+    : window_{length}
+    {};
+
+    void push(double value)
+    {
+        if (window_.full())
+        {
+            double evicted = window_.evicted();
+            double mean = mean_ + (value - evicted) / window_.size();
+            squares_ += (value - evicted) * (value - mean + evicted - mean_);
+            mean_ = mean;
+            window_.push(value);
+        }
+        else
+        {
+            window_.push(value);
+            double delta = value - mean_;
+            mean_ += delta / window_.size();
+            squares_ += delta * (value - mean_);
+        }
+
+        if (++pushes_ == window_.capacity())
+        {
+            pushes_ = 0;
+            recompute();
+        }
+    }
+
+    /** Returns the mean of the values in the window, or zero if it is empty. */
+    double mean() const { return mean_; };
+
+    /** Returns the sample variance of the values in the window, or zero if it holds fewer than two values. */
+    double variance() const
+    {
+        if (window_.size() < 2 || squares_ <= ROUNDING_RESIDUE * mean_ * mean_ * window_.size()) return 0.0;
+        return squares_ / (window_.size() - 1);
+    }
+
+    /** Returns the sample standard deviation of the values in the window. */
+    double standardDeviation() const { return std::sqrt(variance()); };
+
+    /** Indicates whether the window holds length values. */
+    bool ready() const { return window_.full(); };
+
+    size_t size() const { return window_.size(); };
+
+    /** Sums of squared deviations up to this fraction of the squared mean per value are rounding residue
+     *  of the running update on a flat window, and are reported as zero variance. */
+    static constexpr double ROUNDING_RESIDUE = 1e-14;
+
+    void clear()
+    {
+        window_.clear();
+        mean_ = 0.0;
+        squares_ = 0.0;
+        pushes_ = 0;
+    }
+
+private:
+
+    void recompute()
+    {
+        double sum = 0.0;
+        for (size_t i = 0; i < window_.size(); ++i) sum += window_[i];
+        mean_ = sum / window_.size();
+        squares_ = 0.0;
+        for (size_t i = 0; i < window_.size(); ++i) squares_ += (window_[i] - mean_) * (window_[i] - mean_);
+    }
+
+    RollingWindow<double> window_;
+    double mean_ = 0.0;
+    double squares_ = 0.0; // Sum of squared deviations from the mean
+    size_t pushes_ = 0;
+};
+
+}
+
+#endif
\ No newline at end of file
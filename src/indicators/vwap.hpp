@@ -0,0 +1,53 @@
+#ifndef VWAP_HPP
+#define VWAP_HPP
+
+#include <cstddef>
+
+#include "sma.hpp"
+
+namespace indicators
+{
+
+/** Volume-weighted average price over the last lookback trades, kept as running sums of price times volume and of volume. */
+class VWAP
+{
+public:
+
+    explicit VWAP(size_t lookback)
+    : price_volume_{lookback},
+      volume_{lookback}
+    {};
+
+    void push(double price, double volume)
+    {
+        price_volume_.push(price * volume);
+        volume_.push(volume);
+        last_price_ = price;
+    }
+
+    /** Returns the VWAP of the trades in the window, or zero if they have no volume. */
+    double value() const { return volume_.sum() > 0 ? price_volume_.sum() / volume_.sum() : 0.0; };
+
+    /** Returns the price of the latest trade. */
+    double lastPrice() const { return last_price_; };
+
+    /** Indicates whether lookback trades have been seen. */
+    bool ready() const { return volume_.ready(); };
+
+    void clear()
+    {
+        price_volume_.clear();
+        volume_.clear();
+        last_price_ = 0.0;
+    }
+
+private:
+
+    SMA price_volume_;
+    SMA volume_;
+    double last_price_ = 0.0;
+};
+
+}
+
+#endif
\ No newline at end of file
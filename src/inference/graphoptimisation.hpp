@@ -0,0 +1,32 @@
+#ifndef GRAPH_OPTIMISATION_HPP
+#define GRAPH_OPTIMISATION_HPP
+
+#include <string>
+
+/** How far ONNX Runtime optimises a model graph when loading it. */
+enum class GraphOptimisation : int
+{
+    BASIC,      // Constant folding and redundant node elimination
+    EXTENDED,   // Also fuses nodes into larger kernels
+    ALL         // Also optimises memory layout for the hardware
+};
+
+inline std::string to_string(GraphOptimisation level)
+{
+    switch (level) {
+        case GraphOptimisation::BASIC: return std::string{"basic"};
+        case GraphOptimisation::EXTENDED: return std::string{"extended"};
+        case GraphOptimisation::ALL: return std::string{"all"};
+        default: return std::string{""};
+    }
+}
+
+/** Returns the graph optimisation level for the given name. Defaults to basic. */
+inline GraphOptimisation graph_optimisation_from_string(std::string_view name)
+{
+    if (name == "extended") return GraphOptimisation::EXTENDED;
+    if (name == "all") return GraphOptimisation::ALL;
+    return GraphOptimisation::BASIC;
+}
+
+#endif
\ No newline at end of file
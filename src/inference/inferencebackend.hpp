@@ -0,0 +1,29 @@
+#ifndef INFERENCE_BACKEND_HPP
+#define INFERENCE_BACKEND_HPP
+
+#include <string>
+
+/** What runs a DeepTrader model. */
+enum class InferenceBackend : int
+{
+    ONNX,       // The exported ONNX model, on ONNX Runtime
+    NATIVE      // Tree ensembles only: the XGBoost model, on the built-in evaluator
+};
+
+inline std::string to_string(InferenceBackend backend)
+{
+    switch (backend) {
+        case InferenceBackend::ONNX: return std::string{"onnx"};
+        case InferenceBackend::NATIVE: return std::string{"native"};
+        default: return std::string{""};
+    }
+}
+
+/** Returns the inference backend for the given name. Defaults to ONNX. */
+inline InferenceBackend inference_backend_from_string(std::string_view name)
+{
+    if (name == "native") return InferenceBackend::NATIVE;
+    return InferenceBackend::ONNX;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef INFERENCE_DEVICE_HPP
+#define INFERENCE_DEVICE_HPP
+
+#include <string>
+
+/** Where ONNX Runtime runs a model. GPU devices fall back to the CPU when the ONNX Runtime build or the machine lacks them. */
+enum class InferenceDevice : int
+{
+    CPU,
+    CUDA,       // Through the CUDA execution provider
+    TENSORRT    // Through the TensorRT execution provider, with CUDA then the CPU for nodes it cannot run
+};
+
+inline std::string to_string(InferenceDevice device)
+{
+    switch (device) {
+        case InferenceDevice::CPU: return std::string{"cpu"};
+        case InferenceDevice::CUDA: return std::string{"cuda"};
+        case InferenceDevice::TENSORRT: return std::string{"tensorrt"};
+        default: return std::string{""};
+    }
+}
+
+/** Returns the inference device for the given name. Defaults to the CPU. */
+inline InferenceDevice inference_device_from_string(std::string_view name)
+{
+    if (name == "cuda") return InferenceDevice::CUDA;
+    if (name == "tensorrt") return InferenceDevice::TENSORRT;
+    return InferenceDevice::CPU;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,534 @@
+#ifndef INFERENCE_SERVICE_HPP
+#define INFERENCE_SERVICE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "onnxruntime/onnxruntime_cxx_api.h"
+
+#include "graphoptimisation.hpp"
+#include "inferencedevice.hpp"
+#include "modelcache.hpp"
+#include "../utilities/logger.hpp"
+
+/** Runs an ONNX model for every agent of the process that uses it, loading the model once.
+ *  Concurrent predictions are gathered into micro-batches: a batch runs once it holds the maximum batch size,
+ *  or once its first request has waited the maximum wait time. Requests are answered on the service's own thread.
+ *  Inputs and outputs are bound once to buffers sized for the largest batch, so running a batch allocates nothing.
+ *  A model may run on a GPU through the CUDA or TensorRT execution provider, with its buffers in page-locked memory. */
+class InferenceService
+{
+public:
+
+    struct BatchingOptions
+    {
+        size_t max_batch_size = 32;
+        std::chrono::microseconds max_wait {500};
+    };
+
+    /** How the session running a model is set up. Agents asking for different settings get sessions of their own. */
+    struct SessionSettings
+    {
+        GraphOptimisation graph_optimisation = GraphOptimisation::BASIC;
+        unsigned int intra_op_threads = 0; // 0 for the ONNX Runtime default
+        InferenceDevice device = InferenceDevice::CPU;
+        int device_id = 0; // GPU to run on, for GPU devices
+
+        std::string key() const
+        {
+            std::string key = to_string(graph_optimisation) + "/" + std::to_string(intra_op_threads);
+            if (device != InferenceDevice::CPU) key += "/" + to_string(device) + std::to_string(device_id);
+            return key;
+        }
+    };
+
+    /** Called with the model output for a row, or nullopt if inference failed. */
+    typedef std::function<void(std::optional<float>)> Callback;
+
+    /** Requests predictions from a service, for an agent. Callbacks are not called once the client is closed or destroyed,
+     *  and closing waits for a callback in progress, so a client declared last in an agent never calls back into a destroyed agent. */
+    class Client
+    {
+    public:
+
+        Client() = default;
+        Client(const Client&) = delete;
+        Client& operator=(const Client&) = delete;
+
+        explicit Client(std::shared_ptr<InferenceService> service)
+        : service_{std::move(service)},
+          state_{std::make_shared<State>()}
+        {
+        };
+
+        Client(Client&& other) = default;
+
+        Client& operator=(Client&& other)
+        {
+            close();
+            service_ = std::move(other.service_);
+            state_ = std::move(other.state_);
+            return *this;
+        }
+
+        ~Client()
+        {
+            close();
+        };
+
+        /** Indicates whether the client has a service to ask. */
+        bool ready() const { return service_ != nullptr; };
+
+        /** Asks for the model output on one row of features, copied before returning, answered through the callback. */
+        void predict(const float* features, size_t count, Callback callback)
+        {
+            if (!ready())
+            {
+                callback(std::nullopt);
+                return;
+            }
+
+            std::shared_ptr<State> state = state_;
+            service_->submit(features, count, [state, callback = std::move(callback)](std::optional<float> output) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->open) callback(output);
+            });
+        }
+
+        /** Stops answering requests through this client. */
+        void close()
+        {
+            if (state_ == nullptr) return;
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->open = false;
+        }
+
+    private:
+
+        struct State
+        {
+            std::mutex mutex;
+            bool open = true;
+        };
+
+        std::shared_ptr<InferenceService> service_;
+        std::shared_ptr<State> state_;
+    };
+
+    InferenceService(const InferenceService&) = delete;
+    InferenceService& operator=(const InferenceService&) = delete;
+
+    ~InferenceService()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_all();
+        if (worker_.joinable()) worker_.join();
+    };
+
+    /** Sets how the services of the process batch requests. Applies to models loaded afterwards. */
+    static void setBatchingOptions(BatchingOptions options)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        batchingOptions() = options;
+    }
+
+    /** Returns the service running the model at the given path with the given settings, loading it on first use. 
+     *  Rows are fed to the model in the given shape, without the batch dimension. Throws if the model cannot be loaded. */
+    static std::shared_ptr<InferenceService> forModel(const std::string& model_path, std::vector<int64_t> row_shape, SessionSettings settings)
+    {
+        // The environment is created first so that it outlives the sessions at exit
+        env();
+        std::lock_guard<std::mutex> lock(registryMutex());
+        std::shared_ptr<InferenceService>& service = registry()[model_path + "@" + settings.key()];
+        if (service == nullptr)
+        {
+            service.reset(new InferenceService{model_path, std::move(row_shape), settings, batchingOptions()});
+        }
+        return service;
+    }
+
+    /** Returns the number of features in a row. */
+    size_t rowSize() const { return row_size_; };
+
+private:
+
+    struct Request
+    {
+        Callback callback;
+        std::chrono::steady_clock::time_point submitted;
+        bool valid; // Whether the request had a full row of features
+    };
+
+    /** The input and output tensors of a batch of one size, viewing the shared buffers, and their binding. */
+    struct Binding
+    {
+        Ort::Value input {nullptr};
+        Ort::Value output {nullptr};
+        std::unique_ptr<Ort::IoBinding> io_binding;
+    };
+
+    /** Memory the tensors of every batch size view. For a model on a GPU it is page-locked memory from the CUDA provider,
+     *  which the device copies to and from directly rather than through a page-locked copy of its own. */
+    class StagingBuffer
+    {
+    public:
+
+        StagingBuffer() = default;
+        StagingBuffer(const StagingBuffer&) = delete;
+        StagingBuffer& operator=(const StagingBuffer&) = delete;
+
+        ~StagingBuffer()
+        {
+            if (allocator_ != nullptr) allocator_->Free(data_);
+        };
+
+        /** Allocates size values, page-locked if the session runs on a GPU and the provider has page-locked memory. */
+        void allocate(Ort::Session& session, InferenceDevice device, int device_id, size_t size)
+        {
+            if (device != InferenceDevice::CPU)
+            {
+                try
+                {
+                    Ort::MemoryInfo pinned{"CudaPinned", OrtDeviceAllocator, device_id, OrtMemTypeCPUOutput};
+                    std::unique_ptr<Ort::Allocator> allocator = std::make_unique<Ort::Allocator>(session, pinned);
+                    data_ = static_cast<float*>(allocator->Alloc(size * sizeof(float)));
+                    std::fill_n(data_, size, 0.0f);
+                    allocator_ = std::move(allocator);
+                    memory_info_ = std::move(pinned);
+                    return;
+                }
+                catch (const std::exception& e)
+                {
+                    LOG_WARN("Staging inference tensors in pageable memory: " << e.what());
+                }
+            }
+            host_.assign(size, 0.0f);
+            data_ = host_.data();
+        }
+
+        float* data() { return data_; };
+        const Ort::MemoryInfo& memoryInfo() const { return memory_info_; };
+
+    private:
+
+        Ort::MemoryInfo memory_info_ = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        std::unique_ptr<Ort::Allocator> allocator_; // Set if the memory is page-locked
+        std::vector<float> host_;
+        float* data_ = nullptr;
+    };
+
+    InferenceService(const std::string& model_path, std::vector<int64_t> row_shape, SessionSettings settings, BatchingOptions options)
+    : row_shape_{std::move(row_shape)},
+      options_{options}
+    {
+        // Changes the device to the CPU if the model cannot run on the one asked for
+        session_ = createSession(model_path, settings);
+        device_ = settings.device;
+
+        // Names are looked up once rather than on every run
+        Ort::AllocatorWithDefaultOptions allocator;
+        input_name_ = session_->GetInputNameAllocated(0, allocator).get();
+        output_name_ = session_->GetOutputNameAllocated(0, allocator).get();
+
+        row_size_ = 1;
+        for (int64_t dim : row_shape_) row_size_ *= static_cast<size_t>(dim);
+
+        // Models exported with a fixed batch dimension take batches of that size at most
+        std::vector<int64_t> model_shape = session_->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        if (!model_shape.empty() && model_shape.front() > 0)
+        {
+            options_.max_batch_size = std::min(options_.max_batch_size, static_cast<size_t>(model_shape.front()));
+        }
+        options_.max_batch_size = std::max<size_t>(options_.max_batch_size, 1);
+
+        // One row of output per row of input, its dimensions other than the batch taken from the model
+        output_row_shape_ = session_->GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        if (!output_row_shape_.empty()) output_row_shape_.erase(output_row_shape_.begin());
+        output_row_size_ = 1;
+        for (int64_t& dim : output_row_shape_)
+        {
+            if (dim <= 0) dim = 1;
+            output_row_size_ *= static_cast<size_t>(dim);
+        }
+
+        input_buffer_.allocate(*session_, device_, settings.device_id, options_.max_batch_size * row_size_);
+        output_buffer_.allocate(*session_, device_, settings.device_id, options_.max_batch_size * output_row_size_);
+        bindings_.resize(options_.max_batch_size);
+        pending_.reserve(options_.max_batch_size * 4);
+        pending_features_.reserve(options_.max_batch_size * 4 * row_size_);
+        batch_.reserve(options_.max_batch_size);
+
+        LOG_INFO("Loaded ONNX model " << model_path << " on " << to_string(device_) << " with " << to_string(settings.graph_optimisation) << " graph optimisation for batches of up to " 
+            << options_.max_batch_size << " rows, waiting up to " << options_.max_wait.count() << "us");
+        worker_ = std::thread{[this]() { run(); }};
+    }
+
+    /** Creates a session from the optimised model in the cache, or optimises the model and saves it to the cache.
+     *  A session on a GPU is tried first if one is asked for, and the device is changed to the CPU if it fails. */
+    static std::unique_ptr<Ort::Session> createSession(const std::string& model_path, SessionSettings& settings)
+    {
+        auto sessionOptions = [&settings](GraphOptimizationLevel level) {
+            Ort::SessionOptions session_options;
+            session_options.SetGraphOptimizationLevel(level);
+            if (settings.intra_op_threads > 0)
+            {
+                session_options.SetIntraOpNumThreads(static_cast<int>(settings.intra_op_threads));
+            }
+            return session_options;
+        };
+
+        // Graphs optimised for a GPU may hold nodes compiled for it, which cannot be saved, so GPU sessions optimise
+        // the model each time they load it. TensorRT keeps the engines it builds in the cache instead.
+        if (settings.device != InferenceDevice::CPU)
+        {
+            try
+            {
+                Ort::SessionOptions session_options = sessionOptions(ortOptimisationLevel(settings.graph_optimisation));
+                appendExecutionProviders(session_options, settings);
+                return std::make_unique<Ort::Session>(env(), model_path.c_str(), session_options);
+            }
+            catch (const std::exception& e)
+            {
+                LOG_WARN("Running " << model_path << " on the CPU, as it cannot run on " << to_string(settings.device) << ": " << e.what());
+                settings.device = InferenceDevice::CPU;
+            }
+        }
+
+        std::filesystem::path cached = ModelCache::optimisedModelPath(model_path, settings.key());
+        if (std::filesystem::exists(cached))
+        {
+            try
+            {
+                // Already optimised, so only loaded
+                std::unique_ptr<Ort::Session> session = std::make_unique<Ort::Session>(env(), cached.c_str(), sessionOptions(ORT_DISABLE_ALL));
+                LOG_INFO("Loaded optimised ONNX model " << cached);
+                return session;
+            }
+            catch (const Ort::Exception& e)
+            {
+                LOG_WARN("Ignoring the cached model " << cached << ": " << e.what());
+            }
+        }
+
+        Ort::SessionOptions session_options = sessionOptions(ortOptimisationLevel(settings.graph_optimisation));
+        std::filesystem::path temporary = ModelCache::temporaryPath(cached);
+        bool caching = ModelCache::ensureDirectory();
+        if (caching) session_options.SetOptimizedModelFilePath(temporary.c_str());
+
+        std::unique_ptr<Ort::Session> session = std::make_unique<Ort::Session>(env(), model_path.c_str(), session_options);
+        if (caching)
+        {
+            std::error_code error;
+            std::filesystem::rename(temporary, cached, error);
+            if (error) std::filesystem::remove(temporary, error);
+        }
+        return session;
+    }
+
+    /** Adds the execution providers for the settings' GPU device, which the CPU backs for nodes they cannot run.
+     *  Throws if the ONNX Runtime build lacks them. */
+    static void appendExecutionProviders(Ort::SessionOptions& session_options, const SessionSettings& settings)
+    {
+        std::vector<std::string> providers = Ort::GetAvailableProviders();
+        auto available = [&providers](std::string_view provider) {
+            return std::find(providers.begin(), providers.end(), provider) != providers.end();
+        };
+
+        if (settings.device == InferenceDevice::TENSORRT)
+        {
+            if (!available("TensorrtExecutionProvider"))
+            {
+                throw std::runtime_error("ONNX Runtime was built without the TensorRT execution provider");
+            }
+
+            std::string device_id = std::to_string(settings.device_id);
+            std::filesystem::path engines = ModelCache::engineDirectory();
+            bool caching = ModelCache::ensureDirectory();
+            if (caching)
+            {
+                std::error_code error;
+                std::filesystem::create_directories(engines, error);
+                caching = !error;
+            }
+            std::string engine_path = engines.string();
+            std::vector<const char*> keys {"device_id", "trt_engine_cache_enable", "trt_engine_cache_path"};
+            std::vector<const char*> values {device_id.c_str(), caching ? "1" : "0", engine_path.c_str()};
+
+            const OrtApi& api = Ort::GetApi();
+            OrtTensorRTProviderOptionsV2* tensorrt_options = nullptr;
+            Ort::ThrowOnError(api.CreateTensorRTProviderOptions(&tensorrt_options));
+            std::unique_ptr<OrtTensorRTProviderOptionsV2, decltype(api.ReleaseTensorRTProviderOptions)> owned_options{tensorrt_options, api.ReleaseTensorRTProviderOptions};
+            Ort::ThrowOnError(api.UpdateTensorRTProviderOptions(tensorrt_options, keys.data(), values.data(), keys.size()));
+            session_options.AppendExecutionProvider_TensorRT_V2(*tensorrt_options);
+        }
+
+        // CUDA runs the nodes TensorRT cannot, or the whole model
+        if (!available("CUDAExecutionProvider"))
+        {
+            throw std::runtime_error("ONNX Runtime was built without the CUDA execution provider");
+        }
+        OrtCUDAProviderOptions cuda_options;
+        cuda_options.device_id = settings.device_id;
+        session_options.AppendExecutionProvider_CUDA(cuda_options);
+    }
+
+    static GraphOptimizationLevel ortOptimisationLevel(GraphOptimisation level)
+    {
+        switch (level) {
+            case GraphOptimisation::EXTENDED: return ORT_ENABLE_EXTENDED;
+            case GraphOptimisation::ALL: return ORT_ENABLE_ALL;
+            default: return ORT_ENABLE_BASIC;
+        }
+    }
+
+    static Ort::Env& env()
+    {
+        static Ort::Env env{ORT_LOGGING_LEVEL_WARNING, "InferenceService"};
+        return env;
+    }
+
+    static std::mutex& registryMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::unordered_map<std::string, std::shared_ptr<InferenceService>>& registry()
+    {
+        static std::unordered_map<std::string, std::shared_ptr<InferenceService>> services;
+        return services;
+    }
+
+    static BatchingOptions& batchingOptions()
+    {
+        static BatchingOptions options;
+        return options;
+    }
+
+    void submit(const float* features, size_t count, Callback callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            bool valid = (count == row_size_);
+            pending_.push_back(Request{std::move(callback), std::chrono::steady_clock::now(), valid});
+            size_t offset = pending_features_.size();
+            pending_features_.resize(offset + row_size_, 0.0f);
+            if (valid) std::copy_n(features, row_size_, pending_features_.begin() + offset);
+        }
+        condition_.notify_one();
+    }
+
+    /** Gathers pending requests into batches and runs them until the service is destroyed. */
+    void run()
+    {
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+            if (pending_.empty()) return;
+
+            // Wait for the batch to fill up, no longer than the first request may wait
+            std::chrono::steady_clock::time_point deadline = pending_.front().submitted + options_.max_wait;
+            condition_.wait_until(lock, deadline, [this]() { return stopping_ || pending_.size() >= options_.max_batch_size; });
+
+            // The rows are staged straight into the bound input buffer
+            size_t rows = std::min(pending_.size(), options_.max_batch_size);
+            std::copy_n(pending_features_.begin(), rows * row_size_, input_buffer_.data());
+            pending_features_.erase(pending_features_.begin(), pending_features_.begin() + rows * row_size_);
+            batch_.assign(std::make_move_iterator(pending_.begin()), std::make_move_iterator(pending_.begin() + rows));
+            pending_.erase(pending_.begin(), pending_.begin() + rows);
+            lock.unlock();
+
+            runBatch();
+            batch_.clear();
+        }
+    }
+
+    /** Returns the tensors and binding for a batch of the given number of rows, creating them on first use. */
+    Binding& bindingFor(size_t rows)
+    {
+        Binding& binding = bindings_[rows - 1];
+        if (binding.io_binding != nullptr) return binding;
+
+        std::vector<int64_t> input_shape {static_cast<int64_t>(rows)};
+        input_shape.insert(input_shape.end(), row_shape_.begin(), row_shape_.end());
+        std::vector<int64_t> output_shape {static_cast<int64_t>(rows)};
+        output_shape.insert(output_shape.end(), output_row_shape_.begin(), output_row_shape_.end());
+
+        binding.input = Ort::Value::CreateTensor<float>(input_buffer_.memoryInfo(), input_buffer_.data(), rows * row_size_, input_shape.data(), input_shape.size());
+        binding.output = Ort::Value::CreateTensor<float>(output_buffer_.memoryInfo(), output_buffer_.data(), rows * output_row_size_, output_shape.data(), output_shape.size());
+        binding.io_binding = std::make_unique<Ort::IoBinding>(*session_);
+        binding.io_binding->BindInput(input_name_.c_str(), binding.input);
+        binding.io_binding->BindOutput(output_name_.c_str(), binding.output);
+        return binding;
+    }
+
+    void runBatch()
+    {
+        bool succeeded = false;
+        try
+        {
+            Binding& binding = bindingFor(batch_.size());
+            session_->Run(Ort::RunOptions{nullptr}, *binding.io_binding);
+            succeeded = true;
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR("ONNX Runtime error running a batch of " << batch_.size() << ": " << e.what());
+        }
+
+        // The first output of each row, whether the model outputs one value per row or several
+        for (size_t row = 0; row < batch_.size(); ++row)
+        {
+            try
+            {
+                bool answered = succeeded && batch_[row].valid;
+                batch_[row].callback(answered ? std::optional<float>{output_buffer_.data()[row * output_row_size_]} : std::nullopt);
+            }
+            catch (const std::exception& e)
+            {
+                LOG_ERROR("Error answering a prediction: " << e.what());
+            }
+        }
+    }
+
+    std::unique_ptr<Ort::Session> session_;
+    InferenceDevice device_;
+    std::vector<int64_t> row_shape_;
+    std::vector<int64_t> output_row_shape_;
+    size_t row_size_;
+    size_t output_row_size_;
+    BatchingOptions options_;
+    std::string input_name_;
+    std::string output_name_;
+
+    /** Buffers the tensors of every batch size view, sized for the largest batch, used by the worker only.
+     *  Declared after the session, whose allocator frees them. */
+    StagingBuffer input_buffer_;
+    StagingBuffer output_buffer_;
+    std::vector<Binding> bindings_; // By batch size minus one
+    std::vector<Request> batch_;
+
+    /** Requests waiting to be batched, oldest first, and their rows of features back to back. */
+    std::vector<Request> pending_;
+    std::vector<float> pending_features_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stopping_ = false;
+
+    std::thread worker_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,205 @@
+#ifndef MODEL_CACHE_HPP
+#define MODEL_CACHE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+
+#include "../utilities/logger.hpp"
+#include "../utilities/mappedfile.hpp"
+
+/** The min and max of each feature, and of the output last, that DeepTrader models were trained on. */
+struct NormalisationValues
+{
+    std::vector<float> min_values;
+    std::vector<float> max_values;
+};
+
+/** Files derived from DeepTrader models, kept on disk between runs so that agents start without redoing the work:
+ *  models as optimised by ONNX Runtime, and normalisation values compiled from JSON into a binary blob.
+ *  Entries are named after a hash of the file they derive from, so a changed model or JSON file is never served stale. */
+class ModelCache
+{
+public:
+
+    /** Sets the directory the cache is kept in. Must be called before the first model is loaded. */
+    static void setDirectory(std::string directory)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        cacheDirectory() = std::move(directory);
+    }
+
+    /** Returns a hash of the contents of the file, as 16 hex digits. */
+    static std::string contentHash(const std::string& path)
+    {
+        MappedFile file{path};
+        std::string_view data = file.view();
+
+        // FNV-1a, over 8 bytes at a time but for the tail
+        uint64_t hash = 14695981039346656037ull;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, data.data() + i, sizeof(word));
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        for (; i < data.size(); ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+        }
+
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        return std::string{hex};
+    }
+
+    /** Returns the path in the cache of the model at the given path as optimised with the given settings, which may not exist yet. */
+    static std::filesystem::path optimisedModelPath(const std::string& model_path, std::string_view settings_key)
+    {
+        std::string settings{settings_key};
+        std::replace(settings.begin(), settings.end(), '/', '-');
+        std::filesystem::path model{model_path};
+        return entryPath(model.stem().string() + "-" + contentHash(model_path) + "-" + settings + ".onnx");
+    }
+
+    /** Returns a path next to the given cache entry to write it to first, so that it never appears half written. */
+    static std::filesystem::path temporaryPath(const std::filesystem::path& entry)
+    {
+        return std::filesystem::path{entry.string() + ".tmp" + std::to_string(::getpid())};
+    }
+
+    /** Returns the directory TensorRT keeps the engines it builds in, which it names after the models itself. */
+    static std::filesystem::path engineDirectory()
+    {
+        return entryPath("tensorrt");
+    }
+
+    /** Creates the cache directory. Returns false if it cannot be created. */
+    static bool ensureDirectory()
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory(), error);
+        if (error)
+        {
+            LOG_WARN("Cannot create the model cache " << directory() << ": " << error.message());
+            return false;
+        }
+        return true;
+    }
+
+    /** Returns the normalisation values in the JSON file at the given path, shared by the agents of the process.
+     *  They are read from their compiled blob in the cache if there is one, and compiled into it otherwise. Throws if neither can be read. */
+    static std::shared_ptr<const NormalisationValues> normalisationValues(const std::string& json_path)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        std::shared_ptr<const NormalisationValues>& values = loadedValues()[json_path];
+        if (values != nullptr) return values;
+
+        std::filesystem::path blob_path = entryPath(std::filesystem::path{json_path}.stem().string() + "-" + contentHash(json_path) + ".bin");
+        std::shared_ptr<NormalisationValues> loaded = readBlob(blob_path);
+        if (loaded == nullptr)
+        {
+            loaded = std::make_shared<NormalisationValues>();
+            std::ifstream json_file{json_path};
+            nlohmann::json norm_data;
+            json_file >> norm_data;
+            loaded->min_values = norm_data["min_values"].get<std::vector<float>>();
+            loaded->max_values = norm_data["max_values"].get<std::vector<float>>();
+            writeBlob(blob_path, *loaded);
+        }
+
+        values = loaded;
+        return values;
+    }
+
+private:
+
+    /** Blobs are the magic, the version, the number of values, then the min and max values as native floats. */
+    static constexpr uint32_t BLOB_MAGIC = 0x564e5444; // "DTNV"
+    static constexpr uint32_t BLOB_VERSION = 1;
+
+    static std::shared_ptr<NormalisationValues> readBlob(const std::filesystem::path& blob_path)
+    {
+        if (!std::filesystem::exists(blob_path)) return nullptr;
+
+        MappedFile file{blob_path.string()};
+        std::string_view data = file.view();
+        uint32_t header[3];
+        if (data.size() < sizeof(header)) return nullptr;
+        std::memcpy(header, data.data(), sizeof(header));
+        size_t count = header[2];
+        if (header[0] != BLOB_MAGIC || header[1] != BLOB_VERSION || data.size() != sizeof(header) + 2 * count * sizeof(float))
+        {
+            LOG_WARN("Ignoring the malformed normalisation blob " << blob_path);
+            return nullptr;
+        }
+
+        std::shared_ptr<NormalisationValues> values = std::make_shared<NormalisationValues>();
+        values->min_values.resize(count);
+        values->max_values.resize(count);
+        std::memcpy(values->min_values.data(), data.data() + sizeof(header), count * sizeof(float));
+        std::memcpy(values->max_values.data(), data.data() + sizeof(header) + count * sizeof(float), count * sizeof(float));
+        return values;
+    }
+
+    static void writeBlob(const std::filesystem::path& blob_path, const NormalisationValues& values)
+    {
+        if (values.min_values.size() != values.max_values.size() || !ensureDirectory()) return;
+
+        std::filesystem::path temporary = temporaryPath(blob_path);
+        {
+            uint32_t header[3] = {BLOB_MAGIC, BLOB_VERSION, static_cast<uint32_t>(values.min_values.size())};
+            std::ofstream blob{temporary, std::ios::binary};
+            blob.write(reinterpret_cast<const char*>(header), sizeof(header));
+            blob.write(reinterpret_cast<const char*>(values.min_values.data()), values.min_values.size() * sizeof(float));
+            blob.write(reinterpret_cast<const char*>(values.max_values.data()), values.max_values.size() * sizeof(float));
+            if (!blob) return;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporary, blob_path, error);
+        if (error) std::filesystem::remove(temporary, error);
+    }
+
+    static std::filesystem::path entryPath(const std::string& name)
+    {
+        return std::filesystem::path{directory()} / name;
+    }
+
+    static std::string directory()
+    {
+        return cacheDirectory();
+    }
+
+    static std::string& cacheDirectory()
+    {
+        static std::string directory = "./cache/models";
+        return directory;
+    }
+
+    static std::unordered_map<std::string, std::shared_ptr<const NormalisationValues>>& loadedValues()
+    {
+        static std::unordered_map<std::string, std::shared_ptr<const NormalisationValues>> values;
+        return values;
+    }
+
+    static std::mutex& mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,253 @@
+#ifndef TREE_ENSEMBLE_HPP
+#define TREE_ENSEMBLE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+/** A gradient-boosted regression tree ensemble loaded from an XGBoost JSON model, evaluated natively.
+ *  Every tree is stored as a complete binary tree of the ensemble's depth in flat arrays, the children of node i
+ *  at 2i + 1 and 2i + 2, with a leaf reached early copied into every leaf below it. Each row then takes the same
+ *  number of steps down every tree, and a step is a comparison turned into an index rather than a branch.
+ *  Rows are evaluated in blocks, a tree at a time, so that their traversals overlap.
+ *
+ *  Predictions equal those of the ONNX TreeEnsembleRegressor the model is exported to: a row goes left when
+ *  its feature is below the threshold, a missing (NaN) feature follows the tree's default direction, and the leaf
+ *  values are summed in float in tree order before the base score is added. */
+class TreeEnsemble
+{
+public:
+
+    TreeEnsemble(const TreeEnsemble&) = delete;
+    TreeEnsemble& operator=(const TreeEnsemble&) = delete;
+
+    /** Returns the ensemble loaded from the XGBoost JSON model at the given path, loading it on first use.
+     *  Ensembles are immutable, so one is shared by every agent of the process. Throws if the model cannot be loaded. */
+    static std::shared_ptr<const TreeEnsemble> forModel(const std::string& model_path)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        std::shared_ptr<const TreeEnsemble>& ensemble = registry()[model_path];
+        if (ensemble == nullptr)
+        {
+            ensemble.reset(new TreeEnsemble{model_path});
+        }
+        return ensemble;
+    }
+
+    /** Writes the prediction for each of n rows of featureCount() features. */
+    void predict(const float* rows, size_t n, float* out) const
+    {
+        for (size_t start = 0; start < n; start += ROW_BLOCK)
+        {
+            size_t block = std::min(ROW_BLOCK, n - start);
+            const float* block_rows = rows + start * feature_count_;
+            float sums[ROW_BLOCK] = {};
+            for (size_t tree = 0; tree < tree_count_; ++tree)
+            {
+                const uint32_t* features = features_.data() + tree * internal_count_;
+                const float* thresholds = thresholds_.data() + tree * internal_count_;
+                const uint8_t* default_left = default_left_.data() + tree * internal_count_;
+                const float* leaves = leaves_.data() + tree * leaf_count_;
+
+                uint32_t nodes[ROW_BLOCK] = {};
+                for (unsigned int level = 0; level < depth_; ++level)
+                {
+                    for (size_t r = 0; r < block; ++r)
+                    {
+                        uint32_t node = nodes[r];
+                        float value = block_rows[r * feature_count_ + features[node]];
+                        uint32_t left = (value < thresholds[node]) | (std::isnan(value) & default_left[node]);
+                        nodes[r] = 2 * node + 2 - left;
+                    }
+                }
+                for (size_t r = 0; r < block; ++r)
+                {
+                    sums[r] += leaves[nodes[r] - internal_count_];
+                }
+            }
+            for (size_t r = 0; r < block; ++r)
+            {
+                out[start + r] = sums[r] + base_score_;
+            }
+        }
+    }
+
+    /** Returns the prediction for one row of featureCount() features. */
+    float predict(const float* row) const
+    {
+        float out;
+        predict(row, 1, &out);
+        return out;
+    }
+
+    size_t featureCount() const { return feature_count_; };
+    size_t treeCount() const { return tree_count_; };
+    unsigned int depth() const { return depth_; };
+
+    /** Rows evaluated together down each tree. */
+    static constexpr size_t ROW_BLOCK = 8;
+
+    /** Deepest tree loaded. A complete tree of this depth holds 2^depth leaves, so deeper models are rejected. */
+    static constexpr unsigned int MAX_DEPTH = 12;
+
+private:
+
+    /** One tree as exported by XGBoost: node i is a leaf if left[i] is -1, when its value is in conditions[i]. */
+    struct SourceTree
+    {
+        std::vector<int> left;
+        std::vector<int> right;
+        std::vector<unsigned int> split_indices;
+        std::vector<float> conditions;
+        std::vector<int> default_left;
+    };
+
+    explicit TreeEnsemble(const std::string& model_path)
+    {
+        std::ifstream file{model_path};
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open tree ensemble model " + model_path);
+        }
+        nlohmann::json model = nlohmann::json::parse(file);
+        const nlohmann::json& learner = model.at("learner");
+
+        std::string objective = learner.at("objective").at("name").get<std::string>();
+        if (objective != "reg:squarederror" && objective != "reg:linear" && objective != "reg:absoluteerror")
+        {
+            throw std::invalid_argument("Unsupported tree ensemble objective " + objective + " in " + model_path);
+        }
+        const nlohmann::json& parameters = learner.at("learner_model_param");
+        if (std::stoi(parameters.value("num_class", std::string{"0"})) > 1 || std::stoi(parameters.value("num_target", std::string{"1"})) > 1)
+        {
+            throw std::invalid_argument("Only single-output tree ensembles are supported: " + model_path);
+        }
+        feature_count_ = std::stoul(parameters.at("num_feature").get<std::string>());
+        base_score_ = parseScore(parameters.at("base_score").get<std::string>());
+
+        const nlohmann::json& booster = learner.at("gradient_booster");
+        if (booster.at("name").get<std::string>() != "gbtree")
+        {
+            throw std::invalid_argument("Only gbtree boosters are supported: " + model_path);
+        }
+
+        std::vector<SourceTree> trees;
+        for (const nlohmann::json& tree : booster.at("model").at("trees"))
+        {
+            if (tree.contains("categories") && !tree.at("categories").empty())
+            {
+                throw std::invalid_argument("Categorical splits are not supported: " + model_path);
+            }
+            SourceTree source;
+            source.left = tree.at("left_children").get<std::vector<int>>();
+            source.right = tree.at("right_children").get<std::vector<int>>();
+            source.split_indices = tree.at("split_indices").get<std::vector<unsigned int>>();
+            source.conditions = tree.at("split_conditions").get<std::vector<float>>();
+            source.default_left = tree.at("default_left").get<std::vector<int>>();
+            size_t nodes = source.left.size();
+            if (nodes == 0 || source.right.size() != nodes || source.split_indices.size() != nodes
+                || source.conditions.size() != nodes || source.default_left.size() != nodes)
+            {
+                throw std::invalid_argument("Malformed tree in " + model_path);
+            }
+            depth_ = std::max(depth_, depthOf(source, 0, 0));
+            trees.push_back(std::move(source));
+        }
+
+        tree_count_ = trees.size();
+        internal_count_ = (1u << depth_) - 1;
+        leaf_count_ = 1u << depth_;
+        features_.assign(tree_count_ * internal_count_, 0);
+        thresholds_.assign(tree_count_ * internal_count_, 0.0f);
+        default_left_.assign(tree_count_ * internal_count_, 0);
+        leaves_.assign(tree_count_ * leaf_count_, 0.0f);
+        for (size_t tree = 0; tree < tree_count_; ++tree)
+        {
+            flatten(trees[tree], tree, 0, 0);
+        }
+    }
+
+    /** Parses the base score, written as a number or, by newer XGBoost versions, as a one-element array. */
+    static float parseScore(std::string score)
+    {
+        score.erase(std::remove(score.begin(), score.end(), '['), score.end());
+        score.erase(std::remove(score.begin(), score.end(), ']'), score.end());
+        return std::stof(score);
+    }
+
+    /** Returns the depth of the subtree below the given node, checking it references valid nodes and features. */
+    unsigned int depthOf(const SourceTree& tree, int node, unsigned int level) const
+    {
+        if (node < 0 || static_cast<size_t>(node) >= tree.left.size() || level > MAX_DEPTH)
+        {
+            throw std::invalid_argument("Tree ensemble trees must be well formed and at most " + std::to_string(MAX_DEPTH) + " deep");
+        }
+        if (tree.left[node] == -1) return 0;
+        if (tree.split_indices[node] >= feature_count_)
+        {
+            throw std::invalid_argument("Tree ensemble split on feature " + std::to_string(tree.split_indices[node]) + " out of range");
+        }
+        return 1 + std::max(depthOf(tree, tree.left[node], level + 1), depthOf(tree, tree.right[node], level + 1));
+    }
+
+    /** Stores the source node at the given position of the complete tree, and its subtree below it. */
+    void flatten(const SourceTree& tree, size_t tree_index, int node, uint32_t position)
+    {
+        if (position >= internal_count_)
+        {
+            leaves_[tree_index * leaf_count_ + position - internal_count_] = tree.conditions[node];
+            return;
+        }
+
+        size_t flat = tree_index * internal_count_ + position;
+        if (tree.left[node] == -1)
+        {
+            // Both ways lead to copies of this leaf, so the split is never looked at
+            flatten(tree, tree_index, node, 2 * position + 1);
+            flatten(tree, tree_index, node, 2 * position + 2);
+            return;
+        }
+        features_[flat] = tree.split_indices[node];
+        thresholds_[flat] = tree.conditions[node];
+        default_left_[flat] = tree.default_left[node] != 0;
+        flatten(tree, tree_index, tree.left[node], 2 * position + 1);
+        flatten(tree, tree_index, tree.right[node], 2 * position + 2);
+    }
+
+    static std::mutex& registryMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::unordered_map<std::string, std::shared_ptr<const TreeEnsemble>>& registry()
+    {
+        static std::unordered_map<std::string, std::shared_ptr<const TreeEnsemble>> ensembles;
+        return ensembles;
+    }
+
+    size_t feature_count_ = 0;
+    size_t tree_count_ = 0;
+    unsigned int depth_ = 0;
+    uint32_t internal_count_ = 0; // Split nodes per tree, 2^depth - 1
+    uint32_t leaf_count_ = 1;     // Leaves per tree, 2^depth
+    float base_score_ = 0.0f;
+
+    // Split nodes of every tree, tree after tree, each tree in breadth-first order
+    std::vector<uint32_t> features_;
+    std::vector<float> thresholds_;
+    std::vector<uint8_t> default_left_;
+
+    // Leaves of every tree, tree after tree, left to right
+    std::vector<float> leaves_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "loadtestrunner.hpp"
+#include "../agent/loadgeneratoragent.hpp"
+#include "../networking/networkentity.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+LoadTestRunner::LoadTestRunner(Options options)
+: options_{options}
+{
+}
+
+bool LoadTestRunner::run()
+{
+    asio::io_context io_context{static_cast<int>(options_.io_threads)};
+    auto work = asio::make_work_guard(io_context);
+    std::vector<std::unique_ptr<NetworkEntity>> nodes;
+    std::vector<std::shared_ptr<LoadGeneratorAgent>> generators;
+    for (unsigned int i = 0; i < options_.connections; ++i)
+    {
+        LoadGeneratorConfigPtr config = std::make_shared<LoadGeneratorConfig>();
+        config->agent_id = options_.first_agent_id + i;
+        config->type = AgentType::LOAD_GENERATOR;
+        config->addr = options_.addr + ":" + std::to_string(options_.port + i);
+        config->exchange_name = options_.exchange_name;
+        config->exchange_addr = options_.exchange_addr;
+        config->ticker = options_.ticker;
+        config->delay = 0;
+        config->arrival = options_.arrival;
+        config->mid_price = options_.mid_price;
+        config->price_range = options_.price_range;
+        config->max_resting = options_.max_resting;
+        config->seed = (options_.seed != 0) ? options_.seed + i : 0;
+
+        nodes.push_back(std::make_unique<NetworkEntity>(io_context, options_.addr, static_cast<unsigned short>(options_.port + i)));
+        nodes.back()->listen();
+        generators.push_back(std::make_shared<LoadGeneratorAgent>(nodes.back().get(), config));
+        nodes.back()->setAgent(std::static_pointer_cast<Agent>(generators.back()));
+    }
+
+    std::vector<std::thread> io_threads;
+    for (unsigned int i = 0; i < std::max(options_.io_threads, 1u); ++i)
+    {
+        io_threads.emplace_back([&io_context]() { io_context.run(); });
+    }
+
+    report("Waiting for " + options_.exchange_name + " to open trading to " + std::to_string(options_.connections) + " connections");
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(options_.connect_timeout);
+    bool trading = false;
+    while (!trading && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        trading = std::all_of(generators.begin(), generators.end(), [](auto const& generator) { return generator->tradingOpen(); });
+    }
+
+    if (trading)
+    {
+        std::ostringstream header;
+        header << std::setw(12) << "offered/s" << std::setw(12) << "sent/s" << std::setw(12) << "acked/s"
+               << std::setw(12) << "ack p50us" << std::setw(12) << "ack p99us" << std::setw(12) << "ack p999us"
+               << std::setw(12) << "md p50us" << std::setw(12) << "md p99us" << std::setw(10) << "unacked" << std::setw(10) << "rejected";
+        report(header.str());
+
+        for (double rate : options_.rates)
+        {
+            for (auto const& generator : generators)
+            {
+                generator->takeStats();
+                generator->startLoad(rate / generators.size());
+            }
+            std::this_thread::sleep_for(std::chrono::duration<double>(options_.stage_time));
+            for (auto const& generator : generators)
+            {
+                generator->stopLoad();
+            }
+            std::this_thread::sleep_for(std::chrono::duration<double>(options_.drain_time));
+
+            LoadGeneratorAgent::LoadStats total;
+            for (auto const& generator : generators)
+            {
+                std::unique_ptr<LoadGeneratorAgent::LoadStats> stats = generator->takeStats();
+                total.sent += stats->sent;
+                total.acked += stats->acked;
+                total.rejected += stats->rejected;
+                total.elapsed = std::max(total.elapsed, stats->elapsed);
+                total.ack_latency.merge(stats->ack_latency);
+                total.market_data_latency.merge(stats->market_data_latency);
+            }
+
+            // Throughput over the stage alone; replies in the drain time still count towards it
+            double elapsed = std::max(total.elapsed, 1e-9);
+            std::ostringstream row;
+            row << std::fixed << std::setprecision(1)
+                << std::setw(12) << rate << std::setw(12) << total.sent / elapsed << std::setw(12) << total.acked / elapsed
+                << std::setw(12) << total.ack_latency.percentile(0.5) / 1000.0
+                << std::setw(12) << total.ack_latency.percentile(0.99) / 1000.0
+                << std::setw(12) << total.ack_latency.percentile(0.999) / 1000.0
+                << std::setw(12) << total.market_data_latency.percentile(0.5) / 1000.0
+                << std::setw(12) << total.market_data_latency.percentile(0.99) / 1000.0
+                << std::setw(10) << total.sent - total.acked - total.rejected
+                << std::setw(10) << total.rejected;
+            report(row.str());
+        }
+    }
+    else
+    {
+        report("Trading did not start within " + std::to_string(options_.connect_timeout) + "s");
+    }
+
+    for (auto const& generator : generators)
+    {
+        generator->terminate();
+    }
+    work.reset();
+    io_context.stop();
+    for (std::thread& thread : io_threads)
+    {
+        thread.join();
+    }
+    return trading;
+}
+
+void LoadTestRunner::report(const std::string& line)
+{
+    std::cout << "[LoadTest] " << line << std::endl;
+}
@@ -0,0 +1,53 @@
+#ifndef LOAD_TEST_RUNNER_HPP
+#define LOAD_TEST_RUNNER_HPP
+
+#include <string>
+#include <vector>
+
+#include "../config/arrivalprocess.hpp"
+
+/** Measures how many orders per second a running exchange sustains and how its latency grows with the load.
+ *  Opens a number of connections to the exchange, each a load generator on a node of its own in this process,
+ *  and sends orders through them at each of a series of total rates in turn, printing the throughput reached
+ *  and the order to ack and order to market data latencies at each rate. */
+class LoadTestRunner
+{
+public:
+
+    struct Options
+    {
+        std::string exchange_name;         // the exchange to load
+        std::string exchange_addr;         // its address, ip:port
+        std::string ticker;                // the ticker orders are sent for
+        std::string addr = "127.0.0.1";    // the address the generators listen on, where the exchange sends market data
+        unsigned short port = 9100;        // the port of the first generator, the others taking the ports after it
+        int first_agent_id = 100;          // the agent ID of the first generator, the others taking the IDs after it
+        unsigned int connections = 1;      // generators, each with its own connection to the exchange
+        unsigned int io_threads = 2;       // threads handling the generators' network IO
+        std::vector<double> rates;         // total orders per second of each stage, across all connections
+        double stage_time = 10;            // seconds orders are sent at each rate
+        double drain_time = 1;             // seconds after each stage replies are still timed
+        int connect_timeout = 60;          // seconds to wait for the exchange's trading session to start
+        ArrivalProcess arrival = ArrivalProcess::FIXED;
+        double mid_price = 100;
+        int price_range = 5;
+        int max_resting = 100;             // resting orders each generator keeps in the book
+        unsigned int seed = 0;             // seed of the first generator, the others seeded after it; zero for random seeds
+    };
+
+    LoadTestRunner() = delete;
+
+    explicit LoadTestRunner(Options options);
+
+    /** Runs a stage at each rate and prints the throughput and latency curve. Returns false if trading never started. */
+    bool run();
+
+private:
+
+    /** Prints a line of progress. */
+    void report(const std::string& line);
+
+    Options options_;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <chrono>
 #include <thread>
+#include <map>
 
 #include <boost/asio.hpp>
 #include <boost/archive/text_oarchive.hpp>
@@ -29,12 +30,19 @@
 #include "agent/orchestratoragent.hpp"
 #include "agent/deeptraderlstm.hpp"
 #include "agent/deeptraderxgb.hpp"
+#include "inference/inferenceservice.hpp"
+#include "utilities/simulationclock.hpp"
+#include "utilities/threadplacement.hpp"
 
 #include "message/message.hpp"
 #include "message/messagetype.hpp"
 #include "message/market_data_message.hpp"
 
 #include "config/configreader.hpp"
+#include "sweep/sweeprunner.hpp"
+#include "aggregate/aggregaterunner.hpp"
+#include "replay/replayrunner.hpp"
+#include "loadtest/loadtestrunner.hpp"
 #include "config/exchangeconfig.hpp"
 #include "config/traderconfig.hpp"
 
@@ -49,6 +57,11 @@ std::string showUsage()
     ss << "  " << "local" << "\t\t" << "run simulation in local mode" << "\n";
     ss << "  " << "orchestrator" << "\t" << "orchestrate the cloud simulation from this node" << "\n";
     ss << "  " << "node" << "\t\t" << "run as a simulation node" << "\n";
+    ss << "  " << "simulate" << "\t" << "run the whole simulation in this process on a virtual clock" << "\n";
+    ss << "  " << "sweep" << "\t\t" << "run the trials of a parameter sweep on a pool of simulate processes" << "\n";
+    ss << "  " << "aggregate" << "\t" << "summarise the profits and trades of the trials of a sweep into tables" << "\n";
+    ss << "  " << "replay" << "\t" << "replay the order tape of an exchange through its matching engine and check the trades" << "\n";
+    ss << "  " << "loadtest" << "\t" << "load a running exchange at a series of order rates and report its throughput and latency" << "\n";
     return ss.str();
 }
 
@@ -75,6 +88,17 @@ std::string showLocalUsage() {
     return ss.str();
 }
 
+/** Sets how the DeepTraders of the process batch their predictions and where their models are cached. */
+void setInferenceOptions(const po::variables_map& vm)
+{
+    ModelCache::setDirectory(vm["model-cache"].as<std::string>());
+
+    InferenceService::BatchingOptions batching;
+    batching.max_batch_size = vm["inference-max-batch"].as<size_t>();
+    batching.max_wait = std::chrono::microseconds(vm["inference-max-wait"].as<unsigned int>());
+    InferenceService::setBatchingOptions(batching);
+}
+
 void local_runner(int argc, char** argv)
 {
     po::options_description desc("Allowed options");
@@ -85,10 +109,38 @@ void local_runner(int argc, char** argv)
         ("exchange-name", po::value<std::string>()->default_value(std::string{"LSE"}), "set the name of the exchange")
         ("connect-time", po::value<int>()->default_value(30), "(exchange only) the time allowed for traders to connect (seconds)")
         ("trading-time", po::value<int>()->default_value(60), "(exchange only) the time of the trading window (seconds)")
+        ("order-book", po::value<std::string>()->default_value(std::string{"heap"}), "(exchange only) the order book implementation: heap or ladder")
+        ("tick-size", po::value<double>()->default_value(1.0), "(exchange only) the minimum price increment of the ticker")
+        ("matching-mode", po::value<std::string>()->default_value(std::string{"continuous"}), "(exchange only) the matching mode: continuous or auction")
+        ("auction-interval", po::value<int>()->default_value(100), "(exchange only) the time between call auction uncrosses (milliseconds)")
+        ("depth-levels", po::value<int>()->default_value(0), "(exchange only) the number of price levels published in market depth updates, 0 to disable")
+        ("market-data-feed", po::value<std::string>()->default_value(std::string{"full"}), "(exchange only) the market data feed: full or delta")
+        ("snapshot-interval", po::value<int>()->default_value(100), "(exchange only) the number of updates between full snapshots in the delta feed")
+        ("conflation-interval", po::value<int>()->default_value(0), "(exchange only) the minimum time between market data updates of a ticker (milliseconds), 0 to conflate per message only")
+        ("multicast-group", po::value<std::string>()->default_value(std::string{""}), "(exchange only) the multicast group address:port market data is published to, one port per ticker from this one; empty to disable")
+        ("csv-flush-interval", po::value<int>()->default_value(200), "(exchange only) the time between background writes of the CSV outputs (milliseconds), 0 to write every row synchronously")
+        ("output-format", po::value<std::string>()->default_value(std::string{"csv"}), "(exchange only) the format of the trade tapes, market data feeds and LOB snapshots: csv or columnar")
+        ("tape-compression", po::value<std::string>()->default_value(std::string{"none"}), "(exchange only) the CSV outputs written zstd-compressed: none, messages or all")
+        ("busy-poll", po::value<int>()->default_value(0), "(exchange only) the time the matching engine busy-polls for orders before sleeping (microseconds), -1 never to sleep, 0 to sleep at once")
+        ("cpu-affinity", po::value<std::string>()->default_value(std::string{""}), "(exchange only) the CPUs the exchange's threads are pinned to by role, as io=0;matching=1-2;session,writer=3, or auto; empty not to pin")
+        ("order-rate-limit", po::value<double>()->default_value(0), "(exchange only) the order messages per second each trader may send, beyond which they are rejected; 0 for no limit")
+        ("order-burst", po::value<int>()->default_value(0), "(exchange only) the order messages a trader may send at once within its rate limit, 0 for one second's worth")
+        ("fair-intake", po::value<bool>()->default_value(false), "(exchange only) interleave the messages the matching engine takes by sender, rather than handling them as they arrived")
+        ("shared-memory-feed", po::value<std::string>()->default_value(std::string{""}), "(exchange only) the directory, such as /dev/shm, each ticker's market data is also written to for traders on this host; empty to disable")
         ("delay", po::value<unsigned int>()->default_value(0), "(trader only) delayed start for trader (seconds)")
         ("side", po::value<std::string>()->default_value(std::string{"buyer"}), "(trader only) set the trader side: buyer or seller")
         ("limit", po::value<double>()->default_value(100), "(trader only) set the limit price of the trader")
+        ("prediction-log-interval", po::value<unsigned int>()->default_value(1), "(deep traders only) record every nth price prediction to the prediction log, 0 for none")
+        ("graph-optimisation", po::value<std::string>()->default_value(std::string{"basic"}), "(deep traders only) the model graph optimisation: basic, extended or all")
+        ("inference-threads", po::value<unsigned int>()->default_value(0), "(deep traders only) the threads running each inference, 0 for the ONNX Runtime default")
+        ("inference-device", po::value<std::string>()->default_value(std::string{"cpu"}), "(deep traders only) where the ONNX model runs: cpu, cuda or tensorrt, falling back to cpu")
+        ("inference-device-id", po::value<int>()->default_value(0), "(deep traders only) the GPU the ONNX model runs on")
+        ("inference-backend", po::value<std::string>()->default_value(std::string{"onnx"}), "(deepxgb only) what runs the model: onnx, or native for the built-in tree evaluator")
+        ("inference-max-batch", po::value<size_t>()->default_value(32), "(deep traders only) the most predictions run through a model at once")
+        ("inference-max-wait", po::value<unsigned int>()->default_value(500), "(deep traders only) the longest a prediction waits for others to batch with it (microseconds)")
+        ("model-cache", po::value<std::string>()->default_value(std::string{"./cache/models"}), "(deep traders only) the directory optimised models and compiled normalisation values are kept in")
         ("exchange-addr", po::value<std::string>()->default_value(std::string{"127.0.0.1:9999"}), "(trader only) set the IPv4 address of the exchange")
+        ("metrics-port", po::value<unsigned short>()->default_value(0), "set the port the agent serves its metrics on over HTTP, 0 to disable")
         ("config", po::value<std::string>()->default_value(std::string{"../simulation.xml"}), "set the path to the configuration file")
     ;
 
@@ -109,6 +161,11 @@ void local_runner(int argc, char** argv)
 
     asio::io_context io_context;
     NetworkEntity entity{io_context, std::string{"127.0.0.1"}, port};
+    setInferenceOptions(vm);
+    if (vm["metrics-port"].as<unsigned short>() != 0)
+    {
+        entity.enableMetrics(vm["metrics-port"].as<unsigned short>());
+    }
 
     SimulationConfigPtr simulation_config = ConfigReader::readConfig(config_filepath);
 
@@ -121,6 +178,24 @@ void local_runner(int argc, char** argv)
         config->tickers = std::vector { vm["ticker"].as<std::string>() };
         config->connect_time = vm["connect-time"].as<int>();
         config->trading_time = vm["trading-time"].as<int>();
+        config->order_book_type = order_book_type_from_string(vm["order-book"].as<std::string>());
+        config->tick_sizes[vm["ticker"].as<std::string>()] = vm["tick-size"].as<double>();
+        config->matching_mode = matching_mode_from_string(vm["matching-mode"].as<std::string>());
+        config->auction_interval = vm["auction-interval"].as<int>();
+        config->depth_levels = vm["depth-levels"].as<int>();
+        config->market_data_feed = market_data_feed_type_from_string(vm["market-data-feed"].as<std::string>());
+        config->snapshot_interval = vm["snapshot-interval"].as<int>();
+        config->conflation_interval = vm["conflation-interval"].as<int>();
+        config->multicast_group = vm["multicast-group"].as<std::string>();
+        config->csv_flush_interval = vm["csv-flush-interval"].as<int>();
+        config->busy_poll = vm["busy-poll"].as<int>();
+        config->cpu_affinity = vm["cpu-affinity"].as<std::string>();
+        config->order_rate_limit = vm["order-rate-limit"].as<double>();
+        config->order_burst = vm["order-burst"].as<int>();
+        config->fair_intake = vm["fair-intake"].as<bool>();
+        config->shared_memory_feed = vm["shared-memory-feed"].as<std::string>();
+        config->output_format = output_format_from_string(vm["output-format"].as<std::string>());
+        config->tape_compression = tape_compression_from_string(vm["tape-compression"].as<std::string>());
 
         std::shared_ptr<StockExchange> exchange (new StockExchange{&entity, config});
         entity.setAgent(std::static_pointer_cast<Agent>(exchange));
@@ -366,6 +441,11 @@ void local_runner(int argc, char** argv)
         config->side = (vm["side"].as<std::string>() == "buyer") ? Order::Side::BID : Order::Side::ASK;
         config->limit = vm["limit"].as<double>();
         config->delay = vm["delay"].as<unsigned int>();
+        config->prediction_log_interval = vm["prediction-log-interval"].as<unsigned int>();
+        config->graph_optimisation = graph_optimisation_from_string(vm["graph-optimisation"].as<std::string>());
+        config->inference_threads = vm["inference-threads"].as<unsigned int>();
+        config->inference_device = inference_device_from_string(vm["inference-device"].as<std::string>());
+        config->inference_device_id = vm["inference-device-id"].as<int>();
 
         std::shared_ptr<TraderDeepLSTM> trader (new TraderDeepLSTM{&entity, config});
         entity.setAgent(std::static_pointer_cast<Agent>(trader));
@@ -382,6 +462,12 @@ void local_runner(int argc, char** argv)
         config->side = (vm["side"].as<std::string>() == "buyer") ? Order::Side::BID : Order::Side::ASK;
         config->limit = vm["limit"].as<double>();
         config->delay = vm["delay"].as<unsigned int>();
+        config->prediction_log_interval = vm["prediction-log-interval"].as<unsigned int>();
+        config->graph_optimisation = graph_optimisation_from_string(vm["graph-optimisation"].as<std::string>());
+        config->inference_threads = vm["inference-threads"].as<unsigned int>();
+        config->inference_device = inference_device_from_string(vm["inference-device"].as<std::string>());
+        config->inference_device_id = vm["inference-device-id"].as<int>();
+        config->inference_backend = inference_backend_from_string(vm["inference-backend"].as<std::string>());
 
         std::shared_ptr<TraderDeepXGB> trader (new TraderDeepXGB{&entity, config});
         entity.setAgent(std::static_pointer_cast<Agent>(trader));
@@ -400,6 +486,17 @@ void node_runner(int argc, char** argv)
     desc.add_options()
         ("help", "show help message")
         ("port", po::value<unsigned short>()->default_value(8080), "set the port of the current agent")
+        ("write-batch", po::value<size_t>()->default_value(64 * 1024), "set the maximum number of bytes sent to a connection in one write")
+        ("io-threads", po::value<unsigned int>()->default_value(1), "set the number of threads handling network IO, each connection still being served in order")
+        ("send-high-watermark", po::value<size_t>()->default_value(8 * 1024 * 1024), "set the bytes queued to a connection above which market data is dropped and other messages wait, 0 for unbounded")
+        ("send-low-watermark", po::value<size_t>()->default_value(2 * 1024 * 1024), "set the bytes queued to a connection below which waiting messages resume")
+        ("send-stall-timeout", po::value<unsigned int>()->default_value(10000), "set the milliseconds a message may wait on a backlogged connection before it is closed")
+        ("max-agents", po::value<unsigned int>()->default_value(1), "set the number of agents the node may host, sharing its sockets and connections")
+        ("inference-max-batch", po::value<size_t>()->default_value(32), "set the most DeepTrader predictions run through a model at once, across the agents of the node")
+        ("inference-max-wait", po::value<unsigned int>()->default_value(500), "set the longest a DeepTrader prediction waits for others to batch with it (microseconds)")
+        ("model-cache", po::value<std::string>()->default_value(std::string{"./cache/models"}), "set the directory DeepTrader models are kept in once optimised, with their compiled normalisation values")
+        ("metrics-port", po::value<unsigned short>()->default_value(0), "set the port the node serves its metrics on over HTTP, 0 to disable")
+        ("cpu-affinity", po::value<std::string>()->default_value(std::string{""}), "set the CPUs the node's threads are pinned to by role, as io=0;matching=1-2;session,writer=3, or auto to divide those the node may run on; an exchange's own setting takes precedence")
     ;
 
     po::variables_map vm;
@@ -414,8 +511,28 @@ void node_runner(int argc, char** argv)
 
     unsigned short port { vm["port"].as<unsigned short>() };
 
-    asio::io_context io_context;
+    unsigned int io_threads { vm["io-threads"].as<unsigned int>() };
+
+    asio::io_context io_context{static_cast<int>(io_threads)};
     NetworkEntity entity{io_context, port};
+    entity.setMaxWriteBatch(vm["write-batch"].as<size_t>());
+    entity.setIOThreads(io_threads);
+    entity.setMaxAgents(vm["max-agents"].as<unsigned int>());
+    setInferenceOptions(vm);
+    if (vm["metrics-port"].as<unsigned short>() != 0)
+    {
+        entity.enableMetrics(vm["metrics-port"].as<unsigned short>());
+    }
+
+    SendQueueLimits send_queue_limits;
+    send_queue_limits.high_watermark = vm["send-high-watermark"].as<size_t>();
+    send_queue_limits.low_watermark = std::min(vm["send-low-watermark"].as<size_t>(), send_queue_limits.high_watermark);
+    send_queue_limits.stall_timeout = std::chrono::milliseconds(vm["send-stall-timeout"].as<unsigned int>());
+    entity.setSendQueueLimits(send_queue_limits);
+    if (!vm["cpu-affinity"].as<std::string>().empty())
+    {
+        ThreadPlacement::instance().configure(vm["cpu-affinity"].as<std::string>(), 1);
+    }
     entity.start();
 }
 
@@ -426,6 +543,7 @@ void orchestrator(int argc, char** argv)
         ("help", "show help message")
         ("port", po::value<unsigned short>()->default_value(8080), "set the port of the orchestrator agent")
         ("config", po::value<std::string>()->default_value(std::string{"simulation.xml"}), "set the path to the configuration file")
+        ("wire-format", po::value<std::string>()->default_value(std::string{"binary"}), "set the message wire format used by the whole simulation: binary or text")
     ;
 
     po::variables_map vm;
@@ -447,6 +565,7 @@ void orchestrator(int argc, char** argv)
     // Create a new network entity with orchestrator agent
     asio::io_context io_context;
     NetworkEntity entity{io_context, 10001};
+    entity.setWireFormat(wire_format_from_string(vm["wire-format"].as<std::string>()));
 
     AgentConfigPtr orchestrator_config = std::make_shared<AgentConfig>();
     orchestrator_config->agent_id = 999;
@@ -459,6 +578,259 @@ void orchestrator(int argc, char** argv)
     entity.start();
 }
 
+void simulate(int argc, char** argv)
+{
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "show help message")
+        ("config", po::value<std::string>()->default_value(std::string{"simulation.xml"}), "set the path to the configuration file")
+        ("seed", po::value<uint64_t>()->default_value(1), "set the seed every random choice of the session is drawn from, so that it can be repeated")
+        ("inference-max-batch", po::value<size_t>()->default_value(32), "set the most DeepTrader predictions run through a model at once")
+        ("inference-max-wait", po::value<unsigned int>()->default_value(500), "set the longest a DeepTrader prediction waits for others to batch with it (microseconds)")
+        ("model-cache", po::value<std::string>()->default_value(std::string{"./cache/models"}), "set the directory DeepTrader models are kept in once optimised, with their compiled normalisation values")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "\n" << desc << std::endl;
+        exit(1);
+    }
+
+    // Everything from here on, reading the configuration included, runs on the virtual clock
+    SimulationClock::useVirtualTime(vm["seed"].as<uint64_t>());
+    std::string filepath { vm["config"].as<std::string>() };
+    SimulationConfigPtr simulation = ConfigReader::readConfig(filepath);
+    setInferenceOptions(vm);
+
+    // One node per address of the configuration, in each slot of the trials run at once, 
+    // hosting every agent given that address, all handing messages over in process
+    std::map<std::string, unsigned int> agents_per_node;
+    for (int slot = 0; slot < std::min(simulation->concurrentTrials(), simulation->repetitions()); slot++)
+    {
+        SimulationConfigPtr trial = simulation->trial(slot);
+        for (auto config : trial->exchanges()) ++agents_per_node[config->addr];
+        for (auto config : trial->injectors()) ++agents_per_node[config->addr];
+        for (auto config : trial->relays()) ++agents_per_node[config->addr];
+        for (auto config : trial->traders()) ++agents_per_node[config->addr];
+    }
+
+    // A single IO thread handles every message, so that a seeded session repeats exactly
+    asio::io_context io_context{1};
+    std::vector<std::unique_ptr<NetworkEntity>> nodes;
+    std::thread io_thread;
+    {
+        SimulationClock::Participant setup;
+        for (auto const& [address, agent_count] : agents_per_node)
+        {
+            size_t colon = address.find(':');
+            std::string ip = address.substr(0, colon);
+            unsigned short port = static_cast<unsigned short>(std::stoi(address.substr(colon + 1)));
+
+            nodes.push_back(std::make_unique<NetworkEntity>(io_context, ip, port));
+            nodes.back()->setMaxAgents(agent_count);
+            nodes.back()->listen();
+        }
+
+        nodes.push_back(std::make_unique<NetworkEntity>(io_context, std::string{"127.0.0.1"}, 10001));
+        nodes.back()->listen();
+
+        AgentConfigPtr orchestrator_config = std::make_shared<AgentConfig>();
+        orchestrator_config->agent_id = 999;
+        std::shared_ptr<OrchestratorAgent> orchestrator (new OrchestratorAgent{nodes.back().get(), orchestrator_config});
+        nodes.back()->setAgent(std::static_pointer_cast<Agent>(orchestrator));
+        orchestrator->configureSimulation(simulation);
+
+        io_thread = std::thread([&io_context]() { io_context.run(); });
+    }
+
+    // The session has run to its end once nothing is left to happen
+    SimulationClock::waitUntilIdle();
+    std::cout << "Simulation finished at " << std::chrono::duration<double>(SimulationClock::now()).count() << "s of virtual time." << std::endl;
+    io_context.stop();
+    io_thread.join();
+}
+
+void sweep(int argc, char** argv)
+{
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "show help message")
+        ("config", po::value<std::string>()->default_value("simulation.xml"), "set the simulation configuration file every trial runs")
+        ("markets", po::value<std::string>()->default_value("markets.csv"), "set the file of trader mixes to sweep, one per line")
+        ("output", po::value<std::string>()->default_value("sweep"), "set the directory the trials and merged profits are written to")
+        ("trials", po::value<int>()->default_value(3), "set the number of trials of each trader mix")
+        ("jobs", po::value<unsigned int>()->default_value(0), "set the number of trials run at once, 0 for one per hardware thread")
+        ("retries", po::value<int>()->default_value(2), "set the number of further attempts at a failed trial")
+        ("trial-timeout", po::value<int>()->default_value(600), "set the seconds a trial may run before it fails, 0 for no limit")
+        ("seed", po::value<uint64_t>()->default_value(1), "set the seed the seeds of the trials are drawn from")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "\n" << desc << std::endl;
+        exit(1);
+    }
+
+    SweepRunner::Options options;
+    options.config = vm["config"].as<std::string>();
+    options.markets = vm["markets"].as<std::string>();
+    options.output = vm["output"].as<std::string>();
+    options.executable = std::filesystem::canonical("/proc/self/exe").string();
+    options.trials = vm["trials"].as<int>();
+    options.jobs = vm["jobs"].as<unsigned int>();
+    options.retries = vm["retries"].as<int>();
+    options.trial_timeout = vm["trial-timeout"].as<int>();
+    options.seed = vm["seed"].as<uint64_t>();
+
+    SweepRunner runner {options};
+    if (runner.run() > 0)
+    {
+        exit(1);
+    }
+}
+
+void aggregate(int argc, char** argv)
+{
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "show help message")
+        ("input", po::value<std::string>()->default_value("sweep"), "set the directory of the sweep to summarise")
+        ("output", po::value<std::string>()->default_value(""), "set the directory the tables are written to, empty for aggregate/ in the sweep")
+        ("jobs", po::value<unsigned int>()->default_value(0), "set the number of trials read at once, 0 for one per hardware thread")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "\n" << desc << std::endl;
+        exit(1);
+    }
+
+    AggregateRunner::Options options;
+    options.input = vm["input"].as<std::string>();
+    options.output = vm["output"].as<std::string>();
+    options.jobs = vm["jobs"].as<unsigned int>();
+
+    AggregateRunner runner {options};
+    if (runner.run() > 0)
+    {
+        exit(1);
+    }
+}
+
+void replay(int argc, char** argv)
+{
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "show help message")
+        ("config", po::value<std::string>()->default_value("simulation.xml"), "set the simulation configuration the session ran")
+        ("tape", po::value<std::string>(), "set the order tape recorded by the exchange")
+        ("trades", po::value<std::string>()->default_value(""), "set the CSV trade tape of the session to check the replay against, empty not to check")
+        ("exchange", po::value<std::string>()->default_value(""), "set the exchange that recorded the tape, empty for the first of the configuration")
+        ("output", po::value<std::string>()->default_value("replay"), "set the directory the outputs of the replay are written to")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") || !vm.count("tape"))
+    {
+        std::cout << "\n" << desc << std::endl;
+        exit(1);
+    }
+
+    ReplayRunner::Options options;
+    options.config = vm["config"].as<std::string>();
+    options.tape = vm["tape"].as<std::string>();
+    options.trades = vm["trades"].as<std::string>();
+    options.exchange = vm["exchange"].as<std::string>();
+    options.output = vm["output"].as<std::string>();
+
+    ReplayRunner runner {options};
+    if (runner.run() > 0)
+    {
+        exit(1);
+    }
+}
+
+void loadtest(int argc, char** argv)
+{
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "show help message")
+        ("exchange-name", po::value<std::string>()->default_value(std::string{"LSE"}), "set the name of the exchange to load")
+        ("exchange-addr", po::value<std::string>()->default_value(std::string{"127.0.0.1:9999"}), "set the IPv4 address of the exchange")
+        ("ticker", po::value<std::string>()->default_value(std::string{"AAPL"}), "set the ticker orders are sent for")
+        ("addr", po::value<std::string>()->default_value(std::string{"127.0.0.1"}), "set the IPv4 address the load generators listen on for market data")
+        ("port", po::value<unsigned short>()->default_value(9100), "set the port of the first load generator, the others taking the ports after it")
+        ("agent-id", po::value<int>()->default_value(100), "set the agent ID of the first load generator, the others taking the IDs after it")
+        ("connections", po::value<unsigned int>()->default_value(1), "set the number of connections to the exchange, each with its own load generator")
+        ("io-threads", po::value<unsigned int>()->default_value(2), "set the number of threads handling the load generators' network IO")
+        ("rates", po::value<std::string>()->default_value(std::string{"1000,2000,5000,10000,20000"}), "set the total orders per second of each stage, comma separated")
+        ("stage-time", po::value<double>()->default_value(10), "set the seconds orders are sent at each rate")
+        ("drain-time", po::value<double>()->default_value(1), "set the seconds after each stage that replies are still timed")
+        ("connect-timeout", po::value<int>()->default_value(60), "set the seconds to wait for the exchange to open trading")
+        ("arrival", po::value<std::string>()->default_value(std::string{"poisson"}), "set the arrival of orders: fixed or poisson")
+        ("mid-price", po::value<double>()->default_value(100), "set the price orders are spread around")
+        ("price-range", po::value<int>()->default_value(5), "set how far either side of the mid price orders are priced")
+        ("max-resting", po::value<int>()->default_value(100), "set the resting orders each load generator keeps before cancelling the oldest")
+        ("seed", po::value<unsigned int>()->default_value(0), "set the seed of the first load generator, 0 for random seeds")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "\n" << desc << std::endl;
+        exit(1);
+    }
+
+    LoadTestRunner::Options options;
+    options.exchange_name = vm["exchange-name"].as<std::string>();
+    options.exchange_addr = vm["exchange-addr"].as<std::string>();
+    options.ticker = vm["ticker"].as<std::string>();
+    options.addr = vm["addr"].as<std::string>();
+    options.port = vm["port"].as<unsigned short>();
+    options.first_agent_id = vm["agent-id"].as<int>();
+    options.connections = std::max(vm["connections"].as<unsigned int>(), 1u);
+    options.io_threads = vm["io-threads"].as<unsigned int>();
+    options.stage_time = vm["stage-time"].as<double>();
+    options.drain_time = vm["drain-time"].as<double>();
+    options.connect_timeout = vm["connect-timeout"].as<int>();
+    options.arrival = arrival_process_from_string(vm["arrival"].as<std::string>());
+    options.mid_price = vm["mid-price"].as<double>();
+    options.price_range = vm["price-range"].as<int>();
+    options.max_resting = vm["max-resting"].as<int>();
+    options.seed = vm["seed"].as<unsigned int>();
+
+    std::stringstream rates {vm["rates"].as<std::string>()};
+    std::string rate;
+    while (std::getline(rates, rate, ','))
+    {
+        if (!rate.empty()) options.rates.push_back(std::stod(rate));
+    }
+
+    LoadTestRunner runner {options};
+    if (!runner.run())
+    {
+        exit(1);
+    }
+}
+
 int main(int argc, char** argv)
 {
 
@@ -477,6 +849,26 @@ int main(int argc, char** argv)
     {
         orchestrator(argc, argv);
     }
+    else if (mode == "simulate")
+    {
+        simulate(argc, argv);
+    }
+    else if (mode == "sweep")
+    {
+        sweep(argc, argv);
+    }
+    else if (mode == "aggregate")
+    {
+        aggregate(argc, argv);
+    }
+    else if (mode == "replay")
+    {
+        replay(argc, argv);
+    }
+    else if (mode == "loadtest")
+    {
+        loadtest(argc, argv);
+    }
     else
     {
         node_runner(argc, argv);
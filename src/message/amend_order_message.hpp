@@ -0,0 +1,41 @@
+#ifndef AMEND_ORDER_MESSAGE_HPP
+#define AMEND_ORDER_MESSAGE_HPP
+
+#include "message.hpp"
+#include "messagetype.hpp"
+#include "../order/order.hpp"
+
+/** Changes the price and remaining quantity of a resting limit order in one step, keeping its order id.
+ *  The order keeps its time priority if only its quantity decreases. An amended order that crosses the spread
+ *  is matched like a new order. The exchange answers with an execution report of the amended order, 
+ *  or a cancel reject if the order is no longer resting. A quantity of zero cancels the order. */
+class AmendOrderMessage : public Message
+{
+public:
+
+    AmendOrderMessage() : Message(MessageType::AMEND_ORDER) {};
+
+    int order_id;
+    std::string ticker;
+    Order::Side side;
+    int quantity;  // New remaining quantity
+    double price;
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & order_id;
+        ar & ticker;
+        ar & side;
+        ar & quantity;
+        ar & price;
+    }
+};
+
+typedef std::shared_ptr<AmendOrderMessage> AmendOrderMessagePtr;
+
+#endif
\ No newline at end of file
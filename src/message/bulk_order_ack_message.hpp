@@ -0,0 +1,36 @@
+#ifndef BULK_ORDER_ACK_MESSAGE_HPP
+#define BULK_ORDER_ACK_MESSAGE_HPP
+
+#include <boost/serialization/shared_ptr.hpp>
+
+#include "message.hpp"
+#include "messagetype.hpp"
+#include "exec_report_message.hpp"
+
+/** The outcome of a BulkOrderMessage for its sender: every execution report the pass over it produced for the sender,
+ *  in the order they were produced, and the IDs of the cancelled orders that were not resting in the book.
+ *  Fills of the new orders after the pass are reported by separate execution reports, as for any resting order. */
+class BulkOrderAckMessage : public Message
+{
+public:
+
+    BulkOrderAckMessage() : Message(MessageType::BULK_ORDER_ACK) {};
+
+    std::vector<ExecutionReportMessagePtr> reports;
+    std::vector<int> rejected_cancels;
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & reports;
+        ar & rejected_cancels;
+    }
+};
+
+typedef std::shared_ptr<BulkOrderAckMessage> BulkOrderAckMessagePtr;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+#ifndef BULK_ORDER_MESSAGE_HPP
+#define BULK_ORDER_MESSAGE_HPP
+
+#include "message.hpp"
+#include "messagetype.hpp"
+#include "../order/order.hpp"
+
+/** New limit orders and cancels for one ticker, submitted together. The exchange handles the whole message in
+ *  one pass of the matching engine, cancels first, then amends and then new orders in the order given, with no other message
+ *  handled in between, and answers with a single BulkOrderAckMessage. */
+class BulkOrderMessage : public Message
+{
+public:
+
+    BulkOrderMessage() : Message(MessageType::BULK_ORDER) {};
+
+    /** A new limit order of the batch, for the ticker of the batch. */
+    struct NewOrder
+    {
+        int client_order_id;
+        Order::Side side;
+        Order::TimeInForce time_in_force;
+        int quantity;
+        double price;
+        double priv_value;
+
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & client_order_id;
+            ar & side;
+            ar & time_in_force;
+            ar & quantity;
+            ar & price;
+            ar & priv_value;
+        }
+    };
+
+    /** A cancel of a resting order of the ticker of the batch. */
+    struct Cancel
+    {
+        int order_id;
+        Order::Side side;
+
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & order_id;
+            ar & side;
+        }
+    };
+
+    /** An amend of a resting order of the ticker of the batch, as an AmendOrderMessage. */
+    struct Amend
+    {
+        int order_id;
+        Order::Side side;
+        int quantity;
+        double price;
+
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & order_id;
+            ar & side;
+            ar & quantity;
+            ar & price;
+        }
+    };
+
+    void addOrder(Order::Side side, int quantity, double price, double priv_value, 
+        Order::TimeInForce time_in_force = Order::TimeInForce::GTC, int client_order_id = 0)
+    {
+        orders.push_back({client_order_id, side, time_in_force, quantity, price, priv_value});
+    }
+
+    void addCancel(Order::Side side, int order_id)
+    {
+        cancels.push_back({order_id, side});
+    }
+
+    void addAmend(Order::Side side, int order_id, int quantity, double price)
+    {
+        amends.push_back({order_id, side, quantity, price});
+    }
+
+    std::string ticker;
+    std::vector<Cancel> cancels;
+    std::vector<Amend> amends;
+    std::vector<NewOrder> orders;
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & ticker;
+        ar & cancels;
+        ar & amends;
+        ar & orders;
+    }
+};
+
+typedef std::shared_ptr<BulkOrderMessage> BulkOrderMessagePtr;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef CLOCK_SYNC_MESSAGE_HPP
+#define CLOCK_SYNC_MESSAGE_HPP
+
+#include "message.hpp"
+#include "messagetype.hpp"
+
+/** A round trip of clock synchronisation with the exchange. The trader sends it with the time it was sent on its
+ *  system clock; the exchange sends it back with the time it was received on its own clock, and the time it is
+ *  answered as its sent timestamp. */
+class ClockSyncMessage : public Message
+{
+public:
+
+    ClockSyncMessage() : Message(MessageType::CLOCK_SYNC) {};
+
+    /** When the request was sent, on the trader's system clock (ns). */
+    long long origin = 0;
+
+    /** When the exchange received the request, on the exchange's clock (ns); zero in the request. */
+    long long receive = 0;
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & origin;
+        ar & receive;
+    }
+
+};
+
+typedef std::shared_ptr<ClockSyncMessage> ClockSyncMessagePtr;
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef COMPACT_MARKET_DATA_HPP
+#define COMPACT_MARKET_DATA_HPP
+
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "market_data_message.hpp"
+#include "symboldirectory.hpp"
+#include "../trade/marketdata.hpp"
+#include "../trade/marketdatafields.hpp"
+
+/** Fixed-layout binary encoding of market data updates, sent in place of the archive in the binary wire format.
+ *  The ticker travels as the symbol ID the exchange defined for it and prices as whole ticks, so a full update is 192 bytes
+ *  and one carrying only the top of the book 72. Fields are written in host byte order, as every node of a simulation runs
+ *  on the same architecture. Updates the encoding cannot represent exactly are sent as archives instead. */
+class CompactMarketData
+{
+public:
+
+    /** Marks a compact update, in place of the binary wire magic. */
+    static constexpr unsigned char MAGIC = 0xB2;
+    static constexpr unsigned char VERSION = 2;
+
+    static constexpr size_t HEADER_SIZE = 32;
+    static constexpr size_t TOP_SIZE = 40;
+    static constexpr size_t DEPTH_SIZE = 24;
+    static constexpr size_t TRADE_STATS_SIZE = 24;
+    static constexpr size_t ANALYTICS_SIZE = 56;
+    static constexpr size_t EQUILIBRIUM_SIZE = 16;
+    static constexpr size_t MAX_SIZE = HEADER_SIZE + TOP_SIZE + DEPTH_SIZE + TRADE_STATS_SIZE + ANALYTICS_SIZE + EQUILIBRIUM_SIZE;
+
+    /** Returns the encoded update, or nothing if its ticker has no symbol ID of its exchange
+     *  or one of its prices is not a whole number of ticks. */
+    static std::optional<std::string> encode(const MarketDataMessage& message)
+    {
+      const MarketData& data = *message.data;
+      std::optional<SymbolDirectory::Symbol> symbol = SymbolDirectory::instance().find(message.sender_id, data.ticker);
+      if (!symbol.has_value()) return std::nullopt;
+
+      char buffer[MAX_SIZE];
+      Writer writer {buffer, symbol->tick_size};
+      writer.put(MAGIC);
+      writer.put(VERSION);
+      writer.put(static_cast<uint8_t>(data.fields));
+      writer.put(uint8_t{0});
+      writer.put(symbol->id);
+      writer.put(uint16_t{0});
+      writer.put(static_cast<int32_t>(message.sender_id));
+      writer.put(static_cast<int32_t>(message.recipient_id));
+      writer.put(static_cast<uint64_t>(message.sequence));
+      writer.put(static_cast<uint64_t>(message.timestamp_sent));
+
+      writer.putPrice(data.best_bid);
+      writer.putPrice(data.best_ask);
+      writer.put(static_cast<int32_t>(data.best_bid_size));
+      writer.put(static_cast<int32_t>(data.best_ask_size));
+      writer.putPrice(data.last_price_traded);
+      writer.put(static_cast<int32_t>(data.last_quantity_traded));
+      writer.put(static_cast<int32_t>(data.cumulative_volume_traded));
+      writer.put(static_cast<int32_t>(data.trades_count));
+      writer.put(static_cast<uint64_t>(data.timestamp));
+
+      if (includes(data.fields, MarketDataFields::DEPTH))
+      {
+        writer.putPrice(data.worst_bid);
+        writer.putPrice(data.worst_ask);
+        writer.put(static_cast<int32_t>(data.bids_volume));
+        writer.put(static_cast<int32_t>(data.asks_volume));
+        writer.put(static_cast<int32_t>(data.bids_count));
+        writer.put(static_cast<int32_t>(data.asks_count));
+      }
+
+      if (includes(data.fields, MarketDataFields::TRADE_STATS))
+      {
+        writer.putPrice(data.high_price);
+        writer.putPrice(data.low_price);
+        writer.put(data.volume_per_tick);
+        writer.put(data.vwap);
+      }
+
+      // Derived from prices, so not on the tick grid
+      if (includes(data.fields, MarketDataFields::ANALYTICS))
+      {
+        writer.put(static_cast<uint64_t>(data.time_diff));
+        writer.put(data.mid_price);
+        writer.put(data.micro_price);
+        writer.put(data.imbalance);
+        writer.put(data.spread);
+        writer.put(data.limit_price);
+        writer.put(static_cast<int32_t>(data.side));
+        writer.put(int32_t{0});
+      }
+
+      if (includes(data.fields, MarketDataFields::EQUILIBRIUM))
+      {
+        writer.put(data.p_equilibrium);
+        writer.put(data.smiths_alpha);
+      }
+
+      if (!writer.exact) return std::nullopt;
+      return std::string{buffer, writer.size()};
+    };
+
+    /** Indicates whether the serialised message is a compact market data update. */
+    static bool isCompact(std::string_view serialised)
+    {
+      return !serialised.empty() && static_cast<unsigned char>(serialised.front()) == MAGIC;
+    };
+
+    /** Returns the market data update encoded in the given bytes. The message and its data share one allocation.
+     *  Throws if the update is truncated, of another version, or its symbol was not defined to this process. */
+    static MarketDataMessagePtr decode(std::string_view encoded)
+    {
+      if (encoded.size() < HEADER_SIZE + TOP_SIZE)
+      {
+        throw std::runtime_error("Compact market data update is truncated");
+      }
+
+      Reader reader {encoded.data()};
+      reader.skip(1);
+      unsigned int version = reader.get<uint8_t>();
+      if (version != VERSION)
+      {
+        throw std::runtime_error("Unsupported compact market data version " + std::to_string(version));
+      }
+      MarketDataFields fields = static_cast<MarketDataFields>(reader.get<uint8_t>());
+      reader.skip(1);
+      uint16_t symbol_id = reader.get<uint16_t>();
+      reader.skip(2);
+      int sender_id = reader.get<int32_t>();
+
+      if (encoded.size() != encodedSize(fields))
+      {
+        throw std::runtime_error("Compact market data update is " + std::to_string(encoded.size())
+          + " bytes, expected " + std::to_string(encodedSize(fields)) + " for fields " + to_string(fields));
+      }
+
+      std::optional<SymbolDirectory::Symbol> symbol = SymbolDirectory::instance().find(sender_id, symbol_id);
+      if (!symbol.has_value())
+      {
+        throw std::runtime_error("Compact market data for symbol " + std::to_string(symbol_id)
+          + " of agent " + std::to_string(sender_id) + " arrived before its definition");
+      }
+      reader.tick_size = symbol->tick_size;
+
+      std::shared_ptr<Decoded> decoded = std::make_shared<Decoded>();
+      MarketDataMessage& message = decoded->message;
+      MarketData& data = decoded->data;
+      message.data = MarketDataPtr{decoded, &data};
+
+      message.sender_id = sender_id;
+      message.recipient_id = reader.get<int32_t>();
+      message.sequence = reader.get<uint64_t>();
+      message.timestamp_sent = reader.get<uint64_t>();
+
+      data.fields = fields;
+      data.ticker = std::move(symbol->ticker);
+      data.best_bid = reader.getPrice();
+      data.best_ask = reader.getPrice();
+      data.best_bid_size = reader.get<int32_t>();
+      data.best_ask_size = reader.get<int32_t>();
+      data.last_price_traded = reader.getPrice();
+      data.last_quantity_traded = reader.get<int32_t>();
+      data.cumulative_volume_traded = reader.get<int32_t>();
+      data.trades_count = reader.get<int32_t>();
+      data.timestamp = reader.get<uint64_t>();
+
+      if (includes(fields, MarketDataFields::DEPTH))
+      {
+        data.worst_bid = reader.getPrice();
+        data.worst_ask = reader.getPrice();
+        data.bids_volume = reader.get<int32_t>();
+        data.asks_volume = reader.get<int32_t>();
+        data.bids_count = reader.get<int32_t>();
+        data.asks_count = reader.get<int32_t>();
+        data.total_volume = data.bids_volume + data.asks_volume;
+      }
+
+      if (includes(fields, MarketDataFields::TRADE_STATS))
+      {
+        data.high_price = reader.getPrice();
+        data.low_price = reader.getPrice();
+        data.volume_per_tick = reader.get<double>();
+        data.vwap = reader.get<double>();
+      }
+
+      if (includes(fields, MarketDataFields::ANALYTICS))
+      {
+        data.time_diff = reader.get<uint64_t>();
+        data.mid_price = reader.get<double>();
+        data.micro_price = reader.get<double>();
+        data.imbalance = reader.get<double>();
+        data.spread = reader.get<double>();
+        data.limit_price = reader.get<double>();
+        data.side = reader.get<int32_t>();
+        reader.skip(4);
+      }
+
+      if (includes(fields, MarketDataFields::EQUILIBRIUM))
+      {
+        data.p_equilibrium = reader.get<double>();
+        data.smiths_alpha = reader.get<double>();
+      }
+
+      return MarketDataMessagePtr{decoded, &message};
+    };
+
+    /** Returns the size of an update carrying the given groups of fields. */
+    static constexpr size_t encodedSize(MarketDataFields fields)
+    {
+      return HEADER_SIZE + TOP_SIZE
+        + (includes(fields, MarketDataFields::DEPTH) ? DEPTH_SIZE : 0)
+        + (includes(fields, MarketDataFields::TRADE_STATS) ? TRADE_STATS_SIZE : 0)
+        + (includes(fields, MarketDataFields::ANALYTICS) ? ANALYTICS_SIZE : 0)
+        + (includes(fields, MarketDataFields::EQUILIBRIUM) ? EQUILIBRIUM_SIZE : 0);
+    };
+
+private:
+
+    /** A decoded update and its data, allocated together. */
+    struct Decoded
+    {
+      MarketDataMessage message;
+      MarketData data;
+    };
+
+    struct Writer
+    {
+      char* out;
+      double tick_size;
+      bool exact = true; // every price written was a whole number of ticks
+      char* start = out;
+
+      template<class T>
+      void put(T value)
+      {
+        std::memcpy(out, &value, sizeof(T));
+        out += sizeof(T);
+      };
+
+      /** Writes the price in ticks, noting if it does not convert back to exactly the same price. */
+      void putPrice(double price)
+      {
+        double ticks = std::round(price / tick_size);
+        if (!(std::abs(ticks) <= INT32_MAX) || ticks * tick_size != price) exact = false;
+        put(exact ? static_cast<int32_t>(ticks) : int32_t{0});
+      };
+
+      size_t size() const
+      {
+        return static_cast<size_t>(out - start);
+      };
+    };
+
+    struct Reader
+    {
+      const char* in;
+      double tick_size = 1.0;
+
+      template<class T>
+      T get()
+      {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+      };
+
+      double getPrice()
+      {
+        return get<int32_t>() * tick_size;
+      };
+
+      void skip(size_t bytes)
+      {
+        in += bytes;
+      };
+    };
+};
+
+#endif
@@ -8,7 +8,10 @@ class ConfigAckMessage : public Message
 {
 public:
 
-    ConfigAckMessage() : Message(MessageType::CONFIG) {};
+    ConfigAckMessage() : Message(MessageType::CONFIG_ACK) {};
+
+    /** The ID of the agent the node was configured to host. */
+    int agent_id;
 
 private:
 
@@ -17,6 +20,7 @@ private:
     void serialize(Archive & ar, const unsigned int version)
     {
         ar & boost::serialization::base_object<Message>(*this);
+        ar & agent_id;
     }
 
 };
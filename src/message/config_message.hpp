@@ -23,6 +23,10 @@ public:
     /** Agent-specific configuration object. */
     AgentConfigPtr config;
 
+    /** Whether the node hosted agents of an earlier trial. The agent is created afresh in place of the one it replaces,
+     *  while the node keeps its connections and the models and caches loaded by its process. */
+    bool reset = false;
+
 private:
 
     friend class boost::serialization::access;
@@ -33,6 +37,7 @@ private:
         ar & my_addr;
         ar & agent_type;
         ar & config;
+        ar & reset;
     }
 
 };
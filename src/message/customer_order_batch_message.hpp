@@ -0,0 +1,75 @@
+#ifndef CUSTOMER_ORDER_BATCH_MESSAGE_HPP
+#define CUSTOMER_ORDER_BATCH_MESSAGE_HPP
+
+#include "message.hpp"
+#include "messagetype.hpp"
+#include "customer_order_message.hpp"
+#include "../order/order.hpp"
+
+/** Customer orders for the traders hosted by one node, sent together in a single broadcast.
+ *  The receiving node hands each order to its traders as a separate customer order message. */
+class CustomerOrderBatchMessage : public Message
+{
+public:
+
+    CustomerOrderBatchMessage() : Message(MessageType::CUSTOMER_ORDER_BATCH) {};
+
+    /** One order of the batch, for the ticker of the batch. */
+    struct Entry
+    {
+        int client_order_id;
+        Order::Side side;
+        int quantity;
+        double price;
+        double priv_value;
+
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & client_order_id;
+            ar & side;
+            ar & quantity;
+            ar & price;
+            ar & priv_value;
+        }
+    };
+
+    std::string ticker;
+    std::vector<Entry> orders;
+
+    /** Returns the customer order message for the entry at the given index, as sent by the sender of the batch. */
+    std::shared_ptr<CustomerOrderMessage> unpack(size_t index) const
+    {
+        std::shared_ptr<CustomerOrderMessage> msg = std::make_shared<CustomerOrderMessage>();
+        msg->sender_id = sender_id;
+        msg->recipient_id = recipient_id;
+        msg->agent_name = agent_name;
+        msg->timestamp_sent = timestamp_sent;
+        msg->timestamp_received = timestamp_received;
+        msg->timestamp_processed = timestamp_processed;
+
+        const Entry& entry = orders.at(index);
+        msg->client_order_id = entry.client_order_id;
+        msg->ticker = ticker;
+        msg->side = entry.side;
+        msg->quantity = entry.quantity;
+        msg->price = entry.price;
+        msg->priv_value = entry.priv_value;
+        return msg;
+    }
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & ticker;
+        ar & orders;
+    }
+};
+
+typedef std::shared_ptr<CustomerOrderBatchMessage> CustomerOrderBatchMessagePtr;
+
+#endif
\ No newline at end of file
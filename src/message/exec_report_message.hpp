@@ -12,20 +12,21 @@ public:
 
     ExecutionReportMessage() : Message(MessageType::EXECUTION_REPORT) {};
 
-    /** Creates an ExecutionReport message from a new or cancelled order. */
+    /** Creates an ExecutionReport message from a new or cancelled order. 
+     *  The report holds a copy of the order, so it is not changed by later matching while waiting to be sent. */
     static std::shared_ptr<ExecutionReportMessage> createFromOrder(OrderPtr order)
     {
         std::shared_ptr<ExecutionReportMessage> message = std::make_shared<ExecutionReportMessage>();
-        message->order = order;
+        message->order = order->clone();
         message->trade = nullptr;
         return message;
     };
 
-    /** Creates an ExecutionReport message from the state of a post-trade order and the trade object. */
+    /** Creates an ExecutionReport message from a copy of the state of a post-trade order and the trade object. */
     static std::shared_ptr<ExecutionReportMessage> createFromTrade(OrderPtr order, TradePtr trade)
     {
         std::shared_ptr<ExecutionReportMessage> message = std::make_shared<ExecutionReportMessage>();
-        message->order = order;
+        message->order = order->clone();
         message->trade = trade;
         return message;
     };
@@ -0,0 +1,65 @@
+#ifndef MARKET_DATA_DELTA_MESSAGE_HPP
+#define MARKET_DATA_DELTA_MESSAGE_HPP
+
+#include <boost/serialization/utility.hpp>
+
+#include "message.hpp"
+#include "messagetype.hpp"
+#include "../trade/marketdata.hpp"
+
+/** An incremental market data update carrying only the fields changed since the previous update of the ticker. */
+class MarketDataDeltaMessage : public Message
+{
+public:
+
+    MarketDataDeltaMessage() : Message(MessageType::MARKET_DATA_DELTA) {};
+
+    /** Creates a delta message holding the fields of current that differ from previous. */
+    static std::shared_ptr<MarketDataDeltaMessage> createFromChange(const MarketData& previous, const MarketData& current, unsigned long sequence)
+    {
+        std::shared_ptr<MarketDataDeltaMessage> message = std::make_shared<MarketDataDeltaMessage>();
+        message->ticker = current.ticker;
+        message->sequence = sequence;
+
+        std::array<double, MarketData::FIELD_COUNT> previous_values = previous.values();
+        std::array<double, MarketData::FIELD_COUNT> current_values = current.values();
+        for (size_t i = 0; i < MarketData::FIELD_COUNT; ++i)
+        {
+            if (previous_values[i] != current_values[i])
+            {
+                message->changes.push_back({static_cast<int>(i), current_values[i]});
+            }
+        }
+        return message;
+    };
+
+    /** Applies the changed fields to the given market data. */
+    void applyTo(MarketData& data) const
+    {
+        for (auto const& [field_index, value] : changes)
+        {
+            data.setValue(field_index, value);
+        }
+    };
+
+    std::string ticker;
+    unsigned long sequence;
+    std::vector<std::pair<int, double>> changes;
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & ticker;
+        ar & sequence;
+        ar & changes;
+    }
+
+};
+
+typedef std::shared_ptr<MarketDataDeltaMessage> MarketDataDeltaMessagePtr;
+
+#endif
\ No newline at end of file
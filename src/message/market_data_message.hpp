@@ -14,6 +14,9 @@ public:
 
     MarketDataPtr data;
 
+    /** Position of this update in the market data feed of the ticker. */
+    unsigned long sequence = 0;
+
 private:
 
     friend class boost::serialization::access;
@@ -22,6 +25,7 @@ private:
     {
         ar & boost::serialization::base_object<Message>(*this);
         ar & data;
+        ar & sequence;
     }
 
 };
@@ -0,0 +1,35 @@
+#ifndef MARKET_DATA_REQUEST_MESSAGE_HPP
+#define MARKET_DATA_REQUEST_MESSAGE_HPP
+
+#include "message.hpp"
+#include "messagetype.hpp"
+
+/** Asks the exchange to resend the latest market data of the ticker as a full snapshot over TCP, 
+ *  after a subscriber detected a gap in the sequenced UDP feed. */
+class MarketDataRequestMessage : public Message
+{
+public:
+
+    MarketDataRequestMessage() : Message(MessageType::MARKET_DATA_REQUEST) {};
+
+    std::string ticker;
+
+    /** The last sequence number the subscriber applied, 0 if it has none. */
+    unsigned long last_sequence = 0;
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & ticker;
+        ar & last_sequence;
+    }
+
+};
+
+typedef std::shared_ptr<MarketDataRequestMessage> MarketDataRequestMessagePtr;
+
+#endif
\ No newline at end of file
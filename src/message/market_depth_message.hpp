@@ -0,0 +1,30 @@
+#ifndef MARKET_DEPTH_MESSAGE_HPP
+#define MARKET_DEPTH_MESSAGE_HPP
+
+#include "message.hpp"
+#include "messagetype.hpp"
+#include "../trade/marketdepth.hpp"
+
+class MarketDepthMessage : public Message
+{
+public:
+
+    MarketDepthMessage() : Message(MessageType::MARKET_DEPTH) {};
+
+    MarketDepthPtr depth;
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & depth;
+    }
+
+};
+
+typedef std::shared_ptr<MarketDepthMessage> MarketDepthMessagePtr;
+
+#endif
\ No newline at end of file
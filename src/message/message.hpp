@@ -2,8 +2,11 @@
 #define MESSAGE_HPP
 
 #include <chrono>
+#include <cstdint>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
 #include <boost/serialization/string.hpp>
 #include <boost/serialization/unordered_map.hpp>
 #include <boost/serialization/vector.hpp>
@@ -11,6 +14,7 @@
 
 #include "messagetype.hpp"
 #include "../utilities/csvprintable.hpp"
+#include "../utilities/simulationclock.hpp"
 
 /** A message that can be sent between network entities. */
 class Message : std::enable_shared_from_this<Message>, public CSVPrintable 
@@ -24,11 +28,11 @@ public:
 
     virtual ~Message() = default;
 
-    /** Returns the size of the serialized messaged in bytes. */
+    /** Returns the size of the serialized messaged in bytes, in the binary wire format. */
     size_t getSerializedSize()
     {
         std::ostringstream oss;
-        boost::archive::text_oarchive oa{oss};
+        boost::archive::binary_oarchive oa{oss, boost::archive::no_header};
         oa << *this;
         return oss.str().size();
     }
@@ -37,40 +41,42 @@ public:
     void markSent(int sender_id)
     {
         this->sender_id = sender_id;
-        std::chrono::system_clock::duration now = std::chrono::system_clock::now().time_since_epoch();
-        timestamp_sent = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+        timestamp_sent = SimulationClock::nowNanos();
     }
 
     /** Marks the given message as received and adds timestamp. */
     void markReceived()
     {
-        std::chrono::system_clock::duration now = std::chrono::system_clock::now().time_since_epoch();
-        timestamp_received = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+        timestamp_received = SimulationClock::nowNanos();
     }
 
     /** Marks the given message as processed and adds timestamp. */
     void markProcessed()
     {
-        std::chrono::system_clock::duration now = std::chrono::system_clock::now().time_since_epoch();
-        timestamp_processed = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+        timestamp_processed = SimulationClock::nowNanos();
     }
 
-    std::string describeCSVHeaders() const override
+    static constexpr std::string_view CSV_HEADERS = "sender_id,agent_name,timestamp_sent,timestamp_received,timestamp_processed";
+
+    std::string_view csvHeaders() const override
     {
-        return "sender_id,agent_name,timestamp_sent,timestamp_received,timestamp_processed";
+        return CSV_HEADERS;
     }
 
-    std::string toCSV() const override
+    void appendCSV(std::string& row) const override
     {
-        return std::to_string(sender_id) + ","  + agent_name + "," + std::to_string(timestamp_sent) + "," + std::to_string(timestamp_received) + "," + std::to_string(timestamp_processed);
+        csv::appendFields(row, ",", sender_id, agent_name, timestamp_sent, timestamp_received, timestamp_processed);
     }
 
     MessageType type;
     int sender_id;
+    int recipient_id = -1; // The agent the message is for, among several hosted by one node, or -1 for any
     std::string agent_name; 
     unsigned long long timestamp_sent;
     unsigned long long timestamp_received;
     unsigned long long timestamp_processed;
+    uint64_t trace_enqueued = 0; // Tracer ticks when queued for the matching engine while tracing; not sent
+    uint16_t symbol = 0; // Symbol ID of the ticker of an order message, given by the exchange routing it to its matching engine; not sent
 
 private:
 
@@ -81,6 +87,7 @@ private:
         ar & boost::serialization::base_object<CSVPrintable>(*this);
         ar & type;
         ar & sender_id;
+        ar & recipient_id;
         ar & agent_name;
         ar & timestamp_sent;
         ar & timestamp_received;
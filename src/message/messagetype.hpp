@@ -1,6 +1,8 @@
 #ifndef MESSAGE_TYPE_HPP
 #define MESSAGE_TYPE_HPP
 
+#include <string>
+
 enum class MessageType : int
 {
     INIT,
@@ -19,6 +21,55 @@ enum class MessageType : int
     TRADER_LIST_RESPONSE, 
     REQUEST_TRADER_LIST, 
     TECHNICAL_AGENTS_STARTED, 
+    MARKET_DEPTH,
+    MARKET_DATA_DELTA,
+    MULTICAST_GROUP,
+    MARKET_DATA_REQUEST,
+    CUSTOMER_ORDER_BATCH,
+    BULK_ORDER,
+    BULK_ORDER_ACK,
+    AMEND_ORDER,
+    CONFIG_ACK,
+    PROFIT_REPORT,
+    CLOCK_SYNC,
+    SYMBOL_DEFINITION,
+    SHARED_MEMORY_FEED,
 };
 
+inline std::string to_string(MessageType type)
+{
+    switch (type) {
+        case MessageType::INIT: return std::string{"init"};
+        case MessageType::CONFIG: return std::string{"config"};
+        case MessageType::EVENT: return std::string{"event"};
+        case MessageType::MARKET_DATA: return std::string{"market-data"};
+        case MessageType::SUBSCRIBE: return std::string{"subscribe"};
+        case MessageType::LIMIT_ORDER: return std::string{"limit-order"};
+        case MessageType::MARKET_ORDER: return std::string{"market-order"};
+        case MessageType::CANCEL_ORDER: return std::string{"cancel-order"};
+        case MessageType::EXECUTION_REPORT: return std::string{"execution-report"};
+        case MessageType::CANCEL_REJECT: return std::string{"cancel-reject"};
+        case MessageType::PROFIT: return std::string{"profit"};
+        case MessageType::TRADER_CONFIG: return std::string{"trader-config"};
+        case MessageType::CUSTOMER_ORDER: return std::string{"customer-order"};
+        case MessageType::TRADER_LIST_RESPONSE: return std::string{"trader-list-response"};
+        case MessageType::REQUEST_TRADER_LIST: return std::string{"request-trader-list"};
+        case MessageType::TECHNICAL_AGENTS_STARTED: return std::string{"technical-agents-started"};
+        case MessageType::MARKET_DEPTH: return std::string{"market-depth"};
+        case MessageType::MARKET_DATA_DELTA: return std::string{"market-data-delta"};
+        case MessageType::MULTICAST_GROUP: return std::string{"multicast-group"};
+        case MessageType::MARKET_DATA_REQUEST: return std::string{"market-data-request"};
+        case MessageType::CUSTOMER_ORDER_BATCH: return std::string{"customer-order-batch"};
+        case MessageType::BULK_ORDER: return std::string{"bulk-order"};
+        case MessageType::BULK_ORDER_ACK: return std::string{"bulk-order-ack"};
+        case MessageType::AMEND_ORDER: return std::string{"amend-order"};
+        case MessageType::CONFIG_ACK: return std::string{"config-ack"};
+        case MessageType::PROFIT_REPORT: return std::string{"profit-report"};
+        case MessageType::CLOCK_SYNC: return std::string{"clock-sync"};
+        case MessageType::SYMBOL_DEFINITION: return std::string{"symbol-definition"};
+        case MessageType::SHARED_MEMORY_FEED: return std::string{"shared-memory-feed"};
+        default: return std::string{""};
+    }
+}
+
 #endif
\ No newline at end of file
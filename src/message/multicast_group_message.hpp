@@ -0,0 +1,32 @@
+#ifndef MULTICAST_GROUP_MESSAGE_HPP
+#define MULTICAST_GROUP_MESSAGE_HPP
+
+#include "message.hpp"
+#include "messagetype.hpp"
+
+/** Tells a subscriber to receive the market data of the ticker by joining the given multicast group. */
+class MulticastGroupMessage : public Message
+{
+public:
+
+    MulticastGroupMessage() : Message(MessageType::MULTICAST_GROUP) {};
+
+    std::string ticker;
+    std::string group_address;
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & ticker;
+        ar & group_address;
+    }
+
+};
+
+typedef std::shared_ptr<MulticastGroupMessage> MulticastGroupMessagePtr;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef PROFIT_REPORT_MESSAGE_HPP
+#define PROFIT_REPORT_MESSAGE_HPP
+
+#include "message.hpp"
+#include "../trade/profitledger.hpp"
+
+/** Snapshot of the profits of the agents trading at an exchange, streamed to the orchestrator during the session. */
+class ProfitReportMessage : public Message
+{
+public:
+
+    ProfitReportMessage() : Message(MessageType::PROFIT_REPORT) {};
+
+    /** The ID the accounts are indexed from. */
+    int first_agent_id = 0;
+
+    ProfitLedger::Accounts accounts;
+
+    /** Whether the session has ended, so that the profits are final. */
+    bool final = false;
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & first_agent_id;
+        ar & accounts;
+        ar & final;
+    }
+
+};
+
+typedef std::shared_ptr<ProfitReportMessage> ProfitReportMessagePtr;
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef SHARED_MEMORY_FEED_MESSAGE_HPP
+#define SHARED_MEMORY_FEED_MESSAGE_HPP
+
+#include <cstdint>
+
+#include "message.hpp"
+#include "messagetype.hpp"
+
+/** Tells a subscriber on the exchange's host to read the market data of the ticker from the given shared memory ring,
+ *  instead of being sent it. The subscriber subscribes again without its host if it cannot open the ring. */
+class SharedMemoryFeedMessage : public Message
+{
+public:
+
+    SharedMemoryFeedMessage() : Message(MessageType::SHARED_MEMORY_FEED) {};
+
+    std::string ticker;
+    std::string path;
+    uint64_t token = 0; // of the ring, to check the one opened is the exchange's
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & ticker;
+        ar & path;
+        ar & token;
+    }
+
+};
+
+typedef std::shared_ptr<SharedMemoryFeedMessage> SharedMemoryFeedMessagePtr;
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "message.hpp"
 #include "messagetype.hpp"
+#include "../trade/marketdatafields.hpp"
 
 class SubscribeMessage : public Message
 {
@@ -13,6 +14,18 @@ public:
     std::string ticker;
     std::string address;
 
+    /** Maximum number of market data updates per second the subscriber wants to receive, 0 for every update. */
+    unsigned int max_update_rate = 0;
+
+    /** Whether the subscriber can receive market data by joining a multicast group. */
+    bool multicast = false;
+
+    /** Identifier of the subscriber's host if it can read market data from shared memory there, empty if it cannot. */
+    std::string host;
+
+    /** Groups of market data fields the subscriber uses, beyond the top of the book, which are all the exchange need compute and send. */
+    MarketDataFields fields = MarketDataFields::ALL;
+
 private:
 
     friend class boost::serialization::access;
@@ -22,6 +35,10 @@ private:
         ar & boost::serialization::base_object<Message>(*this);
         ar & ticker;
         ar & address;
+        ar & max_update_rate;
+        ar & multicast;
+        ar & fields;
+        ar & host;
     }
 
 };
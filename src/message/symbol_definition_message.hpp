@@ -0,0 +1,37 @@
+#ifndef SYMBOL_DEFINITION_MESSAGE_HPP
+#define SYMBOL_DEFINITION_MESSAGE_HPP
+
+#include <cstdint>
+
+#include "message.hpp"
+#include "messagetype.hpp"
+
+/** Sent by the exchange to a subscriber before its market data: the symbol ID and tick size that identify the ticker
+ *  and scale its prices in the exchange's compact market data updates. */
+class SymbolDefinitionMessage : public Message
+{
+public:
+
+    SymbolDefinitionMessage() : Message(MessageType::SYMBOL_DEFINITION) {};
+
+    std::string ticker;
+    uint16_t symbol = 0;
+    double tick_size = 0;
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & boost::serialization::base_object<Message>(*this);
+        ar & ticker;
+        ar & symbol;
+        ar & tick_size;
+    }
+
+};
+
+typedef std::shared_ptr<SymbolDefinitionMessage> SymbolDefinitionMessagePtr;
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef SYMBOL_DIRECTORY_HPP
+#define SYMBOL_DIRECTORY_HPP
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/** Process-wide directory of the symbol IDs exchanges give their tickers in compact market data updates.
+ *  Exchanges define their own tickers; traders learn them from the exchange's symbol definitions. Safe from any thread. */
+class SymbolDirectory
+{
+public:
+
+    /** A ticker of an exchange with its symbol ID and tick size. */
+    struct Symbol
+    {
+        std::string ticker;
+        uint16_t id = 0;
+        double tick_size = 0;
+    };
+
+    /** Returns the process-wide directory. */
+    static SymbolDirectory& instance()
+    {
+      static SymbolDirectory directory;
+      return directory;
+    };
+
+    SymbolDirectory(const SymbolDirectory&) = delete;
+    SymbolDirectory& operator=(const SymbolDirectory&) = delete;
+
+    /** Gives the ticker of the exchange with the given agent ID the next free symbol ID of the exchange,
+     *  or updates the tick size of the ticker already defined, and returns the symbol. */
+    Symbol define(int exchange_id, const std::string& ticker, double tick_size)
+    {
+      std::unique_lock<std::shared_mutex> lock(mutex_);
+      auto existing = by_ticker_.find({exchange_id, ticker});
+      uint16_t id = (existing != by_ticker_.end()) ? existing->second : static_cast<uint16_t>(++next_id_[exchange_id]);
+      Symbol symbol {ticker, id, tick_size};
+      by_ticker_.insert_or_assign({exchange_id, ticker}, id);
+      by_id_.insert_or_assign(key(exchange_id, id), symbol);
+      return symbol;
+    };
+
+    /** Records a symbol the exchange with the given agent ID defined, as a trader learns it. */
+    void learn(int exchange_id, const Symbol& symbol)
+    {
+      std::unique_lock<std::shared_mutex> lock(mutex_);
+      by_ticker_.insert_or_assign({exchange_id, symbol.ticker}, symbol.id);
+      by_id_.insert_or_assign(key(exchange_id, symbol.id), symbol);
+    };
+
+    /** Returns the symbol of the exchange's ticker, or nothing if it is not defined. */
+    std::optional<Symbol> find(int exchange_id, const std::string& ticker) const
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex_);
+      auto id = by_ticker_.find({exchange_id, ticker});
+      if (id == by_ticker_.end()) return std::nullopt;
+      return by_id_.at(key(exchange_id, id->second));
+    };
+
+    /** Returns the symbol the exchange gave the given ID, or nothing if it is not known. */
+    std::optional<Symbol> find(int exchange_id, uint16_t id) const
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex_);
+      auto symbol = by_id_.find(key(exchange_id, id));
+      if (symbol == by_id_.end()) return std::nullopt;
+      return symbol->second;
+    };
+
+private:
+
+    SymbolDirectory() = default;
+
+    static uint64_t key(int exchange_id, uint16_t id)
+    {
+      return (static_cast<uint64_t>(static_cast<uint32_t>(exchange_id)) << 16) | id;
+    };
+
+    mutable std::shared_mutex mutex_;
+    std::map<std::pair<int, std::string>, uint16_t> by_ticker_;
+    std::unordered_map<uint64_t, Symbol> by_id_;
+    std::unordered_map<int, uint32_t> next_id_;
+};
+
+#endif
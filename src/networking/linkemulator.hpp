@@ -0,0 +1,270 @@
+#ifndef LINK_EMULATOR_HPP
+#define LINK_EMULATOR_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/asio.hpp>
+
+#include "../config/linkprofile.hpp"
+#include "../utilities/simulationclock.hpp"
+#include "../utilities/simulationtimer.hpp"
+
+namespace asio = boost::asio;
+
+/** Emulates wide area network links to peers. A message sent to or received from a peer with a link profile
+ *  is held for the link's delay and jitter, plus the time to transmit it and those queued before it at the link's bandwidth,
+ *  and then handed on by a timer, so no thread blocks on it. Messages over TCP arrive in the order sent, and lost ones
+ *  are retransmitted after a timeout; broadcasts may overtake each other, and lost ones are dropped. Safe from any thread. */
+class LinkEmulator
+{
+public:
+
+    enum class Direction : int
+    {
+        OUT,  // Sent to the peer
+        IN    // Received from the peer
+    };
+
+    /** How long a lost message over TCP waits to be retransmitted: the minimum retransmission timeout of Linux. */
+    static constexpr std::chrono::milliseconds RETRANSMIT_TIMEOUT {200};
+
+    explicit LinkEmulator(asio::io_context& io_context)
+    : io_context_{io_context}
+    {
+    };
+
+    LinkEmulator(const LinkEmulator&) = delete;
+    LinkEmulator& operator=(const LinkEmulator&) = delete;
+
+    /** Emulates the given link to the peer at the given address, replacing the link already emulated to it.
+     *  Messages already in flight on the link arrive as they were scheduled. */
+    void setProfile(const std::string& address, const LinkProfile& profile)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto link = links_.find(address);
+      if (link == links_.end())
+      {
+        if (!profile.emulated()) return;
+        link = links_.emplace(address, std::make_unique<Link>(io_context_)).first;
+      }
+      for (Channel* channel : {&link->second->out, &link->second->in})
+      {
+        std::lock_guard<std::mutex> channel_lock(channel->mutex);
+        channel->profile = profile;
+      }
+      active_.store(true, std::memory_order_release);
+    };
+
+    /** Indicates whether any link is emulated. */
+    bool active() const
+    {
+      return active_.load(std::memory_order_acquire);
+    };
+
+    /** Hands a message over the link to or from the peer at the given address, calling deliver once it has crossed,
+     *  unless it is lost. Measure returns the size of the message in bytes, and is only called if the link's bandwidth is capped.
+     *  Returns false, without calling deliver, if no link to the peer is emulated, for the caller to carry on directly. */
+    bool delay(const std::string& address, Direction direction, bool reliable,
+      const std::function<size_t()>& measure, std::function<void()> deliver)
+    {
+      if (!active()) return false;
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto link = links_.find(address);
+      if (link == links_.end()) return false;
+      Channel& channel = (direction == Direction::OUT) ? link->second->out : link->second->in;
+      lock.unlock();
+
+      transmit(channel, reliable, measure, std::move(deliver));
+      return true;
+    };
+
+    /** Appends the messages each emulated link delayed and lost, by peer and direction. */
+    void appendPrometheus(std::string& out)
+    {
+      if (!active()) return;
+
+      std::string delayed = "# TYPE dsxe_link_delayed_total counter\n";
+      std::string lost = "# TYPE dsxe_link_lost_total counter\n";
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto const& [address, link] : links_)
+      {
+        for (Channel* channel : {&link->out, &link->in})
+        {
+          std::lock_guard<std::mutex> channel_lock(channel->mutex);
+          std::string labels = "{peer=\"" + address + "\",direction=\"" + (channel == &link->out ? "out" : "in") + "\"} ";
+          delayed += "dsxe_link_delayed_total" + labels + std::to_string(channel->delayed) + "\n";
+          lost += "dsxe_link_lost_total" + labels + std::to_string(channel->lost) + "\n";
+        }
+      }
+      out += delayed;
+      out += lost;
+    };
+
+private:
+
+    /** One direction of a link. Its timer runs on a strand of its own, so that messages due together are handed on in order. */
+    struct Channel
+    {
+      explicit Channel(asio::io_context& io_context)
+      : strand{asio::make_strand(io_context)},
+        timer{strand}
+      {
+      };
+
+      std::mutex mutex;
+      LinkProfile profile;
+      std::mt19937 random {SimulationClock::randomSeed()};
+      SimulationClock::duration free_at {}; // when the link has transmitted every message sent so far
+      SimulationClock::duration last_arrival {}; // of the latest message over TCP, which later ones may not overtake
+      std::multimap<SimulationClock::duration, std::function<void()>> in_flight; // by arrival, in the order sent when equal
+      std::optional<SimulationClock::duration> armed; // the arrival the timer waits for
+      uint64_t delayed = 0;
+      uint64_t lost = 0;
+
+      asio::strand<asio::io_context::executor_type> strand;
+      SimulationTimer timer;
+    };
+
+    /** Links are kept until the emulator is destroyed, as their timers' handlers refer to them. */
+    struct Link
+    {
+      explicit Link(asio::io_context& io_context)
+      : out{io_context},
+        in{io_context}
+      {
+      };
+
+      Channel out;
+      Channel in;
+    };
+
+    /** Schedules the message's arrival: after the messages queued before it have been transmitted,
+     *  its own transmission and the delay of the link, and the timeouts of any retransmissions. */
+    void transmit(Channel& channel, bool reliable, const std::function<size_t()>& measure, std::function<void()> deliver)
+    {
+      std::lock_guard<std::mutex> lock(channel.mutex);
+      const LinkProfile& profile = channel.profile;
+      SimulationClock::duration now = SimulationClock::now();
+
+      SimulationClock::duration departure = now;
+      if (profile.bandwidth > 0)
+      {
+        double seconds = static_cast<double>(measure()) * 8.0 / (profile.bandwidth * 1e6);
+        departure = std::max(now, channel.free_at) + toDuration(seconds * 1e3);
+        channel.free_at = departure;
+      }
+
+      SimulationClock::duration arrival = departure + propagation(channel);
+      if (profile.loss > 0)
+      {
+        std::bernoulli_distribution lose {profile.loss};
+        if (!reliable && lose(channel.random))
+        {
+          ++channel.lost;
+          return;
+        }
+        while (reliable && lose(channel.random))
+        {
+          ++channel.lost;
+          arrival += RETRANSMIT_TIMEOUT;
+        }
+      }
+
+      if (reliable)
+      {
+        arrival = std::max(arrival, channel.last_arrival);
+        channel.last_arrival = arrival;
+      }
+
+      ++channel.delayed;
+      channel.in_flight.emplace(arrival, std::move(deliver));
+      if (!channel.armed.has_value() || arrival < channel.armed.value())
+      {
+        arm(channel, now);
+      }
+    };
+
+    /** Returns the link's delay with jitter drawn from its distribution, never negative. */
+    static SimulationClock::duration propagation(Channel& channel)
+    {
+      const LinkProfile& profile = channel.profile;
+      double delay = profile.delay;
+      if (profile.jitter > 0)
+      {
+        switch (profile.distribution)
+        {
+          case DelayDistribution::UNIFORM:
+            delay += std::uniform_real_distribution<double>{-profile.jitter, profile.jitter}(channel.random);
+            break;
+          case DelayDistribution::NORMAL:
+            delay += std::normal_distribution<double>{0.0, profile.jitter}(channel.random);
+            break;
+          case DelayDistribution::EXPONENTIAL:
+            delay += std::exponential_distribution<double>{1.0 / profile.jitter}(channel.random);
+            break;
+          default:
+            break;
+        }
+      }
+      return toDuration(std::max(delay, 0.0));
+    };
+
+    /** Sets the channel's timer for its earliest arrival. The channel's mutex must be held. */
+    void arm(Channel& channel, SimulationClock::duration now)
+    {
+      SimulationClock::duration next = channel.in_flight.begin()->first;
+      channel.armed = next;
+      channel.timer.expires_after(std::max(next - now, SimulationClock::duration::zero()));
+      channel.timer.async_wait([this, &channel](const boost::system::error_code& error) {
+        if (!error) deliverDue(channel);
+      });
+    };
+
+    /** Hands on every message that has arrived, in the order of arrival, then waits for the next. */
+    void deliverDue(Channel& channel)
+    {
+      std::vector<std::function<void()>> due;
+      {
+        std::lock_guard<std::mutex> lock(channel.mutex);
+        SimulationClock::duration now = SimulationClock::now();
+        auto end = channel.in_flight.upper_bound(now);
+        for (auto it = channel.in_flight.begin(); it != end; ++it)
+        {
+          due.push_back(std::move(it->second));
+        }
+        channel.in_flight.erase(channel.in_flight.begin(), end);
+        channel.armed.reset();
+        if (!channel.in_flight.empty()) arm(channel, now);
+      }
+
+      for (std::function<void()> const& deliver : due)
+      {
+        deliver();
+      }
+    };
+
+    static SimulationClock::duration toDuration(double milliseconds)
+    {
+      return std::chrono::duration_cast<SimulationClock::duration>(std::chrono::duration<double, std::milli>(milliseconds));
+    };
+
+    asio::io_context& io_context_;
+    std::atomic<bool> active_ = false;
+
+    /** The links emulated, by the address of the peer. */
+    std::unordered_map<std::string, std::unique_ptr<Link>> links_;
+    std::mutex mutex_;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef LOCAL_TRANSPORT_HPP
+#define LOCAL_TRANSPORT_HPP
+
+#include <algorithm>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class NetworkEntity;
+
+/** The NetworkEntities listening in this process by address, so that agents sharing a process
+ *  hand messages to each other directly instead of through the sockets. */
+class LocalTransport
+{
+public:
+
+    LocalTransport(const LocalTransport&) = delete;
+    LocalTransport& operator=(const LocalTransport&) = delete;
+
+    static LocalTransport& instance()
+    {
+        static LocalTransport transport;
+        return transport;
+    }
+
+    /** Makes the NetworkEntity reachable in process at the given IPv4 address. */
+    void add(std::string_view address, NetworkEntity* entity)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        entities_.insert_or_assign(std::string{address}, entity);
+    }
+
+    /** Removes every address of the NetworkEntity. */
+    void remove(NetworkEntity* entity)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        std::erase_if(entities_, [entity](auto const& entry) { return entry.second == entity; });
+    }
+
+    /** Returns the NetworkEntity listening at the given IPv4 address in this process, or null ptr if there is none. */
+    NetworkEntity* find(std::string_view address)
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (entities_.empty()) return nullptr;
+
+        auto it = entities_.find(std::string{address});
+        return (it != entities_.end()) ? it->second : nullptr;
+    }
+
+private:
+
+    LocalTransport() = default;
+
+    std::unordered_map<std::string, NetworkEntity*> entities_;
+    std::shared_mutex mutex_;
+};
+
+#endif
\ No newline at end of file
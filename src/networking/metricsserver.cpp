@@ -0,0 +1,42 @@
+#include "metricsserver.hpp"
+#include "../utilities/logger.hpp"
+
+asio::awaitable<void> MetricsServer::start()
+{
+    auto executor = co_await asio::this_coro::executor;
+    tcp::acceptor acceptor(executor, {tcp::v4(), port_});
+    LOG_INFO("Serving metrics on port " << port_ << "...");
+
+    while (true)
+    {
+        tcp::socket socket = co_await acceptor.async_accept(asio::make_strand(io_context_), asio::use_awaitable);
+        asio::co_spawn(socket.get_executor(), handleRequest(std::move(socket)), asio::detached);
+    }
+}
+
+asio::awaitable<void> MetricsServer::handleRequest(tcp::socket socket)
+{
+    try {
+        std::string request;
+        co_await asio::async_read_until(socket, asio::dynamic_buffer(request, MAX_REQUEST_SIZE), "\r\n\r\n", asio::use_awaitable);
+
+        // Only the request line matters: the method and path
+        std::string request_line = request.substr(0, request.find("\r\n"));
+        bool found = request_line.starts_with("GET /metrics ") || request_line.starts_with("GET / ");
+
+        std::string body = found ? render_() : std::string{"Not found\n"};
+        std::string response = std::string{found ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n"}
+            + "Content-Type: text/plain; version=0.0.4\r\n"
+            + "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            + "Connection: close\r\n\r\n"
+            + body;
+        co_await asio::async_write(socket, asio::buffer(response), asio::use_awaitable);
+
+        boost::system::error_code ec;
+        socket.shutdown(tcp::socket::shutdown_both, ec);
+    }
+    catch (std::exception& e)
+    {
+        LOG_DEBUG("Metrics request failed: " << e.what());
+    }
+}
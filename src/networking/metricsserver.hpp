@@ -0,0 +1,42 @@
+#ifndef METRICS_SERVER_HPP
+#define METRICS_SERVER_HPP
+
+#include <functional>
+#include <string>
+#include <boost/asio.hpp>
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+
+/** A minimal HTTP server answering GET /metrics with the text rendered on each request,
+ *  in the Prometheus text exposition format, so that running nodes can be scraped or polled with curl. */
+class MetricsServer
+{
+public:
+
+    MetricsServer() = delete;
+
+    MetricsServer(asio::io_context& io_context, unsigned short port, std::function<std::string()> render)
+    : io_context_(io_context),
+      port_{port},
+      render_{std::move(render)}
+    {
+    }
+
+    /** Listens for scrapes on the port, one request per connection. */
+    asio::awaitable<void> start();
+
+private:
+
+    /** Answers the request of a single connection and closes it. */
+    asio::awaitable<void> handleRequest(tcp::socket socket);
+
+    /** Requests with longer headers are refused. */
+    static constexpr size_t MAX_REQUEST_SIZE = 8 * 1024;
+
+    asio::io_context& io_context_;
+    const unsigned short port_;
+    std::function<std::string()> render_;
+};
+
+#endif
@@ -1,5 +1,11 @@
+#include <thread>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
 #include <boost/serialization/export.hpp>
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/optional.hpp>
@@ -20,13 +26,30 @@
 #include "../message/config_message.hpp"
 #include "../message/config_ack_message.hpp"
 #include "../message/profitmessage.hpp"
+#include "../message/profit_report_message.hpp"
 #include "../message/customer_order_message.hpp"
 #include "../message/request_trader_list_message.hpp"
 #include "../message/trader_list_message.hpp"
+#include "../message/market_depth_message.hpp"
+#include "../message/market_data_delta_message.hpp"
+#include "../message/multicast_group_message.hpp"
+#include "../message/market_data_request_message.hpp"
+#include "../message/customer_order_batch_message.hpp"
+#include "../message/bulk_order_message.hpp"
+#include "../message/bulk_order_ack_message.hpp"
+#include "../message/amend_order_message.hpp"
+#include "../message/clock_sync_message.hpp"
+#include "../message/symbol_definition_message.hpp"
+#include "../message/shared_memory_feed_message.hpp"
+#include "../message/compactmarketdata.hpp"
+#include "../message/symboldirectory.hpp"
 #include "../order/order.hpp"
 #include "../order/limitorder.hpp"
 #include "../order/marketorder.hpp"
 #include "../trade/trade.hpp"
+#include "../utilities/logger.hpp"
+#include "../utilities/latencyrecorder.hpp"
+#include "../utilities/tracer.hpp"
 
 BOOST_CLASS_EXPORT(Message);
 BOOST_CLASS_EXPORT(MarketDataMessage);
@@ -37,9 +60,21 @@ BOOST_CLASS_EXPORT(CancelOrderMessage);
 BOOST_CLASS_EXPORT(EventMessage);
 BOOST_CLASS_EXPORT(CancelRejectMessage);
 BOOST_CLASS_EXPORT(ProfitMessage);
+BOOST_CLASS_EXPORT(ProfitReportMessage);
 BOOST_CLASS_EXPORT(CustomerOrderMessage);
 BOOST_CLASS_EXPORT(RequestTraderListMessage);
 BOOST_CLASS_EXPORT(TraderListMessage);
+BOOST_CLASS_EXPORT(MarketDepthMessage);
+BOOST_CLASS_EXPORT(MarketDataDeltaMessage);
+BOOST_CLASS_EXPORT(MulticastGroupMessage);
+BOOST_CLASS_EXPORT(MarketDataRequestMessage);
+BOOST_CLASS_EXPORT(CustomerOrderBatchMessage);
+BOOST_CLASS_EXPORT(BulkOrderMessage);
+BOOST_CLASS_EXPORT(BulkOrderAckMessage);
+BOOST_CLASS_EXPORT(AmendOrderMessage);
+BOOST_CLASS_EXPORT(ClockSyncMessage);
+BOOST_CLASS_EXPORT(SymbolDefinitionMessage);
+BOOST_CLASS_EXPORT(SharedMemoryFeedMessage);
 
 /** TODO: This should be elsewhere */
 BOOST_CLASS_EXPORT(AgentConfig);
@@ -49,6 +84,8 @@ BOOST_CLASS_EXPORT(ArbitrageurConfig);
 BOOST_CLASS_EXPORT(MarketWatcherConfig);
 BOOST_CLASS_EXPORT(OrderInjectorConfig);
 BOOST_CLASS_EXPORT(ZIPConfig);
+BOOST_CLASS_EXPORT(LoadGeneratorConfig);
+BOOST_CLASS_EXPORT(MarketDataRelayConfig);
 
 BOOST_CLASS_EXPORT(ConfigMessage);
 BOOST_CLASS_EXPORT(ConfigAckMessage);
@@ -61,76 +98,595 @@ BOOST_CLASS_EXPORT(Trade);
 BOOST_CLASS_EXPORT(ExecutionReportMessage);
 
 namespace archive = boost::archive;
+namespace iostreams = boost::iostreams;
+
+NetworkEntity::~NetworkEntity()
+{
+    LocalTransport::instance().remove(this);
+    for (auto& [path, feed] : shared_memory_feeds_)
+    {
+        stopSharedMemoryFeed(*feed);
+    }
+}
 
 void NetworkEntity::start()
 {
-    asio::co_spawn(io_context_, TCPServer::start(), asio::detached);
-    asio::co_spawn(io_context_, UDPServer::start(), asio::detached);
-    std::cout << "Listening on port " << port() << "...\n";
+    listen();
+
+    // Every connection runs on its own strand, so extra threads only spread connections between them
+    std::vector<std::thread> io_threads;
+    for (unsigned int i = 1; i < io_threads_; ++i)
+    {
+        io_threads.emplace_back([this]() { runIOThread(); });
+    }
+
+    runIOThread();
+
+    for (std::thread& thread : io_threads)
+    {
+        thread.join();
+    }
+}
+
+void NetworkEntity::runIOThread()
+{
+    std::unique_lock<std::mutex> lock(io_thread_handles_mutex_);
+    std::thread::native_handle_type handle = ThreadPlacement::currentThread();
+    io_thread_handles_.push_back(handle);
+    ThreadPlacement::instance().pinCurrent(ThreadRole::IO);
+    lock.unlock();
 
     io_context_.run();
+
+    lock.lock();
+    std::erase(io_thread_handles_, handle);
+}
+
+void NetworkEntity::placeIOThreads()
+{
+    std::unique_lock<std::mutex> lock(io_thread_handles_mutex_);
+    for (std::thread::native_handle_type handle : io_thread_handles_)
+    {
+        ThreadPlacement::instance().pin(handle, ThreadRole::IO);
+    }
+}
+
+void NetworkEntity::listen()
+{
+    asio::co_spawn(io_context_, TCPServer::start(), asio::detached);
+    asio::co_spawn(UDPServer::broadcastExecutor(), UDPServer::start(), asio::detached);
+    if (metrics_server_ != nullptr)
+    {
+        asio::co_spawn(io_context_, metrics_server_->start(), asio::detached);
+    }
+    LOG_INFO("Listening on port " << port() << "...");
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+    LOG_INFO("Socket I/O runs on io_uring");
+#endif
+}
+
+void NetworkEntity::enableMetrics(unsigned short metrics_port)
+{
+    metrics_server_ = std::make_unique<MetricsServer>(io_context_, metrics_port, [this]() { return renderMetrics(); });
+}
+
+std::string NetworkEntity::renderMetrics()
+{
+    std::string out;
+    out += "# TYPE dsxe_process_resident_bytes gauge\n";
+    out += "dsxe_process_resident_bytes " + std::to_string(NetworkMetrics::residentBytes()) + "\n";
+    metrics_.appendPrometheus(out);
+
+    std::vector<std::pair<ipv4_address, TCPConnectionPtr>> connections;
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+    for (auto const& [address, connection] : connections_.left)
+    {
+        connections.emplace_back(address, connection);
+    }
+    connections_lock.unlock();
+
+    out += "# TYPE dsxe_send_queue_bytes gauge\n";
+    for (auto const& [address, connection] : connections)
+    {
+        out += "dsxe_send_queue_bytes{peer=\"" + address + "\"} " + std::to_string(connection->queuedBytes()) + "\n";
+    }
+    out += "# TYPE dsxe_send_queue_dropped_total counter\n";
+    for (auto const& [address, connection] : connections)
+    {
+        out += "dsxe_send_queue_dropped_total{peer=\"" + address + "\"} " + std::to_string(connection->droppedMessages()) + "\n";
+    }
+    link_emulator_.appendPrometheus(out);
+
+    std::vector<std::shared_ptr<Agent>> agents;
+    std::unique_lock<std::mutex> agents_lock(agents_mutex_);
+    for (auto const& [agent_id, agent] : agents_)
+    {
+        agents.push_back(agent);
+    }
+    agents_lock.unlock();
+
+    for (std::shared_ptr<Agent> const& agent : agents)
+    {
+        agent->appendMetrics(out);
+    }
+    return out;
+}
+
+void NetworkEntity::setIOThreads(unsigned int io_threads)
+{
+    io_threads_ = std::max(io_threads, 1u);
+}
+
+void NetworkEntity::setMaxAgents(unsigned int max_agents)
+{
+    max_agents_ = std::max(max_agents, 1u);
 }
 
 std::string NetworkEntity::serialiseMessage(MessagePtr message)
 {
-    std::stringstream ss;
-    archive::text_oarchive oa{ss};
-    oa << message;
-    return ss.str() + std::string{"#END#"};
+    return serialiseMessage(message, wire_format_.load(std::memory_order_relaxed));
+}
+
+std::string NetworkEntity::serialiseMessage(MessagePtr message, WireFormat wire_format)
+{
+    TraceSpan span {TraceStage::SERIALISE, message->type};
+    if (wire_format == WireFormat::TEXT)
+    {
+        std::stringstream ss;
+        archive::text_oarchive oa{ss};
+        oa << message;
+        return ss.str();
+    }
+
+    // Market data goes in its compact encoding whenever the update fits it
+    if (message->type == MessageType::MARKET_DATA)
+    {
+        std::optional<std::string> compact = CompactMarketData::encode(*std::static_pointer_cast<MarketDataMessage>(message));
+        if (compact.has_value()) return std::move(compact.value());
+    }
+
+    // The wire header replaces the archive header so that incompatible peers are detected up front
+    unsigned int library_version = archive::BOOST_ARCHIVE_VERSION();
+    std::string serialised {static_cast<char>(BINARY_WIRE_MAGIC), static_cast<char>(BINARY_WIRE_VERSION),
+        static_cast<char>(library_version & 0xFF), static_cast<char>((library_version >> 8) & 0xFF)};
+    {
+        iostreams::stream<iostreams::back_insert_device<std::string>> stream{serialised};
+        archive::binary_oarchive oa{stream, archive::no_header};
+        oa << message;
+    }
+    return serialised;
+}
+
+WireFormat NetworkEntity::detectWireFormat(std::string_view message)
+{
+    bool binary = !message.empty() && (static_cast<unsigned char>(message.front()) == BINARY_WIRE_MAGIC 
+        || CompactMarketData::isCompact(message));
+    return binary ? WireFormat::BINARY : WireFormat::TEXT;
 }
 
 MessagePtr NetworkEntity::deserialiseMessage(std::string_view message)
 {
-    std::stringstream ss{std::string{message}};
-    archive::text_iarchive ia{ss};
-    MessagePtr msg = std::make_shared<Message>();
-    ia >> msg;
+    // Traced once the message's type is known
+    uint64_t trace_start = Tracer::enabled() ? Tracer::now() : 0;
+    MessagePtr msg;
+    if (CompactMarketData::isCompact(message))
+    {
+        msg = CompactMarketData::decode(message);
+    }
+    else if (detectWireFormat(message) == WireFormat::TEXT)
+    {
+        std::stringstream ss{std::string{message}};
+        archive::text_iarchive ia{ss};
+        ia >> msg;
+    }
+    else
+    {
+        if (message.size() < BINARY_WIRE_HEADER_SIZE)
+        {
+            throw std::runtime_error("Binary message is missing its wire header");
+        }
+        unsigned int wire_version = static_cast<unsigned char>(message[1]);
+        unsigned int library_version = static_cast<unsigned char>(message[2]) | (static_cast<unsigned char>(message[3]) << 8);
+        if (wire_version != BINARY_WIRE_VERSION || library_version != archive::BOOST_ARCHIVE_VERSION())
+        {
+            throw std::runtime_error("Unsupported binary wire version " + std::to_string(wire_version) 
+                + " (archive library " + std::to_string(library_version) + "), use the text wire format with this peer");
+        }
+
+        iostreams::stream<iostreams::array_source> stream{message.data() + BINARY_WIRE_HEADER_SIZE, message.size() - BINARY_WIRE_HEADER_SIZE};
+        archive::binary_iarchive ia{stream, archive::no_header};
+        ia >> msg;
+    }
 
     if (msg == nullptr)
     {
         throw std::runtime_error("Deserialisation returned nullptr");
     }
 
+    if (trace_start != 0)
+    {
+        Tracer::instance().record(TraceStage::DESERIALISE, trace_start, Tracer::now(), msg->type);
+    }
     return msg;
 }
 
 void NetworkEntity::connect(ipv4_view address, std::function<void()> const& callback)
 {
     std::pair<std::string, unsigned int> pair = splitAddress(address);
+    std::string full_addr = concatAddress(pair.first, pair.second);
+
+    // Agents in this process are reached without a connection
+    if (LocalTransport::instance().find(full_addr) != nullptr)
+    {
+        LOG_INFO("Reaching " << full_addr << " in process");
+        asio::post(io_context_, SimulationClock::holding(callback));
+        return;
+    }
 
-    // Cospawn an asio coroutine to connect to address then call callback
-    asio::co_spawn(io_context_, TCPServer::connect(pair.first, pair.second, callback), asio::detached);
+    // Agents hosted together share one connection to each address
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+    if (connections_.left.find(full_addr) != connections_.left.end())
+    {
+        connections_lock.unlock();
+        asio::post(io_context_, callback);
+        return;
+    }
+
+    // Agents connecting while the connection is being established wait for it
+    auto [pending, first] = pending_connections_.try_emplace(full_addr);
+    pending->second.push_back(callback);
+    connections_lock.unlock();
+    if (!first) return;
+
+    // Cospawn an asio coroutine to connect to address then call the callbacks
+    auto takePending = [this, full_addr]() {
+        std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+        std::vector<std::function<void()>> callbacks = std::move(pending_connections_[full_addr]);
+        pending_connections_.erase(full_addr);
+        return callbacks;
+    };
+    asio::co_spawn(io_context_, TCPServer::connect(pair.first, pair.second, [takePending]() {
+        for (std::function<void()> const& pending_callback : takePending())
+        {
+            pending_callback();
+        }
+    }), [takePending](std::exception_ptr error) {
+        // Later attempts to connect start afresh
+        if (error) takePending();
+    });
 }
 
 void NetworkEntity::sendBroadcast(ipv4_view address, MessagePtr message)
 {
+    if (emulateLink(address, LinkEmulator::Direction::OUT, message, false, [=, this, address = ipv4_address{address}]() {
+        transmitBroadcast(address, message, false);
+    })) return;
+
+    transmitBroadcast(address, message, false);
+}
+
+void NetworkEntity::transmitBroadcast(ipv4_view address, MessagePtr message, bool shared)
+{
+    if (sendLocally(address, message, true, shared)) return;
+
     std::pair<std::string, unsigned int> pair = splitAddress(address);
-    message->markSent(agent()->getAgentId());
-    asio::post(io_context_, [=, this](){
-        asio::co_spawn(this->io_context_, UDPServer::sendBroadcast(pair.first, pair.second, serialiseMessage(message)), asio::detached);
+    asio::post(UDPServer::broadcastExecutor(), [=, this](){
+        std::string serialised = serialiseMessage(message);
+        metrics_.recordOut(message->type, serialised.size());
+        asio::co_spawn(UDPServer::broadcastExecutor(), UDPServer::sendBroadcast(pair.first, pair.second, std::move(serialised)), asio::detached);
     });
 }
 
+void NetworkEntity::sendBroadcast(std::span<const ipv4_address> addresses, MessagePtr message)
+{
+    if (addresses.empty()) return;
+
+    std::vector<std::string_view> destinations;
+    destinations.reserve(addresses.size());
+    std::unordered_set<std::string_view> seen;
+    for (ipv4_address const& address : addresses)
+    {
+        // A node hands one copy to each of its agents that knows the sender
+        if (seen.insert(address).second) destinations.push_back(address);
+    }
+
+    // NetworkEntities in this process are handed the message itself, the rest a datagram
+    bool shared = destinations.size() > 1;
+    std::vector<udp::endpoint> endpoints;
+    for (std::string_view address : destinations)
+    {
+        if (emulateLink(address, LinkEmulator::Direction::OUT, message, false, [=, this, address = ipv4_address{address}]() {
+            transmitBroadcast(address, message, shared);
+        })) continue;
+        if (sendLocally(address, message, true, shared)) continue;
+
+        std::pair<std::string, unsigned int> pair = splitAddress(address);
+        endpoints.emplace_back(asio::ip::make_address(pair.first), pair.second);
+    }
+    if (endpoints.empty()) return;
+
+    // Every endpoint is sent the same immutable buffer
+    std::shared_ptr<const std::string> serialised = std::make_shared<const std::string>(serialiseMessage(message));
+    asio::post(UDPServer::broadcastExecutor(), [this, endpoints = std::move(endpoints), serialised, type = message->type](){
+        for (udp::endpoint const& endpoint : endpoints)
+        {
+            metrics_.recordOut(type, serialised->size());
+            asio::co_spawn(UDPServer::broadcastExecutor(), UDPServer::sendBroadcast(endpoint, serialised), asio::detached);
+        }
+    });
+}
+
+void NetworkEntity::joinMulticastGroup(ipv4_view group_address)
+{
+    // Agents hosted together join each group once, through the shared socket
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+    if (!multicast_groups_.insert(std::string{group_address}).second) return;
+    connections_lock.unlock();
+
+    std::pair<std::string, unsigned int> pair = splitAddress(group_address);
+    asio::post(UDPServer::broadcastExecutor(), [=, this](){
+        UDPServer::joinMulticastGroup(pair.first, pair.second);
+    });
+}
+
+void NetworkEntity::attachSharedMemoryFeed(const std::string& path, uint64_t token, ipv4_view publisher)
+{
+    // Agents hosted together read each ring once, as they share a multicast group
+    std::unique_lock<std::mutex> feeds_lock(shared_memory_feeds_mutex_);
+    std::unique_ptr<SharedMemoryFeed>& feed = shared_memory_feeds_[path];
+    if (feed != nullptr && feed->ring->token() == token) return;
+
+    // A ring left from an exchange of an earlier trial is no longer written to
+    if (feed != nullptr)
+    {
+        stopSharedMemoryFeed(*feed);
+        feed = nullptr;
+    }
+
+    std::unique_ptr<SharedMemoryFeed> attached = std::make_unique<SharedMemoryFeed>();
+    try
+    {
+        attached->ring = SharedMemoryRing::open(path, token);
+    }
+    catch (std::exception&)
+    {
+        shared_memory_feeds_.erase(path);
+        throw;
+    }
+    attached->publisher = ipv4_address{publisher};
+    attached->reader = std::thread([this, feed = attached.get()]() { readSharedMemoryFeed(*feed); });
+    feed = std::move(attached);
+}
+
+bool NetworkEntity::publishSharedMemory(SharedMemoryRing& ring, MessagePtr message)
+{
+    std::string serialised = serialiseMessage(message);
+    if (!ring.publish(serialised)) return false;
+    metrics_.recordOut(message->type, serialised.size());
+    return true;
+}
+
+bool NetworkEntity::emulatesLinks() const
+{
+    return link_emulator_.active();
+}
+
+void NetworkEntity::readSharedMemoryFeed(SharedMemoryFeed& feed)
+{
+    ThreadPlacement::instance().pinCurrent(ThreadRole::IO);
+    LOG_INFO("Reading market data from shared memory ring " << feed.ring->path());
+
+    std::string message;
+    while (feed.running.load(std::memory_order_acquire))
+    {
+        // Read before looking, so that a message written in between is not slept through
+        uint32_t notifications = feed.ring->notifications();
+        if (feed.ring->next(message))
+        {
+            dispatchBroadcast(feed.publisher, message);
+            continue;
+        }
+        feed.ring->wait(notifications, SHARED_MEMORY_POLL_TIMEOUT);
+    }
+
+    if (feed.ring->skipped() > 0)
+    {
+        LOG_WARN("Fell behind shared memory ring " << feed.ring->path() << " by " << feed.ring->skipped() << " messages");
+    }
+}
+
+void NetworkEntity::stopSharedMemoryFeed(SharedMemoryFeed& feed)
+{
+    feed.running.store(false, std::memory_order_release);
+    if (feed.reader.joinable())
+    {
+        feed.reader.join();
+    }
+}
+
 void NetworkEntity::sendMessage(ipv4_view address, MessagePtr message, bool async)
 {
+    if (emulateLink(address, LinkEmulator::Direction::OUT, message, true, [=, this, address = ipv4_address{address}]() {
+        transmitMessage(address, message, async, false);
+    })) return;
+
+    transmitMessage(address, message, async, false);
+}
+
+void NetworkEntity::transmitMessage(ipv4_view address, MessagePtr message, bool async, bool shared)
+{
+    if (sendLocally(address, message, false, shared)) return;
+
+    TCPConnectionPtr connection = findConnection(address);
+
     // If TCP connection exists with the given address, send the message
-    if (connections_.left.find(std::string{address}) != connections_.left.end())
+    if (connection != nullptr)
     {
-        TCPConnectionPtr connection = connections_.left.at(std::string{address});
-        message->markSent(agent()->getAgentId());
-        asio::post(io_context_, [=, this](){
-            asio::co_spawn(io_context_, TCPServer::sendMessage(connection, serialiseMessage(message), async), asio::detached);
-        });
-        
+        queueMessage(connection, message, async);
     }
     // Abort sending message if TCP connection cannot be found
     else 
     {
-        std::cout << "Message failed to send: no TCP connection with " << address << "\n";
+        LOG_WARN("Message failed to send: no TCP connection with " << address);
     }
 
 }
 
+bool NetworkEntity::sendMessage(int agent_id, MessagePtr message, bool async)
+{
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+    auto local_route = local_routes_.find(agent_id);
+    if (local_route != local_routes_.end())
+    {
+        ipv4_address address = local_route->second;
+        connections_lock.unlock();
+        if (LocalTransport::instance().find(address) == nullptr) return false;
+        sendMessage(address, message, async);
+        return true;
+    }
+    connections_lock.unlock();
+
+    TCPConnectionPtr connection = findRoute(agent_id);
+    if (connection == nullptr) return false;
+
+    // Links are emulated by the address of the peer, looked up only while any is
+    if (link_emulator_.active())
+    {
+        connections_lock.lock();
+        auto address = connections_.right.find(connection);
+        std::optional<ipv4_address> peer = (address != connections_.right.end()) ? std::optional{address->second} : std::nullopt;
+        connections_lock.unlock();
+
+        if (peer.has_value() && emulateLink(peer.value(), LinkEmulator::Direction::OUT, message, true, [=, this]() {
+            queueMessage(connection, message, async);
+        })) return true;
+    }
+
+    queueMessage(connection, message, async);
+    return true;
+}
+
+void NetworkEntity::queueMessage(TCPConnectionPtr connection, MessagePtr message, bool async)
+{
+    queueMessage(connection, std::make_shared<const std::string>(serialiseMessage(message)), message->type, async);
+}
+
+void NetworkEntity::queueMessage(TCPConnectionPtr connection, TCPConnection::OutboundMessage serialised, MessageType type, bool async)
+{
+    // A single hop onto the strand, so messages reach each connection in the order they were sent
+    metrics_.recordOut(type, serialised->size());
+    asio::co_spawn(connection->socket().get_executor(), 
+        TCPServer::sendMessage(connection, std::move(serialised), async, sendPolicyFor(type)), asio::detached);
+}
+
+void NetworkEntity::sendMessage(const std::vector<ipv4_address>& addresses, MessagePtr message, bool async)
+{
+    if (addresses.empty()) return;
+
+    // NetworkEntities in this process are handed the message itself, the rest are sent it over their connection
+    bool shared = addresses.size() > 1;
+    std::vector<TCPConnectionPtr> connections;
+    for (ipv4_address const& address : addresses)
+    {
+        if (emulateLink(address, LinkEmulator::Direction::OUT, message, true, [=, this]() {
+            transmitMessage(address, message, async, shared);
+        })) continue;
+        if (sendLocally(address, message, false, shared)) continue;
+
+        TCPConnectionPtr connection = findConnection(address);
+        if (connection == nullptr)
+        {
+            LOG_WARN("Message failed to send: no TCP connection with " << address);
+            continue;
+        }
+        connections.push_back(connection);
+    }
+    if (connections.empty()) return;
+
+    // Every connection queues the same immutable buffer
+    TCPConnection::OutboundMessage serialised = std::make_shared<const std::string>(serialiseMessage(message));
+    for (TCPConnectionPtr const& connection : connections)
+    {
+        queueMessage(connection, serialised, message->type, async);
+    }
+}
+
+SendPolicy NetworkEntity::sendPolicyFor(MessageType type)
+{
+    // Market data is superseded by the next update, everything else must arrive
+    switch (type)
+    {
+        case MessageType::MARKET_DATA:
+        case MessageType::MARKET_DATA_DELTA:
+        case MessageType::MARKET_DEPTH:
+            return SendPolicy::DROP;
+        default:
+            return SendPolicy::BLOCK;
+    }
+}
+
+size_t NetworkEntity::sendQueueDepth(ipv4_view address)
+{
+    TCPConnectionPtr connection = findConnection(address);
+    return (connection != nullptr) ? connection->queuedBytes() : 0;
+}
+
+bool NetworkEntity::sendQueueBacklogged(ipv4_view address)
+{
+    return sendQueueBounded() && sendQueueDepth(address) >= TCPServer::sendQueueLimits().high_watermark;
+}
+
+bool NetworkEntity::sendQueueBacklogged(int agent_id)
+{
+    if (!sendQueueBounded()) return false;
+
+    TCPConnectionPtr connection = findRoute(agent_id);
+    return connection != nullptr && connection->queuedBytes() >= TCPServer::sendQueueLimits().high_watermark;
+}
+
+bool NetworkEntity::sendQueueBounded()
+{
+    return TCPServer::sendQueueLimits().high_watermark > 0;
+}
+
+void NetworkEntity::addRoute(int agent_id, ipv4_view address)
+{
+    if (LocalTransport::instance().find(address) != nullptr)
+    {
+        std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+        local_routes_.insert_or_assign(agent_id, std::string{address});
+        return;
+    }
+
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+    auto it = connections_.left.find(std::string{address});
+    if (it != connections_.left.end())
+    {
+        routes_.insert_or_assign(agent_id, it->second);
+    }
+}
+
+void NetworkEntity::removeRoute(int agent_id)
+{
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+    routes_.erase(agent_id);
+    local_routes_.erase(agent_id);
+}
+
+NetworkEntity::TCPConnectionPtr NetworkEntity::findRoute(int agent_id)
+{
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+    auto it = routes_.find(agent_id);
+    return (it != routes_.end()) ? it->second : nullptr;
+}
+
+NetworkEntity::TCPConnectionPtr NetworkEntity::findConnection(ipv4_view address)
+{
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+    auto it = connections_.left.find(std::string{address});
+    return (it != connections_.left.end()) ? it->second : nullptr;
+}
+
 std::string NetworkEntity::concatAddress(std::string_view address, unsigned int port)
 {
     return std::string{address} + ":" + std::to_string(port);
@@ -163,16 +719,21 @@ std::pair<std::string, unsigned int> NetworkEntity::splitAddress(std::string_vie
 
 void NetworkEntity::addConnection(std::string_view address, unsigned int port, TCPConnectionPtr connection)
 {
-    std::cout << "New connection with " << address << ":" << port << "\n";
+    LOG_INFO("New connection with " << address << ":" << port);
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
     connections_.left.insert({concatAddress(address, port), connection});
 }
 
 void NetworkEntity::removeConnection(std::string_view address, unsigned int port)
 {
     std::string full_addr = concatAddress(address, port);
-    if (connections_.left.find(full_addr) != connections_.left.end())
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+    auto it = connections_.left.find(full_addr);
+    if (it != connections_.left.end())
     {
-        connections_.left.erase(full_addr);
+        TCPConnectionPtr connection = it->second;
+        std::erase_if(routes_, [&](auto const& route) { return route.second == connection; });
+        connections_.left.erase(it);
     }
 }
 
@@ -182,48 +743,265 @@ std::string NetworkEntity::handleMessage(std::string_view sender_adress, unsigne
     // std::cout << "Received message from " << sender_adress << ":" << sender_port << "\n";
     // std::cout << "Received message " << message << "\n";
 
+    // Messages over an emulated link are handled once they would have arrived, and their responses sent back over the link
+    ipv4_address sender = concatAddress(sender_adress, sender_port);
+    if (link_emulator_.delay(sender, LinkEmulator::Direction::IN, true, [size = message.size()]() { return size; },
+        [this, sender, message = std::string{message}]() { dispatchMessage(sender, message, false); }))
+    {
+        return std::string{};
+    }
+
+    return dispatchMessage(sender, message, true);
+}
+
+std::string NetworkEntity::dispatchMessage(const ipv4_address& sender, std::string_view message, bool respond_inline)
+{
     try     
     {
         MessagePtr msg = deserialiseMessage(message);
         msg->markReceived();
+        LatencyRecorder::instance().record(LatencyStage::WIRE, msg->type, msg->sender_id, msg->timestamp_sent, msg->timestamp_received);
+        metrics_.recordIn(msg->type, message.size());
 
         if (msg->type == MessageType::CONFIG)
         {
-            configureEntity(sender_adress, std::dynamic_pointer_cast<ConfigMessage>(msg));
+            // Talk to the rest of the simulation in the format chosen by the orchestrator
+            setWireFormat(detectWireFormat(message));
+            configureEntity(sender, std::dynamic_pointer_cast<ConfigMessage>(msg));
+        }
+        else if (msg->type == MessageType::SYMBOL_DEFINITION)
+        {
+            learnSymbol(std::dynamic_pointer_cast<SymbolDefinitionMessage>(msg));
         }
         else
         {
-            std::optional<MessagePtr> response = agent()->handleMessage(concatAddress(sender_adress, sender_port), msg);
-            if (response.has_value()) 
+            std::shared_ptr<Agent> recipient = agentFor(msg->recipient_id);
+            if (recipient == nullptr)
+            {
+                LOG_WARN("Dropped message for agent " << msg->recipient_id << " from " << sender << ": no such agent hosted here");
+                return std::string{};
+            }
+
+            std::optional<MessagePtr> response = recipient->handleMessage(sender, msg);
+            if (response.has_value() && !respond_inline)
             {
-                return serialiseMessage(response.value());
+                response.value()->recipient_id = msg->sender_id;
+                response.value()->markSent(recipient->getAgentId());
+                sendMessage(sender, response.value(), true);
+            }
+            else if (response.has_value()) 
+            {
+                response.value()->markSent(recipient->getAgentId());
+                std::string serialised = serialiseMessage(response.value(), detectWireFormat(message));
+                metrics_.recordOut(response.value()->type, serialised.size());
+                return serialised;
             }
         }
     }
     catch (std::exception& e)
     {
-        std::cout << "Failed to deserialise message from " << sender_adress << "\n";
-        std::cout << "Reason: " << e.what() << "\n";
+        LOG_WARN("Failed to deserialise message from " << sender);
+        LOG_WARN("Reason: " << e.what());
         //std::cout << "Message " << message << "\n";
     }
 
     return std::string{};
 }
 
+void NetworkEntity::learnSymbol(SymbolDefinitionMessagePtr msg)
+{
+    SymbolDirectory::instance().learn(msg->sender_id, SymbolDirectory::Symbol{msg->ticker, msg->symbol, msg->tick_size});
+    LOG_DEBUG("Agent " << msg->sender_id << " sends " << msg->ticker << " as symbol " << msg->symbol);
+}
+
+void NetworkEntity::setLinkProfile(ipv4_view address, const LinkProfile& profile)
+{
+    std::pair<std::string, unsigned int> pair = splitAddress(address);
+    link_emulator_.setProfile(concatAddress(pair.first, pair.second), profile);
+    LOG_INFO("Emulating link to " << address << ": " << profile.delay << "ms " << to_string(profile.distribution) 
+        << " delay, " << profile.jitter << "ms jitter, " << profile.bandwidth << "Mbit/s, " << profile.loss << " loss");
+}
+
+bool NetworkEntity::emulateLink(ipv4_view address, LinkEmulator::Direction direction, MessagePtr message, bool reliable, std::function<void()> deliver)
+{
+    if (!link_emulator_.active()) return false;
+
+    // Messages handed over in process are measured as they would have been sent
+    return link_emulator_.delay(ipv4_address{address}, direction, reliable, [this, message]() { return serialiseMessage(message).size(); }, 
+        std::move(deliver));
+}
+
+bool NetworkEntity::sendLocally(ipv4_view address, MessagePtr message, bool broadcast, bool shared)
+{
+    NetworkEntity* entity = LocalTransport::instance().find(address);
+    if (entity == nullptr) return false;
+
+    metrics_.recordOut(message->type, 0);
+    entity->receiveLocally(LocalDelivery{localAddress(), message, broadcast, shared});
+    return true;
+}
+
+void NetworkEntity::receiveLocally(LocalDelivery delivery)
+{
+    // In virtual time the clock waits until the message has been handled
+    SimulationClock::beginWork();
+    local_inbox_.push(std::move(delivery));
+
+    // A drain already scheduled picks the message up, the fences pairing with the one after it clears the flag
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!local_inbox_scheduled_.exchange(true))
+    {
+        asio::post(io_context_, [this]() { drainLocalInbox(); });
+    }
+}
+
+void NetworkEntity::drainLocalInbox()
+{
+    LocalDelivery delivery;
+    while (true)
+    {
+        for (size_t handled = 0; handled < LOCAL_INBOX_BATCH; ++handled)
+        {
+            if (!local_inbox_.pop(delivery)) break;
+            handleLocalDelivery(delivery);
+            delivery = LocalDelivery{};
+            SimulationClock::endWork();
+        }
+
+        // Let other work on the IO context run between batches
+        if (!local_inbox_.empty())
+        {
+            asio::post(io_context_, [this]() { drainLocalInbox(); });
+            return;
+        }
+
+        // Messages queued after the check above but before the flag is cleared schedule nothing, so check again
+        local_inbox_scheduled_.store(false);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (local_inbox_.empty() || local_inbox_scheduled_.exchange(true)) return;
+    }
+}
+
+void NetworkEntity::handleLocalDelivery(LocalDelivery& delivery)
+{
+    if (emulateLink(delivery.sender, LinkEmulator::Direction::IN, delivery.message, !delivery.broadcast, [this, delivery]() mutable {
+        dispatchLocalDelivery(delivery);
+    })) return;
+
+    dispatchLocalDelivery(delivery);
+}
+
+void NetworkEntity::dispatchLocalDelivery(LocalDelivery& delivery)
+{
+    try
+    {
+        MessagePtr msg = delivery.message;
+        metrics_.recordIn(msg->type, 0);
+        if (delivery.shared)
+        {
+            // Other receivers hold the same message, so the time it arrived is recorded without writing it
+            unsigned long long timestamp_received = SimulationClock::nowNanos();
+            LatencyRecorder::instance().record(LatencyStage::WIRE, msg->type, msg->sender_id, msg->timestamp_sent, timestamp_received);
+        }
+        else
+        {
+            msg->markReceived();
+            LatencyRecorder::instance().record(LatencyStage::WIRE, msg->type, msg->sender_id, msg->timestamp_sent, msg->timestamp_received);
+        }
+
+        if (delivery.broadcast)
+        {
+            deliverBroadcast(delivery.sender, msg);
+        }
+        else if (msg->type == MessageType::CONFIG)
+        {
+            configureEntity(delivery.sender, std::dynamic_pointer_cast<ConfigMessage>(msg));
+        }
+        else if (msg->type == MessageType::SYMBOL_DEFINITION)
+        {
+            learnSymbol(std::dynamic_pointer_cast<SymbolDefinitionMessage>(msg));
+        }
+        else
+        {
+            std::shared_ptr<Agent> recipient = agentFor(msg->recipient_id);
+            if (recipient == nullptr)
+            {
+                LOG_WARN("Dropped message for agent " << msg->recipient_id << " from " << delivery.sender << ": no such agent hosted here");
+                return;
+            }
+
+            // Responses go back to the sender among the agents hosted by its NetworkEntity, over any link emulated to it
+            std::optional<MessagePtr> response = recipient->handleMessage(delivery.sender, msg);
+            if (response.has_value())
+            {
+                response.value()->recipient_id = msg->sender_id;
+                response.value()->markSent(recipient->getAgentId());
+                if (LocalTransport::instance().find(delivery.sender) == nullptr)
+                {
+                    LOG_WARN("Response failed to send: " << delivery.sender << " no longer runs in this process");
+                }
+                else
+                {
+                    sendMessage(delivery.sender, response.value(), true);
+                }
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        LOG_WARN("Failed to handle message handed over in process from " << delivery.sender);
+        LOG_WARN("Reason: " << e.what());
+    }
+}
+
+void NetworkEntity::registerLocally()
+{
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+    local_address_ = concatAddress(addr_.value_or("127.0.0.1"), port_);
+    connections_lock.unlock();
+
+    LocalTransport::instance().add(concatAddress("127.0.0.1", port_), this);
+    if (addr_.has_value())
+    {
+        LocalTransport::instance().add(concatAddress(addr_.value(), port_), this);
+    }
+}
+
+NetworkEntity::ipv4_address NetworkEntity::localAddress()
+{
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
+    return local_address_;
+}
+
 void NetworkEntity::handleBroadcast(std::string_view sender_adress, unsigned int sender_port, std::string_view message)
 {
     // std::cout << "Received broadcast from " << sender_adress << ":" << sender_port << ": " << message << "\n";
 
+    ipv4_address sender = concatAddress(sender_adress, sender_port);
+    if (link_emulator_.delay(sender, LinkEmulator::Direction::IN, false, [size = message.size()]() { return size; },
+        [this, sender, message = std::string{message}]() { dispatchBroadcast(sender, message); }))
+    {
+        return;
+    }
+
+    dispatchBroadcast(sender, message);
+}
+
+void NetworkEntity::dispatchBroadcast(const ipv4_address& sender, std::string_view message)
+{
     try 
     {
         MessagePtr msg = deserialiseMessage(message);
         msg->markReceived();
-        agent()->handleBroadcast(concatAddress(sender_adress, sender_port), msg);
+        LatencyRecorder::instance().record(LatencyStage::WIRE, msg->type, msg->sender_id, msg->timestamp_sent, msg->timestamp_received);
+        metrics_.recordIn(msg->type, message.size());
+
+        deliverBroadcast(sender, msg);
     }
     catch (std::exception& e)
     {
-        std::cout << "Failed to deserialise message from " << sender_adress << "\n";
-        std::cout << e.what() << "\n";
+        LOG_WARN("Failed to deserialise message from " << sender);
+        LOG_WARN(e.what());
     }
     
     return;
@@ -234,6 +1012,11 @@ unsigned int NetworkEntity::port()
     return port_;
 }
 
+asio::io_context& NetworkEntity::ioContext()
+{
+    return io_context_;
+}
+
 std::string NetworkEntity::addr()
 {
     if (!addr_.has_value())
@@ -246,46 +1029,151 @@ std::string NetworkEntity::addr()
 
 void NetworkEntity::setAgent(std::shared_ptr<Agent> agent)
 {
-    if (agent_.has_value())
+    retireAgent(agent->getAgentId());
+
+    std::unique_lock<std::mutex> agents_lock(agents_mutex_);
+    if (agents_.size() >= max_agents_)
     {
-        agent_.value()->terminate();
-        closeConnections();
+        throw std::runtime_error("Cannot host agent " + std::to_string(agent->getAgentId()) 
+            + ": this node already hosts its maximum of " + std::to_string(max_agents_) + " agents.");
     }
-    
-    agent_ = agent;
+    agents_.insert({agent->getAgentId(), agent});
+    agents_lock.unlock();
+
     agent->start();
 }
 
-std::shared_ptr<Agent> NetworkEntity::agent()
+void NetworkEntity::retireAgent(int agent_id, bool keep_connections)
+{
+    std::unique_lock<std::mutex> agents_lock(agents_mutex_);
+    auto it = (max_agents_ == 1) ? agents_.begin() : agents_.find(agent_id);
+    if (it == agents_.end()) return;
+
+    std::shared_ptr<Agent> retired = it->second;
+    agents_.erase(it);
+    bool shared = !agents_.empty();
+    agents_lock.unlock();
+
+    retired->terminate();
+    if (!shared && !keep_connections) closeConnections();
+}
+
+std::shared_ptr<Agent> NetworkEntity::agentFor(int recipient_id)
+{
+    std::unique_lock<std::mutex> agents_lock(agents_mutex_);
+    if (agents_.size() == 1) return agents_.begin()->second;
+
+    auto it = agents_.find(recipient_id);
+    if (it != agents_.end()) return it->second;
+
+    // Messages addressed by name, as to an exchange hosted alongside its traders
+    if (recipient_id < 0)
+    {
+        for (auto const& [agent_id, agent] : agents_)
+        {
+            if (agent->takesUnaddressedMessages()) return agent;
+        }
+    }
+    return nullptr;
+}
+
+void NetworkEntity::deliverBroadcast(std::string_view sender_address, MessagePtr message)
+{
+    if (message->type == MessageType::CUSTOMER_ORDER_BATCH)
+    {
+        // Each order of a batch finds its recipients as if it had been broadcast alone
+        CustomerOrderBatchMessagePtr batch = std::dynamic_pointer_cast<CustomerOrderBatchMessage>(message);
+        for (size_t i = 0; i < batch->orders.size(); ++i)
+        {
+            MessagePtr order = batch->unpack(i);
+            for (std::shared_ptr<Agent> const& recipient : broadcastRecipients(sender_address, order->sender_id, order->recipient_id))
+            {
+                recipient->handleBroadcast(sender_address, order);
+            }
+        }
+        return;
+    }
+
+    for (std::shared_ptr<Agent> const& recipient : broadcastRecipients(sender_address, message->sender_id, message->recipient_id))
+    {
+        recipient->handleBroadcast(sender_address, message);
+    }
+}
+
+std::vector<std::shared_ptr<Agent>> NetworkEntity::broadcastRecipients(std::string_view sender_address, int sender_id, int recipient_id)
 {
-    if (!agent_.has_value())
+    std::unique_lock<std::mutex> agents_lock(agents_mutex_);
+    if (agents_.size() == 1)
+    {
+        if (agents_.begin()->first == sender_id) return {};
+        return {agents_.begin()->second};
+    }
+
+    auto it = agents_.find(recipient_id);
+    if (it != agents_.end()) return {it->second};
+
+    // An agent hosted here does not hear its own broadcasts to the agents it shares the node with
+    std::vector<std::shared_ptr<Agent>> recipients;
+    for (auto const& [agent_id, agent] : agents_)
     {
-        throw std::runtime_error("No agent has been assigned to this NetworkEntity.");
+        if (agent_id != sender_id && agent->knowsAddress(sender_address)) recipients.push_back(agent);
     }
 
-    return agent_.value();
+    // Senders unknown to every agent, such as an injector picking a trader address at random, reach one agent in turn
+    if (recipients.empty() && !agents_.empty())
+    {
+        auto next = std::next(agents_.begin(), next_broadcast_agent_++ % agents_.size());
+        if (next->first == sender_id && agents_.size() > 1)
+        {
+            next = std::next(agents_.begin(), next_broadcast_agent_++ % agents_.size());
+        }
+        if (next->first != sender_id) recipients.push_back(next->second);
+    }
+    return recipients;
 }
 
 void NetworkEntity::configureEntity(std::string_view sender_address, ConfigMessagePtr msg)
 {
-    // Set own address
+    // Set own address, at which agents in this process reach this one too
     addr_ = splitAddress(msg->config->addr).first;
+    registerLocally();
 
-    // Initialise a new agent
-    setAgent(AgentFactory::createAgent(this, msg->config));
+    // Links to the agent's peers are emulated before it first reaches them
+    for (auto const& [address, profile] : msg->config->links)
+    {
+        setLinkProfile(address, profile);
+    }
+
+    // Retire the agent being replaced before the new one starts connecting, then initialise it;
+    // between trials the new one takes over the connections of the old
+    retireAgent(msg->config->agent_id, msg->reset);
+    std::shared_ptr<Agent> agent = AgentFactory::createAgent(this, msg->config);
+    agent->setOrchestratorAddress(sender_address);
+    setAgent(agent);
 
-    // Send configuration acknowledgement back to orchestrator
-    // ConfigAckMessagePtr ack_msg = std::make_shared<ConfigAckMessage>();
-    // sendMessage(sender_address, std::static_pointer_cast<Message>(ack_msg), true);
+    // Send configuration acknowledgement back to orchestrator, which waits for every agent of a phase before the next
+    ConfigAckMessagePtr ack_msg = std::make_shared<ConfigAckMessage>();
+    ack_msg->agent_id = msg->config->agent_id;
+    ack_msg->markSent(msg->config->agent_id);
+    sendMessage(sender_address, std::static_pointer_cast<Message>(ack_msg), true);
+}
+
+void NetworkEntity::setWireFormat(WireFormat wire_format)
+{
+    wire_format_.store(wire_format, std::memory_order_relaxed);
 }
 
 void NetworkEntity::closeConnections()
 {
+    std::unique_lock<std::mutex> connections_lock(connections_mutex_);
     for (auto connection : connections_.left)
     {
-        std::cout << "Closing connection with " << connection.first << "\n";
-        connection.second->close();
+        LOG_INFO("Closing connection with " << connection.first);
+        TCPConnectionPtr tcp_connection = connection.second;
+        asio::dispatch(tcp_connection->socket().get_executor(), [tcp_connection]() { tcp_connection->close(); });
     }
 
     connections_.clear();
+    routes_.clear();
+    local_routes_.clear();
 }
\ No newline at end of file
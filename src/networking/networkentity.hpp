@@ -1,17 +1,34 @@
 #ifndef NETWORK_ENTITY_HPP
 #define NETWORK_ENTITY_HPP
 
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <functional>
+#include <mutex>
 #include <optional>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <boost/asio.hpp>
 #include <boost/bimap.hpp>
 
 #include "tcpserver.hpp"
 #include "udpserver.hpp"
+#include "wireformat.hpp"
+#include "linkemulator.hpp"
+#include "localtransport.hpp"
+#include "metricsserver.hpp"
+#include "networkmetrics.hpp"
 #include "../message/message.hpp"
 #include "../message/config_message.hpp"
+#include "../message/symbol_definition_message.hpp"
+#include "../utilities/linkedqueue.hpp"
+#include "../utilities/sharedmemoryring.hpp"
+#include "../utilities/simulationclock.hpp"
+#include "../utilities/threadplacement.hpp"
 
 class Agent;
 
@@ -26,64 +43,207 @@ public:
     typedef std::string ipv4_address;
     typedef std::string_view ipv4_view;
     typedef boost::bimap<ipv4_address, TCPConnectionPtr> bimap;
+    typedef std::unordered_map<int, TCPConnectionPtr> routing_table;
 
     NetworkEntity() = delete;
-    virtual ~NetworkEntity() = default;
+    virtual ~NetworkEntity();
 
     NetworkEntity(asio::io_context& io_context, unsigned short port)
     : io_context_(io_context),
       port_(port),
       addr_(std::nullopt),
-      agent_(std::nullopt),
       TCPServer(io_context, port),
       UDPServer(io_context, port),
       connections_{}
     {
+        registerLocally();
     }
 
     NetworkEntity(asio::io_context& io_context, std::string addr, unsigned short port)
     : io_context_(io_context),
       port_(port),
       addr_(addr),
-      agent_(std::nullopt),
       TCPServer(io_context, port),
       UDPServer(io_context, port),
       connections_{}
     {
+        registerLocally();
     }
 
-    /** Starts both servers and listens for incoming connections. */
+    using TCPServer::setMaxWriteBatch;
+    using TCPServer::setSendQueueLimits;
+
+    /** Sets the number of threads running the IO context. Must be called before start. */
+    void setIOThreads(unsigned int io_threads);
+
+    /** Sets how many agents this NetworkEntity may host at once, sharing its sockets and connections.
+     *  Messages are handed to the agent they are addressed to by ID. Must be called before start. */
+    void setMaxAgents(unsigned int max_agents);
+
+    /** Serves the node's metrics over HTTP on the given port once listening. Must be called before start. */
+    void enableMetrics(unsigned short metrics_port);
+
+    /** Returns the node's metrics in the Prometheus text format: messages and bytes in and out per type, 
+     *  the send queue of each connection, the messages delayed and lost by each emulated link,
+     *  the process's resident memory and the metrics of the hosted agents. */
+    std::string renderMetrics();
+
+    /** Emulates the given wide area network link to the peer at the given IPv4 address, 
+     *  for the messages and broadcasts sent to and received from it, over the network or in process.
+     *  Agents hosted together share their node's links. */
+    void setLinkProfile(ipv4_view address, const LinkProfile& profile);
+
+    /** Pins the threads running the IO context to the CPUs the process's thread placement gives network IO. */
+    void placeIOThreads();
+
+    /** Starts both servers and listens for incoming connections, running the IO context until it is stopped. */
     virtual void start();
 
-    /** Establishes a lasting TCP connection with the given IPv4 address. */
+    /** Starts both servers without running the IO context, for NetworkEntities sharing one run elsewhere. */
+    void listen();
+
+    /** Establishes a lasting TCP connection with the given IPv4 address, or reuses the one already open.
+     *  NetworkEntities in this process need no connection, and are handed messages directly. */
     void connect(ipv4_view address, std::function<void()> const& callback);
 
     /** Sends a broadcast to the given IPv4 address. */
     void sendBroadcast(ipv4_view address, MessagePtr message);
 
+    /** Sends the same broadcast to each of the given IPv4 addresses, serialising it only once. 
+     *  Addresses listed several times, as for agents hosted by one node, are sent a single copy. */
+    void sendBroadcast(std::span<const ipv4_address> addresses, MessagePtr message);
+
+    /** Starts receiving broadcasts sent to the given IPv4 multicast group address. */
+    void joinMulticastGroup(ipv4_view group_address);
+
+    /** Starts reading the broadcasts written to the shared memory ring at the given path, on a thread of its own,
+     *  as if sent from the given IPv4 address. Does nothing if already reading the ring; replaces an earlier ring at the path.
+     *  Throws if the ring cannot be opened or is not the one with the given token. */
+    void attachSharedMemoryFeed(const std::string& path, uint64_t token, ipv4_view publisher);
+
+    /** Writes the broadcast to the shared memory ring, serialised as it would be sent. Returns false if it does not fit in a slot. */
+    bool publishSharedMemory(SharedMemoryRing& ring, MessagePtr message);
+
+    /** Indicates whether any link to a peer is emulated, which messages through shared memory would bypass. */
+    bool emulatesLinks() const;
+
     /** Sends a message to the given IPv4 address. */
     void sendMessage(ipv4_view address, MessagePtr message, bool async);
 
+    /** Sends the same message to each of the given IPv4 addresses, serialising it only once. */
+    void sendMessage(const std::vector<ipv4_address>& addresses, MessagePtr message, bool async);
+
+    /** Sends a message to the agent with the given ID. Returns false if there is no route to the agent. */
+    bool sendMessage(int agent_id, MessagePtr message, bool async);
+
+    /** Routes messages for the given agent ID to the open connection with the given IPv4 address. */
+    void addRoute(int agent_id, ipv4_view address);
+
+    /** Removes the route to the agent with the given ID. */
+    void removeRoute(int agent_id);
+
+    /** Returns the number of bytes waiting to be sent to the given IPv4 address, zero if there is no connection. */
+    size_t sendQueueDepth(ipv4_view address);
+
+    /** Indicates whether messages to the given IPv4 address are queued above the high watermark. */
+    bool sendQueueBacklogged(ipv4_view address);
+
+    /** Indicates whether messages to the agent with the given ID are queued above the high watermark. */
+    bool sendQueueBacklogged(int agent_id);
+
+    /** Indicates whether outgoing queues are bounded at all. */
+    bool sendQueueBounded();
+
     /** Returns the listening port of the NetworkEntity. */
     unsigned int port();
 
+    /** Returns the IO context running the servers, on which agents may also schedule their own work. */
+    asio::io_context& ioContext();
+
     /** Returns the address of the NetworkEntity. Must be called after address is known. */
     std::string addr();
 
-    /** Sets the agent running inside this NetworkEntity. */
+    /** Starts the agent inside this NetworkEntity, replacing the hosted agent with the same ID, 
+     *  or the only agent if no more than one may be hosted. */
     void setAgent(std::shared_ptr<Agent> agent);
 
     /** Closes all connections cleanly. */
     void closeConnections();
 
+    /** Sets the format outgoing messages are serialised in. Incoming messages are accepted in either format. */
+    void setWireFormat(WireFormat wire_format);
+
+    /** Serialises a message into a string to be sent, in the given wire format. */
+    static std::string serialiseMessage(MessagePtr message, WireFormat wire_format);
+
+    /** Deserialises incoming strings into messages, in whichever wire format they were sent. */
+    static MessagePtr deserialiseMessage(std::string_view message);
+
 private:
 
-    /** Returns the agent running inside this NetworkEntity. */
-    std::shared_ptr<Agent> agent();
+    /** A message handed over by a NetworkEntity in this process instead of being serialised. */
+    struct LocalDelivery
+    {
+        ipv4_address sender;  // The listening address of the sending NetworkEntity
+        MessagePtr message;
+        bool broadcast = false;
+        bool shared = false;  // Handed to other receivers as well, so it must not be written to
+    };
+
+    /** Returns the hosted agent a message is addressed to, the only agent if there is one, 
+     *  the agent taking unaddressed messages for a message addressed by name, or null ptr if there is none. */
+    std::shared_ptr<Agent> agentFor(int recipient_id);
+
+    /** Hands a broadcast from the given address to the hosted agents it is for, 
+     *  each order of a customer order batch as a customer order message of its own. */
+    void deliverBroadcast(std::string_view sender_address, MessagePtr message);
+
+    /** Returns the hosted agents a broadcast from the given address is for, other than its sender: the agent it is addressed to,
+     *  else every agent that knows the sender, else one agent in turn. */
+    std::vector<std::shared_ptr<Agent>> broadcastRecipients(std::string_view sender_address, int sender_id, int recipient_id);
+
+    /** Sends a broadcast to the given IPv4 address once it has crossed any link emulated to it. */
+    void transmitBroadcast(ipv4_view address, MessagePtr message, bool shared);
+
+    /** Sends a message to the given IPv4 address once it has crossed any link emulated to it. */
+    void transmitMessage(ipv4_view address, MessagePtr message, bool async, bool shared);
+
+    /** Hands the message to the deliver callback once it has crossed the link emulated to or from the given address, 
+     *  or drops it if it is lost. Returns false if no link is emulated to the address, for the caller to carry on directly. */
+    bool emulateLink(ipv4_view address, LinkEmulator::Direction direction, MessagePtr message, bool reliable, std::function<void()> deliver);
+
+    /** Hands the message to the NetworkEntity listening at the given IPv4 address if it runs in this process.
+     *  Returns false if it does not. */
+    bool sendLocally(ipv4_view address, MessagePtr message, bool broadcast, bool shared);
+
+    /** Queues a message handed over in process and schedules handling it on the IO context. Safe to call from any thread. */
+    void receiveLocally(LocalDelivery delivery);
+
+    /** Handles the messages handed over in process in the order they were queued, a batch at a time. */
+    void drainLocalInbox();
+
+    /** Handles a message handed over in process as the servers handle one received through the sockets. */
+    void handleLocalDelivery(LocalDelivery& delivery);
+
+    /** Handles a message handed over in process once it has crossed any link emulated from its sender. */
+    void dispatchLocalDelivery(LocalDelivery& delivery);
+
+    /** Makes this NetworkEntity reachable in process at its loopback address and its own address, once known. */
+    void registerLocally();
+
+    /** Returns the listening address of this NetworkEntity, which messages it hands over in process come from. */
+    ipv4_address localAddress();
+
+    /** Terminates the hosted agent an agent with the given ID replaces, closing the connections if no other agent shares them
+     *  unless they are to be kept for the next trial. */
+    void retireAgent(int agent_id, bool keep_connections = false);
 
     /** Initialises the agent running inside this NetworkEntity using a config message. */
     void configureEntity(std::string_view sender_address, ConfigMessagePtr msg);
 
+    /** Records the symbol an exchange defined, for decoding its compact market data. Not passed on to the hosted agents. */
+    void learnSymbol(SymbolDefinitionMessagePtr msg);
+
     /** Adds a given connection to the bimap of open connections. */
     void addConnection(std::string_view address, unsigned int port, TCPConnectionPtr connection) override;
 
@@ -96,11 +256,33 @@ private:
     /** Handles an incoming UDP broadcast. */
     void handleBroadcast(std::string_view sender_adress, unsigned int sender_port, std::string_view message) override;
 
-    /** Serialises a message into a string to be sent. */
+    /** Handles a TCP message from the given address once it has crossed any link emulated from it.
+     *  Returns the serialised response if it is to be written back at once, otherwise sends it and returns an empty string. */
+    std::string dispatchMessage(const ipv4_address& sender, std::string_view message, bool respond_inline);
+
+    /** Handles a UDP broadcast from the given address once it has crossed any link emulated from it. */
+    void dispatchBroadcast(const ipv4_address& sender, std::string_view message);
+
+    /** Serialises a message into a string to be sent, in the current wire format. */
     std::string serialiseMessage(MessagePtr message);
 
-    /** Deserialises incoming strings into messages. */
-    MessagePtr deserialiseMessage(std::string_view message);
+    /** Returns the wire format the given serialised message was sent in. */
+    static WireFormat detectWireFormat(std::string_view message);
+
+    /** Returns how to treat a message of the given type on a backlogged connection. */
+    static SendPolicy sendPolicyFor(MessageType type);
+
+    /** Returns the open connection with the given IPv4 address, or null ptr if there is none. */
+    TCPConnectionPtr findConnection(ipv4_view address);
+
+    /** Returns the connection routed to the agent with the given ID, or null ptr if there is none. */
+    TCPConnectionPtr findRoute(int agent_id);
+
+    /** Serialises the message and queues it on the connection. */
+    void queueMessage(TCPConnectionPtr connection, MessagePtr message, bool async);
+
+    /** Queues the serialised message of the given type on the connection's strand, behind every message queued on it before. */
+    void queueMessage(TCPConnectionPtr connection, TCPConnection::OutboundMessage serialised, MessageType type, bool async);
 
     /** Combines IP address with port into a single string. */
     std::string concatAddress(std::string_view address, unsigned int port);
@@ -113,6 +295,72 @@ private:
 
     /** The bidirectional map of currently open TCP connections. */
     bimap connections_;
+    std::mutex connections_mutex_;
+
+    /** The connection to each agent known by ID, guarded by the connections mutex. */
+    routing_table routes_;
+
+    /** The address of each agent known by ID that runs in this process, guarded by the connections mutex. */
+    std::unordered_map<int, ipv4_address> local_routes_;
+
+    /** The listening address messages handed over in process come from, guarded by the connections mutex. */
+    ipv4_address local_address_;
+
+    /** Messages handed over by NetworkEntities in this process, waiting to be handled on the IO context. */
+    LinkedQueue<LocalDelivery> local_inbox_;
+
+    /** Set while handling the local inbox is scheduled, so that it is scheduled once for many messages. */
+    std::atomic<bool> local_inbox_scheduled_ = false;
+
+    /** The most messages handed over in process handled before letting the IO context run other work. */
+    static constexpr size_t LOCAL_INBOX_BATCH = 256;
+
+    /** Callbacks of the agents waiting for a connection being established to each address, guarded by the connections mutex. */
+    std::unordered_map<ipv4_address, std::vector<std::function<void()>>> pending_connections_;
+
+    /** The multicast groups already joined, guarded by the connections mutex. */
+    std::unordered_set<ipv4_address> multicast_groups_;
+
+    /** A shared memory ring read on a thread of its own. */
+    struct SharedMemoryFeed
+    {
+        SharedMemoryRingPtr ring;
+        ipv4_address publisher;
+        std::atomic<bool> running = true;
+        std::thread reader;
+    };
+
+    /** The shared memory rings being read by path. Their readers never take the mutex, so it is held while one is stopped. */
+    std::unordered_map<std::string, std::unique_ptr<SharedMemoryFeed>> shared_memory_feeds_;
+    std::mutex shared_memory_feeds_mutex_;
+
+    /** How long a shared memory reader sleeps waiting for a message before checking it is still running. */
+    static constexpr std::chrono::milliseconds SHARED_MEMORY_POLL_TIMEOUT {100};
+
+    /** Reads broadcasts from the feed's ring until the feed is stopped. */
+    void readSharedMemoryFeed(SharedMemoryFeed& feed);
+
+    /** Stops reading the feed and waits for its reader to finish. */
+    static void stopSharedMemoryFeed(SharedMemoryFeed& feed);
+
+    /** The number of threads running the IO context. */
+    unsigned int io_threads_ = 1;
+
+    /** The threads running the IO context while it runs, to be pinned once the thread placement is known. */
+    std::vector<std::thread::native_handle_type> io_thread_handles_;
+    std::mutex io_thread_handles_mutex_;
+
+    /** Runs the IO context on the calling thread, pinned to the CPUs of network IO if placed. */
+    void runIOThread();
+
+    /** Counts of the messages received and sent. */
+    NetworkMetrics metrics_;
+
+    /** Serves the metrics if enabled, null ptr otherwise. */
+    std::unique_ptr<MetricsServer> metrics_server_;
+
+    /** The wide area network links emulated to peers. */
+    LinkEmulator link_emulator_ {io_context_};
 
     /** The port of this NetworkEntity. */
     unsigned int port_;
@@ -120,8 +368,24 @@ private:
     /** The IPv4 address of this NetworkEntity. */
     std::optional<std::string> addr_;
 
-    /** Pointer to an Agent. May be empty before agent is initialised. */
-    std::optional<std::shared_ptr<Agent>> agent_;
+    /** The format outgoing messages are serialised in. Adopted from the orchestrator on configuration. */
+    std::atomic<WireFormat> wire_format_ = WireFormat::BINARY;
+
+    /** Marks a binary message, followed by the wire version and the archive library version. 
+     *  Text archives always start with a digit, so the formats cannot be confused. */
+    static constexpr unsigned char BINARY_WIRE_MAGIC = 0xB1;
+    static constexpr unsigned char BINARY_WIRE_VERSION = 2;
+    static constexpr size_t BINARY_WIRE_HEADER_SIZE = 4;
+
+    /** The agents hosted by this NetworkEntity by ID. Empty before the first agent is initialised. */
+    std::unordered_map<int, std::shared_ptr<Agent>> agents_;
+    std::mutex agents_mutex_;
+
+    /** The number of agents that may be hosted at once. */
+    unsigned int max_agents_ = 1;
+
+    /** The hosted agent next given a broadcast from an unknown sender, guarded by the agents mutex. */
+    size_t next_broadcast_agent_ = 0;
 };
 
 
@@ -0,0 +1,92 @@
+#ifndef NETWORK_METRICS_HPP
+#define NETWORK_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include "../message/messagetype.hpp"
+
+/** Counts of the messages and bytes a NetworkEntity received and sent, per message type,
+ *  rendered in the Prometheus text exposition format. Counting is lock-free and safe from any thread. */
+class NetworkMetrics
+{
+public:
+
+    /** Message types are counted up to and including the last one defined. */
+    static constexpr size_t TYPE_COUNT = static_cast<size_t>(MessageType::SHARED_MEMORY_FEED) + 1;
+
+    /** Counts a message received, of the given size in bytes; zero if handed over in process. */
+    void recordIn(MessageType type, size_t bytes)
+    {
+      Counters& counters = in_[indexOf(type)];
+      counters.messages.fetch_add(1, std::memory_order_relaxed);
+      counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    };
+
+    /** Counts a message sent, of the given size in bytes; zero if handed over in process. */
+    void recordOut(MessageType type, size_t bytes)
+    {
+      Counters& counters = out_[indexOf(type)];
+      counters.messages.fetch_add(1, std::memory_order_relaxed);
+      counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    };
+
+    /** Appends the counts of the message types seen so far. */
+    void appendPrometheus(std::string& out) const
+    {
+      out += "# TYPE dsxe_messages_total counter\n";
+      appendCounts(out, "dsxe_messages_total", false);
+      out += "# TYPE dsxe_message_bytes_total counter\n";
+      appendCounts(out, "dsxe_message_bytes_total", true);
+    };
+
+    /** Returns the resident set size of this process in bytes, or zero where it cannot be read. */
+    static uint64_t residentBytes()
+    {
+      std::ifstream statm {"/proc/self/statm"};
+      uint64_t total_pages = 0;
+      uint64_t resident_pages = 0;
+      if (!(statm >> total_pages >> resident_pages)) return 0;
+      return resident_pages * static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    };
+
+private:
+
+    struct Counters
+    {
+      std::atomic<uint64_t> messages = 0;
+      std::atomic<uint64_t> bytes = 0;
+    };
+
+    /** Types from newer peers share the last slot. */
+    static size_t indexOf(MessageType type)
+    {
+      size_t index = static_cast<size_t>(type);
+      return index < TYPE_COUNT ? index : TYPE_COUNT - 1;
+    };
+
+    void appendCounts(std::string& out, const char* name, bool bytes) const
+    {
+      for (const char* direction : {"in", "out"})
+      {
+        const std::array<Counters, TYPE_COUNT>& counters = (direction[0] == 'i') ? in_ : out_;
+        for (size_t i = 0; i < TYPE_COUNT; ++i)
+        {
+          uint64_t messages = counters[i].messages.load(std::memory_order_relaxed);
+          if (messages == 0) continue;
+          uint64_t value = bytes ? counters[i].bytes.load(std::memory_order_relaxed) : messages;
+          out += std::string{name} + "{direction=\"" + direction + "\",type=\"" + to_string(static_cast<MessageType>(i))
+              + "\"} " + std::to_string(value) + "\n";
+        }
+      }
+    };
+
+    std::array<Counters, TYPE_COUNT> in_;
+    std::array<Counters, TYPE_COUNT> out_;
+};
+
+#endif
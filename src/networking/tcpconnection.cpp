@@ -1,40 +1,128 @@
 #include <iostream>
+#include <cstring>
 #include <boost/asio.hpp>
 #include <boost/system/error_code.hpp>  
 
 #include "tcpconnection.hpp"
+#include "../utilities/logger.hpp"
+#include "../utilities/tracer.hpp"
 
 namespace asio = boost::asio;
 
-asio::awaitable<void> TCPConnection::send(std::string_view message, bool async)
+asio::awaitable<void> TCPConnection::send(OutboundMessage message, bool async, SendPolicy policy)
 {
     try {
+        // Senders already held back keep their place ahead of this one
+        if (limits_.high_watermark > 0 && (queuedBytes() >= limits_.high_watermark || !blocked_senders_.empty()))
+        {
+            if (policy == SendPolicy::DROP)
+            {
+                dropped_messages_.fetch_add(1, std::memory_order_relaxed);
+                co_return;
+            }
+
+            // Wait for the writer to drain the queue, unless the connection stays stuck for too long
+            asio::steady_timer blocked {socket_.get_executor(), limits_.stall_timeout};
+            blocked_senders_.push_back(&blocked);
+            boost::system::error_code ec;
+            co_await blocked.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+            std::erase(blocked_senders_, &blocked);
+
+            if (!ec)
+            {
+                LOG_WARN("Closing stalled connection with " << queuedBytes() << " bytes queued");
+                close();
+            }
+            if (!open()) co_return;
+        }
+
         // Push message to queue
-        queue_.push(std::string{message});
+        queued_bytes_.fetch_add(message->size(), std::memory_order_relaxed);
+        queue_.push_back(std::move(message));
 
         // Notify of new message in queue
         timer_.cancel_one();
     }
     catch (std::exception& e)
     {
-        std::cout << "Failed to send message. Exception " << e.what() << "\n";
+        LOG_WARN("Failed to send message. Exception " << e.what());
     }
 
     co_return;
 }
 
-asio::awaitable<std::string> TCPConnection::read(std::string& read_buffer)
+asio::awaitable<std::string_view> TCPConnection::read()
 {
-    // Read until the delimiter
-    std::size_t n = co_await asio::async_read_until(socket_, asio::dynamic_buffer(read_buffer, 4096), "#END#", asio::use_awaitable);
+    // Release the frame returned by the previous read
+    read_start_ += consumed_;
+    consumed_ = 0;
+    if (read_start_ == read_end_)
+    {
+        read_start_ = 0;
+        read_end_ = 0;
+    }
 
-    // Extract the message from the buffer
-    std::string msg = read_buffer.substr(0, n);
+    // Read the length prefix, then the whole message
+    co_await fill(FRAME_HEADER_SIZE);
+    const unsigned char* header = reinterpret_cast<const unsigned char*>(read_buffer_.data() + read_start_);
+    size_t message_size = header[0] | (header[1] << 8) | (header[2] << 16) | (static_cast<size_t>(header[3]) << 24);
+    if (message_size > MAX_FRAME_SIZE)
+    {
+        throw std::runtime_error("Frame of " + std::to_string(message_size) + " bytes exceeds the maximum frame size");
+    }
+    {
+        TraceSpan span {TraceStage::SOCKET_READ};
+        co_await fill(FRAME_HEADER_SIZE + message_size);
+    }
+
+    consumed_ = FRAME_HEADER_SIZE + message_size;
+    co_return std::string_view{read_buffer_.data() + read_start_ + FRAME_HEADER_SIZE, message_size};
+}
 
-    // Consume the message length worth of bytes from the read buffer
-    read_buffer.erase(0, n);
-    
-    co_return msg;
+asio::awaitable<void> TCPConnection::fill(size_t size)
+{
+    while (read_end_ - read_start_ < size)
+    {
+        // Move the partial frame to the front if it would not fit, growing the buffer for large frames
+        if (read_start_ + size > read_buffer_.size())
+        {
+            std::memmove(read_buffer_.data(), read_buffer_.data() + read_start_, read_end_ - read_start_);
+            read_end_ -= read_start_;
+            read_start_ = 0;
+            if (size > read_buffer_.size())
+            {
+                read_buffer_.resize(std::max(size, 2 * read_buffer_.size()));
+            }
+        }
+
+        read_end_ += co_await socket_.async_read_some(asio::buffer(read_buffer_.data() + read_end_, read_buffer_.size() - read_end_), asio::use_awaitable);
+    }
+}
+
+std::array<unsigned char, 4> TCPConnection::frameHeader(size_t message_size)
+{
+    return {static_cast<unsigned char>(message_size & 0xFF), static_cast<unsigned char>((message_size >> 8) & 0xFF),
+        static_cast<unsigned char>((message_size >> 16) & 0xFF), static_cast<unsigned char>((message_size >> 24) & 0xFF)};
+}
+
+void TCPConnection::dequeue(size_t count)
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        bytes += queue_[i]->size();
+    }
+    queue_.erase(queue_.begin(), queue_.begin() + count);
+    queued_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+
+    // Cancelled waits resume in the order the senders were held back
+    if (!blocked_senders_.empty() && queuedBytes() <= limits_.low_watermark)
+    {
+        for (asio::steady_timer* blocked : blocked_senders_)
+        {
+            blocked->cancel();
+        }
+    }
 }
 
 bool TCPConnection::open()
@@ -51,4 +139,10 @@ void TCPConnection::close()
         socket_.shutdown(tcp::socket::shutdown_both, ec);
         socket_.close(ec);
     }
+
+    // Release held back senders so they can see the connection is gone
+    for (asio::steady_timer* blocked : blocked_senders_)
+    {
+        blocked->cancel();
+    }
 }
\ No newline at end of file
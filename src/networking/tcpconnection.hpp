@@ -1,28 +1,73 @@
 #ifndef TCP_CONNECTION_HPP
 #define TCP_CONNECTION_HPP
 
-#include <queue>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <array>
+#include <memory>
+#include <string>
 #include <boost/asio.hpp>
 
 namespace asio = boost::asio;
 using asio::ip::tcp;
 
+/** What to do with a message sent to a connection whose queue is above its high watermark. */
+enum class SendPolicy : int
+{
+    BLOCK,  // Wait until the queue drains below the low watermark, disconnecting if it stays stuck
+    DROP    // Discard the message, for updates superseded by later ones
+};
+
+/** Bounds on the outgoing queue of a connection, in bytes of queued messages. */
+struct SendQueueLimits
+{
+    /** Queue size above which senders are held back. Zero leaves the queue unbounded. */
+    size_t high_watermark = 0;
+
+    /** Queue size below which held back senders resume. */
+    size_t low_watermark = 0;
+
+    /** How long a sender may be held back before the connection is considered stalled and closed. */
+    std::chrono::milliseconds stall_timeout {10000};
+};
+
 class TCPConnection : std::enable_shared_from_this<TCPConnection>
 {
 public:
+    /** A serialised message, immutable so that it can be queued on several connections at once. */
+    typedef std::shared_ptr<const std::string> OutboundMessage;
 
-    TCPConnection(tcp::socket socket)
+    TCPConnection(tcp::socket socket, SendQueueLimits limits = {})
     : socket_{std::move(socket)},
       queue_{},
-      timer_{socket_.get_executor()}
+      timer_{socket_.get_executor()},
+      limits_{limits},
+      read_buffer_(INITIAL_READ_BUFFER_SIZE)
     {
     }
 
-    /** Queues the given message to be sent to the connected client. */
-    asio::awaitable<void> send(std::string_view message, bool async);
+    /** Queues the given message to be sent to the connected client, without copying it.
+     *  If the queue is above its high watermark the message is held back or dropped according to the policy. */
+    asio::awaitable<void> send(OutboundMessage message, bool async, SendPolicy policy = SendPolicy::BLOCK);
+
+    /** Removes the given number of sent messages from the front of the queue, resuming held back senders 
+     *  once the queue is below its low watermark. */
+    void dequeue(size_t count);
+
+    /** Returns the number of bytes of messages waiting to be sent. Safe to call from any thread. */
+    size_t queuedBytes() const { return queued_bytes_.load(std::memory_order_relaxed); };
 
-    /** Reads a message from the connected client. */
-    asio::awaitable<std::string> read(std::string& read_buffer);
+    /** Returns the number of messages dropped because the queue was full. Safe to call from any thread. */
+    size_t droppedMessages() const { return dropped_messages_.load(std::memory_order_relaxed); };
+
+    /** Reads the next message frame from the connected client. The returned view points into the
+     *  receive buffer and is only valid until the next read. */
+    asio::awaitable<std::string_view> read();
+
+    /** Returns the length prefix written in front of a message of the given size. */
+    static std::array<unsigned char, 4> frameHeader(size_t message_size);
 
     /** Closes the connection. */
     void close();
@@ -31,19 +76,46 @@ public:
     bool open();
 
     /** Returns the outgoing message queue for this connection. */
-    std::queue<std::string>& queue() { return queue_; };
+    std::deque<OutboundMessage>& queue() { return queue_; };
 
-    /** Returns the socket associated with this connection. */
+    /** Returns the socket associated with this connection. Its executor is the connection's strand, 
+     *  which every operation on the connection must run on. */
     tcp::socket& socket() { return socket_; };
 
     /** Returns the timer associated with this connection. */
     asio::steady_timer& timer() { return timer_; };
 
+    /** Size of the little-endian length prefix of each frame. */
+    static constexpr size_t FRAME_HEADER_SIZE = 4;
+
+    /** Frames announcing a larger message are treated as a corrupt stream. */
+    static constexpr size_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
 private:
 
+    /** Reads from the socket until at least size bytes of the current frame are buffered. */
+    asio::awaitable<void> fill(size_t size);
+
+    static constexpr size_t INITIAL_READ_BUFFER_SIZE = 64 * 1024;
+
     tcp::socket socket_;
-    std::queue<std::string> queue_;
+    std::deque<OutboundMessage> queue_;
     asio::steady_timer timer_;
+
+    SendQueueLimits limits_;
+    std::atomic<size_t> queued_bytes_ = 0;
+    std::atomic<size_t> dropped_messages_ = 0;
+
+    /** Timers of the senders held back until the queue drains, in the order they arrived. */
+    std::deque<asio::steady_timer*> blocked_senders_;
+
+    /** Receive buffer reused across reads. Bytes in [read_start_, read_end_) are not yet consumed. */
+    std::vector<char> read_buffer_;
+    size_t read_start_ = 0;
+    size_t read_end_ = 0;
+
+    /** Size of the frame returned by the last read, released on the next one. */
+    size_t consumed_ = 0;
 };
 
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "tcpserver.hpp"
+#include "../utilities/logger.hpp"
 #include <boost/asio.hpp>
 
 namespace asio = boost::asio;
@@ -20,23 +21,22 @@ asio::awaitable<void> TCPServer::messageListener(TCPConnectionPtr connection)
     unsigned int port { connection->socket().remote_endpoint().port() };
 
     try {
-        std::string read_buffer;
         while (true)
         {
-            std::string message = co_await connection->read(read_buffer);
+            std::string_view message = co_await connection->read();
 
             std::string response = handleMessage(address, port, message);
             if (!response.empty())
             {
-                co_await connection->send(response, false);
+                co_await connection->send(std::make_shared<const std::string>(std::move(response)), false);
             }
         }
     }
     catch (std::exception& e)
     {
         // std::cout << "TCP message listener failed" << "\n";
-        std::cout << "Connection with " << address << ":" << port << " dropped.\n";
-        std::cout << "Reason:\n" << e.what() << "\n";
+        LOG_WARN("Connection with " << address << ":" << port << " dropped.");
+        LOG_WARN("Reason:\n" << e.what());
 
         removeConnection(address, port);
     }
@@ -47,6 +47,10 @@ asio::awaitable<void> TCPServer::messageWriter(TCPConnectionPtr connection)
     std::string address { connection->socket().remote_endpoint().address().to_string() };
     unsigned int port { connection->socket().remote_endpoint().port() };
     
+    // Reused across batches
+    std::vector<std::array<unsigned char, 4>> headers;
+    std::vector<asio::const_buffer> buffers;
+
     try {
         while (connection->open())
         {
@@ -57,19 +61,37 @@ asio::awaitable<void> TCPServer::messageWriter(TCPConnectionPtr connection)
                 boost::system::error_code ec;
                 co_await connection->timer().async_wait(asio::redirect_error(asio::use_awaitable, ec));
             }
-            // Send message to the connection
+            // Send every queued message, each prefixed with its length, in one gather write up to the batch size
             else
             {
-                co_await asio::async_write(connection->socket(), asio::buffer(connection->queue().front()), asio::use_awaitable);
-                connection->queue().pop();
+                std::deque<TCPConnection::OutboundMessage>& queue = connection->queue();
+                headers.clear();
+                buffers.clear();
+                size_t batch_bytes = 0;
+                size_t batch_count = 0;
+                while (batch_count < queue.size() && (batch_count == 0 || batch_bytes + TCPConnection::FRAME_HEADER_SIZE + queue[batch_count]->size() <= max_write_batch_bytes_))
+                {
+                    batch_bytes += TCPConnection::FRAME_HEADER_SIZE + queue[batch_count]->size();
+                    headers.push_back(TCPConnection::frameHeader(queue[batch_count]->size()));
+                    ++batch_count;
+                }
+                for (size_t i = 0; i < batch_count; ++i)
+                {
+                    buffers.push_back(asio::buffer(headers[i]));
+                    buffers.push_back(asio::buffer(*queue[i]));
+                }
+
+                // Messages queued meanwhile are appended at the back, leaving the batch in place
+                co_await asio::async_write(connection->socket(), buffers, asio::use_awaitable);
+                connection->dequeue(batch_count);
             }
         }
     }
     catch (std::exception& e)
     {
         // std::cout << "TCP message writer failed" << "\n";
-        std::cout << "Connection with " << address << ":" << port << " dropped.\n";
-        std::cout << "Reason:\n" << e.what() << "\n";
+        LOG_WARN("Connection with " << address << ":" << port << " dropped.");
+        LOG_WARN("Reason:\n" << e.what());
 
         removeConnection(address, port);
     }
@@ -77,20 +99,20 @@ asio::awaitable<void> TCPServer::messageWriter(TCPConnectionPtr connection)
 
 asio::awaitable<void> TCPServer::handleAccept(tcp::socket socket)
 {
-    std::cout << "Accepted connection from " << socket.remote_endpoint() << "\n";
+    LOG_INFO("Accepted connection from " << socket.remote_endpoint());
 
     std::string address { socket.remote_endpoint().address().to_string() };
     unsigned int port { socket.remote_endpoint().port() };
     
     // Create a shared pointer to this connection and add to list
-    TCPConnectionPtr connection = std::make_shared<TCPConnection>(std::move(socket));
+    TCPConnectionPtr connection = std::make_shared<TCPConnection>(std::move(socket), send_queue_limits_);
     addConnection(address, port, connection);
 
-    // Start listening for messages from this connection
-    asio::co_spawn(io_context_, messageListener(connection), asio::detached);
+    // Start listening for messages from this connection, on the connection's strand
+    asio::co_spawn(connection->socket().get_executor(), messageListener(connection), asio::detached);
 
-    // Start a writing coroutine to send messages to this connection
-    asio::co_spawn(io_context_, messageWriter(connection), asio::detached);
+    // Start a writing coroutine to send messages to this connection, on the same strand
+    asio::co_spawn(connection->socket().get_executor(), messageWriter(connection), asio::detached);
 
     co_return;
 }
@@ -102,43 +124,54 @@ asio::awaitable<void> TCPServer::listener()
 
     while (true)
     {
-        tcp::socket socket = co_await acceptor.async_accept(asio::use_awaitable);
+        // Each connection gets its own strand so that its reads and writes never run concurrently
+        tcp::socket socket = co_await acceptor.async_accept(asio::make_strand(io_context_), asio::use_awaitable);
         asio::co_spawn(executor, handleAccept(std::move(socket)), asio::detached);
     }
 }
 
-asio::awaitable<void> TCPServer::sendMessage(TCPConnectionPtr connection, std::string message, bool async)
+asio::awaitable<void> TCPServer::sendMessage(TCPConnectionPtr connection, TCPConnection::OutboundMessage message, bool async, SendPolicy policy)
+{
+    co_await connection->send(std::move(message), async, policy);
+}
+
+void TCPServer::setMaxWriteBatch(size_t max_write_batch_bytes)
+{
+    max_write_batch_bytes_ = max_write_batch_bytes;
+}
+
+void TCPServer::setSendQueueLimits(SendQueueLimits limits)
 {
-    co_await connection->send(message, async);
+    send_queue_limits_ = limits;
 }
 
 asio::awaitable<void> TCPServer::connect(std::string address, const unsigned int port, std::function<void()> callback)
 {
     asio::ip::address addr = asio::ip::make_address(address);
     tcp::endpoint endpoint(addr, port);
-    tcp::socket socket(io_context_);
+    tcp::socket socket(asio::make_strand(io_context_));
 
     try
     {
         co_await socket.async_connect(endpoint, asio::use_awaitable);
 
         // Create a shared pointer to this connection and add to list
-        TCPConnectionPtr connection = std::make_shared<TCPConnection>(std::move(socket));
+        TCPConnectionPtr connection = std::make_shared<TCPConnection>(std::move(socket), send_queue_limits_);
         addConnection(address, port, connection);
 
         // Make a callback to the caller
         callback();
         
-        // Start listening for messages from this connection
-        asio::co_spawn(io_context_, messageListener(connection), asio::detached);
+        // Start listening for messages from this connection, on the connection's strand
+        asio::co_spawn(connection->socket().get_executor(), messageListener(connection), asio::detached);
 
-        // Start a writing coroutine to send messages to this connection
-        asio::co_spawn(io_context_, messageWriter(connection), asio::detached);
+        // Start a writing coroutine to send messages to this connection, on the same strand
+        asio::co_spawn(connection->socket().get_executor(), messageWriter(connection), asio::detached);
     }
     catch (std::exception& e)
     {
-        std::cout << "Exception: " << e.what() << std::endl;
-        std::cout << "Failed to connect to " << address << ":" << port << std::endl;
+        LOG_ERROR("Exception: " << e.what());
+        LOG_ERROR("Failed to connect to " << address << ":" << port);
         throw e;
     }
     
@@ -30,8 +30,18 @@ public:
     /** Connects to the given address and port and adds the connection to the connections list. */
     asio::awaitable<void> connect(std::string address, const unsigned int port, std::function<void()> callback);
 
-    /** Sends a message to a given connection. */
-    asio::awaitable<void> sendMessage(TCPConnectionPtr connection, std::string message, bool async);
+    /** Sends a message to a given connection, holding it back or dropping it per the policy if the connection is backlogged. */
+    asio::awaitable<void> sendMessage(TCPConnectionPtr connection, TCPConnection::OutboundMessage message, bool async, SendPolicy policy = SendPolicy::BLOCK);
+
+    /** Sets the maximum number of bytes the writer gathers from a connection's queue into one write. 
+     *  A message larger than this is still sent, on its own. */
+    void setMaxWriteBatch(size_t max_write_batch_bytes);
+
+    /** Sets the bounds of the outgoing queue of every connection opened from now on. */
+    void setSendQueueLimits(SendQueueLimits limits);
+
+    /** Returns the bounds of the outgoing queue of each connection. */
+    const SendQueueLimits& sendQueueLimits() const { return send_queue_limits_; };
 
 
     /** Derived classes must implement the following: */
@@ -61,6 +71,12 @@ private:
 
     const unsigned short tcp_port_;
     asio::io_context& io_context_;
+
+    /** Maximum number of bytes gathered into one write. */
+    size_t max_write_batch_bytes_ = 64 * 1024;
+
+    /** Bounds of the outgoing queue of each connection. */
+    SendQueueLimits send_queue_limits_;
 };
 
 #endif
\ No newline at end of file
@@ -10,10 +10,23 @@ asio::awaitable<void> UDPServer::start()
 {
     // std::cout << "Starting a UDP server on port " << udp_port_ << "\n";
 
-    co_await listener();
+    co_await listener(socket_);
 }
 
-asio::awaitable<void> UDPServer::listener()
+void UDPServer::joinMulticastGroup(std::string_view group_address, const unsigned int port)
+{
+    // Several agents on one host may join the same group, so the port is shared
+    std::unique_ptr<udp::socket> socket = std::make_unique<udp::socket>(asio::make_strand(io_context_));
+    socket->open(udp::v4());
+    socket->set_option(udp::socket::reuse_address(true));
+    socket->bind(udp::endpoint(asio::ip::address_v4::any(), port));
+    socket->set_option(asio::ip::multicast::join_group(asio::ip::make_address_v4(group_address)));
+
+    asio::co_spawn(socket->get_executor(), listener(*socket), asio::detached);
+    multicast_sockets_.push_back(std::move(socket));
+}
+
+asio::awaitable<void> UDPServer::listener(udp::socket& socket)
 {
     auto executor = co_await asio::this_coro::executor;
     // std::cout << "Listening for UDP on port " << udp_port_ << "\n";
@@ -23,10 +36,9 @@ asio::awaitable<void> UDPServer::listener()
     while (true)
     {
         udp::endpoint endpoint;
-        std::size_t n = co_await socket_.async_receive_from(asio::buffer(data), endpoint, asio::use_awaitable);
+        std::size_t n = co_await socket.async_receive_from(asio::buffer(data), endpoint, asio::use_awaitable);
         
-        std::string message(data, n);
-        handleBroadcast(endpoint.address().to_string(), endpoint.port(), message);
+        handleBroadcast(endpoint.address().to_string(), endpoint.port(), std::string_view{data, n});
     }
 }
 
@@ -42,4 +54,9 @@ asio::awaitable<void> UDPServer::sendBroadcast(udp::endpoint endpoint, std::stri
 {
     // std::cout << "Sending broadcast\n";
     co_await socket_.async_send_to(asio::buffer(message), endpoint, asio::use_awaitable);
+}
+
+asio::awaitable<void> UDPServer::sendBroadcast(udp::endpoint endpoint, std::shared_ptr<const std::string> message)
+{
+    co_await socket_.async_send_to(asio::buffer(*message), endpoint, asio::use_awaitable);
 }
\ No newline at end of file
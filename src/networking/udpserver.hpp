@@ -2,6 +2,8 @@
 #define UDP_SERVER_HPP
 
 #include <iostream>
+#include <memory>
+#include <vector>
 #include <boost/asio.hpp>
 
 namespace asio = boost::asio;
@@ -15,7 +17,7 @@ public:
     UDPServer(asio::io_context& io_context, unsigned short port)
     : io_context_(io_context), 
       udp_port_{port},
-      socket_{io_context_, udp::endpoint(udp::v4(), port)}
+      socket_{asio::make_strand(io_context_), udp::endpoint(udp::v4(), port)}
     {
     }
 
@@ -28,17 +30,29 @@ public:
     /** Sends a UDP broadcast message to the given UDP endpoint. */
     asio::awaitable<void> sendBroadcast(udp::endpoint endpoint, std::string message);
 
+    /** Sends a UDP broadcast message shared between several sends to the given UDP endpoint. */
+    asio::awaitable<void> sendBroadcast(udp::endpoint endpoint, std::shared_ptr<const std::string> message);
+
+    /** Joins the given multicast group and passes the broadcasts sent to it to handleBroadcast. */
+    void joinMulticastGroup(std::string_view group_address, const unsigned int port);
+
+    /** Returns the strand that operations on the broadcast socket run on. */
+    udp::socket::executor_type broadcastExecutor() { return socket_.get_executor(); };
+
     /** Handles an incoming UDP broadcast. */
     virtual void handleBroadcast(std::string_view sender_address, unsigned int sender_port, std::string_view message) = 0;
 
 private:
 
-    /** Listens for incoming UDP broadcasts. */
-    asio::awaitable<void> listener();
+    /** Listens for incoming UDP broadcasts on the given socket. */
+    asio::awaitable<void> listener(udp::socket& socket);
 
     const unsigned short udp_port_;
     asio::io_context& io_context_;
     udp::socket socket_;
+
+    /** Sockets bound to the port of each multicast group joined. */
+    std::vector<std::unique_ptr<udp::socket>> multicast_sockets_;
 };
 
 #endif
\ No newline at end of file
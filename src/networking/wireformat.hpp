@@ -0,0 +1,28 @@
+#ifndef WIRE_FORMAT_HPP
+#define WIRE_FORMAT_HPP
+
+#include <string>
+
+enum class WireFormat : int
+{
+    TEXT,   // Boost text archives, human readable for debugging
+    BINARY  // Boost binary archives behind a versioned wire header
+};
+
+inline std::string to_string(WireFormat wire_format)
+{
+    switch (wire_format) {
+        case WireFormat::TEXT: return std::string{"text"};
+        case WireFormat::BINARY: return std::string{"binary"};
+        default: return std::string{""};
+    }
+}
+
+/** Returns the wire format for the given name. Defaults to the binary format. */
+inline WireFormat wire_format_from_string(std::string_view name)
+{
+    if (name == "text") return WireFormat::TEXT;
+    return WireFormat::BINARY;
+}
+
+#endif
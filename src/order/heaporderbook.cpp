@@ -0,0 +1,228 @@
+#include <iostream>
+
+#include "heaporderbook.hpp"
+#include "../utilities/logger.hpp"
+
+void HeapOrderBook::addOrder(LimitOrderPtr order)
+{
+    if (order->side == Order::Side::BID)
+    {
+        bids_.push(order);
+        bids_volume_ += order->remaining_quantity;
+        addToLevel(bids_sizes_, order);
+    }
+    else
+    {
+        asks_.push(order);
+        asks_volume_ += order->remaining_quantity;
+        addToLevel(asks_sizes_, order);
+    }
+    ++order_count_;
+}
+
+std::optional<LimitOrderPtr> HeapOrderBook::removeOrder(int order_id, Order::Side side)
+{
+    if (side == Order::Side::BID)
+    {
+        std::optional<LimitOrderPtr> order = bids_.remove(order_id);
+        if (order.has_value())
+        {
+            bids_volume_ -= order.value()->remaining_quantity;
+            removeFromLevel(bids_sizes_, order.value());
+            --order_count_;
+        }
+        return order;
+    }
+    else
+    {
+        std::optional<LimitOrderPtr> order = asks_.remove(order_id);
+        if (order.has_value())
+        {
+            asks_volume_ -= order.value()->remaining_quantity;
+            removeFromLevel(asks_sizes_, order.value());
+            --order_count_;
+        }
+        return order;
+    }
+}
+
+std::optional<LimitOrderPtr> HeapOrderBook::amendOrder(int order_id, Order::Side side, int price, int quantity)
+{
+    OrderQueue& queue = (side == Order::Side::BID) ? bids_ : asks_;
+    level_map& sizes = (side == Order::Side::BID) ? bids_sizes_ : asks_sizes_;
+    int& volume = (side == Order::Side::BID) ? bids_volume_ : asks_volume_;
+
+    std::optional<LimitOrderPtr> found = queue.find(order_id);
+    if (!found.has_value())
+    {
+        return std::nullopt;
+    }
+
+    LimitOrderPtr order = found.value();
+    removeFromLevel(sizes, order);
+    volume -= order->remaining_quantity;
+    if (price == order->price && quantity <= order->remaining_quantity)
+    {
+        // Neither the price nor the time the heap is ordered by changes, so the order is amended in place without a new heap entry
+        order->remaining_quantity = quantity;
+    }
+    else
+    {
+        // The heap entry cannot be reordered, so a copy at the new price replaces it;
+        // the old entry is dropped once it reaches the top or the queue compacts its heap
+        queue.remove(order_id);
+        order = std::static_pointer_cast<LimitOrder>(order->clone());
+        order->requeue();
+        order->price = price;
+        order->remaining_quantity = quantity;
+        queue.push(order);
+    }
+    addToLevel(sizes, order);
+    volume += quantity;
+    return order;
+}
+
+std::optional<LimitOrderPtr> HeapOrderBook::findOrder(int order_id, Order::Side side)
+{
+    return (side == Order::Side::BID) ? bids_.find(order_id) : asks_.find(order_id);
+}
+
+std::optional<LimitOrderPtr> HeapOrderBook::bestBid() 
+{
+    if (bids_.empty())
+    {
+        return std::nullopt;
+    }
+    return bids_.top();
+}
+
+std::optional<LimitOrderPtr> HeapOrderBook::worstBid()
+{
+    return bids_.worst();
+}
+
+int HeapOrderBook::bestBidSize()
+{
+    std::optional<LimitOrderPtr> best_bid = bestBid();
+    if (best_bid.has_value())
+    {
+        return bids_sizes_.at(best_bid.value()->price).quantity;
+    }
+    else 
+    {
+        return 0;
+    }
+}
+
+std::optional<LimitOrderPtr> HeapOrderBook::bestAsk() 
+{
+    if (asks_.empty())
+    {
+        return std::nullopt;
+    }
+    return asks_.top();
+}
+
+std::optional<LimitOrderPtr> HeapOrderBook::worstAsk()
+{
+    return asks_.worst();
+}
+
+int HeapOrderBook::bestAskSize()
+{
+    std::optional<LimitOrderPtr> best_ask = bestAsk();
+    if (best_ask.has_value())
+    {
+        return asks_sizes_.at(best_ask.value()->price).quantity;
+    }
+    else 
+    {
+        return 0;
+    }
+}
+
+void HeapOrderBook::popBestBid()
+{
+    if (!bids_.empty())
+    {
+        bids_volume_ -= bids_.top()->remaining_quantity;
+        LOG_DEBUG(bids_volume_);
+        removeFromLevel(bids_sizes_, bids_.top());
+        bids_.pop();
+        --order_count_;
+    }
+}
+
+void HeapOrderBook::popBestAsk()
+{
+    if (!asks_.empty())
+    {
+        asks_volume_ -= asks_.top()->remaining_quantity;
+        LOG_DEBUG(asks_volume_);
+        removeFromLevel(asks_sizes_, asks_.top());
+        asks_.pop();
+        --order_count_;
+    }
+}
+
+bool HeapOrderBook::contains(int order_id, Order::Side side)
+{
+    if (side == Order::Side::BID)
+    {
+        return bids_.find(order_id).has_value();
+    }
+    else
+    {
+        return asks_.find(order_id).has_value();
+    }
+}
+
+void HeapOrderBook::walkDepth(Order::Side side, const std::function<bool(int, int, int)>& visit)
+{
+    if (side == Order::Side::BID)
+    {
+        for (auto level = bids_sizes_.rbegin(); level != bids_sizes_.rend(); ++level)
+        {
+            if (!visit(level->first, level->second.quantity, level->second.count)) return;
+        }
+    }
+    else
+    {
+        for (auto level = asks_sizes_.begin(); level != asks_sizes_.end(); ++level)
+        {
+            if (!visit(level->first, level->second.quantity, level->second.count)) return;
+        }
+    }
+}
+
+void HeapOrderBook::walkOrders(Order::Side side, const std::function<bool(const LimitOrderPtr&)>& visit)
+{
+    (side == Order::Side::BID) ? bids_.walk(visit) : asks_.walk(visit);
+}
+
+int HeapOrderBook::bidsCount()
+{
+    return bids_.size();
+}
+
+int HeapOrderBook::asksCount()
+{
+    return asks_.size();
+}
+
+void HeapOrderBook::addToLevel(level_map& levels, const LimitOrderPtr& order)
+{
+    LevelSize& level = levels[order->price];
+    level.quantity += order->remaining_quantity;
+    ++level.count;
+}
+
+void HeapOrderBook::removeFromLevel(level_map& levels, const LimitOrderPtr& order)
+{
+    auto level = levels.find(order->price);
+    level->second.quantity -= order->remaining_quantity;
+    if (--level->second.count == 0)
+    {
+        levels.erase(level);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef HEAP_ORDERBOOK_HPP
+#define HEAP_ORDERBOOK_HPP
+
+#include <map>
+#include <optional>
+
+#include "orderbook.hpp"
+#include "orderqueue.hpp"
+
+/** Order book storing resting orders of each side in a priority queue. */
+class HeapOrderBook : public OrderBook {
+public:
+
+    HeapOrderBook(std::string_view ticker, TickSize tick_size)
+    : OrderBook(ticker, tick_size),
+      bids_{Order::Side::BID},
+      asks_{Order::Side::ASK}
+    {
+    }
+
+    void addOrder(LimitOrderPtr order) override;
+
+    std::optional<LimitOrderPtr> removeOrder(int order_id, Order::Side side) override;
+
+    std::optional<LimitOrderPtr> amendOrder(int order_id, Order::Side side, int price, int quantity) override;
+
+    std::optional<LimitOrderPtr> findOrder(int order_id, Order::Side side) override;
+
+    std::optional<LimitOrderPtr> bestBid() override;
+
+    std::optional<LimitOrderPtr> worstBid() override;
+
+    std::optional<LimitOrderPtr> bestAsk() override;
+
+    std::optional<LimitOrderPtr> worstAsk() override;
+
+    int bestBidSize() override;
+
+    int bestAskSize() override;
+
+    void popBestBid() override;
+
+    void popBestAsk() override;
+
+    bool contains(int order_id, Order::Side side) override;
+
+    void walkDepth(Order::Side side, const std::function<bool(int, int, int)>& visit) override;
+
+    void walkOrders(Order::Side side, const std::function<bool(const LimitOrderPtr&)>& visit) override;
+
+    int bidsCount() override;
+
+    int asksCount() override;
+
+private:
+
+    /** Aggregate size and number of the orders resting at a price. */
+    struct LevelSize
+    {
+        int quantity = 0;
+        int count = 0;
+    };
+
+    typedef std::map<int, LevelSize> level_map;
+
+    /** Adds the order to the aggregate of its price level. */
+    static void addToLevel(level_map& levels, const LimitOrderPtr& order);
+
+    /** Removes the order from the aggregate of its price level, dropping the level once empty. */
+    static void removeFromLevel(level_map& levels, const LimitOrderPtr& order);
+
+    OrderQueue bids_;
+    OrderQueue asks_;
+
+    /** Aggregates of all price levels of each side, maintained as orders are added and removed. */
+    level_map bids_sizes_;
+    level_map asks_sizes_;
+};
+
+#endif
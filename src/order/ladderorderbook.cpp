@@ -0,0 +1,145 @@
+#include "ladderorderbook.hpp"
+
+void LadderOrderBook::addOrder(LimitOrderPtr order)
+{
+    ladder(order->side).push(order);
+    if (order->side == Order::Side::BID)
+    {
+        bids_volume_ += order->remaining_quantity;
+    }
+    else
+    {
+        asks_volume_ += order->remaining_quantity;
+    }
+    ++order_count_;
+}
+
+std::optional<LimitOrderPtr> LadderOrderBook::removeOrder(int order_id, Order::Side side)
+{
+    std::optional<LimitOrderPtr> order = ladder(side).remove(order_id);
+    if (order.has_value())
+    {
+        if (side == Order::Side::BID)
+        {
+            bids_volume_ -= order.value()->remaining_quantity;
+        }
+        else
+        {
+            asks_volume_ -= order.value()->remaining_quantity;
+        }
+        --order_count_;
+    }
+    return order;
+}
+
+std::optional<LimitOrderPtr> LadderOrderBook::amendOrder(int order_id, Order::Side side, int price, int quantity)
+{
+    std::optional<LimitOrderPtr> order = ladder(side).find(order_id);
+    if (order.has_value())
+    {
+        int change = quantity - order.value()->remaining_quantity;
+        ladder(side).amend(order_id, price, quantity);
+        if (side == Order::Side::BID)
+        {
+            bids_volume_ += change;
+        }
+        else
+        {
+            asks_volume_ += change;
+        }
+    }
+    return order;
+}
+
+std::optional<LimitOrderPtr> LadderOrderBook::findOrder(int order_id, Order::Side side)
+{
+    return ladder(side).find(order_id);
+}
+
+std::optional<LimitOrderPtr> LadderOrderBook::bestBid()
+{
+    if (bids_.empty())
+    {
+        return std::nullopt;
+    }
+    return bids_.top();
+}
+
+std::optional<LimitOrderPtr> LadderOrderBook::worstBid()
+{
+    return bids_.worst();
+}
+
+std::optional<LimitOrderPtr> LadderOrderBook::bestAsk()
+{
+    if (asks_.empty())
+    {
+        return std::nullopt;
+    }
+    return asks_.top();
+}
+
+std::optional<LimitOrderPtr> LadderOrderBook::worstAsk()
+{
+    return asks_.worst();
+}
+
+int LadderOrderBook::bestBidSize()
+{
+    return bids_.bestLevelSize();
+}
+
+int LadderOrderBook::bestAskSize()
+{
+    return asks_.bestLevelSize();
+}
+
+void LadderOrderBook::popBestBid()
+{
+    if (!bids_.empty())
+    {
+        bids_volume_ -= bids_.top()->remaining_quantity;
+        bids_.pop();
+        --order_count_;
+    }
+}
+
+void LadderOrderBook::popBestAsk()
+{
+    if (!asks_.empty())
+    {
+        asks_volume_ -= asks_.top()->remaining_quantity;
+        asks_.pop();
+        --order_count_;
+    }
+}
+
+bool LadderOrderBook::contains(int order_id, Order::Side side)
+{
+    return ladder(side).find(order_id).has_value();
+}
+
+void LadderOrderBook::walkDepth(Order::Side side, const std::function<bool(int, int, int)>& visit)
+{
+    ladder(side).walkLevels(visit);
+}
+
+void LadderOrderBook::walkOrders(Order::Side side, const std::function<bool(const LimitOrderPtr&)>& visit)
+{
+    ladder(side).walkOrders(visit);
+}
+
+int LadderOrderBook::bidsCount()
+{
+    return bids_.size();
+}
+
+int LadderOrderBook::asksCount()
+{
+    return asks_.size();
+}
+
+OrderLadder& LadderOrderBook::ladder(Order::Side side)
+{
+    return (side == Order::Side::BID) ? bids_ : asks_;
+}
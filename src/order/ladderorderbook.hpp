@@ -0,0 +1,63 @@
+#ifndef LADDER_ORDERBOOK_HPP
+#define LADDER_ORDERBOOK_HPP
+
+#include <optional>
+
+#include "orderbook.hpp"
+#include "orderladder.hpp"
+
+/** Order book storing resting orders of each side in a ladder of price levels. */
+class LadderOrderBook : public OrderBook {
+public:
+
+    LadderOrderBook(std::string_view ticker, TickSize tick_size)
+    : OrderBook(ticker, tick_size),
+      bids_{Order::Side::BID},
+      asks_{Order::Side::ASK}
+    {
+    }
+
+    void addOrder(LimitOrderPtr order) override;
+
+    std::optional<LimitOrderPtr> removeOrder(int order_id, Order::Side side) override;
+
+    std::optional<LimitOrderPtr> amendOrder(int order_id, Order::Side side, int price, int quantity) override;
+
+    std::optional<LimitOrderPtr> findOrder(int order_id, Order::Side side) override;
+
+    std::optional<LimitOrderPtr> bestBid() override;
+
+    std::optional<LimitOrderPtr> worstBid() override;
+
+    std::optional<LimitOrderPtr> bestAsk() override;
+
+    std::optional<LimitOrderPtr> worstAsk() override;
+
+    int bestBidSize() override;
+
+    int bestAskSize() override;
+
+    void popBestBid() override;
+
+    void popBestAsk() override;
+
+    bool contains(int order_id, Order::Side side) override;
+
+    void walkDepth(Order::Side side, const std::function<bool(int, int, int)>& visit) override;
+
+    void walkOrders(Order::Side side, const std::function<bool(const LimitOrderPtr&)>& visit) override;
+
+    int bidsCount() override;
+
+    int asksCount() override;
+
+private:
+
+    /** Returns the ladder for the given side. */
+    OrderLadder& ladder(Order::Side side);
+
+    OrderLadder bids_;
+    OrderLadder asks_;
+};
+
+#endif
@@ -11,6 +11,12 @@ public:
     LimitOrder(int order_id)
     : Order(order_id, Order::Type::LIMIT) {};
 
+    std::shared_ptr<Order> clone() const override
+    {
+        return std::make_shared<LimitOrder>(*this);
+    }
+
+    /** Limit price in ticks of the ticker's tick size. */
     int price;
 
 private:
@@ -11,6 +11,11 @@ public:
     MarketOrder(int order_id) 
     : Order(order_id, Order::Type::MARKET, Order::TimeInForce::IOC) {};
 
+    std::shared_ptr<Order> clone() const override
+    {
+        return std::make_shared<MarketOrder>(*this);
+    }
+
 private:
 
     friend std::ostream& operator<<(std::ostream& os, const MarketOrder& order)
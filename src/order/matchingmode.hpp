@@ -0,0 +1,28 @@
+#ifndef MATCHING_MODE_HPP
+#define MATCHING_MODE_HPP
+
+#include <string>
+
+enum class MatchingMode : int
+{
+    CONTINUOUS,   // Orders are matched on arrival
+    CALL_AUCTION  // Orders are batched and uncrossed at a single clearing price at every interval
+};
+
+inline std::string to_string(MatchingMode mode)
+{
+    switch (mode) {
+        case MatchingMode::CONTINUOUS: return std::string{"continuous"};
+        case MatchingMode::CALL_AUCTION: return std::string{"auction"};
+        default: return std::string{""};
+    }
+}
+
+/** Returns the matching mode for the given name. Defaults to continuous matching. */
+inline MatchingMode matching_mode_from_string(std::string_view name)
+{
+    if (name == "auction") return MatchingMode::CALL_AUCTION;
+    return MatchingMode::CONTINUOUS;
+}
+
+#endif
@@ -11,6 +11,7 @@
 #include <boost/serialization/shared_ptr.hpp>
 
 #include "../trade/trade.hpp"
+#include "../utilities/simulationclock.hpp"
 
 class OrderFactory;
 
@@ -27,7 +28,8 @@ public:
         NEW,
         FILLED,
         PARTIALLY_FILLED,
-        CANCELLED
+        CANCELLED,
+        REJECTED                     // Turned away by the exchange before reaching the book
     };
 
     enum class Type: int {
@@ -47,8 +49,7 @@ public:
     : id{order_id},
       type{type}
     {
-        std::chrono::system_clock::duration now = std::chrono::system_clock::now().time_since_epoch();
-        timestamp_created = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+        timestamp_created = SimulationClock::nowNanos();
     }
 
     Order(int order_id, Type type, TimeInForce time_in_force)
@@ -56,8 +57,7 @@ public:
       type{type},
       time_in_force{time_in_force}
     {
-        std::chrono::system_clock::duration now = std::chrono::system_clock::now().time_since_epoch();
-        timestamp_created = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+        timestamp_created = SimulationClock::nowNanos();
     }
 
     virtual ~Order() = default;
@@ -72,11 +72,22 @@ public:
         status = new_status;
         if (new_status == Order::Status::FILLED)
         {
-            std::chrono::system_clock::duration now = std::chrono::system_clock::now().time_since_epoch();
-            timestamp_executed = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+            timestamp_executed = SimulationClock::nowNanos();
         }
     }
 
+    /** Restamps the order as created now, so that it queues behind every order already resting at its price. */
+    void requeue()
+    {
+        timestamp_created = SimulationClock::nowNanos();
+    }
+
+    /** Returns a copy of the order as it stands now, unaffected by later fills. */
+    virtual std::shared_ptr<Order> clone() const
+    {
+        return std::make_shared<Order>(*this);
+    }
+
     int id;
     int client_order_id;
     int sender_id;
@@ -84,6 +95,7 @@ public:
     Order::Type type;
     Order::TimeInForce time_in_force;
     std::string ticker;
+    uint16_t symbol = 0; // Symbol ID the exchange gave the ticker, indexing its state of the ticker; not sent
     Order::Side side;
     Order::Status status;
     double avg_price;
@@ -113,6 +125,9 @@ protected:
             case Order::Status::CANCELLED:
                 os << "CANCELLED";
                 break;
+            case Order::Status::REJECTED:
+                os << "REJECTED";
+                break;
         }
         return os;
     
@@ -4,51 +4,27 @@
 
 #include "order.hpp"
 #include "orderbook.hpp"
+#include "heaporderbook.hpp"
+#include "ladderorderbook.hpp"
+#include "../utilities/logger.hpp"
 
 #include <boost/serialization/export.hpp>
 
 BOOST_CLASS_EXPORT(MarketData);
 
-void OrderBook::addOrder(LimitOrderPtr order)
+OrderBookPtr OrderBook::create(std::string_view ticker, OrderBookType type, TickSize tick_size)
 {
-    if (order->side == Order::Side::BID)
+    switch (type)
     {
-        bids_.push(order);
-        bids_volume_ += order->remaining_quantity;
-        bids_sizes_[order->price] += order->remaining_quantity;
-    }
-    else
-    {
-        asks_.push(order);
-        asks_volume_ += order->remaining_quantity;
-        asks_sizes_[order->price] += order->remaining_quantity;
-    }
-    ++order_count_;
-}
-
-std::optional<LimitOrderPtr> OrderBook::removeOrder(int order_id, Order::Side side)
-{
-    if (side == Order::Side::BID)
-    {
-        std::optional<LimitOrderPtr> order = bids_.remove(order_id);
-        if (order.has_value())
+        case OrderBookType::LADDER:
         {
-            bids_volume_ -= order.value()->remaining_quantity;
-            bids_sizes_[order.value()->price] -= order.value()->remaining_quantity;
-            --order_count_;
+            return std::make_shared<LadderOrderBook>(ticker, tick_size);
         }
-        return order;
-    }
-    else
-    {
-        std::optional<LimitOrderPtr> order = asks_.remove(order_id);
-        if (order.has_value())
+        case OrderBookType::HEAP:
+        default:
         {
-            asks_volume_ -= order.value()->remaining_quantity;
-            asks_sizes_[order.value()->price] -= order.value()->remaining_quantity;
-            --order_count_;
+            return std::make_shared<HeapOrderBook>(ticker, tick_size);
         }
-        return order;
     }
 }
 
@@ -72,192 +48,32 @@ void OrderBook::updateOrderWithTrade(OrderPtr order, TradePtr trade)
     }
 }
 
-std::optional<LimitOrderPtr> OrderBook::bestBid() 
-{
-    if (bids_.empty())
-    {
-        return std::nullopt;
-    }
-    return bids_.top();
-}
-
-std::optional<LimitOrderPtr> OrderBook::worstBid() 
-{
-    if (bids_.empty()) 
-    {
-        return std::nullopt;
-    }
-
-    // Convert priority queue to a vector (inefficient but works)
-    std::vector<LimitOrderPtr> all_orders;
-    auto copy = bids_;  // Make a copy since we cannot iterate directly
-
-    while (!copy.empty()) 
-    {
-        all_orders.push_back(copy.top());
-        copy.pop();
-    }
-
-    // Worst bid is the lowest price order
-    auto worst_bid = *std::min_element(all_orders.begin(), all_orders.end(), 
-        [](const LimitOrderPtr& a, const LimitOrderPtr& b) { return a->price < b->price; });
-
-    return worst_bid;
-}
-
-
-int OrderBook::bestBidSize()
-{
-    std::optional<LimitOrderPtr> best_bid = bestBid();
-    if (best_bid.has_value())
-    {
-        return bids_sizes_.at(best_bid.value()->price);
-    }
-    else 
-    {
-        return 0;
-    }
-}
-
-std::optional<LimitOrderPtr> OrderBook::bestAsk() 
-{
-    if (asks_.empty())
-    {
-        return std::nullopt;
-    }
-    return asks_.top();
-}
-
-std::optional<LimitOrderPtr> OrderBook::worstAsk() 
-{
-    if (asks_.empty()) 
-    {
-        return std::nullopt;
-    }
-
-    // Convert priority queue to a vector (inefficient but works)
-    std::vector<LimitOrderPtr> all_orders;
-    auto copy = asks_;  // Make a copy since we cannot iterate directly
-
-    while (!copy.empty()) 
-    {
-        all_orders.push_back(copy.top());
-        copy.pop();
-    }
-
-    // Worst ask is the highest price order
-    auto worst_ask = *std::max_element(all_orders.begin(), all_orders.end(), 
-        [](const LimitOrderPtr& a, const LimitOrderPtr& b) { return a->price < b->price; });
-
-    return worst_ask;
-}
-
-
-int OrderBook::bestAskSize()
-{
-    std::optional<LimitOrderPtr> best_ask = bestAsk();
-    if (best_ask.has_value())
-    {
-        return asks_sizes_.at(best_ask.value()->price);
-    }
-    else 
-    {
-        return 0;
-    }
-}
-
-void OrderBook::popBestBid()
-{
-    if (!bids_.empty())
-    {
-        bids_volume_ -= bids_.top()->remaining_quantity;
-        std::cout << bids_volume_ << "\n";
-        bids_sizes_[bids_.top()->price] -= bids_.top()->remaining_quantity;
-        bids_.pop();
-        --order_count_;
-    }
-}
-
-void OrderBook::popBestAsk()
-{
-    if (!asks_.empty())
-    {
-        asks_volume_ -= asks_.top()->remaining_quantity;
-        std::cout << asks_volume_ << "\n";
-        asks_sizes_[asks_.top()->price] -= asks_.top()->remaining_quantity;
-        asks_.pop();
-        --order_count_;
-    }
-}
-
-bool OrderBook::contains(int order_id, Order::Side side)
-{
-    if (side == Order::Side::BID)
-    {
-        return bids_.find(order_id).has_value();
-    }
-    else
-    {
-        return asks_.find(order_id).has_value();
-    }
-}
-
-void OrderBook::updateRollingWindow(double high_price, double low_price)
+void OrderBook::logTrade(TradePtr trade)
 {
-    high_prices_.push_back(high_price);
-    low_prices_.push_back(low_price);
-    if (high_prices_.size() > lookback_period_)
-    {
-        high_prices_.pop_front();
-        low_prices_.pop_front();
-    }
+    time_diff_ = last_trade_.has_value() ? trade->timestamp - last_trade_.value()->timestamp : 0; // The first trade has no previous one
+    last_trade_ = trade;
+    trade_stats_.add(trade->price, trade->quantity, trade->timestamp);
+    trade_volume_ += trade->quantity;
+    ++trade_count_;
 }
 
-std::optional<double> OrderBook::calculateHigh()
+void OrderBook::setTradeStatsWindow(TradeStatsWindow window)
 {
-    if (high_prices_.empty()) return std::nullopt;
-    return *std::max_element(high_prices_.begin(), high_prices_.end());
+    trade_stats_ = RollingTradeStats{window};
 }
 
-std::optional<double> OrderBook::calculateLow()
+OrderBook::TradeStatistics OrderBook::tradeStatistics() const
 {
-    if (low_prices_.empty()) return std::nullopt;
-    return *std::min_element(low_prices_.begin(), low_prices_.end());
+    return TradeStatistics{last_trade_, time_diff_, trade_volume_, trade_count_, trade_stats_};
 }
 
-void OrderBook::logTrade(TradePtr trade)
+void OrderBook::restoreTradeStatistics(const TradeStatistics& statistics)
 {
-    std::cout << "Logging trade: Price = " << trade->price << ", Quantity = " << trade->quantity << ", Timestamp = " << trade->timestamp << "\n";
-
-    // Compute time difference using previous timestamp (for LOB)
-    if (last_trade_.has_value())
-    {
-        time_diff_ = trade->timestamp - last_trade_.value()->timestamp;
-        std::cout << "Last trade timestamp: " << last_trade_.value()->timestamp << "\n"; // Debug statement for last trade timestamp
-        std::cout << "Time difference between current and last trade: " << time_diff_ << " nanoseconds\n"; // Debug statement for time difference
-    } 
-    else 
-    { 
-        time_diff_ = 0; // For first trade the time diff would be set to 0
-    }
-
-    // Debug statement to print last trade details
-    if (last_trade_.has_value())
-    {
-        std::cout << "Last trade details: Price = " << last_trade_.value()->price 
-                  << ", Quantity = " << last_trade_.value()->quantity 
-                  << ", Timestamp = " << last_trade_.value()->timestamp << "\n";
-    }
-
-    last_trade_ = trade;
-    updateRollingWindow(trade->price, trade->price);
-    trade_high_ = calculateHigh();
-    trade_low_ = calculateLow();
-    trade_volume_ += trade->quantity;
-    ++trade_count_;
-
-    // Print updated high and low prices
-    std::cout << "Updated High Price: " << trade_high_.value() << ", Updated Low Price: " << trade_low_.value() << "\n";
+    last_trade_ = statistics.last_trade;
+    time_diff_ = statistics.time_diff;
+    trade_volume_ = statistics.trade_volume;
+    trade_count_ = statistics.trade_count;
+    trade_stats_ = statistics.rolling;
 }
 
 double OrderBook::getTotalBidVolume()
@@ -281,7 +97,7 @@ double OrderBook::calculateMidPrice()
         return 0; 
     }
 
-    return (best_bid.value()->price + best_ask.value()->price) / 2; // Calculate mid price as average of best bid and best ask prices
+    return tick_size_.toPrice(best_bid.value()->price + best_ask.value()->price) / 2; // Calculate mid price as average of best bid and best ask prices
 } 
 
 // Micro Price = Weighted average of best bid and best ask prices in the LOB snapshot of the current time
@@ -295,8 +111,8 @@ double OrderBook::calculateMicroPrice()
         return 0; 
     }
     
-    double best_bid_price = best_bid.value()->price;
-    double best_ask_price = best_ask.value()->price;
+    double best_bid_price = tick_size_.toPrice(best_bid.value()->price);
+    double best_ask_price = tick_size_.toPrice(best_ask.value()->price);
     int best_bid_size = bestBidSize();
     int best_ask_size = bestAskSize(); 
 
@@ -330,7 +146,7 @@ double OrderBook::calculateSpread()
     }
 
     // Ensure spread is calculated correctly
-    double spread = std::abs(best_ask.value()->price - best_bid.value()->price);
+    double spread = tick_size_.toPrice(std::abs(best_ask.value()->price - best_bid.value()->price));
 
     // Return spread
     return spread; 
@@ -339,48 +155,74 @@ double OrderBook::calculateSpread()
 
 
 
-MarketDataPtr OrderBook::getLiveMarketData(Order::Side aggressing_side)
+MarketDataPtr OrderBook::getLiveMarketData(Order::Side aggressing_side, MarketDataFields fields)
 {
     MarketDataPtr data = std::make_shared<MarketData>();
     data->ticker = ticker_;
-    data->best_bid = bestBid().has_value() ? bestBid().value()->price : 0;
-    data->best_ask = bestAsk().has_value() ? bestAsk().value()->price : 0;
+    data->fields = fields;
+    data->best_bid = bestBid().has_value() ? tick_size_.toPrice(bestBid().value()->price) : 0;
+    data->best_ask = bestAsk().has_value() ? tick_size_.toPrice(bestAsk().value()->price) : 0;
     data->best_bid_size = bestBidSize();
     data->best_ask_size = bestAskSize();
 
-    data->asks_volume = asks_volume_;
-    data->bids_volume = bids_volume_;
-    data->asks_count = asks_.size();
-    data->bids_count = bids_.size();
-
     data->last_price_traded = last_trade_.has_value() ? last_trade_.value()->price : 0;
     data->last_quantity_traded = last_trade_.has_value() ? last_trade_.value()->quantity : 0;
+    data->cumulative_volume_traded = trade_volume_;
+    data->trades_count = trade_count_;
 
-    data->high_price = trade_high_.has_value() ? trade_high_.value() : -1;
-    data->low_price = trade_low_.has_value() ? trade_low_.value() : -1;
+    data->timestamp = SimulationClock::nowMillis();
 
-    double current_volume_traded = trade_volume_;
-    if (trade_count_ <= 1) {
-        data->volume_per_tick = current_volume_traded;  // First tick takes full volume
-    } else {
-        data->volume_per_tick = std::max(0.0, current_volume_traded - previous_volume_traded_);
+    if (includes(fields, MarketDataFields::DEPTH))
+    {
+        data->worst_bid = worstBid().has_value() ? tick_size_.toPrice(worstBid().value()->price) : 0;
+        data->worst_ask = worstAsk().has_value() ? tick_size_.toPrice(worstAsk().value()->price) : 0;
+        data->asks_volume = asks_volume_;
+        data->bids_volume = bids_volume_;
+        data->asks_count = asksCount();
+        data->bids_count = bidsCount();
+        data->total_volume = data->asks_volume + data->bids_volume;
     }
-    previous_volume_traded_ = current_volume_traded; // Update previous volume 
 
+    // The volume since the previous update is taken whether or not it is asked for, so that it stays per update
+    double volume_per_tick = trade_stats_.takeVolumeSinceUpdate();
 
-    data->cumulative_volume_traded = trade_volume_;
-    data->trades_count = trade_count_;
-
-    data->timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (includes(fields, MarketDataFields::TRADE_STATS))
+    {
+        trade_stats_.expire(SimulationClock::nowNanos());
+        data->high_price = trade_stats_.high().value_or(-1);
+        data->low_price = trade_stats_.low().value_or(-1);
+        data->vwap = trade_stats_.vwap().value_or(-1);
+        data->volume_per_tick = volume_per_tick;
+    }
 
     // Additionals for DT 
-    data->mid_price = calculateMidPrice();
-    data->micro_price = calculateMicroPrice();
-    data->side = getAggressingSide(aggressing_side);
-    data->imbalance = calculateImbalance();
-    data->spread = calculateSpread();
-    data->time_diff = time_diff_;
-    data->total_volume = data->asks_volume + data->bids_volume;
+    if (includes(fields, MarketDataFields::ANALYTICS))
+    {
+        data->mid_price = calculateMidPrice();
+        data->micro_price = calculateMicroPrice();
+        data->side = getAggressingSide(aggressing_side);
+        data->imbalance = calculateImbalance();
+        data->spread = calculateSpread();
+        data->time_diff = time_diff_;
+    }
   
     return data;
-} 
\ No newline at end of file
+} 
+
+MarketDepthPtr OrderBook::getDepth(size_t levels)
+{
+    MarketDepthPtr depth = std::make_shared<MarketDepth>();
+    depth->ticker = ticker_;
+    depth->timestamp = SimulationClock::nowMillis();
+
+    walkDepth(Order::Side::BID, [&](int price, int quantity, int count) {
+        depth->bids.emplace_back(tick_size_.toPrice(price), quantity, count);
+        return depth->bids.size() < levels;
+    });
+    walkDepth(Order::Side::ASK, [&](int price, int quantity, int count) {
+        depth->asks.emplace_back(tick_size_.toPrice(price), quantity, count);
+        return depth->asks.size() < levels;
+    });
+
+    return depth;
+}
\ No newline at end of file
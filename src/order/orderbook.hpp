@@ -8,84 +8,119 @@
 #include <unordered_map>
 #include <deque>
 #include <optional>
+#include <functional>
 
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/serialization/string.hpp>
+#include <boost/serialization/deque.hpp>
+#include <boost/serialization/shared_ptr.hpp>
 
 #include "order.hpp"
 #include "limitorder.hpp"
-#include "orderqueue.hpp"
+#include "orderbooktype.hpp"
+#include "ticksize.hpp"
 #include "../trade/trade.hpp"
 #include "../trade/marketdata.hpp"
+#include "../trade/marketdepth.hpp"
+#include "../trade/rollingtradestats.hpp"
 
 class OrderBook;
 typedef std::shared_ptr<OrderBook> OrderBookPtr;
 
-/** The order book storing all orders for a single ticker. */
+/** The order book storing all orders for a single ticker.
+ *  Derived classes provide the storage of resting orders. */
 class OrderBook : std::enable_shared_from_this<OrderBook> {
 public:
 
-    OrderBook(std::string_view ticker)
+    OrderBook(std::string_view ticker, TickSize tick_size)
     : ticker_{std::string(ticker)},
-      bids_{Order::Side::BID},
-      asks_{Order::Side::ASK},
+      tick_size_{tick_size},
       bids_volume_{0},
       asks_volume_{0},
       order_count_{0},
       trade_volume_{0},
-      trade_count_{0}, 
-      previous_volume_traded_{0}
+      trade_count_{0}
     {
     }
+
+    virtual ~OrderBook() = default;
     
     /** Adds the given order to the order book. */
-    void addOrder(LimitOrderPtr order);
+    virtual void addOrder(LimitOrderPtr order) = 0;
 
     /** Removes the given order from the order book if exists. Returns nullopt if order does not exist. */
-    std::optional<LimitOrderPtr> removeOrder(int order_id, Order::Side side);
+    virtual std::optional<LimitOrderPtr> removeOrder(int order_id, Order::Side side) = 0;
+
+    /** Changes the price (ticks) and remaining quantity of the given resting order. The order keeps its time priority
+     *  if only its quantity decreases, and otherwise joins the back of the queue at its new price.
+     *  The new price must not cross the spread. Returns the order as it now rests, or nullopt if it does not exist. */
+    virtual std::optional<LimitOrderPtr> amendOrder(int order_id, Order::Side side, int price, int quantity) = 0;
+
+    /** Returns the given resting order, or nullopt if it does not exist. */
+    virtual std::optional<LimitOrderPtr> findOrder(int order_id, Order::Side side) = 0;
 
     /** Updates the order quantity and price based on the executed trade. */
     void updateOrderWithTrade(OrderPtr order, TradePtr trade);
 
     /** Returns the best bid in the order book. */
-    std::optional<LimitOrderPtr> bestBid();
+    virtual std::optional<LimitOrderPtr> bestBid() = 0;
 
     /** Returns the worst bid in the order book. */
-    std::optional<LimitOrderPtr> worstBid();
+    virtual std::optional<LimitOrderPtr> worstBid() = 0;
 
     /** Returns the best ask in the order book. */
-    std::optional<LimitOrderPtr> bestAsk();
+    virtual std::optional<LimitOrderPtr> bestAsk() = 0;
 
     /** Returns the worst ask in the order book. */
-    std::optional<LimitOrderPtr> worstAsk();
+    virtual std::optional<LimitOrderPtr> worstAsk() = 0;
 
     /** Returns the aggregate size of all bids at the best bid price. */
-    int bestBidSize();
+    virtual int bestBidSize() = 0;
 
     /** Returns the aggregate size of all asks at the best ask price. */
-    int bestAskSize();
+    virtual int bestAskSize() = 0;
 
     /** Removes the best bid from the order queue. */
-    void popBestBid();
+    virtual void popBestBid() = 0;
 
     /** Removes the best ask from the order queue. */
-    void popBestAsk();
+    virtual void popBestAsk() = 0;
 
     /** Checks if the given order exists in the order book. */
-    bool contains(int order_id, Order::Side side);
+    virtual bool contains(int order_id, Order::Side side) = 0;
+
+    /** Visits the price (ticks), aggregate size and order count of each price level on the given side,
+     *  best price first, until the visitor returns false. Does not modify the book. */
+    virtual void walkDepth(Order::Side side, const std::function<bool(int, int, int)>& visit) = 0;
+
+    /** Visits each resting order on the given side, best price first and in time priority within a price,
+     *  until the visitor returns false. Does not modify the book. */
+    virtual void walkOrders(Order::Side side, const std::function<bool(const LimitOrderPtr&)>& visit) = 0;
+
+    /** Returns the top price levels of each side, up to the given number of levels. */
+    MarketDepthPtr getDepth(size_t levels);
+
+    /** Returns the number of resting bids. */
+    virtual int bidsCount() = 0;
+
+    /** Returns the number of resting asks. */
+    virtual int asksCount() = 0;
 
     /** Logs the details of the executed trade for statistics. */
     void logTrade(TradePtr trade);
 
+    /** Sets the window the high, low and VWAP of the trades are kept over, forgetting the trades logged so far. */
+    void setTradeStatsWindow(TradeStatsWindow window);
+
     /** Gets total bid volume. */
     double getTotalBidVolume(); 
 
     /** Gets total ask volume. */
     double getTotalAskVolume(); 
 
-    /** Returns live level 1 market data. */
-    MarketDataPtr getLiveMarketData(Order::Side aggressing_side);
+    /** Returns live level 1 market data, computing only the given groups of fields beyond the top of the book. */
+    MarketDataPtr getLiveMarketData(Order::Side aggressing_side, MarketDataFields fields = MarketDataFields::ALL);
 
     /** Calculates mid price.  */
     double calculateMidPrice();
@@ -102,43 +137,74 @@ public:
     /** Calculates order book spread. */
     double calculateSpread();
 
-    /** Creates a new order book for the given ticker. */
-    static OrderBookPtr create(std::string_view ticker)
+    /** The statistics kept over the trades of the book, saved in session checkpoints. */
+    struct TradeStatistics
     {
-        return std::make_shared<OrderBook>(ticker);
-    }
-
-
-private:
-    void updateRollingWindow(double high_price, double low_price);
-    std::optional<double> calculateHigh();
-    std::optional<double> calculateLow();
+        std::optional<TradePtr> last_trade;
+        unsigned long long time_diff = 0;
+        int trade_volume = 0;
+        int trade_count = 0;
+        RollingTradeStats rolling;
+
+    private:
+
+        /** Boost 1.74 has no support for std::optional, so presence is written ahead of the value. */
+        template<class Archive, class T>
+        static void serializeOptional(Archive & ar, std::optional<T>& value)
+        {
+            bool present = value.has_value();
+            ar & present;
+            if (!present)
+            {
+                value.reset();
+                return;
+            }
+            if (!value.has_value()) value.emplace();
+            ar & value.value();
+        }
+
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            serializeOptional(ar, last_trade);
+            ar & time_diff;
+            ar & trade_volume;
+            ar & trade_count;
+            ar & rolling;
+        }
+    };
+
+    /** Returns the statistics of the trades logged so far. */
+    TradeStatistics tradeStatistics() const;
+
+    /** Replaces the trade statistics with those of a saved session. */
+    void restoreTradeStatistics(const TradeStatistics& statistics);
+
+    /** Returns the tick size used to convert between order book and message prices. */
+    const TickSize& tickSize() const { return tick_size_; }
+
+    /** Creates a new order book of the given type for the given ticker. */
+    static OrderBookPtr create(std::string_view ticker, OrderBookType type = OrderBookType::HEAP, TickSize tick_size = TickSize{});
+
+protected:
 
     std::string ticker_;
-    OrderQueue bids_;
-    OrderQueue asks_;
+    TickSize tick_size_;
 
     int bids_volume_;
     int asks_volume_;
     int order_count_;
 
-    std::unordered_map<double, int> bids_sizes_;
-    std::unordered_map<double, int> asks_sizes_;
+private:
 
     std::optional<TradePtr> last_trade_;
     unsigned long long time_diff_ = 0; // Time difference between current and previous trade
 
-    std::optional<double> trade_high_;
-    std::optional<double> trade_low_;
     int trade_volume_;
     int trade_count_;
 
-    std::deque<double> high_prices_;
-    std::deque<double> low_prices_;
-    const size_t lookback_period_ = 14;
-
-    double previous_volume_traded_; 
-
+    RollingTradeStats trade_stats_;
 };
 
 #endif // ORDERBOOK_HPP
\ No newline at end of file
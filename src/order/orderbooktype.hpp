@@ -0,0 +1,28 @@
+#ifndef ORDER_BOOK_TYPE_HPP
+#define ORDER_BOOK_TYPE_HPP
+
+#include <string>
+
+enum class OrderBookType : int
+{
+    HEAP,   // Priority queue of resting orders
+    LADDER  // Price levels, each holding a FIFO of resting orders
+};
+
+inline std::string to_string(OrderBookType book_type)
+{
+    switch (book_type) {
+        case OrderBookType::HEAP: return std::string{"heap"};
+        case OrderBookType::LADDER: return std::string{"ladder"};
+        default: return std::string{""};
+    }
+}
+
+/** Returns the order book type for the given name. Defaults to the heap order book. */
+inline OrderBookType order_book_type_from_string(std::string_view name)
+{
+    if (name == "ladder") return OrderBookType::LADDER;
+    return OrderBookType::HEAP;
+}
+
+#endif
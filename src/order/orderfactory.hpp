@@ -1,8 +1,12 @@
 #ifndef ORDER_FACTORY_HPP
 #define ORDER_FACTORY_HPP
 
+#include <atomic>
+
 #include "limitorder.hpp"
 #include "marketorder.hpp"
+#include "ticksize.hpp"
+#include "../utilities/objectpool.hpp"
 #include "../message/limit_order_message.hpp"
 #include "../message/market_order_message.hpp"
 
@@ -12,17 +16,19 @@ public:
 
     OrderFactory() = default;
 
-    LimitOrderPtr createLimitOrder(LimitOrderMessagePtr msg)
+    /** Creates a limit order from the message, converting its price to ticks of the given tick size. */
+    LimitOrderPtr createLimitOrder(LimitOrderMessagePtr msg, const TickSize& tick_size)
     {
-        LimitOrderPtr order = std::make_shared<LimitOrder>(++order_id_);
+        LimitOrderPtr order = std::allocate_shared<LimitOrder>(PoolAllocator<LimitOrder>{limit_order_pool_}, ++order_id_);
         order->sender_id = msg->sender_id;
         order->agent_name = msg->agent_name; 
         order->client_order_id = msg->client_order_id;
         order->priv_value = msg->priv_value;
         order->ticker = msg->ticker;
+        order->symbol = msg->symbol;
         order->side = msg->side;
         order->time_in_force = msg->time_in_force;
-        order->price = msg->price;
+        order->price = tick_size.toTicks(msg->price);
         order->status = Order::Status::NEW;
         order->remaining_quantity = msg->quantity;
         order->cumulative_quantity = 0;
@@ -34,12 +40,13 @@ public:
 
     MarketOrderPtr createMarketOrder(MarketOrderMessagePtr msg)
     {
-        MarketOrderPtr order = std::make_shared<MarketOrder>(++order_id_);
+        MarketOrderPtr order = std::allocate_shared<MarketOrder>(PoolAllocator<MarketOrder>{market_order_pool_}, ++order_id_);
         order->sender_id = msg->sender_id;
         order->agent_name = msg->agent_name;
         order->client_order_id = msg->client_order_id;
         order->priv_value = msg->priv_value;
         order->ticker = msg->ticker;
+        order->symbol = msg->symbol;
         order->side = msg->side;
         order->status = Order::Status::NEW;
         order->remaining_quantity = msg->quantity;
@@ -50,14 +57,67 @@ public:
         return order;
     }
 
+    /** Returns the order of the message as rejected, with no order ID, as it never reached the book. */
+    LimitOrderPtr createRejectedLimitOrder(LimitOrderMessagePtr msg, const TickSize& tick_size)
+    {
+        LimitOrderPtr order = std::make_shared<LimitOrder>(0);
+        order->sender_id = msg->sender_id;
+        order->agent_name = msg->agent_name;
+        order->client_order_id = msg->client_order_id;
+        order->priv_value = msg->priv_value;
+        order->ticker = msg->ticker;
+        order->symbol = msg->symbol;
+        order->side = msg->side;
+        order->time_in_force = msg->time_in_force;
+        order->price = tick_size.toTicks(msg->price);
+        order->status = Order::Status::REJECTED;
+        order->remaining_quantity = msg->quantity;
+        order->cumulative_quantity = 0;
+        order->avg_price = 0.0;
+        order->timestamp_sent = msg->timestamp_sent;
+        order->timestamp_received = msg->timestamp_received;
+        return order;
+    }
+
+    /** Returns the order of the message as rejected, with no order ID, as it never reached the book. */
+    MarketOrderPtr createRejectedMarketOrder(MarketOrderMessagePtr msg)
+    {
+        MarketOrderPtr order = std::make_shared<MarketOrder>(0);
+        order->sender_id = msg->sender_id;
+        order->agent_name = msg->agent_name;
+        order->client_order_id = msg->client_order_id;
+        order->priv_value = msg->priv_value;
+        order->ticker = msg->ticker;
+        order->symbol = msg->symbol;
+        order->side = msg->side;
+        order->status = Order::Status::REJECTED;
+        order->remaining_quantity = msg->quantity;
+        order->cumulative_quantity = 0;
+        order->avg_price = 0.0;
+        order->timestamp_sent = msg->timestamp_sent;
+        order->timestamp_received = msg->timestamp_received;
+        return order;
+    }
+
     int getNumberOfOrders() const
     {
         return order_id_;
     }
 
+    /** Continues the order ids from those of a saved session. */
+    void restoreNumberOfOrders(int orders)
+    {
+        order_id_ = orders;
+    }
+
 private:
 
-    int order_id_ = 0;
+    /** Shared by the matching engines of all tickers. */
+    std::atomic<int> order_id_ = 0;
+
+    /** Pools backing the orders created by this factory. */
+    ObjectPoolPtr limit_order_pool_ = std::make_shared<ObjectPool>();
+    ObjectPoolPtr market_order_pool_ = std::make_shared<ObjectPool>();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "orderladder.hpp"
+
+void OrderLadder::push(LimitOrderPtr order)
+{
+    auto level = levels_.try_emplace(order->price, order->price).first;
+    index_[order->id] = level->second.add(order);
+}
+
+const LimitOrderPtr& OrderLadder::top() const
+{
+    return bestLevel()->second.orders.front();
+}
+
+void OrderLadder::pop()
+{
+    if (levels_.empty()) return;
+
+    auto level = bestLevel();
+    const LimitOrderPtr& order = level->second.orders.front();
+    level->second.total_quantity -= order->remaining_quantity;
+    index_.erase(order->id);
+    level->second.orders.pop_front();
+
+    if (level->second.empty())
+    {
+        levels_.erase(level);
+    }
+}
+
+std::optional<LimitOrderPtr> OrderLadder::worst() const
+{
+    if (levels_.empty()) return std::nullopt;
+    return worstLevel()->second.orders.back();
+}
+
+int OrderLadder::bestLevelSize() const
+{
+    if (levels_.empty()) return 0;
+    return bestLevel()->second.total_quantity;
+}
+
+void OrderLadder::walkLevels(const std::function<bool(int, int, int)>& visit) const
+{
+    if (side_ == Order::Side::BID)
+    {
+        for (auto level = levels_.rbegin(); level != levels_.rend(); ++level)
+        {
+            if (!visit(level->first, level->second.total_quantity, level->second.count())) return;
+        }
+    }
+    else
+    {
+        for (auto level = levels_.begin(); level != levels_.end(); ++level)
+        {
+            if (!visit(level->first, level->second.total_quantity, level->second.count())) return;
+        }
+    }
+}
+
+void OrderLadder::walkOrders(const std::function<bool(const LimitOrderPtr&)>& visit) const
+{
+    auto visitLevel = [&visit](const PriceLevel& level) {
+        for (const LimitOrderPtr& order : level.orders)
+        {
+            if (!visit(order)) return false;
+        }
+        return true;
+    };
+
+    if (side_ == Order::Side::BID)
+    {
+        for (auto level = levels_.rbegin(); level != levels_.rend(); ++level)
+        {
+            if (!visitLevel(level->second)) return;
+        }
+    }
+    else
+    {
+        for (auto level = levels_.begin(); level != levels_.end(); ++level)
+        {
+            if (!visitLevel(level->second)) return;
+        }
+    }
+}
+
+std::optional<LimitOrderPtr> OrderLadder::find(int order_id)
+{
+    auto it = index_.find(order_id);
+    if (it != index_.end())
+    {
+        return *it->second;
+    }
+    return std::nullopt;
+}
+
+std::optional<LimitOrderPtr> OrderLadder::remove(int order_id)
+{
+    auto it = index_.find(order_id);
+    if (it == index_.end())
+    {
+        return std::nullopt;
+    }
+
+    LimitOrderPtr order = *it->second;
+    auto level = levels_.find(order->price);
+    level->second.total_quantity -= order->remaining_quantity;
+    level->second.orders.erase(it->second);
+    index_.erase(it);
+
+    if (level->second.empty())
+    {
+        levels_.erase(level);
+    }
+    return order;
+}
+
+bool OrderLadder::amend(int order_id, int price, int quantity)
+{
+    auto it = index_.find(order_id);
+    if (it == index_.end())
+    {
+        return false;
+    }
+
+    LimitOrderPtr order = *it->second;
+    auto level = levels_.find(order->price);
+    level->second.total_quantity -= order->remaining_quantity;
+    if (price == order->price && quantity <= order->remaining_quantity)
+    {
+        order->remaining_quantity = quantity;
+        level->second.total_quantity += quantity;
+        return true;
+    }
+
+    // Splicing moves the order's node, so the index keeps pointing at it
+    order->requeue();
+    order->price = price;
+    order->remaining_quantity = quantity;
+    auto target = levels_.try_emplace(price, price).first;
+    target->second.orders.splice(target->second.orders.end(), level->second.orders, it->second);
+    target->second.total_quantity += quantity;
+
+    if (level->second.empty())
+    {
+        levels_.erase(level);
+    }
+    return true;
+}
+
+OrderLadder::level_map::iterator OrderLadder::bestLevel()
+{
+    return (side_ == Order::Side::BID) ? std::prev(levels_.end()) : levels_.begin();
+}
+
+OrderLadder::level_map::const_iterator OrderLadder::bestLevel() const
+{
+    return (side_ == Order::Side::BID) ? std::prev(levels_.end()) : levels_.begin();
+}
+
+OrderLadder::level_map::const_iterator OrderLadder::worstLevel() const
+{
+    return (side_ == Order::Side::BID) ? levels_.begin() : std::prev(levels_.end());
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef ORDER_LADDER_HPP
+#define ORDER_LADDER_HPP
+
+#include <map>
+#include <unordered_map>
+#include <optional>
+#include <functional>
+
+#include "limitorder.hpp"
+#include "pricelevel.hpp"
+
+/** One side of the order book stored as a ladder of price levels with price-time priority. */
+class OrderLadder {
+public:
+
+    OrderLadder(Order::Side side)
+    : side_{side},
+      levels_{},
+      index_{}
+    {
+    }
+
+    /** Adds the order to the level at its price, creating the level if needed. */
+    void push(LimitOrderPtr order);
+
+    /** Returns the order with the highest priority. Ladder must not be empty. */
+    const LimitOrderPtr& top() const;
+
+    /** Removes the order with the highest priority. */
+    void pop();
+
+    /** Returns the order at the back of the worst price level if present. */
+    std::optional<LimitOrderPtr> worst() const;
+
+    /** Returns the aggregate size of all orders at the best price level. */
+    int bestLevelSize() const;
+
+    /** Visits the price, aggregate size and order count of each price level, best price first,
+     *  until the visitor returns false. */
+    void walkLevels(const std::function<bool(int, int, int)>& visit) const;
+
+    /** Visits each order, best price level first and in time priority within a level, until the visitor returns false. */
+    void walkOrders(const std::function<bool(const LimitOrderPtr&)>& visit) const;
+
+    /** Returns the number of orders in the ladder. */
+    int size() const { return index_.size(); }
+
+    /** Checks if the ladder holds no orders. */
+    bool empty() const { return levels_.empty(); }
+
+    /** Finds and returns the order with the given id if present in the ladder. */
+    std::optional<LimitOrderPtr> find(int order_id);
+
+    /** Removes and returns the order with the given id if present in the ladder. */
+    std::optional<LimitOrderPtr> remove(int order_id);
+
+    /** Changes the price and remaining quantity of the order with the given id, keeping its place in its level if only 
+     *  its quantity decreases and moving it to the back of the level at the new price otherwise. Returns false if it is not present. */
+    bool amend(int order_id, int price, int quantity);
+
+private:
+
+    typedef std::map<int, PriceLevel> level_map;
+
+    /** Returns the iterator to the best price level. Ladder must not be empty. */
+    level_map::iterator bestLevel();
+    level_map::const_iterator bestLevel() const;
+
+    /** Returns the iterator to the worst price level. Ladder must not be empty. */
+    level_map::const_iterator worstLevel() const;
+
+    Order::Side side_;
+
+    /** Price levels sorted in ascending price order. */
+    level_map levels_;
+
+    /** Position of each resting order within its price level by order id. */
+    std::unordered_map<int, std::list<LimitOrderPtr>::iterator> index_;
+};
+
+#endif
@@ -1,25 +1,110 @@
 #include "orderqueue.hpp"
 
+#include <algorithm>
+
+void OrderQueue::push(LimitOrderPtr order)
+{
+    index_[order->id] = by_price_.emplace(order->price, order);
+    queue_type::push(order);
+    compact();
+}
+
+const LimitOrderPtr& OrderQueue::top()
+{
+    discardRemoved();
+    return this->c.front();
+}
+
+void OrderQueue::pop()
+{
+    discardRemoved();
+    if (!this->c.empty())
+    {
+        auto it = index_.find(this->c.front()->id);
+        by_price_.erase(it->second);
+        index_.erase(it);
+        queue_type::pop();
+    }
+}
+
 std::optional<LimitOrderPtr> OrderQueue::find(int order_id)
 {
-    for (auto it = this->c.begin(); it != this->c.end(); ++it)
+    auto it = index_.find(order_id);
+    if (it != index_.end())
     {
-        if ((*it)->id == order_id)
-        {
-            return *it;
-        }
+        return it->second->second;
     }
     return std::nullopt;
 };
 
 std::optional<LimitOrderPtr> OrderQueue::remove(int order_id)
 {
-    std::optional<LimitOrderPtr> order = this->find(order_id);
-    if (order.has_value())
+    auto it = index_.find(order_id);
+    if (it == index_.end())
     {
-        this->c.erase(std::remove(this->c.begin(), this->c.end(), order.value()), this->c.end());
-        return order;
+        return std::nullopt;
     }
-    
-    return std::nullopt;
-};
\ No newline at end of file
+
+    // Leave the heap entry in place and skip it once it reaches the top, or drop it when the heap is compacted
+    LimitOrderPtr order = it->second->second;
+    by_price_.erase(it->second);
+    index_.erase(it);
+    compact();
+    return order;
+};
+
+std::optional<LimitOrderPtr> OrderQueue::worst() const
+{
+    if (by_price_.empty())
+    {
+        return std::nullopt;
+    }
+    return (side_ == Order::Side::BID) ? by_price_.begin()->second : std::prev(by_price_.end())->second;
+}
+
+void OrderQueue::walk(const std::function<bool(const LimitOrderPtr&)>& visit) const
+{
+    if (side_ == Order::Side::ASK)
+    {
+        for (auto const& [price, order] : by_price_)
+        {
+            if (!visit(order)) return;
+        }
+        return;
+    }
+
+    // Bids run from the highest price down, each price still visited in the order its orders joined
+    for (auto level_end = by_price_.end(); level_end != by_price_.begin(); )
+    {
+        auto level_begin = by_price_.lower_bound(std::prev(level_end)->first);
+        for (auto it = level_begin; it != level_end; ++it)
+        {
+            if (!visit(it->second)) return;
+        }
+        level_end = level_begin;
+    }
+}
+
+void OrderQueue::discardRemoved()
+{
+    while (!this->c.empty() && !isLive(this->c.front()))
+    {
+        queue_type::pop();
+    }
+}
+
+void OrderQueue::compact()
+{
+    // Every entry is of a live order or of a removed one, so the heap is at most twice the live orders
+    size_t live = index_.size();
+    if (this->c.size() - live <= live) return;
+
+    std::erase_if(this->c, [this](const LimitOrderPtr& order) { return !isLive(order); });
+    std::make_heap(this->c.begin(), this->c.end(), this->comp);
+}
+
+bool OrderQueue::isLive(const LimitOrderPtr& order) const
+{
+    auto it = index_.find(order->id);
+    return it != index_.end() && it->second->second == order;
+}
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <queue>
 #include <optional>
 #include <functional>
+#include <map>
+#include <unordered_map>
 
 #include "limitorder.hpp"
 
@@ -12,7 +14,10 @@ class OrderQueue: public std::priority_queue<LimitOrderPtr, std::vector<LimitOrd
 public:
 
     OrderQueue(Order::Side side)
-    : std::priority_queue<LimitOrderPtr, std::vector<LimitOrderPtr>, std::function<bool(LimitOrderPtr, LimitOrderPtr)>>()
+    : std::priority_queue<LimitOrderPtr, std::vector<LimitOrderPtr>, std::function<bool(LimitOrderPtr, LimitOrderPtr)>>(),
+      side_{side},
+      by_price_{},
+      index_{}
     {
         if (side == Order::Side::BID) 
         {
@@ -40,12 +45,55 @@ public:
         }
     }
 
+    /** Adds the order to the queue and indexes it by id. */
+    void push(LimitOrderPtr order);
+
+    /** Returns the live order with the highest priority. Queue must not be empty. */
+    const LimitOrderPtr& top();
+
+    /** Removes the live order with the highest priority. */
+    void pop();
+
+    /** Returns a live order at the worst price level if present. */
+    std::optional<LimitOrderPtr> worst() const;
+
+    /** Visits each live order, best price first and in the order they joined within a price, until the visitor returns false. */
+    void walk(const std::function<bool(const LimitOrderPtr&)>& visit) const;
+
+    /** Returns the number of live orders in the queue. */
+    size_t size() const { return index_.size(); }
+
+    /** Checks if the queue holds no live orders. */
+    bool empty() const { return index_.empty(); }
+
     /** Finds and returns the order with the given id if present in the queue. */
     std::optional<LimitOrderPtr> find(int order_id);
 
     /** Removes and returns the order with the given id if present in the queue. */
     std::optional<LimitOrderPtr> remove(int order_id);
 
+private:
+
+    typedef std::priority_queue<LimitOrderPtr, std::vector<LimitOrderPtr>, std::function<bool(LimitOrderPtr, LimitOrderPtr)>> queue_type;
+
+    /** Discards entries of removed orders sitting at the top of the heap. */
+    void discardRemoved();
+
+    /** Rebuilds the heap from the entries of live orders once those of removed orders outnumber them,
+     *  so that cancels and amends deep in the book do not grow the heap without bound. */
+    void compact();
+
+    /** Indicates whether the heap entry is of a live order: the index holds that very order, as an amended order is pushed again under its id. */
+    bool isLive(const LimitOrderPtr& order) const;
+
+    Order::Side side_;
+
+    /** Live orders in the queue sorted by price. */
+    std::multimap<int, LimitOrderPtr> by_price_;
+
+    /** Position of each live order in the price map by order id. */
+    std::unordered_map<int, std::multimap<int, LimitOrderPtr>::iterator> index_;
+
 };
 
 #endif
\ No newline at end of file
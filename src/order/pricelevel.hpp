@@ -0,0 +1,60 @@
+#ifndef PRICE_LEVEL_HPP
+#define PRICE_LEVEL_HPP
+
+#include <list>
+#include <algorithm>
+
+#include "limitorder.hpp"
+
+/** A single price level of the order book holding its resting orders in time priority. */
+class PriceLevel {
+public:
+
+    PriceLevel(int price)
+    : price{price},
+      total_quantity{0},
+      orders{}
+    {
+    }
+
+    /** Adds the order to the level, keeping the orders sorted by creation time. Returns its position. */
+    std::list<LimitOrderPtr>::iterator add(LimitOrderPtr order)
+    {
+        total_quantity += order->remaining_quantity;
+
+        // New orders join the back of the queue; re-inserted orders keep their original priority
+        if (orders.empty() || order->timestamp_created >= orders.back()->timestamp_created)
+        {
+            return orders.insert(orders.end(), order);
+        }
+        else if (order->timestamp_created <= orders.front()->timestamp_created)
+        {
+            return orders.insert(orders.begin(), order);
+        }
+        else
+        {
+            auto it = std::find_if(orders.begin(), orders.end(), [&](const LimitOrderPtr& resting) {
+                return resting->timestamp_created > order->timestamp_created;
+            });
+            return orders.insert(it, order);
+        }
+    }
+
+    /** Returns the number of orders resting at this level. */
+    int count() const
+    {
+        return orders.size();
+    }
+
+    /** Checks if there are no orders resting at this level. */
+    bool empty() const
+    {
+        return orders.empty();
+    }
+
+    int price;
+    int total_quantity;
+    std::list<LimitOrderPtr> orders;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef TICK_SIZE_HPP
+#define TICK_SIZE_HPP
+
+#include <cmath>
+
+/** Converts between decimal prices used in messages and integer price ticks used by the order book. */
+class TickSize {
+public:
+
+    TickSize(double size = 1.0)
+    : size_{size > 0.0 ? size : 1.0}
+    {
+    }
+
+    /** Returns the given price rounded to the nearest whole number of ticks. */
+    int toTicks(double price) const
+    {
+        return static_cast<int>(std::lround(price / size_));
+    }
+
+    /** Returns the decimal price of the given number of ticks. */
+    double toPrice(int ticks) const
+    {
+        return ticks * size_;
+    }
+
+    /** Returns the minimum price increment. */
+    double size() const
+    {
+        return size_;
+    }
+
+private:
+
+    double size_;
+};
+
+#endif
\ No newline at end of file
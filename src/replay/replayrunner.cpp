@@ -0,0 +1,146 @@
+#include "replayrunner.hpp"
+#include "../agent/stockexchange.hpp"
+#include "../config/configreader.hpp"
+#include "../networking/networkentity.hpp"
+#include "../utilities/ordertape.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    /** Splits a CSV row into its fields. */
+    std::vector<std::string> splitRow(const std::string& row)
+    {
+        std::vector<std::string> fields;
+        std::stringstream stream {row};
+        std::string field;
+        while (std::getline(stream, field, ','))
+        {
+            fields.push_back(field);
+        }
+        return fields;
+    }
+}
+
+ReplayRunner::ReplayRunner(Options options)
+: options_{options}
+{
+}
+
+int ReplayRunner::run()
+{
+    ExchangeConfigPtr config = exchangeConfig();
+    std::vector<MessagePtr> messages = OrderTape::read(options_.tape);
+    report("Replaying " + std::to_string(messages.size()) + " order messages through " + config->name);
+
+    // The exchange is never connected, so its network entity is not started
+    asio::io_context io_context;
+    NetworkEntity entity {io_context, std::string{"127.0.0.1"}, 0};
+    std::shared_ptr<StockExchange> exchange = std::make_shared<StockExchange>(&entity, config, true);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<TradePtr> trades = exchange->replay(messages);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    exchange->terminate();
+
+    std::stringstream throughput;
+    throughput << "Matched " << messages.size() << " messages into " << trades.size() << " trades in " 
+               << elapsed.count() << "s, " << static_cast<long>(messages.size() / std::max(elapsed.count(), 1e-9)) << " messages/s";
+    report(throughput.str());
+
+    if (options_.trades.empty()) return 0;
+
+    int differences = compareTrades(trades);
+    report(differences == 0 ? "Trades match the trade tape" : std::to_string(differences) + " trades differ from the trade tape");
+    return differences;
+}
+
+ExchangeConfigPtr ReplayRunner::exchangeConfig()
+{
+    SimulationConfigPtr simulation = ConfigReader::readConfig(options_.config);
+    for (ExchangeConfigPtr const& exchange : simulation->exchanges())
+    {
+        if (!options_.exchange.empty() && exchange->name != options_.exchange) continue;
+
+        // The replay writes outputs of its own, and saves no checkpoint over that of the session
+        ExchangeConfigPtr config = std::static_pointer_cast<ExchangeConfig>(exchange->clone());
+        config->output_dir = options_.output;
+        config->multicast_group.clear();
+        config->shared_memory_feed.clear();
+        config->checkpoint_file.clear();
+        return config;
+    }
+    throw std::runtime_error("No exchange " + options_.exchange + " in configuration " + options_.config);
+}
+
+int ReplayRunner::compareTrades(const std::vector<TradePtr>& trades)
+{
+    std::ifstream tape {options_.trades};
+    if (!tape.is_open())
+    {
+        throw std::runtime_error("Failed to open trade tape: " + options_.trades);
+    }
+
+    // Columns are matched by name, and timestamps differ between the session and the replay
+    std::string row;
+    std::getline(tape, row);
+    std::vector<std::string> tape_headers = splitRow(row);
+    std::vector<std::string> replay_headers = splitRow(std::string{Trade::CSV_HEADERS});
+    std::vector<std::pair<size_t, size_t>> compared;
+    for (size_t i = 0; i < tape_headers.size(); ++i)
+    {
+        auto it = std::find(replay_headers.begin(), replay_headers.end(), tape_headers[i]);
+        if (it != replay_headers.end() && tape_headers[i] != "timestamp")
+        {
+            compared.push_back({i, static_cast<size_t>(it - replay_headers.begin())});
+        }
+    }
+    if (compared.empty())
+    {
+        throw std::runtime_error("Not a CSV trade tape: " + options_.trades);
+    }
+
+    int differences = 0;
+    size_t index = 0;
+    while (std::getline(tape, row))
+    {
+        if (row.empty()) continue;
+        if (index >= trades.size())
+        {
+            ++differences;
+            continue;
+        }
+
+        std::vector<std::string> expected = splitRow(row);
+        std::vector<std::string> actual = splitRow(trades[index]->toCSV());
+        for (auto const& [tape_column, replay_column] : compared)
+        {
+            if (tape_column >= expected.size() || expected[tape_column] != actual[replay_column])
+            {
+                if (differences == 0)
+                {
+                    report("First difference at trade " + std::to_string(index + 1) + ":\n  tape:   " + row 
+                        + "\n  replay: " + trades[index]->toCSV());
+                }
+                ++differences;
+                break;
+            }
+        }
+        ++index;
+    }
+    if (index < trades.size())
+    {
+        differences += trades.size() - index;
+    }
+    return differences;
+}
+
+void ReplayRunner::report(const std::string& line)
+{
+    std::cout << "[Replay] " << line << std::endl;
+}
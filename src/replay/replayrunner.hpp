@@ -0,0 +1,48 @@
+#ifndef REPLAY_RUNNER_HPP
+#define REPLAY_RUNNER_HPP
+
+#include <string>
+#include <vector>
+
+#include "../trade/trade.hpp"
+#include "../config/exchangeconfig.hpp"
+
+/** Replays the order tape of a recorded session through an exchange in this process, without networking,
+ *  matching its messages as fast as they can be matched, and checks the trades against the session's trade tape.
+ *  Serves as a throughput benchmark of the matching engine and a regression check of changes to it. */
+class ReplayRunner
+{
+public:
+
+    struct Options
+    {
+        std::string config;          // the simulation configuration the session ran
+        std::string tape;            // the order tape the exchange recorded
+        std::string trades;          // the trade tape of the session to check against, empty not to check
+        std::string exchange;        // the exchange of the configuration that recorded the tape, empty for the first
+        std::string output;          // the directory the outputs of the replay are written to
+    };
+
+    ReplayRunner() = delete;
+
+    explicit ReplayRunner(Options options);
+
+    /** Runs the replay and reports its throughput. Returns the number of trades that differ from the trade tape. */
+    int run();
+
+private:
+
+    /** Returns the configuration of the exchange to replay, writing its outputs to the output directory. */
+    ExchangeConfigPtr exchangeConfig();
+
+    /** Compares the trades of the replay with the rows of the trade tape, except for their timestamps.
+     *  Returns the number of trades that differ, or are only in one of them. */
+    int compareTrades(const std::vector<TradePtr>& trades);
+
+    /** Prints a line of progress. */
+    void report(const std::string& line);
+
+    Options options_;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "sweeprunner.hpp"
+#include "../utilities/workstealingpool.hpp"
+
+#include <sys/wait.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+SweepRunner::SweepRunner(Options options)
+: options_{options},
+  config_path_{std::filesystem::absolute(options.config)},
+  output_path_{std::filesystem::absolute(options.output)}
+{
+}
+
+int SweepRunner::run()
+{
+    std::vector<Trial> trials = expand();
+    std::atomic<int> failed = 0;
+    {
+        WorkStealingPool pool {options_.jobs > 0 ? options_.jobs : std::thread::hardware_concurrency()};
+        report("Running " + std::to_string(trials.size()) + " trials, " + std::to_string(pool.size()) + " at once");
+        for (Trial const& trial : trials)
+        {
+            pool.submit([this, &trial, &failed]() {
+                try
+                {
+                    if (!runTrial(trial)) ++failed;
+                }
+                catch (std::exception& e)
+                {
+                    report("Configuration " + std::to_string(trial.configuration) + " trial " + std::to_string(trial.trial) 
+                        + " could not be run: " + e.what());
+                    ++failed;
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    mergeProfits(trials);
+    report("Sweep finished, " + std::to_string(failed.load()) + " trials failed");
+    return failed.load();
+}
+
+std::vector<SweepRunner::Trial> SweepRunner::expand()
+{
+    std::ifstream markets {options_.markets};
+    if (!markets.is_open())
+    {
+        throw std::runtime_error("Failed to open markets file: " + options_.markets);
+    }
+
+    std::vector<Trial> trials;
+    std::string line;
+    int configuration = 0;
+    while (std::getline(markets, line))
+    {
+        if (line.empty()) continue;
+        ++configuration;
+
+        // Trials read their trader mix from ../markets.csv, as the configuration reader expects
+        std::filesystem::path configuration_path = output_path_ / ("config_" + std::to_string(configuration));
+        std::filesystem::create_directories(configuration_path);
+        std::ofstream mix {configuration_path / "markets.csv"};
+        mix << line << "\n";
+
+        for (int trial = 1; trial <= options_.trials; ++trial)
+        {
+            trials.push_back(Trial{configuration, trial, trialSeed(configuration, trial),
+                configuration_path / ("trial_" + std::to_string(trial))});
+        }
+    }
+    return trials;
+}
+
+bool SweepRunner::runTrial(const Trial& trial)
+{
+    std::string name = "Configuration " + std::to_string(trial.configuration) + " trial " + std::to_string(trial.trial);
+    if (std::filesystem::exists(trial.directory / COMPLETED_MARKER))
+    {
+        report(name + " completed by an earlier run, skipping");
+        return true;
+    }
+
+    for (int attempts = 0; attempts <= options_.retries; ++attempts)
+    {
+        // Each attempt starts from an empty directory, so that a failed one leaves no outputs behind
+        std::filesystem::remove_all(trial.directory);
+        std::filesystem::create_directories(trial.directory);
+
+        if (attempt(trial))
+        {
+            std::ofstream {trial.directory / COMPLETED_MARKER};
+            report(name + " completed");
+            return true;
+        }
+        report(name + " failed" + (attempts < options_.retries ? ", retrying" : ""));
+    }
+    return false;
+}
+
+bool SweepRunner::attempt(const Trial& trial)
+{
+    std::stringstream command;
+    command << "cd '" << trial.directory.string() << "' && ";
+    if (options_.trial_timeout > 0)
+    {
+        command << "timeout " << options_.trial_timeout << " ";
+    }
+    command << "'" << options_.executable << "' simulate --config '" << config_path_.string() << "' --seed " << trial.seed
+            << " > simulation.log 2>&1";
+
+    int status = std::system(command.str().c_str());
+    if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return false;
+
+    // A trial is complete once its exchanges have written their profits
+    std::filesystem::path profits = trial.directory / "profits";
+    return std::filesystem::is_directory(profits) && !std::filesystem::is_empty(profits);
+}
+
+void SweepRunner::mergeProfits(const std::vector<Trial>& trials)
+{
+    std::filesystem::path merged_path = output_path_ / "profits.csv";
+    std::ofstream merged {merged_path};
+    merged << "config, trial, agent_name, profit\n";
+
+    for (Trial const& trial : trials)
+    {
+        if (!std::filesystem::exists(trial.directory / COMPLETED_MARKER)) continue;
+
+        for (auto const& entry : std::filesystem::directory_iterator{trial.directory / "profits"})
+        {
+            std::ifstream profits {entry.path()};
+            std::string row;
+            std::getline(profits, row); // Headers
+            while (std::getline(profits, row))
+            {
+                if (row.empty()) continue;
+                merged << trial.configuration << ", " << trial.trial << ", " << row << "\n";
+            }
+        }
+    }
+    report("Merged profits written to " + merged_path.string());
+}
+
+uint64_t SweepRunner::trialSeed(int configuration, int trial) const
+{
+    // SplitMix64 of the sweep seed and the trial's place in the sweep, so that a trial keeps its seed when the sweep is resumed
+    uint64_t z = options_.seed + (static_cast<uint64_t>(configuration) * 1000003ull + trial) * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void SweepRunner::report(const std::string& line)
+{
+    std::unique_lock<std::mutex> lock(report_mutex_);
+    std::cout << "[Sweep] " << line << std::endl;
+}
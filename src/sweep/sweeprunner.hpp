@@ -0,0 +1,75 @@
+#ifndef SWEEP_RUNNER_HPP
+#define SWEEP_RUNNER_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** Runs a parameter sweep: each trader mix of a markets file, repeated for a number of trials,
+ *  each trial a whole simulation run on the virtual clock by a child process in a directory of its own.
+ *  Trials run on a work-stealing pool, failed ones are retried, and a sweep run again resumes where it stopped. */
+class SweepRunner
+{
+public:
+
+    struct Options
+    {
+        std::string config;          // the simulation configuration every trial runs
+        std::string markets;         // the trader mixes, one per line in the format of markets.csv
+        std::string output;          // the directory the trials and merged profits are written to
+        std::string executable;      // the simulation executable the trials are run with
+        int trials = 3;              // trials of each trader mix
+        unsigned int jobs = 0;       // trials run at once, 0 for one per hardware thread
+        int retries = 2;             // further attempts at a failed trial
+        int trial_timeout = 600;     // seconds a trial may run before it is counted as failed, 0 for no limit
+        uint64_t seed = 1;           // seed the seeds of the trials are drawn from
+    };
+
+    SweepRunner() = delete;
+
+    explicit SweepRunner(Options options);
+
+    /** Runs the trials not completed by an earlier run of the sweep, then merges the profits of all completed trials.
+     *  Returns the number of trials that failed every attempt. */
+    int run();
+
+    /** Name of the file marking a trial as completed, so that resumed sweeps skip it. */
+    static constexpr const char* COMPLETED_MARKER = ".completed";
+
+private:
+
+    struct Trial
+    {
+        int configuration;
+        int trial;
+        uint64_t seed;
+        std::filesystem::path directory;
+    };
+
+    /** Expands the markets file into the trials of the sweep, writing each trader mix where its trials read it. */
+    std::vector<Trial> expand();
+
+    /** Runs the trial until it completes or has failed every attempt. Returns whether it completed. */
+    bool runTrial(const Trial& trial);
+
+    /** Runs one attempt at the trial in a child process. Returns whether it exited cleanly and wrote its profits. */
+    bool attempt(const Trial& trial);
+
+    /** Writes the profits of every completed trial to one CSV file, labelled with their trader mix and trial. */
+    void mergeProfits(const std::vector<Trial>& trials);
+
+    /** Returns the seed of the given trial, drawn from the seed of the sweep. */
+    uint64_t trialSeed(int configuration, int trial) const;
+
+    /** Prints a line of progress; trials report from several threads. */
+    void report(const std::string& line);
+
+    Options options_;
+    std::filesystem::path config_path_;
+    std::filesystem::path output_path_;
+    std::mutex report_mutex_;
+};
+
+#endif
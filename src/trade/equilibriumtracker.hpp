@@ -0,0 +1,83 @@
+#ifndef EQUILIBRIUM_TRACKER_HPP
+#define EQUILIBRIUM_TRACKER_HPP
+
+#include <cmath>
+#include <algorithm>
+
+#include <boost/serialization/access.hpp>
+
+/** Running sums over the trade prices of a ticker from which p* (p equilibrium) and
+ *  Smith's alpha are derived in constant time per trade. */
+class EquilibriumTracker
+{
+public:
+
+    EquilibriumTracker() = default;
+
+    /** Adds the price of a new trade. */
+    void add(double price)
+    {
+        if (count_ == 0)
+        {
+            shift_ = price;
+        }
+
+        // Trade i is weighted by 0.9^i, so the earliest trades keep the largest weight
+        double weight = std::pow(0.9, count_);
+        weighted_sum_ += price * weight;
+        weight_sum_ += weight;
+
+        // Sums of prices relative to the first trade avoid cancellation in the variance
+        double shifted = price - shift_;
+        sum_ += shifted;
+        sum_squares_ += shifted * shifted;
+        ++count_;
+    }
+
+    /** Returns the exponentially weighted average of all trade prices, or zero if no trades. */
+    double pEquilibrium() const
+    {
+        if (count_ == 0) return 0.0;
+        return weighted_sum_ / weight_sum_;
+    }
+
+    /** Returns the root mean squared deviation of all trade prices from p*, or zero if no trades. */
+    double smithsAlpha() const
+    {
+        if (count_ == 0) return 0.0;
+
+        // sum((p - p*)^2) expanded around the shifted prices
+        double d = pEquilibrium() - shift_;
+        double sum_squared_diff = sum_squares_ - 2 * d * sum_ + count_ * d * d;
+        return std::sqrt(std::max(0.0, sum_squared_diff) / count_);
+    }
+
+    /** Returns the number of trades added. */
+    unsigned long count() const
+    {
+        return count_;
+    }
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & count_;
+        ar & weighted_sum_;
+        ar & weight_sum_;
+        ar & shift_;
+        ar & sum_;
+        ar & sum_squares_;
+    }
+
+    unsigned long count_ = 0;
+    double weighted_sum_ = 0.0;
+    double weight_sum_ = 0.0;
+    double shift_ = 0.0;
+    double sum_ = 0.0;
+    double sum_squares_ = 0.0;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,183 @@
+#ifndef INJECTION_SCHEDULE_HPP
+#define INJECTION_SCHEDULE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "offsetschedule.hpp"
+#include "../config/orderinjectorconfig.hpp"
+#include "../order/order.hpp"
+
+/** A customer order to inject at a point in the session, for the trader at an index of the injector's trader list. */
+struct ScheduledCustomerOrder
+{
+    double time;  // Seconds since the session started
+    uint32_t trader;
+    int client_order_id;
+    Order::Side side;
+    int price;
+    int quantity;
+};
+
+/** The customer orders an order injector issues over a session, generated ahead of time in time order.
+ *  Every random choice is drawn from one generator in a fixed order, so a schedule is determined by its seed,
+ *  the injector config and the number of traders, regardless of how fast the orders are then dispatched.
+ *
+ *  Orders are issued in steps, a step every issue delay of the config's time mode, each step of between
+ *  5 and 10 orders at the price offset of its time in the input file or offset function. */
+class InjectionSchedule
+{
+public:
+
+    InjectionSchedule(OrderInjectorConfigPtr config, OffsetSchedule offsets, size_t trader_count, unsigned int seed)
+    : config_{config},
+      offsets_{std::move(offsets)},
+      trader_count_{trader_count},
+      random_generator_{seed}
+    {
+        // Supply and demand ranges are drawn once for the whole session
+        sMin_ = std::uniform_int_distribution<>(config_->supply_min_low, config_->supply_min_high)(random_generator_);
+        sMax_ = std::uniform_int_distribution<>(config_->supply_max_low, config_->supply_max_high)(random_generator_);
+        dMin_ = std::uniform_int_distribution<>(config_->demand_min_low, config_->demand_min_high)(random_generator_);
+        dMax_ = std::uniform_int_distribution<>(config_->demand_max_low, config_->demand_max_high)(random_generator_);
+    }
+
+    /** Generates the orders of every step before the given session time that has not been generated yet. */
+    void extendTo(double time)
+    {
+        if (trader_count_ == 0) return;
+        while (next_step_time_ < time)
+        {
+            generateStep(next_step_time_);
+            next_step_time_ += nextIssueDelay();
+        }
+    }
+
+    /** Drops the orders before the given index, which have been dispatched. Indices of later orders shift down. */
+    void discardBefore(size_t index)
+    {
+        orders_.erase(orders_.begin(), orders_.begin() + std::min(index, orders_.size()));
+    }
+
+    /** Returns the session time up to which orders have been generated. */
+    double horizon() const { return next_step_time_; };
+
+    const std::vector<ScheduledCustomerOrder>& orders() const { return orders_; };
+
+    size_t size() const { return orders_.size(); };
+
+private:
+
+    /** Generates the orders of the step issued at the given session time. */
+    void generateStep(double time)
+    {
+        int offset_value = 0;
+        if (config_->use_input_file && !offsets_.empty())
+        {
+            double total_time = offsets_.totalTime();
+            if (total_time <= 0.0) total_time = 1.0;
+            offset_value = realWorldScheduleOffset(time, total_time, offsets_);
+        }
+        else if (config_->use_offset)
+        {
+            offset_value = scheduleOffset(time);
+        }
+
+        int order_count = std::uniform_int_distribution<>(5, 10)(random_generator_);
+        for (int i = 0; i < order_count; ++i)
+        {
+            orders_.push_back(generateOrder(time, offset_value));
+        }
+    }
+
+    ScheduledCustomerOrder generateOrder(double time, int offset_value)
+    {
+        ScheduledCustomerOrder order;
+        order.time = time;
+        order.client_order_id = next_client_order_id_++;
+        order.side = (std::uniform_int_distribution<>(0, 1)(random_generator_) == 0) ? Order::Side::BID : Order::Side::ASK;
+
+        int low = (order.side == Order::Side::ASK) ? sMin_ : dMin_;
+        int high = (order.side == Order::Side::ASK) ? sMax_ : dMax_;
+        std::uniform_int_distribution<> price_dist(low, high);
+        int price = std::clamp(price_dist(random_generator_) + offset_value, 1, 9999);
+        if (config_->step_mode == "jittered")
+        {
+            price += std::uniform_int_distribution<>(-2, 2)(random_generator_);
+        }
+        else if (config_->step_mode == "random")
+        {
+            price = price_dist(random_generator_);
+        }
+        order.price = price;
+
+        order.quantity = std::uniform_int_distribution<>(10, 50)(random_generator_);
+        order.trader = static_cast<uint32_t>(std::uniform_int_distribution<size_t>(0, trader_count_ - 1)(random_generator_));
+        return order;
+    }
+
+    /** Returns the delay before the next step in seconds, by the config's time mode. */
+    double nextIssueDelay()
+    {
+        double interval = config_->interval;
+        double delay = interval;
+        if (config_->time_mode == "drip-fixed")
+        {
+            delay = (trader_count_ > 1) ? interval / (trader_count_ - 1) : interval;
+        }
+        else if (config_->time_mode == "drip-jitter")
+        {
+            double base = (trader_count_ > 1) ? interval / (trader_count_ - 1) : interval;
+            delay = base + std::uniform_real_distribution<double>(0.0, base)(random_generator_);
+        }
+        else if (config_->time_mode == "drip-poisson")
+        {
+            double lambda = (trader_count_ > 0) ? trader_count_ / interval : 1.0;
+            delay = std::exponential_distribution<double>(lambda)(random_generator_);
+        }
+
+        // A zero interval would never let the session time advance
+        return std::max(delay, MIN_ISSUE_DELAY);
+    }
+
+    /** Returns the offset of the historical schedule at the given session time, the schedule repeating once per total time. */
+    static int realWorldScheduleOffset(double time, double total_time, const OffsetSchedule& offset_schedule)
+    {
+        double percent_elapsed = std::fmod(time / total_time, 1.0);
+        return offset_schedule.offsetAt(percent_elapsed);
+    }
+
+    /** Returns the offset of the sine wave with a linear trend at the given session time. */
+    static int scheduleOffset(double time)
+    {
+        double pi2 = 2 * M_PI;
+        double c = M_PI * 3000;
+        double wavelength = time / c;
+        double gradient = 100 * time / (c / pi2);
+        double amplitude = 100 * time / (c / pi2);
+        double offset = gradient + amplitude * sin(wavelength * time);
+        return static_cast<int>(std::round(offset));
+    }
+
+    /** Shortest delay between steps in seconds. */
+    static constexpr double MIN_ISSUE_DELAY = 0.001;
+
+    OrderInjectorConfigPtr config_;
+    OffsetSchedule offsets_;
+    size_t trader_count_;
+    std::mt19937 random_generator_;
+
+    int sMin_;
+    int sMax_;
+    int dMin_;
+    int dMax_;
+
+    double next_step_time_ = 0.0;
+    int next_client_order_id_ = 0;
+    std::vector<ScheduledCustomerOrder> orders_;
+};
+
+#endif
\ No newline at end of file
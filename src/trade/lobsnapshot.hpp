@@ -8,6 +8,7 @@
 #include <boost/serialization/string.hpp>
 
 #include "../utilities/csvprintable.hpp"
+#include "../utilities/columnarbatch.hpp"
 #include "../order/order.hpp"  // Used for SIDE
 
 /** The LOB Snapshot Data **/
@@ -35,14 +36,29 @@ class LOBSnapshot : public CSVPrintable, std::enable_shared_from_this<LOBSnapsho
         double trade_price; 
 
 
-        std::string describeCSVHeaders() const override
+        static constexpr std::string_view CSV_HEADERS = "timestamp, time_diff, side, best_bid, best_ask, micro_price, mid_price, imbalance, spread, total_volume, p_equilibrium, smiths_alpha, limit_price_chosen, trade_price"; // CSV headers for the LOB Snapshot
+
+        std::string_view csvHeaders() const override
+        {
+            return CSV_HEADERS;
+        }
+
+        void appendCSV(std::string& row) const override
         {
-            return "timestamp, time_diff, side, best_bid, best_ask, micro_price, mid_price, imbalance, spread, total_volume, p_equilibrium, smiths_alpha, limit_price_chosen, trade_price"; // CSV headers for the LOB Snapshot
+            // CSV data for the LOB Snapshot
+            csv::appendFields(row, ", ", timestamp, time_diff, side, best_bid, best_ask, micro_price, mid_price, imbalance, spread, total_volume);
+            row += ',';
+            csv::appendFields(row, ",", p_equilibrium, smiths_alpha, limit_price_chosen, trade_price);
         }
 
-        std::string toCSV() const override
+        void toColumns(ColumnarBatch& batch) const override
         {
-            return std::to_string(timestamp) + ", " + std::to_string(time_diff) + ", " + std::to_string(side) + ", " + std::to_string(best_bid) + ", " + std::to_string(best_ask) + ", " + std::to_string(micro_price) + ", " + std::to_string(mid_price) + ", " + std::to_string(imbalance) + ", " + std::to_string(spread) + ", " + std::to_string(total_volume) + "," + std::to_string(p_equilibrium) + "," + std::to_string(smiths_alpha) + "," + std::to_string(limit_price_chosen) + "," + std::to_string(trade_price); // CSV data for the LOB Snapshot
+            batch.append("timestamp", timestamp); batch.append("time_diff", time_diff); batch.append("side", side);
+            batch.append("best_bid", best_bid); batch.append("best_ask", best_ask);
+            batch.append("micro_price", micro_price); batch.append("mid_price", mid_price);
+            batch.append("imbalance", imbalance); batch.append("spread", spread); batch.append("total_volume", total_volume);
+            batch.append("p_equilibrium", p_equilibrium); batch.append("smiths_alpha", smiths_alpha);
+            batch.append("limit_price_chosen", limit_price_chosen); batch.append("trade_price", trade_price);
         }
 
     private:
@@ -2,12 +2,16 @@
 #define MARKET_DATA_HPP
 
 #include <string>
+#include <array>
+#include <type_traits>
 
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/serialization/string.hpp>
 
+#include "marketdatafields.hpp"
 #include "../utilities/csvprintable.hpp"
+#include "../utilities/columnarbatch.hpp"
 
 /** The Level 1 Market Data Feed **/
 class MarketData : public CSVPrintable, std::enable_shared_from_this<MarketData> {
@@ -15,53 +19,129 @@ class MarketData : public CSVPrintable, std::enable_shared_from_this<MarketData>
         MarketData() = default;
 
         std::string ticker;
-        double best_bid;
-        double worst_bid;
-        double best_ask;
-        double worst_ask;
-        int best_bid_size;
-        int best_ask_size;
+        double best_bid = 0;
+        double worst_bid = 0;
+        double best_ask = 0;
+        double worst_ask = 0;
+        int best_bid_size = 0;
+        int best_ask_size = 0;
 
-        int bids_volume;
-        int asks_volume;
-        int bids_count;
-        int asks_count;
+        int bids_volume = 0;
+        int asks_volume = 0;
+        int bids_count = 0;
+        int asks_count = 0;
 
-        double last_price_traded;
-        int last_quantity_traded;
+        double last_price_traded = 0;
+        int last_quantity_traded = 0;
 
-        double high_price;
-        double low_price;
-        int cumulative_volume_traded;
-        int trades_count;
+        double high_price = 0;
+        double low_price = 0;
+        int cumulative_volume_traded = 0;
+        int trades_count = 0;
 
-        double volume_per_tick; 
+        double volume_per_tick = 0; 
+        double vwap = 0; // volume weighted average price of the trades in the ticker's trade statistics window
 
-        unsigned long long timestamp;
+        unsigned long long timestamp = 0;
 
         // New Metrics 
-        unsigned long long time_diff; 
-        double mid_price; 
-        double micro_price;
-        int side;
-        double imbalance; 
-        double spread;
-        double total_volume;
-        double p_equilibrium;
-        double smiths_alpha;
-        double limit_price; 
-
-        std::string describeCSVHeaders() const override
+        unsigned long long time_diff = 0; 
+        double mid_price = 0; 
+        double micro_price = 0;
+        int side = 0;
+        double imbalance = 0; 
+        double spread = 0;
+        double total_volume = 0;
+        double p_equilibrium = 0;
+        double smiths_alpha = 0;
+        double limit_price = 0; 
+
+        /** Groups of fields filled in, and serialised; the rest are left at zero. */
+        MarketDataFields fields = MarketDataFields::ALL;
+
+        /** Resets the fields outside the given groups, which are all that is serialised from then on. */
+        void keepOnly(MarketDataFields kept)
         {
-            return "timestamp,ticker,best_bid,best_ask,best_bid_size,best_ask_size,bids_volume,asks_volume,bids_count,asks_count,worst_bid,worst_ask"; // CSV headers for the Market Data
+            if (!includes(kept, MarketDataFields::DEPTH))
+            {
+                worst_bid = 0; worst_ask = 0;
+                bids_volume = 0; asks_volume = 0; bids_count = 0; asks_count = 0; total_volume = 0;
+            }
+            if (!includes(kept, MarketDataFields::TRADE_STATS))
+            {
+                high_price = 0; low_price = 0; volume_per_tick = 0; vwap = 0;
+            }
+            if (!includes(kept, MarketDataFields::ANALYTICS))
+            {
+                time_diff = 0; mid_price = 0; micro_price = 0; side = 0; imbalance = 0; spread = 0; limit_price = 0;
+            }
+            if (!includes(kept, MarketDataFields::EQUILIBRIUM))
+            {
+                p_equilibrium = 0; smiths_alpha = 0;
+            }
+            fields = kept;
         }
 
-        std::string toCSV() const override
+        /** Number of numeric fields exchanged in market data delta updates. */
+        static constexpr size_t FIELD_COUNT = 29;
+
+        /** Returns the numeric fields in a fixed order, for computing delta updates. */
+        std::array<double, FIELD_COUNT> values() const
+        {
+            std::array<double, FIELD_COUNT> result;
+            size_t index = 0;
+            visitFields(*this, [&](const auto& field) { result[index++] = static_cast<double>(field); });
+            return result;
+        }
+
+        /** Sets the numeric field at the given position of values(). */
+        void setValue(size_t field_index, double value)
+        {
+            size_t index = 0;
+            visitFields(*this, [&](auto& field) {
+                if (index++ == field_index) field = static_cast<std::decay_t<decltype(field)>>(value);
+            });
+        }
+
+        static constexpr std::string_view CSV_HEADERS = "timestamp,ticker,best_bid,best_ask,best_bid_size,best_ask_size,bids_volume,asks_volume,bids_count,asks_count,worst_bid,worst_ask"; // CSV headers for the Market Data
+
+        std::string_view csvHeaders() const override
+        {
+            return CSV_HEADERS;
+        }
+
+        void appendCSV(std::string& row) const override
+        {
+            csv::appendFields(row, ",", timestamp, ticker, best_bid, best_ask, best_bid_size, best_ask_size, bids_volume, asks_volume, bids_count, asks_count, worst_bid, worst_ask); // CSV data for the Market Data
+        }
+
+        void toColumns(ColumnarBatch& batch) const override
         {
-            return std::to_string(timestamp) + "," + ticker + "," + std::to_string(best_bid) + "," + std::to_string(best_ask) + "," + std::to_string(best_bid_size) + "," + std::to_string(best_ask_size) + "," + std::to_string(bids_volume) + "," + std::to_string(asks_volume) + "," + std::to_string(bids_count) + "," + std::to_string(asks_count) + "," + std::to_string(worst_bid) + "," + std::to_string(worst_ask); // CSV data for the Market Data
+            batch.append("timestamp", timestamp); batch.append("ticker", ticker);
+            batch.append("best_bid", best_bid); batch.append("best_ask", best_ask);
+            batch.append("best_bid_size", best_bid_size); batch.append("best_ask_size", best_ask_size);
+            batch.append("bids_volume", bids_volume); batch.append("asks_volume", asks_volume);
+            batch.append("bids_count", bids_count); batch.append("asks_count", asks_count);
+            batch.append("worst_bid", worst_bid); batch.append("worst_ask", worst_ask);
         }
 
     private:
+        /** Calls the visitor with each numeric field in the order of values(). */
+        template<class Self, class Visitor>
+        static void visitFields(Self& data, Visitor&& visit)
+        {
+            visit(data.best_bid); visit(data.worst_bid); visit(data.best_ask); visit(data.worst_ask);
+            visit(data.best_bid_size); visit(data.best_ask_size);
+            visit(data.bids_volume); visit(data.asks_volume); visit(data.bids_count); visit(data.asks_count);
+            visit(data.last_price_traded); visit(data.last_quantity_traded);
+            visit(data.high_price); visit(data.low_price); visit(data.cumulative_volume_traded); visit(data.trades_count);
+            visit(data.volume_per_tick); visit(data.timestamp);
+            visit(data.time_diff); visit(data.mid_price); visit(data.micro_price); visit(data.side);
+            visit(data.imbalance); visit(data.spread); visit(data.total_volume);
+            visit(data.p_equilibrium); visit(data.smiths_alpha); visit(data.limit_price);
+            visit(data.vwap);
+        }
+
         friend std::ostream& operator<<(std::ostream& os, const MarketData& data)
         {
             os << "Market Data: " << data.ticker << ":\n" 
@@ -85,42 +165,56 @@ class MarketData : public CSVPrintable, std::enable_shared_from_this<MarketData>
         template<class Archive>
         void serialize(Archive & ar, const unsigned int version)
         {
+            // Only the groups of fields filled in are sent
+            ar & fields;
             ar & ticker;
+
             ar & best_bid;
-            ar & worst_bid;
             ar & best_ask;
-            ar & worst_ask;
             ar & best_bid_size;
             ar & best_ask_size;
-
-            ar & bids_volume;
-            ar & asks_volume;
-            ar & bids_count;
-            ar & asks_count;
-
             ar & last_price_traded;
             ar & last_quantity_traded;
-
-            ar & high_price;
-            ar & low_price;
             ar & cumulative_volume_traded;
             ar & trades_count;
-
-            ar & volume_per_tick;
-
             ar & timestamp;
 
+            if (includes(fields, MarketDataFields::DEPTH))
+            {
+                ar & worst_bid;
+                ar & worst_ask;
+                ar & bids_volume;
+                ar & asks_volume;
+                ar & bids_count;
+                ar & asks_count;
+                ar & total_volume;
+            }
+
+            if (includes(fields, MarketDataFields::TRADE_STATS))
+            {
+                ar & high_price;
+                ar & low_price;
+                ar & volume_per_tick;
+                ar & vwap;
+            }
+
             //Serialise new metrics for LOB snapshot
-            ar & time_diff; 
-            ar & mid_price;
-            ar & micro_price;
-            ar & side; 
-            ar & imbalance; 
-            ar & spread; 
-            ar & total_volume;
-            ar & p_equilibrium;
-            ar & smiths_alpha; 
-            ar & limit_price; 
+            if (includes(fields, MarketDataFields::ANALYTICS))
+            {
+                ar & time_diff; 
+                ar & mid_price;
+                ar & micro_price;
+                ar & side; 
+                ar & imbalance; 
+                ar & spread; 
+                ar & limit_price; 
+            }
+
+            if (includes(fields, MarketDataFields::EQUILIBRIUM))
+            {
+                ar & p_equilibrium;
+                ar & smiths_alpha; 
+            }
         }
 };
 
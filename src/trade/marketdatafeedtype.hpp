@@ -0,0 +1,28 @@
+#ifndef MARKET_DATA_FEED_TYPE_HPP
+#define MARKET_DATA_FEED_TYPE_HPP
+
+#include <string>
+
+enum class MarketDataFeedType : int
+{
+    FULL,   // Every update carries the complete market data
+    DELTA   // Updates carry only the fields changed since the previous one, with periodic full snapshots
+};
+
+inline std::string to_string(MarketDataFeedType feed_type)
+{
+    switch (feed_type) {
+        case MarketDataFeedType::FULL: return std::string{"full"};
+        case MarketDataFeedType::DELTA: return std::string{"delta"};
+        default: return std::string{""};
+    }
+}
+
+/** Returns the market data feed type for the given name. Defaults to the full feed. */
+inline MarketDataFeedType market_data_feed_type_from_string(std::string_view name)
+{
+    if (name == "delta") return MarketDataFeedType::DELTA;
+    return MarketDataFeedType::FULL;
+}
+
+#endif
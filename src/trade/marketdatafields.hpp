@@ -0,0 +1,66 @@
+#ifndef MARKET_DATA_FIELDS_HPP
+#define MARKET_DATA_FIELDS_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/** Groups of market data fields, combined into the set a subscriber needs.
+ *  The top of the book and the last trade are always included. */
+enum class MarketDataFields : uint8_t
+{
+    TOP = 0,                // Best bid and ask with their sizes, the last trade, the volume and number of trades, the timestamp
+    DEPTH = 1 << 0,         // Worst bid and ask, and the volume and number of orders on each side
+    TRADE_STATS = 1 << 1,   // High, low and volume weighted average trade prices over a window, and the volume traded since the previous update
+    ANALYTICS = 1 << 2,     // Mid and micro price, imbalance, spread, aggressing side, time since the last trade, limit price
+    EQUILIBRIUM = 1 << 3,   // Competitive equilibrium price p* and Smith's alpha
+    ALL = DEPTH | TRADE_STATS | ANALYTICS | EQUILIBRIUM
+};
+
+inline constexpr MarketDataFields operator|(MarketDataFields a, MarketDataFields b)
+{
+    return static_cast<MarketDataFields>(static_cast<uint8_t>(a) | static_cast<uint8_t>(b));
+}
+
+inline constexpr MarketDataFields& operator|=(MarketDataFields& a, MarketDataFields b)
+{
+    return a = a | b;
+}
+
+/** Indicates whether the set includes every field of the given group. */
+inline constexpr bool includes(MarketDataFields set, MarketDataFields group)
+{
+    return (static_cast<uint8_t>(set) & static_cast<uint8_t>(group)) == static_cast<uint8_t>(group);
+}
+
+inline std::string to_string(MarketDataFields fields)
+{
+    if (fields == MarketDataFields::ALL) return std::string{"all"};
+
+    std::string names {"top"};
+    if (includes(fields, MarketDataFields::DEPTH)) names += ",depth";
+    if (includes(fields, MarketDataFields::TRADE_STATS)) names += ",trade-stats";
+    if (includes(fields, MarketDataFields::ANALYTICS)) names += ",analytics";
+    if (includes(fields, MarketDataFields::EQUILIBRIUM)) names += ",equilibrium";
+    return names;
+}
+
+/** Returns the set of field groups named in a comma-separated list, such as "depth,trade-stats". Unknown names are ignored. */
+inline MarketDataFields market_data_fields_from_string(std::string_view names)
+{
+    MarketDataFields fields = MarketDataFields::TOP;
+    while (!names.empty())
+    {
+        size_t comma = names.find(',');
+        std::string_view name = names.substr(0, comma);
+        if (name == "all") fields |= MarketDataFields::ALL;
+        else if (name == "depth") fields |= MarketDataFields::DEPTH;
+        else if (name == "trade-stats") fields |= MarketDataFields::TRADE_STATS;
+        else if (name == "analytics") fields |= MarketDataFields::ANALYTICS;
+        else if (name == "equilibrium") fields |= MarketDataFields::EQUILIBRIUM;
+        names = (comma == std::string_view::npos) ? std::string_view{} : names.substr(comma + 1);
+    }
+    return fields;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef MARKET_DEPTH_HPP
+#define MARKET_DEPTH_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+/** Aggregate of all resting orders at a single price. */
+class DepthLevel {
+    public:
+        DepthLevel() = default;
+
+        DepthLevel(double price, int quantity, int count)
+        : price{price},
+          quantity{quantity},
+          count{count}
+        {
+        }
+
+        double price;
+        int quantity;
+        int count;
+
+    private:
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & price;
+            ar & quantity;
+            ar & count;
+        }
+};
+
+/** The Level 2 Market Data Feed: the top price levels of each side, best first. **/
+class MarketDepth : std::enable_shared_from_this<MarketDepth> {
+    public:
+        MarketDepth() = default;
+
+        std::string ticker;
+        unsigned long long timestamp;
+        std::vector<DepthLevel> bids;
+        std::vector<DepthLevel> asks;
+
+    private:
+        friend std::ostream& operator<<(std::ostream& os, const MarketDepth& depth)
+        {
+            os << "Market Depth: " << depth.ticker << ":\n";
+            for (const DepthLevel& level : depth.asks)
+            {
+                os << "ASK: " << level.quantity << " (" << level.count << ") @ $" << level.price << "\n";
+            }
+            for (const DepthLevel& level : depth.bids)
+            {
+                os << "BID: " << level.quantity << " (" << level.count << ") @ $" << level.price << "\n";
+            }
+            return os;
+        }
+
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & ticker;
+            ar & timestamp;
+            ar & bids;
+            ar & asks;
+        }
+};
+
+typedef std::shared_ptr<MarketDepth> MarketDepthPtr;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,252 @@
+#ifndef OFFSET_SCHEDULE_HPP
+#define OFFSET_SCHEDULE_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../utilities/mappedfile.hpp"
+
+/** A table of price offsets over normalised time, derived from a historical price file.
+ *  Times are sorted, so the offset for a point in time is found by binary search. */
+class OffsetSchedule
+{
+public:
+
+    OffsetSchedule() = default;
+
+    /** Loads the schedule of the given historical data file, from its sidecar cache if it is up to date.
+     *  Otherwise parses the file and writes the cache for the next load. */
+    static OffsetSchedule load(const std::string& historical_data_file)
+    {
+        std::filesystem::path source{historical_data_file};
+        std::string cache_path = historical_data_file + CACHE_SUFFIX;
+        uint64_t source_size = std::filesystem::file_size(source);
+        int64_t source_time = std::filesystem::last_write_time(source).time_since_epoch().count();
+
+        OffsetSchedule schedule;
+        if (schedule.readCache(cache_path, source_size, source_time))
+        {
+            return schedule;
+        }
+
+        MappedFile file{historical_data_file};
+        schedule = parse(file.view());
+        if (schedule.empty())
+        {
+            throw std::runtime_error("No data points found in historical file: " + historical_data_file);
+        }
+        schedule.writeCache(cache_path, source_size, source_time);
+        return schedule;
+    }
+
+    /** Parses historical data in the CSV format Date,Time,Open,High,Low,Close,Volume, with times as HH:MM:SS.
+     *  Times are normalised to the span of the file and close prices scaled to offsets between zero and SCALE_FACTOR. */
+    static OffsetSchedule parse(std::string_view data)
+    {
+        std::vector<double> times;
+        std::vector<double> prices;
+        double min_price = std::numeric_limits<double>::max();
+        double max_price = std::numeric_limits<double>::lowest();
+
+        size_t line_start = 0;
+        while (line_start < data.size())
+        {
+            size_t line_end = data.find('\n', line_start);
+            if (line_end == std::string_view::npos) line_end = data.size();
+            std::string_view line = data.substr(line_start, line_end - line_start);
+            line_start = line_end + 1;
+
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty()) continue;
+
+            std::string_view fields[FIELD_COUNT];
+            splitFields(line, fields);
+            double price = parsePrice(fields[CLOSE_FIELD]);
+            times.push_back(parseTime(fields[TIME_FIELD]));
+            prices.push_back(price);
+            min_price = std::min(min_price, price);
+            max_price = std::max(max_price, price);
+        }
+
+        OffsetSchedule schedule;
+        if (times.empty()) return schedule;
+
+        // Rows are expected in time order; sorting keeps lookups correct if they are not
+        std::vector<size_t> order(times.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return times[a] < times[b]; });
+
+        double first_time = times[order.front()];
+        double total_time = times[order.back()] - first_time;
+        double price_range = max_price - min_price;
+
+        schedule.times_.reserve(times.size());
+        schedule.offsets_.reserve(times.size());
+        for (size_t index : order)
+        {
+            double normalised_time = (total_time > 0) ? (times[index] - first_time) / total_time : 0.0;
+            double normalised_price = (price_range > 0) ? std::clamp((prices[index] - min_price) / price_range, 0.0, 1.0) : 0.0;
+            schedule.times_.push_back(normalised_time);
+            schedule.offsets_.push_back(static_cast<int32_t>(std::round(normalised_price * SCALE_FACTOR)));
+        }
+        return schedule;
+    }
+
+    /** Returns the offset of the first point at or after the given normalised time, or of the last point if there is none. */
+    int offsetAt(double normalised_time) const
+    {
+        auto it = std::lower_bound(times_.begin(), times_.end(), normalised_time);
+        if (it == times_.end()) return offsets_.back();
+        return offsets_[it - times_.begin()];
+    }
+
+    /** Returns the normalised time of the last point. */
+    double totalTime() const { return times_.back(); };
+
+    /** Returns the number of points in the schedule. */
+    size_t size() const { return times_.size(); };
+
+    bool empty() const { return times_.empty(); };
+
+    /** Offsets are scaled to the range [0, SCALE_FACTOR]. */
+    static constexpr int SCALE_FACTOR = 40;
+
+    /** Suffix of the sidecar cache file next to the historical data file. */
+    static constexpr char CACHE_SUFFIX[] = ".offsets";
+
+private:
+
+    static constexpr size_t FIELD_COUNT = 7;
+    static constexpr size_t TIME_FIELD = 1;
+    static constexpr size_t CLOSE_FIELD = 5;
+
+    /** Splits the line at commas into the given fields, leaving missing fields empty. */
+    static void splitFields(std::string_view line, std::string_view (&fields)[FIELD_COUNT])
+    {
+        size_t start = 0;
+        for (size_t i = 0; i < FIELD_COUNT && start <= line.size(); ++i)
+        {
+            size_t end = line.find(',', start);
+            if (end == std::string_view::npos) end = line.size();
+            fields[i] = line.substr(start, end - start);
+            start = end + 1;
+        }
+    }
+
+    /** Parses a time HH:MM:SS into seconds since midnight. */
+    static double parseTime(std::string_view time)
+    {
+        int parts[3];
+        const char* it = time.data();
+        const char* end = time.data() + time.size();
+        for (int i = 0; i < 3; ++i)
+        {
+            auto [ptr, ec] = std::from_chars(it, end, parts[i]);
+            bool separator_expected = i < 2;
+            if (ec != std::errc{} || (separator_expected && (ptr == end || *ptr != ':')))
+            {
+                throw std::invalid_argument("Invalid time format: " + std::string{time});
+            }
+            it = separator_expected ? ptr + 1 : ptr;
+        }
+        return parts[0] * 3600 + parts[1] * 60 + parts[2];
+    }
+
+    static double parsePrice(std::string_view price)
+    {
+        double value;
+        auto [ptr, ec] = std::from_chars(price.data(), price.data() + price.size(), value);
+        if (ec != std::errc{})
+        {
+            throw std::invalid_argument("Invalid price: " + std::string{price});
+        }
+        return value;
+    }
+
+    /** Cache layout: the 8 bytes "OFFSETS1", uint64 size and int64 modification time of the historical data file,
+     *  uint64 point count, then the times as doubles and the offsets as int32, in the byte order of the host. */
+    bool readCache(const std::string& cache_path, uint64_t source_size, int64_t source_time)
+    {
+        std::error_code error;
+        if (!std::filesystem::exists(cache_path, error)) return false;
+
+        try
+        {
+            MappedFile cache{cache_path};
+            std::string_view data = cache.view();
+            constexpr size_t header_size = sizeof(CACHE_MAGIC) - 1 + 3 * sizeof(uint64_t);
+            if (data.size() < header_size || data.substr(0, sizeof(CACHE_MAGIC) - 1) != CACHE_MAGIC) return false;
+
+            const char* it = data.data() + sizeof(CACHE_MAGIC) - 1;
+            uint64_t cached_size, count;
+            int64_t cached_time;
+            std::memcpy(&cached_size, it, sizeof(uint64_t)); it += sizeof(uint64_t);
+            std::memcpy(&cached_time, it, sizeof(int64_t)); it += sizeof(int64_t);
+            std::memcpy(&count, it, sizeof(uint64_t)); it += sizeof(uint64_t);
+            if (cached_size != source_size || cached_time != source_time || count == 0) return false;
+            if (data.size() != header_size + count * (sizeof(double) + sizeof(int32_t))) return false;
+
+            times_.resize(count);
+            offsets_.resize(count);
+            std::memcpy(times_.data(), it, count * sizeof(double)); it += count * sizeof(double);
+            std::memcpy(offsets_.data(), it, count * sizeof(int32_t));
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            times_.clear();
+            offsets_.clear();
+            return false;
+        }
+    }
+
+    /** Writes the cache through a temporary file, so concurrent runs never read a partial cache.
+     *  The cache is only an optimisation, so failing to write it is ignored. */
+    void writeCache(const std::string& cache_path, uint64_t source_size, int64_t source_time) const
+    {
+        std::string temporary_path = cache_path + "." + std::to_string(::getpid());
+        {
+            std::ofstream cache{temporary_path, std::ios::binary};
+            if (!cache) return;
+
+            uint64_t count = times_.size();
+            cache.write(CACHE_MAGIC, sizeof(CACHE_MAGIC) - 1);
+            cache.write(reinterpret_cast<const char*>(&source_size), sizeof(source_size));
+            cache.write(reinterpret_cast<const char*>(&source_time), sizeof(source_time));
+            cache.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            cache.write(reinterpret_cast<const char*>(times_.data()), count * sizeof(double));
+            cache.write(reinterpret_cast<const char*>(offsets_.data()), count * sizeof(int32_t));
+            if (!cache)
+            {
+                cache.close();
+                std::error_code error;
+                std::filesystem::remove(temporary_path, error);
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporary_path, cache_path, error);
+        if (error) std::filesystem::remove(temporary_path, error);
+    }
+
+    static constexpr char CACHE_MAGIC[] = "OFFSETS1";
+
+    std::vector<double> times_;
+    std::vector<int32_t> offsets_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef PREDICTION_RECORD_HPP
+#define PREDICTION_RECORD_HPP
+
+#include <array>
+#include <string>
+
+#include "../utilities/csvprintable.hpp"
+
+/** How the price of a DeepTrader prediction was chosen. */
+enum class PredictionOutcome : int
+{
+    MODEL,          // The model price was used
+    UNREASONABLE,   // The model price was out of range and replaced by a price next to the best bid or ask
+    UNAVAILABLE,    // The model was not initialised and the best bid or ask was used
+    ERROR           // Inference failed and the best bid or ask was used
+};
+
+inline std::string to_string(PredictionOutcome outcome)
+{
+    switch (outcome) {
+        case PredictionOutcome::MODEL: return std::string{"model"};
+        case PredictionOutcome::UNREASONABLE: return std::string{"unreasonable"};
+        case PredictionOutcome::UNAVAILABLE: return std::string{"unavailable"};
+        case PredictionOutcome::ERROR: return std::string{"error"};
+        default: return std::string{""};
+    }
+}
+
+/** Telemetry of a single DeepTrader price prediction. */
+class PredictionRecord : public CSVPrintable
+{
+public:
+
+    /** Number of features fed to the models. */
+    static constexpr size_t FEATURE_COUNT = 13;
+
+    unsigned long long timestamp = 0; // nanoseconds since epoch
+    int agent_id = 0;
+    int side = 0; // 1 for BID, 0 for ASK
+    PredictionOutcome outcome = PredictionOutcome::MODEL;
+    std::array<float, FEATURE_COUNT> features {}; // raw, in model input order
+    float normalised_output = 0;
+    float denormalised_output = 0;
+    double price = 0;
+
+    static constexpr std::string_view CSV_HEADERS = "timestamp,agent_id,side,outcome,"
+        "market_timestamp,time_diff,is_bid,best_bid,best_ask,micro_price,mid_price,imbalance,spread,total_volume,p_equilibrium,smiths_alpha,limit_price,"
+        "normalised_output,denormalised_output,price";
+
+    std::string_view csvHeaders() const override
+    {
+        return CSV_HEADERS;
+    }
+
+    void appendCSV(std::string& row) const override
+    {
+        csv::appendFields(row, ",", timestamp, agent_id, side, to_string(outcome));
+        for (float feature : features)
+        {
+            row += ',';
+            csv::append(row, feature);
+        }
+        row += ',';
+        csv::appendFields(row, ",", normalised_output, denormalised_output, price);
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,125 @@
+#ifndef PROFIT_LEDGER_HPP
+#define PROFIT_LEDGER_HPP
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/serialization/access.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+/** Profit and loss of the agents trading at an exchange, kept up to date as trades execute in arrays indexed by agent ID,
+ *  counted from the first ID of the trial, so that a trade costs two array updates rather than lookups by name. */
+class ProfitLedger
+{
+public:
+
+    /** The profit, number of trades and name of each agent, indexed by its ID less the first ID of the trial. */
+    struct Accounts
+    {
+        std::vector<double> profits;
+        std::vector<unsigned int> trades;
+        std::vector<std::string> names; // empty for agents that have not subscribed
+
+        /** Returns the profits summed by agent name, over the agents that have traded. */
+        std::unordered_map<std::string, double> profitsByName() const
+        {
+            std::unordered_map<std::string, double> by_name;
+            for (size_t i = 0; i < profits.size(); ++i)
+            {
+                if (trades[i] > 0) by_name[names[i]] += profits[i];
+            }
+            return by_name;
+        }
+
+    private:
+
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & profits;
+            ar & trades;
+            ar & names;
+        }
+    };
+
+    ProfitLedger(const ProfitLedger&) = delete;
+    ProfitLedger& operator=(const ProfitLedger&) = delete;
+
+    explicit ProfitLedger(int first_agent_id = 0)
+    : first_agent_id_{first_agent_id}
+    {
+    }
+
+    /** Names the agent with the given ID. */
+    void setName(int agent_id, const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ensureSlot(agent_id)) return;
+        accounts_.names[agent_id - first_agent_id_] = name;
+    }
+
+    /** Adds the profit of a trade to the account of the agent with the given ID. IDs before the first of the trial are ignored. */
+    void record(int agent_id, double profit)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ensureSlot(agent_id)) return;
+        accounts_.profits[agent_id - first_agent_id_] += profit;
+        ++accounts_.trades[agent_id - first_agent_id_];
+    }
+
+    /** Zeroes the profits of the agents whose names satisfy the predicate. */
+    void resetIf(const std::function<bool(const std::string&)>& predicate)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < accounts_.profits.size(); ++i)
+        {
+            if (predicate(accounts_.names[i])) accounts_.profits[i] = 0.0;
+        }
+    }
+
+    /** Returns a copy of the accounts, consistent as of one moment. */
+    Accounts accounts() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return accounts_;
+    }
+
+    /** Replaces the accounts with the given ones, indexed from the first ID of this trial. */
+    void restore(Accounts accounts)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        accounts_ = std::move(accounts);
+    }
+
+    int firstAgentId() const
+    {
+        return first_agent_id_;
+    }
+
+private:
+
+    /** Grows the arrays to hold the given agent. Returns false if the ID is before the first of the trial. */
+    bool ensureSlot(int agent_id)
+    {
+        if (agent_id < first_agent_id_) return false;
+        size_t index = agent_id - first_agent_id_;
+        if (index >= accounts_.profits.size())
+        {
+            accounts_.profits.resize(index + 1, 0.0);
+            accounts_.trades.resize(index + 1, 0);
+            accounts_.names.resize(index + 1);
+        }
+        return true;
+    }
+
+    int first_agent_id_;
+    Accounts accounts_;
+    mutable std::mutex mutex_;
+};
+
+#endif
@@ -22,16 +22,16 @@ class ProfitSnapshot : public CSVPrintable, std::enable_shared_from_this<ProfitS
         std::string agent_name;
         double profit;
 
-        std::string describeCSVHeaders() const override
+        static constexpr std::string_view CSV_HEADERS = "agent_name, profit"; // CSV headers for the Profit Snapshot
+
+        std::string_view csvHeaders() const override
         {
-            //return "agent_id, agent_name, profit"; // CSV headers for the Profit Snapshot
-            return "agent_name, profit"; // CSV headers for the Profit Snapshot
+            return CSV_HEADERS;
         }
 
-        std::string toCSV() const override
+        void appendCSV(std::string& row) const override
         {
-            //return std::to_string(agent_id) + ", " + agent_name + ", " + std::to_string(profit);
-            return agent_name + ", " + std::to_string(profit);
+            csv::appendFields(row, ", ", agent_name, profit);
         }
 
     private:
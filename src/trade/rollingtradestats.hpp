@@ -0,0 +1,231 @@
+#ifndef ROLLING_TRADE_STATS_HPP
+#define ROLLING_TRADE_STATS_HPP
+
+#include <cctype>
+#include <deque>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <boost/serialization/access.hpp>
+#include <boost/serialization/deque.hpp>
+
+/** The trades a ticker's rolling trade statistics cover: its latest trades, or those within a span of time. */
+struct TradeStatsWindow
+{
+    enum Kind : unsigned char
+    {
+        TRADES,
+        TIME
+    };
+
+    Kind kind = TRADES;
+    unsigned long long size = 14; // trades, or nanoseconds
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & kind;
+        ar & size;
+    }
+};
+
+inline std::string to_string(const TradeStatsWindow& window)
+{
+    if (window.kind == TradeStatsWindow::TRADES) return std::to_string(window.size);
+    if (window.size % 1000000000ULL == 0) return std::to_string(window.size / 1000000000ULL) + "s";
+    if (window.size % 1000000ULL == 0) return std::to_string(window.size / 1000000ULL) + "ms";
+    if (window.size % 1000ULL == 0) return std::to_string(window.size / 1000ULL) + "us";
+    return std::to_string(window.size) + "ns";
+}
+
+/** Returns the window described by the given string: a number of trades such as "14",
+ *  or a span of time in seconds, milliseconds, microseconds or nanoseconds such as "5s" or "250ms". */
+inline TradeStatsWindow trade_stats_window_from_string(std::string_view window)
+{
+    size_t digits = 0;
+    while (digits < window.size() && std::isdigit(static_cast<unsigned char>(window[digits]))) ++digits;
+
+    unsigned long long size = (digits > 0) ? std::stoull(std::string{window.substr(0, digits)}) : 0;
+    std::string_view unit = window.substr(digits);
+    if (size == 0)
+    {
+        throw std::runtime_error("Invalid trade statistics window: " + std::string{window});
+    }
+
+    if (unit.empty()) return TradeStatsWindow{TradeStatsWindow::TRADES, size};
+    if (unit == "s") return TradeStatsWindow{TradeStatsWindow::TIME, size * 1000000000ULL};
+    if (unit == "ms") return TradeStatsWindow{TradeStatsWindow::TIME, size * 1000000ULL};
+    if (unit == "us") return TradeStatsWindow{TradeStatsWindow::TIME, size * 1000ULL};
+    if (unit == "ns") return TradeStatsWindow{TradeStatsWindow::TIME, size};
+    throw std::runtime_error("Unknown unit of trade statistics window: " + std::string{window});
+}
+
+/** Statistics over the trades of a ticker within a rolling window: the high and low price, kept in monotonic queues,
+ *  and the volume weighted average price, volume and number of trades, kept as running sums.
+ *  Each trade costs amortised constant time to add and to expire. Also tracks the volume traded between updates. */
+class RollingTradeStats
+{
+public:
+
+    RollingTradeStats() = default;
+
+    explicit RollingTradeStats(TradeStatsWindow window)
+    : window_{window}
+    {
+    }
+
+    /** Adds a trade of the given price and quantity at the given time in nanoseconds, expiring those it pushes out of the window. */
+    void add(double price, int quantity, unsigned long long timestamp)
+    {
+        unsigned long long sequence = next_sequence_++;
+        trades_.push_back(Trade{sequence, timestamp, price, quantity});
+        notional_ += price * quantity;
+        volume_ += quantity;
+        total_volume_ += quantity;
+
+        // A price at or beyond an older one is the extreme for as long as the older one would be
+        while (!highs_.empty() && highs_.back().price <= price) highs_.pop_back();
+        highs_.push_back(Extreme{sequence, price});
+        while (!lows_.empty() && lows_.back().price >= price) lows_.pop_back();
+        lows_.push_back(Extreme{sequence, price});
+
+        expire(timestamp);
+    }
+
+    /** Expires the trades outside the window at the given time in nanoseconds. Trade windows expire only as trades are added. */
+    void expire(unsigned long long now)
+    {
+        while (!trades_.empty() && isExpired(trades_.front(), now))
+        {
+            const Trade& oldest = trades_.front();
+            notional_ -= oldest.price * oldest.quantity;
+            volume_ -= oldest.quantity;
+            if (highs_.front().sequence == oldest.sequence) highs_.pop_front();
+            if (lows_.front().sequence == oldest.sequence) lows_.pop_front();
+            trades_.pop_front();
+        }
+
+        // Running sums are exact again once the window is empty
+        if (trades_.empty()) notional_ = 0.0;
+    }
+
+    /** Returns the highest trade price in the window, or nothing if it has no trades. */
+    std::optional<double> high() const
+    {
+        if (highs_.empty()) return std::nullopt;
+        return highs_.front().price;
+    }
+
+    /** Returns the lowest trade price in the window, or nothing if it has no trades. */
+    std::optional<double> low() const
+    {
+        if (lows_.empty()) return std::nullopt;
+        return lows_.front().price;
+    }
+
+    /** Returns the volume weighted average trade price in the window, or nothing if it has no trades. */
+    std::optional<double> vwap() const
+    {
+        if (volume_ == 0) return std::nullopt;
+        return notional_ / volume_;
+    }
+
+    /** Returns the volume traded in the window. */
+    long long volume() const
+    {
+        return volume_;
+    }
+
+    /** Returns the number of trades in the window. */
+    size_t count() const
+    {
+        return trades_.size();
+    }
+
+    /** Returns the volume traded since this was last called. */
+    long long takeVolumeSinceUpdate()
+    {
+        long long volume = total_volume_ - reported_volume_;
+        reported_volume_ = total_volume_;
+        return volume;
+    }
+
+    const TradeStatsWindow& window() const
+    {
+        return window_;
+    }
+
+private:
+
+    struct Trade
+    {
+        unsigned long long sequence;
+        unsigned long long timestamp;
+        double price;
+        int quantity;
+
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & sequence;
+            ar & timestamp;
+            ar & price;
+            ar & quantity;
+        }
+    };
+
+    /** A trade that is the high or low of the window until it expires or is surpassed. */
+    struct Extreme
+    {
+        unsigned long long sequence;
+        double price;
+
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & sequence;
+            ar & price;
+        }
+    };
+
+    bool isExpired(const Trade& trade, unsigned long long now) const
+    {
+        if (window_.kind == TradeStatsWindow::TRADES) return trades_.size() > window_.size;
+        return trade.timestamp + window_.size <= now;
+    }
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & window_;
+        ar & trades_;
+        ar & highs_;
+        ar & lows_;
+        ar & notional_;
+        ar & volume_;
+        ar & next_sequence_;
+        ar & total_volume_;
+        ar & reported_volume_;
+    }
+
+    TradeStatsWindow window_;
+
+    /** Trades in the window, oldest first. */
+    std::deque<Trade> trades_;
+
+    /** Trades that are the high, or the low, of the window from some point until they expire; prices strictly decreasing, or increasing. */
+    std::deque<Extreme> highs_;
+    std::deque<Extreme> lows_;
+
+    double notional_ = 0.0;
+    long long volume_ = 0;
+    unsigned long long next_sequence_ = 0;
+
+    long long total_volume_ = 0;
+    long long reported_volume_ = 0;
+};
+
+#endif
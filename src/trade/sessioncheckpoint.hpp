@@ -0,0 +1,123 @@
+#ifndef SESSION_CHECKPOINT_HPP
+#define SESSION_CHECKPOINT_HPP
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/serialization/access.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/unordered_map.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include "trade.hpp"
+#include "marketdata.hpp"
+#include "equilibriumtracker.hpp"
+#include "profitledger.hpp"
+#include "../order/limitorder.hpp"
+#include "../order/orderbook.hpp"
+
+/** The state of an exchange at the end of a trading session, kept in a binary file
+ *  so that later sessions can open on it instead of trading their way back to it. */
+struct SessionCheckpoint
+{
+    /** A resting order, with the owner the serialization of orders leaves out. */
+    struct RestingOrder
+    {
+        LimitOrderPtr order;
+        int sender_id = 0;
+        std::string agent_name;
+
+    private:
+
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & order;
+            ar & sender_id;
+            ar & agent_name;
+        }
+    };
+
+    /** The state kept for each ticker. */
+    struct Book
+    {
+        std::vector<RestingOrder> orders; // bids then asks, each best price first in time priority
+        OrderBook::TradeStatistics statistics;
+        std::vector<TradePtr> trades;
+        EquilibriumTracker equilibrium;
+        MarketDataPtr last_market_data;
+        unsigned long market_data_sequence = 0;
+
+    private:
+
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & orders;
+            ar & statistics;
+            ar & trades;
+            ar & equilibrium;
+            ar & last_market_data;
+            ar & market_data_sequence;
+        }
+    };
+
+    std::unordered_map<std::string, Book> books;
+
+    /** Ids handed out so far, so that those of the restored session do not collide with them. */
+    int orders_created = 0;
+    int trades_created = 0;
+    int volume_traded = 0;
+
+    /** Profits of the agents that have traded so far, indexed from the first configured agent ID. */
+    ProfitLedger::Accounts profits;
+
+    /** Writes the checkpoint to the file at the given path, replacing it. */
+    void save(const std::string& path) const
+    {
+        std::ofstream file {path, std::ios::binary | std::ios::trunc};
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open checkpoint file for writing: " + path);
+        }
+        boost::archive::binary_oarchive archive {file};
+        archive << *this;
+    }
+
+    /** Reads the checkpoint from the file at the given path. */
+    static SessionCheckpoint load(const std::string& path)
+    {
+        std::ifstream file {path, std::ios::binary};
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open checkpoint file: " + path);
+        }
+        SessionCheckpoint checkpoint;
+        boost::archive::binary_iarchive archive {file};
+        archive >> checkpoint;
+        return checkpoint;
+    }
+
+private:
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & books;
+        ar & orders_created;
+        ar & trades_created;
+        ar & volume_traded;
+        ar & profits;
+    }
+};
+
+#endif
@@ -11,6 +11,8 @@
 #include <boost/serialization/shared_ptr.hpp>
 
 #include "../utilities/csvprintable.hpp"
+#include "../utilities/columnarbatch.hpp"
+#include "../utilities/simulationclock.hpp"
 
 class TradeFactory;
 
@@ -20,8 +22,7 @@ public:
 
     Trade()
     {
-        std::chrono::system_clock::duration now = std::chrono::system_clock::now().time_since_epoch();
-        timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+        timestamp = SimulationClock::nowNanos();
     }
 
     int id;
@@ -41,14 +42,26 @@ public:
     double seller_profit; 
 
 
-    std::string describeCSVHeaders() const override
+    static constexpr std::string_view CSV_HEADERS = "id,ticker,quantity,price,timestamp,buyer_id,seller_id,buyer_name,seller_name,aggressing_order_id,resting_order_id,buyer_priv_value,seller_priv_value,buyer_profit,seller_profit";
+
+    std::string_view csvHeaders() const override
+    {
+        return CSV_HEADERS;
+    }
+
+    void appendCSV(std::string& row) const override
     {
-        return "id,ticker,quantity,price,timestamp,buyer_id,seller_id,buyer_name,seller_name,aggressing_order_id,resting_order_id,buyer_priv_value,seller_priv_value,buyer_profit,seller_profit"; 
+        csv::appendFields(row, ",", id, ticker, quantity, price, timestamp, buyer_id, seller_id, buyer_name, seller_name, aggressing_order_id, resting_order_id, buyer_priv_value, seller_priv_value, buyer_profit, seller_profit);
     }
 
-    std::string toCSV() const override
+    void toColumns(ColumnarBatch& batch) const override
     {
-        return std::to_string(id) + "," + ticker + "," + std::to_string(quantity) + "," + std::to_string(price) + "," + std::to_string(timestamp) + "," + std::to_string(buyer_id) + "," + std::to_string(seller_id) + "," + buyer_name + "," + seller_name + "," + std::to_string(aggressing_order_id) + "," + std::to_string(resting_order_id) + "," + std::to_string(buyer_priv_value) + "," + std::to_string(seller_priv_value) + "," + std::to_string(buyer_profit) + "," + std::to_string(seller_profit);
+        batch.append("id", id); batch.append("ticker", ticker); batch.append("quantity", quantity); batch.append("price", price);
+        batch.append("timestamp", timestamp); batch.append("buyer_id", buyer_id); batch.append("seller_id", seller_id);
+        batch.append("buyer_name", buyer_name); batch.append("seller_name", seller_name);
+        batch.append("aggressing_order_id", aggressing_order_id); batch.append("resting_order_id", resting_order_id);
+        batch.append("buyer_priv_value", buyer_priv_value); batch.append("seller_priv_value", seller_priv_value);
+        batch.append("buyer_profit", buyer_profit); batch.append("seller_profit", seller_profit);
     }
 
 private:
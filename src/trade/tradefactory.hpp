@@ -1,9 +1,13 @@
 #ifndef TRADE_FACTORY_HPP
 #define TRADE_FACTORY_HPP
 
+#include <atomic>
+
 #include "trade.hpp"
 #include "../order/limitorder.hpp"
 #include "../order/marketorder.hpp"
+#include "../order/ticksize.hpp"
+#include "../utilities/objectpool.hpp"
 
 class TradeFactory
 {
@@ -11,13 +15,13 @@ public:
 
     TradeFactory() = default;
 
-    TradePtr createFromLimitOrders(LimitOrderPtr resting_order, LimitOrderPtr aggressing_order)
+    TradePtr createFromLimitOrders(LimitOrderPtr resting_order, LimitOrderPtr aggressing_order, const TickSize& tick_size)
     {
-        std::shared_ptr<Trade> trade = std::make_shared<Trade>();
+        std::shared_ptr<Trade> trade = std::allocate_shared<Trade>(PoolAllocator<Trade>{trade_pool_});
         trade->id = ++trade_id_;
         trade->ticker = resting_order->ticker;
         trade->quantity = std::min(resting_order->remaining_quantity, aggressing_order->remaining_quantity);
-        trade->price = resting_order->price;
+        trade->price = tick_size.toPrice(resting_order->price);
         if (aggressing_order->side == Order::Side::BID)
         {
             trade->buyer_id = aggressing_order->sender_id;
@@ -48,13 +52,13 @@ public:
         return trade;
     }
 
-    TradePtr createFromLimitAndMarketOrders(LimitOrderPtr resting_order, MarketOrderPtr aggressing_order)
+    TradePtr createFromLimitAndMarketOrders(LimitOrderPtr resting_order, MarketOrderPtr aggressing_order, const TickSize& tick_size)
     {
-        std::shared_ptr<Trade> trade = std::make_shared<Trade>();
+        std::shared_ptr<Trade> trade = std::allocate_shared<Trade>(PoolAllocator<Trade>{trade_pool_});
         trade->id = ++trade_id_;
         trade->ticker = resting_order->ticker;
         trade->quantity = std::min(resting_order->remaining_quantity, aggressing_order->remaining_quantity);
-        trade->price = resting_order->price;
+        trade->price = tick_size.toPrice(resting_order->price);
         if (aggressing_order->side == Order::Side::BID)
         {
             trade->buyer_id = aggressing_order->sender_id;
@@ -90,10 +94,26 @@ public:
         return trade_id_;
     }
 
+    int getVolumeTraded() const
+    {
+        return volume_traded_;
+    }
+
+    /** Continues the trade ids and volume traded from those of a saved session. */
+    void restoreTrades(int trades, int volume_traded)
+    {
+        trade_id_ = trades;
+        volume_traded_ = volume_traded;
+    }
+
 private:
 
-    int trade_id_ = 0;
-    int volume_traded_ = 0;
+    /** Shared by the matching engines of all tickers. */
+    std::atomic<int> trade_id_ = 0;
+    std::atomic<int> volume_traded_ = 0;
+
+    /** Pool backing the trades created by this factory. */
+    ObjectPoolPtr trade_pool_ = std::make_shared<ObjectPool>();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#ifndef TRADE_HISTORY_HPP
+#define TRADE_HISTORY_HPP
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "trade.hpp"
+
+/** The trades of a session, of which only the latest are kept in memory. Older trades are spilled to a compact
+ *  binary log on disk, or dropped if there is none, so that long sessions run in bounded memory.
+ *  Not thread-safe; each history is used by one matching engine or trader at a time. */
+class TradeHistory
+{
+public:
+
+    TradeHistory(const TradeHistory&) = delete;
+    TradeHistory& operator=(const TradeHistory&) = delete;
+
+    /** Keeps up to window trades in memory, all of them if zero, and spills older ones to the log at the given path,
+     *  created on the first spill. Older trades are dropped if the path is empty. */
+    explicit TradeHistory(size_t window = 0, std::string spill_path = "")
+    : window_{window},
+      spill_path_{std::move(spill_path)}
+    {
+    }
+
+    /** Removes the spill log, which holds nothing the trade tape does not. */
+    ~TradeHistory()
+    {
+        if (spill_.is_open())
+        {
+            spill_.close();
+            std::error_code error;
+            std::filesystem::remove(spill_path_, error);
+        }
+    }
+
+    /** Adds the trade as the latest, spilling the oldest trade kept in memory if the window is full. */
+    void add(TradePtr trade)
+    {
+        recent_.push_back(std::move(trade));
+        if (window_ == 0 || recent_.size() <= window_) return;
+
+        if (!spill_path_.empty())
+        {
+            spill(*recent_.front());
+        }
+        else
+        {
+            ++dropped_;
+        }
+        recent_.pop_front();
+    }
+
+    /** Returns the number of trades added, including those spilled or dropped. */
+    size_t size() const
+    {
+        return dropped_ + spilled_ + recent_.size();
+    }
+
+    /** Returns the trades kept in memory, oldest first. */
+    const std::deque<TradePtr>& recent() const
+    {
+        return recent_;
+    }
+
+    /** Calls the callback on every trade not dropped, oldest first, reading the spilled trades back from the log. */
+    void forEach(const std::function<void(const TradePtr&)>& callback)
+    {
+        if (spilled_ > 0)
+        {
+            spill_.flush();
+            std::ifstream log {spill_path_, std::ios::binary};
+            if (!log.is_open())
+            {
+                throw std::runtime_error("Failed to open trade history log: " + spill_path_);
+            }
+            for (size_t i = 0; i < spilled_; ++i)
+            {
+                callback(read(log));
+            }
+        }
+        for (TradePtr const& trade : recent_)
+        {
+            callback(trade);
+        }
+    }
+
+    /** Returns every trade not dropped, oldest first. */
+    std::vector<TradePtr> all()
+    {
+        std::vector<TradePtr> trades;
+        trades.reserve(spilled_ + recent_.size());
+        forEach([&trades](const TradePtr& trade) { trades.push_back(trade); });
+        return trades;
+    }
+
+private:
+
+    /** Appends the trade to the log as its fixed-size fields followed by its strings, each behind its length. */
+    void spill(const Trade& trade)
+    {
+        if (!spill_.is_open())
+        {
+            spill_.open(spill_path_, std::ios::binary | std::ios::trunc);
+            if (!spill_.is_open())
+            {
+                throw std::runtime_error("Failed to open trade history log for writing: " + spill_path_);
+            }
+        }
+
+        writeValue(trade.id);
+        writeValue(trade.quantity);
+        writeValue(trade.price);
+        writeValue(trade.timestamp);
+        writeValue(trade.buyer_id);
+        writeValue(trade.seller_id);
+        writeValue(trade.aggressing_order_id);
+        writeValue(trade.resting_order_id);
+        writeValue(trade.buyer_priv_value);
+        writeValue(trade.seller_priv_value);
+        writeValue(trade.buyer_profit);
+        writeValue(trade.seller_profit);
+        writeString(trade.ticker);
+        writeString(trade.buyer_name);
+        writeString(trade.seller_name);
+        ++spilled_;
+    }
+
+    /** Reads the next trade from the log. */
+    static TradePtr read(std::ifstream& log)
+    {
+        TradePtr trade = std::make_shared<Trade>();
+        readValue(log, trade->id);
+        readValue(log, trade->quantity);
+        readValue(log, trade->price);
+        readValue(log, trade->timestamp);
+        readValue(log, trade->buyer_id);
+        readValue(log, trade->seller_id);
+        readValue(log, trade->aggressing_order_id);
+        readValue(log, trade->resting_order_id);
+        readValue(log, trade->buyer_priv_value);
+        readValue(log, trade->seller_priv_value);
+        readValue(log, trade->buyer_profit);
+        readValue(log, trade->seller_profit);
+        readString(log, trade->ticker);
+        readString(log, trade->buyer_name);
+        readString(log, trade->seller_name);
+        if (!log)
+        {
+            throw std::runtime_error("Trade history log is cut short");
+        }
+        return trade;
+    }
+
+    template<typename T>
+    void writeValue(const T& value)
+    {
+        spill_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void writeString(const std::string& value)
+    {
+        uint32_t length = static_cast<uint32_t>(value.size());
+        writeValue(length);
+        spill_.write(value.data(), length);
+    }
+
+    template<typename T>
+    static void readValue(std::ifstream& log, T& value)
+    {
+        log.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    static void readString(std::ifstream& log, std::string& value)
+    {
+        uint32_t length = 0;
+        readValue(log, length);
+        value.resize(length);
+        log.read(value.data(), length);
+    }
+
+    size_t window_;
+    std::string spill_path_;
+    std::ofstream spill_;
+    std::deque<TradePtr> recent_;
+    size_t spilled_ = 0;
+    size_t dropped_ = 0;
+};
+
+typedef std::shared_ptr<TradeHistory> TradeHistoryPtr;
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef TRADING_SESSION_STATE_HPP
+#define TRADING_SESSION_STATE_HPP
+
+#include <string>
+
+enum class TradingSessionState : int
+{
+    PRE_OPEN,   // Orders are not matched yet
+    OPEN,       // Matching engines are running
+    CLOSING,    // Matching engines are stopping and no more orders are accepted
+    CLOSED      // The session has ended and results are written
+};
+
+inline std::string to_string(TradingSessionState state)
+{
+    switch (state) {
+        case TradingSessionState::PRE_OPEN: return std::string{"pre-open"};
+        case TradingSessionState::OPEN: return std::string{"open"};
+        case TradingSessionState::CLOSING: return std::string{"closing"};
+        case TradingSessionState::CLOSED: return std::string{"closed"};
+        default: return std::string{""};
+    }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef CLOCK_OFFSET_ESTIMATOR_HPP
+#define CLOCK_OFFSET_ESTIMATOR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+/** Estimates the offset and drift of a remote clock from the local one from NTP-style round trips:
+ *  the local time a request was sent (t1), the remote times it was received (t2) and answered (t3),
+ *  and the local time the answer arrived (t4). Each round trip gives an offset, accurate to within half its network delay,
+ *  so only the round trips nearest the fastest among the latest are trusted, and the drift is fitted to their offsets over time.
+ *  Not thread-safe. */
+class ClockOffsetEstimator
+{
+public:
+
+    /** The remote clock as the local clock plus offset nanoseconds at local time at,
+     *  gaining drift nanoseconds per second of local time from then. */
+    struct Estimate
+    {
+        int64_t offset = 0;
+        double drift = 0;
+        int64_t at = 0;
+        int64_t delay = 0; // round trip of the fastest sample, within half of which the offset is accurate
+    };
+
+    /** Round trips kept. */
+    static constexpr size_t WINDOW = 32;
+
+    /** Round trips slower than the fastest kept by more than this many nanoseconds are not trusted. */
+    static constexpr int64_t DELAY_TOLERANCE = 200'000;
+
+    /** Local nanoseconds the trusted round trips must span for their drift to be fitted. */
+    static constexpr int64_t MIN_DRIFT_SPAN = 5'000'000'000;
+
+    /** Adds a round trip. Returns false and ignores it if its times are inconsistent. */
+    bool addSample(int64_t t1, int64_t t2, int64_t t3, int64_t t4)
+    {
+      int64_t delay = (t4 - t1) - (t3 - t2);
+      if (t4 < t1 || t3 < t2 || delay < 0) return false;
+
+      samples_.push_back(Sample{((t2 - t1) + (t3 - t4)) / 2, delay, t1 + (t4 - t1) / 2});
+      if (samples_.size() > WINDOW) samples_.pop_front();
+      return true;
+    };
+
+    /** Returns the estimate from the round trips kept, or nothing before the first. */
+    std::optional<Estimate> estimate() const
+    {
+      if (samples_.empty()) return std::nullopt;
+
+      auto fastest = std::min_element(samples_.begin(), samples_.end(),
+        [](const Sample& a, const Sample& b) { return a.delay < b.delay; });
+
+      // Least squares fit of the trusted offsets against local time, measured from the oldest kept to stay precise in doubles
+      int64_t base = samples_.front().local;
+      double count = 0, mean_time = 0, mean_offset = 0;
+      for (Sample const& sample : samples_)
+      {
+        if (sample.delay > fastest->delay + DELAY_TOLERANCE) continue;
+        count += 1;
+        mean_time += sample.local - base;
+        mean_offset += sample.offset;
+      }
+      mean_time /= count;
+      mean_offset /= count;
+
+      double covariance = 0, variance = 0;
+      int64_t first = INT64_MAX, last = INT64_MIN;
+      for (Sample const& sample : samples_)
+      {
+        if (sample.delay > fastest->delay + DELAY_TOLERANCE) continue;
+        double time = static_cast<double>(sample.local - base) - mean_time;
+        covariance += time * (sample.offset - mean_offset);
+        variance += time * time;
+        first = std::min(first, sample.local);
+        last = std::max(last, sample.local);
+      }
+
+      Estimate estimate;
+      estimate.delay = fastest->delay;
+      if (count < 3 || last - first < MIN_DRIFT_SPAN || variance <= 0)
+      {
+        // Too few or too close together for a drift, so the fastest round trip's offset stands
+        estimate.offset = fastest->offset;
+        estimate.at = fastest->local;
+        return estimate;
+      }
+
+      double slope = covariance / variance;
+      estimate.at = last;
+      estimate.offset = static_cast<int64_t>(mean_offset + slope * (static_cast<double>(last - base) - mean_time));
+      estimate.drift = slope * 1e9;
+      return estimate;
+    };
+
+    /** Forgets every round trip. */
+    void clear()
+    {
+      samples_.clear();
+    };
+
+private:
+
+    struct Sample
+    {
+      int64_t offset;
+      int64_t delay;
+      int64_t local; // midpoint of the round trip
+    };
+
+    std::deque<Sample> samples_;
+};
+
+#endif
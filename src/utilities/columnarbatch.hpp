@@ -0,0 +1,153 @@
+#ifndef COLUMNAR_BATCH_HPP
+#define COLUMNAR_BATCH_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/** Type of the values stored in a column. */
+enum class ColumnType : uint8_t
+{
+    INT64 = 1,  // 8-byte signed integers
+    UINT64 = 2, // 8-byte unsigned integers
+    DOUBLE = 3, // 8-byte IEEE 754 doubles
+    STRING = 4  // UTF-8 strings
+};
+
+/** A row group being built, holding the values of each column contiguously.
+ *  The columns are defined by the fields appended to the first row; every later row must append the same fields in the same order. */
+class ColumnarBatch
+{
+public:
+
+    /** A single column of the row group.
+     *  String columns hold the end offset of each value in offsets and the characters in data. */
+    struct Column
+    {
+        std::string name;
+        ColumnType type;
+        std::vector<char> data;
+        std::vector<uint32_t> offsets;
+    };
+
+    /** Starts a new row. */
+    void beginRow()
+    {
+        column_index_ = 0;
+    }
+
+    /** Completes the current row. */
+    void endRow()
+    {
+        if (column_index_ != columns_.size())
+        {
+            throw std::logic_error("Row has " + std::to_string(column_index_) + " fields, expected " + std::to_string(columns_.size()));
+        }
+        ++rows_;
+    }
+
+    /** Appends a numeric field to the current row. */
+    template<class T>
+    requires std::is_arithmetic_v<T>
+    void append(std::string_view name, T value)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            appendFixed(name, ColumnType::DOUBLE, static_cast<double>(value));
+        }
+        else if constexpr (std::is_unsigned_v<T>)
+        {
+            appendFixed(name, ColumnType::UINT64, static_cast<uint64_t>(value));
+        }
+        else
+        {
+            appendFixed(name, ColumnType::INT64, static_cast<int64_t>(value));
+        }
+    }
+
+    /** Appends a string field to the current row. */
+    void append(std::string_view name, std::string_view value)
+    {
+        Column& column = nextColumn(name, ColumnType::STRING);
+        column.data.insert(column.data.end(), value.begin(), value.end());
+        column.offsets.push_back(static_cast<uint32_t>(column.data.size()));
+    }
+
+    /** Drops the fields appended to the current row. */
+    void discardRow()
+    {
+        for (Column& column : columns_)
+        {
+            if (column.type == ColumnType::STRING)
+            {
+                column.offsets.resize(rows_);
+                column.data.resize(rows_ > 0 ? column.offsets.back() : 0);
+            }
+            else
+            {
+                column.data.resize(rows_ * sizeof(uint64_t));
+            }
+        }
+        if (rows_ == 0) columns_.clear();
+        column_index_ = 0;
+    }
+
+    /** Drops the rows of the batch, keeping the columns and their capacity. */
+    void clear()
+    {
+        for (Column& column : columns_)
+        {
+            column.data.clear();
+            column.offsets.clear();
+        }
+        rows_ = 0;
+        column_index_ = 0;
+    }
+
+    /** Returns the number of complete rows. */
+    size_t rows() const { return rows_; };
+
+    /** Returns the columns of the batch. */
+    const std::vector<Column>& columns() const { return columns_; };
+
+private:
+
+    /** Returns the column the next field of the row goes to, defining it while the first row is built. */
+    Column& nextColumn(std::string_view name, ColumnType type)
+    {
+        if (column_index_ == columns_.size())
+        {
+            if (rows_ > 0)
+            {
+                throw std::logic_error("Unexpected field " + std::string{name} + " after the first row");
+            }
+            columns_.push_back(Column{std::string{name}, type, {}, {}});
+        }
+
+        Column& column = columns_[column_index_++];
+        if (column.type != type)
+        {
+            throw std::logic_error("Field " + std::string{name} + " does not match the type of column " + column.name);
+        }
+        return column;
+    }
+
+    template<class T>
+    void appendFixed(std::string_view name, ColumnType type, T value)
+    {
+        Column& column = nextColumn(name, type);
+        size_t size = column.data.size();
+        column.data.resize(size + sizeof(T));
+        std::memcpy(column.data.data() + size, &value, sizeof(T));
+    }
+
+    std::vector<Column> columns_;
+    size_t column_index_ = 0;
+    size_t rows_ = 0;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,162 @@
+#ifndef COLUMNAR_WRITER_HPP
+#define COLUMNAR_WRITER_HPP
+
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "csvprintable.hpp"
+#include "columnarbatch.hpp"
+#include "rowwriter.hpp"
+#include "outputstream.hpp"
+#include "threadplacement.hpp"
+
+static_assert(std::endian::native == std::endian::little, "The columnar format is written in little-endian byte order");
+
+/** Writes items to a binary file of fixed-schema row groups, each holding the values of every column contiguously.
+ *  Rows are appended to a batch by the caller and full row groups are written out by a background thread.
+ *
+ *  The file holds a header followed by row groups until the end of the file; all integers are little-endian.
+ *  Header:    the 8 bytes "SIMCOL01", uint32 column count, then for each column a uint8 ColumnType,
+ *             a uint32 name length and the name.
+ *  Row group: uint32 row count, then for each column in header order a uint64 byte length followed by the values.
+ *             Numeric columns hold one 8-byte value per row. String columns hold one uint32 end offset per row
+ *             followed by the characters of all rows, the offsets counting from the first character.
+ *  The columns are those of the first row written; a file with no rows is empty. */
+class ColumnarWriter : public RowWriter
+{
+public:
+
+    ColumnarWriter() = delete;
+
+    /** Creates a writer that writes a row group once it holds the given number of rows, and the rest on stopping. */
+    ColumnarWriter(std::string path, size_t rows_per_group = DEFAULT_ROWS_PER_GROUP)
+    : path_{path},
+      file_{path, std::ios::binary},
+      rows_per_group_{rows_per_group}
+    {
+        flusher_ = std::thread{&ColumnarWriter::runFlusher, this};
+    };
+
+    ~ColumnarWriter()
+    {
+        stop();
+    };
+
+    /** Writes out all buffered rows, stops the writer and closes the file. */
+    void stop() override
+    {
+        if (flusher_.joinable())
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stopped_ = true;
+            lock.unlock();
+            cv_.notify_one();
+            flusher_.join();
+        }
+        file_.close();
+    }
+
+    /** Appends the columns of the given item as a row of the current row group. */
+    void writeRow(CSVPrintablePtr item) override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        batch_.beginRow();
+        try
+        {
+            item->toColumns(batch_);
+            batch_.endRow();
+        }
+        catch (...)
+        {
+            batch_.discardRow();
+            throw;
+        }
+        bool full = batch_.rows() >= rows_per_group_;
+        lock.unlock();
+
+        if (full) cv_.notify_one();
+    }
+
+    /** Number of rows in each row group unless configured otherwise. */
+    static constexpr size_t DEFAULT_ROWS_PER_GROUP = 1 << 16;
+
+private:
+
+    /** Swaps out each full row group and writes it to the file until stopped, then writes out the rest. */
+    void runFlusher()
+    {
+        ThreadPlacement::instance().pinCurrent(ThreadRole::WRITER);
+        ColumnarBatch pending;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            cv_.wait(lock, [this]{ return stopped_ || batch_.rows() >= rows_per_group_; });
+            std::swap(pending, batch_);
+            bool stopped = stopped_;
+            lock.unlock();
+
+            if (pending.rows() > 0)
+            {
+                writeRowGroup(pending);
+                pending.clear();
+            }
+            if (stopped) return;
+
+            lock.lock();
+        }
+    }
+
+    /** Writes the given row group, preceded by the header if it is the first. */
+    void writeRowGroup(const ColumnarBatch& group)
+    {
+        if (!started_)
+        {
+            file_.write(MAGIC, sizeof(MAGIC) - 1);
+            writeValue<uint32_t>(group.columns().size());
+            for (ColumnarBatch::Column const& column : group.columns())
+            {
+                writeValue<uint8_t>(static_cast<uint8_t>(column.type));
+                writeValue<uint32_t>(column.name.size());
+                file_.write(column.name.data(), column.name.size());
+            }
+            started_ = true;
+        }
+
+        writeValue<uint32_t>(group.rows());
+        for (ColumnarBatch::Column const& column : group.columns())
+        {
+            size_t offsets_size = column.offsets.size() * sizeof(uint32_t);
+            writeValue<uint64_t>(offsets_size + column.data.size());
+            file_.write(reinterpret_cast<const char*>(column.offsets.data()), offsets_size);
+            file_.write(column.data.data(), column.data.size());
+        }
+        file_.flush();
+    }
+
+    template<class T>
+    void writeValue(T value)
+    {
+        file_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static constexpr char MAGIC[] = "SIMCOL01";
+
+    std::string path_;
+    OutputStream file_; // a local file, or an object uploaded as it is written for an s3:// path
+    bool started_ = false;
+
+    size_t rows_per_group_;
+    ColumnarBatch batch_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopped_ = false;
+    std::thread flusher_;
+};
+
+#endif
\ No newline at end of file
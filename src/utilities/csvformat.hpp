@@ -0,0 +1,51 @@
+#ifndef CSV_FORMAT_HPP
+#define CSV_FORMAT_HPP
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/** Helpers appending CSV fields to a row buffer without temporary strings. 
+ *  Numbers are formatted as std::to_string would, doubles with six decimals. */
+namespace csv
+{
+    inline void append(std::string& row, std::string_view value)
+    {
+        row.append(value);
+    }
+
+    template<class T>
+    requires std::is_integral_v<T>
+    inline void append(std::string& row, T value)
+    {
+        char buffer[24];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        row.append(buffer, end);
+    }
+
+    inline void append(std::string& row, double value)
+    {
+        char buffer[64];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 6);
+        if (ec == std::errc{})
+        {
+            row.append(buffer, end);
+        }
+        else
+        {
+            // Only values too large to be prices or quantities get here
+            row += std::to_string(value);
+        }
+    }
+
+    /** Appends the given fields to the row, separated by the given separator. */
+    template<class First, class... Rest>
+    inline void appendFields(std::string& row, std::string_view separator, const First& first, const Rest&... rest)
+    {
+        append(row, first);
+        ((row.append(separator), append(row, rest)), ...);
+    }
+}
+
+#endif
\ No newline at end of file
@@ -2,19 +2,47 @@
 #define CSV_PRINTABLE_HPP
 
 #include <string>
+#include <string_view>
+#include <stdexcept>
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 
+#include "csvformat.hpp"
+
+class ColumnarBatch;
+
 class CSVPrintable
 {
 public:
 
     virtual ~CSVPrintable() = default;
 
-    virtual std::string describeCSVHeaders() const = 0;
-    virtual std::string toCSV() const = 0;
+    /** Returns the CSV headers, shared by every item of the type. */
+    virtual std::string_view csvHeaders() const = 0;
+
+    /** Appends the fields of the item as a CSV row to the given buffer, without a line break. */
+    virtual void appendCSV(std::string& row) const = 0;
+
+    std::string describeCSVHeaders() const
+    {
+        return std::string{csvHeaders()};
+    }
+
+    std::string toCSV() const
+    {
+        std::string row;
+        appendCSV(row);
+        return row;
+    }
+
+    /** Appends the fields of the item to the current row of the batch, for columnar outputs. 
+     *  Items written only to CSV files need not implement this. */
+    virtual void toColumns([[maybe_unused]] ColumnarBatch& batch) const
+    {
+        throw std::logic_error("Item cannot be written to a columnar output");
+    }
 
 private:
 
@@ -6,48 +6,213 @@
 #include <fstream>
 #include <vector>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+#ifdef SIMULATION_WITH_ZSTD
+#include <zstd.h>
+#endif
 
-#include "syncqueue.hpp"
 #include "csvprintable.hpp"
+#include "rowwriter.hpp"
+#include "outputstream.hpp"
+#include "threadplacement.hpp"
 
-class CSVWriter
+class CSVWriter : public RowWriter
 {
 public:
 
     CSVWriter() = delete;
 
+    /** Creates a writer that writes each row immediately. */
     CSVWriter(std::string path)
     : path_{path},
       file_{path}
     {
     };
 
+    /** Creates a writer that appends rows to a buffer written out by a background thread every flush interval, 
+     *  or sooner once the buffer is full. A zero interval makes the writer synchronous. */
+    CSVWriter(std::string path, std::chrono::milliseconds flush_interval)
+    : CSVWriter(path, flush_interval, false)
+    {
+    };
+
+    /** Creates a writer as above that, if compressing, writes the file as a sequence of independent zstd frames.
+     *  Each frame holds one full buffer of rows, compressed by the background thread, or the rest of the rows on stopping;
+     *  the flush interval is then ignored. The file can be read with zstd -d and decompressed frame by frame. */
+    CSVWriter(std::string path, std::chrono::milliseconds flush_interval, bool compress)
+    : path_{path},
+      file_{path, compress ? std::ios::binary : std::ios::out},
+      flush_interval_{flush_interval},
+      compress_{compress}
+    {
+        if (compress_ && !COMPRESSION_SUPPORTED)
+        {
+            throw std::runtime_error("Cannot compress " + path + ": built without zstd");
+        }
+        if (flush_interval_.count() > 0 || compress_)
+        {
+            buffer_.reserve(BUFFER_SIZE);
+            flusher_ = std::thread{&CSVWriter::runFlusher, this};
+        }
+    };
+
     ~CSVWriter()
     {
         stop();
     };
 
-    /** Stops the CSV writer and closes the file. */
-    void stop()
+    /** Indicates whether writers can compress their files, which requires building with zstd. */
+#ifdef SIMULATION_WITH_ZSTD
+    static constexpr bool COMPRESSION_SUPPORTED = true;
+#else
+    static constexpr bool COMPRESSION_SUPPORTED = false;
+#endif
+
+    /** Writes out all buffered rows, stops the CSV writer and closes the file. */
+    void stop() override
     {
+        if (flusher_.joinable())
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stopped_ = true;
+            lock.unlock();
+            cv_.notify_one();
+            flusher_.join();
+        }
         file_.close();
     }
 
-    /** Writes the given item as a CSV row immediately. */
-    void writeRow(CSVPrintablePtr item) {
-        if (!started_) 
+    /** Writes the given item as a CSV row, immediately or through the buffer. Rows keep the order they are written in. */
+    void writeRow(CSVPrintablePtr item) override {
+        if (!flusher_.joinable())
         {
-            file_ << item->describeCSVHeaders() << std::endl;
+            row_.clear();
+            if (!started_) 
+            {
+                row_ += item->csvHeaders();
+                row_ += '\n';
+                started_ = true;
+            }
+            item->appendCSV(row_);
+            row_ += '\n';
+            file_.write(row_.data(), row_.size());
+            file_.flush();
+            return;
+        }
+
+        // Rows are formatted by the caller straight into the buffer, as the item may change once this returns
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!started_)
+        {
+            buffer_ += item->csvHeaders();
+            buffer_ += '\n';
             started_ = true;
         }
-        file_ << item->toCSV() << std::endl;
+        item->appendCSV(buffer_);
+        buffer_ += '\n';
+        bool full = buffer_.size() >= BUFFER_SIZE;
+        lock.unlock();
+
+        if (full) cv_.notify_one();
     }
 
 private:
 
+    /** Swaps out the buffer and writes it to the file until stopped, then writes out the rest. */
+    void runFlusher()
+    {
+        ThreadPlacement::instance().pinCurrent(ThreadRole::WRITER);
+        std::string pending;
+        pending.reserve(BUFFER_SIZE);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            auto ready = [this]{ return stopped_ || buffer_.size() >= BUFFER_SIZE; };
+            if (compress_)
+            {
+                cv_.wait(lock, ready);
+            }
+            else
+            {
+                cv_.wait_for(lock, flush_interval_, ready);
+            }
+            pending.swap(buffer_);
+            bool stopped = stopped_;
+            lock.unlock();
+
+            if (!pending.empty())
+            {
+                writeBlock(pending);
+                file_.flush();
+                pending.clear();
+            }
+            if (stopped) return;
+
+            lock.lock();
+        }
+    }
+
+    /** Writes the given rows to the file, as a zstd frame if compressing. */
+    void writeBlock(const std::string& rows)
+    {
+        if (!compress_)
+        {
+            file_.write(rows.data(), rows.size());
+            return;
+        }
+#ifdef SIMULATION_WITH_ZSTD
+        if (!compression_context_)
+        {
+            compression_context_.reset(ZSTD_createCCtx());
+        }
+        compressed_.resize(ZSTD_compressBound(rows.size()));
+        size_t size = ZSTD_compressCCtx(compression_context_.get(), compressed_.data(), compressed_.size(), 
+            rows.data(), rows.size(), COMPRESSION_LEVEL);
+        if (ZSTD_isError(size))
+        {
+            std::cerr << "Failed to compress rows of " << path_ << ": " << ZSTD_getErrorName(size) << "\n";
+            return;
+        }
+        file_.write(compressed_.data(), size);
+#endif
+    }
+
+    /** Buffered rows are written out once they reach this many bytes. */
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+#ifdef SIMULATION_WITH_ZSTD
+    struct CompressionContextDeleter
+    {
+        void operator()(ZSTD_CCtx* context) const { ZSTD_freeCCtx(context); }
+    };
+
+    /** Compression level of the frames, a fast level close to the zstd default. */
+    static constexpr int COMPRESSION_LEVEL = 3;
+
+    std::unique_ptr<ZSTD_CCtx, CompressionContextDeleter> compression_context_;
+    std::vector<char> compressed_;
+#endif
+
     std::string path_;
-    std::ofstream file_;
+    OutputStream file_; // a local file, or an object uploaded as it is written for an s3:// path
     bool started_ = false;
+
+    /** Reused to format each row when writing synchronously. */
+    std::string row_;
+
+    std::chrono::milliseconds flush_interval_ {0};
+    bool compress_ = false;
+    std::string buffer_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopped_ = false;
+    std::thread flusher_;
 };
 
 typedef std::shared_ptr<CSVWriter> CSVWriterPtr;
@@ -0,0 +1,99 @@
+#ifndef JITTERED_TIMER_HPP
+#define JITTERED_TIMER_HPP
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <boost/asio.hpp>
+
+#include "simulationclock.hpp"
+#include "simulationtimer.hpp"
+
+namespace asio = boost::asio;
+
+/** Calls a function repeatedly on an IO context, waiting a jittered interval after each call returns.
+ *  Calls run on a strand, so they never overlap, and no thread is held between them. Waits are on the SimulationClock. */
+class JitteredTimer
+{
+public:
+
+    JitteredTimer() = delete;
+    JitteredTimer(const JitteredTimer&) = delete;
+    JitteredTimer& operator=(const JitteredTimer&) = delete;
+
+    explicit JitteredTimer(asio::io_context& io_context)
+    : strand_{asio::make_strand(io_context)},
+      timer_{strand_},
+      random_generator_{SimulationClock::randomSeed()}
+    {
+    };
+
+    ~JitteredTimer()
+    {
+        stop();
+    };
+
+    /** Calls the callback as soon as possible and then every interval until stopped,
+     *  each wait stretched or shortened by a random fraction of up to rel_jitter. */
+    void start(std::chrono::milliseconds interval, double rel_jitter, std::function<void()> callback)
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+        interval_ = interval;
+        jitter_ = std::uniform_real_distribution<>(-rel_jitter, rel_jitter);
+        callback_ = std::move(callback);
+        running_ = true;
+        unsigned long generation = ++generation_;
+        asio::post(strand_, SimulationClock::holding([this, generation]() { fire(generation); }));
+    }
+
+    /** Stops calling the callback. Waits for a call in progress on another thread to return,
+     *  so the callback is never running once this returns. May be called from the callback itself. */
+    void stop()
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+        running_ = false;
+        ++generation_;
+    }
+
+    bool running()
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+        return running_;
+    }
+
+private:
+
+    /** Makes a call unless the timer was stopped or restarted since the given generation was started, then waits for the next. */
+    void fire(unsigned long generation)
+    {
+        std::chrono::milliseconds wait;
+        {
+            std::lock_guard<std::recursive_mutex> lock(mutex_);
+            if (generation != generation_) return;
+            callback_();
+            if (generation != generation_) return;
+            wait = std::chrono::milliseconds(static_cast<long>(std::round(interval_.count() * (1.0 + jitter_(random_generator_)))));
+        }
+
+        timer_.expires_after(wait);
+        timer_.async_wait([this, generation](const boost::system::error_code& error) {
+            if (!error) fire(generation);
+        });
+    }
+
+    asio::strand<asio::io_context::executor_type> strand_;
+    SimulationTimer timer_;
+    std::mt19937 random_generator_;
+    std::uniform_real_distribution<> jitter_;
+    std::chrono::milliseconds interval_ {0};
+    std::function<void()> callback_;
+    bool running_ = false;
+    unsigned long generation_ = 0; // Calls scheduled under an older generation are dropped
+
+    /** Held for the duration of each call, so stopping waits for a call in progress. */
+    std::recursive_mutex mutex_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,140 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include <iomanip>
+
+/** HDR-style histogram of latencies in nanoseconds. Each power of two is split into SUB_BUCKETS linear buckets,
+ *  so any value is kept to within about 3% of itself. Recording is lock-free and safe from any thread. */
+class LatencyHistogram
+{
+public:
+
+    static constexpr unsigned int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+
+    /** Values from 2^MAX_MAGNITUDE ns (about 68 seconds) upwards share the last bucket. */
+    static constexpr unsigned int MAX_MAGNITUDE = 36;
+    static constexpr size_t BUCKET_COUNT = SUB_BUCKETS * (MAX_MAGNITUDE - SUB_BUCKET_BITS + 1);
+
+    LatencyHistogram() = default;
+
+    /** Copies a snapshot of the counts, which may be recorded to meanwhile. */
+    LatencyHistogram(const LatencyHistogram& other)
+    {
+      merge(other);
+    };
+
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    /** Records a latency in nanoseconds. */
+    void record(uint64_t value)
+    {
+      counts_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+      count_.fetch_add(1, std::memory_order_relaxed);
+      sum_.fetch_add(value, std::memory_order_relaxed);
+
+      uint64_t max = max_.load(std::memory_order_relaxed);
+      while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+    };
+
+    /** Adds the counts of the other histogram to this one. */
+    void merge(const LatencyHistogram& other)
+    {
+      for (size_t i = 0; i < BUCKET_COUNT; ++i)
+      {
+        uint64_t count = other.counts_[i].load(std::memory_order_relaxed);
+        if (count > 0) counts_[i].fetch_add(count, std::memory_order_relaxed);
+      }
+      count_.fetch_add(other.count(), std::memory_order_relaxed);
+      sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+      uint64_t other_max = other.max();
+      uint64_t max = max_.load(std::memory_order_relaxed);
+      while (other_max > max && !max_.compare_exchange_weak(max, other_max, std::memory_order_relaxed)) {}
+    };
+
+    /** Returns the number of values recorded. */
+    uint64_t count() const
+    {
+      return count_.load(std::memory_order_relaxed);
+    };
+
+    /** Returns the largest value recorded. */
+    uint64_t max() const
+    {
+      return max_.load(std::memory_order_relaxed);
+    };
+
+    /** Returns the mean of the values recorded. */
+    double mean() const
+    {
+      uint64_t count = this->count();
+      return count > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / count : 0.0;
+    };
+
+    /** Returns the value below which the given fraction of values fall, as the upper bound of its bucket. */
+    uint64_t percentile(double fraction) const
+    {
+      uint64_t count = this->count();
+      if (count == 0) return 0;
+
+      uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * count + 0.5));
+      uint64_t seen = 0;
+      for (size_t i = 0; i < BUCKET_COUNT; ++i)
+      {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return std::min(upperBoundOf(i), max());
+      }
+      return max();
+    };
+
+    /** Returns the count, mean, median, tail percentiles and maximum in microseconds. */
+    std::string summary() const
+    {
+      std::ostringstream out;
+      out << std::fixed << std::setprecision(1)
+          << "count=" << count()
+          << " mean=" << mean() / 1000.0 << "us"
+          << " p50=" << percentile(0.5) / 1000.0 << "us"
+          << " p99=" << percentile(0.99) / 1000.0 << "us"
+          << " p999=" << percentile(0.999) / 1000.0 << "us"
+          << " max=" << max() / 1000.0 << "us";
+      return out.str();
+    };
+
+private:
+
+    static size_t bucketOf(uint64_t value)
+    {
+      if (value < SUB_BUCKETS) return value;
+
+      unsigned int magnitude = std::bit_width(value) - 1;
+      if (magnitude >= MAX_MAGNITUDE) return BUCKET_COUNT - 1;
+
+      unsigned int shift = magnitude - SUB_BUCKET_BITS;
+      return SUB_BUCKETS * (shift + 1) + ((value >> shift) - SUB_BUCKETS);
+    };
+
+    static uint64_t upperBoundOf(size_t bucket)
+    {
+      if (bucket < SUB_BUCKETS) return bucket;
+
+      unsigned int shift = bucket / SUB_BUCKETS - 1;
+      uint64_t sub_bucket = bucket % SUB_BUCKETS;
+      return ((SUB_BUCKETS + sub_bucket + 1) << shift) - 1;
+    };
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts_ {};
+    std::atomic<uint64_t> count_ = 0;
+    std::atomic<uint64_t> sum_ = 0;
+    std::atomic<uint64_t> max_ = 0;
+};
+
+#endif
\ No newline at end of file
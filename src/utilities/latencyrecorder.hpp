@@ -0,0 +1,128 @@
+#ifndef LATENCY_RECORDER_HPP
+#define LATENCY_RECORDER_HPP
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <sstream>
+#include <unordered_map>
+
+#include "latencyhistogram.hpp"
+#include "../message/messagetype.hpp"
+
+/** The stages of a message's journey timed from its timestamps. */
+enum class LatencyStage : int
+{
+    WIRE,       // From being sent to being received and deserialised
+    QUEUE,      // From being received to being taken off the matching engine's queue
+    PROCESSING  // From being taken off the queue to being processed
+};
+
+inline std::string to_string(LatencyStage stage)
+{
+    switch (stage) {
+        case LatencyStage::WIRE: return std::string{"wire"};
+        case LatencyStage::QUEUE: return std::string{"queue"};
+        case LatencyStage::PROCESSING: return std::string{"processing"};
+        default: return std::string{""};
+    }
+}
+
+/** Process-wide latency histograms per stage, message type and sending agent. 
+ *  Safe to record to and query from any thread while the simulation runs. */
+class LatencyRecorder
+{
+public:
+
+    /** Returns the process-wide recorder. */
+    static LatencyRecorder& instance()
+    {
+      static LatencyRecorder recorder;
+      return recorder;
+    };
+
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+    /** Records the latency between two nanosecond timestamps. Negative latencies from clock skew count as zero. */
+    void record(LatencyStage stage, MessageType type, int agent_id, unsigned long long from, unsigned long long to)
+    {
+      histogramFor({stage, type, agent_id}).record(to > from ? to - from : 0);
+    };
+
+    /** Returns the latencies recorded at the stage, merged over all message types and agents unless given. */
+    LatencyHistogram snapshot(LatencyStage stage, std::optional<MessageType> type = std::nullopt, std::optional<int> agent_id = std::nullopt)
+    {
+      LatencyHistogram merged;
+      std::shared_lock<std::shared_mutex> lock(mutex_);
+      for (auto const& [key, histogram] : histograms_)
+      {
+        if (key.stage != stage) continue;
+        if (type.has_value() && key.type != type.value()) continue;
+        if (agent_id.has_value() && key.agent_id != agent_id.value()) continue;
+        merged.merge(*histogram);
+      }
+      return merged;
+    };
+
+    /** Returns one line per stage and message type recorded so far, merged over agents. */
+    std::string report()
+    {
+      std::set<std::pair<LatencyStage, MessageType>> recorded;
+      std::shared_lock<std::shared_mutex> lock(mutex_);
+      for (auto const& [key, histogram] : histograms_)
+      {
+        recorded.insert({key.stage, key.type});
+      }
+      lock.unlock();
+
+      std::ostringstream out;
+      for (auto const& [stage, type] : recorded)
+      {
+        out << to_string(stage) << " " << to_string(type) << ": " << snapshot(stage, type).summary() << "\n";
+      }
+      return out.str();
+    };
+
+private:
+
+    LatencyRecorder() = default;
+
+    struct Key
+    {
+      LatencyStage stage;
+      MessageType type;
+      int agent_id;
+
+      bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash
+    {
+      size_t operator()(const Key& key) const
+      {
+        return (static_cast<size_t>(key.agent_id) << 16) ^ (static_cast<size_t>(key.type) << 4) ^ static_cast<size_t>(key.stage);
+      };
+    };
+
+    /** Returns the histogram for the key, creating it on first use. Histograms are never removed. */
+    LatencyHistogram& histogramFor(const Key& key)
+    {
+      std::shared_lock<std::shared_mutex> read_lock(mutex_);
+      auto it = histograms_.find(key);
+      if (it != histograms_.end()) return *it->second;
+      read_lock.unlock();
+
+      std::unique_lock<std::shared_mutex> write_lock(mutex_);
+      auto [inserted, _] = histograms_.try_emplace(key, std::make_unique<LatencyHistogram>());
+      return *inserted->second;
+    };
+
+    std::shared_mutex mutex_;
+    std::unordered_map<Key, std::unique_ptr<LatencyHistogram>, KeyHash> histograms_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef LINKED_QUEUE_HPP
+#define LINKED_QUEUE_HPP
+
+#include <atomic>
+#include <utility>
+
+/** Unbounded lock-free queue for many producers and a single consumer.
+ *  Producers link a new node with a single atomic exchange, so pushing never waits on the consumer or fails;
+ *  the consumer follows the links from a stub node standing for the last value popped. */
+template <typename T>
+class LinkedQueue
+{
+public:
+
+    LinkedQueue()
+    : head_{new Node{}},
+      tail_{head_.load(std::memory_order_relaxed)}
+    {
+    };
+
+    LinkedQueue(const LinkedQueue&) = delete;
+    LinkedQueue& operator=(const LinkedQueue&) = delete;
+
+    ~LinkedQueue()
+    {
+      while (tail_ != nullptr)
+      {
+        Node* next = tail_->next.load(std::memory_order_relaxed);
+        delete tail_;
+        tail_ = next;
+      }
+    };
+
+    /** Pushes the value to the end of the queue. Safe to call from any thread. */
+    void push(T&& value)
+    {
+      Node* node = new Node{};
+      node->value = std::move(value);
+      Node* previous = head_.exchange(node, std::memory_order_acq_rel);
+      previous->next.store(node, std::memory_order_release);
+    };
+
+    /** Pops the value at the front of the queue into the given value. Returns false if the queue is empty,
+     *  or the value pushed next is still being linked. Must only be called by the consumer. */
+    bool pop(T& value)
+    {
+      Node* next = tail_->next.load(std::memory_order_acquire);
+      if (next == nullptr) return false;
+
+      value = std::move(next->value);
+      delete tail_;
+      tail_ = next;
+      return true;
+    };
+
+    /** Indicates whether the queue is empty. Must only be called by the consumer. */
+    bool empty() const
+    {
+      return tail_->next.load(std::memory_order_acquire) == nullptr;
+    };
+
+private:
+
+    struct Node
+    {
+      std::atomic<Node*> next = nullptr;
+      T value;
+    };
+
+    std::atomic<Node*> head_; // The node pushed last
+    Node* tail_;              // The stub node before the front of the queue
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,157 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "ringbuffer.hpp"
+
+/** Least severe level compiled in: 0 debug, 1 info, 2 warning, 3 error. Calls below it are removed entirely. */
+#ifndef SIMULATION_LOG_LEVEL
+#define SIMULATION_LOG_LEVEL 1
+#endif
+
+enum class LogLevel : int
+{
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR
+};
+
+/** Process-wide asynchronous logger. Callers enqueue formatted lines into a lock-free ring buffer 
+ *  and a background thread writes them out, so logging never blocks on console I/O. */
+class Logger
+{
+public:
+
+    /** Returns the process-wide logger, starting its flusher thread on first use. */
+    static Logger& instance()
+    {
+      static Logger logger;
+      return logger;
+    };
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /** Queues the line for output. The line is dropped, and counted, if the buffer is full. */
+    void log(LogLevel level, std::string line)
+    {
+      if (!buffer_.push(Entry{level, std::move(line)}))
+      {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+    };
+
+    ~Logger()
+    {
+      running_.store(false, std::memory_order_release);
+      flusher_.join();
+    };
+
+private:
+
+    struct Entry
+    {
+      LogLevel level = LogLevel::INFO;
+      std::string line;
+    };
+
+    Logger()
+    : buffer_{BUFFER_CAPACITY},
+      running_{true},
+      dropped_{0},
+      flusher_{&Logger::flush, this}
+    {
+    };
+
+    /** Writes out queued lines until the logger is destroyed, then drains what is left. */
+    void flush()
+    {
+      std::string out;
+      std::string err;
+      while (true)
+      {
+        bool stopping = !running_.load(std::memory_order_acquire);
+        Entry entry;
+        while (buffer_.pop(entry))
+        {
+          std::string& target = (entry.level >= LogLevel::WARN) ? err : out;
+          target += prefix(entry.level);
+          target += entry.line;
+          target += '\n';
+        }
+
+        size_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0)
+        {
+          err += "[WARN] Logger dropped " + std::to_string(dropped) + " lines\n";
+        }
+
+        if (!out.empty())
+        {
+          std::fwrite(out.data(), 1, out.size(), stdout);
+          std::fflush(stdout);
+          out.clear();
+        }
+        else if (err.empty())
+        {
+          if (stopping) return;
+          std::this_thread::sleep_for(FLUSH_INTERVAL);
+        }
+        if (!err.empty())
+        {
+          std::fwrite(err.data(), 1, err.size(), stderr);
+          err.clear();
+        }
+      }
+    };
+
+    static const char* prefix(LogLevel level)
+    {
+      switch (level) {
+        case LogLevel::DEBUG: return "[DEBUG] ";
+        case LogLevel::WARN: return "[WARN] ";
+        case LogLevel::ERROR: return "[ERROR] ";
+        default: return "";
+      }
+    };
+
+    static constexpr size_t BUFFER_CAPACITY = 16384;
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL {1};
+
+    RingBuffer<Entry> buffer_;
+    std::atomic<bool> running_;
+    std::atomic<size_t> dropped_;
+    std::thread flusher_;
+};
+
+/** Formats the streamed arguments and queues them at the given level. */
+#define LOG_AT(level, ...) do { std::ostringstream log_stream_; log_stream_ << __VA_ARGS__; Logger::instance().log(level, log_stream_.str()); } while (0)
+
+#if SIMULATION_LOG_LEVEL <= 0
+#define LOG_DEBUG(...) LOG_AT(LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#if SIMULATION_LOG_LEVEL <= 1
+#define LOG_INFO(...) LOG_AT(LogLevel::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if SIMULATION_LOG_LEVEL <= 2
+#define LOG_WARN(...) LOG_AT(LogLevel::WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#define LOG_ERROR(...) LOG_AT(LogLevel::ERROR, __VA_ARGS__)
+
+#endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** A read-only memory mapping of a whole file, unmapped when destroyed. */
+class MappedFile
+{
+public:
+
+    MappedFile() = delete;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /** Maps the file at the given path, throwing if it cannot be opened. */
+    explicit MappedFile(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Failed to open the file: " + path);
+        }
+
+        struct stat status;
+        if (::fstat(fd, &status) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Failed to read the size of the file: " + path);
+        }
+        size_ = static_cast<size_t>(status.st_size);
+
+        // Empty files cannot be mapped and are left as an empty view
+        if (size_ > 0)
+        {
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("Failed to map the file: " + path);
+            }
+            data_ = static_cast<const char*>(data);
+            ::madvise(data, size_, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (data_ != nullptr)
+        {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    /** Returns the contents of the file. */
+    std::string_view view() const { return std::string_view{data_, size_}; };
+
+    /** Returns the size of the file in bytes. */
+    size_t size() const { return size_; };
+
+private:
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif
\ No newline at end of file
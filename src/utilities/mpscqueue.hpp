@@ -0,0 +1,188 @@
+#ifndef MPSC_QUEUE_HPP
+#define MPSC_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <optional>
+#include <vector>
+
+#include "ringbuffer.hpp"
+
+/** Bounded FIFO queue for many producers and a single consumer, with the same interface as SyncQueue.
+ *  Pushes are lock-free; producers only take the lock to wake the consumer when it is asleep, and the
+ *  consumer can drain a whole batch per wakeup. */
+template <typename T>
+class MPSCQueue
+{
+public:
+
+    MPSCQueue(size_t capacity = 8192)
+    : ring_{capacity},
+      lock_{},
+      cv_{}
+    {
+    };
+
+    /** Pushes the value to the end of the queue, yielding while the queue is full. Safe to call from any thread. */
+    void push(T value)
+    {
+      while (!ring_.push(std::move(value)))
+      {
+        if (closed_.load(std::memory_order_acquire)) return;
+        std::this_thread::yield();
+      }
+
+      // Pairs with the fence in wait, so either the consumer sees the value or we see it asleep
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (waiting_.load(std::memory_order_relaxed))
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        lock.unlock();
+        cv_.notify_one();
+      }
+    };
+
+    /** Wait until present and pops the value from the start of the queue. Returns null ptr if the queue is closed. */
+    T pop()
+    {
+      T value {};
+      if (wait(std::nullopt)) ring_.pop(value);
+      return value;
+    };
+
+    /** Waits until present or the deadline passes and pops the value from the start of the queue. 
+     *  Returns null ptr on timeout or if the queue is closed. */
+    T popUntil(std::chrono::steady_clock::time_point deadline)
+    {
+      T value {};
+      if (wait(deadline)) ring_.pop(value);
+      return value;
+    };
+
+    /** Waits until present, then appends up to max_count values to values. 
+     *  Returns the number of values popped, zero if the queue is closed. */
+    size_t popBatch(std::vector<T>& values, size_t max_count)
+    {
+      return wait(std::nullopt) ? drain(values, max_count) : 0;
+    };
+
+    /** Waits until present or the deadline passes, then appends up to max_count values to values. 
+     *  Returns the number of values popped, zero on timeout or if the queue is closed. */
+    size_t popBatchUntil(std::chrono::steady_clock::time_point deadline, std::vector<T>& values, size_t max_count)
+    {
+      return wait(deadline) ? drain(values, max_count) : 0;
+    };
+
+    /** Sets how long the consumer busy-polls an empty queue before sleeping, so that a value pushed meanwhile is seen
+     *  without the producer waking it, at the cost of the consumer's core. Zero, the default, sleeps at once.
+     *  Must be called before the consumer starts. */
+    void setBusyPoll(std::chrono::nanoseconds busy_poll)
+    {
+      busy_poll_ = busy_poll;
+    };
+
+    /** Returns the approximate size of the queue. */
+    unsigned int size()
+    {
+      return ring_.size();
+    };
+
+    /** Prevents future writes and wakes the consumer. Values still queued are dropped with the queue. */
+    void close()
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      closed_.store(true, std::memory_order_release);
+      lock.unlock();
+      cv_.notify_all();
+    };
+
+private:
+
+    /** Waits until a value is present or the deadline passes. Returns false on timeout or if the queue is closed. */
+    bool wait(std::optional<std::chrono::steady_clock::time_point> deadline)
+    {
+      if (closed_.load(std::memory_order_acquire)) return false;
+      if (!ring_.empty()) return true;
+      if (busy_poll_.count() > 0 && poll(deadline)) return true;
+
+      std::unique_lock<std::mutex> lock(lock_);
+      waiting_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      auto ready = [this]{ return !ring_.empty() || closed_.load(std::memory_order_acquire); };
+      bool woken = true;
+      if (deadline.has_value())
+      {
+        woken = cv_.wait_until(lock, deadline.value(), ready);
+      }
+      else
+      {
+        cv_.wait(lock, ready);
+      }
+
+      waiting_.store(false, std::memory_order_relaxed);
+      return woken && !closed_.load(std::memory_order_acquire);
+    };
+
+    /** Spins until a value is present, backing off up to MAX_POLL_PAUSES pauses between checks, 
+     *  for the busy poll time or until the deadline. Returns false if none arrived or the queue was closed. */
+    bool poll(std::optional<std::chrono::steady_clock::time_point> deadline)
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      std::chrono::steady_clock::time_point end = (busy_poll_ >= std::chrono::steady_clock::time_point::max() - start)
+        ? std::chrono::steady_clock::time_point::max() 
+        : start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(busy_poll_);
+      if (deadline.has_value()) end = std::min(end, deadline.value());
+
+      unsigned int pauses = 1;
+      while (ring_.empty())
+      {
+        if (closed_.load(std::memory_order_acquire) || std::chrono::steady_clock::now() >= end) return false;
+        for (unsigned int i = 0; i < pauses; ++i)
+        {
+          cpuRelax();
+        }
+        pauses = std::min(pauses * 2, MAX_POLL_PAUSES);
+      }
+      return true;
+    };
+
+    /** Hints to the CPU that the thread is spinning, freeing resources for a sibling hyperthread. */
+    static void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__)
+      asm volatile("yield");
+#endif
+    };
+
+    /** Most pauses between checks of a busy poll, bounding how late it sees a value. */
+    static constexpr unsigned int MAX_POLL_PAUSES = 16;
+
+    /** Pops up to max_count values without waiting. */
+    size_t drain(std::vector<T>& values, size_t max_count)
+    {
+      size_t count = 0;
+      T value {};
+      while (count < max_count && ring_.pop(value))
+      {
+        values.push_back(std::move(value));
+        ++count;
+      }
+      return count;
+    };
+
+    RingBuffer<T> ring_;
+    std::mutex lock_;
+    std::condition_variable cv_;
+    std::atomic<bool> waiting_ = false;
+    std::atomic<bool> closed_ = false;
+    std::chrono::nanoseconds busy_poll_ {0};
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,152 @@
+#ifndef OBJECT_POOL_HPP
+#define OBJECT_POOL_HPP
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+
+/** Thread-safe pool of fixed-size memory blocks carved out of large chunks and recycled through a free list. */
+class ObjectPool
+{
+public:
+
+    ObjectPool(size_t blocks_per_chunk = 1024)
+    : blocks_per_chunk_{blocks_per_chunk},
+      block_size_{0},
+      free_list_{nullptr},
+      chunks_{},
+      lock_{}
+    {
+    };
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    /** Returns a block of the given size. The first request fixes the block size of the pool;
+     *  requests of any other size fall back to the global allocator. */
+    void* allocate(size_t size)
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      if (block_size_ == 0)
+      {
+        block_size_ = roundUp(std::max(size, sizeof(Block)));
+      }
+      if (roundUp(std::max(size, sizeof(Block))) != block_size_)
+      {
+        lock.unlock();
+        return ::operator new(size);
+      }
+      if (free_list_ == nullptr)
+      {
+        grow();
+      }
+      Block* block = free_list_;
+      free_list_ = block->next;
+      return block;
+    };
+
+    /** Returns the block of the given size to the pool. */
+    void deallocate(void* ptr, size_t size)
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      if (roundUp(std::max(size, sizeof(Block))) != block_size_)
+      {
+        lock.unlock();
+        ::operator delete(ptr);
+        return;
+      }
+      Block* block = static_cast<Block*>(ptr);
+      block->next = free_list_;
+      free_list_ = block;
+    };
+
+private:
+
+    struct Block
+    {
+      Block* next;
+    };
+
+    /** Rounds the size up to keep every block maximally aligned. */
+    static size_t roundUp(size_t size)
+    {
+      constexpr size_t alignment = alignof(std::max_align_t);
+      return (size + alignment - 1) / alignment * alignment;
+    };
+
+    /** Allocates a new chunk and threads its blocks onto the free list. */
+    void grow()
+    {
+      std::unique_ptr<std::byte[]> chunk{new std::byte[block_size_ * blocks_per_chunk_]};
+      for (size_t i = 0; i < blocks_per_chunk_; ++i)
+      {
+        Block* block = reinterpret_cast<Block*>(chunk.get() + i * block_size_);
+        block->next = free_list_;
+        free_list_ = block;
+      }
+      chunks_.push_back(std::move(chunk));
+    };
+
+    size_t blocks_per_chunk_;
+    size_t block_size_;
+    Block* free_list_;
+    std::vector<std::unique_ptr<std::byte[]>> chunks_;
+    std::mutex lock_;
+};
+
+typedef std::shared_ptr<ObjectPool> ObjectPoolPtr;
+
+/** Allocator drawing single objects from an ObjectPool, for use with std::allocate_shared.
+ *  Every copy shares ownership of the pool so it outlives all objects allocated from it. */
+template <typename T>
+class PoolAllocator
+{
+public:
+
+    typedef T value_type;
+
+    PoolAllocator(ObjectPoolPtr pool)
+    : pool_{pool}
+    {
+    };
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other)
+    : pool_{other.pool_}
+    {
+    };
+
+    T* allocate(size_t n)
+    {
+      if (n != 1) return static_cast<T*>(::operator new(n * sizeof(T)));
+      return static_cast<T*>(pool_->allocate(sizeof(T)));
+    };
+
+    void deallocate(T* ptr, size_t n)
+    {
+      if (n != 1) return ::operator delete(ptr);
+      pool_->deallocate(ptr, sizeof(T));
+    };
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const
+    {
+      return pool_ == other.pool_;
+    };
+
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const
+    {
+      return pool_ != other.pool_;
+    };
+
+private:
+
+    template <typename U>
+    friend class PoolAllocator;
+
+    ObjectPoolPtr pool_;
+};
+
+#endif
\ No newline at end of file
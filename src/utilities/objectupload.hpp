@@ -0,0 +1,224 @@
+#ifndef OBJECT_UPLOAD_HPP
+#define OBJECT_UPLOAD_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cerrno>
+#include <csignal>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "logger.hpp"
+#include "threadplacement.hpp"
+
+/** A stream buffer uploading what is written to it to an object in S3-compatible storage while it is being written.
+ *  Bytes are gathered into chunks, and a background thread streams full chunks to the aws CLI, which uploads them
+ *  as the parts of a multipart upload with the credentials, region and endpoint it is configured with. At most a set
+ *  number of chunks wait to be streamed; writers block once they are all taken, so memory stays bounded however
+ *  large the object grows. The object is complete once the buffer is closed. */
+class ObjectUpload : public std::streambuf
+{
+public:
+
+    ObjectUpload() = delete;
+    ObjectUpload(const ObjectUpload&) = delete;
+    ObjectUpload& operator=(const ObjectUpload&) = delete;
+
+    /** Starts uploading to the object at the given s3://bucket/key URI. */
+    explicit ObjectUpload(std::string uri, size_t chunk_size = DEFAULT_CHUNK_SIZE, size_t max_chunks = DEFAULT_MAX_CHUNKS)
+    : uri_{uri},
+      chunk_size_{chunk_size},
+      max_chunks_{std::max(max_chunks, size_t{1})}
+    {
+      chunk_.reserve(chunk_size_);
+      uploader_ = std::thread{&ObjectUpload::runUploader, this};
+    };
+
+    ~ObjectUpload()
+    {
+      close();
+    };
+
+    /** Indicates whether the given path names an object in S3-compatible storage rather than a local file. */
+    static bool isObjectPath(std::string_view path)
+    {
+      return path.starts_with("s3://");
+    };
+
+    /** Streams the rest of the object and waits for its upload to complete. Returns whether it was uploaded. */
+    bool close()
+    {
+      if (!uploader_.joinable()) return !failed_;
+      if (!chunk_.empty()) submit();
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      closed_ = true;
+      lock.unlock();
+      cv_.notify_all();
+      uploader_.join();
+      return !failed_;
+    };
+
+    /** Bytes of the object each chunk holds unless configured otherwise, the part size the aws CLI uploads by default. */
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 8 << 20;
+
+    /** Chunks waiting to be streamed before writers block, unless configured otherwise. */
+    static constexpr size_t DEFAULT_MAX_CHUNKS = 4;
+
+protected:
+
+    std::streamsize xsputn(const char* data, std::streamsize size) override
+    {
+      chunk_.append(data, static_cast<size_t>(size));
+      if (chunk_.size() >= chunk_size_) submit();
+      return size;
+    };
+
+    int_type overflow(int_type c) override
+    {
+      if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+      chunk_.push_back(traits_type::to_char_type(c));
+      if (chunk_.size() >= chunk_size_) submit();
+      return c;
+    };
+
+private:
+
+    /** Queues the gathered chunk to be streamed, waiting while the queue is full. */
+    void submit()
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]{ return chunks_.size() < max_chunks_; });
+      chunks_.push_back(std::move(chunk_));
+      lock.unlock();
+      cv_.notify_all();
+
+      chunk_ = std::string{};
+      chunk_.reserve(chunk_size_);
+    };
+
+    /** Streams each queued chunk to the aws CLI until closed, then waits for the CLI to complete the upload. */
+    void runUploader()
+    {
+      ThreadPlacement::instance().pinCurrent(ThreadRole::WRITER);
+
+      pid_t pid = -1;
+      int pipe = startCLI(pid);
+      if (pipe == -1)
+      {
+        LOG_ERROR("Failed to start the upload of " << uri_);
+        failed_ = true;
+      }
+
+      // A CLI that exits early raises SIGPIPE on the next write, which is blocked in this thread alone so the write fails instead
+      sigset_t sigpipe;
+      sigemptyset(&sigpipe);
+      sigaddset(&sigpipe, SIGPIPE);
+      pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (true)
+      {
+        cv_.wait(lock, [this]{ return closed_ || !chunks_.empty(); });
+        if (chunks_.empty()) break;
+        std::string chunk = std::move(chunks_.front());
+        chunks_.pop_front();
+        lock.unlock();
+        cv_.notify_all();
+
+        // Chunks are still taken once the upload has failed, so that writers are not blocked
+        if (!failed_ && !writeAll(pipe, chunk))
+        {
+          LOG_ERROR("Failed to stream " << uri_ << " to the aws CLI");
+          failed_ = true;
+
+          // Consumes the SIGPIPE the failed write left pending
+          timespec none {0, 0};
+          sigtimedwait(&sigpipe, nullptr, &none);
+        }
+        lock.lock();
+      }
+      lock.unlock();
+
+      if (pipe != -1)
+      {
+        ::close(pipe);
+        int status = 0;
+        pid_t waited = -1;
+        while ((waited = ::waitpid(pid, &status, 0)) == -1 && errno == EINTR);
+        if (waited == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+          LOG_ERROR("Failed to upload " << uri_);
+          failed_ = true;
+        }
+      }
+    };
+
+    /** Spawns the aws CLI to upload its standard input to the object, without a shell. Returns the pipe to its standard input, or -1. */
+    int startCLI(pid_t& pid)
+    {
+      // Both ends are closed on exec, so neither this CLI nor one spawned for another object holds the pipe open
+      int ends[2];
+      if (::pipe2(ends, O_CLOEXEC) == -1) return -1;
+
+      posix_spawn_file_actions_t actions;
+      posix_spawn_file_actions_init(&actions);
+      posix_spawn_file_actions_adddup2(&actions, ends[0], STDIN_FILENO);
+
+      std::string uri = uri_;
+      char aws[] = "aws", s3[] = "s3", cp[] = "cp", quiet[] = "--only-show-errors", from_stdin[] = "-";
+      char* argv[] = {aws, s3, cp, quiet, from_stdin, uri.data(), nullptr};
+      int spawned = posix_spawnp(&pid, "aws", &actions, nullptr, argv, environ);
+      posix_spawn_file_actions_destroy(&actions);
+
+      ::close(ends[0]);
+      if (spawned != 0)
+      {
+        ::close(ends[1]);
+        return -1;
+      }
+      return ends[1];
+    };
+
+    /** Writes the whole chunk to the pipe. Returns whether it was written. */
+    static bool writeAll(int pipe, std::string_view chunk)
+    {
+      while (!chunk.empty())
+      {
+        ssize_t written = ::write(pipe, chunk.data(), chunk.size());
+        if (written == -1 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        chunk.remove_prefix(static_cast<size_t>(written));
+      }
+      return true;
+    };
+
+    std::string uri_;
+    size_t chunk_size_;
+    size_t max_chunks_;
+
+    /** Chunk being gathered by the writer. */
+    std::string chunk_;
+
+    /** Full chunks waiting to be streamed, at most max_chunks_. */
+    std::deque<std::string> chunks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool closed_ = false;
+    std::atomic<bool> failed_ = false;
+
+    std::thread uploader_;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef ORDER_TAPE_HPP
+#define ORDER_TAPE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../message/message.hpp"
+#include "../networking/networkentity.hpp"
+#include "../networking/wireformat.hpp"
+
+/** A tape of the order messages an exchange has matched, with their full payloads, in the order it matched them,
+ *  so that the session can be replayed offline. Each message is kept in the binary wire format behind its length. */
+class OrderTape
+{
+public:
+
+    OrderTape() = delete;
+    OrderTape(const OrderTape&) = delete;
+    OrderTape& operator=(const OrderTape&) = delete;
+
+    /** Creates the tape at the given path, replacing any file there. */
+    explicit OrderTape(const std::string& path)
+    : file_{path, std::ios::binary | std::ios::trunc}
+    {
+        if (!file_.is_open())
+        {
+            throw std::runtime_error("Failed to open order tape for writing: " + path);
+        }
+        file_.write(MAGIC, sizeof(MAGIC));
+    }
+
+    /** Appends the message to the tape. */
+    void record(MessagePtr message)
+    {
+        std::string serialised = NetworkEntity::serialiseMessage(message, WireFormat::BINARY);
+        uint32_t length = static_cast<uint32_t>(serialised.size());
+        file_.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        file_.write(serialised.data(), serialised.size());
+    }
+
+    /** Writes out the messages recorded and closes the tape. */
+    void close()
+    {
+        file_.close();
+    }
+
+    /** Reads every message of the tape at the given path. A tape cut short ends at its last whole message. */
+    static std::vector<MessagePtr> read(const std::string& path)
+    {
+        std::ifstream file {path, std::ios::binary};
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open order tape: " + path);
+        }
+
+        char magic[sizeof(MAGIC)];
+        if (!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), MAGIC))
+        {
+            throw std::runtime_error("Not an order tape: " + path);
+        }
+
+        std::vector<MessagePtr> messages;
+        uint32_t length;
+        std::string serialised;
+        while (file.read(reinterpret_cast<char*>(&length), sizeof(length)))
+        {
+            serialised.resize(length);
+            if (!file.read(serialised.data(), length)) break;
+            messages.push_back(NetworkEntity::deserialiseMessage(serialised));
+        }
+        return messages;
+    }
+
+private:
+
+    static constexpr char MAGIC[8] = {'D', 'S', 'X', 'E', 'T', 'A', 'P', 'E'};
+
+    std::ofstream file_;
+};
+
+typedef std::shared_ptr<OrderTape> OrderTapePtr;
+
+#endif
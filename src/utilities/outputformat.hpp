@@ -0,0 +1,28 @@
+#ifndef OUTPUT_FORMAT_HPP
+#define OUTPUT_FORMAT_HPP
+
+#include <string>
+
+enum class OutputFormat : int
+{
+    CSV,        // One line of comma-separated text per row
+    COLUMNAR    // Fixed-schema binary row groups, see ColumnarWriter
+};
+
+inline std::string to_string(OutputFormat format)
+{
+    switch (format) {
+        case OutputFormat::CSV: return std::string{"csv"};
+        case OutputFormat::COLUMNAR: return std::string{"columnar"};
+        default: return std::string{""};
+    }
+}
+
+/** Returns the output format for the given name. Defaults to CSV. */
+inline OutputFormat output_format_from_string(std::string_view name)
+{
+    if (name == "columnar") return OutputFormat::COLUMNAR;
+    return OutputFormat::CSV;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef OUTPUT_STREAM_HPP
+#define OUTPUT_STREAM_HPP
+
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "objectupload.hpp"
+
+/** An output stream to a local file, or to an object in S3-compatible storage for a path of the form s3://bucket/key. */
+class OutputStream : public std::ostream
+{
+public:
+
+    OutputStream(const std::string& path, std::ios::openmode mode = std::ios::out)
+    : std::ostream{nullptr}
+    {
+      if (ObjectUpload::isObjectPath(path))
+      {
+        upload_ = std::make_unique<ObjectUpload>(path);
+        rdbuf(upload_.get());
+      }
+      else
+      {
+        file_.open(path, mode | std::ios::out);
+        rdbuf(&file_);
+      }
+    };
+
+    /** Writes out what is buffered and closes the file, or completes the upload of the object. */
+    void close()
+    {
+      flush();
+      if (upload_ != nullptr)
+      {
+        upload_->close();
+      }
+      else
+      {
+        file_.close();
+      }
+    };
+
+private:
+
+    std::filebuf file_;
+    std::unique_ptr<ObjectUpload> upload_;
+};
+
+#endif
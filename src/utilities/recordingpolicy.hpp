@@ -0,0 +1,89 @@
+#ifndef RECORDING_POLICY_HPP
+#define RECORDING_POLICY_HPP
+
+#include <cctype>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/** Which rows of an output stream are recorded: every row, every nth, or for each bucket of time
+ *  the last row or the rows holding its open, high, low and close price. */
+struct RecordingPolicy
+{
+    enum Kind : unsigned char
+    {
+        EVERY,
+        NTH,
+        LAST,
+        OHLC
+    };
+
+    Kind kind = EVERY;
+    unsigned long long size = 1; // rows, or nanoseconds
+
+    /** Indicates whether rows are held until their bucket of time closes, rather than written or dropped as they come. */
+    bool holdsRows() const
+    {
+        return kind == LAST || kind == OHLC;
+    }
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version)
+    {
+        ar & kind;
+        ar & size;
+    }
+};
+
+inline std::string to_string(const RecordingPolicy& policy)
+{
+    auto span = [](unsigned long long size) {
+        if (size % 1000000000ULL == 0) return std::to_string(size / 1000000000ULL) + "s";
+        if (size % 1000000ULL == 0) return std::to_string(size / 1000000ULL) + "ms";
+        if (size % 1000ULL == 0) return std::to_string(size / 1000ULL) + "us";
+        return std::to_string(size) + "ns";
+    };
+
+    switch (policy.kind) {
+        case RecordingPolicy::EVERY: return std::string{"every"};
+        case RecordingPolicy::NTH: return "nth:" + std::to_string(policy.size);
+        case RecordingPolicy::LAST: return "last:" + span(policy.size);
+        case RecordingPolicy::OHLC: return "ohlc:" + span(policy.size);
+        default: return std::string{""};
+    }
+}
+
+/** Returns the policy described by the given string: "every", "nth:<rows>" such as "nth:10", or "last:<span>" or "ohlc:<span>"
+ *  with a span of time in seconds, milliseconds, microseconds or nanoseconds such as "last:100ms". Defaults to every row. */
+inline RecordingPolicy recording_policy_from_string(std::string_view policy)
+{
+    if (policy.empty() || policy == "every") return RecordingPolicy{};
+
+    size_t colon = policy.find(':');
+    std::string_view kind = policy.substr(0, colon);
+    std::string_view size = (colon == std::string_view::npos) ? std::string_view{} : policy.substr(colon + 1);
+
+    size_t digits = 0;
+    while (digits < size.size() && std::isdigit(static_cast<unsigned char>(size[digits]))) ++digits;
+    unsigned long long count = (digits > 0) ? std::stoull(std::string{size.substr(0, digits)}) : 0;
+    std::string_view unit = size.substr(digits);
+    if (count == 0)
+    {
+        throw std::runtime_error("Invalid recording policy: " + std::string{policy});
+    }
+
+    if (kind == "nth" && unit.empty()) return RecordingPolicy{RecordingPolicy::NTH, count};
+    if (kind != "last" && kind != "ohlc")
+    {
+        throw std::runtime_error("Unknown recording policy: " + std::string{policy});
+    }
+
+    RecordingPolicy::Kind bucketed = (kind == "last") ? RecordingPolicy::LAST : RecordingPolicy::OHLC;
+    if (unit == "s") return RecordingPolicy{bucketed, count * 1000000000ULL};
+    if (unit == "ms") return RecordingPolicy{bucketed, count * 1000000ULL};
+    if (unit == "us") return RecordingPolicy{bucketed, count * 1000ULL};
+    if (unit == "ns") return RecordingPolicy{bucketed, count};
+    throw std::runtime_error("Unknown unit of recording policy: " + std::string{policy});
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef RECORD_SINK_HPP
+#define RECORD_SINK_HPP
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "threadplacement.hpp"
+
+/** Writes copies of fixed-size records as CSV rows to a file opened once.
+ *  Records are queued by value and formatted by a background thread every flush interval,
+ *  so the caller only copies the record. Records must provide csvHeaders() and appendCSV(std::string&). */
+template<class Record>
+class RecordSink
+{
+public:
+
+    RecordSink() = delete;
+    RecordSink(const RecordSink&) = delete;
+    RecordSink& operator=(const RecordSink&) = delete;
+
+    RecordSink(std::string path, std::chrono::milliseconds flush_interval = std::chrono::milliseconds{200})
+    : file_{path},
+      flush_interval_{flush_interval}
+    {
+        records_.reserve(RESERVED_RECORDS);
+        flusher_ = std::thread{&RecordSink::runFlusher, this};
+    };
+
+    ~RecordSink()
+    {
+        stop();
+    };
+
+    /** Queues the given record to be written. */
+    void write(const Record& record)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        records_.push_back(record);
+    }
+
+    /** Writes out all queued records and closes the file. */
+    void stop()
+    {
+        if (flusher_.joinable())
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stopped_ = true;
+            lock.unlock();
+            cv_.notify_one();
+            flusher_.join();
+        }
+        file_.close();
+    }
+
+private:
+
+    /** Swaps out the queued records and writes them to the file until stopped, then writes out the rest. */
+    void runFlusher()
+    {
+        ThreadPlacement::instance().pinCurrent(ThreadRole::WRITER);
+        std::vector<Record> pending;
+        pending.reserve(RESERVED_RECORDS);
+        std::string rows;
+        bool started = false;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            cv_.wait_for(lock, flush_interval_, [this]{ return stopped_; });
+            pending.swap(records_);
+            bool stopped = stopped_;
+            lock.unlock();
+
+            if (!pending.empty())
+            {
+                if (!started)
+                {
+                    rows += pending.front().csvHeaders();
+                    rows += '\n';
+                    started = true;
+                }
+                for (Record const& record : pending)
+                {
+                    record.appendCSV(rows);
+                    rows += '\n';
+                }
+                file_.write(rows.data(), rows.size());
+                file_.flush();
+                rows.clear();
+                pending.clear();
+            }
+            if (stopped) return;
+
+            lock.lock();
+        }
+    }
+
+    /** Records queued between flushes are kept without reallocating up to this many. */
+    static constexpr size_t RESERVED_RECORDS = 1024;
+
+    std::ofstream file_;
+    std::chrono::milliseconds flush_interval_;
+    std::vector<Record> records_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopped_ = false;
+    std::thread flusher_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,121 @@
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+/** Bounded lock-free queue for many producers and a single consumer. 
+ *  Each slot carries a sequence number telling producers and the consumer whose turn it is. */
+template <typename T>
+class RingBuffer
+{
+public:
+
+    /** Creates a ring buffer holding up to capacity values, rounded up to a power of two. */
+    RingBuffer(size_t capacity = 8192)
+    : capacity_{roundUp(capacity)},
+      mask_{capacity_ - 1},
+      slots_{std::make_unique<Slot[]>(capacity_)},
+      head_{0},
+      tail_{0}
+    {
+      for (size_t i = 0; i < capacity_; ++i)
+      {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+      }
+    };
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    /** Pushes the value to the end of the queue. Returns false without blocking if the queue is full, 
+     *  leaving the value untouched. Safe to call from any thread. */
+    bool push(T&& value)
+    {
+      size_t position = tail_.load(std::memory_order_relaxed);
+      Slot* slot;
+      while (true)
+      {
+        slot = &slots_[position & mask_];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+        if (difference == 0)
+        {
+          if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+        }
+        else if (difference < 0)
+        {
+          return false;
+        }
+        else
+        {
+          position = tail_.load(std::memory_order_relaxed);
+        }
+      }
+
+      slot->value = std::move(value);
+      slot->sequence.store(position + 1, std::memory_order_release);
+      return true;
+    };
+
+    /** Pops the value at the start of the queue into value. Returns false if the queue is empty. 
+     *  Must only be called from the consumer thread. */
+    bool pop(T& value)
+    {
+      size_t position = head_.load(std::memory_order_relaxed);
+      Slot& slot = slots_[position & mask_];
+      if (slot.sequence.load(std::memory_order_acquire) != position + 1) return false;
+
+      value = std::move(slot.value);
+      slot.sequence.store(position + capacity_, std::memory_order_release);
+      head_.store(position + 1, std::memory_order_relaxed);
+      return true;
+    };
+
+    /** Indicates whether there is no value ready to be popped. Must only be called from the consumer thread. */
+    bool empty() const
+    {
+      size_t position = head_.load(std::memory_order_relaxed);
+      return slots_[position & mask_].sequence.load(std::memory_order_acquire) != position + 1;
+    };
+
+    /** Returns the approximate number of values in the queue. */
+    size_t size() const
+    {
+      size_t head = head_.load(std::memory_order_relaxed);
+      size_t tail = tail_.load(std::memory_order_relaxed);
+      return tail > head ? tail - head : 0;
+    };
+
+    /** Returns the number of values the queue can hold. */
+    size_t capacity() const
+    {
+      return capacity_;
+    };
+
+private:
+
+    struct Slot
+    {
+      std::atomic<size_t> sequence;
+      T value;
+    };
+
+    static size_t roundUp(size_t capacity)
+    {
+      size_t rounded = 2;
+      while (rounded < capacity) rounded <<= 1;
+      return rounded;
+    }
+
+    size_t capacity_;
+    size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+
+    /** Kept on separate cache lines so producers and the consumer do not contend. */
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+#endif
\ No newline at end of file
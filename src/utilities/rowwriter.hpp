@@ -0,0 +1,24 @@
+#ifndef ROW_WRITER_HPP
+#define ROW_WRITER_HPP
+
+#include <memory>
+
+#include "csvprintable.hpp"
+
+/** An output file the exchange writes items to, one row per item. */
+class RowWriter
+{
+public:
+
+    virtual ~RowWriter() = default;
+
+    /** Writes the given item as a row. Rows keep the order they are written in. */
+    virtual void writeRow(CSVPrintablePtr item) = 0;
+
+    /** Writes out all buffered rows and closes the file. */
+    virtual void stop() = 0;
+};
+
+typedef std::shared_ptr<RowWriter> RowWriterPtr;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+#ifndef SAMPLED_WRITER_HPP
+#define SAMPLED_WRITER_HPP
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "rowwriter.hpp"
+#include "recordingpolicy.hpp"
+#include "simulationclock.hpp"
+
+/** Writes the rows of a stream to another writer under a recording policy, dropping the rest before they are formatted.
+ *  Time buckets are aligned to the simulation clock and written once a row of a later bucket arrives or the writer stops,
+ *  so a bucket with no rows is not written at all. For OHLC buckets the rows holding the open, high, low and close price
+ *  are written, each once and in the order they arrived. Rows held until their bucket closes must not be changed after. */
+class SampledWriter : public RowWriter
+{
+public:
+
+    /** Returns the price of a row that OHLC buckets are taken over. */
+    typedef std::function<double(const CSVPrintable&)> PriceOf;
+
+    SampledWriter() = delete;
+
+    SampledWriter(RowWriterPtr writer, RecordingPolicy policy, PriceOf price_of = nullptr)
+    : writer_{writer},
+      policy_{policy},
+      price_of_{price_of}
+    {
+      if (policy_.kind == RecordingPolicy::OHLC && !price_of_)
+      {
+        throw std::runtime_error("OHLC recording needs the price of each row");
+      }
+    };
+
+    ~SampledWriter()
+    {
+      stop();
+    };
+
+    void writeRow(CSVPrintablePtr item) override
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      unsigned long long sequence = rows_++;
+      switch (policy_.kind)
+      {
+        case RecordingPolicy::EVERY:
+        {
+          writer_->writeRow(item);
+          break;
+        }
+        case RecordingPolicy::NTH:
+        {
+          if (sequence % policy_.size == 0) writer_->writeRow(item);
+          break;
+        }
+        default:
+        {
+          unsigned long long bucket = static_cast<unsigned long long>(SimulationClock::now().count()) / policy_.size;
+          if (close_.item != nullptr && bucket != bucket_) writeBucket();
+          bucket_ = bucket;
+          hold(Held{item, sequence, price_of_ ? price_of_(*item) : 0.0});
+          break;
+        }
+      }
+    };
+
+    /** Writes the bucket still open, then stops the writer written to. */
+    void stop() override
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (stopped_) return;
+      stopped_ = true;
+      if (close_.item != nullptr) writeBucket();
+      writer_->stop();
+    };
+
+private:
+
+    /** A row of the open bucket, with its place in the stream and its price. */
+    struct Held
+    {
+      CSVPrintablePtr item;
+      unsigned long long sequence = 0;
+      double price = 0;
+    };
+
+    /** Keeps the row as the close of the open bucket, and as its open, high or low if it is one. */
+    void hold(Held row)
+    {
+      if (policy_.kind == RecordingPolicy::OHLC)
+      {
+        if (close_.item == nullptr)
+        {
+          open_ = row;
+          high_ = row;
+          low_ = row;
+        }
+        if (row.price > high_.price) high_ = row;
+        if (row.price < low_.price) low_ = row;
+      }
+      close_ = std::move(row);
+    };
+
+    /** Writes the rows kept of the open bucket and empties it. */
+    void writeBucket()
+    {
+      if (policy_.kind == RecordingPolicy::OHLC)
+      {
+        std::vector<Held*> rows {&open_, &high_, &low_, &close_};
+        std::sort(rows.begin(), rows.end(), [](const Held* a, const Held* b) { return a->sequence < b->sequence; });
+        rows.erase(std::unique(rows.begin(), rows.end(), [](const Held* a, const Held* b) { return a->sequence == b->sequence; }), rows.end());
+        for (Held* row : rows)
+        {
+          writer_->writeRow(row->item);
+        }
+        open_ = high_ = low_ = Held{};
+      }
+      else
+      {
+        writer_->writeRow(close_.item);
+      }
+      close_ = Held{};
+    };
+
+    RowWriterPtr writer_;
+    RecordingPolicy policy_;
+    PriceOf price_of_;
+
+    std::mutex mutex_;
+    unsigned long long rows_ = 0;
+    unsigned long long bucket_ = 0;
+    Held open_;
+    Held high_;
+    Held low_;
+    Held close_;
+    bool stopped_ = false;
+};
+
+#endif
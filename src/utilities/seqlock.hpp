@@ -0,0 +1,100 @@
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+/** Holds a small trivially copyable value that any thread may replace and any thread may read without locking.
+ *  A version count, odd while a value is being written, lets readers detect a torn read and retry it.
+ *  The value is kept in atomic words, so readers racing a writer never have a data race, only a retry.
+ *  Writers exclude each other by claiming the odd count; readers never hold writers up. */
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock values must be trivially copyable");
+
+public:
+
+    SeqLock() = default;
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    /** Replaces the value. Safe to call from any thread. */
+    void store(const T& value)
+    {
+        uint64_t version = version_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            if (version & 1)
+            {
+                std::this_thread::yield();
+                version = version_.load(std::memory_order_relaxed);
+            }
+            else if (version_.compare_exchange_weak(version, version + 1, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        // Keeps the stores below from being seen before the odd count
+        std::atomic_thread_fence(std::memory_order_release);
+
+        // Copied through bytes, so T may have member initialisers and need not be default constructible
+        std::array<uint64_t, WORDS> words {};
+        Bytes bytes = std::bit_cast<Bytes>(value);
+        std::memcpy(words.data(), bytes.data(), sizeof(T));
+        for (size_t i = 0; i < WORDS; ++i) words_[i].store(words[i], std::memory_order_relaxed);
+
+        version_.store(version + 2, std::memory_order_release);
+    }
+
+    /** Returns the latest value completely written, or a value-initialised T if none has been. Safe to call from any thread. */
+    T load() const
+    {
+        std::array<uint64_t, WORDS> words;
+        while (true)
+        {
+            uint64_t version = version_.load(std::memory_order_acquire);
+            if (version & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < WORDS; ++i) words[i] = words_[i].load(std::memory_order_relaxed);
+
+            // Keeps the loads above from being seen after the second read of the count
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (version_.load(std::memory_order_relaxed) == version)
+            {
+                if (version == 0) return T{};
+                break;
+            }
+        }
+
+        Bytes bytes;
+        std::memcpy(bytes.data(), words.data(), sizeof(T));
+        return std::bit_cast<T>(bytes);
+    }
+
+    /** Returns the number of values stored so far. */
+    uint64_t updates() const
+    {
+        return version_.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+
+    typedef std::array<std::byte, sizeof(T)> Bytes;
+
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> version_ {0};
+    std::array<std::atomic<uint64_t>, WORDS> words_ {};
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,346 @@
+#ifndef SHARED_MEMORY_RING_HPP
+#define SHARED_MEMORY_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+/** A ring of fixed-size slots in a memory-mapped file, such as one under /dev/shm, that one process writes messages to
+ *  and any number of processes on the same host read, each at its own pace and without the writer knowing of them.
+ *  Every message is numbered; a slot's version, odd while it is being written, lets readers detect a torn read,
+ *  and readers that fall a whole ring behind skip to the oldest message left and count those they missed.
+ *  Payloads are kept in atomic words, so readers racing the writer never have a data race, only a retry.
+ *  Readers waiting for messages sleep on a futex the writer wakes, which costs the writer nothing while none is waiting. */
+class SharedMemoryRing
+{
+public:
+
+    SharedMemoryRing() = delete;
+    SharedMemoryRing(const SharedMemoryRing&) = delete;
+    SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+    ~SharedMemoryRing()
+    {
+      if (header_ != nullptr)
+      {
+        ::munmap(header_, mapped_size_);
+      }
+      // Readers keep their mappings of a ring removed under them, and see no more messages on it
+      if (owner_)
+      {
+        ::unlink(path_.c_str());
+      }
+    };
+
+    /** Creates the ring at the given path with the given number of slots, each holding a message of up to the given size,
+     *  replacing any ring left there. The ring is removed when the writer is destroyed. Throws if it cannot be created. */
+    static std::unique_ptr<SharedMemoryRing> create(const std::string& path, uint32_t slot_count, uint32_t payload_size)
+    {
+      uint32_t payload_words = (payload_size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+      uint32_t slot_words = SLOT_HEADER_WORDS + payload_words;
+      size_t size = sizeof(Header) + static_cast<size_t>(slot_count) * slot_words * sizeof(uint64_t);
+
+      // Built aside and renamed into place, so that no reader maps a ring of the wrong size
+      std::string building = path + ".building";
+      int fd = ::open(building.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0)
+      {
+        throw std::runtime_error("Failed to create the shared memory ring: " + path);
+      }
+      if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+      {
+        ::close(fd);
+        ::unlink(building.c_str());
+        throw std::runtime_error("Failed to size the shared memory ring: " + path);
+      }
+      std::unique_ptr<SharedMemoryRing> ring;
+      try
+      {
+        ring.reset(new SharedMemoryRing(path, fd, size, false));
+      }
+      catch (std::exception&)
+      {
+        ::close(fd);
+        ::unlink(building.c_str());
+        throw;
+      }
+      ::close(fd);
+
+      Header* header = ring->header_;
+      header->slot_count = slot_count;
+      header->slot_words = slot_words;
+      header->token = std::random_device{}() ^ (static_cast<uint64_t>(std::random_device{}()) << 32) ^ ::getpid();
+      header->published.store(0, std::memory_order_relaxed);
+      header->magic.store(MAGIC, std::memory_order_release);
+
+      if (::rename(building.c_str(), path.c_str()) != 0)
+      {
+        ::unlink(building.c_str());
+        throw std::runtime_error("Failed to publish the shared memory ring: " + path);
+      }
+      ring->owner_ = true;
+      return ring;
+    };
+
+    /** Opens the ring at the given path for reading from its next message on. Throws if it cannot be opened,
+     *  or is not the ring with the given token, as when the path names a ring of another host or an earlier session. */
+    static std::unique_ptr<SharedMemoryRing> open(const std::string& path, uint64_t token)
+    {
+      int fd = ::open(path.c_str(), O_RDWR);
+      if (fd < 0)
+      {
+        throw std::runtime_error("Failed to open the shared memory ring: " + path);
+      }
+      struct stat status;
+      if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(Header))
+      {
+        ::close(fd);
+        throw std::runtime_error("Not a shared memory ring: " + path);
+      }
+      std::unique_ptr<SharedMemoryRing> ring;
+      try
+      {
+        ring.reset(new SharedMemoryRing(path, fd, static_cast<size_t>(status.st_size), false));
+      }
+      catch (std::exception&)
+      {
+        ::close(fd);
+        throw;
+      }
+      ::close(fd);
+
+      const Header* header = ring->header_;
+      size_t expected = sizeof(Header) + static_cast<size_t>(header->slot_count) * header->slot_words * sizeof(uint64_t);
+      if (header->magic.load(std::memory_order_acquire) != MAGIC || header->token != token || expected != ring->mapped_size_)
+      {
+        throw std::runtime_error("Shared memory ring " + path + " is not the one offered");
+      }
+      ring->next_ = header->published.load(std::memory_order_acquire) + 1;
+      return ring;
+    };
+
+    /** Writes the message to the next slot and wakes any waiting readers. Returns false, writing nothing,
+     *  if the message does not fit in a slot. Only the process that created the ring writes to it, from one thread at a time. */
+    bool publish(std::string_view message)
+    {
+      if (message.size() > payloadSize()) return false;
+
+      uint64_t sequence = header_->published.load(std::memory_order_relaxed) + 1;
+      uint64_t* slot = slotFor(sequence);
+      std::atomic_ref<uint64_t> version {slot[0]};
+      version.store(sequence * 2 - 1, std::memory_order_relaxed);
+      // Keeps the stores below from being seen before the odd version
+      std::atomic_thread_fence(std::memory_order_release);
+
+      std::atomic_ref<uint64_t>{slot[1]}.store(message.size(), std::memory_order_relaxed);
+      uint64_t* payload = slot + SLOT_HEADER_WORDS;
+      size_t words = (message.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+      for (size_t i = 0; i < words; ++i)
+      {
+        uint64_t word = 0;
+        std::memcpy(&word, message.data() + i * sizeof(uint64_t), std::min(sizeof(uint64_t), message.size() - i * sizeof(uint64_t)));
+        std::atomic_ref<uint64_t>{payload[i]}.store(word, std::memory_order_relaxed);
+      }
+
+      version.store(sequence * 2, std::memory_order_release);
+      header_->published.store(sequence, std::memory_order_seq_cst);
+
+      // A reader that saw no waiters counted yet finds the changed notification count and does not sleep
+      header_->notifications.fetch_add(1, std::memory_order_seq_cst);
+      if (header_->waiters.load(std::memory_order_seq_cst) > 0)
+      {
+        wake();
+      }
+      return true;
+    };
+
+    /** Reads the next message into the given string and returns true, or returns false if none has been written yet.
+     *  Messages overwritten before they were read are skipped and counted. */
+    bool next(std::string& message)
+    {
+      while (true)
+      {
+        uint64_t* slot = slotFor(next_);
+        std::atomic_ref<uint64_t> version {slot[0]};
+        uint64_t before = version.load(std::memory_order_acquire);
+        if (before < next_ * 2) return false;
+        if (before == next_ * 2)
+        {
+          size_t size = std::min<uint64_t>(std::atomic_ref<uint64_t>{slot[1]}.load(std::memory_order_relaxed), payloadSize());
+          message.resize(size);
+          const uint64_t* payload = slot + SLOT_HEADER_WORDS;
+          size_t words = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+          for (size_t i = 0; i < words; ++i)
+          {
+            uint64_t word = std::atomic_ref<uint64_t>{const_cast<uint64_t&>(payload[i])}.load(std::memory_order_relaxed);
+            std::memcpy(message.data() + i * sizeof(uint64_t), &word, std::min(sizeof(uint64_t), size - i * sizeof(uint64_t)));
+          }
+
+          // Keeps the loads above from being seen after the second read of the version
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if (version.load(std::memory_order_relaxed) == before)
+          {
+            ++next_;
+            return true;
+          }
+        }
+
+        // Lapped by the writer: carry on from the oldest message still in the ring
+        uint64_t published = header_->published.load(std::memory_order_acquire);
+        uint64_t oldest = (published > header_->slot_count) ? published - header_->slot_count + 1 : 1;
+        if (oldest > next_)
+        {
+          skipped_ += oldest - next_;
+          next_ = oldest;
+        }
+      }
+    };
+
+    /** Waits until a message may have been written since the notification count was read, for at most the given time. */
+    void wait(uint32_t notifications, std::chrono::milliseconds timeout)
+    {
+      header_->waiters.fetch_add(1, std::memory_order_seq_cst);
+#ifdef __linux__
+      struct timespec relative {static_cast<time_t>(timeout.count() / 1000), static_cast<long>((timeout.count() % 1000) * 1000000)};
+      ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header_->notifications), FUTEX_WAIT, notifications, &relative, nullptr, 0);
+#else
+      if (header_->notifications.load(std::memory_order_seq_cst) == notifications)
+      {
+        std::this_thread::sleep_for(std::min(timeout, std::chrono::milliseconds(1)));
+      }
+#endif
+      header_->waiters.fetch_sub(1, std::memory_order_seq_cst);
+    };
+
+    /** Returns the number of times messages were written, for waiting on. Read before looking for the next message. */
+    uint32_t notifications() const
+    {
+      return header_->notifications.load(std::memory_order_seq_cst);
+    };
+
+    /** Returns the number of messages written so far. */
+    uint64_t published() const
+    {
+      return header_->published.load(std::memory_order_acquire);
+    };
+
+    /** Returns the number of messages this reader missed for being lapped by the writer. */
+    uint64_t skipped() const
+    {
+      return skipped_;
+    };
+
+    /** Returns the largest message a slot holds. */
+    size_t payloadSize() const
+    {
+      return (header_->slot_words - SLOT_HEADER_WORDS) * sizeof(uint64_t);
+    };
+
+    /** Returns the random token the ring was created with, which readers are given to check they opened the right ring. */
+    uint64_t token() const
+    {
+      return header_->token;
+    };
+
+    const std::string& path() const
+    {
+      return path_;
+    };
+
+    /** Returns an identifier of the host this process runs on, shared by the containers on it:
+     *  the kernel's boot ID where there is one, else the host name. */
+    static const std::string& hostId()
+    {
+      static const std::string host_id = []() {
+        std::string id;
+        std::ifstream boot_id {"/proc/sys/kernel/random/boot_id"};
+        if (boot_id && std::getline(boot_id, id) && !id.empty()) return id;
+
+        char name[256] = {};
+        ::gethostname(name, sizeof(name) - 1);
+        return std::string{name};
+      }();
+      return host_id;
+    };
+
+private:
+
+    static constexpr uint32_t MAGIC = 0x44535852; // "DSXR"
+
+    /** Version and size of the message in each slot, ahead of its payload. */
+    static constexpr uint32_t SLOT_HEADER_WORDS = 2;
+
+    /** The start of the ring, on a cache line of its own. */
+    struct alignas(64) Header
+    {
+      std::atomic<uint32_t> magic;
+      uint32_t slot_count;
+      uint32_t slot_words;
+      uint64_t token;
+      std::atomic<uint64_t> published; // sequence number of the latest message written, from 1
+      alignas(64) std::atomic<uint32_t> notifications; // futex word, counting the messages written
+      std::atomic<uint32_t> waiters; // readers waiting on the futex
+    };
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+      "Shared memory rings need lock-free atomics, which are address-free");
+
+    SharedMemoryRing(const std::string& path, int fd, size_t size, bool owner)
+    : path_{path},
+      mapped_size_{size},
+      owner_{owner}
+    {
+      void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (data == MAP_FAILED)
+      {
+        throw std::runtime_error("Failed to map the shared memory ring: " + path);
+      }
+      header_ = static_cast<Header*>(data);
+    };
+
+    uint64_t* slotFor(uint64_t sequence) const
+    {
+      uint64_t* slots = reinterpret_cast<uint64_t*>(header_ + 1);
+      return slots + ((sequence - 1) % header_->slot_count) * header_->slot_words;
+    };
+
+    void wake()
+    {
+#ifdef __linux__
+      ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header_->notifications), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+    };
+
+    std::string path_;
+    Header* header_ = nullptr;
+    size_t mapped_size_ = 0;
+    bool owner_ = false;
+
+    /** Sequence number of the next message this reader reads. */
+    uint64_t next_ = 1;
+    uint64_t skipped_ = 0;
+};
+
+typedef std::unique_ptr<SharedMemoryRing> SharedMemoryRingPtr;
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef SIMULATION_CLOCK_HPP
+#define SIMULATION_CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <utility>
+#include <boost/asio.hpp>
+
+#include "seqlock.hpp"
+
+namespace asio = boost::asio;
+
+/** The clock every agent of the process reads and waits on.
+ *  In wall time it is the system clock. In virtual time, used when all agents run in one process, it is a discrete-event clock:
+ *  waits are events of a central queue, and once no thread has work in hand the clock jumps straight to the earliest event and fires it.
+ *  Events fire one at a time, each once the work set off by the one before has run, so that a seeded session repeats exactly.
+ *  Work in hand is counted explicitly: threads taking part are Participants, busy except while they sleep,
+ *  and work handed from one thread to another holds the clock from the hand-over until it has run.
+ *  In wall time, timestamps may be corrected onto a reference clock, such as the exchange's, estimated by clock synchronisation. */
+class SimulationClock
+{
+public:
+
+    typedef std::chrono::nanoseconds duration;
+    typedef unsigned long event_id;
+
+    /** Maps the system clock onto the reference clock: offset nanoseconds ahead of it at system time at, 
+     *  gaining drift nanoseconds per second from then. */
+    struct Correction
+    {
+        int64_t offset = 0;
+        double drift = 0;
+        int64_t at = 0;
+    };
+
+    SimulationClock() = delete;
+
+    /** Switches the process to virtual time, starting at zero, with random seeds drawn from the given seed.
+     *  Must be called before any agent is created. */
+    static void useVirtualTime(uint64_t seed)
+    {
+        State& clock = state();
+        std::lock_guard<std::mutex> lock(clock.mutex);
+        clock.now = duration::zero();
+        clock.seed = seed;
+        virtual_.store(true, std::memory_order_release);
+    }
+
+    /** Indicates whether the process runs on virtual time. */
+    static bool isVirtual()
+    {
+        return virtual_.load(std::memory_order_acquire);
+    }
+
+    /** Returns the time since the epoch, or since the start of the session in virtual time. */
+    static duration now()
+    {
+        if (!isVirtual())
+        {
+            return std::chrono::duration_cast<duration>(std::chrono::system_clock::now().time_since_epoch());
+        }
+        State& clock = state();
+        std::lock_guard<std::mutex> lock(clock.mutex);
+        return clock.now;
+    }
+
+    /** Returns the current time in nanoseconds, as timestamps are kept: on the reference clock if a correction is set. */
+    static unsigned long long nowNanos()
+    {
+        if (isVirtual() || !corrected_.load(std::memory_order_acquire))
+        {
+            return now().count();
+        }
+        int64_t system = systemNanos();
+        Correction correction = correction_.load();
+        return system + correction.offset + static_cast<int64_t>(correction.drift * (system - correction.at) / 1e9);
+    }
+
+    /** Returns the current time in milliseconds, as market data timestamps are kept. */
+    static unsigned long long nowMillis()
+    {
+        return nowNanos() / 1'000'000;
+    }
+
+    /** Returns the uncorrected system time in nanoseconds, which clock synchronisation measures against. */
+    static int64_t systemNanos()
+    {
+        return std::chrono::duration_cast<duration>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /** Returns a monotonic time in nanoseconds for measuring intervals within the process, unaffected by corrections
+     *  or system clock steps. Virtual time in virtual time. */
+    static unsigned long long monotonicNanos()
+    {
+        if (isVirtual())
+        {
+            return now().count();
+        }
+        return std::chrono::duration_cast<duration>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /** Corrects the timestamps of the process onto the reference clock from now on. Ignored in virtual time. */
+    static void setCorrection(const Correction& correction)
+    {
+        correction_.store(correction);
+        corrected_.store(true, std::memory_order_release);
+    }
+
+    /** Returns the correction set, or none if timestamps are kept on the system clock. */
+    static std::optional<Correction> correction()
+    {
+        if (!corrected_.load(std::memory_order_acquire)) return std::nullopt;
+        return correction_.load();
+    }
+
+    /** Blocks the calling thread for the given time. In virtual time the caller must be a Participant. */
+    static void sleepFor(duration wait)
+    {
+        if (!isVirtual())
+        {
+            std::this_thread::sleep_for(wait);
+            return;
+        }
+
+        State& clock = state();
+        std::unique_lock<std::mutex> lock(clock.mutex);
+        bool woken = false;
+        push(clock, wait, [&woken, &clock]() {
+            woken = true;
+            clock.wake_cv.notify_all();
+        });
+
+        // The sleeper is idle until its event fires, which hands it the work back
+        release(clock);
+        clock.wake_cv.wait(lock, [&woken]{ return woken; });
+    }
+
+    /** Calls the callback on the executor once the given virtual time has passed, holding the clock until it has run.
+     *  Returns the id of the event, to cancel it. Virtual time only. */
+    static event_id schedule(duration wait, asio::any_io_executor executor, std::function<void()> callback)
+    {
+        State& clock = state();
+        std::lock_guard<std::mutex> lock(clock.mutex);
+        return push(clock, wait, [executor, callback = std::move(callback)]() {
+            asio::post(executor, [callback]() {
+                callback();
+                endWork();
+            });
+        });
+    }
+
+    /** Removes a scheduled event. Returns false if it has already fired. */
+    static bool cancel(event_id id)
+    {
+        State& clock = state();
+        std::lock_guard<std::mutex> lock(clock.mutex);
+        auto it = clock.index.find(id);
+        if (it == clock.index.end()) return false;
+        clock.events.erase(it->second);
+        clock.index.erase(it);
+        return true;
+    }
+
+    /** Holds the clock while work handed to another thread is pending. Each call must be paired with a call to endWork. */
+    static void beginWork()
+    {
+        if (!isVirtual()) return;
+        State& clock = state();
+        std::lock_guard<std::mutex> lock(clock.mutex);
+        ++clock.busy;
+    }
+
+    /** Releases the clock held for work that has now run, firing the next event if no other work is in hand. */
+    static void endWork()
+    {
+        if (!isVirtual()) return;
+        State& clock = state();
+        std::lock_guard<std::mutex> lock(clock.mutex);
+        release(clock);
+    }
+
+    /** Returns the callback wrapped to hold the clock from now until it has run, for posting to another thread. */
+    static std::function<void()> holding(std::function<void()> callback)
+    {
+        if (!isVirtual()) return callback;
+        beginWork();
+        return [callback = std::move(callback)]() {
+            callback();
+            endWork();
+        };
+    }
+
+    /** Blocks until no work is in hand and no event is left, when a virtual time session has run to its end. */
+    static void waitUntilIdle()
+    {
+        State& clock = state();
+        std::unique_lock<std::mutex> lock(clock.mutex);
+        clock.idle_cv.wait(lock, [&clock]{ return clock.busy == 0 && clock.events.empty(); });
+    }
+
+    /** Returns a seed for a random generator: from the random device in wall time,
+     *  and in virtual time the next of a stream drawn from the seed of the session. */
+    static unsigned int randomSeed()
+    {
+        if (!isVirtual()) return std::random_device{}();
+
+        // SplitMix64 of the session seed and the number of seeds handed out
+        State& clock = state();
+        std::lock_guard<std::mutex> lock(clock.mutex);
+        uint64_t z = clock.seed + (++clock.seeds_drawn) * 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return static_cast<unsigned int>(z ^ (z >> 31));
+    }
+
+    /** Marks the calling thread as taking part in the session for the lifetime of the object:
+     *  in virtual time the clock does not move while it runs, only while it sleeps. */
+    class Participant
+    {
+    public:
+
+        Participant()
+        {
+            beginWork();
+        }
+
+        /** Takes over the work begun by the thread that started this one, so that no time passes while it starts. */
+        explicit Participant(std::adopt_lock_t)
+        {
+        }
+
+        Participant(const Participant&) = delete;
+        Participant& operator=(const Participant&) = delete;
+
+        ~Participant()
+        {
+            endWork();
+        }
+    };
+
+private:
+
+    struct State
+    {
+        std::mutex mutex;
+        std::condition_variable wake_cv;  // Sleeping participants wait on this
+        std::condition_variable idle_cv;  // Notified when the last event has run
+
+        duration now {0};
+        uint64_t seed = 0;
+        uint64_t seeds_drawn = 0;
+
+        /** The number of participants running and pieces of work handed over but not yet run. */
+        long busy = 0;
+
+        /** Pending events by due time, ties fired in the order they were scheduled. */
+        std::map<std::pair<duration, event_id>, std::function<void()>> events;
+        std::map<event_id, std::pair<duration, event_id>> index;
+        event_id next_event = 0;
+    };
+
+    static State& state()
+    {
+        static State clock;
+        return clock;
+    }
+
+    /** Queues an event due after the given wait. The mutex must be held. */
+    static event_id push(State& clock, duration wait, std::function<void()> fire)
+    {
+        event_id id = ++clock.next_event;
+        std::pair<duration, event_id> key {clock.now + std::max(wait, duration::zero()), id};
+        clock.events.emplace(key, std::move(fire));
+        clock.index.emplace(id, key);
+        return id;
+    }
+
+    /** Ends a piece of work and, if it was the last in hand, moves to the earliest event and fires it. The mutex must be held. */
+    static void release(State& clock)
+    {
+        if (--clock.busy > 0) return;
+        if (clock.events.empty())
+        {
+            clock.idle_cv.notify_all();
+            return;
+        }
+
+        auto next = clock.events.begin();
+        clock.now = std::max(clock.now, next->first.first);
+        std::function<void()> fire = std::move(next->second);
+        clock.index.erase(next->first.second);
+        clock.events.erase(next);
+
+        // The event holds the clock until what it sets off has run
+        ++clock.busy;
+        fire();
+    }
+
+    static inline std::atomic<bool> virtual_ = false;
+
+    static inline std::atomic<bool> corrected_ = false;
+    static inline SeqLock<Correction> correction_;
+};
+
+#endif
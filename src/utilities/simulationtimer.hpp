@@ -0,0 +1,101 @@
+#ifndef SIMULATION_TIMER_HPP
+#define SIMULATION_TIMER_HPP
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <boost/asio.hpp>
+
+#include "simulationclock.hpp"
+
+namespace asio = boost::asio;
+
+/** A timer with the interface of the asio::steady_timer it replaces, waiting on the SimulationClock:
+ *  an asio timer in wall time, and an event of the clock's queue in virtual time.
+ *  As with an asio timer, handlers of waits cancelled or replaced are called with operation_aborted. */
+class SimulationTimer
+{
+public:
+
+    typedef std::function<void(const boost::system::error_code&)> handler_type;
+
+    SimulationTimer() = delete;
+    SimulationTimer(const SimulationTimer&) = delete;
+    SimulationTimer& operator=(const SimulationTimer&) = delete;
+
+    explicit SimulationTimer(asio::any_io_executor executor)
+    : executor_{executor},
+      timer_{executor}
+    {
+    }
+
+    explicit SimulationTimer(asio::io_context& io_context)
+    : SimulationTimer(io_context.get_executor())
+    {
+    }
+
+    ~SimulationTimer()
+    {
+        cancel();
+    }
+
+    /** Sets the time the next wait ends, from now, cancelling any pending wait. */
+    void expires_after(SimulationClock::duration wait)
+    {
+        cancel();
+        std::lock_guard<std::mutex> lock(mutex_);
+        wait_ = wait;
+        if (!SimulationClock::isVirtual())
+        {
+            timer_.expires_after(std::chrono::duration_cast<std::chrono::steady_clock::duration>(wait));
+        }
+    }
+
+    /** Calls the handler on the timer's executor once the wait set by expires_after has passed. */
+    void async_wait(handler_type handler)
+    {
+        if (!SimulationClock::isVirtual())
+        {
+            timer_.async_wait(std::move(handler));
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = handler;
+        event_ = SimulationClock::schedule(wait_, executor_, [handler]() { handler(boost::system::error_code{}); });
+    }
+
+    /** Cancels the pending wait, if it has not ended yet. */
+    void cancel()
+    {
+        if (!SimulationClock::isVirtual())
+        {
+            timer_.cancel();
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (event_.has_value() && SimulationClock::cancel(event_.value()))
+        {
+            asio::post(executor_, SimulationClock::holding([handler = std::move(pending_)]() {
+                handler(asio::error::operation_aborted);
+            }));
+        }
+        event_ = std::nullopt;
+        pending_ = nullptr;
+    }
+
+private:
+
+    asio::any_io_executor executor_;
+    asio::steady_timer timer_;
+
+    /** The wait set by expires_after, and the event and handler of the pending wait in virtual time. */
+    SimulationClock::duration wait_ {0};
+    std::optional<SimulationClock::event_id> event_;
+    handler_type pending_;
+    std::mutex mutex_;
+};
+
+#endif
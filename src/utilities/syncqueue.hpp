@@ -5,6 +5,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <chrono>
 
 /** Thread-safe FIFO synchronised queue. */
 template <typename T>
@@ -46,6 +47,21 @@ public:
       return value;
     };
 
+    /** Waits until present or the deadline passes and pops the value from the start of the queue. 
+     *  Returns null ptr on timeout or if the queue is closed. */
+    T popUntil(std::chrono::steady_clock::time_point deadline)
+    {
+      std::unique_lock<std::mutex> lock(lock_); 
+      if (!cv_.wait_until(lock, deadline, [this]{ return !queue_.empty() || closed_; })) return nullptr;
+
+      // Return null ptr if waiting on closed
+      if (closed_) return nullptr;
+
+      T value = queue_.front();
+      queue_.pop();
+      return value;
+    };
+
     /** Returns the size of the queue. */
     unsigned int size()
     {
@@ -0,0 +1,31 @@
+#ifndef TAPE_COMPRESSION_HPP
+#define TAPE_COMPRESSION_HPP
+
+#include <string>
+
+enum class TapeCompression : int
+{
+    NONE,       // All CSV outputs are written as plain text
+    MESSAGES,   // Only the message tape is compressed
+    ALL         // The message tape, trade tapes, market data feeds and LOB snapshots are compressed
+};
+
+inline std::string to_string(TapeCompression compression)
+{
+    switch (compression) {
+        case TapeCompression::NONE: return std::string{"none"};
+        case TapeCompression::MESSAGES: return std::string{"messages"};
+        case TapeCompression::ALL: return std::string{"all"};
+        default: return std::string{""};
+    }
+}
+
+/** Returns the tape compression for the given name. Defaults to no compression. */
+inline TapeCompression tape_compression_from_string(std::string_view name)
+{
+    if (name == "messages") return TapeCompression::MESSAGES;
+    if (name == "all") return TapeCompression::ALL;
+    return TapeCompression::NONE;
+}
+
+#endif
\ No newline at end of file
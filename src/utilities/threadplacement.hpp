@@ -0,0 +1,373 @@
+#ifndef THREAD_PLACEMENT_HPP
+#define THREAD_PLACEMENT_HPP
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#include <filesystem>
+#endif
+
+#include "logger.hpp"
+
+/** The busy threads of a node, pinned to CPUs by role. */
+enum class ThreadRole : int
+{
+    IO,         // Run the network IO context
+    MATCHING,   // Match the orders of a ticker, each given a CPU of its own when there are enough
+    SESSION,    // Time the trading window and the auction uncrosses
+    WRITER      // Write the tapes, feeds and snapshots in the background
+};
+
+inline std::string to_string(ThreadRole role)
+{
+    switch (role)
+    {
+        case ThreadRole::IO:
+            return std::string{"io"};
+        case ThreadRole::MATCHING:
+            return std::string{"matching"};
+        case ThreadRole::SESSION:
+            return std::string{"session"};
+        case ThreadRole::WRITER:
+            return std::string{"writer"};
+        default:
+            throw std::runtime_error("Unknown thread role");
+    }
+}
+
+inline ThreadRole thread_role_from_string(std::string_view role)
+{
+    if (role == "io") return ThreadRole::IO;
+    if (role == "matching") return ThreadRole::MATCHING;
+    if (role == "session") return ThreadRole::SESSION;
+    if (role == "writer") return ThreadRole::WRITER;
+    throw std::runtime_error("Unknown thread role: " + std::string{role});
+}
+
+/** Process-wide CPU placement of the node's threads by role. Threads pinned to the CPUs of one NUMA node
+ *  allocate from its memory under the kernel's default local allocation policy, so placements keep every role on one node.
+ *  A placement is either explicit, as "io=0;matching=2-3;session,writer=4,5" in the CPU list format of Linux,
+ *  or "auto", which divides the CPUs the process may run on - the exclusive cores of a Kubernetes pod with guaranteed CPU
+ *  under the static CPU manager - giving the matching engines cores of their own, preferring the kernel's isolated cores.
+ *  Roles not placed are left to the scheduler. Only supported on Linux; elsewhere nothing is pinned. Safe from any thread. */
+class ThreadPlacement
+{
+public:
+
+    /** Returns the process-wide placement. */
+    static ThreadPlacement& instance()
+    {
+      static ThreadPlacement placement;
+      return placement;
+    };
+
+    ThreadPlacement(const ThreadPlacement&) = delete;
+    ThreadPlacement& operator=(const ThreadPlacement&) = delete;
+
+    /** Places the roles as the given specification says, for the given number of matching engine threads,
+     *  replacing any placement already configured. Throws if the specification is malformed. */
+    void configure(std::string_view spec, size_t matching_threads)
+    {
+      std::array<std::vector<int>, ROLE_COUNT> cpus;
+      if (spec == "auto")
+      {
+        cpus = placeAutomatically(matching_threads);
+      }
+      else
+      {
+        cpus = parse(spec);
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      spec_ = std::string{spec};
+      cpus_ = std::move(cpus);
+      for (size_t role = 0; role < ROLE_COUNT; ++role)
+      {
+        if (!cpus_[role].empty())
+        {
+          LOG_INFO("Pinning " << to_string(static_cast<ThreadRole>(role)) << " threads to CPUs " << formatList(cpus_[role]));
+        }
+      }
+    };
+
+    /** Returns the specification last configured, empty if none. */
+    std::string spec() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return spec_;
+    };
+
+    /** Pins the calling thread to the CPUs of its role. The matching engine of the given index gets one of them to itself.
+     *  Returns false if its role is not placed or the thread could not be pinned. */
+    bool pinCurrent(ThreadRole role, size_t index = 0)
+    {
+      return pin(currentThread(), role, index);
+    };
+
+    /** Returns the handle of the calling thread, for pinning it later from another. */
+    static std::thread::native_handle_type currentThread()
+    {
+      return pthread_self();
+    };
+
+    /** Pins the given thread to the CPUs of its role, as pinCurrent. */
+    bool pin(std::thread::native_handle_type thread, ThreadRole role, size_t index = 0)
+    {
+      std::vector<int> cpus = cpusFor(role, index);
+      if (cpus.empty()) return false;
+
+#ifdef __linux__
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (int cpu : cpus)
+      {
+        CPU_SET(cpu, &set);
+      }
+      int error = pthread_setaffinity_np(thread, sizeof(set), &set);
+      if (error != 0)
+      {
+        LOG_WARN("Failed to pin a " << to_string(role) << " thread to CPUs " << formatList(cpus) << ": error " << error);
+        return false;
+      }
+      return true;
+#else
+      LOG_WARN("Threads are only pinned on Linux, leaving the " << to_string(role) << " thread to the scheduler");
+      return false;
+#endif
+    };
+
+private:
+
+    static constexpr size_t ROLE_COUNT = static_cast<size_t>(ThreadRole::WRITER) + 1;
+
+    /** CPUs beyond this cannot be pinned to with the fixed-size CPU sets of glibc. */
+    static constexpr int MAX_CPUS = 1024;
+
+    ThreadPlacement() = default;
+
+    /** Returns the CPUs a thread of the role and index runs on, empty if the role is not placed. */
+    std::vector<int> cpusFor(ThreadRole role, size_t index) const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const std::vector<int>& cpus = cpus_[static_cast<size_t>(role)];
+      if (role == ThreadRole::MATCHING && cpus.size() > 1)
+      {
+        return std::vector<int>{cpus[index % cpus.size()]};
+      }
+      return cpus;
+    };
+
+    /** Parses "role[,role]=cpus" entries separated by semicolons. */
+    static std::array<std::vector<int>, ROLE_COUNT> parse(std::string_view spec)
+    {
+      std::array<std::vector<int>, ROLE_COUNT> cpus;
+      std::vector<int> placed;
+      std::stringstream entries {std::string{spec}};
+      std::string entry;
+      while (std::getline(entries, entry, ';'))
+      {
+        if (entry.empty()) continue;
+        size_t equals = entry.find('=');
+        if (equals == std::string::npos)
+        {
+          throw std::runtime_error("Invalid CPU affinity entry (missing '='): " + entry);
+        }
+
+        std::vector<int> list = parseList(entry.substr(equals + 1));
+        std::stringstream roles {entry.substr(0, equals)};
+        std::string role;
+        while (std::getline(roles, role, ','))
+        {
+          cpus[static_cast<size_t>(thread_role_from_string(role))] = list;
+        }
+        placed.insert(placed.end(), list.begin(), list.end());
+      }
+
+      size_t nodes = nodesOf(placed).size();
+      if (nodes > 1)
+      {
+        LOG_WARN("CPU affinity " << spec << " spans " << nodes << " NUMA nodes, so threads share memory across them");
+      }
+      return cpus;
+    };
+
+    /** Parses a CPU list such as "0-3,8". */
+    static std::vector<int> parseList(const std::string& list)
+    {
+      std::vector<int> cpus;
+      std::stringstream ranges {list};
+      std::string range;
+      while (std::getline(ranges, range, ','))
+      {
+        if (range.empty()) continue;
+        try
+        {
+          size_t dash = range.find('-');
+          int first = std::stoi(range.substr(0, dash));
+          int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+          if (first < 0 || last >= MAX_CPUS || first > last) throw std::out_of_range(range);
+          for (int cpu = first; cpu <= last; ++cpu)
+          {
+            cpus.push_back(cpu);
+          }
+        }
+        catch (std::logic_error& e)
+        {
+          throw std::runtime_error("Invalid CPU list: " + list);
+        }
+      }
+      std::sort(cpus.begin(), cpus.end());
+      cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+      return cpus;
+    };
+
+    static std::string formatList(const std::vector<int>& cpus)
+    {
+      std::string list;
+      for (int cpu : cpus)
+      {
+        if (!list.empty()) list += ",";
+        list += std::to_string(cpu);
+      }
+      return list;
+    };
+
+    /** Divides the CPUs of the NUMA node the process may run on most of: the matching engines get one each,
+     *  isolated ones first, then IO one, and the session and writer threads share the rest.
+     *  With too few CPUs for that, every role shares the node's CPUs. */
+    static std::array<std::vector<int>, ROLE_COUNT> placeAutomatically(size_t matching_threads)
+    {
+      std::array<std::vector<int>, ROLE_COUNT> cpus;
+      std::vector<int> allowed = allowedCPUs();
+      if (allowed.empty())
+      {
+        LOG_WARN("Cannot place threads automatically: the CPUs the process may run on are unknown");
+        return cpus;
+      }
+
+      // Stay on one node so that the threads' memory is local to all of them
+      std::map<int, std::vector<int>> by_node;
+      for (int cpu : allowed)
+      {
+        by_node[nodeOf(cpu)].push_back(cpu);
+      }
+      std::vector<int> pool = std::max_element(by_node.begin(), by_node.end(),
+        [](const auto& a, const auto& b) { return a.second.size() < b.second.size(); })->second;
+
+      std::vector<int> isolated = readList("/sys/devices/system/cpu/isolated");
+      std::stable_partition(pool.begin(), pool.end(), [&isolated](int cpu) {
+        return std::binary_search(isolated.begin(), isolated.end(), cpu);
+      });
+
+      auto take = [&pool](size_t count) {
+        std::vector<int> taken {pool.begin(), pool.begin() + count};
+        pool.erase(pool.begin(), pool.begin() + count);
+        std::sort(taken.begin(), taken.end());
+        return taken;
+      };
+
+      size_t matching = std::max<size_t>(matching_threads, 1);
+      if (pool.size() >= matching + 2)
+      {
+        cpus[static_cast<size_t>(ThreadRole::MATCHING)] = take(matching);
+        cpus[static_cast<size_t>(ThreadRole::IO)] = take(1);
+      }
+      else if (pool.size() == matching + 1)
+      {
+        cpus[static_cast<size_t>(ThreadRole::MATCHING)] = take(matching);
+        cpus[static_cast<size_t>(ThreadRole::IO)] = pool;
+      }
+      else
+      {
+        LOG_WARN("Only " << pool.size() << " CPUs for " << matching << " matching engines, so no thread gets a CPU of its own");
+        cpus[static_cast<size_t>(ThreadRole::MATCHING)] = pool;
+        cpus[static_cast<size_t>(ThreadRole::IO)] = pool;
+      }
+      std::sort(pool.begin(), pool.end());
+      cpus[static_cast<size_t>(ThreadRole::SESSION)] = pool;
+      cpus[static_cast<size_t>(ThreadRole::WRITER)] = pool;
+      return cpus;
+    };
+
+    /** Returns the CPUs the process may run on, which in a container are those of its cgroup's cpuset. */
+    static std::vector<int> allowedCPUs()
+    {
+      std::vector<int> cpus;
+#ifdef __linux__
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      if (sched_getaffinity(0, sizeof(set), &set) != 0) return cpus;
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      {
+        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+      }
+#endif
+      return cpus;
+    };
+
+    /** Returns the NUMA node of the CPU, or zero if the system does not say. */
+    static int nodeOf(int cpu)
+    {
+#ifdef __linux__
+      std::error_code error;
+      std::filesystem::directory_iterator entries {"/sys/devices/system/cpu/cpu" + std::to_string(cpu), error};
+      for (; !error && entries != std::filesystem::directory_iterator{}; entries.increment(error))
+      {
+        std::string name = entries->path().filename().string();
+        if (name.starts_with("node") && name.size() > 4 && std::isdigit(static_cast<unsigned char>(name[4])))
+        {
+          return std::stoi(name.substr(4));
+        }
+      }
+#endif
+      return 0;
+    };
+
+    static std::vector<int> nodesOf(const std::vector<int>& cpus)
+    {
+      std::vector<int> nodes;
+      for (int cpu : cpus)
+      {
+        nodes.push_back(nodeOf(cpu));
+      }
+      std::sort(nodes.begin(), nodes.end());
+      nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+      return nodes;
+    };
+
+    /** Reads a CPU list from a file, empty if it cannot be read. */
+    static std::vector<int> readList(const std::string& path)
+    {
+      std::ifstream file {path};
+      std::string list;
+      if (!file || !std::getline(file, list)) return std::vector<int>{};
+      try
+      {
+        return parseList(list);
+      }
+      catch (std::runtime_error& e)
+      {
+        return std::vector<int>{};
+      }
+    };
+
+    /** The CPUs of each role, empty for roles left to the scheduler. */
+    std::array<std::vector<int>, ROLE_COUNT> cpus_;
+    std::string spec_;
+    mutable std::mutex mutex_;
+};
+
+#endif
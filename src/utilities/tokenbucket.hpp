@@ -0,0 +1,53 @@
+#ifndef TOKEN_BUCKET_HPP
+#define TOKEN_BUCKET_HPP
+
+#include <algorithm>
+
+/** Admits work at a sustained rate with bursts up to a set size. The bucket holds up to burst tokens and refills at rate tokens
+ *  per second; work is admitted while a token is left and takes its cost in tokens, which may run the bucket into debt, so that
+ *  work costing more than the burst is still admitted once and then paid back. Not thread safe. */
+class TokenBucket
+{
+public:
+
+    TokenBucket() = default;
+
+    /** Creates a full bucket refilling at the given rate per second up to the given burst, as of the given time in nanoseconds. */
+    TokenBucket(double rate, double burst, unsigned long long now)
+    : rate_{rate},
+      burst_{std::max(burst, 1.0)},
+      tokens_{burst_},
+      last_refill_{now}
+    {
+    };
+
+    /** Takes the cost from the bucket and returns true if a token is left at the given time in nanoseconds, otherwise false. */
+    bool admit(unsigned long long now, double cost = 1.0)
+    {
+      refill(now);
+      if (tokens_ < 1.0) return false;
+      tokens_ -= cost;
+      return true;
+    };
+
+    double tokens() const
+    {
+      return tokens_;
+    };
+
+private:
+
+    void refill(unsigned long long now)
+    {
+      if (now <= last_refill_) return;
+      tokens_ = std::min(burst_, tokens_ + rate_ * static_cast<double>(now - last_refill_) / 1e9);
+      last_refill_ = now;
+    };
+
+    double rate_ = 0;
+    double burst_ = 1;
+    double tokens_ = 1;
+    unsigned long long last_refill_ = 0;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../message/messagetype.hpp"
+
+/** The stages of the exchange's handling of a message that are traced. */
+enum class TraceStage : uint8_t
+{
+    SOCKET_READ,        // Reading the rest of a frame from the socket once its header arrived
+    DESERIALISE,        // Deserialising a received message
+    QUEUE_WAIT,         // Waiting on the matching engine's queue
+    MATCH,              // Processing a message in the matching engine, matching orders included
+    EXECUTE_TRADE,      // Executing a trade and reporting it to both traders
+    SERIALISE,          // Serialising an outgoing message, execution reports included
+    MARKET_DATA,        // Publishing market data after a message is processed
+    FANOUT,             // Broadcasting a market data update to the subscribers
+    TAPE_WRITE          // Writing to the message, trade and market data tapes
+};
+
+inline std::string to_string(TraceStage stage)
+{
+    switch (stage) {
+        case TraceStage::SOCKET_READ: return std::string{"socket_read"};
+        case TraceStage::DESERIALISE: return std::string{"deserialise"};
+        case TraceStage::QUEUE_WAIT: return std::string{"queue_wait"};
+        case TraceStage::MATCH: return std::string{"match"};
+        case TraceStage::EXECUTE_TRADE: return std::string{"execute_trade"};
+        case TraceStage::SERIALISE: return std::string{"serialise"};
+        case TraceStage::MARKET_DATA: return std::string{"market_data"};
+        case TraceStage::FANOUT: return std::string{"fanout"};
+        case TraceStage::TAPE_WRITE: return std::string{"tape_write"};
+        default: return std::string{""};
+    }
+}
+
+/** Process-wide tracer of the time spent in each stage, kept in a ring buffer per thread and exported on demand
+ *  in the Chrome trace event format, which Perfetto and chrome://tracing open. Always compiled in: while disabled,
+ *  each traced stage costs one relaxed load. Timestamps are read from the TSC where there is one. */
+class Tracer
+{
+public:
+
+    /** Events kept per thread; older ones are overwritten. */
+    static constexpr size_t RING_SIZE = 1 << 16;
+
+    /** Returns the process-wide tracer. */
+    static Tracer& instance()
+    {
+      static Tracer tracer;
+      return tracer;
+    };
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    /** Indicates whether stages are being traced. */
+    static bool enabled()
+    {
+      return enabled_.load(std::memory_order_relaxed);
+    };
+
+    /** Starts tracing, forgetting the events of any earlier trace. */
+    void start()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto const& buffer : buffers_)
+      {
+        buffer->written.store(0, std::memory_order_relaxed);
+      }
+      enabled_.store(true, std::memory_order_relaxed);
+    };
+
+    /** Stops tracing. The events traced are kept until it is started again. */
+    void stop()
+    {
+      enabled_.store(false, std::memory_order_relaxed);
+    };
+
+    /** Returns the current time in ticks. */
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    };
+
+    /** Records that the stage ran from start to end ticks on the calling thread, for a message of the given type,
+     *  or for no message in particular if EVENT. */
+    void record(TraceStage stage, uint64_t start, uint64_t end, MessageType type = MessageType::EVENT)
+    {
+      thread_local ThreadBuffer* buffer = registerThread();
+      uint64_t index = buffer->written.load(std::memory_order_relaxed);
+      buffer->events[index % RING_SIZE] = Event{start, end, type, stage};
+      buffer->written.store(index + 1, std::memory_order_release);
+    };
+
+    /** Writes the events kept to a Chrome trace file at the given path and returns how many were written.
+     *  Threads still tracing may overwrite events as they are written; stop the tracer first for a consistent trace. */
+    size_t exportChromeTrace(const std::string& path)
+    {
+      std::ofstream out {path};
+      if (!out.is_open())
+      {
+        throw std::runtime_error("Failed to open trace file: " + path);
+      }
+
+      double ticks_per_micro = ticksPerMicrosecond();
+      size_t exported = 0;
+      out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto const& buffer : buffers_)
+      {
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t first = written > RING_SIZE ? written - RING_SIZE : 0;
+        for (uint64_t i = first; i < written; ++i)
+        {
+          const Event& event = buffer->events[i % RING_SIZE];
+          double ts = static_cast<double>(event.start - epoch_ticks_) / ticks_per_micro;
+          double dur = static_cast<double>(event.end > event.start ? event.end - event.start : 0) / ticks_per_micro;
+          out << (exported++ == 0 ? "\n" : ",\n")
+              << "{\"name\":\"" << to_string(event.stage) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id
+              << ",\"ts\":" << ts << ",\"dur\":" << dur;
+          if (event.type != MessageType::EVENT)
+          {
+            out << ",\"args\":{\"type\":\"" << to_string(event.type) << "\"}";
+          }
+          out << "}";
+        }
+      }
+      out << "\n]}\n";
+      return exported;
+    };
+
+private:
+
+    Tracer()
+    : epoch_ticks_{now()},
+      epoch_time_{std::chrono::steady_clock::now()}
+    {
+    };
+
+    struct Event
+    {
+      uint64_t start;
+      uint64_t end;
+      MessageType type;
+      TraceStage stage;
+    };
+
+    /** The events of one thread; written only by that thread. */
+    struct ThreadBuffer
+    {
+      int thread_id;
+      std::atomic<uint64_t> written = 0;
+      std::array<Event, RING_SIZE> events;
+    };
+
+    /** Creates the calling thread's buffer. Buffers outlive their threads so that their events can still be exported. */
+    ThreadBuffer* registerThread()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      buffers_.push_back(std::make_unique<ThreadBuffer>());
+      buffers_.back()->thread_id = static_cast<int>(buffers_.size());
+      return buffers_.back().get();
+    };
+
+    /** Returns the rate of ticks measured against the steady clock since the tracer was created. */
+    double ticksPerMicrosecond() const
+    {
+      uint64_t ticks = now() - epoch_ticks_;
+      double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch_time_).count();
+      return (ticks > 0 && micros > 0) ? ticks / micros : 1.0;
+    };
+
+    static inline std::atomic<bool> enabled_ = false;
+
+    const uint64_t epoch_ticks_;
+    const std::chrono::steady_clock::time_point epoch_time_;
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+/** Traces the stage from its construction to its destruction, if tracing was enabled when it was constructed. */
+class TraceSpan
+{
+public:
+
+    TraceSpan(TraceStage stage, MessageType type = MessageType::EVENT)
+    : stage_{stage},
+      type_{type},
+      start_{Tracer::enabled() ? Tracer::now() : 0}
+    {
+    };
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    ~TraceSpan()
+    {
+      if (start_ != 0) Tracer::instance().record(stage_, start_, Tracer::now(), type_);
+    };
+
+private:
+
+    TraceStage stage_;
+    MessageType type_;
+    uint64_t start_;
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** A fixed pool of worker threads, each running the tasks of its own queue newest first,
+ *  and taking the oldest task of another worker's queue once its own is empty. */
+class WorkStealingPool
+{
+public:
+
+    /** Starts the given number of workers, by default one per hardware thread. */
+    explicit WorkStealingPool(unsigned int threads = std::thread::hardware_concurrency())
+    {
+        threads = std::max(threads, 1u);
+        for (unsigned int i = 0; i < threads; ++i)
+        {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        for (unsigned int i = 0; i < threads; ++i)
+        {
+            threads_.emplace_back(&WorkStealingPool::run, this, i);
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /** Runs the tasks left, then stops the workers. */
+    ~WorkStealingPool()
+    {
+        wait();
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopping_ = true;
+        lock.unlock();
+        work_cv_.notify_all();
+        for (std::thread& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    /** Queues the task on the next worker in turn. */
+    void submit(std::function<void()> task)
+    {
+        Worker& worker = *workers_[next_worker_++ % workers_.size()];
+        std::unique_lock<std::mutex> worker_lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+        worker_lock.unlock();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++queued_;
+        ++unfinished_;
+        lock.unlock();
+        work_cv_.notify_one();
+    }
+
+    /** Blocks until every task submitted has run. */
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]{ return unfinished_ == 0; });
+    }
+
+    /** Returns the number of workers. */
+    size_t size() const
+    {
+        return workers_.size();
+    }
+
+private:
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(size_t index)
+    {
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this]{ return queued_ > 0 || stopping_; });
+            if (queued_ == 0) return;
+            --queued_;
+            lock.unlock();
+
+            // A task counted as queued is in one of the queues until a worker that counted it off takes it
+            std::function<void()> task;
+            while (!take(index, task));
+            task();
+
+            lock.lock();
+            if (--unfinished_ == 0) done_cv_.notify_all();
+        }
+    }
+
+    /** Takes the newest task of the worker's own queue, or else the oldest of another's. Returns false if all are empty. */
+    bool take(size_t index, std::function<void()>& task)
+    {
+        Worker& own = *workers_[index];
+        std::unique_lock<std::mutex> own_lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+        own_lock.unlock();
+
+        for (size_t i = 1; i < workers_.size(); ++i)
+        {
+            Worker& victim = *workers_[(index + i) % workers_.size()];
+            std::unique_lock<std::mutex> victim_lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    size_t next_worker_ = 0; // Tasks are submitted from one thread
+
+    /** Tasks queued but not yet counted off by a worker, and tasks not yet run, guarded by the mutex. */
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    size_t queued_ = 0;
+    size_t unfinished_ = 0;
+    bool stopping_ = false;
+};
+
+#endif